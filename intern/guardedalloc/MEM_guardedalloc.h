@@ -230,6 +230,14 @@ extern const char *(*MEM_name_ptr)(void *vmemh);
 /* Switch allocator to slower but fully guarded mode. */
 void MEM_use_guarded_allocator(void);
 
+/**
+ * Allocate small blocks of the lock-free allocator from size-class slabs with per-thread caches,
+ * instead of using the system allocator for every block. Blocks are always freed by the
+ * allocator they come from, so this can be changed at any time.
+ * Has no effect for the guarded allocator and on platforms without slab support.
+ */
+void MEM_use_slab_allocator(const bool use);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -99,6 +99,11 @@ void aligned_free(void *ptr)
 #endif
 }
 
+void MEM_use_slab_allocator(const bool use)
+{
+  MEM_lockfree_use_slab_allocator(use);
+}
+
 void MEM_use_guarded_allocator(void)
 {
   MEM_allocN_len = MEM_guarded_allocN_len;
@@ -112,6 +112,21 @@ size_t malloc_usable_size(void *ptr);
 void *aligned_malloc(size_t size, size_t alignment);
 void aligned_free(void *ptr);
 
+/* Small blocks of the lock-free allocator can come from size-class slabs with per-thread caches,
+ * this relies on pthreads to give the caches of exiting threads back. */
+#if !defined(WIN32)
+#  define WITH_MEM_SLAB
+#endif
+
+#ifdef WITH_MEM_SLAB
+/* Largest block (including MemHead) allocated from slabs. */
+#  define MEM_SLAB_BLOCK_SIZE_MAX 512
+
+void *mem_slab_alloc(const size_t block_size) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void mem_slab_free(void *ptr, const size_t block_size);
+size_t mem_slab_reserved(void);
+#endif
+
 /* Prototypes for counted allocator functions */
 size_t MEM_lockfree_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
 void MEM_lockfree_freeN(void *vmemh);
@@ -159,6 +174,7 @@ size_t MEM_lockfree_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
 #ifndef NDEBUG
 const char *MEM_lockfree_name_ptr(void *vmemh);
 #endif
+void MEM_lockfree_use_slab_allocator(const bool use);
 
 /* Prototypes for fully guarded allocator functions */
 size_t MEM_guarded_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
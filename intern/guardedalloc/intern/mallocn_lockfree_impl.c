@@ -46,6 +46,7 @@ typedef struct MemHeadAligned {
 static unsigned int totblock = 0;
 static size_t mem_in_use = 0, mmap_in_use = 0, peak_mem = 0;
 static bool malloc_debug_memset = false;
+static bool use_slab_allocator = false;
 
 static void (*error_callback)(const char *) = NULL;
 static void (*thread_lock_callback)(void) = NULL;
@@ -62,6 +63,11 @@ enum {
 #define MEMHEAD_IS_MMAP(memhead) ((memhead)->len & (size_t)MEMHEAD_MMAP_FLAG)
 #define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t)MEMHEAD_ALIGN_FLAG)
 
+/* The length is only aligned to 4 bytes, use the highest bit for blocks allocated from slabs. */
+#define MEMHEAD_SLAB_FLAG ((size_t)1 << (sizeof(size_t) * 8 - 1))
+#define MEMHEAD_IS_SLAB(memhead) ((memhead)->len & MEMHEAD_SLAB_FLAG)
+#define MEMHEAD_FLAGS ((size_t)(MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG) | MEMHEAD_SLAB_FLAG)
+
 /* Uncomment this to have proper peak counter. */
 #define USE_ATOMIC_MAX
 
@@ -93,6 +99,29 @@ print_error(const char *str, ...)
   }
 }
 
+/* Allocate a block with room for len bytes, from a slab when enabled and small enough. */
+MEM_INLINE MemHead *memhead_alloc(const size_t len, const bool clear)
+{
+  MemHead *memh;
+#ifdef WITH_MEM_SLAB
+  if (use_slab_allocator && len + sizeof(MemHead) <= MEM_SLAB_BLOCK_SIZE_MAX) {
+    memh = (MemHead *)mem_slab_alloc(len + sizeof(MemHead));
+    if (LIKELY(memh)) {
+      if (clear) {
+        memset(memh + 1, 0, len);
+      }
+      memh->len = len | MEMHEAD_SLAB_FLAG;
+      return memh;
+    }
+  }
+#endif
+  memh = (MemHead *)(clear ? calloc(1, len + sizeof(MemHead)) : malloc(len + sizeof(MemHead)));
+  if (LIKELY(memh)) {
+    memh->len = len;
+  }
+  return memh;
+}
+
 #if defined(WIN32)
 static void mem_lock_thread(void)
 {
@@ -110,7 +139,7 @@ static void mem_unlock_thread(void)
 size_t MEM_lockfree_allocN_len(const void *vmemh)
 {
   if (vmemh) {
-    return MEMHEAD_FROM_PTR(vmemh)->len & ~((size_t)(MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG));
+    return MEMHEAD_FROM_PTR(vmemh)->len & ~MEMHEAD_FLAGS;
   }
   else {
     return 0;
@@ -153,6 +182,11 @@ void MEM_lockfree_freeN(void *vmemh)
       MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
       aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
     }
+#ifdef WITH_MEM_SLAB
+    else if (MEMHEAD_IS_SLAB(memh)) {
+      mem_slab_free(memh, len + sizeof(MemHead));
+    }
+#endif
     else {
       free(memh);
     }
@@ -264,10 +298,9 @@ void *MEM_lockfree_callocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+  memh = memhead_alloc(len, true);
 
   if (LIKELY(memh)) {
-    memh->len = len;
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
@@ -305,14 +338,13 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)malloc(len + sizeof(MemHead));
+  memh = memhead_alloc(len, false);
 
   if (LIKELY(memh)) {
     if (UNLIKELY(malloc_debug_memset && len)) {
       memset(memh + 1, 255, len);
     }
 
-    memh->len = len;
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
@@ -456,6 +488,12 @@ void MEM_lockfree_printmemlist_stats(void)
 {
   printf("\ntotal memory len: %.3f MB\n", (double)mem_in_use / (double)(1024 * 1024));
   printf("peak memory len: %.3f MB\n", (double)peak_mem / (double)(1024 * 1024));
+#ifdef WITH_MEM_SLAB
+  if (use_slab_allocator) {
+    printf("slab memory reserved: %.3f MB\n",
+           (double)mem_slab_reserved() / (double)(1024 * 1024));
+  }
+#endif
   printf(
       "\nFor more detailed per-block statistics run Blender with memory debugging command line "
       "argument.\n");
@@ -487,6 +525,11 @@ void MEM_lockfree_set_memory_debug(void)
   malloc_debug_memset = true;
 }
 
+void MEM_lockfree_use_slab_allocator(const bool use)
+{
+  use_slab_allocator = use;
+}
+
 size_t MEM_lockfree_get_memory_in_use(void)
 {
   return mem_in_use;
@@ -0,0 +1,229 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Size-class slabs for small blocks of the lock-free allocator.
+ *
+ * Every thread keeps a cache of free blocks per size class, so allocating and freeing does not
+ * need any synchronization in the common case. Blocks move between the thread caches and a
+ * depot shared by all threads in batches, which keeps the memory freed by one thread available
+ * to the others. The depot is only locked for linking or unlinking a single batch.
+ *
+ * Slabs are never given back to the system, free blocks are recycled instead.
+ */
+
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+#include "mallocn_intern.h"
+
+#ifdef WITH_MEM_SLAB
+
+#  include <pthread.h>
+
+#  define SLAB_CLASS_SIZE_STEP 16
+#  define SLAB_CLASS_NUM (MEM_SLAB_BLOCK_SIZE_MAX / SLAB_CLASS_SIZE_STEP)
+#  define SLAB_CLASS_FROM_BLOCK_SIZE(block_size) \
+    ((unsigned int)(((block_size)-1) / SLAB_CLASS_SIZE_STEP))
+#  define SLAB_CLASS_BLOCK_SIZE(class) ((size_t)((class) + 1) * SLAB_CLASS_SIZE_STEP)
+
+/* Number of blocks moved at once between a thread cache and the depot,
+ * also the number of blocks in a slab. */
+#  define SLAB_BATCH_LEN 64
+
+/* Free blocks are linked through their own memory, the smallest class has room for both. */
+typedef struct SlabFreeBlock {
+  struct SlabFreeBlock *next;
+  /* Next batch in the depot, only set for the first block of a batch. */
+  struct SlabFreeBlock *next_batch;
+} SlabFreeBlock;
+
+typedef struct SlabDepot {
+  SlabFreeBlock *batches;
+  uint32_t lock;
+  /* Avoid false sharing between the depots of different classes. */
+  char _pad[64 - sizeof(SlabFreeBlock *) - sizeof(uint32_t)];
+} SlabDepot;
+
+typedef struct SlabThreadCache {
+  SlabFreeBlock *free[SLAB_CLASS_NUM];
+  unsigned int free_len[SLAB_CLASS_NUM];
+  /* The cache is given back to the depot when the thread exits. */
+  bool is_registered;
+} SlabThreadCache;
+
+static SlabDepot slab_depots[SLAB_CLASS_NUM];
+static size_t slab_reserved = 0;
+
+static __thread SlabThreadCache slab_thread_cache;
+static pthread_key_t slab_thread_key;
+static pthread_once_t slab_thread_key_once = PTHREAD_ONCE_INIT;
+
+MEM_INLINE void slab_depot_lock(SlabDepot *depot)
+{
+  while (atomic_cas_uint32(&depot->lock, 0, 1) != 0) {
+    /* Spin, the lock is only held for a few instructions. */
+  }
+}
+
+MEM_INLINE void slab_depot_unlock(SlabDepot *depot)
+{
+  atomic_cas_uint32(&depot->lock, 1, 0);
+}
+
+static void slab_depot_batch_add(const unsigned int class, SlabFreeBlock *batch)
+{
+  SlabDepot *depot = &slab_depots[class];
+  slab_depot_lock(depot);
+  batch->next_batch = depot->batches;
+  depot->batches = batch;
+  slab_depot_unlock(depot);
+}
+
+static SlabFreeBlock *slab_depot_batch_pop(const unsigned int class)
+{
+  SlabDepot *depot = &slab_depots[class];
+  slab_depot_lock(depot);
+  SlabFreeBlock *batch = depot->batches;
+  if (batch != NULL) {
+    depot->batches = batch->next_batch;
+  }
+  slab_depot_unlock(depot);
+  return batch;
+}
+
+/* Give all cached blocks of an exiting thread to the depot. */
+static void slab_thread_cache_exit(void *cache_v)
+{
+  SlabThreadCache *cache = cache_v;
+  for (unsigned int class = 0; class < SLAB_CLASS_NUM; class++) {
+    if (cache->free[class] != NULL) {
+      slab_depot_batch_add(class, cache->free[class]);
+      cache->free[class] = NULL;
+      cache->free_len[class] = 0;
+    }
+  }
+  /* Destructors running after this one may still allocate and register the cache again. */
+  cache->is_registered = false;
+}
+
+static void slab_thread_key_create(void)
+{
+  pthread_key_create(&slab_thread_key, slab_thread_cache_exit);
+}
+
+MEM_INLINE SlabThreadCache *slab_thread_cache_ensure(void)
+{
+  SlabThreadCache *cache = &slab_thread_cache;
+  if (UNLIKELY(!cache->is_registered)) {
+    pthread_once(&slab_thread_key_once, slab_thread_key_create);
+    pthread_setspecific(slab_thread_key, cache);
+    cache->is_registered = true;
+  }
+  return cache;
+}
+
+static void slab_thread_cache_refill(SlabThreadCache *cache, const unsigned int class)
+{
+  SlabFreeBlock *batch = slab_depot_batch_pop(class);
+  if (batch != NULL) {
+    unsigned int batch_len = 0;
+    for (SlabFreeBlock *block = batch; block; block = block->next) {
+      batch_len++;
+    }
+    cache->free[class] = batch;
+    cache->free_len[class] = batch_len;
+    return;
+  }
+
+  const size_t block_size = SLAB_CLASS_BLOCK_SIZE(class);
+  char *slab = malloc(block_size * SLAB_BATCH_LEN);
+  if (UNLIKELY(slab == NULL)) {
+    return;
+  }
+  atomic_add_and_fetch_z(&slab_reserved, block_size * SLAB_BATCH_LEN);
+
+  SlabFreeBlock *first = NULL;
+  for (size_t i = SLAB_BATCH_LEN; i--;) {
+    SlabFreeBlock *block = (SlabFreeBlock *)(slab + i * block_size);
+    block->next = first;
+    first = block;
+  }
+  cache->free[class] = first;
+  cache->free_len[class] = SLAB_BATCH_LEN;
+}
+
+/* Move the first batch of cached blocks to the depot. */
+static void slab_thread_cache_flush(SlabThreadCache *cache, const unsigned int class)
+{
+  SlabFreeBlock *batch = cache->free[class];
+  SlabFreeBlock *last = batch;
+  for (unsigned int i = 1; i < SLAB_BATCH_LEN; i++) {
+    last = last->next;
+  }
+  cache->free[class] = last->next;
+  cache->free_len[class] -= SLAB_BATCH_LEN;
+  last->next = NULL;
+
+  slab_depot_batch_add(class, batch);
+}
+
+void *mem_slab_alloc(const size_t block_size)
+{
+  const unsigned int class = SLAB_CLASS_FROM_BLOCK_SIZE(block_size);
+  SlabThreadCache *cache = slab_thread_cache_ensure();
+
+  if (UNLIKELY(cache->free[class] == NULL)) {
+    slab_thread_cache_refill(cache, class);
+    if (UNLIKELY(cache->free[class] == NULL)) {
+      return NULL;
+    }
+  }
+
+  SlabFreeBlock *block = cache->free[class];
+  cache->free[class] = block->next;
+  cache->free_len[class]--;
+  return block;
+}
+
+void mem_slab_free(void *ptr, const size_t block_size)
+{
+  const unsigned int class = SLAB_CLASS_FROM_BLOCK_SIZE(block_size);
+  SlabThreadCache *cache = slab_thread_cache_ensure();
+
+  SlabFreeBlock *block = ptr;
+  block->next = cache->free[class];
+  cache->free[class] = block;
+
+  /* Keep a full batch after flushing, so alternating allocations and frees stay local. */
+  if (UNLIKELY(++cache->free_len[class] >= SLAB_BATCH_LEN * 2)) {
+    slab_thread_cache_flush(cache, class);
+  }
+}
+
+size_t mem_slab_reserved(void)
+{
+  return slab_reserved;
+}
+
+#endif /* WITH_MEM_SLAB */
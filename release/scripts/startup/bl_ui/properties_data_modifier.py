@@ -194,10 +194,13 @@ class DATA_PT_modifiers(ModifierButtonsPanel, Panel):
         col.label(text="Object:")
         col.prop(md, "object", text="")
 
-        layout.prop(md, "double_threshold")
+        layout.row().prop(md, "solver", expand=True)
 
-        if bpy.app.debug:
-            layout.prop(md, "debug_options")
+        if md.solver == 'FAST':
+            layout.prop(md, "double_threshold")
+
+            if bpy.app.debug:
+                layout.prop(md, "debug_options")
 
     def BUILD(self, layout, _ob, md):
         split = layout.split()
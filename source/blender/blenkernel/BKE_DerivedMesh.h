@@ -393,6 +393,8 @@ void makeDerivedMesh(struct Depsgraph *depsgraph,
                      struct Object *ob,
                      struct BMEditMesh *em,
                      const struct CustomData_MeshMasks *dataMask);
+void mesh_modifier_stack_cache_free(struct Object *ob);
+int mesh_modifier_stack_cache_reused_len(const struct Object *ob);
 
 void DM_calc_loop_tangents(DerivedMesh *dm,
                            bool calc_active_tangent,
@@ -73,6 +73,11 @@ typedef enum eCDAllocType {
   CD_REFERENCE = 3,
   /** Do a full copy of all layers, only allowed if source has same number of elements. */
   CD_DUPLICATE = 4,
+  /**
+   * Share the data of the source layers, which are reference counted. Shared data is
+   * immutable, it's copied before writing by #CustomData_duplicate_referenced_layer.
+   */
+  CD_SHARE = 5,
 } eCDAllocType;
 
 #define CD_TYPE_AS_MASK(_type) (CustomDataMask)((CustomDataMask)1 << (CustomDataMask)(_type))
@@ -217,7 +222,8 @@ bool CustomData_has_layer(const struct CustomData *data, int type);
 int CustomData_number_of_layers(const struct CustomData *data, int type);
 int CustomData_number_of_layers_typemask(const struct CustomData *data, CustomDataMask mask);
 
-/* duplicate data of a layer with flag NOFREE, and remove that flag.
+/* duplicate data of a layer with flag NOFREE, and remove that flag,
+ * or of a layer which shares its data with other layers (see CD_SHARE).
  * returns the layer data */
 void *CustomData_duplicate_referenced_layer(struct CustomData *data,
                                             const int type,
@@ -231,6 +237,7 @@ void *CustomData_duplicate_referenced_layer_named(struct CustomData *data,
                                                   const char *name,
                                                   const int totelem);
 bool CustomData_is_referenced_layer(struct CustomData *data, int type);
+bool CustomData_is_shared_layer(const struct CustomData *data, int type);
 
 /* set the CD_FLAG_NOCOPY flag in custom data layers where the mask is
  * zero for the layer type, so only layer types specified by the mask
@@ -238,6 +245,16 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type);
  */
 void CustomData_set_only_copy(const struct CustomData *data, CustomDataMask mask);
 
+/* hash the layout & contents of all layers, to detect changes between evaluations */
+bool CustomData_hash(const struct CustomData *data,
+                     const int totelem,
+                     const CustomDataMask mask_skip,
+                     uint32_t *r_hash);
+bool CustomData_equals(const struct CustomData *data_a,
+                       const struct CustomData *data_b,
+                       const int totelem,
+                       const CustomDataMask mask_skip);
+
 /* copies data from one CustomData object to another
  * objects need not be compatible, each source layer is copied to the
  * first dest layer of correct type (if there is none, the layer is skipped)
@@ -395,6 +412,7 @@ void CustomData_set_layer_flag(struct CustomData *data, int type, int flag);
 void CustomData_clear_layer_flag(struct CustomData *data, int type, int flag);
 
 void CustomData_bmesh_set_default(struct CustomData *data, void **block);
+void CustomData_bmesh_alloc_block(struct CustomData *data, void **block);
 void CustomData_bmesh_free_block(struct CustomData *data, void **block);
 void CustomData_bmesh_free_block_data(struct CustomData *data, void *block);
 void CustomData_bmesh_free_block_data_exclude_by_type(struct CustomData *data,
@@ -152,7 +152,8 @@ enum {
   G_DEBUG_GPU_SHADERS = (1 << 18),           /* GLSL shaders */
   G_DEBUG_GPU_FORCE_WORKAROUNDS = (1 << 19), /* force gpu workarounds bypassing detections. */
 
-  G_DEBUG_GHOST = (1 << 20), /* Debug GHOST module. */
+  G_DEBUG_GHOST = (1 << 20),           /* Debug GHOST module. */
+  G_DEBUG_DEPSGRAPH_TRACE = (1 << 21), /* depsgraph evaluation timeline */
 };
 
 #define G_DEBUG_ALL \
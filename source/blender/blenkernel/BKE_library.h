@@ -61,6 +61,9 @@ void *BKE_libblock_alloc(struct Main *bmain, short type, const char *name, const
     ATTR_WARN_UNUSED_RESULT;
 void BKE_libblock_init_empty(struct ID *id) ATTR_NONNULL(1);
 
+void BKE_libblock_session_uuid_ensure(struct ID *id) ATTR_NONNULL(1);
+void BKE_libblock_session_uuid_renew(struct ID *id) ATTR_NONNULL(1);
+
 void *BKE_id_new(struct Main *bmain, const short type, const char *name);
 void *BKE_id_new_nomain(const short type, const char *name);
 
@@ -96,6 +99,8 @@ enum {
   LIB_ID_COPY_NO_ANIMDATA = 1 << 19,
   /** Mesh: Reference CD data layers instead of doing real copy - USE WITH CAUTION! */
   LIB_ID_COPY_CD_REFERENCE = 1 << 20,
+  /** Mesh: Share CD data layers, they're copied before writing (see #CD_SHARE). */
+  LIB_ID_COPY_CD_SHARE = 1 << 21,
 
   /* *** XXX Hackish/not-so-nice specific behaviors needed for some corner cases. *** */
   /* *** Ideally we should not have those, but we need them for now... *** */
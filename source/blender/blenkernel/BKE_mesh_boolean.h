@@ -0,0 +1,39 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+#ifndef __BKE_MESH_BOOLEAN_H__
+#define __BKE_MESH_BOOLEAN_H__
+
+/** \file
+ * \ingroup bke
+ */
+
+#include "BLI_utildefines.h"
+
+struct Mesh;
+
+struct Mesh *BKE_mesh_boolean(const struct Mesh *mesh_a,
+                              const struct Mesh *mesh_b,
+                              const float mat_b[4][4],
+                              const bool flip_b,
+                              const short *material_remap_b,
+                              const int material_remap_b_len,
+                              const int operation);
+
+#endif /* __BKE_MESH_BOOLEAN_H__ */
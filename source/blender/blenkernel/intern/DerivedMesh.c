@@ -27,17 +27,21 @@
 #include "MEM_guardedalloc.h"
 
 #include "DNA_cloth_types.h"
+#include "DNA_color_types.h"
+#include "DNA_curveprofile_types.h"
 #include "DNA_customdata_types.h"
 #include "DNA_key_types.h"
 #include "DNA_material_types.h"
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 
 #include "BLI_array.h"
 #include "BLI_blenlib.h"
 #include "BLI_bitmap.h"
+#include "BLI_hash_mm2a.h"
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
 #include "BLI_linklist.h"
@@ -809,6 +813,7 @@ static void mesh_calc_modifier_final_normals(const Mesh *mesh_input,
     if (!CustomData_has_layer(&mesh_final->pdata, CD_NORMAL)) {
       float(*polynors)[3] = CustomData_add_layer(
           &mesh_final->pdata, CD_NORMAL, CD_CALLOC, NULL, mesh_final->totpoly);
+      BKE_mesh_ensure_mvert_unshared(mesh_final);
       BKE_mesh_calc_normals_poly(mesh_final->mvert,
                                  NULL,
                                  mesh_final->totvert,
@@ -869,6 +874,1034 @@ static void mesh_calc_finalize(const Mesh *mesh_input, Mesh *mesh_eval)
   mesh_eval->edit_mesh = mesh_input->edit_mesh;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Modifier Stack Cache
+ *
+ * The results of the modifiers are kept between evaluations of the stack, so that changing
+ * the settings of a modifier only needs the modifiers from that one onward to be evaluated
+ * again. Every result is keyed by a hash of the stack input and the settings of all modifiers
+ * up to that point. A matching hash is only a candidate: the input and the settings are
+ * compared to exact copies kept along with the results before one is used.
+ *
+ * Only modifiers which don't depend on time or other data-blocks can be cached, their result
+ * is fully defined by the key. Caching stops at the first modifier which can't be cached.
+ * The leading deform modifiers are cached along with the others when all of them can be,
+ * otherwise caching starts after them and their coordinates are part of the input.
+ *
+ * Results which are only deformed share the topology arrays of the copy of the input, only
+ * their own coordinates are stored. When nothing but the input coordinates change, the
+ * results are outdated but the copy of the input is kept with the new coordinates swapped in,
+ * so the topology arrays outlive the change.
+ *
+ * Only the active object is cached, the one being edited, and within a memory budget:
+ * results which don't fit aren't stored.
+ * \{ */
+
+/** Memory the input and the results of an object may take in the cache. */
+#define MODIFIER_STACK_CACHE_MEM_MAX ((size_t)256 << 20)
+
+/** Bytes a hash was computed from, compared when the hash matches. */
+typedef struct ModifierStackCacheKey {
+  uchar *data;
+  size_t len;
+  size_t len_alloc;
+} ModifierStackCacheKey;
+
+typedef struct ModifierStackCacheInput {
+  /** Evaluation state, data masks and the mesh settings the modifiers may read. */
+  ModifierStackCacheKey state;
+  /** Copy of the geometry of the input mesh, deformed results share its topology. */
+  Mesh *mesh;
+  /** Coordinates from the leading deform modifiers, when they aren't cached. */
+  float (*deformed_verts)[3];
+  int num_deformed_verts;
+  /** Memory owned by the input. */
+  size_t mem_size;
+} ModifierStackCacheInput;
+
+typedef struct ModifierStackCacheEntry {
+  /** Hash of the stack input and every modifier up to and including this one. */
+  uint32_t hash;
+  /** Settings of this modifier. */
+  ModifierStackCacheKey key;
+  /** Result of the stack so far, NULL when only the input mesh has been deformed. */
+  Mesh *mesh;
+  /** The mesh is owned by an earlier entry, a deform modifier didn't change it. */
+  bool mesh_is_shared;
+  /** Deformed coordinates which are not applied to the mesh yet. */
+  float (*deformed_verts)[3];
+  int num_deformed_verts;
+  bool is_prev_deform;
+  bool have_non_onlydeform_modifiers_applied;
+  /** Error reported by the modifier, set again when its evaluation is skipped. */
+  char *error;
+  /** Memory owned by the entry. */
+  size_t mem_size;
+} ModifierStackCacheEntry;
+
+typedef struct ModifierStackCache {
+  /** Hashes of the stack input of the last evaluation, with and without its coordinates. */
+  uint32_t input_hash;
+  uint32_t input_topology_hash;
+  /** Input the entries were made from, NULL until the same input is evaluated twice. */
+  ModifierStackCacheInput *input;
+  /** Results of the leading cacheable modifiers, in evaluation order. */
+  ModifierStackCacheEntry *entries;
+  int entries_len;
+  int entries_alloc;
+  /** Memory owned by the input and the entries, see #MODIFIER_STACK_CACHE_MEM_MAX. */
+  size_t mem_size;
+  /**
+   * Meshes removed from the cache during the last evaluation. The previous result of the
+   * stack may reference their data until it's freed, see #modifier_stack_cache_free_unused.
+   */
+  LinkNode *meshes_unused;
+  /** The last evaluation didn't use the cache, it's freed along with the unused meshes. */
+  bool is_unused;
+  /** Number of modifiers the last evaluation took the result of from the cache. */
+  int reused_len;
+} ModifierStackCache;
+
+/** State of the cache during an evaluation of the stack. */
+typedef struct ModifierStackCacheEval {
+  /** Cache the results are stored in, NULL when they aren't (anymore). */
+  ModifierStackCache *cache;
+  /** Hash of the stack input and the modifiers so far. */
+  uint32_t hash;
+  /** Settings of the current modifier. */
+  ModifierStackCacheKey key;
+  /** Number of evaluated modifiers with a result in the cache. */
+  int step;
+  /** Modifiers are skipped for as long as their cached result is valid. */
+  bool resume;
+  /** The evaluation state is the one after the last skipped modifier. */
+  bool is_restored;
+  /** The result of the current modifier is stored. */
+  bool use_step;
+} ModifierStackCacheEval;
+
+static void modifier_stack_cache_key_append(ModifierStackCacheKey *key,
+                                            const void *data,
+                                            const size_t size)
+{
+  if (key->len + size > key->len_alloc) {
+    key->len_alloc = MAX2(256, (key->len + size) * 2);
+    key->data = MEM_reallocN(key->data, key->len_alloc);
+  }
+  memcpy(key->data + key->len, data, size);
+  key->len += size;
+}
+
+static bool modifier_stack_cache_key_equals(const ModifierStackCacheKey *key_a,
+                                            const ModifierStackCacheKey *key_b)
+{
+  return key_a->len == key_b->len && memcmp(key_a->data, key_b->data, key_a->len) == 0;
+}
+
+static uint32_t modifier_stack_cache_key_hash(const ModifierStackCacheKey *key, uint32_t hash)
+{
+  return BLI_hash_mm2(key->data, key->len, hash);
+}
+
+static void modifier_stack_cache_key_copy(ModifierStackCacheKey *key_dst,
+                                          const ModifierStackCacheKey *key_src)
+{
+  key_dst->data = MEM_mallocN(MAX2(key_src->len, 1), __func__);
+  memcpy(key_dst->data, key_src->data, key_src->len);
+  key_dst->len = key_dst->len_alloc = key_src->len;
+}
+
+static void modifier_stack_cache_key_free(ModifierStackCacheKey *key)
+{
+  MEM_SAFE_FREE(key->data);
+  key->len = key->len_alloc = 0;
+}
+
+/* Points of the curve, without the tables which are made from them. */
+static void modifier_stack_cache_key_append_curvemapping(ModifierStackCacheKey *key,
+                                                         const CurveMapping *cumap)
+{
+  if (cumap == NULL) {
+    return;
+  }
+  CurveMapping cumap_key;
+  memcpy(&cumap_key, cumap, sizeof(cumap_key));
+  for (int i = 0; i < CM_TOT; i++) {
+    CurveMap *cuma = &cumap_key.cm[i];
+    cuma->curve = cuma->table = cuma->premultable = NULL;
+    cuma->range = cuma->mintable = cuma->maxtable = 0.0f;
+    zero_v2(cuma->ext_in);
+    zero_v2(cuma->ext_out);
+    zero_v2(cuma->premul_ext_in);
+    zero_v2(cuma->premul_ext_out);
+  }
+  modifier_stack_cache_key_append(key, &cumap_key, sizeof(cumap_key));
+  for (int i = 0; i < CM_TOT; i++) {
+    const CurveMap *cuma = &cumap->cm[i];
+    if (cuma->curve) {
+      modifier_stack_cache_key_append(key, cuma->curve, sizeof(*cuma->curve) * cuma->totpoint);
+    }
+  }
+}
+
+/* Points of the profile, without the samples which are made from them. */
+static void modifier_stack_cache_key_append_curveprofile(ModifierStackCacheKey *key,
+                                                         const CurveProfile *profile)
+{
+  if (profile == NULL) {
+    return;
+  }
+  CurveProfile profile_key;
+  memcpy(&profile_key, profile, sizeof(profile_key));
+  profile_key.path = profile_key.table = profile_key.segments = NULL;
+  profile_key.segments_len = 0;
+  modifier_stack_cache_key_append(key, &profile_key, sizeof(profile_key));
+  if (profile->path) {
+    modifier_stack_cache_key_append(
+        key, profile->path, sizeof(*profile->path) * profile->path_len);
+  }
+}
+
+/**
+ * Add everything the result of a modifier depends on besides its input mesh.
+ *
+ * Pointers aren't part of the key, memory can be freed and reused for different settings.
+ * The settings they point to are added instead, modifiers with other data behind pointers
+ * aren't cached, see #modifier_stack_cache_supports.
+ */
+static void modifier_stack_cache_key_append_modifier(ModifierStackCacheKey *key,
+                                                     const ModifierData *md,
+                                                     const CustomData_MeshMasks *mask,
+                                                     const CustomData_MeshMasks *nextmask)
+{
+  const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+  const int header[3] = {md->type, md->mode, md->flag};
+
+  modifier_stack_cache_key_append(key, header, sizeof(header));
+  modifier_stack_cache_key_append(key, mask, sizeof(*mask));
+  modifier_stack_cache_key_append(key, nextmask, sizeof(*nextmask));
+
+  const size_t settings_offset = key->len;
+  modifier_stack_cache_key_append(key,
+                                  (const uchar *)md + sizeof(ModifierData),
+                                  (size_t)mti->structSize - sizeof(ModifierData));
+#define KEY_POINTER_CLEAR(type, member) \
+  memset(key->data + settings_offset + offsetof(type, member) - sizeof(ModifierData), \
+         0, \
+         sizeof(((type *)NULL)->member))
+
+  switch ((ModifierType)md->type) {
+    case eModifierType_Bevel: {
+      const BevelModifierData *bmd = (const BevelModifierData *)md;
+      KEY_POINTER_CLEAR(BevelModifierData, custom_profile);
+      modifier_stack_cache_key_append_curveprofile(key, bmd->custom_profile);
+      break;
+    }
+    case eModifierType_WeightVGEdit: {
+      const WeightVGEditModifierData *wmd = (const WeightVGEditModifierData *)md;
+      KEY_POINTER_CLEAR(WeightVGEditModifierData, cmap_curve);
+      modifier_stack_cache_key_append_curvemapping(key, wmd->cmap_curve);
+      break;
+    }
+    case eModifierType_Subsurf:
+      /* Unused, but not cleared on file read. */
+      KEY_POINTER_CLEAR(SubsurfModifierData, emCache);
+      KEY_POINTER_CLEAR(SubsurfModifierData, mCache);
+      break;
+    default:
+      break;
+  }
+#undef KEY_POINTER_CLEAR
+}
+
+/**
+ * Memory of the layers owned by \a mesh, of all its layers when \a use_referenced is set.
+ * Allocations made by the elements themselves (vertex weights for example) aren't counted.
+ */
+static size_t modifier_stack_cache_mesh_size(const Mesh *mesh, const bool use_referenced)
+{
+  const CustomData *cdata[4] = {&mesh->vdata, &mesh->edata, &mesh->ldata, &mesh->pdata};
+  const int totelem[4] = {mesh->totvert, mesh->totedge, mesh->totloop, mesh->totpoly};
+  size_t size = 0;
+
+  for (int i = 0; i < ARRAY_SIZE(cdata); i++) {
+    for (int j = 0; j < cdata[i]->totlayer; j++) {
+      const CustomDataLayer *layer = &cdata[i]->layers[j];
+      if (use_referenced || (layer->flag & CD_FLAG_NOFREE) == 0) {
+        size += (size_t)CustomData_sizeof(layer->type) * (size_t)totelem[i];
+      }
+    }
+  }
+  return size;
+}
+
+static void modifier_stack_cache_mesh_free_cb(void *mesh)
+{
+  BKE_id_free(NULL, mesh);
+}
+
+/* Free \a mesh once the previous result of the stack doesn't reference it anymore. */
+static void modifier_stack_cache_mesh_release(ModifierStackCache *cache, Mesh *mesh)
+{
+  BLI_linklist_prepend(&cache->meshes_unused, mesh);
+}
+
+static void modifier_stack_cache_input_create(ModifierStackCache *cache,
+                                              const ModifierStackCacheKey *state,
+                                              const Mesh *mesh_input,
+                                              const float (*deformed_verts)[3],
+                                              const int num_deformed_verts)
+{
+  ModifierStackCacheInput *input = MEM_callocN(sizeof(*input), __func__);
+
+  modifier_stack_cache_key_copy(&input->state, state);
+
+  Mesh *mesh = BKE_id_new_nomain(ID_ME, NULL);
+  CustomData_copy(&mesh_input->vdata,
+                  &mesh->vdata,
+                  CD_MASK_EVERYTHING.vmask,
+                  CD_DUPLICATE,
+                  mesh_input->totvert);
+  CustomData_copy(&mesh_input->edata,
+                  &mesh->edata,
+                  CD_MASK_EVERYTHING.emask,
+                  CD_DUPLICATE,
+                  mesh_input->totedge);
+  CustomData_copy(&mesh_input->ldata,
+                  &mesh->ldata,
+                  CD_MASK_EVERYTHING.lmask,
+                  CD_DUPLICATE,
+                  mesh_input->totloop);
+  CustomData_copy(&mesh_input->pdata,
+                  &mesh->pdata,
+                  CD_MASK_EVERYTHING.pmask,
+                  CD_DUPLICATE,
+                  mesh_input->totpoly);
+  mesh->totvert = mesh_input->totvert;
+  mesh->totedge = mesh_input->totedge;
+  mesh->totloop = mesh_input->totloop;
+  mesh->totpoly = mesh_input->totpoly;
+  BKE_mesh_update_customdata_pointers(mesh, false);
+  input->mesh = mesh;
+  input->mem_size = modifier_stack_cache_mesh_size(mesh, false);
+
+  if (deformed_verts) {
+    input->deformed_verts = MEM_dupallocN(deformed_verts);
+    input->num_deformed_verts = num_deformed_verts;
+    input->mem_size += sizeof(*deformed_verts) * (size_t)num_deformed_verts;
+  }
+
+  cache->input = input;
+  cache->mem_size += input->mem_size;
+}
+
+static void modifier_stack_cache_input_free(ModifierStackCache *cache)
+{
+  ModifierStackCacheInput *input = cache->input;
+  modifier_stack_cache_key_free(&input->state);
+  modifier_stack_cache_mesh_release(cache, input->mesh);
+  MEM_SAFE_FREE(input->deformed_verts);
+  cache->mem_size -= input->mem_size;
+  MEM_freeN(input);
+  cache->input = NULL;
+}
+
+/**
+ * Compare the input to its copy, without the coordinates unless \a use_coords is set.
+ */
+static bool modifier_stack_cache_input_equals(const ModifierStackCacheInput *input,
+                                              const ModifierStackCacheKey *state,
+                                              const Mesh *mesh_input,
+                                              const float (*deformed_verts)[3],
+                                              const int num_deformed_verts,
+                                              const bool use_coords)
+{
+  const Mesh *mesh = input->mesh;
+  if (!modifier_stack_cache_key_equals(&input->state, state) ||
+      mesh->totvert != mesh_input->totvert || mesh->totedge != mesh_input->totedge ||
+      mesh->totloop != mesh_input->totloop || mesh->totpoly != mesh_input->totpoly) {
+    return false;
+  }
+  if ((input->deformed_verts == NULL) != (deformed_verts == NULL) ||
+      (deformed_verts && input->num_deformed_verts != num_deformed_verts)) {
+    return false;
+  }
+  if (use_coords && deformed_verts &&
+      memcmp(input->deformed_verts,
+             deformed_verts,
+             sizeof(*deformed_verts) * num_deformed_verts)) {
+    return false;
+  }
+  const CustomDataMask vmask_skip = use_coords ? 0 : CD_MASK_MVERT;
+  return CustomData_equals(&mesh->vdata, &mesh_input->vdata, mesh_input->totvert, vmask_skip) &&
+         CustomData_equals(&mesh->edata, &mesh_input->edata, mesh_input->totedge, 0) &&
+         CustomData_equals(&mesh->ldata, &mesh_input->ldata, mesh_input->totloop, 0) &&
+         CustomData_equals(&mesh->pdata, &mesh_input->pdata, mesh_input->totpoly, 0);
+}
+
+/**
+ * Replace the coordinates of the copy of the input,
+ * which has the same topology as \a mesh_input.
+ */
+static void modifier_stack_cache_input_coords_set(ModifierStackCacheInput *input,
+                                                  const Mesh *mesh_input,
+                                                  const float (*deformed_verts)[3])
+{
+  if (mesh_input->mvert) {
+    memcpy(input->mesh->mvert,
+           mesh_input->mvert,
+           sizeof(*mesh_input->mvert) * mesh_input->totvert);
+  }
+  if (deformed_verts) {
+    memcpy(input->deformed_verts,
+           deformed_verts,
+           sizeof(*deformed_verts) * input->num_deformed_verts);
+  }
+}
+
+static void modifier_stack_cache_entry_free(ModifierStackCache *cache,
+                                            ModifierStackCacheEntry *entry)
+{
+  if (entry->mesh && !entry->mesh_is_shared) {
+    modifier_stack_cache_mesh_release(cache, entry->mesh);
+  }
+  modifier_stack_cache_key_free(&entry->key);
+  MEM_SAFE_FREE(entry->deformed_verts);
+  MEM_SAFE_FREE(entry->error);
+  cache->mem_size -= entry->mem_size;
+}
+
+/* Remove all entries from \a entries_len onward. */
+static void modifier_stack_cache_truncate(ModifierStackCache *cache, const int entries_len)
+{
+  for (int i = entries_len; i < cache->entries_len; i++) {
+    modifier_stack_cache_entry_free(cache, &cache->entries[i]);
+  }
+  cache->entries_len = min_ii(cache->entries_len, entries_len);
+}
+
+/* Remove all entries and the input they were made from. */
+static void modifier_stack_cache_clear(ModifierStackCache *cache)
+{
+  modifier_stack_cache_truncate(cache, 0);
+  if (cache->input) {
+    modifier_stack_cache_input_free(cache);
+  }
+}
+
+void mesh_modifier_stack_cache_free(Object *ob)
+{
+  ModifierStackCache *cache = ob->runtime.modifier_stack_cache;
+  if (cache == NULL) {
+    return;
+  }
+  modifier_stack_cache_clear(cache);
+  BLI_linklist_free(cache->meshes_unused, modifier_stack_cache_mesh_free_cb);
+  MEM_SAFE_FREE(cache->entries);
+  MEM_freeN(cache);
+  ob->runtime.modifier_stack_cache = NULL;
+}
+
+int mesh_modifier_stack_cache_reused_len(const Object *ob)
+{
+  const ModifierStackCache *cache = ob->runtime.modifier_stack_cache;
+  return cache ? cache->reused_len : 0;
+}
+
+/**
+ * Free the meshes removed from the cache by the last evaluation, once the previous result
+ * of the stack is freed. The whole cache is freed when the evaluation didn't use it.
+ */
+static void modifier_stack_cache_free_unused(Object *ob)
+{
+  ModifierStackCache *cache = ob->runtime.modifier_stack_cache;
+  if (cache == NULL) {
+    return;
+  }
+  if (cache->is_unused) {
+    mesh_modifier_stack_cache_free(ob);
+    return;
+  }
+  BLI_linklist_free(cache->meshes_unused, modifier_stack_cache_mesh_free_cb);
+  cache->meshes_unused = NULL;
+}
+
+/* The evaluation doesn't use the cache, its results are removed. */
+static void modifier_stack_cache_discard(Object *ob)
+{
+  ModifierStackCache *cache = ob->runtime.modifier_stack_cache;
+  if (cache) {
+    modifier_stack_cache_clear(cache);
+    cache->reused_len = 0;
+    cache->is_unused = true;
+  }
+}
+
+
+static void modifier_stack_cache_id_link_cb(void *userData,
+                                            Object *UNUSED(ob),
+                                            ID **idpoin,
+                                            int UNUSED(cb_flag))
+{
+  if (*idpoin != NULL) {
+    *(bool *)userData = true;
+  }
+}
+
+/**
+ * A modifier result can only be cached when it's fully defined by the input mesh
+ * and the modifier settings.
+ */
+static bool modifier_stack_cache_supports(Object *ob, ModifierData *md)
+{
+  const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+
+  /* Virtual modifiers (shape keys, parent deformation) aren't part of the stack. */
+  if (md->orig_modifier_data == NULL || BLI_findindex(&ob->modifiers, md) == -1) {
+    return false;
+  }
+  if (modifier_dependsOnTime(md) || (mti->flags & eModifierTypeFlag_UsesPointCache)) {
+    return false;
+  }
+
+  switch ((ModifierType)md->type) {
+    /* Bind data, simulation state or settings behind pointers which aren't part of the key,
+     * see #modifier_stack_cache_key_append_modifier. */
+    case eModifierType_Armature:
+    case eModifierType_Hook:
+    case eModifierType_Cloth:
+    case eModifierType_Collision:
+    case eModifierType_Surface:
+    case eModifierType_MeshDeform:
+    case eModifierType_ParticleSystem:
+    case eModifierType_Explode:
+    case eModifierType_Fluidsim:
+    case eModifierType_Fluid:
+    case eModifierType_Ocean:
+    case eModifierType_Warp:
+    case eModifierType_DynamicPaint:
+    case eModifierType_CorrectiveSmooth:
+    case eModifierType_LaplacianDeform:
+    case eModifierType_MeshSequenceCache:
+    case eModifierType_SurfaceDeform:
+      return false;
+    default:
+      break;
+  }
+
+  /* Textures and other objects, these are reported as ID links too. */
+  bool has_id_link = false;
+  if (mti->foreachIDLink) {
+    mti->foreachIDLink(md, ob, modifier_stack_cache_id_link_cb, &has_id_link);
+  }
+  else if (mti->foreachObjectLink) {
+    /* Each Object can masquerade as an ID, so this should be OK. */
+    mti->foreachObjectLink(
+        md, ob, (ObjectWalkFunc)modifier_stack_cache_id_link_cb, &has_id_link);
+  }
+  return !has_id_link;
+}
+
+/* Only the active object is cached, the one being edited. */
+static bool modifier_stack_cache_is_active(struct Depsgraph *depsgraph, Object *ob)
+{
+  ViewLayer *view_layer = DEG_get_evaluated_view_layer(depsgraph);
+  Object *ob_active = view_layer ? OBACT(view_layer) : NULL;
+  return ob_active && DEG_get_original_object(ob_active) == DEG_get_original_object(ob);
+}
+
+/**
+ * The leading deform modifiers are cached along with the others when all of them can be,
+ * otherwise caching starts after them.
+ */
+static bool modifier_stack_cache_supports_leading(const Scene *scene,
+                                                  Object *ob,
+                                                  ModifierData *md,
+                                                  const int required_mode)
+{
+  for (; md; md = md->next) {
+    if (!modifier_isEnabled(scene, md, required_mode)) {
+      continue;
+    }
+    if (modifierType_getInfo(md->type)->type != eModifierTypeType_OnlyDeform) {
+      break;
+    }
+    if (!modifier_stack_cache_supports(ob, md)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Everything the cacheable modifiers may read besides their own settings. Mesh settings are
+ * added to \a state, the geometry is only hashed since it's compared to a copy on a match.
+ *
+ * \param r_topology_hash: Hash of the input without its coordinates.
+ * \return false when the input can't be hashed.
+ */
+static bool modifier_stack_cache_hash_input(const Scene *scene,
+                                            const Object *ob,
+                                            const Mesh *mesh_input,
+                                            const float (*deformed_verts)[3],
+                                            const int num_deformed_verts,
+                                            ModifierStackCacheKey *state,
+                                            uint32_t *r_topology_hash,
+                                            uint32_t *r_hash)
+{
+  float mesh_settings[8] = {
+      UNPACK3(mesh_input->loc),
+      UNPACK3(mesh_input->size),
+      mesh_input->smoothresh,
+      (float)mesh_input->totcol,
+  };
+  if (mesh_input->texflag & ME_AUTOSPACE) {
+    /* Follows the coordinates, which are compared already. */
+    zero_v3(&mesh_settings[0]);
+    zero_v3(&mesh_settings[3]);
+  }
+  const int mesh_flags[5] = {
+      mesh_input->flag,
+      mesh_input->texflag,
+      mesh_input->cd_flag,
+      /* Subdivision levels are limited by the simplify settings. */
+      scene->r.mode & R_SIMPLIFY,
+      scene->r.simplify_subsurf,
+  };
+  modifier_stack_cache_key_append(state, mesh_settings, sizeof(mesh_settings));
+  modifier_stack_cache_key_append(state, mesh_flags, sizeof(mesh_flags));
+
+  /* Vertex groups are looked up by name. */
+  LISTBASE_FOREACH (const bDeformGroup *, dg, &ob->defbase) {
+    modifier_stack_cache_key_append(state, dg->name, strlen(dg->name) + 1);
+  }
+
+  uint32_t hash = modifier_stack_cache_key_hash(state, 0);
+  if (!CustomData_hash(&mesh_input->vdata, mesh_input->totvert, CD_MASK_MVERT, &hash) ||
+      !CustomData_hash(&mesh_input->edata, mesh_input->totedge, 0, &hash) ||
+      !CustomData_hash(&mesh_input->ldata, mesh_input->totloop, 0, &hash) ||
+      !CustomData_hash(&mesh_input->pdata, mesh_input->totpoly, 0, &hash)) {
+    return false;
+  }
+  *r_topology_hash = hash;
+
+  if (mesh_input->mvert) {
+    hash = BLI_hash_mm2((const uchar *)mesh_input->mvert,
+                        sizeof(*mesh_input->mvert) * mesh_input->totvert,
+                        hash);
+  }
+  if (deformed_verts) {
+    hash = BLI_hash_mm2(
+        (const uchar *)deformed_verts, sizeof(*deformed_verts) * num_deformed_verts, hash);
+  }
+
+  *r_hash = hash;
+  return true;
+}
+
+/**
+ * Make the layers \a data references or shares from the input mesh, or references from the copy
+ * of it already, reference the copy of the input. Other referenced or shared layers are
+ * duplicated, so the cached result doesn't depend on the input mesh or on other results.
+ */
+static void modifier_stack_cache_customdata_share(CustomData *data,
+                                                  const CustomData *data_input,
+                                                  const CustomData *data_copy,
+                                                  const int totelem)
+{
+  for (int i = 0; i < data->totlayer; i++) {
+    CustomDataLayer *layer = &data->layers[i];
+    if ((layer->flag & CD_FLAG_NOFREE) == 0 && layer->sharing_info == NULL) {
+      continue;
+    }
+    const int n = i - CustomData_get_layer_index(data, layer->type);
+    const int index_input = CustomData_get_layer_index_n(data_input, layer->type, n);
+    const int index_copy = CustomData_get_layer_index_n(data_copy, layer->type, n);
+
+    /* Coordinates are stored with every result, they're replaced in the copy of the input. */
+    if (layer->type != CD_MVERT && index_copy != -1 &&
+        ((index_input != -1 && layer->data == data_input->layers[index_input].data) ||
+         layer->data == data_copy->layers[index_copy].data)) {
+      /* A layer sharing the data of the input stops being one of its users. */
+      CustomData_set_layer_n(data, layer->type, n, data_copy->layers[index_copy].data);
+      layer->flag |= CD_FLAG_NOFREE;
+    }
+    else {
+      CustomData_duplicate_referenced_layer_n(data, layer->type, n, totelem);
+    }
+  }
+}
+
+/**
+ * Copy a result which was only deformed, sharing the topology of the copy of the input.
+ */
+static Mesh *modifier_stack_cache_mesh_copy_shared(const ModifierStackCacheInput *input,
+                                                   const Mesh *mesh_input,
+                                                   Mesh *mesh)
+{
+  Mesh *mesh_copy = BKE_mesh_copy_for_eval(mesh, true);
+  modifier_stack_cache_customdata_share(
+      &mesh_copy->vdata, &mesh_input->vdata, &input->mesh->vdata, mesh_copy->totvert);
+  modifier_stack_cache_customdata_share(
+      &mesh_copy->edata, &mesh_input->edata, &input->mesh->edata, mesh_copy->totedge);
+  modifier_stack_cache_customdata_share(
+      &mesh_copy->ldata, &mesh_input->ldata, &input->mesh->ldata, mesh_copy->totloop);
+  modifier_stack_cache_customdata_share(
+      &mesh_copy->pdata, &mesh_input->pdata, &input->mesh->pdata, mesh_copy->totpoly);
+  BKE_mesh_update_customdata_pointers(mesh_copy, false);
+  return mesh_copy;
+}
+
+/**
+ * Store the result of \a md.
+ *
+ * \return false when it doesn't fit in #MODIFIER_STACK_CACHE_MEM_MAX, nothing is stored then.
+ */
+static bool modifier_stack_cache_add(ModifierStackCache *cache,
+                                     ModifierData *md,
+                                     const uint32_t hash,
+                                     const ModifierStackCacheKey *key,
+                                     const Mesh *mesh_input,
+                                     Mesh *mesh,
+                                     const bool mesh_is_unchanged,
+                                     float (*deformed_verts)[3],
+                                     const int num_deformed_verts,
+                                     const bool is_prev_deform,
+                                     const bool have_non_onlydeform_modifiers_applied)
+{
+  BLI_assert(cache->input != NULL);
+  if (cache->entries_len == cache->entries_alloc) {
+    cache->entries_alloc = max_ii(4, cache->entries_alloc * 2);
+    cache->entries = MEM_reallocN(cache->entries, sizeof(*cache->entries) * cache->entries_alloc);
+  }
+
+  ModifierStackCacheEntry *entry = &cache->entries[cache->entries_len];
+  memset(entry, 0, sizeof(*entry));
+  entry->hash = hash;
+  modifier_stack_cache_key_copy(&entry->key, key);
+
+  if (mesh) {
+    ModifierStackCacheEntry *entry_prev = cache->entries_len ? entry - 1 : NULL;
+    if (mesh_is_unchanged && entry_prev && entry_prev->mesh) {
+      entry->mesh = entry_prev->mesh;
+      entry->mesh_is_shared = true;
+    }
+    else {
+      if (!have_non_onlydeform_modifiers_applied && mesh->totface == 0) {
+        entry->mesh = modifier_stack_cache_mesh_copy_shared(cache->input, mesh_input, mesh);
+      }
+      else {
+        entry->mesh = BKE_mesh_copy_for_eval(mesh, false);
+      }
+      entry->mem_size += modifier_stack_cache_mesh_size(entry->mesh, false);
+    }
+  }
+  if (deformed_verts) {
+    entry->deformed_verts = MEM_dupallocN(deformed_verts);
+    entry->num_deformed_verts = num_deformed_verts;
+    entry->mem_size += sizeof(*deformed_verts) * (size_t)num_deformed_verts;
+  }
+  entry->is_prev_deform = is_prev_deform;
+  entry->have_non_onlydeform_modifiers_applied = have_non_onlydeform_modifiers_applied;
+  if (md->error) {
+    entry->error = BLI_strdup(md->error);
+  }
+
+  cache->entries_len++;
+  cache->mem_size += entry->mem_size;
+
+  if (cache->mem_size > MODIFIER_STACK_CACHE_MEM_MAX) {
+    modifier_stack_cache_truncate(cache, cache->entries_len - 1);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Caching is only worth it when a modifier can be cached.
+ */
+static bool modifier_stack_cache_is_useful(const Scene *scene,
+                                           Object *ob,
+                                           ModifierData *md,
+                                           const int required_mode,
+                                           const CDMaskLink *datamasks,
+                                           const CustomData_MeshMasks *final_datamask)
+{
+  /* Original coordinates are tracked along with the stack, not supported. */
+  const CustomDataMask orco_mask = CD_MASK_ORCO | CD_MASK_CLOTH_ORCO;
+  if (final_datamask->vmask & orco_mask) {
+    return false;
+  }
+  for (const CDMaskLink *link = datamasks; link; link = link->next) {
+    if (link->mask.vmask & orco_mask) {
+      return false;
+    }
+  }
+
+  for (; md; md = md->next) {
+    if (modifier_isEnabled(scene, md, required_mode)) {
+      return modifier_stack_cache_supports(ob, md);
+    }
+  }
+  return false;
+}
+
+/**
+ * Replace the stack evaluation state by the one after the cached entry.
+ */
+static void modifier_stack_cache_restore(const ModifierStackCacheEntry *entry,
+                                         Mesh **r_mesh_final,
+                                         float (**r_deformed_verts)[3],
+                                         int *r_num_deformed_verts,
+                                         bool *r_is_prev_deform,
+                                         bool *r_have_non_onlydeform_modifiers_applied)
+{
+  if (*r_mesh_final) {
+    BKE_id_free(NULL, *r_mesh_final);
+  }
+  MEM_SAFE_FREE(*r_deformed_verts);
+
+  /* Reference the cached data, modifiers copy referenced layers before changing them. */
+  *r_mesh_final = entry->mesh ? BKE_mesh_copy_for_eval(entry->mesh, true) : NULL;
+  if (entry->deformed_verts) {
+    *r_deformed_verts = MEM_dupallocN(entry->deformed_verts);
+    *r_num_deformed_verts = entry->num_deformed_verts;
+  }
+  *r_is_prev_deform = entry->is_prev_deform;
+  *r_have_non_onlydeform_modifiers_applied = entry->have_non_onlydeform_modifiers_applied;
+
+  if (*r_mesh_final && entry->have_non_onlydeform_modifiers_applied) {
+    (*r_mesh_final)->runtime.deformed_only = false;
+  }
+}
+
+/**
+ * Start caching the results of the modifiers from \a md onward. The stack input is compared
+ * to the one of the last evaluation, to decide whether the cached results are resumed,
+ * results are stored, or neither.
+ *
+ * \param state: Evaluation state the modifiers depend on.
+ */
+static void modifier_stack_cache_begin(ModifierStackCacheEval *sce,
+                                       const Scene *scene,
+                                       Object *ob,
+                                       ModifierData *md,
+                                       const int required_mode,
+                                       const CDMaskLink *md_datamask,
+                                       const CustomData_MeshMasks *final_datamask,
+                                       const Mesh *mesh_input,
+                                       const float (*deformed_verts)[3],
+                                       const int num_deformed_verts,
+                                       const int state[5])
+{
+  if (!modifier_stack_cache_is_useful(
+          scene, ob, md, required_mode, md_datamask, final_datamask)) {
+    modifier_stack_cache_discard(ob);
+    return;
+  }
+
+  ModifierStackCacheKey input_state = {NULL};
+  modifier_stack_cache_key_append(&input_state, state, sizeof(*state) * 5);
+  modifier_stack_cache_key_append(&input_state, final_datamask, sizeof(*final_datamask));
+
+  uint32_t topology_hash, hash;
+  if (!modifier_stack_cache_hash_input(scene,
+                                       ob,
+                                       mesh_input,
+                                       deformed_verts,
+                                       num_deformed_verts,
+                                       &input_state,
+                                       &topology_hash,
+                                       &hash)) {
+    modifier_stack_cache_key_free(&input_state);
+    modifier_stack_cache_discard(ob);
+    return;
+  }
+
+  ModifierStackCache *cache = ob->runtime.modifier_stack_cache;
+  if (cache == NULL) {
+    cache = MEM_callocN(sizeof(*cache), __func__);
+    ob->runtime.modifier_stack_cache = cache;
+  }
+  cache->is_unused = false;
+  cache->reused_len = 0;
+  sce->hash = hash;
+
+  if (cache->input_topology_hash != topology_hash) {
+    /* Don't store results while the input keeps changing (animation playback for
+     * example), copying them would only add overhead. */
+    modifier_stack_cache_clear(cache);
+  }
+  else if (cache->input_hash != hash) {
+    /* Only the coordinates changed (moving vertices, animated shape keys): the results are
+     * outdated, but the copy of the input keeps its topology with the new coordinates. */
+    modifier_stack_cache_truncate(cache, 0);
+    if (cache->input &&
+        modifier_stack_cache_input_equals(
+            cache->input, &input_state, mesh_input, deformed_verts, num_deformed_verts, false)) {
+      modifier_stack_cache_input_coords_set(cache->input, mesh_input, deformed_verts);
+    }
+    else if (cache->input) {
+      modifier_stack_cache_input_free(cache);
+    }
+  }
+  else if (cache->input &&
+           modifier_stack_cache_input_equals(
+               cache->input, &input_state, mesh_input, deformed_verts, num_deformed_verts, true)) {
+    sce->cache = cache;
+    sce->resume = true;
+  }
+  else {
+    /* Same input as the last evaluation, or a hash collision: start storing results. */
+    modifier_stack_cache_clear(cache);
+    if (modifier_stack_cache_mesh_size(mesh_input, true) <= MODIFIER_STACK_CACHE_MEM_MAX) {
+      modifier_stack_cache_input_create(
+          cache, &input_state, mesh_input, deformed_verts, num_deformed_verts);
+      sce->cache = cache;
+    }
+  }
+  cache->input_topology_hash = topology_hash;
+  cache->input_hash = hash;
+
+  modifier_stack_cache_key_free(&input_state);
+}
+
+/**
+ * Continue the evaluation from the result of the last skipped modifier.
+ */
+static void modifier_stack_cache_eval_restore(ModifierStackCacheEval *sce,
+                                              Mesh **r_mesh_final,
+                                              float (**r_deformed_verts)[3],
+                                              int *r_num_deformed_verts,
+                                              bool *r_is_prev_deform,
+                                              bool *r_have_non_onlydeform_modifiers_applied)
+{
+  if (sce->step != 0 && !sce->is_restored) {
+    modifier_stack_cache_restore(&sce->cache->entries[sce->step - 1],
+                                 r_mesh_final,
+                                 r_deformed_verts,
+                                 r_num_deformed_verts,
+                                 r_is_prev_deform,
+                                 r_have_non_onlydeform_modifiers_applied);
+  }
+  sce->is_restored = true;
+}
+
+/**
+ * Look up the cached result of \a md. Modifiers are skipped for as long as their result is
+ * valid, the evaluation continues from the last of them at the first one which isn't.
+ *
+ * \return true when the evaluation of \a md is skipped.
+ */
+static bool modifier_stack_cache_step_begin(ModifierStackCacheEval *sce,
+                                            Object *ob,
+                                            ModifierData *md,
+                                            const CustomData_MeshMasks *mask,
+                                            const CustomData_MeshMasks *nextmask,
+                                            Mesh **r_mesh_final,
+                                            float (**r_deformed_verts)[3],
+                                            int *r_num_deformed_verts,
+                                            bool *r_is_prev_deform,
+                                            bool *r_have_non_onlydeform_modifiers_applied)
+{
+  ModifierStackCache *cache = sce->cache;
+  sce->use_step = cache && modifier_stack_cache_supports(ob, md);
+  if (sce->use_step) {
+    sce->key.len = 0;
+    modifier_stack_cache_key_append_modifier(&sce->key, md, mask, nextmask);
+    sce->hash = modifier_stack_cache_key_hash(&sce->key, sce->hash);
+  }
+
+  if (sce->resume) {
+    if (sce->use_step && sce->step < cache->entries_len) {
+      const ModifierStackCacheEntry *entry = &cache->entries[sce->step];
+      if (entry->hash == sce->hash && modifier_stack_cache_key_equals(&entry->key, &sce->key)) {
+        if (entry->error) {
+          modifier_setError(md, "%s", entry->error);
+        }
+        *r_have_non_onlydeform_modifiers_applied = entry->have_non_onlydeform_modifiers_applied;
+        sce->step++;
+        sce->is_restored = false;
+        cache->reused_len++;
+        return true;
+      }
+    }
+    sce->resume = false;
+    modifier_stack_cache_truncate(cache, sce->step);
+    modifier_stack_cache_eval_restore(sce,
+                                      r_mesh_final,
+                                      r_deformed_verts,
+                                      r_num_deformed_verts,
+                                      r_is_prev_deform,
+                                      r_have_non_onlydeform_modifiers_applied);
+  }
+
+  if (!sce->use_step) {
+    /* Results after a modifier which can't be cached depend on more than the hash. */
+    sce->cache = NULL;
+  }
+  return false;
+}
+
+/**
+ * Store the result of the modifier evaluated after #modifier_stack_cache_step_begin.
+ */
+static void modifier_stack_cache_step_end(ModifierStackCacheEval *sce,
+                                          ModifierData *md,
+                                          const Mesh *mesh_input,
+                                          Mesh *mesh_final,
+                                          const bool mesh_is_unchanged,
+                                          float (*deformed_verts)[3],
+                                          const int num_deformed_verts,
+                                          const bool is_prev_deform,
+                                          const bool have_non_onlydeform_modifiers_applied)
+{
+  if (!sce->use_step) {
+    return;
+  }
+  if (modifier_stack_cache_add(sce->cache,
+                               md,
+                               sce->hash,
+                               &sce->key,
+                               mesh_input,
+                               mesh_final,
+                               mesh_is_unchanged,
+                               deformed_verts,
+                               num_deformed_verts,
+                               is_prev_deform,
+                               have_non_onlydeform_modifiers_applied)) {
+    sce->step++;
+  }
+  else {
+    /* Past the memory budget, the following results aren't stored either. */
+    sce->cache = NULL;
+  }
+}
+
+/**
+ * Finish the evaluation, from the last cached result when all remaining modifiers had one.
+ */
+static void modifier_stack_cache_end(ModifierStackCacheEval *sce,
+                                     Mesh **r_mesh_final,
+                                     float (**r_deformed_verts)[3],
+                                     int *r_num_deformed_verts,
+                                     bool *r_is_prev_deform,
+                                     bool *r_have_non_onlydeform_modifiers_applied)
+{
+  if (sce->resume) {
+    modifier_stack_cache_truncate(sce->cache, sce->step);
+    modifier_stack_cache_eval_restore(sce,
+                                      r_mesh_final,
+                                      r_deformed_verts,
+                                      r_num_deformed_verts,
+                                      r_is_prev_deform,
+                                      r_have_non_onlydeform_modifiers_applied);
+  }
+  modifier_stack_cache_key_free(&sce->key);
+}
+
+/** \} */
+
 static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
                                 Scene *scene,
                                 Object *ob,
@@ -955,6 +1988,33 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
   /* Clear errors before evaluation. */
   modifiers_clearErrors(ob);
 
+  /* Results of the modifiers are cached for the main evaluation of the active object. */
+  ModifierStackCacheEval stack_cache = {NULL};
+  const bool use_stack_cache = use_cache && !use_render && !sculpt_mode && index == -1 &&
+                               modifier_stack_cache_is_active(depsgraph, ob);
+  const bool use_stack_cache_leading = use_stack_cache && useDeform &&
+                                       modifier_stack_cache_supports_leading(
+                                           scene, ob, md, required_mode);
+  if (!use_stack_cache) {
+    modifier_stack_cache_discard(ob);
+  }
+  else if (use_stack_cache_leading) {
+    const int state[5] = {useDeform, need_mapping, isPrevDeform, mesh_final != NULL, ob->mode};
+    modifier_stack_cache_begin(&stack_cache,
+                               scene,
+                               ob,
+                               md,
+                               required_mode,
+                               md_datamask,
+                               &final_datamask,
+                               mesh_input,
+                               NULL,
+                               0,
+                               state);
+  }
+
+  bool have_non_onlydeform_modifiers_appled = false;
+
   /* Apply all leading deform modifiers. */
   if (useDeform) {
     for (; md; md = md->next, md_datamask = md_datamask->next) {
@@ -969,6 +2029,22 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
       }
 
       if (mti->type == eModifierTypeType_OnlyDeform && !sculpt_dyntopo) {
+        /* Skip modifiers with a valid cached result, continuing from the last one of them. */
+        if (modifier_stack_cache_step_begin(&stack_cache,
+                                            ob,
+                                            md,
+                                            &md_datamask->mask,
+                                            md_datamask->next ? &md_datamask->next->mask :
+                                                                &final_datamask,
+                                            &mesh_final,
+                                            &deformed_verts,
+                                            &num_deformed_verts,
+                                            &isPrevDeform,
+                                            &have_non_onlydeform_modifiers_appled)) {
+          continue;
+        }
+        const Mesh *mesh_final_prev = mesh_final;
+
         if (!deformed_verts) {
           deformed_verts = BKE_mesh_vert_coords_alloc(mesh_input, &num_deformed_verts);
         }
@@ -983,6 +2059,16 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
         modwrap_deformVerts(md, &mectx, mesh_final, deformed_verts, num_deformed_verts);
 
         isPrevDeform = true;
+
+        modifier_stack_cache_step_end(&stack_cache,
+                                      md,
+                                      mesh_input,
+                                      mesh_final,
+                                      mesh_final == mesh_final_prev,
+                                      deformed_verts,
+                                      num_deformed_verts,
+                                      isPrevDeform,
+                                      have_non_onlydeform_modifiers_appled);
       }
       else {
         break;
@@ -994,6 +2080,16 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
       }
     }
 
+    /* The coordinates are needed below when all leading modifiers were skipped. */
+    if (stack_cache.resume) {
+      modifier_stack_cache_eval_restore(&stack_cache,
+                                        &mesh_final,
+                                        &deformed_verts,
+                                        &num_deformed_verts,
+                                        &isPrevDeform,
+                                        &have_non_onlydeform_modifiers_appled);
+    }
+
     /* Result of all leading deforming modifiers is cached for
      * places that wish to use the original mesh but with deformed
      * coordinates (like vertex paint). */
@@ -1006,8 +2102,24 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
     }
   }
 
+  /* Otherwise caching starts with the remaining modifiers,
+   * the coordinates from the leading ones are part of the input. */
+  if (use_stack_cache && !use_stack_cache_leading) {
+    const int state[5] = {useDeform, need_mapping, isPrevDeform, mesh_final != NULL, ob->mode};
+    modifier_stack_cache_begin(&stack_cache,
+                               scene,
+                               ob,
+                               md,
+                               required_mode,
+                               md_datamask,
+                               &final_datamask,
+                               mesh_input,
+                               (const float(*)[3])deformed_verts,
+                               num_deformed_verts,
+                               state);
+  }
+
   /* Apply all remaining constructive and deforming modifiers. */
-  bool have_non_onlydeform_modifiers_appled = false;
   for (; md; md = md->next, md_datamask = md_datamask->next) {
     const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
 
@@ -1068,6 +2180,22 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
       continue;
     }
 
+    /* Skip modifiers with a valid cached result, continuing from the last one of them. */
+    if (modifier_stack_cache_step_begin(&stack_cache,
+                                        ob,
+                                        md,
+                                        &md_datamask->mask,
+                                        md_datamask->next ? &md_datamask->next->mask :
+                                                            &final_datamask,
+                                        &mesh_final,
+                                        &deformed_verts,
+                                        &num_deformed_verts,
+                                        &isPrevDeform,
+                                        &have_non_onlydeform_modifiers_appled)) {
+      continue;
+    }
+    const Mesh *mesh_final_prev = mesh_final;
+
     /* Add orco mesh as layer if needed by this modifier. */
     if (mesh_final && mesh_orco && mti->requiredDataMask) {
       CustomData_MeshMasks mask = {0};
@@ -1271,6 +2399,16 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
 
     isPrevDeform = (mti->type == eModifierTypeType_OnlyDeform);
 
+    modifier_stack_cache_step_end(&stack_cache,
+                                  md,
+                                  mesh_input,
+                                  mesh_final,
+                                  isPrevDeform && mesh_final == mesh_final_prev,
+                                  deformed_verts,
+                                  num_deformed_verts,
+                                  isPrevDeform,
+                                  have_non_onlydeform_modifiers_appled);
+
     /* grab modifiers until index i */
     if ((index != -1) && (BLI_findindex(&ob->modifiers, md) >= index)) {
       break;
@@ -1281,6 +2419,13 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
     }
   }
 
+  modifier_stack_cache_end(&stack_cache,
+                           &mesh_final,
+                           &deformed_verts,
+                           &num_deformed_verts,
+                           &isPrevDeform,
+                           &have_non_onlydeform_modifiers_appled);
+
   BLI_linklist_free((LinkNode *)datamasks, NULL);
 
   for (md = firstmd; md; md = md->next) {
@@ -1415,6 +2560,7 @@ static void editbmesh_calc_modifier_final_normals(const Mesh *mesh_input,
     if (!CustomData_has_layer(&mesh_final->pdata, CD_NORMAL)) {
       float(*polynors)[3] = CustomData_add_layer(
           &mesh_final->pdata, CD_NORMAL, CD_CALLOC, NULL, mesh_final->totpoly);
+      BKE_mesh_ensure_mvert_unshared(mesh_final);
       BKE_mesh_calc_normals_poly(mesh_final->mvert,
                                  NULL,
                                  mesh_final->totvert,
@@ -1788,6 +2934,16 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
    * they aren't cleaned up properly on mode switch, causing crashes, e.g T58150. */
   BLI_assert(ob->id.tag & LIB_TAG_COPIED_ON_WRITE);
 
+  /* Keep the previous result until the new one is calculated, so its BVH trees can be refit
+   * instead of being built again when only the positions changed (deforming shrinkwrap or
+   * snapping targets for example). */
+  Mesh *mesh_eval_prev = NULL;
+  if (ob->runtime.mesh_eval != NULL && ob->runtime.is_mesh_eval_owned &&
+      ob->runtime.mesh_eval->runtime.bvh_cache != NULL) {
+    mesh_eval_prev = ob->runtime.mesh_eval;
+    ob->runtime.mesh_eval = NULL;
+  }
+
   BKE_object_free_derived_caches(ob);
   if (DEG_is_active(depsgraph)) {
     BKE_sculpt_update_object_before_eval(ob);
@@ -1818,6 +2974,15 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
 
   assign_object_mesh_eval(ob);
 
+  if (mesh_eval_prev != NULL) {
+    if (ob->runtime.is_mesh_eval_owned) {
+      BKE_mesh_runtime_bvh_cache_transfer(mesh_eval_prev, ob->runtime.mesh_eval);
+    }
+    BKE_mesh_eval_delete(mesh_eval_prev);
+  }
+  /* The previous result may reference meshes removed from the modifier stack cache. */
+  modifier_stack_cache_free_unused(ob);
+
   ob->runtime.last_data_mask = *dataMask;
   ob->runtime.last_need_mapping = need_mapping;
 
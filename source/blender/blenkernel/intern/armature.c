@@ -72,6 +72,10 @@
 
 #include "CLG_log.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 static CLG_LogRef LOG = {"bke.armature"};
 
 /* **************** Generic Functions, data level *************** */
@@ -1449,6 +1453,67 @@ static void pchan_bone_deform(bPoseChannel *pchan,
   (*contrib) += weight;
 }
 
+/**
+ * Vertex group to bone mapping, resolved once per evaluation so the per-vertex loop
+ * doesn't have to look at the bone to decide how a weight is applied.
+ */
+typedef struct ArmatureDeformGroup {
+  /* NULL when the group doesn't belong to a deforming bone. */
+  bPoseChannel *pchan;
+  /* B-Bone segments or envelope multiplied weights, handled by #pchan_bone_deform. */
+  bool use_generic;
+} ArmatureDeformGroup;
+
+/**
+ * Linear blend skinning is linear in the bone matrices, so instead of transforming the
+ * vertex by every bone, the weighted matrices are summed and the vertex transformed once.
+ */
+BLI_INLINE void armature_blend_mat_add(float blend_mat[4][4],
+                                       const float mat[4][4],
+                                       const float weight)
+{
+#ifdef __SSE2__
+  const __m128 w = _mm_set1_ps(weight);
+  for (int k = 0; k < 4; k++) {
+    const __m128 col = _mm_mul_ps(_mm_loadu_ps(mat[k]), w);
+    _mm_storeu_ps(blend_mat[k], _mm_add_ps(_mm_loadu_ps(blend_mat[k]), col));
+  }
+#else
+  madd_m4_m4m4fl(blend_mat, blend_mat, mat, weight);
+#endif
+}
+
+/* Same as #add_weighted_dq_dq, vectorized. */
+BLI_INLINE void armature_dq_add(DualQuat *dq_accum, const DualQuat *dq, float weight)
+{
+#ifdef __SSE2__
+  const __m128 quat = _mm_loadu_ps(dq->quat);
+  const __m128 quat_accum = _mm_loadu_ps(dq_accum->quat);
+  /* Make sure we interpolate quats in the right direction. */
+  __m128 dot = _mm_mul_ps(quat, quat_accum);
+  dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(1, 0, 3, 2)));
+  dot = _mm_add_ss(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(2, 3, 0, 1)));
+  const __m128 w = _mm_set1_ps((_mm_cvtss_f32(dot) < 0.0f) ? -weight : weight);
+
+  _mm_storeu_ps(dq_accum->quat, _mm_add_ps(quat_accum, _mm_mul_ps(quat, w)));
+  _mm_storeu_ps(dq_accum->trans,
+                _mm_add_ps(_mm_loadu_ps(dq_accum->trans),
+                           _mm_mul_ps(_mm_loadu_ps(dq->trans), w)));
+
+  /* Scale is never interpolated with negative weights, see #add_weighted_dq_dq. */
+  if (dq->scale_weight) {
+    const __m128 w_scale = _mm_set1_ps(weight);
+    for (int k = 0; k < 4; k++) {
+      const __m128 col = _mm_mul_ps(_mm_loadu_ps(dq->scale[k]), w_scale);
+      _mm_storeu_ps(dq_accum->scale[k], _mm_add_ps(_mm_loadu_ps(dq_accum->scale[k]), col));
+    }
+    dq_accum->scale_weight += weight;
+  }
+#else
+  add_weighted_dq_dq(dq_accum, dq, weight);
+#endif
+}
+
 typedef struct ArmatureUserdata {
   Object *armOb;
   Object *target;
@@ -1468,7 +1533,7 @@ typedef struct ArmatureUserdata {
   MDeformVert *dverts;
 
   int defbase_tot;
-  bPoseChannel **defnrToPC;
+  const ArmatureDeformGroup *defgroups;
 
   float premat[4][4];
   float postmat[4][4];
@@ -1561,20 +1626,54 @@ static void armature_vert_task(void *__restrict userdata,
     MDeformWeight *dw = dvert->dw;
     int deformed = 0;
     unsigned int j;
+    float blend_mat[4][4];
+    float blend_weight = 0.0f;
+
+    if (vec) {
+      zero_m4(blend_mat);
+    }
+
     for (j = dvert->totweight; j != 0; j--, dw++) {
       const int index = dw->def_nr;
-      if (index >= 0 && index < data->defbase_tot && (pchan = data->defnrToPC[index])) {
+      if (index >= 0 && index < data->defbase_tot && (pchan = data->defgroups[index].pchan)) {
         float weight = dw->weight;
-        Bone *bone = pchan->bone;
 
         deformed = 1;
 
-        if (bone && bone->flag & BONE_MULT_VG_ENV) {
-          weight *= distfactor_to_bone(
-              co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
+        if (data->defgroups[index].use_generic) {
+          Bone *bone = pchan->bone;
+
+          if (bone->flag & BONE_MULT_VG_ENV) {
+            weight *= distfactor_to_bone(
+                co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
+          }
+
+          pchan_bone_deform(pchan, weight, vec, dq, smat, co, &contrib);
+        }
+        else if (weight != 0.0f) {
+          if (dq) {
+            armature_dq_add(dq, &pchan->runtime.deform_dual_quat, weight);
+          }
+          else {
+            armature_blend_mat_add(blend_mat, pchan->chan_mat, weight);
+            blend_weight += weight;
+          }
+          contrib += weight;
         }
+      }
+    }
 
-        pchan_bone_deform(pchan, weight, vec, dq, smat, co, &contrib);
+    /* Apply the blended matrix, the equivalent of #pchan_deform_accumulate for each bone. */
+    if (blend_weight != 0.0f) {
+      float tmp[3];
+      mul_v3_m4v3(tmp, blend_mat, co);
+      madd_v3_v3fl(tmp, co, -blend_weight);
+      add_v3_v3(vec, tmp);
+
+      if (smat) {
+        float tmpmat[3][3];
+        copy_m3_m4(tmpmat, blend_mat);
+        add_m3_m3m3(smat, smat, tmpmat);
       }
     }
     /* if there are vertexgroups but not groups with bones
@@ -1657,7 +1756,7 @@ void armature_deform_verts(Object *armOb,
                            bGPDstroke *gps)
 {
   bArmature *arm = armOb->data;
-  bPoseChannel **defnrToPC = NULL;
+  ArmatureDeformGroup *defgroups = NULL;
   MDeformVert *dverts = NULL;
   bDeformGroup *dg;
   const bool use_envelope = (deformflag & ARM_DEF_ENVELOPE) != 0;
@@ -1720,18 +1819,20 @@ void armature_deform_verts(Object *armOb,
       }
 
       if (use_dverts) {
-        defnrToPC = MEM_callocN(sizeof(*defnrToPC) * defbase_tot, "defnrToBone");
+        defgroups = MEM_callocN(sizeof(*defgroups) * defbase_tot, "ArmatureDeformGroup");
         /* TODO(sergey): Some considerations here:
          *
          * - Check whether keeping this consistent across frames gives speedup.
          */
         for (i = 0, dg = target->defbase.first; dg; i++, dg = dg->next) {
-          defnrToPC[i] = BKE_pose_channel_find_name(armOb->pose, dg->name);
+          bPoseChannel *pchan = BKE_pose_channel_find_name(armOb->pose, dg->name);
           /* exclude non-deforming bones */
-          if (defnrToPC[i]) {
-            if (defnrToPC[i]->bone->flag & BONE_NO_DEFORM) {
-              defnrToPC[i] = NULL;
-            }
+          if (pchan && !(pchan->bone->flag & BONE_NO_DEFORM)) {
+            const Bone *bone = pchan->bone;
+            defgroups[i].pchan = pchan;
+            defgroups[i].use_generic = (bone->flag & BONE_MULT_VG_ENV) ||
+                                       (bone->segments > 1 &&
+                                        pchan->runtime.bbone_segments == bone->segments);
           }
         }
       }
@@ -1752,7 +1853,7 @@ void armature_deform_verts(Object *armOb,
                            .target_totvert = target_totvert,
                            .dverts = dverts,
                            .defbase_tot = defbase_tot,
-                           .defnrToPC = defnrToPC};
+                           .defgroups = defgroups};
 
   float obinv[4][4];
   invert_m4_m4(obinv, target->obmat);
@@ -1765,8 +1866,8 @@ void armature_deform_verts(Object *armOb,
   settings.min_iter_per_thread = 32;
   BLI_task_parallel_range(0, numVerts, &data, armature_vert_task, &settings);
 
-  if (defnrToPC) {
-    MEM_freeN(defnrToPC);
+  if (defgroups) {
+    MEM_freeN(defgroups);
   }
 }
 
@@ -61,7 +61,11 @@
 
 #define UNDO_DISK 0
 
-bool BKE_memfile_undo_decode(MemFileUndoData *mfu, bContext *C)
+/**
+ * \param mfu_current: The undo data of the current state, when the current state didn't change
+ * since (other than changes tagged by #ID.recalc_after_undo_push). Unchanged IDs are kept.
+ */
+bool BKE_memfile_undo_decode(MemFileUndoData *mfu, MemFileUndoData *mfu_current, bContext *C)
 {
   Main *bmain = CTX_data_main(C);
   char mainstr[sizeof(bmain->name)];
@@ -76,8 +80,11 @@ bool BKE_memfile_undo_decode(MemFileUndoData *mfu, bContext *C)
     success = BKE_blendfile_read(C, mfu->filename, &(const struct BlendFileReadParams){0}, NULL);
   }
   else {
-    success = BKE_blendfile_read_from_memfile(
-        C, &mfu->memfile, &(const struct BlendFileReadParams){0}, NULL);
+    success = BKE_blendfile_read_from_memfile(C,
+                                              &mfu->memfile,
+                                              mfu_current ? &mfu_current->memfile : NULL,
+                                              &(const struct BlendFileReadParams){0},
+                                              NULL);
   }
 
   /* Restore, bmain has been re-allocated. */
@@ -116,6 +123,13 @@ MemFileUndoData *BKE_memfile_undo_encode(Main *bmain, MemFileUndoData *mfu_prev)
     BLI_strncpy(mfu->filename, filename, sizeof(mfu->filename));
   }
   else {
+    /* The state is stored, only later changes prevent keeping IDs on undo. */
+    ID *id;
+    FOREACH_MAIN_ID_BEGIN (bmain, id) {
+      id->recalc_after_undo_push = 0;
+    }
+    FOREACH_MAIN_ID_END;
+
     MemFile *prevfile = (mfu_prev) ? &(mfu_prev->memfile) : NULL;
     /* success = */ /* UNUSED */ BLO_write_file_mem(bmain, prevfile, &mfu->memfile, G.fileflags);
     mfu->undo_size = mfu->memfile.size;
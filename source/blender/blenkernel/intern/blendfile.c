@@ -465,16 +465,22 @@ bool BKE_blendfile_read_from_memory(bContext *C,
 }
 
 /* memfile is the undo buffer */
+/* memfile_current is the undo buffer of the current state, can be NULL */
 bool BKE_blendfile_read_from_memfile(bContext *C,
                                      struct MemFile *memfile,
+                                     struct MemFile *memfile_current,
                                      const struct BlendFileReadParams *params,
                                      ReportList *reports)
 {
   Main *bmain = CTX_data_main(C);
   BlendFileData *bfd;
 
-  bfd = BLO_read_from_memfile(
-      bmain, BKE_main_blendfile_path(bmain), memfile, params->skip_flags, reports);
+  bfd = BLO_read_from_memfile(bmain,
+                              BKE_main_blendfile_path(bmain),
+                              memfile,
+                              memfile_current,
+                              params->skip_flags,
+                              reports);
   if (bfd) {
     /* remove the unused screens and wm */
     while (bfd->main->wm.first) {
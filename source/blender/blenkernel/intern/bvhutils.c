@@ -43,6 +43,13 @@
 
 static ThreadRWMutex cache_rwlock = BLI_RWLOCK_INITIALIZER;
 
+typedef struct BVHCacheItem {
+  int type;
+  BVHTree *tree;
+  /* Positions of the elements changed since the tree was built, the topology didn't. */
+  bool coords_changed;
+} BVHCacheItem;
+
 /* -------------------------------------------------------------------- */
 /** \name Local Callbacks
  * \{ */
@@ -1306,6 +1313,112 @@ static BLI_bitmap *looptri_no_hidden_map_get(const MPoly *mpoly,
   return looptri_mask;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Refit Cached Trees
+ *
+ * When only the positions of a mesh changed, the cached trees are refit to the new positions
+ * instead of being built again.
+ * \{ */
+
+static int mesh_verts_refit_cb(void *userdata, int index, float r_co[4][3])
+{
+  const Mesh *mesh = userdata;
+  copy_v3_v3(r_co[0], mesh->mvert[index].co);
+  return 1;
+}
+
+static int mesh_edges_refit_cb(void *userdata, int index, float r_co[4][3])
+{
+  const Mesh *mesh = userdata;
+  const MEdge *edge = &mesh->medge[index];
+  copy_v3_v3(r_co[0], mesh->mvert[edge->v1].co);
+  copy_v3_v3(r_co[1], mesh->mvert[edge->v2].co);
+  return 2;
+}
+
+static int mesh_faces_refit_cb(void *userdata, int index, float r_co[4][3])
+{
+  const Mesh *mesh = userdata;
+  const MFace *face = &mesh->mface[index];
+  copy_v3_v3(r_co[0], mesh->mvert[face->v1].co);
+  copy_v3_v3(r_co[1], mesh->mvert[face->v2].co);
+  copy_v3_v3(r_co[2], mesh->mvert[face->v3].co);
+  if (face->v4) {
+    copy_v3_v3(r_co[3], mesh->mvert[face->v4].co);
+    return 4;
+  }
+  return 3;
+}
+
+static int mesh_looptri_refit_cb(void *userdata, int index, float r_co[4][3])
+{
+  const Mesh *mesh = userdata;
+  const MLoopTri *lt = &mesh->runtime.looptris.array[index];
+  copy_v3_v3(r_co[0], mesh->mvert[mesh->mloop[lt->tri[0]].v].co);
+  copy_v3_v3(r_co[1], mesh->mvert[mesh->mloop[lt->tri[1]].v].co);
+  copy_v3_v3(r_co[2], mesh->mvert[mesh->mloop[lt->tri[2]].v].co);
+  return 3;
+}
+
+static BVHCacheItem *bvhcache_find_item(BVHCache *cache, int type)
+{
+  while (cache) {
+    BVHCacheItem *item = cache->link;
+    if (item->type == type) {
+      return item;
+    }
+    cache = cache->next;
+  }
+  return NULL;
+}
+
+/**
+ * Refit the cached tree of the given type when the positions of the mesh changed.
+ */
+static void bvhcache_refit_ensure(BVHCache *cache, const int type, Mesh *mesh)
+{
+  BLI_rw_mutex_lock(&cache_rwlock, THREAD_LOCK_READ);
+  BVHCacheItem *item = bvhcache_find_item(cache, type);
+  const bool coords_changed = (item != NULL) && item->coords_changed;
+  BLI_rw_mutex_unlock(&cache_rwlock);
+
+  if (!coords_changed) {
+    return;
+  }
+
+  BLI_rw_mutex_lock(&cache_rwlock, THREAD_LOCK_WRITE);
+  /* Another thread might have refit the tree already. */
+  if (item->coords_changed) {
+    if (item->tree != NULL) {
+      switch (type) {
+        case BVHTREE_FROM_VERTS:
+        case BVHTREE_FROM_LOOSEVERTS:
+          BLI_bvhtree_refit(item->tree, mesh_verts_refit_cb, mesh);
+          break;
+        case BVHTREE_FROM_EDGES:
+        case BVHTREE_FROM_LOOSEEDGES:
+          BLI_bvhtree_refit(item->tree, mesh_edges_refit_cb, mesh);
+          break;
+        case BVHTREE_FROM_FACES:
+          BLI_bvhtree_refit(item->tree, mesh_faces_refit_cb, mesh);
+          break;
+        case BVHTREE_FROM_LOOPTRI:
+        case BVHTREE_FROM_LOOPTRI_NO_HIDDEN:
+          BKE_mesh_runtime_looptri_ensure(mesh);
+          BLI_bvhtree_refit(item->tree, mesh_looptri_refit_cb, mesh);
+          break;
+        default:
+          BLI_assert(false);
+          break;
+      }
+    }
+    item->coords_changed = false;
+  }
+  BLI_rw_mutex_unlock(&cache_rwlock);
+}
+
+/** \} */
+
 /**
  * Builds or queries a bvhcache for the cache bvhtree of the request type.
  */
@@ -1326,6 +1439,10 @@ BVHTree *BKE_bvhtree_from_mesh_get(struct BVHTreeFromMesh *data,
     return tree;
   }
 
+  if (is_cached) {
+    bvhcache_refit_ensure(*bvh_cache, bvh_cache_type, mesh);
+  }
+
   switch (bvh_cache_type) {
     case BVHTREE_FROM_VERTS:
     case BVHTREE_FROM_LOOSEVERTS:
@@ -1620,12 +1737,6 @@ void free_bvhtree_from_mesh(struct BVHTreeFromMesh *data)
 /** \name BVHCache
  * \{ */
 
-typedef struct BVHCacheItem {
-  int type;
-  BVHTree *tree;
-
-} BVHCacheItem;
-
 /**
  * Queries a bvhcache for the cache bvhtree of the request type
  */
@@ -1672,10 +1783,26 @@ void bvhcache_insert(BVHCache **cache_p, BVHTree *tree, int type)
 
   item->type = type;
   item->tree = tree;
+  item->coords_changed = false;
 
   BLI_linklist_prepend(cache_p, item);
 }
 
+/**
+ * Tag the cached trees to be refit when they are used next,
+ * call when the positions of the elements changed but the topology didn't.
+ */
+void bvhcache_tag_coords_changed(BVHCache *cache)
+{
+  BLI_rw_mutex_lock(&cache_rwlock, THREAD_LOCK_WRITE);
+  while (cache) {
+    BVHCacheItem *item = cache->link;
+    item->coords_changed = true;
+    cache = cache->next;
+  }
+  BLI_rw_mutex_unlock(&cache_rwlock);
+}
+
 /**
  * frees a bvhcache
  */
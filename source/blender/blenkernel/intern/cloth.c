@@ -34,6 +34,7 @@
 #include "BLI_rand.h"
 #include "BLI_edgehash.h"
 #include "BLI_linklist.h"
+#include "BLI_task.h"
 
 #include "DEG_depsgraph.h"
 #include "DEG_depsgraph_query.h"
@@ -228,13 +229,65 @@ static BVHTree *bvhtree_build_from_cloth(ClothModifierData *clmd, float epsilon)
   return bvhtree;
 }
 
+typedef struct ClothBVHUpdateData {
+  BVHTree *bvhtree;
+  const ClothVertex *verts;
+  const MVertTri *tri;
+  const MEdge *edges;
+  bool moving;
+} ClothBVHUpdateData;
+
+static void bvhtree_update_from_cloth_tri_task_cb(void *__restrict userdata,
+                                                  const int i,
+                                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ClothBVHUpdateData *data = userdata;
+  const ClothVertex *verts = data->verts;
+  const MVertTri *vt = &data->tri[i];
+  float co[3][3], co_moving[3][3];
+
+  /* copy new locations into array */
+  if (data->moving) {
+    copy_v3_v3(co[0], verts[vt->tri[0]].txold);
+    copy_v3_v3(co[1], verts[vt->tri[1]].txold);
+    copy_v3_v3(co[2], verts[vt->tri[2]].txold);
+
+    /* update moving positions */
+    copy_v3_v3(co_moving[0], verts[vt->tri[0]].tx);
+    copy_v3_v3(co_moving[1], verts[vt->tri[1]].tx);
+    copy_v3_v3(co_moving[2], verts[vt->tri[2]].tx);
+
+    BLI_bvhtree_update_node(data->bvhtree, i, co[0], co_moving[0], 3);
+  }
+  else {
+    copy_v3_v3(co[0], verts[vt->tri[0]].tx);
+    copy_v3_v3(co[1], verts[vt->tri[1]].tx);
+    copy_v3_v3(co[2], verts[vt->tri[2]].tx);
+
+    BLI_bvhtree_update_node(data->bvhtree, i, co[0], NULL, 3);
+  }
+}
+
+static void bvhtree_update_from_cloth_edge_task_cb(void *__restrict userdata,
+                                                   const int i,
+                                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ClothBVHUpdateData *data = userdata;
+  const ClothVertex *verts = data->verts;
+  const MEdge *edge = &data->edges[i];
+  float co[2][3];
+
+  copy_v3_v3(co[0], verts[edge->v1].tx);
+  copy_v3_v3(co[1], verts[edge->v2].tx);
+
+  BLI_bvhtree_update_node(data->bvhtree, i, co[0], NULL, 2);
+}
+
 void bvhtree_update_from_cloth(ClothModifierData *clmd, bool moving, bool self)
 {
-  unsigned int i = 0;
   Cloth *cloth = clmd->clothObject;
   BVHTree *bvhtree;
   ClothVertex *verts = cloth->verts;
-  const MVertTri *vt;
 
   BLI_assert(!(clmd->hairdata != NULL && self));
 
@@ -245,66 +298,36 @@ void bvhtree_update_from_cloth(ClothModifierData *clmd, bool moving, bool self)
     bvhtree = cloth->bvhtree;
   }
 
-  if (!bvhtree) {
+  if (!bvhtree || !verts) {
     return;
   }
 
-  vt = cloth->tri;
+  BLI_assert((int)cloth->primitive_num <= BLI_bvhtree_get_len(bvhtree));
 
-  /* update vertex position in bvh tree */
-  if (clmd->hairdata == NULL) {
-    if (verts && vt) {
-      for (i = 0; i < cloth->primitive_num; i++, vt++) {
-        float co[3][3], co_moving[3][3];
-        bool ret;
-
-        /* copy new locations into array */
-        if (moving) {
-          copy_v3_v3(co[0], verts[vt->tri[0]].txold);
-          copy_v3_v3(co[1], verts[vt->tri[1]].txold);
-          copy_v3_v3(co[2], verts[vt->tri[2]].txold);
-
-          /* update moving positions */
-          copy_v3_v3(co_moving[0], verts[vt->tri[0]].tx);
-          copy_v3_v3(co_moving[1], verts[vt->tri[1]].tx);
-          copy_v3_v3(co_moving[2], verts[vt->tri[2]].tx);
-
-          ret = BLI_bvhtree_update_node(bvhtree, i, co[0], co_moving[0], 3);
-        }
-        else {
-          copy_v3_v3(co[0], verts[vt->tri[0]].tx);
-          copy_v3_v3(co[1], verts[vt->tri[1]].tx);
-          copy_v3_v3(co[2], verts[vt->tri[2]].tx);
-
-          ret = BLI_bvhtree_update_node(bvhtree, i, co[0], NULL, 3);
-        }
-
-        /* check if tree is already full */
-        if (ret == false) {
-          break;
-        }
-      }
+  /* update vertex position in bvh tree,
+   * every primitive updates its own leaf, the branches are refit afterwards */
+  ClothBVHUpdateData data = {
+      .bvhtree = bvhtree,
+      .verts = verts,
+      .tri = cloth->tri,
+      .edges = cloth->edges,
+      .moving = moving,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
 
+  if (clmd->hairdata == NULL) {
+    if (cloth->tri) {
+      BLI_task_parallel_range(
+          0, (int)cloth->primitive_num, &data, bvhtree_update_from_cloth_tri_task_cb, &settings);
       BLI_bvhtree_update_tree(bvhtree);
     }
   }
   else {
-    if (verts) {
-      MEdge *edges = cloth->edges;
-
-      for (i = 0; i < cloth->primitive_num; i++) {
-        float co[2][3];
-
-        copy_v3_v3(co[0], verts[edges[i].v1].tx);
-        copy_v3_v3(co[1], verts[edges[i].v2].tx);
-
-        if (!BLI_bvhtree_update_node(bvhtree, i, co[0], NULL, 2)) {
-          break;
-        }
-      }
-
-      BLI_bvhtree_update_tree(bvhtree);
-    }
+    BLI_task_parallel_range(
+        0, (int)cloth->primitive_num, &data, bvhtree_update_from_cloth_edge_task_cb, &settings);
+    BLI_bvhtree_update_tree(bvhtree);
   }
 }
 
@@ -34,12 +34,14 @@
 #include "DNA_ID.h"
 
 #include "BLI_utildefines.h"
+#include "BLI_hash_mm2a.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_string_utils.h"
 #include "BLI_math.h"
 #include "BLI_math_color_blend.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BLT_translation.h"
 
@@ -52,6 +54,8 @@
 
 #include "bmesh.h"
 
+#include "atomic_ops.h"
+
 #include "CLG_log.h"
 
 /* only for customdata_data_transfer_interp_normal_normals */
@@ -1814,12 +1818,77 @@ void customData_mask_layers__print(const CustomData_MeshMasks *mask)
 /********************* CustomData functions *********************/
 static void customData_update_offsets(CustomData *data);
 
+/* Layers of at least this size are copied from multiple threads, in chunks of about
+ * CUSTOMDATA_COPY_CHUNK_SIZE bytes. */
+#define CUSTOMDATA_PARALLEL_COPY_MIN_SIZE (4 * 1024 * 1024)
+#define CUSTOMDATA_COPY_CHUNK_SIZE (256 * 1024)
+
+typedef struct CustomDataCopyData {
+  const LayerTypeInfo *typeInfo;
+  const char *source;
+  char *dest;
+  int totelem;
+  int chunk_totelem;
+} CustomDataCopyData;
+
+static void customData_copy_layer_data_chunk(void *__restrict userdata,
+                                             const int chunk,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const CustomDataCopyData *data = userdata;
+  const int start = chunk * data->chunk_totelem;
+  const int count = min_ii(data->chunk_totelem, data->totelem - start);
+  const size_t offset = (size_t)start * data->typeInfo->size;
+
+  if (data->typeInfo->copy) {
+    data->typeInfo->copy(data->source + offset, data->dest + offset, count);
+  }
+  else {
+    memcpy(data->dest + offset, data->source + offset, (size_t)count * data->typeInfo->size);
+  }
+}
+
+/* Copy elements of a layer, big layers are split in chunks which are copied in parallel. */
+static void customData_copy_layer_data(const LayerTypeInfo *typeInfo,
+                                       const void *source,
+                                       void *dest,
+                                       const int totelem)
+{
+  const size_t size = (size_t)totelem * typeInfo->size;
+
+  if (size < CUSTOMDATA_PARALLEL_COPY_MIN_SIZE) {
+    if (typeInfo->copy) {
+      typeInfo->copy(source, dest, totelem);
+    }
+    else {
+      memcpy(dest, source, size);
+    }
+    return;
+  }
+
+  CustomDataCopyData data = {
+      .typeInfo = typeInfo,
+      .source = source,
+      .dest = dest,
+      .totelem = totelem,
+      .chunk_totelem = max_ii(1, CUSTOMDATA_COPY_CHUNK_SIZE / typeInfo->size),
+  };
+  const int num_chunks = (totelem + data.chunk_totelem - 1) / data.chunk_totelem;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, num_chunks, &data, customData_copy_layer_data_chunk, &settings);
+}
+
 static CustomDataLayer *customData_add_layer__internal(CustomData *data,
                                                        int type,
                                                        eCDAllocType alloctype,
                                                        void *layerdata,
                                                        int totelem,
                                                        const char *name);
+static void *customData_duplicate_referenced_layer_index(CustomData *data,
+                                                         const int layer_index,
+                                                         const int totelem);
 
 void CustomData_update_typemap(CustomData *data)
 {
@@ -1848,6 +1917,54 @@ static bool customdata_typemap_is_valid(const CustomData *data)
 }
 #endif
 
+/** Users of layer data shared between layers, see #CD_SHARE. */
+typedef struct CustomDataSharingInfo {
+  int users;
+} CustomDataSharingInfo;
+
+/* Make \a layer_dst share the data of \a layer_src, as a new user of it. */
+static void customData_layer_share(CustomDataLayer *layer_src, CustomDataLayer *layer_dst)
+{
+  if (layer_src->sharing_info == NULL) {
+    CustomDataSharingInfo *sharing_info = MEM_mallocN(sizeof(*sharing_info), __func__);
+    sharing_info->users = 1;
+    /* The source may be shared from other threads at the same time (copy-on-write). */
+    if (atomic_cas_ptr((void **)&layer_src->sharing_info, NULL, sharing_info) != NULL) {
+      MEM_freeN(sharing_info);
+    }
+  }
+  atomic_add_and_fetch_int32(&layer_src->sharing_info->users, 1);
+
+  layer_dst->data = layer_src->data;
+  layer_dst->sharing_info = layer_src->sharing_info;
+}
+
+/**
+ * Remove \a layer from the users of its shared data.
+ * \return True when it was the last user, the data is owned by the layer then.
+ */
+static bool customData_layer_unshare(CustomDataLayer *layer)
+{
+  CustomDataSharingInfo *sharing_info = layer->sharing_info;
+  layer->sharing_info = NULL;
+  if (atomic_sub_and_fetch_int32(&sharing_info->users, 1) == 0) {
+    MEM_freeN(sharing_info);
+    return true;
+  }
+  return false;
+}
+
+static void customData_layer_data_free(const int type, void *data, const int totelem)
+{
+  const LayerTypeInfo *typeInfo = layerType_getInfo(type);
+
+  if (typeInfo->free) {
+    typeInfo->free(data, totelem, typeInfo->size);
+  }
+
+  MEM_freeN(data);
+}
+
 bool CustomData_merge(const struct CustomData *source,
                       struct CustomData *dest,
                       CustomDataMask mask,
@@ -1899,6 +2016,7 @@ bool CustomData_merge(const struct CustomData *source,
       case CD_ASSIGN:
       case CD_REFERENCE:
       case CD_DUPLICATE:
+      case CD_SHARE:
         data = layer->data;
         break;
       default:
@@ -1906,12 +2024,30 @@ bool CustomData_merge(const struct CustomData *source,
         break;
     }
 
+    eCDAllocType layer_alloctype = alloctype;
     if ((alloctype == CD_ASSIGN) && (flag & CD_FLAG_NOFREE)) {
-      newlayer = customData_add_layer__internal(
-          dest, type, CD_REFERENCE, data, totelem, layer->name);
+      layer_alloctype = CD_REFERENCE;
     }
-    else {
-      newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
+    else if ((alloctype == CD_REFERENCE) && layer->sharing_info) {
+      /* Other users may free shared data, a reference has to be a user too. */
+      layer_alloctype = CD_SHARE;
+    }
+    else if ((alloctype == CD_SHARE) && (flag & CD_FLAG_NOFREE)) {
+      /* The source doesn't own referenced data, it can't be shared. */
+      layer_alloctype = CD_DUPLICATE;
+    }
+
+    newlayer = customData_add_layer__internal(
+        dest, type, layer_alloctype, data, totelem, layer->name);
+
+    if (newlayer && data && newlayer->data == data) {
+      if (layer_alloctype == CD_SHARE) {
+        customData_layer_share((CustomDataLayer *)layer, newlayer);
+      }
+      else if (layer_alloctype == CD_ASSIGN) {
+        /* The users of shared data are moved along with it. */
+        newlayer->sharing_info = layer->sharing_info;
+      }
     }
 
     if (newlayer) {
@@ -1930,7 +2066,7 @@ bool CustomData_merge(const struct CustomData *source,
   return changed;
 }
 
-/* NOTE: Take care of referenced layers by yourself! */
+/* NOTE: Take care of referenced layers by yourself! Shared layers are copied first. */
 void CustomData_realloc(CustomData *data, int totelem)
 {
   int i;
@@ -1941,6 +2077,10 @@ void CustomData_realloc(CustomData *data, int totelem)
       continue;
     }
     typeInfo = layerType_getInfo(layer->type);
+    if (layer->sharing_info) {
+      customData_duplicate_referenced_layer_index(
+          data, i, (int)(MEM_allocN_len(layer->data) / typeInfo->size));
+    }
     layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
   }
 }
@@ -1962,18 +2102,13 @@ void CustomData_copy(const struct CustomData *source,
 
 static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
 {
-  const LayerTypeInfo *typeInfo;
+  if (layer->sharing_info && !customData_layer_unshare(layer)) {
+    /* Still used by other layers. */
+    return;
+  }
 
   if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
-    typeInfo = layerType_getInfo(layer->type);
-
-    if (typeInfo->free) {
-      typeInfo->free(layer->data, totelem, typeInfo->size);
-    }
-
-    if (layer->data) {
-      MEM_freeN(layer->data);
-    }
+    customData_layer_data_free(layer->type, layer->data, totelem);
   }
 }
 
@@ -2304,13 +2439,14 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   /* Passing a layer-data to copy from with an alloctype that won't copy is
    * most likely a bug */
   BLI_assert(!layerdata || (alloctype == CD_ASSIGN) || (alloctype == CD_DUPLICATE) ||
-             (alloctype == CD_REFERENCE));
+             (alloctype == CD_REFERENCE) || (alloctype == CD_SHARE));
 
   if (!typeInfo->defaultname && CustomData_has_layer(data, type)) {
     return &data->layers[CustomData_get_layer_index(data, type)];
   }
 
-  if ((alloctype == CD_ASSIGN) || (alloctype == CD_REFERENCE)) {
+  if ((alloctype == CD_ASSIGN) || (alloctype == CD_REFERENCE) || (alloctype == CD_SHARE)) {
+    /* Shared data is counted by #CustomData_merge, the only place it's passed from. */
     newlayerdata = layerdata;
   }
   else if (totelem > 0 && typeInfo->size > 0) {
@@ -2327,12 +2463,7 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   }
 
   if (alloctype == CD_DUPLICATE && layerdata) {
-    if (typeInfo->copy) {
-      typeInfo->copy(layerdata, newlayerdata, totelem);
-    }
-    else {
-      memcpy(newlayerdata, layerdata, (size_t)totelem * typeInfo->size);
-    }
+    customData_copy_layer_data(typeInfo, layerdata, newlayerdata, totelem);
   }
   else if (alloctype == CD_DEFAULT) {
     if (typeInfo->set_default) {
@@ -2362,6 +2493,7 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   data->layers[index].type = type;
   data->layers[index].flag = flag;
   data->layers[index].data = newlayerdata;
+  data->layers[index].sharing_info = NULL;
 
   /* Set default name if none exists. Note we only call DATA_()  once
    * we know there is a default name, to avoid overhead of locale lookups
@@ -2535,6 +2667,22 @@ int CustomData_number_of_layers_typemask(const CustomData *data, CustomDataMask
   return number;
 }
 
+static void *customData_duplicate_layer_data(const CustomDataLayer *layer, const int totelem)
+{
+  /* MEM_dupallocN won't work in case of complex layers, like e.g.
+   * CD_MDEFORMVERT, which has pointers to allocated data...
+   * So in case a custom copy function is defined, use it!
+   */
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+
+  if (typeInfo->copy) {
+    void *dst_data = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, "CD duplicate ref layer");
+    customData_copy_layer_data(typeInfo, layer->data, dst_data, totelem);
+    return dst_data;
+  }
+  return MEM_dupallocN(layer->data);
+}
+
 static void *customData_duplicate_referenced_layer_index(CustomData *data,
                                                          const int layer_index,
                                                          const int totelem)
@@ -2548,23 +2696,22 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
   layer = &data->layers[layer_index];
 
   if (layer->flag & CD_FLAG_NOFREE) {
-    /* MEM_dupallocN won't work in case of complex layers, like e.g.
-     * CD_MDEFORMVERT, which has pointers to allocated data...
-     * So in case a custom copy function is defined, use it!
-     */
-    const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
-
-    if (typeInfo->copy) {
-      void *dst_data = MEM_malloc_arrayN(
-          (size_t)totelem, typeInfo->size, "CD duplicate ref layer");
-      typeInfo->copy(layer->data, dst_data, totelem);
-      layer->data = dst_data;
+    layer->data = customData_duplicate_layer_data(layer, totelem);
+    layer->flag &= ~CD_FLAG_NOFREE;
+  }
+  else if (layer->sharing_info) {
+    /* Shared data is immutable, it's only copied when other layers still use it. */
+    if (layer->sharing_info->users == 1) {
+      customData_layer_unshare(layer);
     }
     else {
-      layer->data = MEM_dupallocN(layer->data);
+      void *data_shared = layer->data;
+      layer->data = customData_duplicate_layer_data(layer, totelem);
+      if (customData_layer_unshare(layer)) {
+        /* The other users were freed meanwhile. */
+        customData_layer_data_free(layer->type, data_shared, totelem);
+      }
     }
-
-    layer->flag &= ~CD_FLAG_NOFREE;
   }
 
   return layer->data;
@@ -2622,6 +2769,21 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type)
   return (layer->flag & CD_FLAG_NOFREE) != 0;
 }
 
+/**
+ * The data of the layer of \a type is shared with other layers, it has to be copied before
+ * writing to it, see #CustomData_duplicate_referenced_layer.
+ */
+bool CustomData_is_shared_layer(const CustomData *data, int type)
+{
+  const int layer_index = CustomData_get_active_layer_index(data, type);
+  if (layer_index == -1) {
+    return false;
+  }
+
+  const CustomDataLayer *layer = &data->layers[layer_index];
+  return layer->sharing_info && layer->sharing_info->users > 1;
+}
+
 void CustomData_free_temporary(CustomData *data, int totelem)
 {
   CustomDataLayer *layer;
@@ -2667,6 +2829,127 @@ void CustomData_set_only_copy(const struct CustomData *data, CustomDataMask mask
   }
 }
 
+/**
+ * Hash the layout and contents of all layers, to detect changes to the data.
+ *
+ * \param mask_skip: Layer types of which only the layout is hashed, not the contents.
+ * \param r_hash: Used as the seed and replaced by the resulting hash.
+ * \return false when a layer stores pointers to other allocations which are not hashed
+ * (multi-resolution displacements for example), \a r_hash is left unchanged in that case.
+ */
+bool CustomData_hash(const CustomData *data,
+                     const int totelem,
+                     const CustomDataMask mask_skip,
+                     uint32_t *r_hash)
+{
+  uint32_t hash = BLI_hash_mm2((const uchar *)&totelem, sizeof(totelem), *r_hash);
+
+  for (int i = 0; i < data->totlayer; i++) {
+    const CustomDataLayer *layer = &data->layers[i];
+    const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+
+    if (ELEM(layer->type, CD_MDISPS, CD_GRID_PAINT_MASK, CD_BM_ELEM_PYPTR)) {
+      return false;
+    }
+
+    const int layer_info[6] = {
+        layer->type,
+        layer->flag & ~CD_FLAG_NOCOPY,
+        layer->active,
+        layer->active_rnd,
+        layer->active_clone,
+        layer->active_mask,
+    };
+    hash = BLI_hash_mm2((const uchar *)layer_info, sizeof(layer_info), hash);
+    hash = BLI_hash_mm2((const uchar *)layer->name, strlen(layer->name), hash);
+
+    if (layer->data == NULL || (mask_skip & CD_TYPE_AS_MASK(layer->type))) {
+      continue;
+    }
+
+    if (layer->type == CD_MDEFORMVERT) {
+      const MDeformVert *dvert = layer->data;
+      for (int j = 0; j < totelem; j++, dvert++) {
+        hash = BLI_hash_mm2(
+            (const uchar *)&dvert->totweight, sizeof(dvert->totweight), hash);
+        if (dvert->dw) {
+          hash = BLI_hash_mm2(
+              (const uchar *)dvert->dw, sizeof(*dvert->dw) * (size_t)dvert->totweight, hash);
+        }
+      }
+    }
+    else {
+      hash = BLI_hash_mm2((const uchar *)layer->data, (size_t)typeInfo->size * totelem, hash);
+    }
+  }
+
+  *r_hash = hash;
+  return true;
+}
+
+/**
+ * Compare the layout and contents of all layers which are copied, so a copy made with
+ * #CustomData_copy can be compared to the data it was made from.
+ *
+ * \param mask_skip: Layer types of which only the layout is compared, not the contents.
+ */
+bool CustomData_equals(const CustomData *data_a,
+                       const CustomData *data_b,
+                       const int totelem,
+                       const CustomDataMask mask_skip)
+{
+  int i_a = 0, i_b = 0;
+
+  while (true) {
+    while (i_a < data_a->totlayer && (data_a->layers[i_a].flag & CD_FLAG_NOCOPY)) {
+      i_a++;
+    }
+    while (i_b < data_b->totlayer && (data_b->layers[i_b].flag & CD_FLAG_NOCOPY)) {
+      i_b++;
+    }
+    if (i_a == data_a->totlayer || i_b == data_b->totlayer) {
+      return (i_a == data_a->totlayer && i_b == data_b->totlayer);
+    }
+
+    const CustomDataLayer *layer_a = &data_a->layers[i_a++];
+    const CustomDataLayer *layer_b = &data_b->layers[i_b++];
+    const LayerTypeInfo *typeInfo = layerType_getInfo(layer_a->type);
+    /* Flags which are kept when copying layers. */
+    const int flag_mask = CD_FLAG_EXTERNAL | CD_FLAG_IN_MEMORY;
+
+    if (layer_a->type != layer_b->type ||
+        (layer_a->flag & flag_mask) != (layer_b->flag & flag_mask) ||
+        layer_a->active != layer_b->active || layer_a->active_rnd != layer_b->active_rnd ||
+        layer_a->active_clone != layer_b->active_clone ||
+        layer_a->active_mask != layer_b->active_mask || !STREQ(layer_a->name, layer_b->name)) {
+      return false;
+    }
+    if (layer_a->data == layer_b->data || (mask_skip & CD_TYPE_AS_MASK(layer_a->type))) {
+      continue;
+    }
+    if (layer_a->data == NULL || layer_b->data == NULL) {
+      return false;
+    }
+
+    if (layer_a->type == CD_MDEFORMVERT) {
+      const MDeformVert *dvert_a = layer_a->data;
+      const MDeformVert *dvert_b = layer_b->data;
+      for (int j = 0; j < totelem; j++, dvert_a++, dvert_b++) {
+        if (dvert_a->totweight != dvert_b->totweight) {
+          return false;
+        }
+        if (dvert_a->totweight &&
+            memcmp(dvert_a->dw, dvert_b->dw, sizeof(*dvert_a->dw) * (size_t)dvert_a->totweight)) {
+          return false;
+        }
+      }
+    }
+    else if (memcmp(layer_a->data, layer_b->data, (size_t)typeInfo->size * totelem)) {
+      return false;
+    }
+  }
+}
+
 void CustomData_copy_elements(int type, void *src_data_ofs, void *dst_data_ofs, int count)
 {
   const LayerTypeInfo *typeInfo = layerType_getInfo(type);
@@ -3044,6 +3327,18 @@ const char *CustomData_get_layer_name(const CustomData *data, int type, int n)
   return (layer_index == -1) ? NULL : data->layers[layer_index].name;
 }
 
+/**
+ * Replace the data of \a layer. When it was shared the layer stops being a user of it,
+ * the previous data stays with the other users.
+ */
+static void customData_set_layer_data(CustomDataLayer *layer, void *ptr)
+{
+  if (layer->sharing_info) {
+    customData_layer_unshare(layer);
+  }
+  layer->data = ptr;
+}
+
 void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
 {
   /* get the layer index of the first layer of type */
@@ -3053,7 +3348,7 @@ void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customData_set_layer_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -3066,7 +3361,7 @@ void *CustomData_set_layer_n(const struct CustomData *data, int type, int n, voi
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customData_set_layer_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -3432,7 +3727,11 @@ void CustomData_bmesh_free_block_data(CustomData *data, void *block)
   }
 }
 
-static void CustomData_bmesh_alloc_block(CustomData *data, void **block)
+/**
+ * Allocate a block without initializing it, the pool isn't thread-safe
+ * but the block can be filled from any thread afterwards (see #CustomData_to_bmesh_block).
+ */
+void CustomData_bmesh_alloc_block(CustomData *data, void **block)
 {
 
   if (*block) {
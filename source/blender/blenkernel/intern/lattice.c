@@ -743,6 +743,73 @@ static bool calc_curve_deform(
   return false;
 }
 
+typedef struct CurveDeformUserdata {
+  Object *cuOb;
+  CurveDeform *cd;
+  float (*vert_coords)[3];
+  MDeformVert *dvert;
+  int defgrp_index;
+  short defaxis;
+  /* The coordinates are already in 'cd->curvespace', from calculating the bounds. */
+  bool is_curvespace;
+} CurveDeformUserdata;
+
+static void curve_deform_bounds_task(void *__restrict userdata,
+                                     const int index,
+                                     const TaskParallelTLS *__restrict tls)
+{
+  const CurveDeformUserdata *data = userdata;
+  float(*bounds)[3] = tls->userdata_chunk;
+
+  if (data->dvert == NULL ||
+      defvert_find_weight(&data->dvert[index], data->defgrp_index) > 0.0f) {
+    mul_m4_v3(data->cd->curvespace, data->vert_coords[index]);
+    minmax_v3v3_v3(bounds[0], bounds[1], data->vert_coords[index]);
+  }
+}
+
+static void curve_deform_bounds_finalize(void *__restrict userdata,
+                                         void *__restrict userdata_chunk)
+{
+  const CurveDeformUserdata *data = userdata;
+  float(*bounds)[3] = userdata_chunk;
+
+  minmax_v3v3_v3(data->cd->dmin, data->cd->dmax, bounds[0]);
+  minmax_v3v3_v3(data->cd->dmin, data->cd->dmax, bounds[1]);
+}
+
+static void curve_deform_vert_task(void *__restrict userdata,
+                                   const int index,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const CurveDeformUserdata *data = userdata;
+  CurveDeform *cd = data->cd;
+  float *co = data->vert_coords[index];
+
+  if (data->dvert != NULL) {
+    const float weight = defvert_find_weight(&data->dvert[index], data->defgrp_index);
+
+    if (weight > 0.0f) {
+      float vec[3];
+
+      if (!data->is_curvespace) {
+        mul_m4_v3(cd->curvespace, co);
+      }
+      copy_v3_v3(vec, co);
+      calc_curve_deform(data->cuOb, vec, data->defaxis, cd, NULL);
+      interp_v3_v3v3(co, co, vec, weight);
+      mul_m4_v3(cd->objectspace, co);
+    }
+  }
+  else {
+    if (!data->is_curvespace) {
+      mul_m4_v3(cd->curvespace, co);
+    }
+    calc_curve_deform(data->cuOb, co, data->defaxis, cd, NULL);
+    mul_m4_v3(cd->objectspace, co);
+  }
+}
+
 void curve_deform_verts(Object *cuOb,
                         Object *target,
                         float (*vert_coords)[3],
@@ -752,7 +819,6 @@ void curve_deform_verts(Object *cuOb,
                         short defaxis)
 {
   Curve *cu;
-  int a;
   CurveDeform cd;
   const bool is_neg_axis = (defaxis > 2);
 
@@ -775,71 +841,37 @@ void curve_deform_verts(Object *cuOb,
     cd.dmax[0] = cd.dmax[1] = cd.dmax[2] = 0.0f;
   }
 
-  if (dvert) {
-    MDeformVert *dvert_iter;
-    float vec[3];
-
-    if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-      for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-        const float weight = defvert_find_weight(dvert_iter, defgrp_index);
-
-        if (weight > 0.0f) {
-          mul_m4_v3(cd.curvespace, vert_coords[a]);
-          copy_v3_v3(vec, vert_coords[a]);
-          calc_curve_deform(cuOb, vec, defaxis, &cd, NULL);
-          interp_v3_v3v3(vert_coords[a], vert_coords[a], vec, weight);
-          mul_m4_v3(cd.objectspace, vert_coords[a]);
-        }
-      }
-    }
-    else {
-      /* set mesh min/max bounds */
-      INIT_MINMAX(cd.dmin, cd.dmax);
+  CurveDeformUserdata data = {
+      .cuOb = cuOb,
+      .cd = &cd,
+      .vert_coords = vert_coords,
+      .dvert = dvert,
+      .defgrp_index = defgrp_index,
+      .defaxis = defaxis,
+      .is_curvespace = false,
+  };
 
-      for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-        if (defvert_find_weight(dvert_iter, defgrp_index) > 0.0f) {
-          mul_m4_v3(cd.curvespace, vert_coords[a]);
-          minmax_v3v3_v3(cd.dmin, cd.dmax, vert_coords[a]);
-        }
-      }
+  if ((cu->flag & CU_DEFORM_BOUNDS_OFF) == 0) {
+    /* set mesh min/max bounds, only taking vertices in the group into account */
+    float bounds[2][3];
+    INIT_MINMAX(bounds[0], bounds[1]);
+    INIT_MINMAX(cd.dmin, cd.dmax);
 
-      for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-        const float weight = defvert_find_weight(dvert_iter, defgrp_index);
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+    settings.userdata_chunk = bounds;
+    settings.userdata_chunk_size = sizeof(bounds);
+    settings.func_finalize = curve_deform_bounds_finalize;
+    BLI_task_parallel_range(0, numVerts, &data, curve_deform_bounds_task, &settings);
 
-        if (weight > 0.0f) {
-          /* already in 'cd.curvespace', prev for loop */
-          copy_v3_v3(vec, vert_coords[a]);
-          calc_curve_deform(cuOb, vec, defaxis, &cd, NULL);
-          interp_v3_v3v3(vert_coords[a], vert_coords[a], vec, weight);
-          mul_m4_v3(cd.objectspace, vert_coords[a]);
-        }
-      }
-    }
+    data.is_curvespace = true;
   }
-  else {
-    if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-      for (a = 0; a < numVerts; a++) {
-        mul_m4_v3(cd.curvespace, vert_coords[a]);
-        calc_curve_deform(cuOb, vert_coords[a], defaxis, &cd, NULL);
-        mul_m4_v3(cd.objectspace, vert_coords[a]);
-      }
-    }
-    else {
-      /* set mesh min max bounds */
-      INIT_MINMAX(cd.dmin, cd.dmax);
-
-      for (a = 0; a < numVerts; a++) {
-        mul_m4_v3(cd.curvespace, vert_coords[a]);
-        minmax_v3v3_v3(cd.dmin, cd.dmax, vert_coords[a]);
-      }
 
-      for (a = 0; a < numVerts; a++) {
-        /* already in 'cd.curvespace', prev for loop */
-        calc_curve_deform(cuOb, vert_coords[a], defaxis, &cd, NULL);
-        mul_m4_v3(cd.objectspace, vert_coords[a]);
-      }
-    }
-  }
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 32;
+  BLI_task_parallel_range(0, numVerts, &data, curve_deform_vert_task, &settings);
 }
 
 /* input vec and orco = local coord in armature space */
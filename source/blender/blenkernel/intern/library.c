@@ -79,6 +79,8 @@
 
 #include "BLT_translation.h"
 
+#include "atomic_ops.h"
+
 #include "BKE_action.h"
 #include "BKE_animsys.h"
 #include "BKE_armature.h"
@@ -960,6 +962,7 @@ void BKE_libblock_management_main_add(Main *bmain, void *idv)
   BKE_main_lock(bmain);
   BLI_addtail(lb, id);
   BKE_id_new_name_validate(lb, id, NULL);
+  BKE_libblock_session_uuid_ensure(id);
   /* alphabetic insertion: is in new_id */
   id->tag &= ~(LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT);
   bmain->is_memfile_undo_written = false;
@@ -1246,6 +1249,7 @@ void *BKE_libblock_alloc(Main *bmain, short type, const char *name, const int fl
       BKE_main_lock(bmain);
       BLI_addtail(lb, id);
       BKE_id_new_name_validate(lb, id, name);
+      BKE_libblock_session_uuid_ensure(id);
       bmain->is_memfile_undo_written = false;
       /* alphabetic insertion: is in new_id */
       BKE_main_unlock(bmain);
@@ -1263,6 +1267,33 @@ void *BKE_libblock_alloc(Main *bmain, short type, const char *name, const int fl
   return id;
 }
 
+/* Last session UUID given to an ID, zero is never used. */
+static uint global_session_uuid = 0;
+
+/**
+ * Give the ID an identifier unique in the current session, unless it already has one.
+ * Used to find the same ID again after memfile undo, when its address may have changed.
+ */
+void BKE_libblock_session_uuid_ensure(ID *id)
+{
+  if (id->session_uuid == 0) {
+    id->session_uuid = atomic_add_and_fetch_uint32(&global_session_uuid, 1);
+    /* Skip zero when wrapping around. */
+    if (UNLIKELY(id->session_uuid == 0)) {
+      id->session_uuid = atomic_add_and_fetch_uint32(&global_session_uuid, 1);
+    }
+  }
+}
+
+/**
+ * Give the ID a new session UUID, for IDs read from files.
+ */
+void BKE_libblock_session_uuid_renew(ID *id)
+{
+  id->session_uuid = 0;
+  BKE_libblock_session_uuid_ensure(id);
+}
+
 /**
  * Initialize an ID of given type, such that it has valid 'empty' data.
  * ID is assumed to be just calloc'ed.
@@ -30,19 +30,27 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "DNA_collection_types.h"
 #include "DNA_object_types.h"
 #include "DNA_meta_types.h"
+#include "DNA_particle_types.h"
 #include "DNA_scene_types.h"
 
+#include "BLI_utildefines.h"
+
+#include "BLI_ghash.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
 #include "BLI_string_utils.h"
-#include "BLI_utildefines.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_memarena.h"
 
 #include "BKE_global.h"
 
+#include "BKE_anim.h"
 #include "BKE_displist.h"
+#include "BKE_layer.h"
 #include "BKE_mball_tessellate.h" /* own include */
 #include "BKE_scene.h"
 
@@ -103,6 +111,11 @@ typedef struct MetaballBVHNode { /* BVH node */
   struct MetaballBVHNode *child[2];
 } MetaballBVHNode;
 
+typedef struct NEWVERTEX { /* vertex waiting for its position and normal */
+  const CORNER *c1, *c2;   /* corners of the edge the vertex lies on */
+  unsigned int index;      /* index in the output vertices */
+} NEWVERTEX;
+
 typedef struct process {     /* parameters, storage */
   float thresh, size;        /* mball threshold, single cube size */
   float delta;               /* small delta for calculating normals */
@@ -114,8 +127,7 @@ typedef struct process {     /* parameters, storage */
   MetaballBVHNode metaball_bvh; /* The simplest bvh */
   Box allbb;                    /* Bounding box of all metaelems */
 
-  MetaballBVHNode **bvh_queue; /* Queue used during bvh traversal */
-  unsigned int bvh_queue_size;
+  unsigned int bvh_queue_size; /* Size of the queues used during bvh traversal */
 
   CUBES *cubes;         /* stack of cubes waiting for polygonization */
   CENTERLIST **centers; /* cube center hash table */
@@ -130,6 +142,13 @@ typedef struct process {     /* parameters, storage */
   unsigned int totvertex;   /* memory size */
   unsigned int curvertex;   /* currently added vertices */
 
+  /* Corners and vertices which are added while processing cubes, their density and positions
+   * are computed in parallel once all cubes waiting for polygonization are processed. */
+  CORNER **new_corners;
+  unsigned int new_corners_len, new_corners_mem;
+  NEWVERTEX *new_vertices;
+  unsigned int new_vertices_len, new_vertices_mem;
+
   /* memory allocation from common pool */
   MemArena *pgn_elements;
 } PROCESS;
@@ -138,7 +157,11 @@ typedef struct process {     /* parameters, storage */
 static int vertid(PROCESS *process, const CORNER *c1, const CORNER *c2);
 static void add_cube(PROCESS *process, int i, int j, int k);
 static void make_face(PROCESS *process, int i1, int i2, int i3, int i4);
-static void converge(PROCESS *process, const CORNER *c1, const CORNER *c2, float r_p[3]);
+static void converge(const PROCESS *process,
+                     MetaballBVHNode **bvh_queue,
+                     const CORNER *c1,
+                     const CORNER *c2,
+                     float r_p[3]);
 
 /* ******************* SIMPLE BVH ********************* */
 
@@ -405,25 +428,25 @@ static float densfunc(const MetaElem *ball, float x, float y, float z)
 
 /**
  * Computes density at given position form all metaballs which contain this point in their box.
- * Traverses BVH using a queue.
+ * Traverses BVH using a queue, which is owned by the calling thread.
  */
-static float metaball(PROCESS *process, float x, float y, float z)
+static float metaball(const PROCESS *process, MetaballBVHNode **bvh_queue, float x, float y, float z)
 {
   int i;
   float dens = 0.0f;
   unsigned int front = 0, back = 0;
-  MetaballBVHNode *node;
+  const MetaballBVHNode *node;
 
-  process->bvh_queue[front++] = &process->metaball_bvh;
+  bvh_queue[front++] = (MetaballBVHNode *)&process->metaball_bvh;
 
   while (front != back) {
-    node = process->bvh_queue[back++];
+    node = bvh_queue[back++];
 
     for (i = 0; i < 2; i++) {
       if ((node->bb[i].min[0] <= x) && (node->bb[i].max[0] >= x) && (node->bb[i].min[1] <= y) &&
           (node->bb[i].max[1] >= y) && (node->bb[i].min[2] <= z) && (node->bb[i].max[2] >= z)) {
         if (node->child[i]) {
-          process->bvh_queue[front++] = node->child[i];
+          bvh_queue[front++] = node->child[i];
         }
         else {
           dens += densfunc(node->bb[i].ml, x, y, z);
@@ -442,10 +465,6 @@ static void make_face(PROCESS *process, int i1, int i2, int i3, int i4)
 {
   int *cur;
 
-#ifdef USE_ACCUM_NORMAL
-  float n[3];
-#endif
-
   if (UNLIKELY(process->totindex == process->curindex)) {
     process->totindex += 4096;
     process->indices = MEM_reallocN(process->indices, sizeof(int[4]) * process->totindex);
@@ -459,34 +478,47 @@ static void make_face(PROCESS *process, int i1, int i2, int i3, int i4)
   cur[1] = i2;
   cur[2] = i3;
   cur[3] = i4;
+}
 
 #ifdef USE_ACCUM_NORMAL
-  if (i4 == i3) {
-    normal_tri_v3(n, process->co[i1], process->co[i2], process->co[i3]);
-    accumulate_vertex_normals_v3(process->no[i1],
-                                 process->no[i2],
-                                 process->no[i3],
-                                 NULL,
-                                 n,
-                                 process->co[i1],
-                                 process->co[i2],
-                                 process->co[i3],
-                                 NULL);
-  }
-  else {
-    normal_quad_v3(n, process->co[i1], process->co[i2], process->co[i3], process->co[i4]);
-    accumulate_vertex_normals_v3(process->no[i1],
-                                 process->no[i2],
-                                 process->no[i3],
-                                 process->no[i4],
-                                 n,
-                                 process->co[i1],
-                                 process->co[i2],
-                                 process->co[i3],
-                                 process->co[i4]);
+/**
+ * Accumulates face normals to the vertices, once all vertex positions are computed.
+ */
+static void accumulate_face_normals(PROCESS *process)
+{
+  float n[3];
+
+  for (unsigned int a = 0; a < process->curindex; a++) {
+    const int *cur = process->indices[a];
+    const int i1 = cur[0], i2 = cur[1], i3 = cur[2], i4 = cur[3];
+
+    if (i4 == i3) {
+      normal_tri_v3(n, process->co[i1], process->co[i2], process->co[i3]);
+      accumulate_vertex_normals_v3(process->no[i1],
+                                   process->no[i2],
+                                   process->no[i3],
+                                   NULL,
+                                   n,
+                                   process->co[i1],
+                                   process->co[i2],
+                                   process->co[i3],
+                                   NULL);
+    }
+    else {
+      normal_quad_v3(n, process->co[i1], process->co[i2], process->co[i3], process->co[i4]);
+      accumulate_vertex_normals_v3(process->no[i1],
+                                   process->no[i2],
+                                   process->no[i3],
+                                   process->no[i4],
+                                   n,
+                                   process->co[i1],
+                                   process->co[i2],
+                                   process->co[i3],
+                                   process->co[i4]);
+    }
   }
-#endif
 }
+#endif
 
 /* Frees allocated memory */
 static void freepolygonize(PROCESS *process)
@@ -503,8 +535,11 @@ static void freepolygonize(PROCESS *process)
   if (process->mainb) {
     MEM_freeN(process->mainb);
   }
-  if (process->bvh_queue) {
-    MEM_freeN(process->bvh_queue);
+  if (process->new_corners) {
+    MEM_freeN(process->new_corners);
+  }
+  if (process->new_vertices) {
+    MEM_freeN(process->new_vertices);
   }
   if (process->pgn_elements) {
     BLI_memarena_free(process->pgn_elements);
@@ -530,6 +565,9 @@ static void freepolygonize(PROCESS *process)
 
 static INTLISTS *cubetable[256];
 static char faces[256];
+/* The tables are made by the first polygonization, which can run in any thread. */
+static bool cubetable_is_done = false;
+static ThreadMutex cubetable_lock = BLI_MUTEX_INITIALIZER;
 
 /* edge: LB, LT, LN, LF, RB, RT, RN, RF, BN, BF, TN, TF */
 static int corner1[12] = {
@@ -669,8 +707,8 @@ static void docube(PROCESS *process, CUBE *cube)
 }
 
 /**
- * return corner with the given lattice location
- * set (and cache) its function value
+ * return corner with the given lattice location,
+ * its function value is set by #polygonize_corners_update()
  */
 static CORNER *setcorner(PROCESS *process, int i, int j, int k)
 {
@@ -697,11 +735,18 @@ static CORNER *setcorner(PROCESS *process, int i, int j, int k)
   c->k = k;
   c->co[2] = ((float)k - 0.5f) * process->size;
 
-  c->value = metaball(process, c->co[0], c->co[1], c->co[2]);
+  c->value = 0.0f;
 
   c->next = process->corners[index];
   process->corners[index] = c;
 
+  if (UNLIKELY(process->new_corners_len == process->new_corners_mem)) {
+    process->new_corners_mem += 4096;
+    process->new_corners = MEM_reallocN(process->new_corners,
+                                        sizeof(CORNER *) * process->new_corners_mem);
+  }
+  process->new_corners[process->new_corners_len++] = c;
+
   return c;
 }
 
@@ -753,13 +798,13 @@ static int otherface(int edge, int face)
  */
 static void makecubetable(void)
 {
-  static bool is_done = false;
   int i, e, c, done[12], pos[8];
 
-  if (is_done) {
+  BLI_mutex_lock(&cubetable_lock);
+  if (cubetable_is_done) {
+    BLI_mutex_unlock(&cubetable_lock);
     return;
   }
-  is_done = true;
 
   for (i = 0; i < 256; i++) {
     for (e = 0; e < 12; e++) {
@@ -828,6 +873,9 @@ static void makecubetable(void)
       }
     }
   }
+
+  cubetable_is_done = true;
+  BLI_mutex_unlock(&cubetable_lock);
 }
 
 void BKE_mball_cubeTable_free(void)
@@ -853,6 +901,7 @@ void BKE_mball_cubeTable_free(void)
     }
     cubetable[i] = NULL;
   }
+  cubetable_is_done = false;
 }
 
 /**** Storage ****/
@@ -945,20 +994,30 @@ static int getedge(EDGELIST *table[], int i1, int j1, int k1, int i2, int j2, in
 }
 
 /**
- * Adds a vertex, expands memory if needed.
+ * Adds a vertex lying between two corners, expands memory if needed.
+ * Its position and normal are set by #polygonize_vertices_update().
  */
-static void addtovertices(PROCESS *process, const float v[3], const float no[3])
+static int addtovertices(PROCESS *process, const CORNER *c1, const CORNER *c2)
 {
+  NEWVERTEX *nv;
+
   if (process->curvertex == process->totvertex) {
     process->totvertex += 4096;
     process->co = MEM_reallocN(process->co, process->totvertex * sizeof(float[3]));
     process->no = MEM_reallocN(process->no, process->totvertex * sizeof(float[3]));
   }
 
-  copy_v3_v3(process->co[process->curvertex], v);
-  copy_v3_v3(process->no[process->curvertex], no);
+  if (UNLIKELY(process->new_vertices_len == process->new_vertices_mem)) {
+    process->new_vertices_mem += 4096;
+    process->new_vertices = MEM_reallocN(process->new_vertices,
+                                         sizeof(NEWVERTEX) * process->new_vertices_mem);
+  }
+  nv = &process->new_vertices[process->new_vertices_len++];
+  nv->c1 = c1;
+  nv->c2 = c2;
+  nv->index = process->curvertex;
 
-  process->curvertex++;
+  return (int)process->curvertex++;
 }
 
 #ifndef USE_ACCUM_NORMAL
@@ -967,41 +1026,34 @@ static void addtovertices(PROCESS *process, const float v[3], const float no[3])
  *
  * \note Doesn't do normalization!
  */
-static void vnormal(PROCESS *process, const float point[3], float r_no[3])
+static void vnormal(const PROCESS *process,
+                    MetaballBVHNode **bvh_queue,
+                    const float point[3],
+                    float r_no[3])
 {
   const float delta = process->delta;
-  const float f = metaball(process, point[0], point[1], point[2]);
+  const float f = metaball(process, bvh_queue, point[0], point[1], point[2]);
 
-  r_no[0] = metaball(process, point[0] + delta, point[1], point[2]) - f;
-  r_no[1] = metaball(process, point[0], point[1] + delta, point[2]) - f;
-  r_no[2] = metaball(process, point[0], point[1], point[2] + delta) - f;
+  r_no[0] = metaball(process, bvh_queue, point[0] + delta, point[1], point[2]) - f;
+  r_no[1] = metaball(process, bvh_queue, point[0], point[1] + delta, point[2]) - f;
+  r_no[2] = metaball(process, bvh_queue, point[0], point[1], point[2] + delta) - f;
 }
 #endif /* USE_ACCUM_NORMAL */
 
 /**
  * \return the id of vertex between two corners.
  *
- * If it wasn't previously computed, does #converge() and adds vertex to process.
+ * If it wasn't previously added, adds vertex to process.
  */
 static int vertid(PROCESS *process, const CORNER *c1, const CORNER *c2)
 {
-  float v[3], no[3];
   int vid = getedge(process->edges, c1->i, c1->j, c1->k, c2->i, c2->j, c2->k);
 
   if (vid != -1) {
-    return vid; /* previously computed */
+    return vid; /* previously added */
   }
 
-  converge(process, c1, c2, v); /* position */
-
-#ifdef USE_ACCUM_NORMAL
-  zero_v3(no);
-#else
-  vnormal(process, v, no);
-#endif
-
-  addtovertices(process, v, no); /* save vertex */
-  vid = (int)process->curvertex - 1;
+  vid = addtovertices(process, c1, c2); /* save vertex */
   setedge(process, c1->i, c1->j, c1->k, c2->i, c2->j, c2->k, vid);
 
   return vid;
@@ -1011,7 +1063,11 @@ static int vertid(PROCESS *process, const CORNER *c1, const CORNER *c2)
  * Given two corners, computes approximation of surface intersection point between them.
  * In case of small threshold, do bisection.
  */
-static void converge(PROCESS *process, const CORNER *c1, const CORNER *c2, float r_p[3])
+static void converge(const PROCESS *process,
+                     MetaballBVHNode **bvh_queue,
+                     const CORNER *c1,
+                     const CORNER *c2,
+                     float r_p[3])
 {
   float tmp, dens;
   unsigned int i;
@@ -1033,7 +1089,7 @@ static void converge(PROCESS *process, const CORNER *c1, const CORNER *c2, float
 
   for (i = 0; i < process->converge_res; i++) {
     interp_v3_v3v3(r_p, c1_co, c2_co, 0.5f);
-    dens = metaball(process, r_p[0], r_p[1], r_p[2]);
+    dens = metaball(process, bvh_queue, r_p[0], r_p[1], r_p[2]);
 
     if (dens > 0.0f) {
       c1_value = dens;
@@ -1096,21 +1152,76 @@ static void closest_latice(int r[3], const float pos[3], const float size)
   r[2] = (int)floorf(pos[2] / size + 1.0f);
 }
 
+/* Per thread data of the parallel density computations. */
+typedef struct PolygonizeTLS {
+  MetaballBVHNode **bvh_queue;
+} PolygonizeTLS;
+
+static MetaballBVHNode **polygonize_tls_bvh_queue(const PROCESS *process, PolygonizeTLS *tls)
+{
+  if (tls->bvh_queue == NULL) {
+    tls->bvh_queue = MEM_mallocN(sizeof(MetaballBVHNode *) * process->bvh_queue_size,
+                                 "Metaball BVH Queue");
+  }
+  return tls->bvh_queue;
+}
+
+static void polygonize_tls_finalize(void *__restrict UNUSED(userdata),
+                                    void *__restrict userdata_chunk)
+{
+  PolygonizeTLS *tls = userdata_chunk;
+  if (tls->bvh_queue != NULL) {
+    MEM_freeN(tls->bvh_queue);
+  }
+}
+
+static void polygonize_parallel_range(void *userdata,
+                                      const unsigned int len,
+                                      TaskParallelRangeFunc func)
+{
+  PolygonizeTLS tls = {NULL};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (len > 256);
+  settings.min_iter_per_thread = 64;
+  settings.userdata_chunk = &tls;
+  settings.userdata_chunk_size = sizeof(tls);
+  settings.func_finalize = polygonize_tls_finalize;
+  BLI_task_parallel_range(0, (int)len, userdata, func, &settings);
+}
+
+/* Cubes found by #find_first_points(). */
+typedef struct FIRSTCUBES {
+  int cubes[26][3];
+  unsigned int len;
+} FIRSTCUBES;
+
+typedef struct FirstPointsData {
+  const PROCESS *process;
+  FIRSTCUBES *first_cubes;
+} FirstPointsData;
+
 /**
  * Find at most 26 cubes to start polygonization from.
  */
-static void find_first_points(PROCESS *process, const unsigned int em)
+static void find_first_points(const PROCESS *process,
+                              MetaballBVHNode **bvh_queue,
+                              const unsigned int em,
+                              FIRSTCUBES *r_first)
 {
   const MetaElem *ml;
   int center[3], lbn[3], rtf[3], it[3], dir[3], add[3];
   float tmp[3], a, b;
+  const float size = process->size;
 
   ml = process->mainb[em];
 
   mid_v3_v3v3(tmp, ml->bb->vec[0], ml->bb->vec[6]);
-  closest_latice(center, tmp, process->size);
-  prev_lattice(lbn, ml->bb->vec[0], process->size);
-  next_lattice(rtf, ml->bb->vec[6], process->size);
+  closest_latice(center, tmp, size);
+  prev_lattice(lbn, ml->bb->vec[0], size);
+  next_lattice(rtf, ml->bb->vec[6], size);
+
+  r_first->len = 0;
 
   for (dir[0] = -1; dir[0] <= 1; dir[0]++) {
     for (dir[1] = -1; dir[1] <= 1; dir[1]++) {
@@ -1121,20 +1232,29 @@ static void find_first_points(PROCESS *process, const unsigned int em)
 
         copy_v3_v3_int(it, center);
 
-        b = setcorner(process, it[0], it[1], it[2])->value;
+        /* Same as the value of the corner at it, see #setcorner(). */
+        b = metaball(process,
+                     bvh_queue,
+                     ((float)it[0] - 0.5f) * size,
+                     ((float)it[1] - 0.5f) * size,
+                     ((float)it[2] - 0.5f) * size);
         do {
           it[0] += dir[0];
           it[1] += dir[1];
           it[2] += dir[2];
           a = b;
-          b = setcorner(process, it[0], it[1], it[2])->value;
+          b = metaball(process,
+                       bvh_queue,
+                       ((float)it[0] - 0.5f) * size,
+                       ((float)it[1] - 0.5f) * size,
+                       ((float)it[2] - 0.5f) * size);
 
           if (a * b < 0.0f) {
             add[0] = it[0] - dir[0];
             add[1] = it[1] - dir[1];
             add[2] = it[2] - dir[2];
             DO_MIN(it, add);
-            add_cube(process, add[0], add[1], add[2]);
+            copy_v3_v3_int(r_first->cubes[r_first->len++], add);
             break;
           }
         } while ((it[0] > lbn[0]) && (it[1] > lbn[1]) && (it[2] > lbn[2]) && (it[0] < rtf[0]) &&
@@ -1144,232 +1264,367 @@ static void find_first_points(PROCESS *process, const unsigned int em)
   }
 }
 
+static void find_first_points_task(void *__restrict userdata,
+                                   const int iter,
+                                   const TaskParallelTLS *__restrict tls)
+{
+  FirstPointsData *data = userdata;
+  const PROCESS *process = data->process;
+  MetaballBVHNode **bvh_queue = polygonize_tls_bvh_queue(process, tls->userdata_chunk);
+  find_first_points(process, bvh_queue, (unsigned int)iter, &data->first_cubes[iter]);
+}
+
+static void polygonize_corners_update_task(void *__restrict userdata,
+                                           const int iter,
+                                           const TaskParallelTLS *__restrict tls)
+{
+  PROCESS *process = userdata;
+  MetaballBVHNode **bvh_queue = polygonize_tls_bvh_queue(process, tls->userdata_chunk);
+  CORNER *c = process->new_corners[iter];
+
+  c->value = metaball(process, bvh_queue, c->co[0], c->co[1], c->co[2]);
+}
+
+static void polygonize_vertices_update_task(void *__restrict userdata,
+                                            const int iter,
+                                            const TaskParallelTLS *__restrict tls)
+{
+  PROCESS *process = userdata;
+  MetaballBVHNode **bvh_queue = polygonize_tls_bvh_queue(process, tls->userdata_chunk);
+  const NEWVERTEX *nv = &process->new_vertices[iter];
+
+  converge(process, bvh_queue, nv->c1, nv->c2, process->co[nv->index]); /* position */
+
+#ifdef USE_ACCUM_NORMAL
+  zero_v3(process->no[nv->index]);
+#else
+  vnormal(process, bvh_queue, process->co[nv->index], process->no[nv->index]);
+#endif
+}
+
+/**
+ * Computes the density at all corners added since the last update.
+ */
+static void polygonize_corners_update(PROCESS *process)
+{
+  polygonize_parallel_range(process, process->new_corners_len, polygonize_corners_update_task);
+  process->new_corners_len = 0;
+}
+
+/**
+ * Computes the position and normal of all vertices added since the last update.
+ */
+static void polygonize_vertices_update(PROCESS *process)
+{
+  polygonize_parallel_range(process, process->new_vertices_len, polygonize_vertices_update_task);
+  process->new_vertices_len = 0;
+}
+
 /**
  * The main polygonization proc.
  * Allocates memory, makes cubetable,
  * finds starting surface points
  * and processes cubes on the stack until none left.
+ *
+ * Cubes are processed in fronts: all cubes waiting on the stack are polygonized one after
+ * another, which adds the neighboring cubes for the next front. Looking up and adding corners,
+ * edges and faces is cheap and done in order, so the result does not depend on threading. The
+ * densities of the new corners and the positions of the new vertices, which is where the time
+ * goes, are computed in parallel between the fronts.
  */
 static void polygonize(PROCESS *process)
 {
-  CUBE c;
-  unsigned int i;
+  FirstPointsData first_points_data;
+  CUBES *cubes;
+  unsigned int i, j;
 
   process->centers = MEM_callocN(HASHSIZE * sizeof(CENTERLIST *), "mbproc->centers");
   process->corners = MEM_callocN(HASHSIZE * sizeof(CORNER *), "mbproc->corners");
   process->edges = MEM_callocN(2 * HASHSIZE * sizeof(EDGELIST *), "mbproc->edges");
-  process->bvh_queue = MEM_callocN(sizeof(MetaballBVHNode *) * process->bvh_queue_size,
-                                   "Metaball BVH Queue");
 
   makecubetable();
 
+  first_points_data.process = process;
+  first_points_data.first_cubes = MEM_mallocN(sizeof(FIRSTCUBES) * process->totelem,
+                                              "Metaball first cubes");
+  polygonize_parallel_range(&first_points_data, process->totelem, find_first_points_task);
   for (i = 0; i < process->totelem; i++) {
-    find_first_points(process, i);
+    const FIRSTCUBES *first = &first_points_data.first_cubes[i];
+    for (j = 0; j < first->len; j++) {
+      add_cube(process, first->cubes[j][0], first->cubes[j][1], first->cubes[j][2]);
+    }
   }
+  MEM_freeN(first_points_data.first_cubes);
 
   while (process->cubes != NULL) {
-    c = process->cubes->cube;
-    process->cubes = process->cubes->next;
+    polygonize_corners_update(process);
+
+    cubes = process->cubes;
+    process->cubes = NULL;
+    for (; cubes != NULL; cubes = cubes->next) {
+      docube(process, &cubes->cube);
+    }
+
+    polygonize_vertices_update(process);
+  }
 
-    docube(process, &c);
+#ifdef USE_ACCUM_NORMAL
+  accumulate_face_normals(process);
+#endif
+}
+
+/**
+ * Whether the object is a metaball of the family with the given base name.
+ */
+static bool is_family_metaball(const Object *ob, const char *basisname)
+{
+  char name[MAX_ID_NAME];
+  int nr;
+
+  if (ob->type != OB_MBALL) {
+    return false;
   }
+  BLI_split_name_num(name, &nr, ob->id.name + 2, '.');
+  return STREQ(name, basisname);
 }
 
 /**
- * Iterates over ALL objects in the scene and all of its sets, including
- * making all duplis(not only metas). Copies metas to mainb array.
- * Computes bounding boxes for building BVH. */
-static void init_meta(Depsgraph *depsgraph, PROCESS *process, Scene *scene, Object *ob)
+ * Whether the particles of the object instance metaballs of the family.
+ */
+static bool particles_instance_family(const Object *ob, const char *basisname)
 {
-  Scene *sce_iter = scene;
-  Base *base;
-  Object *bob;
-  MetaBall *mb;
+  LISTBASE_FOREACH (const ParticleSystem *, psys, &ob->particlesystem) {
+    const ParticleSettings *part = psys->part;
+    if (part->ren_as == PART_DRAW_OB && part->instance_object != NULL) {
+      if (is_family_metaball(part->instance_object, basisname)) {
+        return true;
+      }
+    }
+    else if (part->ren_as == PART_DRAW_GR && part->instance_collection != NULL) {
+      LISTBASE_FOREACH (const CollectionObject *, cob, &part->instance_collection->gobject) {
+        if (is_family_metaball(cob->ob, basisname)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Copies the visible elements of a metaball of the family to mainb array.
+ * The matrix is the world space matrix of the metaball object or its instance.
+ */
+static void init_meta_object(PROCESS *process,
+                             const float obinv[4][4],
+                             const Object *bob,
+                             const float bob_mat[4][4])
+{
+  const MetaBall *mb = bob->data;
   const MetaElem *ml;
-  float obinv[4][4], obmat[4][4];
   unsigned int i;
-  int obnr, zero_size = 0;
-  char obname[MAX_ID_NAME];
-  SceneBaseIter iter;
-
-  copy_m4_m4(obmat, ob->obmat); /* to cope with duplicators from BKE_scene_base_iter_next */
-  invert_m4_m4(obinv, ob->obmat);
 
-  BLI_split_name_num(obname, &obnr, ob->id.name + 2, '.');
-
-  /* make main array */
-  BKE_scene_base_iter_next(depsgraph, &iter, &sce_iter, 0, NULL, NULL);
-  while (BKE_scene_base_iter_next(depsgraph, &iter, &sce_iter, 1, &base, &bob)) {
-    if (bob->type == OB_MBALL) {
-      zero_size = 0;
-      ml = NULL;
+  /* when metaball object has zero scale, then MetaElem to this MetaBall
+   * will not be put to mainb array */
+  if (has_zero_axis_m4(bob_mat)) {
+    return;
+  }
+  for (const Object *pob = bob->parent; pob; pob = pob->parent) {
+    if (has_zero_axis_m4(pob->obmat)) {
+      return;
+    }
+  }
 
-      if (bob == ob && (base->flag_legacy & OB_FROMDUPLI) == 0) {
-        mb = ob->data;
+  if (mb->editelems) {
+    ml = mb->editelems->first;
+  }
+  else {
+    ml = mb->elems.first;
+  }
 
-        if (mb->editelems) {
-          ml = mb->editelems->first;
-        }
-        else {
-          ml = mb->elems.first;
-        }
+  while (ml) {
+    if (!(ml->flag & MB_HIDE)) {
+      float pos[4][4], rot[4][4];
+      float expx, expy, expz;
+      float tempmin[3], tempmax[3];
+
+      MetaElem *new_ml;
+
+      /* make a copy because of duplicates */
+      new_ml = BLI_memarena_alloc(process->pgn_elements, sizeof(MetaElem));
+      *(new_ml) = *ml;
+      new_ml->bb = BLI_memarena_alloc(process->pgn_elements, sizeof(BoundBox));
+      new_ml->mat = BLI_memarena_alloc(process->pgn_elements, 4 * 4 * sizeof(float));
+      new_ml->imat = BLI_memarena_alloc(process->pgn_elements, 4 * 4 * sizeof(float));
+
+      /* too big stiffness seems only ugly due to linear interpolation
+       * no need to have possibility for too big stiffness */
+      if (ml->s > 10.0f) {
+        new_ml->s = 10.0f;
       }
       else {
-        char name[MAX_ID_NAME];
-        int nr;
-
-        BLI_split_name_num(name, &nr, bob->id.name + 2, '.');
-        if (STREQ(obname, name)) {
-          mb = bob->data;
+        new_ml->s = ml->s;
+      }
 
-          if (mb->editelems) {
-            ml = mb->editelems->first;
-          }
-          else {
-            ml = mb->elems.first;
-          }
-        }
+      /* if metaball is negative, set stiffness negative */
+      if (new_ml->flag & MB_NEGATIVE) {
+        new_ml->s = -new_ml->s;
       }
 
-      /* when metaball object has zero scale, then MetaElem to this MetaBall
-       * will not be put to mainb array */
-      if (has_zero_axis_m4(bob->obmat)) {
-        zero_size = 1;
+      /* Translation of MetaElem */
+      unit_m4(pos);
+      pos[3][0] = ml->x;
+      pos[3][1] = ml->y;
+      pos[3][2] = ml->z;
+
+      /* Rotation of MetaElem is stored in quat */
+      quat_to_mat4(rot, ml->quat);
+
+      /* Matrix multiply is as follows:
+       *   basis object space ->
+       *   world ->
+       *   ml object space ->
+       *   position ->
+       *   rotation ->
+       *   ml local space
+       */
+      mul_m4_series((float(*)[4])new_ml->mat, obinv, bob_mat, pos, rot);
+      /* ml local space -> basis object space */
+      invert_m4_m4((float(*)[4])new_ml->imat, (float(*)[4])new_ml->mat);
+
+      /* rad2 is inverse of squared radius */
+      new_ml->rad2 = 1 / (ml->rad * ml->rad);
+
+      /* initial dimensions = radius */
+      expx = ml->rad;
+      expy = ml->rad;
+      expz = ml->rad;
+
+      switch (ml->type) {
+        case MB_BALL:
+          break;
+        case MB_CUBE: /* cube is "expanded" by expz, expy and expx */
+          expz += ml->expz;
+          ATTR_FALLTHROUGH;
+        case MB_PLANE: /* plane is "expanded" by expy and expx */
+          expy += ml->expy;
+          ATTR_FALLTHROUGH;
+        case MB_TUBE: /* tube is "expanded" by expx */
+          expx += ml->expx;
+          break;
+        case MB_ELIPSOID: /* ellipsoid is "stretched" by exp* */
+          expx *= ml->expx;
+          expy *= ml->expy;
+          expz *= ml->expz;
+          break;
       }
-      else if (bob->parent) {
-        struct Object *pob = bob->parent;
-        while (pob) {
-          if (has_zero_axis_m4(pob->obmat)) {
-            zero_size = 1;
-            break;
-          }
-          pob = pob->parent;
-        }
+
+      /* untransformed Bounding Box of MetaElem */
+      /* TODO, its possible the elem type has been changed and the exp*
+       * values can use a fallback. */
+      copy_v3_fl3(new_ml->bb->vec[0], -expx, -expy, -expz); /* 0 */
+      copy_v3_fl3(new_ml->bb->vec[1], +expx, -expy, -expz); /* 1 */
+      copy_v3_fl3(new_ml->bb->vec[2], +expx, +expy, -expz); /* 2 */
+      copy_v3_fl3(new_ml->bb->vec[3], -expx, +expy, -expz); /* 3 */
+      copy_v3_fl3(new_ml->bb->vec[4], -expx, -expy, +expz); /* 4 */
+      copy_v3_fl3(new_ml->bb->vec[5], +expx, -expy, +expz); /* 5 */
+      copy_v3_fl3(new_ml->bb->vec[6], +expx, +expy, +expz); /* 6 */
+      copy_v3_fl3(new_ml->bb->vec[7], -expx, +expy, +expz); /* 7 */
+
+      /* transformation of Metalem bb */
+      for (i = 0; i < 8; i++) {
+        mul_m4_v3((float(*)[4])new_ml->mat, new_ml->bb->vec[i]);
       }
 
-      if (zero_size) {
-        while (ml) {
-          ml = ml->next;
-        }
+      /* find max and min of transformed bb */
+      INIT_MINMAX(tempmin, tempmax);
+      for (i = 0; i < 8; i++) {
+        DO_MINMAX(new_ml->bb->vec[i], tempmin, tempmax);
       }
-      else {
-        while (ml) {
-          if (!(ml->flag & MB_HIDE)) {
-            float pos[4][4], rot[4][4];
-            float expx, expy, expz;
-            float tempmin[3], tempmax[3];
-
-            MetaElem *new_ml;
-
-            /* make a copy because of duplicates */
-            new_ml = BLI_memarena_alloc(process->pgn_elements, sizeof(MetaElem));
-            *(new_ml) = *ml;
-            new_ml->bb = BLI_memarena_alloc(process->pgn_elements, sizeof(BoundBox));
-            new_ml->mat = BLI_memarena_alloc(process->pgn_elements, 4 * 4 * sizeof(float));
-            new_ml->imat = BLI_memarena_alloc(process->pgn_elements, 4 * 4 * sizeof(float));
-
-            /* too big stiffness seems only ugly due to linear interpolation
-             * no need to have possibility for too big stiffness */
-            if (ml->s > 10.0f) {
-              new_ml->s = 10.0f;
-            }
-            else {
-              new_ml->s = ml->s;
-            }
 
-            /* if metaball is negative, set stiffness negative */
-            if (new_ml->flag & MB_NEGATIVE) {
-              new_ml->s = -new_ml->s;
-            }
+      /* set only point 0 and 6 - AABB of Metaelem */
+      copy_v3_v3(new_ml->bb->vec[0], tempmin);
+      copy_v3_v3(new_ml->bb->vec[6], tempmax);
 
-            /* Translation of MetaElem */
-            unit_m4(pos);
-            pos[3][0] = ml->x;
-            pos[3][1] = ml->y;
-            pos[3][2] = ml->z;
-
-            /* Rotation of MetaElem is stored in quat */
-            quat_to_mat4(rot, ml->quat);
-
-            /* Matrix multiply is as follows:
-             *   basis object space ->
-             *   world ->
-             *   ml object space ->
-             *   position ->
-             *   rotation ->
-             *   ml local space
-             */
-            mul_m4_series((float(*)[4])new_ml->mat, obinv, bob->obmat, pos, rot);
-            /* ml local space -> basis object space */
-            invert_m4_m4((float(*)[4])new_ml->imat, (float(*)[4])new_ml->mat);
-
-            /* rad2 is inverse of squared radius */
-            new_ml->rad2 = 1 / (ml->rad * ml->rad);
-
-            /* initial dimensions = radius */
-            expx = ml->rad;
-            expy = ml->rad;
-            expz = ml->rad;
-
-            switch (ml->type) {
-              case MB_BALL:
-                break;
-              case MB_CUBE: /* cube is "expanded" by expz, expy and expx */
-                expz += ml->expz;
-                ATTR_FALLTHROUGH;
-              case MB_PLANE: /* plane is "expanded" by expy and expx */
-                expy += ml->expy;
-                ATTR_FALLTHROUGH;
-              case MB_TUBE: /* tube is "expanded" by expx */
-                expx += ml->expx;
-                break;
-              case MB_ELIPSOID: /* ellipsoid is "stretched" by exp* */
-                expx *= ml->expx;
-                expy *= ml->expy;
-                expz *= ml->expz;
-                break;
-            }
+      /* add new_ml to mainb[] */
+      if (UNLIKELY(process->totelem == process->mem)) {
+        process->mem = process->mem * 2 + 10;
+        process->mainb = MEM_reallocN(process->mainb, sizeof(MetaElem *) * process->mem);
+      }
+      process->mainb[process->totelem++] = new_ml;
+    }
+    ml = ml->next;
+  }
+}
 
-            /* untransformed Bounding Box of MetaElem */
-            /* TODO, its possible the elem type has been changed and the exp*
-             * values can use a fallback. */
-            copy_v3_fl3(new_ml->bb->vec[0], -expx, -expy, -expz); /* 0 */
-            copy_v3_fl3(new_ml->bb->vec[1], +expx, -expy, -expz); /* 1 */
-            copy_v3_fl3(new_ml->bb->vec[2], +expx, +expy, -expz); /* 2 */
-            copy_v3_fl3(new_ml->bb->vec[3], -expx, +expy, -expz); /* 3 */
-            copy_v3_fl3(new_ml->bb->vec[4], -expx, -expy, +expz); /* 4 */
-            copy_v3_fl3(new_ml->bb->vec[5], +expx, -expy, +expz); /* 5 */
-            copy_v3_fl3(new_ml->bb->vec[6], +expx, +expy, +expz); /* 6 */
-            copy_v3_fl3(new_ml->bb->vec[7], -expx, +expy, +expz); /* 7 */
-
-            /* transformation of Metalem bb */
-            for (i = 0; i < 8; i++) {
-              mul_m4_v3((float(*)[4])new_ml->mat, new_ml->bb->vec[i]);
-            }
+/**
+ * Iterates over all objects in the scene and all of its sets, including the instances of
+ * duplicators which can instance metaballs of the family. Copies metas to mainb array.
+ * Computes bounding boxes for building BVH.
+ *
+ * The dependency graph evaluates the family metaballs and the geometry and transform of these
+ * duplicators before the basis. Bases instancing through the same particle systems are evaluated
+ * one after another, since building the instance list writes to the particle systems. So this can
+ * run in parallel with the evaluation of other objects.
+ */
+static void init_meta(Depsgraph *depsgraph, PROCESS *process, Scene *scene, Object *ob)
+{
+  ViewLayer *view_layer = DEG_get_evaluated_view_layer(depsgraph);
+  GSet *family_parents = BLI_gset_ptr_new(__func__);
+  float obinv[4][4];
+  unsigned int i;
+  int obnr;
+  char obname[MAX_ID_NAME];
 
-            /* find max and min of transformed bb */
-            INIT_MINMAX(tempmin, tempmax);
-            for (i = 0; i < 8; i++) {
-              DO_MINMAX(new_ml->bb->vec[i], tempmin, tempmax);
-            }
+  invert_m4_m4(obinv, ob->obmat);
 
-            /* set only point 0 and 6 - AABB of Metaelem */
-            copy_v3_v3(new_ml->bb->vec[0], tempmin);
-            copy_v3_v3(new_ml->bb->vec[6], tempmax);
+  BLI_split_name_num(obname, &obnr, ob->id.name + 2, '.');
 
-            /* add new_ml to mainb[] */
-            if (UNLIKELY(process->totelem == process->mem)) {
-              process->mem = process->mem * 2 + 10;
-              process->mainb = MEM_reallocN(process->mainb, sizeof(MetaElem *) * process->mem);
-            }
-            process->mainb[process->totelem++] = new_ml;
+  /* Vertex and face duplicators instance their children. */
+  for (Scene *sce_iter = scene; sce_iter; sce_iter = sce_iter->set) {
+    ViewLayer *view_layer_iter = (sce_iter == scene) ? view_layer :
+                                                       BKE_view_layer_default_render(sce_iter);
+    LISTBASE_FOREACH (Base *, base, &view_layer_iter->object_bases) {
+      Object *bob = base->object;
+      if (bob->parent != NULL && is_family_metaball(bob, obname)) {
+        BLI_gset_add(family_parents, bob->parent);
+      }
+    }
+  }
+
+  /* make main array */
+  for (Scene *sce_iter = scene; sce_iter; sce_iter = sce_iter->set) {
+    ViewLayer *view_layer_iter = (sce_iter == scene) ? view_layer :
+                                                       BKE_view_layer_default_render(sce_iter);
+    LISTBASE_FOREACH (Base *, base, &view_layer_iter->object_bases) {
+      Object *bob = base->object;
+      bool has_duplis = false;
+
+      /* collections cannot be duplicated for metaballs yet, this enters eternal loop because of
+       * BKE_displist_make_mball() getting called inside of collection_duplilist */
+      if ((bob->transflag & OB_DUPLI) && bob->instance_collection == NULL &&
+          (((bob->transflag & (OB_DUPLIVERTS | OB_DUPLIFACES)) &&
+            BLI_gset_haskey(family_parents, bob)) ||
+           ((bob->transflag & OB_DUPLIPARTS) && particles_instance_family(bob, obname)))) {
+        ListBase *duplilist = object_duplilist(depsgraph, sce_iter, bob);
+        LISTBASE_FOREACH (DupliObject *, dob, duplilist) {
+          has_duplis = true;
+          if (is_family_metaball(dob->ob, obname)) {
+            init_meta_object(process, obinv, dob->ob, dob->mat);
           }
-          ml = ml->next;
         }
+        free_object_duplilist(duplilist);
+      }
+
+      /* Duplicators are replaced by their instances. */
+      if (!has_duplis && is_family_metaball(bob, obname)) {
+        init_meta_object(process, obinv, bob, bob->obmat);
       }
     }
   }
 
+  BLI_gset_free(family_parents, NULL);
+
   /* compute AABB of all Metaelems */
   if (process->totelem > 0) {
     copy_v3_v3(process->allbb.min, process->mainb[0]->bb->vec[0]);
@@ -0,0 +1,2305 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup bke
+ *
+ * Boolean operations on the arrays of two meshes, without converting them to BMesh.
+ *
+ * All decisions are made with exact predicates: orientation tests are evaluated in floating
+ * point, and only computed exactly when the rounding error could change their sign.
+ * Operand B is translated by an infinitesimal offset (simulation of simplicity), so none of
+ * the tests used are ever zero. Coplanar faces, edges crossing each other and vertices lying on
+ * the other operand are all resolved consistently, as if the operands were in general position.
+ *
+ * - Triangle pairs of the two operands are found by overlapping their BVH trees in parallel,
+ *   pairs which don't intersect are rejected by the overlap callback.
+ * - Each intersecting pair gives a segment between two points, each one an edge of one triangle
+ *   crossing the other triangle. A point is identified by that edge and triangle, so all
+ *   triangles using the edge get the same point.
+ * - Triangles are split along their segments in parallel, with a constrained triangulation.
+ * - The pieces are grouped in patches bounded by the segments. Each patch is classified inside
+ *   or outside of the other operand in parallel, from the parity of the crossings of a ray.
+ * - Pieces of a face in the same patch are joined back into one face when they form a simple
+ *   polygon. Faces which aren't intersected are copied as they are.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#include "BLI_bitmap.h"
+#include "BLI_delaunay_2d.h"
+#include "BLI_edgehash.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math.h"
+#include "BLI_sort.h"
+#include "BLI_task.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_boolean.h"
+
+/* -------------------------------------------------------------------- */
+/** \name Exact Predicates
+ *
+ * Exact values are kept as expansions, sums of non-overlapping doubles, see "Adaptive Precision
+ * Floating-Point Arithmetic and Fast Robust Geometric Predicates" by Jonathan Richard Shewchuk.
+ * The error bounds of the floating point evaluation are the ones derived there.
+ * \{ */
+
+/** 2^27 + 1, splits a double in two halves of 26 bits for #two_product. */
+#define EXACT_SPLITTER 134217729.0
+/** 2^-53, the relative error of one rounded operation. */
+#define EXACT_EPSILON 1.1102230246251565e-16
+#define ERRBOUND_ORIENT2D ((3.0 + 16.0 * EXACT_EPSILON) * EXACT_EPSILON)
+#define ERRBOUND_ORIENT3D ((7.0 + 56.0 * EXACT_EPSILON) * EXACT_EPSILON)
+
+/** Each product of three doubles adds four terms, #orient3d_exact adds 24 products. */
+#define EXACT_SUM_MAX 96
+
+typedef struct ExactSum {
+  /** Terms of increasing magnitude, the last one has the sign of the sum. */
+  double terms[EXACT_SUM_MAX];
+  int len;
+} ExactSum;
+
+BLI_INLINE void two_sum(const double a, const double b, double *r_x, double *r_y)
+{
+  const double x = a + b;
+  const double b_virt = x - a;
+  const double a_virt = x - b_virt;
+  *r_x = x;
+  *r_y = (a - a_virt) + (b - b_virt);
+}
+
+BLI_INLINE void split(const double a, double *r_hi, double *r_lo)
+{
+  const double c = EXACT_SPLITTER * a;
+  *r_hi = c - (c - a);
+  *r_lo = a - *r_hi;
+}
+
+BLI_INLINE void two_product(const double a, const double b, double *r_x, double *r_y)
+{
+  double a_hi, a_lo, b_hi, b_lo;
+  const double x = a * b;
+  split(a, &a_hi, &a_lo);
+  split(b, &b_hi, &b_lo);
+  const double err = ((x - a_hi * b_hi) - a_lo * b_hi) - a_hi * b_lo;
+  *r_x = x;
+  *r_y = a_lo * b_lo - err;
+}
+
+/** Add \a b to the sum, dropping the terms which are zero. */
+static void exact_sum_add(ExactSum *sum, const double b)
+{
+  double q = b;
+  int len = 0;
+  for (int i = 0; i < sum->len; i++) {
+    double h;
+    two_sum(q, sum->terms[i], &q, &h);
+    if (h != 0.0) {
+      sum->terms[len++] = h;
+    }
+  }
+  if (q != 0.0 || len == 0) {
+    sum->terms[len++] = q;
+  }
+  sum->len = len;
+}
+
+static void exact_sum_add_product(ExactSum *sum, const double a, const double b)
+{
+  double x, y;
+  two_product(a, b, &x, &y);
+  exact_sum_add(sum, y);
+  exact_sum_add(sum, x);
+}
+
+static void exact_sum_add_product3(ExactSum *sum, const double a, const double b, const double c)
+{
+  double x, y, t_x, t_y;
+  two_product(a, b, &x, &y);
+  two_product(y, c, &t_x, &t_y);
+  exact_sum_add(sum, t_y);
+  exact_sum_add(sum, t_x);
+  two_product(x, c, &t_x, &t_y);
+  exact_sum_add(sum, t_y);
+  exact_sum_add(sum, t_x);
+}
+
+/** Add \a sign times the triple product p . (q x r). */
+static void exact_sum_add_triple(
+    ExactSum *sum, const double p[3], const double q[3], const double r[3], const double sign)
+{
+  for (int i = 0; i < 3; i++) {
+    const int j = (i + 1) % 3;
+    const int k = (i + 2) % 3;
+    exact_sum_add_product3(sum, sign * p[i], q[j], r[k]);
+    exact_sum_add_product3(sum, -sign * p[i], q[k], r[j]);
+  }
+}
+
+static int exact_sum_sign(const ExactSum *sum)
+{
+  const double top = sum->terms[sum->len - 1];
+  return (top > 0.0) - (top < 0.0);
+}
+
+static int orient3d_exact(const double a[3], const double b[3], const double c[3], const double d[3])
+{
+  /* det[b - a, c - a, d - a] expanded in triple products of the points themselves,
+   * which only need exact products and sums. */
+  ExactSum sum;
+  sum.len = 0;
+  exact_sum_add_triple(&sum, b, c, d, 1.0);
+  exact_sum_add_triple(&sum, a, b, c, -1.0);
+  exact_sum_add_triple(&sum, a, b, d, 1.0);
+  exact_sum_add_triple(&sum, a, c, d, -1.0);
+  return exact_sum_sign(&sum);
+}
+
+/**
+ * Sign of det[b - a, c - a, d - a]: positive when \a d is on the side of the plane of the
+ * triangle (a, b, c) its normal points to (the corners in counter-clockwise order).
+ */
+static int orient3d(const double a[3], const double b[3], const double c[3], const double d[3])
+{
+  const double ba[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  const double ca[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  const double da[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+  const double t0 = ca[1] * da[2];
+  const double t1 = ca[2] * da[1];
+  const double t2 = ca[2] * da[0];
+  const double t3 = ca[0] * da[2];
+  const double t4 = ca[0] * da[1];
+  const double t5 = ca[1] * da[0];
+  const double det = ba[0] * (t0 - t1) + ba[1] * (t2 - t3) + ba[2] * (t4 - t5);
+  const double permanent = (fabs(t0) + fabs(t1)) * fabs(ba[0]) +
+                           (fabs(t2) + fabs(t3)) * fabs(ba[1]) +
+                           (fabs(t4) + fabs(t5)) * fabs(ba[2]);
+  const double errbound = ERRBOUND_ORIENT3D * permanent;
+  if (det > errbound) {
+    return 1;
+  }
+  if (-det > errbound) {
+    return -1;
+  }
+  return orient3d_exact(a, b, c, d);
+}
+
+/**
+ * Sign of the cross product of (u1 - u0) and (w1 - w0) projected on the axes \a i and \a j.
+ */
+static int cross2(const double u0[3],
+                  const double u1[3],
+                  const double w0[3],
+                  const double w1[3],
+                  const int i,
+                  const int j)
+{
+  const double l = (u1[i] - u0[i]) * (w1[j] - w0[j]);
+  const double r = (u1[j] - u0[j]) * (w1[i] - w0[i]);
+  const double det = l - r;
+  const double errbound = ERRBOUND_ORIENT2D * (fabs(l) + fabs(r));
+  if (det > errbound) {
+    return 1;
+  }
+  if (-det > errbound) {
+    return -1;
+  }
+
+  ExactSum sum;
+  sum.len = 0;
+  exact_sum_add_product(&sum, u1[i], w1[j]);
+  exact_sum_add_product(&sum, -u1[i], w0[j]);
+  exact_sum_add_product(&sum, -u0[i], w1[j]);
+  exact_sum_add_product(&sum, u0[i], w0[j]);
+  exact_sum_add_product(&sum, -u1[j], w1[i]);
+  exact_sum_add_product(&sum, u1[j], w0[i]);
+  exact_sum_add_product(&sum, u0[j], w1[i]);
+  exact_sum_add_product(&sum, -u0[j], w0[i]);
+  return exact_sum_sign(&sum);
+}
+
+/**
+ * Sign of the first non-zero component of the cross product (u1 - u0) x (w1 - w0),
+ * zero when they are parallel.
+ */
+static int cross3_first_sign(const double u0[3],
+                             const double u1[3],
+                             const double w0[3],
+                             const double w1[3])
+{
+  for (int k = 0; k < 3; k++) {
+    const int sign = cross2(u0, u1, w0, w1, (k + 1) % 3, (k + 2) % 3);
+    if (sign != 0) {
+      return sign;
+    }
+  }
+  return 0;
+}
+
+static bool tri_is_degenerate(const double a[3], const double b[3], const double c[3])
+{
+  return cross3_first_sign(a, b, a, c) == 0;
+}
+
+/**
+ * #orient3d of a point of one operand and a triangle of the other. Operand B is translated by
+ * (e, e^2, e^3) for an infinitesimal e, so a point on the plane is moved along the normal
+ * of the triangle, the result is only zero when the triangle has no area.
+ *
+ * \param d_is_b: The point is from operand B, otherwise the triangle is.
+ */
+static int orient3d_sos(
+    const double a[3], const double b[3], const double c[3], const double d[3], const bool d_is_b)
+{
+  const int sign = orient3d(a, b, c, d);
+  if (sign != 0) {
+    return sign;
+  }
+  const int sign_normal = cross3_first_sign(a, b, a, c);
+  return d_is_b ? sign_normal : -sign_normal;
+}
+
+/**
+ * #orient3d of the line (p0, p1) and the line (q0, q1), from different operands, with the same
+ * translation of operand B as #orient3d_sos. The result is only zero for parallel lines.
+ *
+ * \param q_is_b: The second line is from operand B, otherwise the first one is.
+ */
+static int orient3d_lines_sos(const double p0[3],
+                              const double p1[3],
+                              const double q0[3],
+                              const double q1[3],
+                              const bool q_is_b)
+{
+  const int sign = orient3d(p0, p1, q0, q1);
+  if (sign != 0) {
+    return sign;
+  }
+  /* The derivative along the translation is its dot product with (p1 - p0) x (q0 - q1). */
+  const int sign_cross = cross3_first_sign(p0, p1, q1, q0);
+  return q_is_b ? sign_cross : -sign_cross;
+}
+
+/**
+ * Whether the line (p0, p1) passes inside of the triangle \a tri_co of the other operand.
+ */
+static bool line_crosses_tri(const double *tri_co[3],
+                             const double p0[3],
+                             const double p1[3],
+                             const bool line_is_b)
+{
+  const int s0 = orient3d_lines_sos(tri_co[0], tri_co[1], p0, p1, line_is_b);
+  if (s0 == 0) {
+    return false;
+  }
+  const int s1 = orient3d_lines_sos(tri_co[1], tri_co[2], p0, p1, line_is_b);
+  if (s0 != s1) {
+    return false;
+  }
+  return s0 == orient3d_lines_sos(tri_co[2], tri_co[0], p0, p1, line_is_b);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Operands
+ * \{ */
+
+typedef struct BoolTri {
+  /** Vertices, the ones of operand B follow the ones of operand A. */
+  int v[3];
+  /** Face the triangle is part of, the faces of operand B follow the ones of operand A. */
+  int poly;
+} BoolTri;
+
+/** Point where an edge of one operand crosses a triangle of the other one. */
+typedef struct BoolPointKey {
+  /** Vertices of the edge, the lowest first. */
+  int v[2];
+  /** Triangle of the other operand, -1 for points added by the triangulation. */
+  int tri;
+} BoolPointKey;
+
+typedef struct BoolPoint {
+  BoolPointKey key;
+  /** Vertices of the operand the point interpolates and their weights, -1 when unused. */
+  int v[3];
+  float w[3];
+} BoolPoint;
+
+typedef struct BoolSegment {
+  /** Triangles of operand A and B. */
+  int tri[2];
+  BoolPointKey key[2];
+  /** Indices of the points of #key. */
+  int point[2];
+} BoolSegment;
+
+typedef struct BoolState {
+  const Mesh *mesh[2];
+  /** Offsets of the elements of operand B in the arrays of both operands. */
+  int vert_offset_b;
+  int loop_offset_b;
+  int poly_offset_b;
+  int tri_offset_b;
+  /** Vertices of the operands, in the space of operand A, followed by the new points. */
+  double (*co)[3];
+  int verts_len;
+  int points_len;
+  /** New points, from #verts_len onward. */
+  BoolPoint *points;
+  BoolTri *tris;
+  int tris_len;
+  /** Trees of the triangles of each operand, triangles without any area are left out. */
+  BVHTree *tree[2];
+  /** Length of the diagonal of the bounds of both operands. */
+  double size;
+} BoolState;
+
+BLI_INLINE int bool_vert_side(const BoolState *s, const int v)
+{
+  return v >= s->vert_offset_b;
+}
+
+BLI_INLINE int bool_tri_side(const BoolState *s, const int tri)
+{
+  return tri >= s->tri_offset_b;
+}
+
+static void bool_state_init(BoolState *s,
+                            const Mesh *mesh_a,
+                            const Mesh *mesh_b,
+                            const float mat_b[4][4])
+{
+  memset(s, 0, sizeof(*s));
+  s->mesh[0] = mesh_a;
+  s->mesh[1] = mesh_b;
+  s->vert_offset_b = mesh_a->totvert;
+  s->loop_offset_b = mesh_a->totloop;
+  s->poly_offset_b = mesh_a->totpoly;
+  s->verts_len = s->points_len = mesh_a->totvert + mesh_b->totvert;
+
+  double mat_b_db[4][4];
+  copy_m4d_m4(mat_b_db, mat_b);
+
+  s->co = MEM_malloc_arrayN((size_t)s->verts_len, sizeof(*s->co), __func__);
+  double min[3] = {DBL_MAX, DBL_MAX, DBL_MAX}, max[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+  double max_abs = 0.0;
+  for (int side = 0; side < 2; side++) {
+    const Mesh *mesh = s->mesh[side];
+    double(*co)[3] = &s->co[side ? s->vert_offset_b : 0];
+    for (int i = 0; i < mesh->totvert; i++) {
+      copy_v3db_v3fl(co[i], mesh->mvert[i].co);
+      if (side) {
+        double co_b[3];
+        mul_v3_m4v3_db(co_b, mat_b_db, co[i]);
+        copy_v3_v3_db(co[i], co_b);
+      }
+      for (int j = 0; j < 3; j++) {
+        min[j] = min_dd(min[j], co[i][j]);
+        max[j] = max_dd(max[j], co[i][j]);
+        max_abs = max_dd(max_abs, fabs(co[i][j]));
+      }
+    }
+  }
+  if (s->verts_len != 0) {
+    double diagonal[3];
+    sub_v3_v3v3_db(diagonal, max, min);
+    s->size = sqrt(dot_v3v3_db(diagonal, diagonal));
+  }
+
+  const int tris_len[2] = {poly_to_tri_count(mesh_a->totpoly, mesh_a->totloop),
+                           poly_to_tri_count(mesh_b->totpoly, mesh_b->totloop)};
+  s->tri_offset_b = tris_len[0];
+  s->tris_len = tris_len[0] + tris_len[1];
+  s->tris = MEM_malloc_arrayN((size_t)s->tris_len, sizeof(*s->tris), __func__);
+
+  /* Bounds of the triangles are rounded to floats, the margin keeps them around the triangles
+   * and the rays of #bool_patch_classify_cb. */
+  const float epsilon = (float)max_abs * FLT_EPSILON * 8.0f;
+
+  MLoopTri *looptri = MEM_malloc_arrayN(
+      (size_t)max_ii(max_ii(tris_len[0], tris_len[1]), 1), sizeof(*looptri), __func__);
+  for (int side = 0; side < 2; side++) {
+    const Mesh *mesh = s->mesh[side];
+    const int vert_offset = side ? s->vert_offset_b : 0;
+    const int poly_offset = side ? s->poly_offset_b : 0;
+    const int tri_offset = side ? s->tri_offset_b : 0;
+    BKE_mesh_recalc_looptri(
+        mesh->mloop, mesh->mpoly, mesh->mvert, mesh->totloop, mesh->totpoly, looptri);
+
+    BVHTree *tree = (tris_len[side] != 0) ? BLI_bvhtree_new(tris_len[side], epsilon, 4, 6) :
+                                            NULL;
+    for (int i = 0; i < tris_len[side]; i++) {
+      BoolTri *tri = &s->tris[tri_offset + i];
+      for (int j = 0; j < 3; j++) {
+        tri->v[j] = vert_offset + (int)mesh->mloop[looptri[i].tri[j]].v;
+      }
+      tri->poly = poly_offset + (int)looptri[i].poly;
+
+      if (!tri_is_degenerate(s->co[tri->v[0]], s->co[tri->v[1]], s->co[tri->v[2]])) {
+        float tri_co[3][3];
+        for (int j = 0; j < 3; j++) {
+          copy_v3fl_v3db(tri_co[j], s->co[tri->v[j]]);
+        }
+        BLI_bvhtree_insert(tree, i, tri_co[0], 3);
+      }
+    }
+    if (tree) {
+      BLI_bvhtree_balance(tree);
+    }
+    s->tree[side] = tree;
+  }
+  MEM_freeN(looptri);
+}
+
+static void bool_state_free(BoolState *s)
+{
+  for (int side = 0; side < 2; side++) {
+    if (s->tree[side]) {
+      BLI_bvhtree_free(s->tree[side]);
+    }
+  }
+  MEM_freeN(s->co);
+  MEM_SAFE_FREE(s->points);
+  MEM_freeN(s->tris);
+}
+
+/** Make room for \a len new points after the existing ones, returning the first one. */
+static int bool_points_add(BoolState *s, const int len)
+{
+  const int index = s->points_len;
+  s->points_len += len;
+  s->co = MEM_reallocN(s->co, sizeof(*s->co) * (size_t)s->points_len);
+  s->points = MEM_reallocN(s->points,
+                           sizeof(*s->points) * (size_t)max_ii(s->points_len - s->verts_len, 1));
+  return index;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Intersection
+ * \{ */
+
+static void bool_point_key_init(BoolPointKey *key, const int v0, const int v1, const int tri)
+{
+  key->v[0] = min_ii(v0, v1);
+  key->v[1] = max_ii(v0, v1);
+  key->tri = tri;
+}
+
+static int bool_point_key_cmp(const BoolPointKey *a, const BoolPointKey *b)
+{
+  if (a->v[0] != b->v[0]) {
+    return (a->v[0] < b->v[0]) ? -1 : 1;
+  }
+  if (a->v[1] != b->v[1]) {
+    return (a->v[1] < b->v[1]) ? -1 : 1;
+  }
+  if (a->tri != b->tri) {
+    return (a->tri < b->tri) ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Intersect triangle \a t of operand A with triangle \a u of operand B.
+ * \return true when they intersect, along the segment between the points of \a r_keys.
+ */
+static bool bool_isect_tri_tri(const BoolState *s,
+                               const int t,
+                               const int u,
+                               BoolPointKey r_keys[2])
+{
+  const BoolTri *tri_t = &s->tris[t];
+  const BoolTri *tri_u = &s->tris[u];
+  const double *t_co[3], *u_co[3];
+  int t_side[3], u_side[3];
+
+  for (int i = 0; i < 3; i++) {
+    t_co[i] = s->co[tri_t->v[i]];
+    u_co[i] = s->co[tri_u->v[i]];
+  }
+  for (int i = 0; i < 3; i++) {
+    u_side[i] = orient3d_sos(t_co[0], t_co[1], t_co[2], u_co[i], true);
+  }
+  if (u_side[0] == u_side[1] && u_side[1] == u_side[2]) {
+    return false;
+  }
+  for (int i = 0; i < 3; i++) {
+    t_side[i] = orient3d_sos(u_co[0], u_co[1], u_co[2], t_co[i], false);
+  }
+  if (t_side[0] == t_side[1] && t_side[1] == t_side[2]) {
+    return false;
+  }
+
+  /* Both triangles cross the plane of the other one along a segment on the line where the
+   * planes meet, the intersection is bounded by the ends of these segments inside of the other
+   * triangle. In general position, that's either none or two of them. */
+  int keys_len = 0;
+  for (int i = 0; i < 3; i++) {
+    const int j = (i + 1) % 3;
+    if (t_side[i] != t_side[j] && line_crosses_tri(u_co, t_co[i], t_co[j], false)) {
+      if (keys_len == 2) {
+        return false;
+      }
+      bool_point_key_init(&r_keys[keys_len++], tri_t->v[i], tri_t->v[j], u);
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    const int j = (i + 1) % 3;
+    if (u_side[i] != u_side[j] && line_crosses_tri(t_co, u_co[i], u_co[j], true)) {
+      if (keys_len == 2) {
+        return false;
+      }
+      bool_point_key_init(&r_keys[keys_len++], tri_u->v[i], tri_u->v[j], t);
+    }
+  }
+  return keys_len == 2;
+}
+
+static bool bool_overlap_cb(void *userdata, int index_a, int index_b, int UNUSED(thread))
+{
+  const BoolState *s = userdata;
+  BoolPointKey keys[2];
+  return bool_isect_tri_tri(s, index_a, s->tri_offset_b + index_b, keys);
+}
+
+static int bool_overlap_cmp(const void *a_v, const void *b_v)
+{
+  const BVHTreeOverlap *a = a_v;
+  const BVHTreeOverlap *b = b_v;
+  if (a->indexA != b->indexA) {
+    return (a->indexA < b->indexA) ? -1 : 1;
+  }
+  if (a->indexB != b->indexB) {
+    return (a->indexB < b->indexB) ? -1 : 1;
+  }
+  return 0;
+}
+
+typedef struct BoolSegmentData {
+  const BoolState *s;
+  const BVHTreeOverlap *overlap;
+  BoolSegment *segments;
+} BoolSegmentData;
+
+static void bool_segment_cb(void *__restrict userdata,
+                            const int i,
+                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BoolSegmentData *data = userdata;
+  BoolSegment *seg = &data->segments[i];
+  seg->tri[0] = data->overlap[i].indexA;
+  seg->tri[1] = data->s->tri_offset_b + data->overlap[i].indexB;
+  const bool is_isect = bool_isect_tri_tri(data->s, seg->tri[0], seg->tri[1], seg->key);
+  BLI_assert(is_isect);
+  UNUSED_VARS_NDEBUG(is_isect);
+}
+
+/** Find the segments of all intersecting pairs of triangles. */
+static BoolSegment *bool_segments_calc(const BoolState *s, int *r_segments_len)
+{
+  *r_segments_len = 0;
+  if (s->tree[0] == NULL || s->tree[1] == NULL) {
+    return NULL;
+  }
+
+  uint overlap_len;
+  BVHTreeOverlap *overlap = BLI_bvhtree_overlap_ex(s->tree[0],
+                                                   s->tree[1],
+                                                   &overlap_len,
+                                                   bool_overlap_cb,
+                                                   (void *)s,
+                                                   0,
+                                                   BVH_OVERLAP_USE_THREADING |
+                                                       BVH_OVERLAP_RETURN_PAIRS);
+  if (overlap == NULL) {
+    return NULL;
+  }
+
+  /* Threads add the pairs in any order, the result doesn't depend on it. */
+  qsort(overlap, overlap_len, sizeof(*overlap), bool_overlap_cmp);
+
+  BoolSegment *segments = MEM_malloc_arrayN(overlap_len, sizeof(*segments), __func__);
+  BoolSegmentData data = {
+      .s = s,
+      .overlap = overlap,
+      .segments = segments,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(0, (int)overlap_len, &data, bool_segment_cb, &settings);
+
+  MEM_freeN(overlap);
+  *r_segments_len = (int)overlap_len;
+  return segments;
+}
+
+typedef struct BoolSegmentKeyRef {
+  BoolPointKey key;
+  /** Segment and its end, as (segment * 2 + end). */
+  int ref;
+} BoolSegmentKeyRef;
+
+static int bool_segment_key_ref_cmp(const void *a, const void *b)
+{
+  const int cmp = bool_point_key_cmp(&((const BoolSegmentKeyRef *)a)->key,
+                                     &((const BoolSegmentKeyRef *)b)->key);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return ((const BoolSegmentKeyRef *)a)->ref - ((const BoolSegmentKeyRef *)b)->ref;
+}
+
+/** Add the point where the edge of \a key crosses the plane of its triangle. */
+static void bool_point_add(BoolState *s, const BoolPointKey *key, const int index)
+{
+  const BoolTri *tri = &s->tris[key->tri];
+  const double *p0 = s->co[key->v[0]];
+  const double *p1 = s->co[key->v[1]];
+  const double *a = s->co[tri->v[0]];
+  double ab[3], ac[3], ap0[3], ap1[3], n[3];
+
+  sub_v3_v3v3_db(ab, s->co[tri->v[1]], a);
+  sub_v3_v3v3_db(ac, s->co[tri->v[2]], a);
+  sub_v3_v3v3_db(ap0, p0, a);
+  sub_v3_v3v3_db(ap1, p1, a);
+  cross_v3_v3v3_db(n, ab, ac);
+  const double d0 = dot_v3v3_db(n, ap0);
+  const double d1 = dot_v3v3_db(n, ap1);
+  /* The exact predicates decided the edge crosses, the rounded distances may not agree. */
+  double t = (d0 != d1) ? d0 / (d0 - d1) : 0.5;
+  CLAMP(t, 0.0, 1.0);
+  interp_v3_v3v3_db(s->co[index], p0, p1, t);
+
+  BoolPoint *point = &s->points[index - s->verts_len];
+  point->key = *key;
+  point->v[0] = key->v[0];
+  point->v[1] = key->v[1];
+  point->v[2] = -1;
+  point->w[0] = (float)(1.0 - t);
+  point->w[1] = (float)t;
+  point->w[2] = 0.0f;
+}
+
+/** Add the points of the segments, segments ending at the same key share the point. */
+static void bool_segment_points_add(BoolState *s, BoolSegment *segments, const int segments_len)
+{
+  const int refs_len = segments_len * 2;
+  BoolSegmentKeyRef *refs = MEM_malloc_arrayN((size_t)refs_len, sizeof(*refs), __func__);
+  for (int i = 0; i < refs_len; i++) {
+    refs[i].key = segments[i / 2].key[i % 2];
+    refs[i].ref = i;
+  }
+  qsort(refs, (size_t)refs_len, sizeof(*refs), bool_segment_key_ref_cmp);
+
+  int unique_len = 0;
+  for (int i = 0; i < refs_len; i++) {
+    if (i == 0 || bool_point_key_cmp(&refs[i - 1].key, &refs[i].key) != 0) {
+      unique_len++;
+    }
+  }
+  int index = bool_points_add(s, unique_len) - 1;
+  for (int i = 0; i < refs_len; i++) {
+    if (i == 0 || bool_point_key_cmp(&refs[i - 1].key, &refs[i].key) != 0) {
+      bool_point_add(s, &refs[i].key, ++index);
+    }
+    segments[refs[i].ref / 2].point[refs[i].ref % 2] = index;
+  }
+  MEM_freeN(refs);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Triangle Splitting
+ * \{ */
+
+/** Pieces of a triangle split along its segments. */
+typedef struct BoolTriSplit {
+  /** Triangles of points, or of new points as (-1 - index). */
+  int (*tris)[3];
+  int tris_len;
+  /** Points the triangulation added where segments cross each other. */
+  double (*new_co)[3];
+  float (*new_weights)[3];
+  int new_len;
+  /** Pairs of points the triangulation merged. */
+  int (*merge)[2];
+  int merge_len;
+  /** Edges along the segments, bounds of the patches. */
+  int (*edges)[2];
+  int edges_len;
+} BoolTriSplit;
+
+typedef struct BoolSplitData {
+  const BoolState *s;
+  const BoolSegment *segments;
+  /** Segments of each triangle, from #tri_segments_start[tri] to #tri_segments_start[tri + 1]. */
+  const int *tri_segments;
+  const int *tri_segments_start;
+  /** Triangles with segments. */
+  const int *split_tris;
+  BoolTriSplit *splits;
+} BoolSplitData;
+
+typedef struct BoolEdgePoint {
+  double t;
+  int index;
+} BoolEdgePoint;
+
+static int bool_edge_point_cmp(const void *a_v, const void *b_v)
+{
+  const BoolEdgePoint *a = a_v;
+  const BoolEdgePoint *b = b_v;
+  if (a->t != b->t) {
+    return (a->t < b->t) ? -1 : 1;
+  }
+  return a->index - b->index;
+}
+
+static int bool_int_cmp(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+static int bool_co_v2_cmp(const void *a_v, const void *b_v, void *coords_v)
+{
+  const int a = *(const int *)a_v;
+  const int b = *(const int *)b_v;
+  const float(*coords)[2] = coords_v;
+  for (int i = 0; i < 2; i++) {
+    if (coords[a][i] != coords[b][i]) {
+      return (coords[a][i] < coords[b][i]) ? -1 : 1;
+    }
+  }
+  return a - b;
+}
+
+/** Twice the signed area of the triangle (a, b, c). */
+static double bool_cross_tri_v2(const double a[2], const double b[2], const double c[2])
+{
+  return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+static void bool_tri_split_cb(void *__restrict userdata,
+                              const int iter,
+                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BoolSplitData *data = userdata;
+  const BoolState *s = data->s;
+  const int t = data->split_tris[iter];
+  const BoolTri *tri = &s->tris[t];
+  BoolTriSplit *split = &data->splits[iter];
+  const int *tri_segments = &data->tri_segments[data->tri_segments_start[t]];
+  const int segments_len = data->tri_segments_start[t + 1] - data->tri_segments_start[t];
+
+  memset(split, 0, sizeof(*split));
+
+  /* Points of the triangulation: the corners, then the points of the segments. */
+  int *points = MEM_malloc_arrayN((size_t)(3 + segments_len * 2), sizeof(*points), __func__);
+  int points_len = 3;
+  for (int i = 0; i < 3; i++) {
+    points[i] = tri->v[i];
+  }
+  for (int i = 0; i < segments_len; i++) {
+    for (int j = 0; j < 2; j++) {
+      points[points_len++] = data->segments[tri_segments[i]].point[j];
+    }
+  }
+  qsort(&points[3], (size_t)(points_len - 3), sizeof(*points), bool_int_cmp);
+  {
+    int unique_len = 3;
+    for (int i = 3; i < points_len; i++) {
+      if (i == 3 || points[i] != points[unique_len - 1]) {
+        points[unique_len++] = points[i];
+      }
+    }
+    points_len = unique_len;
+  }
+
+  /* Project on the axis the triangle faces the most, keeping its orientation. */
+  const double *tri_co[3] = {s->co[tri->v[0]], s->co[tri->v[1]], s->co[tri->v[2]]};
+  double n[3], ab[3], ac[3];
+  sub_v3_v3v3_db(ab, tri_co[1], tri_co[0]);
+  sub_v3_v3v3_db(ac, tri_co[2], tri_co[0]);
+  cross_v3_v3v3_db(n, ab, ac);
+  int axis = 0;
+  for (int i = 1; i < 3; i++) {
+    if (fabs(n[i]) > fabs(n[axis])) {
+      axis = i;
+    }
+  }
+  int axis_u = (axis + 1) % 3, axis_v = (axis + 2) % 3;
+  if (n[axis] < 0.0) {
+    SWAP(int, axis_u, axis_v);
+  }
+  double extent = 0.0;
+  for (int i = 1; i < 3; i++) {
+    extent = max_dd(extent, fabs(tri_co[i][axis_u] - tri_co[0][axis_u]));
+    extent = max_dd(extent, fabs(tri_co[i][axis_v] - tri_co[0][axis_v]));
+  }
+  const double scale = (extent != 0.0) ? 1.0 / extent : 1.0;
+
+  float(*coords)[2] = MEM_malloc_arrayN((size_t)points_len, sizeof(*coords), __func__);
+  for (int i = 0; i < points_len; i++) {
+    const double *co = s->co[points[i]];
+    coords[i][0] = (float)((co[axis_u] - tri_co[0][axis_u]) * scale);
+    coords[i][1] = (float)((co[axis_v] - tri_co[0][axis_v]) * scale);
+  }
+
+  /* The outline of the triangle goes through the points on its edges, in order. */
+  int *face = MEM_malloc_arrayN((size_t)points_len, sizeof(*face), __func__);
+  int face_len = 0;
+  BoolEdgePoint *edge_points = MEM_malloc_arrayN(
+      (size_t)points_len, sizeof(*edge_points), __func__);
+  for (int k = 0; k < 3; k++) {
+    const int v0 = tri->v[k], v1 = tri->v[(k + 1) % 3];
+    double edge[3];
+    sub_v3_v3v3_db(edge, s->co[v1], s->co[v0]);
+    const double edge_len_sq = dot_v3v3_db(edge, edge);
+    int edge_points_len = 0;
+    for (int i = 3; i < points_len; i++) {
+      const BoolPointKey *key = &s->points[points[i] - s->verts_len].key;
+      if (key->tri != t && key->v[0] == min_ii(v0, v1) && key->v[1] == max_ii(v0, v1)) {
+        double d[3];
+        sub_v3_v3v3_db(d, s->co[points[i]], s->co[v0]);
+        edge_points[edge_points_len].t = (edge_len_sq != 0.0) ?
+                                             dot_v3v3_db(d, edge) / edge_len_sq :
+                                             0.0;
+        edge_points[edge_points_len++].index = i;
+      }
+    }
+    qsort(edge_points, (size_t)edge_points_len, sizeof(*edge_points), bool_edge_point_cmp);
+    face[face_len++] = k;
+    for (int i = 0; i < edge_points_len; i++) {
+      face[face_len++] = edge_points[i].index;
+    }
+  }
+  MEM_freeN(edge_points);
+
+  int(*edges)[2] = MEM_malloc_arrayN((size_t)segments_len, sizeof(*edges), __func__);
+  for (int i = 0; i < segments_len; i++) {
+    for (int j = 0; j < 2; j++) {
+      const int point = data->segments[tri_segments[i]].point[j];
+      const int *found = bsearch(
+          &point, &points[3], (size_t)(points_len - 3), sizeof(*points), bool_int_cmp);
+      edges[i][j] = (int)(found - points);
+    }
+  }
+
+  /* Points at the same place are merged before the triangulation, these come from
+   * intersections at the vertices and edges of the other operand. The lowest index is kept,
+   * so a corner when there is one. */
+  split->merge = MEM_malloc_arrayN((size_t)points_len, sizeof(*split->merge), __func__);
+  int *point_rep = MEM_malloc_arrayN((size_t)points_len, sizeof(*point_rep), __func__);
+  int *point_map = MEM_malloc_arrayN((size_t)points_len, sizeof(*point_map), __func__);
+  for (int i = 0; i < points_len; i++) {
+    point_map[i] = i;
+  }
+  BLI_qsort_r(point_map, (size_t)points_len, sizeof(*point_map), bool_co_v2_cmp, coords);
+  for (int i = 0; i < points_len;) {
+    int i_end = i + 1;
+    while (i_end < points_len && coords[point_map[i]][0] == coords[point_map[i_end]][0] &&
+           coords[point_map[i]][1] == coords[point_map[i_end]][1]) {
+      i_end++;
+    }
+    for (int j = i; j < i_end; j++) {
+      point_rep[point_map[j]] = point_map[i];
+    }
+    i = i_end;
+  }
+  const bool is_degenerate = (point_rep[1] != 1 || point_rep[2] != 2);
+  int unique_len = 0;
+  for (int i = 0; i < points_len; i++) {
+    if (point_rep[i] == i) {
+      point_map[i] = unique_len;
+      points[unique_len] = points[i];
+      copy_v2_v2(coords[unique_len], coords[i]);
+      unique_len++;
+    }
+    else {
+      point_map[i] = point_map[point_rep[i]];
+      split->merge[split->merge_len][0] = points[point_map[i]];
+      split->merge[split->merge_len][1] = points[i];
+      split->merge_len++;
+    }
+  }
+  points_len = unique_len;
+  {
+    int face_unique_len = 0;
+    for (int i = 0; i < face_len; i++) {
+      const int v = point_map[face[i]];
+      if (face_unique_len == 0 || face[face_unique_len - 1] != v) {
+        face[face_unique_len++] = v;
+      }
+    }
+    while (face_unique_len > 1 && face[face_unique_len - 1] == face[0]) {
+      face_unique_len--;
+    }
+    face_len = face_unique_len;
+  }
+  int edges_len = 0;
+  for (int i = 0; i < segments_len; i++) {
+    const int v0 = point_map[edges[i][0]], v1 = point_map[edges[i][1]];
+    if (v0 != v1) {
+      edges[edges_len][0] = v0;
+      edges[edges_len][1] = v1;
+      edges_len++;
+    }
+  }
+  MEM_freeN(point_rep);
+  MEM_freeN(point_map);
+
+  int face_start = 0;
+  CDT_input in = {
+      .verts_len = points_len,
+      .edges_len = edges_len,
+      .faces_len = 1,
+      .vert_coords = coords,
+      .edges = edges,
+      .faces = face,
+      .faces_start_table = &face_start,
+      .faces_len_table = &face_len,
+      .epsilon = 0.0f,
+  };
+  CDT_result *out = is_degenerate ? NULL : BLI_delaunay_2d_cdt_calc(&in, CDT_INSIDE);
+
+  if (out == NULL || out->faces_len == 0) {
+    split->tris = MEM_mallocN(sizeof(*split->tris), __func__);
+    copy_v3_v3_int(split->tris[0], tri->v);
+    split->tris_len = 1;
+    split->merge_len = 0;
+  }
+  else {
+    /* Corners of the triangle in the projected space, for the points the triangulation adds. */
+    double corners[3][2];
+    for (int i = 0; i < 3; i++) {
+      corners[i][0] = (double)coords[i][0];
+      corners[i][1] = (double)coords[i][1];
+    }
+    const double area = bool_cross_tri_v2(corners[0], corners[1], corners[2]);
+
+    /* Vertices the triangulation adds are their own original, past the input ones. */
+    int *vert_ref = MEM_malloc_arrayN((size_t)out->verts_len, sizeof(*vert_ref), __func__);
+    int new_alloc = 0;
+    for (int i = 0; i < out->verts_len; i++) {
+      const int *orig = &out->verts_orig[out->verts_orig_start_table[i]];
+      if (orig[0] >= points_len) {
+        new_alloc++;
+      }
+    }
+    if (new_alloc) {
+      split->new_co = MEM_malloc_arrayN((size_t)new_alloc, sizeof(*split->new_co), __func__);
+      split->new_weights = MEM_malloc_arrayN(
+          (size_t)new_alloc, sizeof(*split->new_weights), __func__);
+    }
+
+    for (int i = 0; i < out->verts_len; i++) {
+      const int *orig = &out->verts_orig[out->verts_orig_start_table[i]];
+      int orig_first = -1;
+      for (int j = 0; j < out->verts_orig_len_table[i]; j++) {
+        if (orig[j] >= points_len) {
+          continue;
+        }
+        if (orig_first == -1) {
+          orig_first = orig[j];
+        }
+        else {
+          split->merge[split->merge_len][0] = points[orig_first];
+          split->merge[split->merge_len][1] = points[orig[j]];
+          split->merge_len++;
+        }
+      }
+      if (orig_first == -1) {
+        const double co[2] = {out->vert_coords[i][0], out->vert_coords[i][1]};
+        double w[3];
+        w[1] = (area != 0.0) ? bool_cross_tri_v2(corners[0], co, corners[2]) / area : 0.0;
+        w[2] = (area != 0.0) ? bool_cross_tri_v2(corners[0], corners[1], co) / area : 0.0;
+        w[0] = 1.0 - w[1] - w[2];
+        for (int j = 0; j < 3; j++) {
+          split->new_co[split->new_len][j] = tri_co[0][j] * w[0] + tri_co[1][j] * w[1] +
+                                             tri_co[2][j] * w[2];
+          split->new_weights[split->new_len][j] = (float)w[j];
+        }
+        vert_ref[i] = -1 - split->new_len++;
+      }
+      else {
+        vert_ref[i] = points[orig_first];
+      }
+    }
+
+    int tris_alloc = 0;
+    for (int i = 0; i < out->faces_len; i++) {
+      tris_alloc += out->faces_len_table[i] - 2;
+    }
+    split->tris = MEM_malloc_arrayN((size_t)tris_alloc, sizeof(*split->tris), __func__);
+    for (int i = 0; i < out->faces_len; i++) {
+      const int *f = &out->faces[out->faces_start_table[i]];
+      for (int j = 2; j < out->faces_len_table[i]; j++) {
+        int *piece = split->tris[split->tris_len++];
+        piece[0] = vert_ref[f[0]];
+        piece[1] = vert_ref[f[j - 1]];
+        piece[2] = vert_ref[f[j]];
+      }
+    }
+
+    split->edges = MEM_malloc_arrayN((size_t)max_ii(out->edges_len, 1), sizeof(*split->edges), __func__);
+    for (int i = 0; i < out->edges_len; i++) {
+      const int *orig = &out->edges_orig[out->edges_orig_start_table[i]];
+      for (int j = 0; j < out->edges_orig_len_table[i]; j++) {
+        if (orig[j] < in.edges_len) {
+          split->edges[split->edges_len][0] = vert_ref[out->edges[i][0]];
+          split->edges[split->edges_len][1] = vert_ref[out->edges[i][1]];
+          split->edges_len++;
+          break;
+        }
+      }
+    }
+    MEM_freeN(vert_ref);
+  }
+
+  if (out) {
+    BLI_delaunay_2d_cdt_free(out);
+  }
+  MEM_freeN(edges);
+  MEM_freeN(face);
+  MEM_freeN(coords);
+  MEM_freeN(points);
+}
+
+static void bool_tri_split_free(BoolTriSplit *split)
+{
+  MEM_SAFE_FREE(split->tris);
+  MEM_SAFE_FREE(split->new_co);
+  MEM_SAFE_FREE(split->new_weights);
+  MEM_SAFE_FREE(split->merge);
+  MEM_SAFE_FREE(split->edges);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Welding
+ *
+ * Points are merged with a union-find, the lowest index is kept so the vertices of the operands
+ * are preferred over new points.
+ * \{ */
+
+static int bool_weld_find(int *parent, int i)
+{
+  int root = i;
+  while (parent[root] != root) {
+    root = parent[root];
+  }
+  while (parent[i] != root) {
+    const int next = parent[i];
+    parent[i] = root;
+    i = next;
+  }
+  return root;
+}
+
+static void bool_weld_union(int *parent, int a, int b)
+{
+  a = bool_weld_find(parent, a);
+  b = bool_weld_find(parent, b);
+  if (a < b) {
+    parent[b] = a;
+  }
+  else if (b < a) {
+    parent[a] = b;
+  }
+}
+
+static int bool_co_cmp(const void *a_v, const void *b_v, void *co_v)
+{
+  const int a = *(const int *)a_v;
+  const int b = *(const int *)b_v;
+  const double(*co)[3] = co_v;
+  for (int i = 0; i < 3; i++) {
+    if (co[a][i] != co[b][i]) {
+      return (co[a][i] < co[b][i]) ? -1 : 1;
+    }
+  }
+  return a - b;
+}
+
+/**
+ * Merge the new points closer than the precision of the result to other points, these come from
+ * intersections at vertices or edges, which the exact predicates moved infinitely close.
+ * Vertices of the operands are not merged with each other.
+ */
+static void bool_weld_coincident(const BoolState *s, int *parent, const bool *vert_is_split)
+{
+  int *points = MEM_malloc_arrayN((size_t)s->points_len, sizeof(*points), __func__);
+  int points_len = 0;
+  for (int i = 0; i < s->points_len; i++) {
+    if (i >= s->verts_len || vert_is_split[i]) {
+      points[points_len++] = i;
+    }
+  }
+  BLI_qsort_r(points, (size_t)points_len, sizeof(*points), bool_co_cmp, s->co);
+
+  /* Points sorted on X, only the ones following within the distance are compared. */
+  const double epsilon = (double)FLT_EPSILON * s->size;
+  for (int i = 0; i < points_len; i++) {
+    const double *co = s->co[points[i]];
+    for (int j = i + 1; j < points_len && s->co[points[j]][0] - co[0] <= epsilon; j++) {
+      if (points[i] < s->verts_len && points[j] < s->verts_len) {
+        continue;
+      }
+      double d[3];
+      sub_v3_v3v3_db(d, s->co[points[j]], co);
+      if (dot_v3v3_db(d, d) <= epsilon * epsilon) {
+        bool_weld_union(parent, points[i], points[j]);
+      }
+    }
+  }
+  MEM_freeN(points);
+}
+
+/**
+ * Check if a triangle has no width, its smallest height is within \a epsilon.
+ */
+static bool bool_tri_is_flat(const BoolState *s, const int v[3], const double epsilon)
+{
+  double edge[3][3], n[3];
+  double len_sq_max = 0.0;
+  for (int i = 0; i < 3; i++) {
+    sub_v3_v3v3_db(edge[i], s->co[v[(i + 1) % 3]], s->co[v[i]]);
+    len_sq_max = max_dd(len_sq_max, dot_v3v3_db(edge[i], edge[i]));
+  }
+  cross_v3_v3v3_db(n, edge[0], edge[1]);
+  /* Twice the area over the longest edge is the smallest height. */
+  return dot_v3v3_db(n, n) <= epsilon * epsilon * len_sq_max;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Classification
+ * \{ */
+
+/** Triangle of the intersected operands. */
+typedef struct BoolPiece {
+  int v[3];
+  /** Triangle of the operand the piece is part of. */
+  int tri;
+  int patch;
+} BoolPiece;
+
+typedef struct BoolClassifyData {
+  const BoolState *s;
+  const BoolPiece *pieces;
+  /** Largest piece of each patch. */
+  const int *patch_piece;
+  /** Ray direction, away from the axes to avoid coplanar cases. */
+  double dir[3];
+  bool *r_patch_inside;
+} BoolClassifyData;
+
+typedef struct BoolRayData {
+  const BoolState *s;
+  /** Ray segment, from a point of a piece to outside of the bounds. */
+  const double *p;
+  const double *q;
+  /** Triangle the piece is part of. */
+  const double *p_tri_co[3];
+  bool p_is_b;
+  int tri_offset;
+  int crossings;
+} BoolRayData;
+
+static void bool_ray_cb(void *userdata,
+                        int index,
+                        const BVHTreeRay *UNUSED(ray),
+                        BVHTreeRayHit *UNUSED(hit))
+{
+  BoolRayData *data = userdata;
+  const BoolState *s = data->s;
+  const BoolTri *tri = &s->tris[data->tri_offset + index];
+  const double *tri_co[3] = {s->co[tri->v[0]], s->co[tri->v[1]], s->co[tri->v[2]]};
+
+  /* The point is rounded off of the plane of its triangle. When that plane is the same as the
+   * one of the other triangle, the point is on it, like the intersection has it. */
+  int p_side;
+  if (orient3d(tri_co[0], tri_co[1], tri_co[2], data->p_tri_co[0]) == 0 &&
+      orient3d(tri_co[0], tri_co[1], tri_co[2], data->p_tri_co[1]) == 0 &&
+      orient3d(tri_co[0], tri_co[1], tri_co[2], data->p_tri_co[2]) == 0) {
+    const int sign_normal = cross3_first_sign(tri_co[0], tri_co[1], tri_co[0], tri_co[2]);
+    p_side = data->p_is_b ? sign_normal : -sign_normal;
+  }
+  else {
+    p_side = orient3d_sos(tri_co[0], tri_co[1], tri_co[2], data->p, data->p_is_b);
+  }
+  const int q_side = orient3d_sos(tri_co[0], tri_co[1], tri_co[2], data->q, data->p_is_b);
+
+  if (p_side != q_side && line_crosses_tri(tri_co, data->p, data->q, data->p_is_b)) {
+    data->crossings++;
+  }
+}
+
+static void bool_patch_classify_cb(void *__restrict userdata,
+                                   const int patch,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BoolClassifyData *data = userdata;
+  const BoolState *s = data->s;
+  const BoolPiece *piece = &data->pieces[data->patch_piece[patch]];
+  const BoolTri *tri = &s->tris[piece->tri];
+  const int side = bool_tri_side(s, piece->tri);
+  BVHTree *tree = s->tree[!side];
+
+  if (tree == NULL) {
+    data->r_patch_inside[patch] = false;
+    return;
+  }
+
+  double p[3] = {0.0, 0.0, 0.0}, q[3];
+  for (int i = 0; i < 3; i++) {
+    add_v3_v3_db(p, s->co[piece->v[i]]);
+  }
+  mul_v3db_db(p, 1.0 / 3.0);
+  const double dist = s->size * 2.0;
+  copy_v3_v3_db(q, data->dir);
+  mul_v3db_db(q, dist);
+  add_v3_v3_db(q, p);
+
+  BoolRayData ray_data = {
+      .s = s,
+      .p = p,
+      .q = q,
+      .p_tri_co = {s->co[tri->v[0]], s->co[tri->v[1]], s->co[tri->v[2]]},
+      .p_is_b = side,
+      .tri_offset = side ? 0 : s->tri_offset_b,
+      .crossings = 0,
+  };
+  float origin[3], dir[3];
+  copy_v3fl_v3db(origin, p);
+  copy_v3fl_v3db(dir, data->dir);
+  BLI_bvhtree_ray_cast_all(tree, origin, dir, 0.0f, (float)dist, bool_ray_cb, &ray_data);
+
+  data->r_patch_inside[patch] = (ray_data.crossings % 2) == 1;
+}
+
+/**
+ * Group the pieces in patches, connected by the edges which aren't along segments,
+ * then classify each patch.
+ *
+ * \return The number of patches.
+ */
+static int bool_patches_calc(const BoolState *s,
+                             BoolPiece *pieces,
+                             const int pieces_len,
+                             EdgeSet *segment_edges,
+                             bool **r_patch_inside)
+{
+  int *parent = MEM_malloc_arrayN((size_t)max_ii(pieces_len, 1), sizeof(*parent), __func__);
+  for (int i = 0; i < pieces_len; i++) {
+    parent[i] = i;
+  }
+
+  EdgeHash *edge_piece[2] = {
+      BLI_edgehash_new_ex(__func__, BLI_EDGEHASH_SIZE_GUESS_FROM_POLYS(s->poly_offset_b)),
+      BLI_edgehash_new_ex(__func__,
+                          BLI_EDGEHASH_SIZE_GUESS_FROM_POLYS(s->mesh[1]->totpoly)),
+  };
+  for (int i = 0; i < pieces_len; i++) {
+    const BoolPiece *piece = &pieces[i];
+    EdgeHash *eh = edge_piece[bool_tri_side(s, piece->tri)];
+    for (int j = 0; j < 3; j++) {
+      const int v0 = piece->v[j], v1 = piece->v[(j + 1) % 3];
+      if (BLI_edgeset_haskey(segment_edges, (uint)v0, (uint)v1)) {
+        continue;
+      }
+      void **val_p;
+      if (BLI_edgehash_ensure_p(eh, (uint)v0, (uint)v1, &val_p)) {
+        bool_weld_union(parent, i, POINTER_AS_INT(*val_p));
+      }
+      else {
+        *val_p = POINTER_FROM_INT(i);
+      }
+    }
+  }
+  BLI_edgehash_free(edge_piece[0], NULL);
+  BLI_edgehash_free(edge_piece[1], NULL);
+
+  /* Number the patches, and find their largest piece to classify them with. */
+  int patches_len = 0;
+  int *patch_piece = MEM_malloc_arrayN((size_t)max_ii(pieces_len, 1), sizeof(*patch_piece), __func__);
+  double *patch_area = MEM_malloc_arrayN((size_t)max_ii(pieces_len, 1), sizeof(*patch_area), __func__);
+  for (int i = 0; i < pieces_len; i++) {
+    const int root = bool_weld_find(parent, i);
+    if (root == i) {
+      pieces[i].patch = patches_len++;
+      patch_area[pieces[i].patch] = -1.0;
+    }
+    else {
+      pieces[i].patch = pieces[root].patch;
+    }
+    double ab[3], ac[3], n[3];
+    sub_v3_v3v3_db(ab, s->co[pieces[i].v[1]], s->co[pieces[i].v[0]]);
+    sub_v3_v3v3_db(ac, s->co[pieces[i].v[2]], s->co[pieces[i].v[0]]);
+    cross_v3_v3v3_db(n, ab, ac);
+    const double area = dot_v3v3_db(n, n);
+    if (area > patch_area[pieces[i].patch]) {
+      patch_area[pieces[i].patch] = area;
+      patch_piece[pieces[i].patch] = i;
+    }
+  }
+  MEM_freeN(patch_area);
+  MEM_freeN(parent);
+
+  bool *patch_inside = MEM_malloc_arrayN(
+      (size_t)max_ii(patches_len, 1), sizeof(*patch_inside), __func__);
+  BoolClassifyData data = {
+      .s = s,
+      .pieces = pieces,
+      .patch_piece = patch_piece,
+      .dir = {0.3213938, 0.5416752, 0.7766555},
+      .r_patch_inside = patch_inside,
+  };
+  normalize_v3_d(data.dir);
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (patches_len > 1);
+  BLI_task_parallel_range(0, patches_len, &data, bool_patch_classify_cb, &settings);
+
+  MEM_freeN(patch_piece);
+  *r_patch_inside = patch_inside;
+  return patches_len;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Result
+ * \{ */
+
+typedef struct BoolCorner {
+  int point;
+  /** Loop of the operands the corner is a copy of, -1 to interpolate it in its face. */
+  int loop;
+} BoolCorner;
+
+typedef struct BoolFace {
+  /** Face of the operands. */
+  int poly;
+  int corner_start;
+  int corners_len;
+} BoolFace;
+
+typedef struct BoolResult {
+  BoolFace *faces;
+  int faces_len;
+  BoolCorner *corners;
+  int corners_len;
+} BoolResult;
+
+static void bool_result_face_add(BoolResult *r, const int poly)
+{
+  BoolFace *face = &r->faces[r->faces_len++];
+  face->poly = poly;
+  face->corner_start = r->corners_len;
+  face->corners_len = 0;
+}
+
+static void bool_result_corner_add(BoolResult *r, const int point, const int loop)
+{
+  r->corners[r->corners_len].point = point;
+  r->corners[r->corners_len].loop = loop;
+  r->corners_len++;
+  r->faces[r->faces_len - 1].corners_len++;
+}
+
+static int bool_half_edge_cmp(const void *a_v, const void *b_v)
+{
+  const int *a = a_v;
+  const int *b = b_v;
+  if (a[0] != b[0]) {
+    return (a[0] < b[0]) ? -1 : 1;
+  }
+  return a[1] - b[1];
+}
+
+static int bool_half_edge_start_cmp(const void *a_v, const void *b_v)
+{
+  const int *a = a_v;
+  const int *b = b_v;
+  return (a[0] < b[0]) ? -1 : (a[0] > b[0]);
+}
+
+/**
+ * Outline of the pieces \a group, when it's a single loop without repeated points.
+ * \return The length of the outline written to \a r_outline, zero when there is none.
+ */
+static int bool_pieces_outline(const BoolPiece *pieces,
+                               const int *group,
+                               const int group_len,
+                               int (*edges)[2],
+                               int *r_outline)
+{
+  int edges_len = 0;
+  for (int i = 0; i < group_len; i++) {
+    const int *v = pieces[group[i]].v;
+    for (int j = 0; j < 3; j++) {
+      edges[edges_len][0] = v[j];
+      edges[edges_len][1] = v[(j + 1) % 3];
+      edges_len++;
+    }
+  }
+  qsort(edges, (size_t)edges_len, sizeof(*edges), bool_half_edge_cmp);
+
+  /* Edges between two pieces go both ways, remove them. */
+  BLI_bitmap *is_inner = BLI_BITMAP_NEW(edges_len, __func__);
+  for (int i = 0; i < edges_len; i++) {
+    const int edge_reverse[2] = {edges[i][1], edges[i][0]};
+    if (bsearch(edge_reverse, edges, (size_t)edges_len, sizeof(*edges), bool_half_edge_cmp)) {
+      BLI_BITMAP_ENABLE(is_inner, i);
+    }
+  }
+  int outline_edges_len = 0;
+  for (int i = 0; i < edges_len; i++) {
+    if (!BLI_BITMAP_TEST(is_inner, i)) {
+      copy_v2_v2_int(edges[outline_edges_len++], edges[i]);
+    }
+  }
+  MEM_freeN(is_inner);
+  if (outline_edges_len < 3) {
+    return 0;
+  }
+  for (int i = 1; i < outline_edges_len; i++) {
+    if (edges[i][0] == edges[i - 1][0]) {
+      return 0;
+    }
+  }
+
+  int len = 0;
+  int v = edges[0][0];
+  do {
+    const int key[2] = {v, 0};
+    const int(*next)[2] = bsearch(
+        key, edges, (size_t)outline_edges_len, sizeof(*edges), bool_half_edge_start_cmp);
+    if (next == NULL || len == outline_edges_len) {
+      return 0;
+    }
+    r_outline[len++] = v;
+    v = (*next)[1];
+  } while (v != edges[0][0]);
+
+  return (len == outline_edges_len) ? len : 0;
+}
+
+/** Add the pieces of face \a poly kept by the operation, joining them when possible. */
+static void bool_result_poly_pieces_add(BoolResult *r,
+                                        const BoolPiece *pieces,
+                                        int *group,
+                                        const int group_len,
+                                        const int poly,
+                                        const bool flip,
+                                        int (*edges)[2],
+                                        int *outline)
+{
+  const int outline_len = bool_pieces_outline(pieces, group, group_len, edges, outline);
+  if (outline_len != 0) {
+    bool_result_face_add(r, poly);
+    for (int i = 0; i < outline_len; i++) {
+      bool_result_corner_add(r, outline[flip ? outline_len - 1 - i : i], -1);
+    }
+    return;
+  }
+  for (int i = 0; i < group_len; i++) {
+    const int *v = pieces[group[i]].v;
+    bool_result_face_add(r, poly);
+    for (int j = 0; j < 3; j++) {
+      bool_result_corner_add(r, v[flip ? 2 - j : j], -1);
+    }
+  }
+}
+
+/** Point on an edge, to split it at. */
+typedef struct BoolEdgeSplit {
+  int edge;
+  int point;
+  double t;
+} BoolEdgeSplit;
+
+static int bool_edge_split_cmp(const void *a_v, const void *b_v)
+{
+  const BoolEdgeSplit *a = a_v;
+  const BoolEdgeSplit *b = b_v;
+  if (a->edge != b->edge) {
+    return (a->edge < b->edge) ? -1 : 1;
+  }
+  if (a->t != b->t) {
+    return (a->t < b->t) ? -1 : 1;
+  }
+  return a->point - b->point;
+}
+
+/**
+ * Faces of both operands on the same plane meet along slivers without any area, their pieces
+ * are dropped once their points are welded together. This leaves edges used in one direction
+ * only, on both sides of the slivers. Split these edges at the points of the others on them.
+ */
+static void bool_result_slivers_split(const BoolState *s, BoolResult *r)
+{
+  EdgeHash *edge_uses = BLI_edgehash_new_ex(__func__,
+                                            BLI_EDGEHASH_SIZE_GUESS_FROM_POLYS(r->faces_len));
+  for (int i = 0; i < r->faces_len; i++) {
+    const BoolFace *face = &r->faces[i];
+    for (int j = 0; j < face->corners_len; j++) {
+      const int v0 = r->corners[face->corner_start + j].point;
+      const int v1 = r->corners[face->corner_start + (j + 1) % face->corners_len].point;
+      void **val_p;
+      if (!BLI_edgehash_ensure_p(edge_uses, (uint)v0, (uint)v1, &val_p)) {
+        *val_p = POINTER_FROM_INT(0);
+      }
+      *val_p = POINTER_FROM_INT(POINTER_AS_INT(*val_p) + ((v0 < v1) ? 1 : -1));
+    }
+  }
+
+  /* Edges used one way more than the other, sorted to look them up. */
+  int(*open)[2] = MEM_malloc_arrayN((size_t)max_ii(r->corners_len, 1), sizeof(*open), __func__);
+  int open_len = 0;
+  for (int i = 0; i < r->faces_len; i++) {
+    const BoolFace *face = &r->faces[i];
+    for (int j = 0; j < face->corners_len; j++) {
+      const int v0 = r->corners[face->corner_start + j].point;
+      const int v1 = r->corners[face->corner_start + (j + 1) % face->corners_len].point;
+      const int uses = POINTER_AS_INT(BLI_edgehash_lookup(edge_uses, (uint)v0, (uint)v1));
+      if ((v0 < v1) ? (uses > 0) : (uses < 0)) {
+        open[open_len][0] = v0;
+        open[open_len][1] = v1;
+        open_len++;
+      }
+    }
+  }
+  BLI_edgehash_free(edge_uses, NULL);
+
+  if (open_len == 0) {
+    MEM_freeN(open);
+    return;
+  }
+  qsort(open, (size_t)open_len, sizeof(*open), bool_half_edge_cmp);
+  {
+    int unique_len = 1;
+    for (int i = 1; i < open_len; i++) {
+      if (bool_half_edge_cmp(open[i], open[unique_len - 1]) != 0) {
+        copy_v2_v2_int(open[unique_len++], open[i]);
+      }
+    }
+    open_len = unique_len;
+  }
+
+  /* Find the first points of the edges along the other edges. */
+  const double epsilon = (double)FLT_EPSILON * s->size;
+  BVHTree *tree_edges = BLI_bvhtree_new(open_len, (float)epsilon, 2, 6);
+  BVHTree *tree_points = BLI_bvhtree_new(open_len, (float)epsilon, 2, 6);
+  for (int i = 0; i < open_len; i++) {
+    float co[2][3];
+    copy_v3fl_v3db(co[0], s->co[open[i][0]]);
+    copy_v3fl_v3db(co[1], s->co[open[i][1]]);
+    BLI_bvhtree_insert(tree_edges, i, co[0], 2);
+    if (i == 0 || open[i][0] != open[i - 1][0]) {
+      BLI_bvhtree_insert(tree_points, i, co[0], 1);
+    }
+  }
+  BLI_bvhtree_balance(tree_edges);
+  BLI_bvhtree_balance(tree_points);
+  uint overlap_len;
+  BVHTreeOverlap *overlap = BLI_bvhtree_overlap(
+      tree_edges, tree_points, &overlap_len, NULL, NULL);
+  BLI_bvhtree_free(tree_edges);
+  BLI_bvhtree_free(tree_points);
+
+  BoolEdgeSplit *splits = MEM_malloc_arrayN(
+      (size_t)max_ii((int)overlap_len, 1), sizeof(*splits), __func__);
+  int splits_len = 0;
+  for (uint i = 0; i < overlap_len; i++) {
+    const int a = open[overlap[i].indexA][0];
+    const int b = open[overlap[i].indexA][1];
+    const int p = open[overlap[i].indexB][0];
+    if (ELEM(p, a, b)) {
+      continue;
+    }
+    double ab[3], ap[3], ap_perp[3];
+    sub_v3_v3v3_db(ab, s->co[b], s->co[a]);
+    sub_v3_v3v3_db(ap, s->co[p], s->co[a]);
+    const double ab_len_sq = dot_v3v3_db(ab, ab);
+    const double t = (ab_len_sq != 0.0) ? dot_v3v3_db(ap, ab) / ab_len_sq : 0.0;
+    copy_v3_v3_db(ap_perp, ab);
+    mul_v3db_db(ap_perp, -t);
+    add_v3_v3_db(ap_perp, ap);
+    if (t > 0.0 && t < 1.0 && dot_v3v3_db(ap_perp, ap_perp) <= epsilon * epsilon) {
+      splits[splits_len].edge = overlap[i].indexA;
+      splits[splits_len].point = p;
+      splits[splits_len].t = t;
+      splits_len++;
+    }
+  }
+  MEM_SAFE_FREE(overlap);
+  qsort(splits, (size_t)splits_len, sizeof(*splits), bool_edge_split_cmp);
+
+  /* Points on each edge, from #edge_splits_start[edge] to #edge_splits_start[edge + 1]. */
+  int *edge_splits_start = MEM_calloc_arrayN(
+      (size_t)open_len + 1, sizeof(*edge_splits_start), __func__);
+  for (int i = 0; i < splits_len; i++) {
+    edge_splits_start[splits[i].edge + 1]++;
+  }
+  for (int i = 0; i < open_len; i++) {
+    edge_splits_start[i + 1] += edge_splits_start[i];
+  }
+
+  /* Edge of each corner, -1 when it isn't split. */
+  int *corner_edge = MEM_malloc_arrayN((size_t)r->corners_len, sizeof(*corner_edge), __func__);
+  int corners_alloc = r->corners_len;
+  for (int i = 0; i < r->faces_len; i++) {
+    const BoolFace *face = &r->faces[i];
+    for (int j = 0; j < face->corners_len; j++) {
+      const int edge[2] = {
+          r->corners[face->corner_start + j].point,
+          r->corners[face->corner_start + (j + 1) % face->corners_len].point,
+      };
+      const int(*found)[2] = bsearch(
+          edge, open, (size_t)open_len, sizeof(*open), bool_half_edge_cmp);
+      const int e = found ? (int)(found - open) : -1;
+      corner_edge[face->corner_start + j] = e;
+      if (e != -1) {
+        corners_alloc += edge_splits_start[e + 1] - edge_splits_start[e];
+      }
+    }
+  }
+
+  BoolCorner *corners = MEM_malloc_arrayN((size_t)corners_alloc, sizeof(*corners), __func__);
+  int corners_len = 0;
+  for (int i = 0; i < r->faces_len; i++) {
+    BoolFace *face = &r->faces[i];
+    const int corner_start = corners_len;
+    for (int j = 0; j < face->corners_len; j++) {
+      corners[corners_len++] = r->corners[face->corner_start + j];
+      const int e = corner_edge[face->corner_start + j];
+      if (e == -1) {
+        continue;
+      }
+      for (int k = edge_splits_start[e]; k < edge_splits_start[e + 1]; k++) {
+        corners[corners_len].point = splits[k].point;
+        corners[corners_len].loop = -1;
+        corners_len++;
+      }
+    }
+    face->corner_start = corner_start;
+    face->corners_len = corners_len - corner_start;
+  }
+  MEM_freeN(corner_edge);
+  MEM_freeN(edge_splits_start);
+  MEM_freeN(splits);
+  MEM_freeN(open);
+
+  MEM_freeN(r->corners);
+  r->corners = corners;
+  r->corners_len = corners_len;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Mesh Output
+ * \{ */
+
+/** Custom data of one element, to interpolate in before copying to layers found by name. */
+static void bool_customdata_interp_named(const CustomData *source,
+                                         CustomData *scratch,
+                                         CustomData *dest,
+                                         const int *src_indices,
+                                         const float *weights,
+                                         const int count,
+                                         const int dest_index)
+{
+  CustomData_interp(source, scratch, src_indices, weights, NULL, count, 0);
+  CustomData_copy_data_named(scratch, dest, 0, dest_index, 1);
+}
+
+static void bool_origindex_clear(CustomData *data, const int len)
+{
+  int *origindex = CustomData_get_layer(data, CD_ORIGINDEX);
+  if (origindex) {
+    copy_vn_i(origindex, len, ORIGINDEX_NONE);
+  }
+}
+
+/** Edge of the operands the result edge (p0, p1) is a part of, -1 when there is none. */
+static int bool_edge_source(const BoolState *s, EdgeHash *edges[2], int p0, int p1)
+{
+  int e[2] = {-1, -1};
+  if (p0 < s->verts_len && p1 < s->verts_len) {
+    e[0] = p0;
+    e[1] = p1;
+  }
+  else {
+    if (p0 < s->verts_len) {
+      SWAP(int, p0, p1);
+    }
+    const BoolPointKey *key = &s->points[p0 - s->verts_len].key;
+    if (key->tri == -1) {
+      return -1;
+    }
+    if (p1 < s->verts_len ? ELEM(p1, key->v[0], key->v[1]) :
+                            (s->points[p1 - s->verts_len].key.v[0] == key->v[0] &&
+                             s->points[p1 - s->verts_len].key.v[1] == key->v[1])) {
+      e[0] = key->v[0];
+      e[1] = key->v[1];
+    }
+  }
+  if (e[0] == -1 || bool_vert_side(s, e[0]) != bool_vert_side(s, e[1])) {
+    return -1;
+  }
+  const int side = bool_vert_side(s, e[0]);
+  const int offset = side ? s->vert_offset_b : 0;
+  return POINTER_AS_INT(BLI_edgehash_lookup_default(
+             edges[side], (uint)(e[0] - offset), (uint)(e[1] - offset), POINTER_FROM_INT(-1)));
+}
+
+static Mesh *bool_mesh_create(const BoolState *s,
+                              const BoolResult *r,
+                              const short *material_remap_b,
+                              const int material_remap_b_len)
+{
+  const Mesh *mesh_a = s->mesh[0];
+
+  /* Points used by the result become its vertices, in order. */
+  int *point_vert = MEM_malloc_arrayN((size_t)s->points_len, sizeof(*point_vert), __func__);
+  copy_vn_i(point_vert, s->points_len, -1);
+  for (int i = 0; i < r->corners_len; i++) {
+    point_vert[r->corners[i].point] = 0;
+  }
+  int verts_len = 0;
+  for (int i = 0; i < s->points_len; i++) {
+    if (point_vert[i] != -1) {
+      point_vert[i] = verts_len++;
+    }
+  }
+  int *vert_point = MEM_malloc_arrayN((size_t)max_ii(verts_len, 1), sizeof(*vert_point), __func__);
+  for (int i = 0; i < s->points_len; i++) {
+    if (point_vert[i] != -1) {
+      vert_point[point_vert[i]] = i;
+    }
+  }
+
+  EdgeHash *result_edges = BLI_edgehash_new_ex(__func__,
+                                               BLI_EDGEHASH_SIZE_GUESS_FROM_POLYS(r->faces_len));
+  for (int i = 0; i < r->faces_len; i++) {
+    const BoolFace *face = &r->faces[i];
+    for (int j = 0; j < face->corners_len; j++) {
+      const int v0 = point_vert[r->corners[face->corner_start + j].point];
+      const int v1 = point_vert[r->corners[face->corner_start + (j + 1) % face->corners_len].point];
+      void **val_p;
+      if (!BLI_edgehash_ensure_p(result_edges, (uint)v0, (uint)v1, &val_p)) {
+        *val_p = POINTER_FROM_INT((int)BLI_edgehash_len(result_edges) - 1);
+      }
+    }
+  }
+  const int edges_len = (int)BLI_edgehash_len(result_edges);
+
+  Mesh *result = BKE_mesh_new_nomain_from_template(
+      mesh_a, verts_len, edges_len, 0, r->corners_len, r->faces_len);
+
+  /* Layers of operand B are added by name, the ones which aren't part of a mesh are left out
+   * since they refer to its own original data. */
+  const Mesh *mesh_b = s->mesh[1];
+  CustomData data_b[4], scratch[2][4];
+  CustomData_copy(&mesh_b->vdata, &data_b[0], CD_MASK_MESH.vmask, CD_REFERENCE, mesh_b->totvert);
+  CustomData_copy(&mesh_b->edata, &data_b[1], CD_MASK_MESH.emask, CD_REFERENCE, mesh_b->totedge);
+  CustomData_copy(&mesh_b->ldata, &data_b[2], CD_MASK_MESH.lmask, CD_REFERENCE, mesh_b->totloop);
+  CustomData_copy(&mesh_b->pdata, &data_b[3], CD_MASK_MESH.pmask, CD_REFERENCE, mesh_b->totpoly);
+  CustomData_merge(&data_b[0], &result->vdata, CD_MASK_MESH.vmask, CD_CALLOC, verts_len);
+  CustomData_merge(&data_b[1], &result->edata, CD_MASK_MESH.emask, CD_CALLOC, edges_len);
+  CustomData_merge(&data_b[2], &result->ldata, CD_MASK_MESH.lmask, CD_CALLOC, r->corners_len);
+  CustomData_merge(&data_b[3], &result->pdata, CD_MASK_MESH.pmask, CD_CALLOC, r->faces_len);
+  BKE_mesh_update_customdata_pointers(result, false);
+  bool_origindex_clear(&result->vdata, verts_len);
+  bool_origindex_clear(&result->edata, edges_len);
+  bool_origindex_clear(&result->pdata, r->faces_len);
+
+  const CustomData *data_src[2][4] = {
+      {&mesh_a->vdata, &mesh_a->edata, &mesh_a->ldata, &mesh_a->pdata},
+      {&data_b[0], &data_b[1], &data_b[2], &data_b[3]},
+  };
+  for (int side = 0; side < 2; side++) {
+    CustomData_copy(data_src[side][0], &scratch[side][0], CD_MASK_MESH.vmask, CD_CALLOC, 1);
+    CustomData_copy(data_src[side][2], &scratch[side][2], CD_MASK_MESH.lmask, CD_CALLOC, 1);
+  }
+
+  /* Vertices. */
+  for (int i = 0; i < verts_len; i++) {
+    const int point = vert_point[i];
+    if (point < s->verts_len) {
+      const int side = bool_vert_side(s, point);
+      CustomData_copy_data_named(
+          data_src[side][0], &result->vdata, point - (side ? s->vert_offset_b : 0), i, 1);
+    }
+    else {
+      const BoolPoint *p = &s->points[point - s->verts_len];
+      const int side = bool_vert_side(s, p->v[0]);
+      const int offset = side ? s->vert_offset_b : 0;
+      const int src[3] = {p->v[0] - offset, p->v[1] - offset, p->v[2] - offset};
+      bool_customdata_interp_named(data_src[side][0],
+                                   &scratch[side][0],
+                                   &result->vdata,
+                                   src,
+                                   p->w,
+                                   (p->v[2] == -1) ? 2 : 3,
+                                   i);
+    }
+    copy_v3fl_v3db(result->mvert[i].co, s->co[point]);
+  }
+
+  /* Edges, with the data of the edge of the operands they are part of. */
+  EdgeHash *src_edges[2];
+  for (int side = 0; side < 2; side++) {
+    const Mesh *mesh = s->mesh[side];
+    src_edges[side] = BLI_edgehash_new_ex(__func__, (uint)mesh->totedge);
+    for (int i = 0; i < mesh->totedge; i++) {
+      BLI_edgehash_insert(
+          src_edges[side], mesh->medge[i].v1, mesh->medge[i].v2, POINTER_FROM_INT(i));
+    }
+  }
+  EdgeHashIterator *ehi;
+  for (ehi = BLI_edgehashIterator_new(result_edges); !BLI_edgehashIterator_isDone(ehi);
+       BLI_edgehashIterator_step(ehi)) {
+    uint v0, v1;
+    BLI_edgehashIterator_getKey(ehi, &v0, &v1);
+    const int i = POINTER_AS_INT(BLI_edgehashIterator_getValue(ehi));
+    const int p0 = vert_point[v0], p1 = vert_point[v1];
+    const int src = bool_edge_source(s, src_edges, p0, p1);
+    MEdge *med = &result->medge[i];
+    if (src != -1) {
+      const int side = bool_vert_side(s, p0 < s->verts_len ? p0 : s->points[p0 - s->verts_len].v[0]);
+      CustomData_copy_data_named(data_src[side][1], &result->edata, src, i, 1);
+    }
+    else {
+      med->flag = ME_EDGEDRAW | ME_EDGERENDER;
+    }
+    med->v1 = v0;
+    med->v2 = v1;
+  }
+  BLI_edgehashIterator_free(ehi);
+  BLI_edgehash_free(src_edges[0], NULL);
+  BLI_edgehash_free(src_edges[1], NULL);
+
+  /* Faces and their loops. */
+  float(*poly_co)[3] = NULL;
+  float *poly_weights = NULL;
+  int *poly_loops = NULL;
+  int poly_alloc = 0;
+  for (int i = 0; i < r->faces_len; i++) {
+    const BoolFace *face = &r->faces[i];
+    const int side = face->poly >= s->poly_offset_b;
+    const Mesh *mesh = s->mesh[side];
+    const int poly_src = face->poly - (side ? s->poly_offset_b : 0);
+    const MPoly *mp_src = &mesh->mpoly[poly_src];
+    const int vert_offset = side ? s->vert_offset_b : 0;
+    const int loop_offset = side ? s->loop_offset_b : 0;
+
+    CustomData_copy_data_named(data_src[side][3], &result->pdata, poly_src, i, 1);
+    MPoly *mp = &result->mpoly[i];
+    mp->loopstart = face->corner_start;
+    mp->totloop = face->corners_len;
+    if (side && material_remap_b && mp->mat_nr < material_remap_b_len) {
+      mp->mat_nr = material_remap_b[mp->mat_nr];
+    }
+
+    bool use_poly_co = false;
+    for (int j = 0; j < face->corners_len; j++) {
+      const int l = face->corner_start + j;
+      const BoolCorner *corner = &r->corners[l];
+      int loop_src = corner->loop;
+      if (loop_src == -1) {
+        /* Corners at a vertex of the face are copied. */
+        for (int k = 0; k < mp_src->totloop; k++) {
+          if ((int)mesh->mloop[mp_src->loopstart + k].v + vert_offset == corner->point) {
+            loop_src = loop_offset + mp_src->loopstart + k;
+            break;
+          }
+        }
+      }
+      if (loop_src != -1) {
+        CustomData_copy_data_named(data_src[side][2], &result->ldata, loop_src - loop_offset, l, 1);
+      }
+      else {
+        if (!use_poly_co) {
+          if (mp_src->totloop > poly_alloc) {
+            poly_alloc = mp_src->totloop;
+            poly_co = MEM_reallocN(poly_co, sizeof(*poly_co) * (size_t)poly_alloc);
+            poly_weights = MEM_reallocN(poly_weights, sizeof(*poly_weights) * (size_t)poly_alloc);
+            poly_loops = MEM_reallocN(poly_loops, sizeof(*poly_loops) * (size_t)poly_alloc);
+          }
+          for (int k = 0; k < mp_src->totloop; k++) {
+            const int v = (int)mesh->mloop[mp_src->loopstart + k].v + vert_offset;
+            copy_v3fl_v3db(poly_co[k], s->co[v]);
+            poly_loops[k] = mp_src->loopstart + k;
+          }
+          use_poly_co = true;
+        }
+        float co[3];
+        copy_v3fl_v3db(co, s->co[corner->point]);
+        interp_weights_poly_v3(poly_weights, poly_co, mp_src->totloop, co);
+        bool_customdata_interp_named(data_src[side][2],
+                                     &scratch[side][2],
+                                     &result->ldata,
+                                     poly_loops,
+                                     poly_weights,
+                                     mp_src->totloop,
+                                     l);
+      }
+    }
+    for (int j = 0; j < face->corners_len; j++) {
+      const int l = face->corner_start + j;
+      const int v0 = point_vert[r->corners[l].point];
+      const int v1 = point_vert[r->corners[face->corner_start + (j + 1) % face->corners_len].point];
+      result->mloop[l].v = (uint)v0;
+      result->mloop[l].e = (uint)POINTER_AS_INT(BLI_edgehash_lookup(result_edges, (uint)v0, (uint)v1));
+    }
+  }
+  MEM_SAFE_FREE(poly_co);
+  MEM_SAFE_FREE(poly_weights);
+  MEM_SAFE_FREE(poly_loops);
+
+  for (int side = 0; side < 2; side++) {
+    CustomData_free(&scratch[side][0], 1);
+    CustomData_free(&scratch[side][2], 1);
+  }
+  CustomData_free(&data_b[0], mesh_b->totvert);
+  CustomData_free(&data_b[1], mesh_b->totedge);
+  CustomData_free(&data_b[2], mesh_b->totloop);
+  CustomData_free(&data_b[3], mesh_b->totpoly);
+
+  BLI_edgehash_free(result_edges, NULL);
+  MEM_freeN(vert_point);
+  MEM_freeN(point_vert);
+
+  result->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+  return result;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Boolean
+ * \{ */
+
+/**
+ * Boolean operation of two meshes.
+ *
+ * \param mat_b: Transform of \a mesh_b into the space of \a mesh_a.
+ * \param flip_b: Reverse the faces of \a mesh_b, for a transform with a negative scale.
+ * \param material_remap_b: Material indices of \a mesh_b in \a mesh_a, optional.
+ * \param operation: One of #BooleanModifierOp.
+ * \return A new mesh with the layers of both meshes.
+ */
+Mesh *BKE_mesh_boolean(const Mesh *mesh_a,
+                       const Mesh *mesh_b,
+                       const float mat_b[4][4],
+                       const bool flip_b,
+                       const short *material_remap_b,
+                       const int material_remap_b_len,
+                       const int operation)
+{
+  BoolState s;
+  bool_state_init(&s, mesh_a, mesh_b, mat_b);
+
+  int segments_len;
+  BoolSegment *segments = bool_segments_calc(&s, &segments_len);
+  if (segments_len != 0) {
+    bool_segment_points_add(&s, segments, segments_len);
+  }
+
+  /* Segments of each triangle. */
+  int *tri_segments_start = MEM_calloc_arrayN(
+      (size_t)s.tris_len + 1, sizeof(*tri_segments_start), __func__);
+  int *tri_segments = MEM_malloc_arrayN(
+      (size_t)max_ii(segments_len * 2, 1), sizeof(*tri_segments), __func__);
+  for (int i = 0; i < segments_len; i++) {
+    tri_segments_start[segments[i].tri[0] + 1]++;
+    tri_segments_start[segments[i].tri[1] + 1]++;
+  }
+  int split_tris_len = 0;
+  for (int i = 0; i < s.tris_len; i++) {
+    split_tris_len += (tri_segments_start[i + 1] != 0);
+    tri_segments_start[i + 1] += tri_segments_start[i];
+  }
+  {
+    int *fill = MEM_dupallocN(tri_segments_start);
+    for (int i = 0; i < segments_len; i++) {
+      tri_segments[fill[segments[i].tri[0]]++] = i;
+      tri_segments[fill[segments[i].tri[1]]++] = i;
+    }
+    MEM_freeN(fill);
+  }
+  int *split_tris = MEM_malloc_arrayN((size_t)max_ii(split_tris_len, 1), sizeof(*split_tris), __func__);
+  int *tri_split = MEM_malloc_arrayN((size_t)max_ii(s.tris_len, 1), sizeof(*tri_split), __func__);
+  split_tris_len = 0;
+  for (int i = 0; i < s.tris_len; i++) {
+    if (tri_segments_start[i + 1] != tri_segments_start[i]) {
+      tri_split[i] = split_tris_len;
+      split_tris[split_tris_len++] = i;
+    }
+    else {
+      tri_split[i] = -1;
+    }
+  }
+
+  /* Split the intersected triangles. */
+  BoolTriSplit *splits = MEM_malloc_arrayN(
+      (size_t)max_ii(split_tris_len, 1), sizeof(*splits), __func__);
+  {
+    BoolSplitData data = {
+        .s = &s,
+        .segments = segments,
+        .tri_segments = tri_segments,
+        .tri_segments_start = tri_segments_start,
+        .split_tris = split_tris,
+        .splits = splits,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (split_tris_len > 1);
+    BLI_task_parallel_range(0, split_tris_len, &data, bool_tri_split_cb, &settings);
+  }
+  MEM_SAFE_FREE(segments);
+  MEM_freeN(tri_segments);
+  MEM_freeN(tri_segments_start);
+
+  /* Add the points of the triangulation. */
+  int *new_point_start = MEM_malloc_arrayN(
+      (size_t)max_ii(split_tris_len, 1), sizeof(*new_point_start), __func__);
+  {
+    int new_len = 0;
+    for (int i = 0; i < split_tris_len; i++) {
+      new_len += splits[i].new_len;
+    }
+    int index = (new_len != 0) ? bool_points_add(&s, new_len) : s.points_len;
+    for (int i = 0; i < split_tris_len; i++) {
+      const BoolTri *tri = &s.tris[split_tris[i]];
+      new_point_start[i] = index;
+      for (int j = 0; j < splits[i].new_len; j++, index++) {
+        BoolPoint *point = &s.points[index - s.verts_len];
+        copy_v3_v3_db(s.co[index], splits[i].new_co[j]);
+        point->key.v[0] = point->key.v[1] = -1;
+        point->key.tri = -1;
+        copy_v3_v3_int(point->v, tri->v);
+        copy_v3_v3(point->w, splits[i].new_weights[j]);
+      }
+    }
+  }
+
+  /* Weld the points merged by the triangulation, then the ones at the same place. */
+  int *parent = MEM_malloc_arrayN((size_t)s.points_len, sizeof(*parent), __func__);
+  for (int i = 0; i < s.points_len; i++) {
+    parent[i] = i;
+  }
+  for (int i = 0; i < split_tris_len; i++) {
+    for (int j = 0; j < splits[i].merge_len; j++) {
+      bool_weld_union(parent, splits[i].merge[j][0], splits[i].merge[j][1]);
+    }
+  }
+  {
+    bool *vert_is_split = MEM_calloc_arrayN((size_t)s.verts_len, sizeof(*vert_is_split), __func__);
+    for (int i = 0; i < split_tris_len; i++) {
+      for (int j = 0; j < 3; j++) {
+        vert_is_split[s.tris[split_tris[i]].v[j]] = true;
+      }
+    }
+    bool_weld_coincident(&s, parent, vert_is_split);
+    MEM_freeN(vert_is_split);
+  }
+
+#define SPLIT_POINT(i, ref) (((ref) < 0) ? new_point_start[i] - 1 - (ref) : (ref))
+
+  /* Pieces of all triangles, the ones collapsed or flattened by welding are left out, the edges
+   * of their neighbors are split by #bool_result_slivers_split. */
+  const double epsilon = (double)FLT_EPSILON * s.size;
+  int pieces_alloc = s.tris_len;
+  for (int i = 0; i < split_tris_len; i++) {
+    pieces_alloc += splits[i].tris_len - 1;
+  }
+  BoolPiece *pieces = MEM_malloc_arrayN((size_t)max_ii(pieces_alloc, 1), sizeof(*pieces), __func__);
+  int pieces_len = 0;
+  for (int t = 0; t < s.tris_len; t++) {
+    const int split_index = tri_split[t];
+    const int tris_len = (split_index != -1) ? splits[split_index].tris_len : 1;
+    for (int i = 0; i < tris_len; i++) {
+      BoolPiece *piece = &pieces[pieces_len];
+      for (int j = 0; j < 3; j++) {
+        const int ref = (split_index != -1) ? splits[split_index].tris[i][j] : s.tris[t].v[j];
+        piece->v[j] = bool_weld_find(parent, SPLIT_POINT(split_index, ref));
+      }
+      if (ELEM(piece->v[0], piece->v[1], piece->v[2]) || piece->v[1] == piece->v[2]) {
+        continue;
+      }
+      if (split_index != -1 && bool_tri_is_flat(&s, piece->v, epsilon)) {
+        continue;
+      }
+      piece->tri = t;
+      pieces_len++;
+    }
+  }
+
+  EdgeSet *segment_edges = BLI_edgeset_new(__func__);
+  for (int i = 0; i < split_tris_len; i++) {
+    for (int j = 0; j < splits[i].edges_len; j++) {
+      const int v0 = bool_weld_find(parent, SPLIT_POINT(i, splits[i].edges[j][0]));
+      const int v1 = bool_weld_find(parent, SPLIT_POINT(i, splits[i].edges[j][1]));
+      if (v0 != v1) {
+        BLI_edgeset_add(segment_edges, (uint)v0, (uint)v1);
+      }
+    }
+  }
+
+#undef SPLIT_POINT
+
+  for (int i = 0; i < split_tris_len; i++) {
+    bool_tri_split_free(&splits[i]);
+  }
+  MEM_freeN(splits);
+  MEM_freeN(new_point_start);
+  MEM_freeN(split_tris);
+
+  bool *patch_inside;
+  bool_patches_calc(&s, pieces, pieces_len, segment_edges, &patch_inside);
+  BLI_edgeset_free(segment_edges);
+
+  /* Keep the pieces inside or outside of the other operand, by face. */
+  const int polys_len = s.poly_offset_b + mesh_b->totpoly;
+  BoolResult r = {NULL};
+  r.faces = MEM_malloc_arrayN(
+      (size_t)max_ii(pieces_len + polys_len, 1), sizeof(*r.faces), __func__);
+  r.corners = MEM_malloc_arrayN(
+      (size_t)max_ii(pieces_len * 3 + s.loop_offset_b + mesh_b->totloop, 1),
+      sizeof(*r.corners),
+      __func__);
+  int *group = MEM_malloc_arrayN((size_t)max_ii(pieces_len, 1), sizeof(*group), __func__);
+  int(*edges)[2] = MEM_malloc_arrayN((size_t)max_ii(pieces_len * 3, 1), sizeof(*edges), __func__);
+  int *outline = MEM_malloc_arrayN((size_t)max_ii(pieces_len * 3, 1), sizeof(*outline), __func__);
+
+  for (int i = 0; i < pieces_len;) {
+    const int poly = s.tris[pieces[i].tri].poly;
+    int i_end = i + 1;
+    bool is_split = (tri_split[pieces[i].tri] != -1);
+    while (i_end < pieces_len && s.tris[pieces[i_end].tri].poly == poly) {
+      is_split |= (tri_split[pieces[i_end].tri] != -1);
+      i_end++;
+    }
+
+    const int side = poly >= s.poly_offset_b;
+    const bool flip = side && (flip_b != (operation == eBooleanModifierOp_Difference));
+
+    /* Faces which aren't intersected are copied when they're kept. */
+    if (!is_split) {
+      const bool inside = patch_inside[pieces[i].patch];
+      bool keep;
+      if (side == 0) {
+        keep = (operation == eBooleanModifierOp_Intersect) ? inside : !inside;
+      }
+      else {
+        keep = (operation == eBooleanModifierOp_Union) ? !inside : inside;
+      }
+      if (keep) {
+        const Mesh *mesh = s.mesh[side];
+        const MPoly *mp = &mesh->mpoly[poly - (side ? s.poly_offset_b : 0)];
+        const int vert_offset = side ? s.vert_offset_b : 0;
+        const int loop_offset = side ? s.loop_offset_b : 0;
+        bool_result_face_add(&r, poly);
+        for (int j = 0; j < mp->totloop; j++) {
+          const int k = mp->loopstart + (flip ? mp->totloop - 1 - j : j);
+          bool_result_corner_add(&r,
+                                 bool_weld_find(parent, (int)mesh->mloop[k].v + vert_offset),
+                                 loop_offset + k);
+        }
+      }
+      i = i_end;
+      continue;
+    }
+
+    /* Pieces of intersected faces are joined by patch. */
+    int group_len;
+    for (int j = i; j < i_end; j++) {
+      const int patch = pieces[j].patch;
+      if (patch == -1) {
+        continue;
+      }
+      const bool inside = patch_inside[patch];
+      bool keep;
+      if (side == 0) {
+        keep = (operation == eBooleanModifierOp_Intersect) ? inside : !inside;
+      }
+      else {
+        keep = (operation == eBooleanModifierOp_Union) ? !inside : inside;
+      }
+      group_len = 0;
+      for (int k = j; k < i_end; k++) {
+        if (pieces[k].patch == patch) {
+          group[group_len++] = k;
+        }
+      }
+      if (keep) {
+        bool_result_poly_pieces_add(&r, pieces, group, group_len, poly, flip, edges, outline);
+      }
+      for (int k = 0; k < group_len; k++) {
+        pieces[group[k]].patch = -1;
+      }
+    }
+    i = i_end;
+  }
+  MEM_freeN(group);
+  MEM_freeN(edges);
+  MEM_freeN(outline);
+  MEM_freeN(patch_inside);
+  MEM_freeN(pieces);
+  MEM_freeN(tri_split);
+
+  bool_result_slivers_split(&s, &r);
+
+  Mesh *result = bool_mesh_create(&s, &r, material_remap_b, material_remap_b_len);
+
+  MEM_freeN(r.faces);
+  MEM_freeN(r.corners);
+  MEM_freeN(parent);
+  bool_state_free(&s);
+
+  return result;
+}
+
+/** \} */
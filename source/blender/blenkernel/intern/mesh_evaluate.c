@@ -90,6 +90,9 @@ static void mesh_calc_normals_vert_fallback(MVert *mverts, int numVerts)
 void BKE_mesh_calc_normals_mapping_simple(struct Mesh *mesh)
 {
   const bool only_face_normals = CustomData_is_referenced_layer(&mesh->vdata, CD_MVERT);
+  if (!only_face_normals) {
+    BKE_mesh_ensure_mvert_unshared(mesh);
+  }
 
   BKE_mesh_calc_normals_mapping_ex(mesh->mvert,
                                    mesh->totvert,
@@ -406,6 +409,10 @@ void BKE_mesh_ensure_normals_for_display(Mesh *mesh)
       poly_nors = MEM_malloc_arrayN((size_t)mesh->totpoly, sizeof(*poly_nors), __func__);
     }
 
+    if (do_vert_normals) {
+      BKE_mesh_ensure_mvert_unshared(mesh);
+    }
+
     /* calculate poly/vert normals */
     BKE_mesh_calc_normals_poly(mesh->mvert,
                                NULL,
@@ -433,6 +440,7 @@ void BKE_mesh_calc_normals(Mesh *mesh)
 #ifdef DEBUG_TIME
   TIMEIT_START_AVERAGED(BKE_mesh_calc_normals);
 #endif
+  BKE_mesh_ensure_mvert_unshared(mesh);
   BKE_mesh_calc_normals_poly(mesh->mvert,
                              NULL,
                              mesh->totvert,
@@ -237,6 +237,45 @@ void BKE_mesh_runtime_clear_geometry(Mesh *mesh)
   BKE_shrinkwrap_discard_boundary_data(mesh);
 }
 
+static bool mesh_runtime_topology_equals(const Mesh *mesh_a, const Mesh *mesh_b)
+{
+  if ((mesh_a->totvert != mesh_b->totvert) || (mesh_a->totedge != mesh_b->totedge) ||
+      (mesh_a->totloop != mesh_b->totloop) || (mesh_a->totpoly != mesh_b->totpoly) ||
+      (mesh_a->totface != mesh_b->totface)) {
+    return false;
+  }
+  if ((mesh_a->totface != 0) && ((mesh_a->mface == NULL) || (mesh_b->mface == NULL))) {
+    return false;
+  }
+  /* Flags are compared as well, they define the hidden and loose elements of the trees. */
+  return ((memcmp(mesh_a->medge, mesh_b->medge, sizeof(MEdge) * mesh_a->totedge) == 0) &&
+          (memcmp(mesh_a->mloop, mesh_b->mloop, sizeof(MLoop) * mesh_a->totloop) == 0) &&
+          (memcmp(mesh_a->mpoly, mesh_b->mpoly, sizeof(MPoly) * mesh_a->totpoly) == 0) &&
+          ((mesh_a->totface == 0) ||
+           (memcmp(mesh_a->mface, mesh_b->mface, sizeof(MFace) * mesh_a->totface) == 0)));
+}
+
+/**
+ * Move the cached BVH trees of \a mesh_src to \a mesh_dst when both have the same topology,
+ * so they are refit to the positions of \a mesh_dst instead of being built again.
+ * Used to keep the trees of a deforming mesh across evaluations.
+ *
+ * \return True when the trees were moved.
+ */
+bool BKE_mesh_runtime_bvh_cache_transfer(Mesh *mesh_src, Mesh *mesh_dst)
+{
+  if ((mesh_src->runtime.bvh_cache == NULL) || (mesh_dst->runtime.bvh_cache != NULL)) {
+    return false;
+  }
+  if (!mesh_runtime_topology_equals(mesh_src, mesh_dst)) {
+    return false;
+  }
+  mesh_dst->runtime.bvh_cache = mesh_src->runtime.bvh_cache;
+  mesh_src->runtime.bvh_cache = NULL;
+  bvhcache_tag_coords_changed(mesh_dst->runtime.bvh_cache);
+  return true;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
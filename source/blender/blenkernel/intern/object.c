@@ -514,6 +514,7 @@ void BKE_object_free(Object *ob)
 
   /* BKE_<id>_free shall never touch to ID->us. Never ever. */
   BKE_object_free_modifiers(ob, LIB_ID_CREATE_NO_USER_REFCOUNT);
+  mesh_modifier_stack_cache_free(ob);
   BKE_object_free_shaderfx(ob, LIB_ID_CREATE_NO_USER_REFCOUNT);
 
   MEM_SAFE_FREE(ob->mat);
@@ -3929,6 +3930,7 @@ void BKE_object_runtime_reset_on_copy(Object *object, const int UNUSED(flag))
   runtime->mesh_deform_eval = NULL;
   runtime->curve_cache = NULL;
   runtime->gpencil_cache = NULL;
+  runtime->modifier_stack_cache = NULL;
 }
 
 /*
@@ -331,6 +331,7 @@ typedef struct VertexDupliData {
 
   const DupliContext *ctx;
   Object *inst_ob; /* object to instantiate (argument for vertex map callback) */
+  float inst_imat[4][4];
   float child_imat[4][4];
 } VertexDupliData;
 
@@ -378,7 +379,7 @@ static void vertex_dupli(const VertexDupliData *vdd,
   /* space matrix is constructed by removing obmat transform,
    * this yields the worldspace transform for recursive duplis
    */
-  mul_m4_m4m4(space_mat, obmat, inst_ob->imat);
+  mul_m4_m4m4(space_mat, obmat, vdd->inst_imat);
 
   dob = make_dupli(vdd->ctx, vdd->inst_ob, obmat, index);
 
@@ -396,9 +397,10 @@ static void make_child_duplis_verts(const DupliContext *ctx, void *userdata, Obj
   Mesh *me_eval = vdd->me_eval;
 
   vdd->inst_ob = child;
-  invert_m4_m4(child->imat, child->obmat);
+  /* Not stored in the child, metaballs build instance lists while other objects are evaluated. */
+  invert_m4_m4(vdd->inst_imat, child->obmat);
   /* relative transform from parent to child space */
-  mul_m4_m4m4(vdd->child_imat, child->imat, ctx->object->obmat);
+  mul_m4_m4m4(vdd->child_imat, vdd->inst_imat, ctx->object->obmat);
 
   const MVert *mvert = me_eval->mvert;
   for (int i = 0; i < me_eval->totvert; i++) {
@@ -616,12 +618,12 @@ static void make_child_duplis_faces(const DupliContext *ctx, void *userdata, Obj
   float(*orco)[3] = fdd->orco;
   MLoopUV *mloopuv = fdd->mloopuv;
   int a, totface = fdd->totface;
-  float child_imat[4][4];
+  float inst_imat[4][4], child_imat[4][4];
   DupliObject *dob;
 
-  invert_m4_m4(inst_ob->imat, inst_ob->obmat);
+  invert_m4_m4(inst_imat, inst_ob->obmat);
   /* relative transform from parent to child space */
-  mul_m4_m4m4(child_imat, inst_ob->imat, ctx->object->obmat);
+  mul_m4_m4m4(child_imat, inst_imat, ctx->object->obmat);
 
   for (a = 0, mp = mpoly; a < totface; a++, mp++) {
     MLoop *loopstart = mloop + mp->loopstart;
@@ -653,7 +655,7 @@ static void make_child_duplis_faces(const DupliContext *ctx, void *userdata, Obj
     /* space matrix is constructed by removing obmat transform,
      * this yields the worldspace transform for recursive duplis
      */
-    mul_m4_m4m4(space_mat, obmat, inst_ob->imat);
+    mul_m4_m4m4(space_mat, obmat, inst_imat);
 
     dob = make_dupli(ctx, inst_ob, obmat, a);
 
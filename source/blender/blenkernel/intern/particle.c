@@ -2284,10 +2284,32 @@ void psys_find_parents(ParticleSimulationData *sim, const bool use_render_params
 
   BLI_kdtree_3d_balance(tree);
 
-  for (; p < totchild; p++, cpa++) {
-    psys_particle_on_emitter(
-        sim->psmd, from, cpa->num, DMCACHE_ISCHILD, cpa->fuv, cpa->foffset, co, 0, 0, 0, orco);
-    cpa->parent = BLI_kdtree_3d_find_nearest(tree, orco, NULL);
+  /* Find the parents of the remaining children in one batch. */
+  if (p < totchild) {
+    const int orco_len = totchild - p;
+    float(*orcos)[3] = MEM_malloc_arrayN((size_t)orco_len, sizeof(*orcos), __func__);
+    KDTreeNearest_3d *nearest = MEM_malloc_arrayN((size_t)orco_len, sizeof(*nearest), __func__);
+
+    for (int i = 0; i < orco_len; i++) {
+      psys_particle_on_emitter(sim->psmd,
+                               from,
+                               cpa[i].num,
+                               DMCACHE_ISCHILD,
+                               cpa[i].fuv,
+                               cpa[i].foffset,
+                               co,
+                               0,
+                               0,
+                               0,
+                               orcos[i]);
+    }
+    BLI_kdtree_3d_find_nearest_batch(tree, (const float(*)[3])orcos, (uint)orco_len, nearest);
+    for (int i = 0; i < orco_len; i++) {
+      cpa[i].parent = nearest[i].index;
+    }
+
+    MEM_freeN(orcos);
+    MEM_freeN(nearest);
   }
 
   BLI_kdtree_3d_free(tree);
@@ -110,6 +110,31 @@ struct PBVHTask {
   }
 };
 
+#else
+
+/* Without TBB, use adaptive range splitting of BLI_task_parallel_range(), with
+ * the reduction done from the finalize callback of every thread chunk. */
+struct PBVHTaskData {
+  PBVHParallelRangeFunc func;
+  void *userdata;
+  const PBVHParallelSettings *settings;
+};
+
+static void pbvh_parallel_range_func(void *__restrict userdata,
+                                     const int iter,
+                                     const TaskParallelTLS *__restrict tls)
+{
+  PBVHTaskData *data = (PBVHTaskData *)userdata;
+  data->func(data->userdata, iter, tls);
+}
+
+static void pbvh_parallel_range_finalize(void *__restrict userdata,
+                                         void *__restrict userdata_chunk)
+{
+  PBVHTaskData *data = (PBVHTaskData *)userdata;
+  data->settings->func_reduce(data->userdata, data->settings->userdata_chunk, userdata_chunk);
+}
+
 #endif
 
 void BKE_pbvh_parallel_range(const int start,
@@ -133,6 +158,28 @@ void BKE_pbvh_parallel_range(const int start,
       parallel_for(tbb::blocked_range<int>(start, stop), task);
     }
 
+    return;
+  }
+#else
+  if (settings->use_threading) {
+    PBVHTaskData data;
+    data.func = func;
+    data.userdata = userdata;
+    data.settings = settings;
+
+    /* Nodes are rather expensive to process, allow every single one of them
+     * to be handled by its own thread. */
+    TaskParallelSettings task_settings;
+    BLI_parallel_range_settings_defaults(&task_settings);
+    task_settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+    task_settings.min_iter_per_thread = 1;
+    task_settings.userdata_chunk = settings->userdata_chunk;
+    task_settings.userdata_chunk_size = settings->userdata_chunk_size;
+    if (settings->func_reduce && settings->userdata_chunk) {
+      task_settings.func_finalize = pbvh_parallel_range_finalize;
+    }
+
+    BLI_task_parallel_range(start, stop, &data, pbvh_parallel_range_func, &task_settings);
     return;
   }
 #endif
@@ -36,8 +36,10 @@ struct BLI_mempool;
 
 /* Task Scheduler
  *
- * Central scheduler that holds running threads ready to execute tasks. A single
- * queue holds the task from all pools.
+ * Central scheduler that holds running threads ready to execute tasks. Every
+ * thread has its own work-stealing deque for the tasks it spawns, idle threads
+ * steal tasks from the deques of other threads. A global queue holds low
+ * priority tasks and tasks pushed from threads not handled by the scheduler.
  *
  * Init/exit must be called before/after any task pools are created/freed, and
  * must be called from the main threads. All other scheduler and pool functions
@@ -172,7 +174,9 @@ typedef struct TaskParallelSettings {
    */
   TaskParallelFinalizeFunc func_finalize;
   /* Minimum allowed number of range iterators to be handled by a single
-   * thread. This allows to achieve following:
+   * thread (for BLI_task_parallel_range() the minimum amount of iterations
+   * handled at once, the actual amount is adapted to the cost of iterations).
+   * This allows to achieve following:
    * - Reduce amount of threading overhead.
    * - Partially occupy thread pool with ranges which are computationally
    *   expensive, but which are smaller than amount of available threads.
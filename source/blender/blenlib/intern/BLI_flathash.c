@@ -0,0 +1,693 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * A general (pointer -> pointer) hash table using open addressing.
+ *
+ * Entries are stored densely in an array, a separate map of slots stores indices into it
+ * (the same layout as edgehash.c). Lookups don't need to follow a pointer per element
+ * and the full hash of every entry is kept, so growing never calls the hash function
+ * and most key comparisons are skipped.
+ *
+ * \note The API matches BLI_ghash.c, except that pointers to keys and values
+ * are only valid until the next insertion or removal.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_flathash.h"
+#include "BLI_strict_flags.h"
+
+typedef struct _FlatHash_Entry FlatHashEntry;
+
+struct FlatHash {
+  GHashHashFP hashfp;
+  GHashCmpFP cmpfp;
+
+  FlatHashEntry *entries;
+  int32_t *map;
+  uint32_t slot_mask;
+  uint capacity_exp;
+  uint length;
+  uint dummy_count;
+};
+
+/* -------------------------------------------------------------------- */
+/** \name Internal Helper Macros & Defines
+ * \{ */
+
+#define ENTRIES_CAPACITY(container) (uint)(1 << (container)->capacity_exp)
+#define MAP_CAPACITY(container) (uint)(1 << ((container)->capacity_exp + 1))
+#define CLEAR_MAP(container) \
+  memset((container)->map, 0xFF, sizeof(int32_t) * MAP_CAPACITY(container))
+#define UPDATE_SLOT_MASK(container) \
+  { \
+    (container)->slot_mask = MAP_CAPACITY(container) - 1; \
+  } \
+  ((void)0)
+#define PERTURB_SHIFT 5
+
+#define ITER_SLOTS(CONTAINER, HASH, SLOT, INDEX) \
+  uint32_t mask = (CONTAINER)->slot_mask; \
+  uint32_t perturb = (HASH); \
+  int32_t *map = (CONTAINER)->map; \
+  uint32_t SLOT = mask & (HASH); \
+  int INDEX = map[SLOT]; \
+  for (;; SLOT = mask & ((5 * SLOT) + 1 + perturb), perturb >>= PERTURB_SHIFT, INDEX = map[SLOT])
+
+#define SLOT_EMPTY -1
+#define SLOT_DUMMY -2
+
+#define CAPACITY_EXP_DEFAULT 3
+
+/* Compare the stored hash first, the compare callback is only needed on collisions. */
+#define FH_INDEX_HAS_KEY(fh, index, hash, key) \
+  ((index) >= 0 && (fh)->entries[index].hash == (hash) && \
+   !(fh)->cmpfp((key), (fh)->entries[index].key))
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Internal Utility API
+ * \{ */
+
+static uint calc_capacity_exp_for_reserve(uint reserve)
+{
+  uint result = 1;
+  while (reserve >>= 1) {
+    result++;
+  }
+  return result;
+}
+
+static void flathash_free_entries(FlatHash *fh,
+                                  GHashKeyFreeFP keyfreefp,
+                                  GHashValFreeFP valfreefp)
+{
+  if (keyfreefp || valfreefp) {
+    for (uint i = 0; i < fh->length; i++) {
+      if (keyfreefp) {
+        keyfreefp(fh->entries[i].key);
+      }
+      if (valfreefp) {
+        valfreefp(fh->entries[i].val);
+      }
+    }
+  }
+}
+
+BLI_INLINE void flathash_insert_index(FlatHash *fh, uint hash, uint entry_index)
+{
+  ITER_SLOTS (fh, hash, slot, index) {
+    if (index == SLOT_EMPTY) {
+      fh->map[slot] = (int32_t)entry_index;
+      break;
+    }
+  }
+}
+
+/**
+ * Reallocate for the given capacity, this also removes all dummy slots from the map.
+ */
+static void flathash_resize(FlatHash *fh, const uint capacity_exp)
+{
+  if (capacity_exp != fh->capacity_exp) {
+    BLI_assert(fh->length < (1u << capacity_exp));
+    fh->capacity_exp = capacity_exp;
+    UPDATE_SLOT_MASK(fh);
+    fh->entries = MEM_reallocN(fh->entries, sizeof(FlatHashEntry) * ENTRIES_CAPACITY(fh));
+    MEM_freeN(fh->map);
+    fh->map = MEM_malloc_arrayN(sizeof(int32_t), MAP_CAPACITY(fh), "fh map");
+  }
+  fh->dummy_count = 0;
+  CLEAR_MAP(fh);
+  for (uint i = 0; i < fh->length; i++) {
+    flathash_insert_index(fh, fh->entries[i].hash, i);
+  }
+}
+
+/**
+ * \return true when the map was rebuilt, slots found before are invalid then.
+ */
+BLI_INLINE bool flathash_ensure_can_insert(FlatHash *fh)
+{
+  if (UNLIKELY(ENTRIES_CAPACITY(fh) <= fh->length + fh->dummy_count)) {
+    /* When most used slots are dummies, rebuilding the map is enough to make room. */
+    const bool grow = ENTRIES_CAPACITY(fh) <= fh->length * 2;
+    flathash_resize(fh, grow ? fh->capacity_exp + 1 : fh->capacity_exp);
+    return true;
+  }
+  return false;
+}
+
+BLI_INLINE FlatHashEntry *flathash_insert_at_slot(
+    FlatHash *fh, uint slot, uint hash, void *key, void *val)
+{
+  FlatHashEntry *entry = &fh->entries[fh->length];
+  entry->key = key;
+  entry->val = val;
+  entry->hash = hash;
+  fh->map[slot] = (int32_t)fh->length;
+  fh->length++;
+  return entry;
+}
+
+BLI_INLINE FlatHashEntry *flathash_insert(FlatHash *fh, uint hash, void *key, void *val)
+{
+  ITER_SLOTS (fh, hash, slot, index) {
+    if (index == SLOT_EMPTY) {
+      return flathash_insert_at_slot(fh, slot, hash, key, val);
+    }
+    else if (index == SLOT_DUMMY) {
+      fh->dummy_count--;
+      return flathash_insert_at_slot(fh, slot, hash, key, val);
+    }
+  }
+}
+
+BLI_INLINE FlatHashEntry *flathash_lookup_entry(FlatHash *fh, const void *key)
+{
+  const uint hash = fh->hashfp(key);
+
+  ITER_SLOTS (fh, hash, slot, index) {
+    if (FH_INDEX_HAS_KEY(fh, index, hash, key)) {
+      return &fh->entries[index];
+    }
+    else if (index == SLOT_EMPTY) {
+      return NULL;
+    }
+  }
+}
+
+/**
+ * Find the entry of \a key or add it with a NULL value.
+ *
+ * \return true when the key was found.
+ */
+BLI_INLINE bool flathash_ensure_entry(FlatHash *fh, void *key, FlatHashEntry **r_entry)
+{
+  const uint hash = fh->hashfp(key);
+  uint dummy_slot = UINT_MAX;
+
+  ITER_SLOTS (fh, hash, slot, index) {
+    if (FH_INDEX_HAS_KEY(fh, index, hash, key)) {
+      *r_entry = &fh->entries[index];
+      return true;
+    }
+    else if (index == SLOT_DUMMY) {
+      if (dummy_slot == UINT_MAX) {
+        dummy_slot = slot;
+      }
+    }
+    else if (index == SLOT_EMPTY) {
+      if (dummy_slot != UINT_MAX) {
+        /* Reuse a dummy slot, this never needs to grow the table. */
+        fh->dummy_count--;
+        *r_entry = flathash_insert_at_slot(fh, dummy_slot, hash, key, NULL);
+      }
+      else if (flathash_ensure_can_insert(fh)) {
+        *r_entry = flathash_insert(fh, hash, key, NULL);
+      }
+      else {
+        *r_entry = flathash_insert_at_slot(fh, slot, hash, key, NULL);
+      }
+      return false;
+    }
+  }
+}
+
+/**
+ * Point the slot which references \a old_index to \a new_index instead.
+ */
+BLI_INLINE void flathash_change_index(FlatHash *fh, uint hash, int old_index, int new_index)
+{
+  ITER_SLOTS (fh, hash, slot, index) {
+    if (index == old_index) {
+      fh->map[slot] = new_index;
+      break;
+    }
+  }
+}
+
+/**
+ * Remove the entry of \a key, the last entry is moved in its place to keep the entries dense.
+ *
+ * \return true when the key was found, its key and value are returned then.
+ */
+static bool flathash_pop(FlatHash *fh, const void *key, void **r_key, void **r_val)
+{
+  const uint hash = fh->hashfp(key);
+
+  ITER_SLOTS (fh, hash, slot, index) {
+    if (FH_INDEX_HAS_KEY(fh, index, hash, key)) {
+      *r_key = fh->entries[index].key;
+      *r_val = fh->entries[index].val;
+      fh->length--;
+      fh->dummy_count++;
+      fh->map[slot] = SLOT_DUMMY;
+      if ((uint)index < fh->length) {
+        fh->entries[index] = fh->entries[fh->length];
+        flathash_change_index(fh, fh->entries[index].hash, (int)fh->length, index);
+      }
+      return true;
+    }
+    else if (index == SLOT_EMPTY) {
+      return false;
+    }
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name FlatHash Public API
+ * \{ */
+
+/**
+ * Creates a new, empty FlatHash.
+ *
+ * \param hashfp: Hash callback.
+ * \param cmpfp: Comparison callback.
+ * \param info: Identifier string for the FlatHash.
+ * \param nentries_reserve: Optionally reserve the number of members that the hash will hold.
+ * Use this to avoid resizing buckets if the size is known or can be closely approximated.
+ * \return  An empty FlatHash.
+ */
+FlatHash *BLI_flathash_new_ex(GHashHashFP hashfp,
+                              GHashCmpFP cmpfp,
+                              const char *info,
+                              const uint nentries_reserve)
+{
+  FlatHash *fh = MEM_mallocN(sizeof(*fh), info);
+  fh->hashfp = hashfp;
+  fh->cmpfp = cmpfp;
+  fh->capacity_exp = calc_capacity_exp_for_reserve(nentries_reserve);
+  UPDATE_SLOT_MASK(fh);
+  fh->length = 0;
+  fh->dummy_count = 0;
+  fh->entries = MEM_malloc_arrayN(sizeof(FlatHashEntry), ENTRIES_CAPACITY(fh), "fh entries");
+  fh->map = MEM_malloc_arrayN(sizeof(int32_t), MAP_CAPACITY(fh), "fh map");
+  CLEAR_MAP(fh);
+  return fh;
+}
+
+/**
+ * Wraps #BLI_flathash_new_ex with zero entries reserved.
+ */
+FlatHash *BLI_flathash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+  return BLI_flathash_new_ex(hashfp, cmpfp, info, 1 << CAPACITY_EXP_DEFAULT);
+}
+
+/**
+ * Frees the FlatHash and its members.
+ *
+ * \param fh: The FlatHash to free.
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ */
+void BLI_flathash_free(FlatHash *fh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  flathash_free_entries(fh, keyfreefp, valfreefp);
+  MEM_freeN(fh->map);
+  MEM_freeN(fh->entries);
+  MEM_freeN(fh);
+}
+
+/**
+ * Reserve given amount of entries (resize \a fh accordingly if needed).
+ */
+void BLI_flathash_reserve(FlatHash *fh, const uint nentries_reserve)
+{
+  const uint capacity_exp = calc_capacity_exp_for_reserve(nentries_reserve);
+  if (capacity_exp > fh->capacity_exp) {
+    flathash_resize(fh, capacity_exp);
+  }
+}
+
+/**
+ * Insert a key/value pair into the \a fh.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique.
+ */
+void BLI_flathash_insert(FlatHash *fh, void *key, void *val)
+{
+  BLI_assert(BLI_flathash_haskey(fh, key) == false);
+  flathash_ensure_can_insert(fh);
+  flathash_insert(fh, fh->hashfp(key), key, val);
+}
+
+/**
+ * Inserts a new value to a key that may already be in ghash.
+ *
+ * Avoids #BLI_flathash_remove, #BLI_flathash_insert calls (double lookups)
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_flathash_reinsert(
+    FlatHash *fh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  FlatHashEntry *entry;
+  if (flathash_ensure_entry(fh, key, &entry)) {
+    if (keyfreefp) {
+      keyfreefp(entry->key);
+    }
+    if (valfreefp) {
+      valfreefp(entry->val);
+    }
+    entry->key = key;
+    entry->val = val;
+    return false;
+  }
+  entry->val = val;
+  return true;
+}
+
+/**
+ * Lookup the value of \a key in \a fh.
+ *
+ * \param key: The key to lookup.
+ * \returns the value for \a key or NULL.
+ *
+ * \note When NULL is a valid value, use #BLI_flathash_lookup_p to differentiate a missing key
+ * from a key with a NULL value. (Avoids calling #BLI_flathash_haskey before #BLI_flathash_lookup)
+ */
+void *BLI_flathash_lookup(FlatHash *fh, const void *key)
+{
+  FlatHashEntry *entry = flathash_lookup_entry(fh, key);
+  return entry ? entry->val : NULL;
+}
+
+/**
+ * A version of #BLI_flathash_lookup which accepts a fallback argument.
+ */
+void *BLI_flathash_lookup_default(FlatHash *fh, const void *key, void *val_default)
+{
+  FlatHashEntry *entry = flathash_lookup_entry(fh, key);
+  return entry ? entry->val : val_default;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a fh.
+ *
+ * \param key: The key to lookup.
+ * \returns the pointer to value for \a key or NULL.
+ *
+ * \note This has 2 main benefits over #BLI_flathash_lookup.
+ * - A NULL return always means that \a key isn't in \a fh.
+ * - The value can be modified in-place without further function calls (faster).
+ */
+void **BLI_flathash_lookup_p(FlatHash *fh, const void *key)
+{
+  FlatHashEntry *entry = flathash_lookup_entry(fh, key);
+  return entry ? &entry->val : NULL;
+}
+
+/**
+ * Ensure \a key is exists in \a fh.
+ *
+ * This handles the common situation where the caller needs ensure a key is added to \a fh,
+ * constructing a new value in the case the key isn't found.
+ * Otherwise use the existing value.
+ *
+ * \returns true when the value didn't need to be added.
+ * (when false, the caller _must_ initialize the value).
+ */
+bool BLI_flathash_ensure_p(FlatHash *fh, void *key, void ***r_val)
+{
+  FlatHashEntry *entry;
+  const bool haskey = flathash_ensure_entry(fh, key, &entry);
+  *r_val = &entry->val;
+  return haskey;
+}
+
+/**
+ * Remove \a key from \a fh, or return false if the key wasn't found.
+ *
+ * \param key: The key to remove.
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ * \return true if \a key was removed from \a fh.
+ */
+bool BLI_flathash_remove(FlatHash *fh,
+                         const void *key,
+                         GHashKeyFreeFP keyfreefp,
+                         GHashValFreeFP valfreefp)
+{
+  void *key_removed, *val_removed;
+  if (flathash_pop(fh, key, &key_removed, &val_removed)) {
+    if (keyfreefp) {
+      keyfreefp(key_removed);
+    }
+    if (valfreefp) {
+      valfreefp(val_removed);
+    }
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Remove \a key from \a fh, returning the value or NULL if the key wasn't found.
+ *
+ * \param key: The key to remove.
+ * \param keyfreefp: Optional callback to free the key.
+ * \return the value of \a key in \a fh or NULL.
+ */
+void *BLI_flathash_popkey(FlatHash *fh, const void *key, GHashKeyFreeFP keyfreefp)
+{
+  void *key_removed, *val_removed;
+  if (flathash_pop(fh, key, &key_removed, &val_removed)) {
+    if (keyfreefp) {
+      keyfreefp(key_removed);
+    }
+    return val_removed;
+  }
+  return NULL;
+}
+
+/**
+ * \return true if the \a key is in \a fh.
+ */
+bool BLI_flathash_haskey(FlatHash *fh, const void *key)
+{
+  return flathash_lookup_entry(fh, key) != NULL;
+}
+
+/**
+ * \return size of the FlatHash.
+ */
+uint BLI_flathash_len(FlatHash *fh)
+{
+  return fh->length;
+}
+
+/**
+ * Reset \a fh clearing all entries.
+ *
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ * \param nentries_reserve: Optionally reserve the number of members that the hash will hold.
+ */
+void BLI_flathash_clear_ex(FlatHash *fh,
+                           GHashKeyFreeFP keyfreefp,
+                           GHashValFreeFP valfreefp,
+                           const uint nentries_reserve)
+{
+  flathash_free_entries(fh, keyfreefp, valfreefp);
+  fh->length = 0;
+  flathash_resize(fh, calc_capacity_exp_for_reserve(nentries_reserve));
+}
+
+/**
+ * Wraps #BLI_flathash_clear_ex with zero entries reserved.
+ */
+void BLI_flathash_clear(FlatHash *fh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  BLI_flathash_clear_ex(fh, keyfreefp, valfreefp, 1 << CAPACITY_EXP_DEFAULT);
+}
+
+FlatHash *BLI_flathash_ptr_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flathash_new_ex(
+      BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+FlatHash *BLI_flathash_ptr_new(const char *info)
+{
+  return BLI_flathash_ptr_new_ex(info, 0);
+}
+
+FlatHash *BLI_flathash_str_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flathash_new_ex(
+      BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+FlatHash *BLI_flathash_str_new(const char *info)
+{
+  return BLI_flathash_str_new_ex(info, 0);
+}
+
+FlatHash *BLI_flathash_int_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flathash_new_ex(
+      BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info, nentries_reserve);
+}
+FlatHash *BLI_flathash_int_new(const char *info)
+{
+  return BLI_flathash_int_new_ex(info, 0);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name FlatHash Iterator API
+ * \{ */
+
+/**
+ * Init an already allocated FlatHashIterator. The hash table must not
+ * be mutated while the iterator is in use, and the iterator will
+ * step exactly BLI_flathash_len(fh) times before becoming done.
+ *
+ * \param fhi: The FlatHashIterator to initialize.
+ * \param fh: The FlatHash to iterate over.
+ */
+void BLI_flathashIterator_init(FlatHashIterator *fhi, FlatHash *fh)
+{
+  fhi->entries = fh->entries;
+  fhi->length = fh->length;
+  fhi->index = 0;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name FlatSet Public API
+ *
+ * Use flathash API to give 'set' functionality
+ * \{ */
+
+FlatSet *BLI_flatset_new_ex(GSetHashFP hashfp,
+                            GSetCmpFP cmpfp,
+                            const char *info,
+                            const uint nentries_reserve)
+{
+  return (FlatSet *)BLI_flathash_new_ex(hashfp, cmpfp, info, nentries_reserve);
+}
+
+FlatSet *BLI_flatset_new(GSetHashFP hashfp, GSetCmpFP cmpfp, const char *info)
+{
+  return (FlatSet *)BLI_flathash_new(hashfp, cmpfp, info);
+}
+
+void BLI_flatset_free(FlatSet *fs, GSetKeyFreeFP keyfreefp)
+{
+  BLI_flathash_free((FlatHash *)fs, keyfreefp, NULL);
+}
+
+void BLI_flatset_reserve(FlatSet *fs, const uint nentries_reserve)
+{
+  BLI_flathash_reserve((FlatHash *)fs, nentries_reserve);
+}
+
+/**
+ * Adds the key to the set (no checks for unique keys!).
+ * Matching #BLI_flathash_insert
+ */
+void BLI_flatset_insert(FlatSet *fs, void *key)
+{
+  BLI_flathash_insert((FlatHash *)fs, key, NULL);
+}
+
+/**
+ * A version of BLI_flatset_insert which checks first if the key is in the set.
+ * \returns true if a new key has been added.
+ */
+bool BLI_flatset_add(FlatSet *fs, void *key)
+{
+  FlatHashEntry *entry;
+  return !flathash_ensure_entry((FlatHash *)fs, key, &entry);
+}
+
+bool BLI_flatset_haskey(FlatSet *fs, const void *key)
+{
+  return flathash_lookup_entry((FlatHash *)fs, key) != NULL;
+}
+
+/**
+ * Returns the pointer to the key if it's found.
+ */
+void *BLI_flatset_lookup(FlatSet *fs, const void *key)
+{
+  FlatHashEntry *entry = flathash_lookup_entry((FlatHash *)fs, key);
+  return entry ? entry->key : NULL;
+}
+
+bool BLI_flatset_remove(FlatSet *fs, const void *key, GSetKeyFreeFP keyfreefp)
+{
+  return BLI_flathash_remove((FlatHash *)fs, key, keyfreefp, NULL);
+}
+
+uint BLI_flatset_len(FlatSet *fs)
+{
+  return ((FlatHash *)fs)->length;
+}
+
+void BLI_flatset_clear_ex(FlatSet *fs, GSetKeyFreeFP keyfreefp, const uint nentries_reserve)
+{
+  BLI_flathash_clear_ex((FlatHash *)fs, keyfreefp, NULL, nentries_reserve);
+}
+
+void BLI_flatset_clear(FlatSet *fs, GSetKeyFreeFP keyfreefp)
+{
+  BLI_flathash_clear((FlatHash *)fs, keyfreefp, NULL);
+}
+
+FlatSet *BLI_flatset_ptr_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flatset_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+FlatSet *BLI_flatset_ptr_new(const char *info)
+{
+  return BLI_flatset_ptr_new_ex(info, 0);
+}
+
+FlatSet *BLI_flatset_str_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flatset_new_ex(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+FlatSet *BLI_flatset_str_new(const char *info)
+{
+  return BLI_flatset_str_new_ex(info, 0);
+}
+
+FlatSet *BLI_flatset_int_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_flatset_new_ex(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info, nentries_reserve);
+}
+FlatSet *BLI_flatset_int_new(const char *info)
+{
+  return BLI_flatset_int_new_ex(info, 0);
+}
+
+/** \} */
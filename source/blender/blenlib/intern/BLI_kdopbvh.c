@@ -52,6 +52,10 @@
 
 #include "BLI_strict_flags.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 /* used for iterative_raycast */
 // #define USE_SKIP_LINKS
 
@@ -72,6 +76,9 @@
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
 #endif
 
+/* Bounding volumes of branches with more leafs are calculated in parallel. */
+#define KDOPBVH_THREAD_HULL_THRESHOLD (KDOPBVH_THREAD_LEAF_THRESHOLD * 16)
+
 /* -------------------------------------------------------------------- */
 /** \name Struct Definitions
  * \{ */
@@ -372,33 +379,85 @@ static void create_kdop_hull(
   }
 }
 
+static void kdop_hull_join(const BVHTree *tree,
+                           float *__restrict bv,
+                           const float *__restrict node_bv)
+{
+  float newmin, newmax;
+  axis_t axis_iter;
+
+  /* for all Axes. */
+  for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+    newmin = node_bv[(2 * axis_iter)];
+    if ((newmin < bv[(2 * axis_iter)])) {
+      bv[(2 * axis_iter)] = newmin;
+    }
+
+    newmax = node_bv[(2 * axis_iter) + 1];
+    if ((newmax > bv[(2 * axis_iter) + 1])) {
+      bv[(2 * axis_iter) + 1] = newmax;
+    }
+  }
+}
+
+typedef struct RefitKdopHullData {
+  const BVHTree *tree;
+  BVHNode *node;
+} RefitKdopHullData;
+
+typedef struct RefitKdopHullChunk {
+  float bv[26];
+} RefitKdopHullChunk;
+
+static void refit_kdop_hull_task_cb(void *__restrict userdata,
+                                    const int j,
+                                    const TaskParallelTLS *__restrict tls)
+{
+  const RefitKdopHullData *data = userdata;
+  RefitKdopHullChunk *chunk = tls->userdata_chunk;
+  kdop_hull_join(data->tree, chunk->bv, data->tree->nodes[j]->bv);
+}
+
+static void refit_kdop_hull_finalize(void *__restrict userdata, void *__restrict userdata_chunk)
+{
+  const RefitKdopHullData *data = userdata;
+  const RefitKdopHullChunk *chunk = userdata_chunk;
+  kdop_hull_join(data->tree, data->node->bv, chunk->bv);
+}
+
 /**
  * \note depends on the fact that the BVH's for each face is already built
  */
 static void refit_kdop_hull(const BVHTree *tree, BVHNode *node, int start, int end)
 {
-  float newmin, newmax;
-  float *__restrict bv = node->bv;
   int j;
-  axis_t axis_iter;
 
   node_minmax_init(tree, node);
 
-  for (j = start; j < end; j++) {
-    float *__restrict node_bv = tree->nodes[j]->bv;
+  if (end - start > KDOPBVH_THREAD_HULL_THRESHOLD) {
+    /* Each thread joins the bounding volumes of a part of the leafs. */
+    RefitKdopHullData data = {
+        .tree = tree,
+        .node = node,
+    };
+    RefitKdopHullChunk chunk;
+    for (axis_t axis_iter = tree->start_axis; axis_iter != tree->stop_axis; axis_iter++) {
+      chunk.bv[2 * axis_iter] = FLT_MAX;
+      chunk.bv[2 * axis_iter + 1] = -FLT_MAX;
+    }
 
-    /* for all Axes. */
-    for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
-      newmin = node_bv[(2 * axis_iter)];
-      if ((newmin < bv[(2 * axis_iter)])) {
-        bv[(2 * axis_iter)] = newmin;
-      }
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.userdata_chunk = &chunk;
+    settings.userdata_chunk_size = sizeof(chunk);
+    settings.func_finalize = refit_kdop_hull_finalize;
+    settings.min_iter_per_thread = 1024;
+    BLI_task_parallel_range(start, end, &data, refit_kdop_hull_task_cb, &settings);
+    return;
+  }
 
-      newmax = node_bv[(2 * axis_iter) + 1];
-      if ((newmax > bv[(2 * axis_iter) + 1])) {
-        bv[(2 * axis_iter) + 1] = newmax;
-      }
-    }
+  for (j = start; j < end; j++) {
+    kdop_hull_join(tree, node->bv, tree->nodes[j]->bv);
   }
 }
 
@@ -1032,20 +1091,110 @@ bool BLI_bvhtree_update_node(
   return true;
 }
 
-/* call BLI_bvhtree_update_node() first for every node/point/triangle */
+static void bvhtree_update_tree_task_cb(void *__restrict userdata,
+                                        const int j,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHTree *tree = userdata;
+  node_join(tree, tree->nodes[tree->totleaf + j - 1]);
+}
+
+/**
+ * Call #BLI_bvhtree_update_node() first for every node/point/triangle.
+ *
+ * \note Leafs may be updated from multiple threads, as long as every thread updates other leafs.
+ */
 void BLI_bvhtree_update_tree(BVHTree *tree)
 {
   /* Update bottom=>top
    * TRICKY: the way we build the tree all the childs have an index greater than the parent
    * This allows us todo a bottom up update by starting on the bigger numbered branch */
 
-  BVHNode **root = tree->nodes + tree->totleaf;
-  BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+  if (tree->totleaf <= KDOPBVH_THREAD_LEAF_THRESHOLD * 16) {
+    BVHNode **root = tree->nodes + tree->totleaf;
+    BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
 
-  for (; index >= root; index--) {
-    node_join(tree, *index);
+    for (; index >= root; index--) {
+      node_join(tree, *index);
+    }
+    return;
+  }
+
+  /* Branches on the same level of the implicit tree don't depend on each other,
+   * update them in parallel, starting from the deepest level.
+   * Branch j (starting at 1 for the root) is stored at nodes[totleaf + j - 1],
+   * see #non_recursive_bvh_div_nodes. */
+  const int tree_offset = 2 - tree->tree_type;
+  int level_start[32 + 1];
+  int levels_len = 0;
+  for (int i = 1; i <= tree->totbranch; i = i * tree->tree_type + tree_offset) {
+    level_start[levels_len++] = i;
+  }
+  level_start[levels_len] = tree->totbranch + 1;
+
+  for (int level = levels_len - 1; level >= 0; level--) {
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 256;
+    BLI_task_parallel_range(level_start[level],
+                            level_start[level + 1],
+                            tree,
+                            bvhtree_update_tree_task_cb,
+                            &settings);
+  }
+}
+typedef struct BVHRefitData {
+  BVHTree *tree;
+  BVHTree_RefitCallback callback;
+  void *userdata;
+} BVHRefitData;
+
+static void bvhtree_refit_task_cb(void *__restrict userdata,
+                                  const int i,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHRefitData *data = userdata;
+  const BVHTree *tree = data->tree;
+  BVHNode *node = tree->nodes[i];
+  float co[4][3];
+  axis_t axis_iter;
+
+  const int numpoints = data->callback(data->userdata, node->index, co);
+  BLI_assert(numpoints >= 1 && numpoints <= 4);
+
+  create_kdop_hull(tree, node, co[0], numpoints, 0);
+
+  /* inflate the bv with some epsilon */
+  for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+    node->bv[(2 * axis_iter)] -= tree->epsilon;     /* minimum */
+    node->bv[(2 * axis_iter) + 1] += tree->epsilon; /* maximum */
   }
 }
+
+/**
+ * Refit a balanced tree to new positions of its elements, keeping its structure.
+ * A faster alternative to building a new tree when only the positions changed.
+ *
+ * \param callback: Called for every leaf (from multiple threads) with the index it was
+ * inserted with, to get the new points of the element.
+ */
+void BLI_bvhtree_refit(BVHTree *tree, BVHTree_RefitCallback callback, void *userdata)
+{
+  BVHRefitData data = {
+      .tree = tree,
+      .callback = callback,
+      .userdata = userdata,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(0, tree->totleaf, &data, bvhtree_refit_task_cb, &settings);
+
+  BLI_bvhtree_update_tree(tree);
+}
+
 /**
  * Number of times #BLI_bvhtree_insert has been called.
  * mainly useful for asserts functions to check we added the correct number.
@@ -1568,6 +1717,55 @@ int BLI_bvhtree_find_nearest(BVHTree *tree,
   return BLI_bvhtree_find_nearest_ex(tree, co, nearest, callback, userdata, 0);
 }
 
+typedef struct BVHNearestBatchData {
+  BVHTree *tree;
+  const float (*co)[3];
+  BVHTreeNearest *nearest;
+  BVHTree_NearestPointCallback callback;
+  void *userdata;
+  int flag;
+} BVHNearestBatchData;
+
+static void bvhtree_find_nearest_batch_task_cb(void *__restrict userdata,
+                                               const int i,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHNearestBatchData *data = userdata;
+  BLI_bvhtree_find_nearest_ex(
+      data->tree, data->co[i], &data->nearest[i], data->callback, data->userdata, data->flag);
+}
+
+/**
+ * Find the nearest node for every point in \a co.
+ *
+ * \param nearest: Array of \a co_len results, initialized as for #BLI_bvhtree_find_nearest_ex
+ * (index and the squared distance to search around).
+ * \param flag: #BVH_NEAREST_USE_THREADING answers the queries in parallel.
+ */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    const int co_len,
+                                    BVHTreeNearest *nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag)
+{
+  BVHNearestBatchData data = {
+      .tree = tree,
+      .co = co,
+      .nearest = nearest,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag & ~BVH_NEAREST_USE_THREADING,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (flag & BVH_NEAREST_USE_THREADING) &&
+                           (co_len > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  BLI_task_parallel_range(0, co_len, &data, bvhtree_find_nearest_batch_task_cb, &settings);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -1989,6 +2187,250 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_ray_cast_packet
+ *
+ * Casts packets of rays together, testing every node against all rays of a packet at once.
+ * Coherent rays (shrinkwrap, baking, snapping) mostly visit the same nodes,
+ * so the node is loaded once for the whole packet.
+ *
+ * \{ */
+
+/* Matches the width of SSE registers. */
+#define BVH_RAYCAST_PACKET_SIZE 4
+
+typedef struct BVHRayPacketData {
+  BVHTree_RayCastCallback callback;
+  void *userdata;
+
+  int rays_len;
+  bool use_fast_hit;
+
+  /* Per axis values of all rays, to test a node against the whole packet. */
+  float origin[3][BVH_RAYCAST_PACKET_SIZE];
+  float idot_axis[3][BVH_RAYCAST_PACKET_SIZE];
+  float hit_dist[BVH_RAYCAST_PACKET_SIZE];
+
+  BVHRayCastData rays[BVH_RAYCAST_PACKET_SIZE];
+} BVHRayPacketData;
+
+typedef struct BVHRayPacketCastData {
+  BVHTree *tree;
+  const float (*co)[3];
+  const float (*dir)[3];
+  int rays_len;
+  float radius;
+  BVHTreeRayHit *hits;
+  BVHTree_RayCastCallback callback;
+  void *userdata;
+  int flag;
+} BVHRayPacketCastData;
+
+/**
+ * Same as #fast_ray_nearest_hit for all rays of the packet in \a mask.
+ *
+ * \return the mask of rays that hit the node closer than their current hit.
+ */
+static int packet_ray_nearest_hit(const BVHRayPacketData *data,
+                                  const BVHNode *node,
+                                  const int mask,
+                                  float r_dist[BVH_RAYCAST_PACKET_SIZE])
+{
+  const float *bv = node->bv;
+  int mask_hit = 0;
+
+  if (!data->use_fast_hit) {
+    for (int r = 0; r < data->rays_len; r++) {
+      if (mask & (1 << r)) {
+        r_dist[r] = ray_nearest_hit(&data->rays[r], bv);
+        if (r_dist[r] < data->hit_dist[r]) {
+          mask_hit |= (1 << r);
+        }
+      }
+    }
+    return mask_hit;
+  }
+
+#ifdef __SSE2__
+  __m128 t_near = _mm_setzero_ps(), t_far = _mm_setzero_ps();
+  for (int i = 0; i < 3; i++) {
+    const __m128 origin = _mm_loadu_ps(data->origin[i]);
+    const __m128 idot = _mm_loadu_ps(data->idot_axis[i]);
+    const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[2 * i]), origin), idot);
+    const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[2 * i + 1]), origin), idot);
+    if (i == 0) {
+      t_near = _mm_min_ps(t1, t2);
+      t_far = _mm_max_ps(t1, t2);
+    }
+    else {
+      t_near = _mm_max_ps(t_near, _mm_min_ps(t1, t2));
+      t_far = _mm_min_ps(t_far, _mm_max_ps(t1, t2));
+    }
+  }
+  const __m128 hit = _mm_and_ps(
+      _mm_and_ps(_mm_cmple_ps(t_near, t_far), _mm_cmpge_ps(t_far, _mm_setzero_ps())),
+      _mm_cmplt_ps(t_near, _mm_loadu_ps(data->hit_dist)));
+  _mm_storeu_ps(r_dist, t_near);
+  mask_hit = _mm_movemask_ps(hit);
+#else
+  for (int r = 0; r < BVH_RAYCAST_PACKET_SIZE; r++) {
+    float t_near = -FLT_MAX, t_far = FLT_MAX;
+    for (int i = 0; i < 3; i++) {
+      const float t1 = (bv[2 * i] - data->origin[i][r]) * data->idot_axis[i][r];
+      const float t2 = (bv[2 * i + 1] - data->origin[i][r]) * data->idot_axis[i][r];
+      t_near = max_ff(t_near, min_ff(t1, t2));
+      t_far = min_ff(t_far, max_ff(t1, t2));
+    }
+    r_dist[r] = t_near;
+    if (t_near <= t_far && t_far >= 0.0f && t_near < data->hit_dist[r]) {
+      mask_hit |= (1 << r);
+    }
+  }
+#endif
+
+  return mask_hit & mask;
+}
+
+static void dfs_raycast_packet(BVHRayPacketData *data, const BVHNode *node, int mask)
+{
+  float dist[BVH_RAYCAST_PACKET_SIZE];
+
+  mask = packet_ray_nearest_hit(data, node, mask, dist);
+  if (mask == 0) {
+    return;
+  }
+
+  if (node->totnode == 0) {
+    for (int r = 0; r < data->rays_len; r++) {
+      if ((mask & (1 << r)) == 0) {
+        continue;
+      }
+      BVHRayCastData *ray_data = &data->rays[r];
+      if (data->callback) {
+        data->callback(data->userdata, node->index, &ray_data->ray, &ray_data->hit);
+      }
+      else {
+        ray_data->hit.index = node->index;
+        ray_data->hit.dist = dist[r];
+        madd_v3_v3v3fl(ray_data->hit.co, ray_data->ray.origin, ray_data->ray.direction, dist[r]);
+      }
+      data->hit_dist[r] = ray_data->hit.dist;
+    }
+  }
+  else {
+    /* Pick loop direction from the first ray still in the packet. */
+    int r = 0;
+    while ((mask & (1 << r)) == 0) {
+      r++;
+    }
+    if (data->rays[r].ray_dot_axis[node->main_axis] > 0.0f) {
+      for (int i = 0; i != node->totnode; i++) {
+        dfs_raycast_packet(data, node->children[i], mask);
+      }
+    }
+    else {
+      for (int i = node->totnode - 1; i >= 0; i--) {
+        dfs_raycast_packet(data, node->children[i], mask);
+      }
+    }
+  }
+}
+
+static void bvhtree_ray_cast_packet_task_cb(void *__restrict userdata,
+                                            const int packet_index,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHRayPacketCastData *cast_data = userdata;
+  const BVHTree *tree = cast_data->tree;
+  const int ray_start = packet_index * BVH_RAYCAST_PACKET_SIZE;
+  BVHRayPacketData data;
+
+  data.callback = cast_data->callback;
+  data.userdata = cast_data->userdata;
+  data.rays_len = min_ii(BVH_RAYCAST_PACKET_SIZE, cast_data->rays_len - ray_start);
+  data.use_fast_hit = (cast_data->radius == 0.0f);
+
+  for (int r = 0; r < BVH_RAYCAST_PACKET_SIZE; r++) {
+    if (r >= data.rays_len) {
+      /* Unused rays never hit, they are masked out. */
+      for (int i = 0; i < 3; i++) {
+        data.origin[i][r] = 0.0f;
+        data.idot_axis[i][r] = 0.0f;
+      }
+      data.hit_dist[r] = 0.0f;
+      continue;
+    }
+
+    BVHRayCastData *ray_data = &data.rays[r];
+    BLI_ASSERT_UNIT_V3(cast_data->dir[ray_start + r]);
+
+    ray_data->tree = tree;
+    ray_data->callback = cast_data->callback;
+    ray_data->userdata = cast_data->userdata;
+    copy_v3_v3(ray_data->ray.origin, cast_data->co[ray_start + r]);
+    copy_v3_v3(ray_data->ray.direction, cast_data->dir[ray_start + r]);
+    ray_data->ray.radius = cast_data->radius;
+    bvhtree_ray_cast_data_precalc(ray_data, cast_data->flag);
+    memcpy(&ray_data->hit, &cast_data->hits[ray_start + r], sizeof(ray_data->hit));
+
+    for (int i = 0; i < 3; i++) {
+      data.origin[i][r] = ray_data->ray.origin[i];
+      data.idot_axis[i][r] = ray_data->idot_axis[i];
+    }
+    data.hit_dist[r] = ray_data->hit.dist;
+  }
+
+  dfs_raycast_packet(&data, tree->nodes[tree->totleaf], (1 << data.rays_len) - 1);
+
+  for (int r = 0; r < data.rays_len; r++) {
+    memcpy(&cast_data->hits[ray_start + r], &data.rays[r].hit, sizeof(data.rays[r].hit));
+  }
+}
+
+/**
+ * Cast many rays, giving the same hits as #BLI_bvhtree_ray_cast_ex for every ray.
+ * Rays next to each other in the arrays are cast together, so they should be coherent.
+ *
+ * \param hits: Array of \a rays_len hits, initialized as for #BLI_bvhtree_ray_cast_ex
+ * (index and the maximum distance).
+ * \param flag: #BVH_RAYCAST_USE_THREADING casts the packets in parallel.
+ */
+void BLI_bvhtree_ray_cast_packet(BVHTree *tree,
+                                 const float (*co)[3],
+                                 const float (*dir)[3],
+                                 const int rays_len,
+                                 float radius,
+                                 BVHTreeRayHit *hits,
+                                 BVHTree_RayCastCallback callback,
+                                 void *userdata,
+                                 int flag)
+{
+  if (tree->nodes[tree->totleaf] == NULL || rays_len == 0) {
+    return;
+  }
+
+  BVHRayPacketCastData data = {
+      .tree = tree,
+      .co = co,
+      .dir = dir,
+      .rays_len = rays_len,
+      .radius = radius,
+      .hits = hits,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+  const int packets_len = (rays_len + BVH_RAYCAST_PACKET_SIZE - 1) / BVH_RAYCAST_PACKET_SIZE;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (flag & BVH_RAYCAST_USE_THREADING) &&
+                           (rays_len > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  BLI_task_parallel_range(0, packets_len, &data, bvhtree_ray_cast_packet_task_cb, &settings);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
@@ -0,0 +1,248 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Read-only memory mapped files.
+ *
+ * When reading a mapped page fails (the file was truncated, a network drive
+ * disconnected, ...) the system raises SIGBUS. A signal handler catches those
+ * faults for the mapped regions, replaces the mapping with zeroed memory so the
+ * faulting access can complete, and flags the file so the error gets reported.
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "atomic_ops.h"
+
+#include "BLI_mmap.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#ifndef WIN32
+#  include <signal.h>
+#  include <stdlib.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+/* Mapped region of a file, as seen by the signal handler. */
+typedef struct MMapRegion {
+  /* The address to which the file was mapped, NULL while the region is unused. */
+  char *volatile memory;
+
+  /* The length of the file (and therefore the mapped region). */
+  volatile size_t length;
+
+  /* Set when an I/O error occurred while reading the mapped memory. */
+  volatile bool io_error;
+} MMapRegion;
+
+struct BLI_mmap_file {
+  /* The address to which the file was mapped. */
+  char *memory;
+
+  /* The length of the file (and therefore the mapped region). */
+  size_t length;
+
+  MMapRegion *region;
+};
+
+#ifndef WIN32
+
+/* Upper limit of files mapped at the same time, opening more fails and callers fall back to
+ * regular reading. */
+#  define MMAP_REGIONS_MAX 256
+
+/* Regions of open files. Open and free claim and release them while holding the lock, the
+ * signal handler reads them without (it can't wait for a lock). The array is static so the
+ * handler never reads freed memory, even when a file is freed on another thread meanwhile.
+ *
+ * A region is published by setting its memory last and released by clearing its memory first,
+ * both atomically, so the handler never sees a region which is only partially set up. */
+static MMapRegion mmap_regions[MMAP_REGIONS_MAX];
+static ThreadMutex mmap_lock = BLI_MUTEX_INITIALIZER;
+
+static bool sigbus_handler_installed = false;
+static struct sigaction sigbus_handler_previous;
+
+static void sigbus_handler(int sig, siginfo_t *siginfo, void *ptr)
+{
+  const char *error_addr = (const char *)siginfo->si_addr;
+
+  for (int i = 0; i < MMAP_REGIONS_MAX; i++) {
+    MMapRegion *region = &mmap_regions[i];
+    char *memory = atomic_cas_ptr((void **)&region->memory, NULL, NULL);
+    if (memory == NULL) {
+      continue;
+    }
+    const size_t length = region->length;
+    /* Skip the region if it was released and claimed again while reading its length. */
+    if (atomic_cas_ptr((void **)&region->memory, NULL, NULL) != memory) {
+      continue;
+    }
+
+    if (error_addr >= memory && error_addr < memory + length) {
+      region->io_error = true;
+
+      /* Replace the mapped memory with zeroes so the read can complete, the error is reported
+       * by the read functions. */
+      if (mmap(memory, length, PROT_READ, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) ==
+          MAP_FAILED) {
+        abort();
+      }
+      return;
+    }
+  }
+
+  /* Not a fault in one of our files, forward to the previous handler. */
+  if (sigbus_handler_previous.sa_flags & SA_SIGINFO) {
+    sigbus_handler_previous.sa_sigaction(sig, siginfo, ptr);
+  }
+  else if (sigbus_handler_previous.sa_handler == SIG_DFL ||
+           sigbus_handler_previous.sa_handler == SIG_IGN) {
+    signal(sig, SIG_DFL);
+    raise(sig);
+  }
+  else {
+    sigbus_handler_previous.sa_handler(sig);
+  }
+}
+
+/* Installs the signal handler, when called for the first time. Call with the lock held. */
+static bool sigbus_handler_ensure(void)
+{
+  if (sigbus_handler_installed) {
+    return true;
+  }
+
+  struct sigaction newact, oldact;
+  memset(&newact, 0, sizeof(newact));
+  sigemptyset(&newact.sa_mask);
+  newact.sa_sigaction = sigbus_handler;
+  newact.sa_flags = SA_SIGINFO;
+
+  if (sigaction(SIGBUS, &newact, &oldact) != 0) {
+    return false;
+  }
+
+  sigbus_handler_previous = oldact;
+  sigbus_handler_installed = true;
+  return true;
+}
+
+/* Claim an unused region for the mapped memory. Call with the lock held. */
+static MMapRegion *mmap_region_claim(char *memory, const size_t length)
+{
+  for (int i = 0; i < MMAP_REGIONS_MAX; i++) {
+    MMapRegion *region = &mmap_regions[i];
+    if (region->memory == NULL) {
+      region->length = length;
+      region->io_error = false;
+      atomic_cas_ptr((void **)&region->memory, NULL, memory);
+      return region;
+    }
+  }
+  return NULL;
+}
+
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+  struct stat st;
+  if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    return NULL;
+  }
+
+  const size_t length = (size_t)st.st_size;
+  void *memory = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+
+  BLI_mutex_lock(&mmap_lock);
+  MMapRegion *region = sigbus_handler_ensure() ? mmap_region_claim(memory, length) : NULL;
+  BLI_mutex_unlock(&mmap_lock);
+
+  if (region == NULL) {
+    munmap(memory, length);
+    return NULL;
+  }
+
+  BLI_mmap_file *file = MEM_callocN(sizeof(BLI_mmap_file), __func__);
+  file->memory = memory;
+  file->length = length;
+  file->region = region;
+  return file;
+}
+
+void BLI_mmap_free(BLI_mmap_file *file)
+{
+  /* Release the region before unmapping, faults in the unmapped range are no longer ours. */
+  BLI_mutex_lock(&mmap_lock);
+  atomic_cas_ptr((void **)&file->region->memory, file->memory, NULL);
+  BLI_mutex_unlock(&mmap_lock);
+
+  munmap(file->memory, file->length);
+  MEM_freeN(file);
+}
+
+#else /* WIN32 */
+
+BLI_mmap_file *BLI_mmap_open(int UNUSED(fd))
+{
+  /* Not supported, I/O errors can't be recovered from yet. Callers fall back to reading. */
+  return NULL;
+}
+
+void BLI_mmap_free(BLI_mmap_file *file)
+{
+  MEM_freeN(file);
+}
+
+#endif /* WIN32 */
+
+bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
+{
+  /* If a previous read has already failed or we try to read past the end,
+   * don't even attempt to read any further. */
+  if (BLI_mmap_has_io_error(file) || offset > file->length || length > file->length - offset) {
+    return false;
+  }
+
+  memcpy(dest, file->memory + offset, length);
+
+  /* The signal handler sets this when the read failed. */
+  return !BLI_mmap_has_io_error(file);
+}
+
+void *BLI_mmap_get_pointer(BLI_mmap_file *file)
+{
+  return file->memory;
+}
+
+size_t BLI_mmap_get_length(const BLI_mmap_file *file)
+{
+  return file->length;
+}
+
+bool BLI_mmap_has_io_error(const BLI_mmap_file *file)
+{
+  return (file->region != NULL) && file->region->io_error;
+}
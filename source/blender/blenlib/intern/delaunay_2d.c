@@ -28,6 +28,7 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_mempool.h"
+#include "BLI_threads.h"
 
 #include "BLI_delaunay_2d.h"
 
@@ -2407,7 +2408,7 @@ static CDT_result *cdt_get_output(CDT_state *cdt,
         result->faces_start_table[i] = j;
         se = se_start = f->symedge;
         do {
-          result->faces[j++] = se->vert->index;
+          result->faces[j++] = vert_to_output_map[se->vert->index];
           se = se->next;
         } while (se != se_start);
         result->faces_len_table[i] = j - result->faces_start_table[i];
@@ -2470,15 +2471,20 @@ CDT_result *BLI_delaunay_2d_cdt_calc(const CDT_input *input, const CDT_output_ty
   LinkNode *edge_list;
   CDT_result *result;
   static bool called_exactinit = false;
+  static ThreadMutex exactinit_mutex = BLI_MUTEX_INITIALIZER;
 #ifdef DEBUG_CDT
   int dbg_level = 0;
 #endif
 
   /* The exact orientation and incircle primitives need a one-time initialization of certain
-   * constants. */
+   * constants. Triangulations can be computed from several threads. */
   if (!called_exactinit) {
-    exactinit();
-    called_exactinit = true;
+    BLI_mutex_lock(&exactinit_mutex);
+    if (!called_exactinit) {
+      exactinit();
+      called_exactinit = true;
+    }
+    BLI_mutex_unlock(&exactinit_mutex);
   }
 #ifdef DEBUG_CDT
   if (dbg_level > 0) {
@@ -22,6 +22,7 @@
 
 #include "BLI_math.h"
 #include "BLI_kdtree_impl.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_strict_flags.h"
 
@@ -145,7 +146,50 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+/* Sub-trees with at least this many nodes are balanced in their own task. */
+#define KD_BALANCE_TASK_MIN 8192
+
+typedef struct KDTreeBalanceTask {
+  KDTreeNode *nodes;
+  uint nodes_len;
+  uint axis;
+  uint ofs;
+} KDTreeBalanceTask;
+
+static uint kdtree_balance(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs);
+
+static void kdtree_balance_task(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+  KDTreeBalanceTask *task = taskdata;
+  kdtree_balance(pool, task->nodes, task->nodes_len, task->axis, task->ofs);
+}
+
+/**
+ * Balance a sub-tree, or push it into the \a pool when it's large enough.
+ *
+ * The root of a sub-tree is always its median, so the index it gets is known before the
+ * sub-tree itself is balanced. This gives the same result regardless of the number of threads.
+ */
+static uint kdtree_balance_subtree(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+{
+  if (pool == NULL || nodes_len < KD_BALANCE_TASK_MIN) {
+    return kdtree_balance(pool, nodes, nodes_len, axis, ofs);
+  }
+
+  KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+  task->nodes = nodes;
+  task->nodes_len = nodes_len;
+  task->axis = axis;
+  task->ofs = ofs;
+  BLI_task_pool_push(pool, kdtree_balance_task, task, true, TASK_PRIORITY_HIGH);
+
+  return (nodes_len / 2) + ofs;
+}
+
+static uint kdtree_balance(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
 {
   KDTreeNode *node;
   float co;
@@ -194,9 +238,9 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   node = &nodes[median];
   node->d = axis;
   axis = (axis + 1) % KD_DIMS;
-  node->left = kdtree_balance(nodes, median, axis, ofs);
-  node->right = kdtree_balance(
-      nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
+  node->left = kdtree_balance_subtree(pool, nodes, median, axis, ofs);
+  node->right = kdtree_balance_subtree(
+      pool, nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
 
   return median + ofs;
 }
@@ -210,7 +254,17 @@ void BLI_kdtree_nd_(balance)(KDTree *tree)
     }
   }
 
-  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  if (tree->nodes_len < KD_BALANCE_TASK_MIN * 2) {
+    tree->root = kdtree_balance(NULL, tree->nodes, tree->nodes_len, 0, 0);
+  }
+  else {
+    /* Both halves of the tree are split further in parallel. */
+    TaskScheduler *scheduler = BLI_task_scheduler_get();
+    TaskPool *pool = BLI_task_pool_create(scheduler, NULL);
+    tree->root = kdtree_balance(pool, tree->nodes, tree->nodes_len, 0, 0);
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+  }
 
 #ifdef DEBUG
   tree->is_balanced = true;
@@ -806,6 +860,236 @@ finally:
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_kdtree_3d_find_nearest_batch & BLI_kdtree_3d_range_search_batch
+ * \{ */
+
+/* Batches with fewer queries are answered from the calling thread. */
+#define KD_BATCH_THREAD_MIN 256
+/* Most levels of the tree used to order a batch, and the queries per bucket to aim for. */
+#define KD_BATCH_LEVELS_MAX 12
+#define KD_BATCH_BUCKET_QUERIES 8
+
+/* Splitting plane of a node, in the breadth-first array used to order a batch. */
+typedef struct KDTreeBatchSplit {
+  float value;
+  uint d;
+} KDTreeBatchSplit;
+
+/**
+ * Copy the splitting planes of the top levels of the tree into a breadth-first (Eytzinger)
+ * array, where the children of \a i are at `2 * i` and `2 * i + 1`.
+ * Missing nodes send every query to the left, so they still end up in a bucket of their own.
+ */
+static void kdtree_batch_splits_fill(const KDTreeNode *nodes,
+                                     KDTreeBatchSplit *splits,
+                                     const uint splits_len,
+                                     const uint cur,
+                                     const uint i)
+{
+  if (i >= splits_len) {
+    return;
+  }
+  if (cur == KD_NODE_UNSET) {
+    splits[i].value = FLT_MAX;
+    splits[i].d = 0;
+    kdtree_batch_splits_fill(nodes, splits, splits_len, KD_NODE_UNSET, 2 * i);
+    kdtree_batch_splits_fill(nodes, splits, splits_len, KD_NODE_UNSET, 2 * i + 1);
+    return;
+  }
+  const KDTreeNode *node = &nodes[cur];
+  splits[i].value = node->co[node->d];
+  splits[i].d = node->d;
+  kdtree_batch_splits_fill(nodes, splits, splits_len, node->left, 2 * i);
+  kdtree_batch_splits_fill(nodes, splits, splits_len, node->right, 2 * i + 1);
+}
+
+/**
+ * Order of the queries, so ones ending up in the same part of the tree are answered after
+ * each other. Since sub-trees are stored contiguously, this way neighboring queries mostly
+ * touch the same nodes, and every thread works on a compact region of the tree.
+ *
+ * Queries are bucketed by the sub-tree they descend to a few levels down, the number of levels
+ * depends on the batch size. Only these levels are walked, using a compact breadth-first copy of
+ * them, so all memory used here is sized to the batch instead of the tree.
+ */
+static uint *kdtree_batch_order(const KDTree *tree, const float (*co)[KD_DIMS], const uint co_len)
+{
+  uint levels = 1;
+  while (levels < KD_BATCH_LEVELS_MAX && ((uint)1 << levels) < tree->nodes_len &&
+         ((uint)1 << levels) * KD_BATCH_BUCKET_QUERIES < co_len) {
+    levels++;
+  }
+  const uint buckets_len = (uint)1 << levels;
+
+  /* Index 0 is unused, the root is at 1. */
+  KDTreeBatchSplit *splits = MEM_mallocN(sizeof(*splits) * buckets_len, __func__);
+  uint *offsets = MEM_callocN(sizeof(uint) * (buckets_len + 1), __func__);
+  uint *bucket = MEM_mallocN(sizeof(uint) * co_len, __func__);
+  uint *order = MEM_mallocN(sizeof(uint) * co_len, __func__);
+
+  kdtree_batch_splits_fill(tree->nodes, splits, buckets_len, tree->root, 1);
+
+  /* Counting sort by the bucket index. */
+  for (uint i = 0; i < co_len; i++) {
+    uint j = 1;
+    for (uint l = 0; l < levels; l++) {
+      const KDTreeBatchSplit *split = &splits[j];
+      j = 2 * j + (uint)(co[i][split->d] >= split->value);
+    }
+    bucket[i] = j - buckets_len;
+    offsets[bucket[i] + 1]++;
+  }
+  for (uint i = 0; i < buckets_len; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+  for (uint i = 0; i < co_len; i++) {
+    order[offsets[bucket[i]]++] = i;
+  }
+
+  MEM_freeN(splits);
+  MEM_freeN(offsets);
+  MEM_freeN(bucket);
+  return order;
+}
+
+static void kdtree_nearest_clear(KDTreeNearest *nearest)
+{
+  nearest->index = -1;
+  nearest->dist = FLT_MAX;
+  for (uint j = 0; j < KD_DIMS; j++) {
+    nearest->co[j] = 0.0f;
+  }
+}
+
+static void kdtree_batch_settings(TaskParallelSettings *settings, const uint co_len)
+{
+  BLI_parallel_range_settings_defaults(settings);
+  settings->use_threading = (co_len >= KD_BATCH_THREAD_MIN);
+  settings->min_iter_per_thread = KD_BATCH_THREAD_MIN / 4;
+}
+
+typedef struct KDTreeBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  const uint *order;
+  float range;
+  KDTreeNearest *r_nearest;
+  KDTreeNearest **r_nearest_range;
+  int *r_nearest_len;
+} KDTreeBatchData;
+
+static void kdtree_find_nearest_batch_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const uint q = data->order[i];
+
+  BLI_kdtree_nd_(find_nearest)(data->tree, data->co[q], &data->r_nearest[q]);
+}
+
+/**
+ * Find the nearest node of every point in \a co, the queries are answered in parallel.
+ *
+ * \param r_nearest: Array of \a co_len results, with an index of -1 when no node is found.
+ */
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        const uint co_len,
+                                        KDTreeNearest *r_nearest)
+{
+#ifdef DEBUG
+  BLI_assert(tree->is_balanced == true);
+#endif
+
+  if (UNLIKELY(co_len == 0)) {
+    return;
+  }
+
+  if (UNLIKELY(tree->root == KD_NODE_UNSET)) {
+    for (uint i = 0; i < co_len; i++) {
+      kdtree_nearest_clear(&r_nearest[i]);
+    }
+    return;
+  }
+
+  uint *order = kdtree_batch_order(tree, co, co_len);
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .order = order,
+      .r_nearest = r_nearest,
+  };
+
+  TaskParallelSettings settings;
+  kdtree_batch_settings(&settings, co_len);
+  BLI_task_parallel_range(0, (int)co_len, &data, kdtree_find_nearest_batch_cb, &settings);
+
+  MEM_freeN(order);
+}
+
+static void kdtree_range_search_batch_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const uint q = data->order[i];
+
+  data->r_nearest_len[q] = BLI_kdtree_nd_(range_search)(
+      data->tree, data->co[q], &data->r_nearest_range[q], data->range);
+}
+
+/**
+ * Range search for every point in \a co, the queries are answered in parallel.
+ *
+ * \param r_nearest: Array of \a co_len result arrays, sorted by distance like
+ * #BLI_kdtree_3d_range_search. Each is NULL when nothing is found
+ * (caller is responsible for freeing them).
+ * \param r_nearest_len: Array of \a co_len result lengths.
+ */
+void BLI_kdtree_nd_(range_search_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        const uint co_len,
+                                        const float range,
+                                        KDTreeNearest **r_nearest,
+                                        int *r_nearest_len)
+{
+#ifdef DEBUG
+  BLI_assert(tree->is_balanced == true);
+#endif
+
+  if (UNLIKELY(co_len == 0)) {
+    return;
+  }
+
+  if (UNLIKELY(tree->root == KD_NODE_UNSET)) {
+    for (uint i = 0; i < co_len; i++) {
+      r_nearest[i] = NULL;
+      r_nearest_len[i] = 0;
+    }
+    return;
+  }
+
+  uint *order = kdtree_batch_order(tree, co, co_len);
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .order = order,
+      .range = range,
+      .r_nearest_range = r_nearest,
+      .r_nearest_len = r_nearest_len,
+  };
+
+  TaskParallelSettings settings;
+  kdtree_batch_settings(&settings, co_len);
+  BLI_task_parallel_range(0, (int)co_len, &data, kdtree_range_search_batch_cb, &settings);
+
+  MEM_freeN(order);
+}
+
+/** \} */
+
 /**
  * Use when we want to loop over nodes ordered by index.
  * Requires indices to be aligned with nodes.
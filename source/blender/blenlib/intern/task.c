@@ -32,6 +32,8 @@
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
+#include "PIL_time.h"
+
 #include "atomic_ops.h"
 
 /* Define this to enable some detailed statistic print. */
@@ -58,6 +60,17 @@
  */
 #define DELAYED_QUEUE_SIZE 4096
 
+/* Number of tasks which fit into the work-stealing deque of a single thread.
+ *
+ * Must be a power of two. When the deque is full, tasks are pushed to the
+ * scheduler's global queue instead. More details could be found at TaskDeque.
+ */
+#define DEQUE_SIZE 1024
+
+/* Size of the padding used to keep frequently modified atomics of different
+ * threads on different cache lines. */
+#define CACHELINE_SIZE 64
+
 #ifndef NDEBUG
 #  define ASSERT_THREAD_ID(scheduler, thread_id) \
     do { \
@@ -132,6 +145,40 @@ typedef struct TaskMemPoolStats {
 } TaskMemPoolStats;
 #endif
 
+/* This is a per-thread work-stealing deque, based on the Chase-Lev algorithm.
+ *
+ * Owner of the deque pushes and pops tasks at the bottom without any locks,
+ * other threads which ran out of work steal tasks from the top. This way a
+ * thread picks up the tasks it spawned itself first (which are likely to be
+ * hot in the cache), and threads looking for work are spread over all deques
+ * rather than contending on a single global queue mutex.
+ *
+ * All accesses to top and bottom go via atomic operations, which are full
+ * memory barriers, so there is no need in any explicit fences here.
+ *
+ * Every slot stores the pool of a task next to the task itself. This allows
+ * to check which pool a task belongs to without dereferencing the task, which
+ * might have been executed and freed by another thread already.
+ *
+ * Deques are only used when there is at least one worker thread which is
+ * allowed to run any pool, in the background-only configuration all tasks go
+ * through the scheduler's global queue.
+ */
+typedef struct TaskDequeSlot {
+  Task *task;
+  TaskPool *pool;
+} TaskDequeSlot;
+
+typedef struct TaskDeque {
+  /* Index of the oldest task, incremented by thieves. */
+  int64_t top;
+  char _pad1[CACHELINE_SIZE - sizeof(int64_t)];
+  /* Index past the newest task, only modified by the owner thread. */
+  int64_t bottom;
+  char _pad2[CACHELINE_SIZE - sizeof(int64_t)];
+  TaskDequeSlot slots[DEQUE_SIZE];
+} TaskDeque;
+
 typedef struct TaskThreadLocalStorage {
   /* Memory pool for faster task allocation.
    * The idea is to re-use memory of finished/discarded tasks by this thread.
@@ -207,16 +254,28 @@ struct TaskScheduler {
   int num_threads;
   bool background_thread_only;
 
+  /* Global queue, used for tasks pushed from threads which are not handled by
+   * this scheduler, for low priority tasks and when deque of a thread is full. */
   ListBase queue;
   ThreadMutex queue_mutex;
   ThreadCondition queue_cond;
 
+  /* Number of worker threads which are about to sleep or are sleeping on the
+   * queue_cond, used to avoid locking queue_mutex when nobody is to be woken up. */
+  uint32_t num_sleeping_threads;
+  /* Incremented (with queue_mutex locked) every time sleeping threads are to be
+   * woken up. See task_scheduler_thread_wait_pop() for details. */
+  uint32_t wakeup_epoch;
+
   ThreadMutex startup_mutex;
   ThreadCondition startup_cond;
   volatile int num_thread_started;
 
   volatile bool do_exit;
 
+  /* Threads are pinned to NUMA nodes, see task_scheduler_numa_init(). */
+  bool use_numa;
+
   /* NOTE: In pthread's TLS we store the whole TaskThread structure. */
   pthread_key_t tls_id_key;
 };
@@ -225,6 +284,12 @@ typedef struct TaskThread {
   TaskScheduler *scheduler;
   int id;
   TaskThreadLocalStorage tls;
+  /* Work-stealing deque, NULL when scheduler only has background thread. */
+  TaskDeque *deque;
+  /* Indices of threads to steal tasks from, in order of preference. */
+  int *steal_order;
+  /* NUMA node this thread is running on, only used when scheduler uses NUMA. */
+  int numa_node;
 } TaskThread;
 
 /* Helper */
@@ -326,6 +391,108 @@ static void task_free(TaskPool *pool, Task *task, const int thread_id)
   }
 }
 
+/* Work-stealing deque */
+
+static TaskDeque *task_deque_create(void)
+{
+  TaskDeque *deque = MEM_mallocN_aligned(sizeof(TaskDeque), CACHELINE_SIZE, "TaskDeque");
+  deque->top = 0;
+  deque->bottom = 0;
+  return deque;
+}
+
+/* Push task to the bottom of the deque, only to be called from the owner thread.
+ *
+ * Returns false if the deque is full. */
+static bool task_deque_push(TaskDeque *deque, Task *task)
+{
+  const int64_t bottom = deque->bottom;
+  const int64_t top = atomic_add_and_fetch_int64(&deque->top, 0);
+  if (bottom - top >= DEQUE_SIZE) {
+    return false;
+  }
+  TaskDequeSlot *slot = &deque->slots[bottom & (DEQUE_SIZE - 1)];
+  slot->task = task;
+  slot->pool = task->pool;
+  /* Publish the task, atomic operation ensures slot is written before. */
+  atomic_add_and_fetch_int64(&deque->bottom, 1);
+  return true;
+}
+
+/* Pop the newest task from the bottom of the deque, only to be called from the
+ * owner thread.
+ *
+ * If pool is not NULL, only a task which belongs to that pool is popped. */
+static Task *task_deque_pop(TaskDeque *deque, TaskPool *pool)
+{
+  if (pool != NULL) {
+    /* Owner is the only one who writes slots, so it's safe to peek at the
+     * bottom one. If it gets stolen meanwhile the pop below fails. */
+    const int64_t top = atomic_add_and_fetch_int64(&deque->top, 0);
+    const int64_t last = deque->bottom - 1;
+    if (last < top || deque->slots[last & (DEQUE_SIZE - 1)].pool != pool) {
+      return NULL;
+    }
+  }
+
+  const int64_t bottom = atomic_sub_and_fetch_int64(&deque->bottom, 1);
+  const int64_t top = atomic_add_and_fetch_int64(&deque->top, 0);
+  if (top > bottom) {
+    /* Deque is empty, restore bottom so it matches top again. */
+    atomic_add_and_fetch_int64(&deque->bottom, 1);
+    return NULL;
+  }
+  Task *task = deque->slots[bottom & (DEQUE_SIZE - 1)].task;
+  if (top == bottom) {
+    /* This was the last task in the deque, race against thieves for it. */
+    if (atomic_cas_int64(&deque->top, top, top + 1) != top) {
+      task = NULL;
+    }
+    atomic_add_and_fetch_int64(&deque->bottom, 1);
+  }
+  return task;
+}
+
+/* Steal the oldest task from the top of the deque, can be called from any thread.
+ *
+ * If pool is not NULL, only a task which belongs to that pool is stolen. */
+static Task *task_deque_steal(TaskDeque *deque, TaskPool *pool)
+{
+  const int64_t top = atomic_add_and_fetch_int64(&deque->top, 0);
+  const int64_t bottom = atomic_add_and_fetch_int64(&deque->bottom, 0);
+  if (top >= bottom) {
+    return NULL;
+  }
+  /* NOTE: Slot might be overwritten by the owner here, but only after the task
+   * was taken from the deque, in which case the CAS below fails. */
+  const TaskDequeSlot *slot = &deque->slots[top & (DEQUE_SIZE - 1)];
+  Task *task = slot->task;
+  if (pool != NULL && slot->pool != pool) {
+    return NULL;
+  }
+  if (atomic_cas_int64(&deque->top, top, top + 1) != top) {
+    return NULL;
+  }
+  return task;
+}
+
+/* Check whether a task of the given pool is in the deque, can be called from any thread.
+ *
+ * Slots are read without synchronization, which is fine since only the pool pointers are
+ * compared. A task which stays in the deque during the check is always seen, the index of a
+ * task does not change while it is in the deque. */
+static bool task_deque_has_pool_task(TaskDeque *deque, TaskPool *pool)
+{
+  const int64_t top = atomic_add_and_fetch_int64(&deque->top, 0);
+  const int64_t bottom = atomic_add_and_fetch_int64(&deque->bottom, 0);
+  for (int64_t i = top; i < bottom; i++) {
+    if (deque->slots[i & (DEQUE_SIZE - 1)].pool == pool) {
+      return true;
+    }
+  }
+  return false;
+}
+
 /* Task Scheduler */
 
 static void task_pool_num_decrease(TaskPool *pool, size_t done)
@@ -353,55 +520,202 @@ static void task_pool_num_increase(TaskPool *pool, size_t new)
   BLI_mutex_unlock(&pool->num_mutex);
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+/* Get scheduler's thread structure of the calling thread, NULL if the calling
+ * thread is not handled by this scheduler. */
+BLI_INLINE TaskThread *task_scheduler_current_thread(TaskScheduler *scheduler)
 {
-  bool found_task = false;
+  if (BLI_thread_is_main()) {
+    return &scheduler->task_threads[0];
+  }
+  return pthread_getspecific(scheduler->tls_id_key);
+}
+
+/* Wake up one of the sleeping worker threads, if any. */
+static void task_scheduler_wakeup(TaskScheduler *scheduler, const bool wakeup_all)
+{
+  if (atomic_add_and_fetch_uint32(&scheduler->num_sleeping_threads, 0) == 0) {
+    return;
+  }
   BLI_mutex_lock(&scheduler->queue_mutex);
+  scheduler->wakeup_epoch++;
+  if (wakeup_all) {
+    BLI_condition_notify_all(&scheduler->queue_cond);
+  }
+  else {
+    BLI_condition_notify_one(&scheduler->queue_cond);
+  }
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+}
 
-  while (!scheduler->queue.first && !scheduler->do_exit) {
-    BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+/* Pop task from the global queue.
+ *
+ * If pool is not NULL, only a task which belongs to that pool is popped. */
+static Task *task_scheduler_queue_pop(TaskScheduler *scheduler, TaskPool *pool)
+{
+  /* Avoid lock when queue is empty. */
+  if (atomic_cas_ptr(&scheduler->queue.first, NULL, NULL) == NULL) {
+    return NULL;
   }
 
-  do {
-    Task *current_task;
-
-    /* Assuming we can only have a void queue in 'exit' case here seems logical
-     * (we should only be here after our worker thread has been woken up from a
-     * condition_wait(), which only happens after a new task was added to the queue),
-     * but it is wrong.
-     * Waiting on condition may wake up the thread even if condition is not signaled
-     * (spurious wake-ups), and some race condition may also empty the queue **after**
-     * condition has been signaled, but **before** awoken thread reaches this point...
-     * See http://stackoverflow.com/questions/8594591
-     *
-     * So we only abort here if do_exit is set.
-     */
-    if (scheduler->do_exit) {
-      BLI_mutex_unlock(&scheduler->queue_mutex);
-      return false;
+  Task *task;
+  BLI_mutex_lock(&scheduler->queue_mutex);
+  for (task = scheduler->queue.first; task != NULL; task = task->next) {
+    if (pool != NULL) {
+      if (task->pool == pool) {
+        break;
+      }
+    }
+    else if (!scheduler->background_thread_only || task->pool->run_in_background) {
+      break;
     }
+  }
+  if (task != NULL) {
+    BLI_remlink(&scheduler->queue, task);
+  }
+  BLI_mutex_unlock(&scheduler->queue_mutex);
 
-    for (current_task = scheduler->queue.first; current_task != NULL;
-         current_task = current_task->next) {
-      TaskPool *pool = current_task->pool;
+  return task;
+}
 
-      if (scheduler->background_thread_only && !pool->run_in_background) {
+/* Move a task which was taken from a deque to the head of the global queue. The task is already
+ * accounted for in the number of tasks of its pool.
+ *
+ * Threads waiting for the pool might have missed the task while it was moved, so they are woken
+ * up to look for it again. */
+static void task_scheduler_queue_relocate(TaskScheduler *scheduler, Task *task)
+{
+  TaskPool *pool = task->pool;
+
+  BLI_mutex_lock(&scheduler->queue_mutex);
+  BLI_addhead(&scheduler->queue, task);
+  scheduler->wakeup_epoch++;
+  BLI_condition_notify_one(&scheduler->queue_cond);
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+
+  BLI_mutex_lock(&pool->num_mutex);
+  BLI_condition_notify_all(&pool->num_cond);
+  BLI_mutex_unlock(&pool->num_mutex);
+}
+
+/* Find a task of the pool which is buried under tasks of other pools in one of the deques.
+ *
+ * Tasks are only popped or stolen from the ends of a deque, so the tasks in front of it are
+ * moved to the global queue, where they are still picked up by other threads. Without this a
+ * thread waiting for the pool could wait forever when all other threads wait as well. */
+static Task *task_scheduler_find_buried_task(TaskScheduler *scheduler,
+                                             TaskThread *thread,
+                                             TaskPool *pool)
+{
+  const int num_deques = scheduler->num_threads + 1;
+  for (int i = 0; i < num_deques; i++) {
+    TaskDeque *deque = scheduler->task_threads[i].deque;
+    const bool is_owner = (thread != NULL && thread->deque == deque);
+    while (task_deque_has_pool_task(deque, pool)) {
+      Task *task = is_owner ? task_deque_pop(deque, NULL) : task_deque_steal(deque, NULL);
+      if (task == NULL) {
+        /* Lost a race against another thread, check again. */
         continue;
       }
+      if (task->pool == pool) {
+        return task;
+      }
+      task_scheduler_queue_relocate(scheduler, task);
+    }
+  }
+  return NULL;
+}
 
-      *task = current_task;
-      found_task = true;
-      BLI_remlink(&scheduler->queue, *task);
-      break;
+/* Find a task to be executed by the given thread: the newest task from its own
+ * deque first, then the oldest task from deques of other threads, then a task
+ * from the global queue.
+ *
+ * Thread might be NULL for threads which are not handled by the scheduler, and
+ * if pool is not NULL only tasks from that pool are considered. */
+static Task *task_scheduler_find_task(TaskScheduler *scheduler, TaskThread *thread, TaskPool *pool)
+{
+  Task *task;
+
+  if (thread != NULL && thread->deque != NULL) {
+    if ((task = task_deque_pop(thread->deque, pool)) != NULL) {
+      return task;
     }
-    if (!found_task) {
-      BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+  }
+
+  if (!scheduler->background_thread_only) {
+    const int num_deques = scheduler->num_threads + 1;
+    if (thread != NULL) {
+      for (int i = 0; i < num_deques - 1; i++) {
+        TaskThread *victim = &scheduler->task_threads[thread->steal_order[i]];
+        if ((task = task_deque_steal(victim->deque, pool)) != NULL) {
+          return task;
+        }
+      }
+      /* Own deque is only stolen from when looking for tasks of a specific pool,
+       * which might be hidden below tasks of other pools. */
+      if (pool != NULL && (task = task_deque_steal(thread->deque, pool)) != NULL) {
+        return task;
+      }
+    }
+    else {
+      for (int i = 0; i < num_deques; i++) {
+        if ((task = task_deque_steal(scheduler->task_threads[i].deque, pool)) != NULL) {
+          return task;
+        }
+      }
     }
-  } while (!found_task);
+  }
 
-  BLI_mutex_unlock(&scheduler->queue_mutex);
+  if ((task = task_scheduler_queue_pop(scheduler, pool)) != NULL) {
+    return task;
+  }
 
-  return true;
+  if (pool != NULL && !scheduler->background_thread_only) {
+    return task_scheduler_find_buried_task(scheduler, thread, pool);
+  }
+
+  return NULL;
+}
+
+static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler,
+                                           TaskThread *thread,
+                                           Task **task)
+{
+  while (!scheduler->do_exit) {
+    if ((*task = task_scheduler_find_task(scheduler, thread, NULL)) != NULL) {
+      return true;
+    }
+
+    /* Nothing to do, go to sleep.
+     *
+     * Pushing a task only wakes up threads when num_sleeping_threads is not
+     * zero, so we announce ourselves as sleeping and do another check for
+     * tasks. Either the pushing thread sees us sleeping and increments the
+     * wakeup epoch, or we see the pushed task here.
+     *
+     * Comparing the epoch instead of waiting unconditionally avoids missing a
+     * wakeup which happens between the check below and the condition wait, and
+     * also deals with spurious wake-ups of the condition.
+     */
+    atomic_add_and_fetch_uint32(&scheduler->num_sleeping_threads, 1);
+    const uint32_t wakeup_epoch = atomic_add_and_fetch_uint32(&scheduler->wakeup_epoch, 0);
+
+    *task = task_scheduler_find_task(scheduler, thread, NULL);
+    if (*task == NULL) {
+      BLI_mutex_lock(&scheduler->queue_mutex);
+      while (scheduler->wakeup_epoch == wakeup_epoch && !scheduler->do_exit) {
+        BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+      }
+      BLI_mutex_unlock(&scheduler->queue_mutex);
+    }
+
+    atomic_sub_and_fetch_uint32(&scheduler->num_sleeping_threads, 1);
+
+    if (*task != NULL) {
+      return true;
+    }
+  }
+
+  return false;
 }
 
 BLI_INLINE void handle_local_queue(TaskThreadLocalStorage *tls, const int thread_id)
@@ -433,6 +747,10 @@ static void *task_scheduler_thread_run(void *thread_p)
 
   pthread_setspecific(scheduler->tls_id_key, thread);
 
+  if (scheduler->use_numa) {
+    BLI_thread_numa_run_on_node(thread->numa_node);
+  }
+
   /* signal the main thread when all threads have started */
   BLI_mutex_lock(&scheduler->startup_mutex);
   scheduler->num_thread_started++;
@@ -442,13 +760,17 @@ static void *task_scheduler_thread_run(void *thread_p)
   BLI_mutex_unlock(&scheduler->startup_mutex);
 
   /* keep popping off tasks */
-  while (task_scheduler_thread_wait_pop(scheduler, &task)) {
+  while (task_scheduler_thread_wait_pop(scheduler, thread, &task)) {
     TaskPool *pool = task->pool;
 
-    /* run task */
-    BLI_assert(!tls->do_delayed_push);
-    task->run(pool, task->taskdata, thread_id);
-    BLI_assert(!tls->do_delayed_push);
+    /* Tasks of canceled pools can not be removed from the deques, so they are
+     * discarded here instead. */
+    if (!pool->do_cancel) {
+      /* run task */
+      BLI_assert(!tls->do_delayed_push);
+      task->run(pool, task->taskdata, thread_id);
+      BLI_assert(!tls->do_delayed_push);
+    }
 
     /* delete task */
     task_free(pool, task, thread_id);
@@ -463,6 +785,71 @@ static void *task_scheduler_thread_run(void *thread_p)
   return NULL;
 }
 
+/* Assign NUMA nodes to all threads (including the main one, which is not
+ * pinned though), proportionally to the number of processors of every node.
+ * Threads with adjacent indices end up on the same node.
+ *
+ * Returns false when NUMA scheduling is disabled or there is only one node. */
+static bool task_scheduler_numa_init(TaskScheduler *scheduler, const int num_threads_total)
+{
+  if (!BLI_system_numa_scheduling_get()) {
+    return false;
+  }
+  const int num_nodes = BLI_thread_numa_num_nodes();
+  if (num_nodes < 2) {
+    return false;
+  }
+
+  int *node_num_processors = MEM_malloc_arrayN(num_nodes, sizeof(int), __func__);
+  int num_nodes_used = 0, num_processors = 0;
+  for (int node = 0; node < num_nodes; node++) {
+    node_num_processors[node] = BLI_thread_numa_node_num_processors(node);
+    num_processors += node_num_processors[node];
+    num_nodes_used += (node_num_processors[node] != 0) ? 1 : 0;
+  }
+
+  if (num_nodes_used < 2) {
+    MEM_freeN(node_num_processors);
+    return false;
+  }
+
+  for (int i = 0; i < num_threads_total; i++) {
+    const int position = (int)(((int64_t)i * num_processors) / num_threads_total);
+    int node, end = 0;
+    for (node = 0; node < num_nodes - 1; node++) {
+      end += node_num_processors[node];
+      if (position < end) {
+        break;
+      }
+    }
+    scheduler->task_threads[i].numa_node = node;
+  }
+
+  MEM_freeN(node_num_processors);
+  return true;
+}
+
+/* Threads prefer to steal from the threads next to them on the same NUMA node
+ * first, only then from other nodes. */
+static void task_scheduler_steal_order_init(TaskScheduler *scheduler, const int num_threads_total)
+{
+  for (int i = 0; i < num_threads_total; i++) {
+    TaskThread *thread = &scheduler->task_threads[i];
+    int num_victims = 0;
+    thread->steal_order = MEM_malloc_arrayN(
+        max_ii(1, num_threads_total - 1), sizeof(int), "TaskThread steal order");
+    for (int same_node = 1; same_node >= 0; same_node--) {
+      for (int j = 1; j < num_threads_total; j++) {
+        const int victim = (i + j) % num_threads_total;
+        if ((scheduler->task_threads[victim].numa_node == thread->numa_node) == same_node) {
+          thread->steal_order[num_victims++] = victim;
+        }
+      }
+    }
+    BLI_assert(num_victims == num_threads_total - 1);
+  }
+}
+
 TaskScheduler *BLI_task_scheduler_create(int num_threads)
 {
   TaskScheduler *scheduler = MEM_callocN(sizeof(TaskScheduler), "TaskScheduler");
@@ -474,6 +861,8 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
   BLI_listbase_clear(&scheduler->queue);
   BLI_mutex_init(&scheduler->queue_mutex);
   BLI_condition_init(&scheduler->queue_cond);
+  scheduler->num_sleeping_threads = 0;
+  scheduler->wakeup_epoch = 0;
 
   BLI_mutex_init(&scheduler->startup_mutex);
   BLI_condition_init(&scheduler->startup_cond);
@@ -497,8 +886,21 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
                                         "TaskScheduler task threads");
 
   /* Initialize TLS for main thread. */
+  scheduler->task_threads[0].scheduler = scheduler;
+  scheduler->task_threads[0].id = 0;
   initialize_task_tls(&scheduler->task_threads[0].tls);
 
+  /* Create work-stealing deques for all threads, including the main one, before
+   * any worker is launched, since workers steal from each other. */
+  for (int i = 0; i < num_threads + 1; i++) {
+    scheduler->task_threads[i].deque = scheduler->background_thread_only ? NULL :
+                                                                           task_deque_create();
+    scheduler->task_threads[i].numa_node = 0;
+  }
+  scheduler->use_numa = !scheduler->background_thread_only &&
+                        task_scheduler_numa_init(scheduler, num_threads + 1);
+  task_scheduler_steal_order_init(scheduler, num_threads + 1);
+
   pthread_key_create(&scheduler->tls_id_key, NULL);
 
   /* launch threads that will be waiting for work */
@@ -562,7 +964,18 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
   /* Delete task thread data */
   if (scheduler->task_threads) {
     for (int i = 0; i < scheduler->num_threads + 1; i++) {
-      TaskThreadLocalStorage *tls = &scheduler->task_threads[i].tls;
+      TaskThread *thread = &scheduler->task_threads[i];
+      if (thread->deque != NULL) {
+        /* Delete leftover tasks, all threads are joined so it's safe to pop
+         * from any deque here. */
+        while ((task = task_deque_pop(thread->deque, NULL)) != NULL) {
+          task_data_free(task, 0);
+          MEM_freeN(task);
+        }
+        MEM_freeN(thread->deque);
+      }
+      MEM_freeN(thread->steal_order);
+      TaskThreadLocalStorage *tls = &thread->tls;
       free_task_tls(tls);
     }
 
@@ -593,6 +1006,16 @@ static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriori
 {
   task_pool_num_increase(task->pool, 1);
 
+  /* High priority tasks pushed from one of the scheduler's threads go to its
+   * own deque, without any locks. */
+  if (priority == TASK_PRIORITY_HIGH) {
+    TaskThread *thread = task_scheduler_current_thread(scheduler);
+    if (thread != NULL && thread->deque != NULL && task_deque_push(thread->deque, task)) {
+      task_scheduler_wakeup(scheduler, false);
+      return;
+    }
+  }
+
   /* add task to queue */
   BLI_mutex_lock(&scheduler->queue_mutex);
 
@@ -603,10 +1026,45 @@ static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriori
     BLI_addtail(&scheduler->queue, task);
   }
 
+  scheduler->wakeup_epoch++;
   BLI_condition_notify_one(&scheduler->queue_cond);
   BLI_mutex_unlock(&scheduler->queue_mutex);
 }
 
+/* Push list of tasks, which are all considered to be of high priority. */
+static void task_scheduler_push_list(TaskScheduler *scheduler,
+                                     TaskPool *pool,
+                                     ListBase *tasks,
+                                     size_t num_tasks)
+{
+  if (num_tasks == 0) {
+    return;
+  }
+
+  task_pool_num_increase(pool, num_tasks);
+
+  TaskThread *thread = task_scheduler_current_thread(scheduler);
+  if (thread != NULL && thread->deque != NULL) {
+    Task *task;
+    while ((task = tasks->first) != NULL) {
+      if (!task_deque_push(thread->deque, task)) {
+        break;
+      }
+      BLI_remlink(tasks, task);
+    }
+    if (BLI_listbase_is_empty(tasks)) {
+      task_scheduler_wakeup(scheduler, true);
+      return;
+    }
+  }
+
+  BLI_mutex_lock(&scheduler->queue_mutex);
+  BLI_movelisttolist(&scheduler->queue, tasks);
+  scheduler->wakeup_epoch++;
+  BLI_condition_notify_all(&scheduler->queue_cond);
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+}
+
 static void task_scheduler_push_all(TaskScheduler *scheduler,
                                     TaskPool *pool,
                                     Task **tasks,
@@ -618,12 +1076,25 @@ static void task_scheduler_push_all(TaskScheduler *scheduler,
 
   task_pool_num_increase(pool, num_tasks);
 
+  TaskThread *thread = task_scheduler_current_thread(scheduler);
+  int num_pushed = 0;
+  if (thread != NULL && thread->deque != NULL) {
+    while (num_pushed < num_tasks && task_deque_push(thread->deque, tasks[num_pushed])) {
+      num_pushed++;
+    }
+    if (num_pushed == num_tasks) {
+      task_scheduler_wakeup(scheduler, true);
+      return;
+    }
+  }
+
   BLI_mutex_lock(&scheduler->queue_mutex);
 
-  for (int i = 0; i < num_tasks; i++) {
+  for (int i = num_pushed; i < num_tasks; i++) {
     BLI_addhead(&scheduler->queue, tasks[i]);
   }
 
+  scheduler->wakeup_epoch++;
   BLI_condition_notify_all(&scheduler->queue_cond);
   BLI_mutex_unlock(&scheduler->queue_mutex);
 }
@@ -888,14 +1359,7 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
 
   if (atomic_fetch_and_and_uint8((uint8_t *)&pool->is_suspended, 0)) {
     if (pool->num_suspended) {
-      task_pool_num_increase(pool, pool->num_suspended);
-      BLI_mutex_lock(&scheduler->queue_mutex);
-
-      BLI_movelisttolist(&scheduler->queue, &pool->suspended_queue);
-
-      BLI_condition_notify_all(&scheduler->queue_cond);
-      BLI_mutex_unlock(&scheduler->queue_mutex);
-
+      task_scheduler_push_list(scheduler, pool, &pool->suspended_queue, pool->num_suspended);
       pool->num_suspended = 0;
     }
   }
@@ -906,29 +1370,17 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
 
   handle_local_queue(tls, pool->thread_id);
 
+  TaskThread *thread = task_scheduler_current_thread(scheduler);
+
   BLI_mutex_lock(&pool->num_mutex);
 
   while (pool->num != 0) {
-    Task *task, *work_task = NULL;
-    bool found_task = false;
-
     BLI_mutex_unlock(&pool->num_mutex);
 
-    BLI_mutex_lock(&scheduler->queue_mutex);
-
     /* find task from this pool. if we get a task from another pool,
      * we can get into deadlock */
-
-    for (task = scheduler->queue.first; task; task = task->next) {
-      if (task->pool == pool) {
-        work_task = task;
-        found_task = true;
-        BLI_remlink(&scheduler->queue, task);
-        break;
-      }
-    }
-
-    BLI_mutex_unlock(&scheduler->queue_mutex);
+    Task *work_task = task_scheduler_find_task(scheduler, thread, pool);
+    const bool found_task = (work_task != NULL);
 
     /* if found task, do it, otherwise wait until other tasks are done */
     if (found_task) {
@@ -938,7 +1390,7 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
       BLI_assert(!tls->do_delayed_push);
 
       /* delete task */
-      task_free(pool, task, pool->thread_id);
+      task_free(pool, work_task, pool->thread_id);
 
       /* Handle all tasks from local queue. */
       handle_local_queue(tls, pool->thread_id);
@@ -976,10 +1428,24 @@ void BLI_task_pool_cancel(TaskPool *pool)
 
   task_scheduler_clear(pool->scheduler, pool);
 
-  /* wait until all entries are cleared */
+  /* wait until all entries are cleared
+   *
+   * Tasks can not be removed from the work-stealing deques, so help discarding
+   * them here. Worker threads discard tasks of canceled pool as well. */
+  TaskThread *thread = task_scheduler_current_thread(pool->scheduler);
   BLI_mutex_lock(&pool->num_mutex);
   while (pool->num) {
-    BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+    BLI_mutex_unlock(&pool->num_mutex);
+    Task *task = task_scheduler_find_task(pool->scheduler, thread, pool);
+    if (task != NULL) {
+      task_data_free(task, pool->thread_id);
+      MEM_freeN(task);
+      task_pool_num_decrease(pool, 1);
+    }
+    BLI_mutex_lock(&pool->num_mutex);
+    if (task == NULL && pool->num) {
+      BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+    }
   }
   BLI_mutex_unlock(&pool->num_mutex);
 
@@ -1264,10 +1730,198 @@ static void parallel_range_single_thread(TaskParallelRangePool *range_pool)
   }
 }
 
+/* Adaptive range splitting used by BLI_task_parallel_range().
+ *
+ * The range is initially divided evenly between all tasks. Each task consumes
+ * its own sub-range from the beginning, in grains which size is adapted to the
+ * measured cost of the iterations, so that a single grain takes about
+ * RANGE_GRAIN_TIME seconds. When a task runs out of iterations, it steals the
+ * second half of the biggest remaining sub-range of another task
+ * (split-on-steal), so uneven work gets balanced without resorting to tiny
+ * chunks for the whole range.
+ *
+ * Begin and end of a sub-range are packed into a single 64 bit value, so the
+ * owner advancing the beginning and thieves moving the end back can not step
+ * on each other's toes.
+ */
+
+/* Target duration of a single grain of iterations, in seconds. */
+#define RANGE_GRAIN_TIME 5e-5
+
+typedef struct TaskParallelRangeSplit {
+  /* Beginning (low 32 bits) and end (high 32 bits) of the range, relative to start. */
+  uint64_t range;
+  char _pad[CACHELINE_SIZE - sizeof(uint64_t)];
+} TaskParallelRangeSplit;
+BLI_STATIC_ASSERT(sizeof(TaskParallelRangeSplit) == CACHELINE_SIZE,
+                  "Range split is expected to take a single cache line");
+
+typedef struct TaskParallelRangeSplitState {
+  int start;
+  void *userdata;
+  TaskParallelRangeFunc func;
+
+  int num_tasks;
+  TaskParallelRangeSplit *splits;
+
+  /* Grain size bounds and initial value, in number of iterations. */
+  int min_grain;
+  int initial_grain;
+
+  void *flatten_tls_storage;
+  size_t tls_data_size;
+
+  /* With NUMA scheduling every task allocates and initializes its own copy of
+   * the userdata chunk, so its pages are placed on the node of the thread which
+   * uses it (first-touch policy), instead of all copies living next to each
+   * other on the node of the calling thread. */
+  void *initial_tls_memory;
+  void **tls_chunks;
+} TaskParallelRangeSplitState;
+
+BLI_INLINE uint64_t range_split_pack(const int begin, const int end)
+{
+  return (uint64_t)(uint32_t)begin | ((uint64_t)(uint32_t)end << 32);
+}
+
+BLI_INLINE void range_split_unpack(const uint64_t range, int *r_begin, int *r_end)
+{
+  *r_begin = (int)(uint32_t)(range & 0xffffffff);
+  *r_end = (int)(uint32_t)(range >> 32);
+}
+
+BLI_INLINE uint64_t range_split_get(TaskParallelRangeSplit *split)
+{
+  return atomic_add_and_fetch_uint64(&split->range, 0);
+}
+
+/* Take up to grain iterations from the beginning of own range. */
+static bool range_split_take(TaskParallelRangeSplit *split,
+                             const int grain,
+                             const int min_grain,
+                             int *r_begin,
+                             int *r_end)
+{
+  uint64_t range = range_split_get(split);
+  for (;;) {
+    int begin, end;
+    range_split_unpack(range, &begin, &end);
+    if (begin >= end) {
+      return false;
+    }
+    /* Never take more than half of what's left (unless it's less than the
+     * minimum grain), so there is always something to steal for idle tasks
+     * near the end of the loop. */
+    const int count = min_ii(grain, max_ii(min_grain, (end - begin + 1) / 2));
+    const int new_begin = min_ii(begin + count, end);
+    const uint64_t old_range = atomic_cas_uint64(
+        &split->range, range, range_split_pack(new_begin, end));
+    if (old_range == range) {
+      *r_begin = begin;
+      *r_end = new_begin;
+      return true;
+    }
+    range = old_range;
+  }
+}
+
+/* Steal the second half of the biggest remaining range of other tasks into
+ * the (empty) range of the given task. */
+static bool range_split_steal(TaskParallelRangeSplitState *state, const int task_index)
+{
+  for (;;) {
+    int victim_index = -1;
+    uint64_t victim_range = 0;
+    int victim_size = 0;
+    for (int i = 1; i < state->num_tasks; i++) {
+      const int index = (task_index + i) % state->num_tasks;
+      const uint64_t range = range_split_get(&state->splits[index]);
+      int begin, end;
+      range_split_unpack(range, &begin, &end);
+      if (end - begin > victim_size) {
+        victim_index = index;
+        victim_range = range;
+        victim_size = end - begin;
+      }
+    }
+    /* Leave at least a minimum grain to the victim and take at least one. */
+    if (victim_index == -1 || victim_size < 2 || victim_size < state->min_grain * 2) {
+      return false;
+    }
+
+    int begin, end;
+    range_split_unpack(victim_range, &begin, &end);
+    const int mid = begin + victim_size / 2;
+    if (atomic_cas_uint64(&state->splits[victim_index].range,
+                          victim_range,
+                          range_split_pack(begin, mid)) == victim_range) {
+      /* Own range is empty, so nobody else modifies it. */
+      TaskParallelRangeSplit *split = &state->splits[task_index];
+      uint64_t range = range_split_get(split);
+      while (atomic_cas_uint64(&split->range, range, range_split_pack(mid, end)) != range) {
+        range = range_split_get(split);
+      }
+      return true;
+    }
+    /* Victim changed meanwhile, look again. */
+  }
+}
+
+static void parallel_range_split_func(TaskPool *__restrict pool, void *taskdata, int thread_id)
+{
+  TaskParallelRangeSplitState *__restrict state = BLI_task_pool_userdata(pool);
+  const int task_index = POINTER_AS_INT(taskdata);
+  TaskParallelRangeSplit *split = &state->splits[task_index];
+  const int start = state->start;
+  void *userdata = state->userdata;
+  TaskParallelRangeFunc func = state->func;
+  const int min_grain = state->min_grain;
+
+  TaskParallelTLS tls = {
+      .thread_id = thread_id,
+      .userdata_chunk = (state->flatten_tls_storage != NULL) ?
+                            (char *)state->flatten_tls_storage +
+                                (state->tls_data_size * (size_t)task_index) :
+                            NULL,
+  };
+  if (state->tls_chunks != NULL) {
+    tls.userdata_chunk = MEM_mallocN(state->tls_data_size, "TaskParallelRange node-local chunk");
+    memcpy(tls.userdata_chunk, state->initial_tls_memory, state->tls_data_size);
+    state->tls_chunks[task_index] = tls.userdata_chunk;
+  }
+
+  int grain = state->initial_grain;
+  int begin, end;
+  do {
+    while (range_split_take(split, grain, min_grain, &begin, &end)) {
+      const double time_start = PIL_check_seconds_timer();
+      for (int i = begin; i < end; i++) {
+        func(userdata, start + i, &tls);
+      }
+      const double time_elapsed = PIL_check_seconds_timer() - time_start;
+
+      /* Adapt grain to the observed cost of iterations. Only grow after a full
+       * grain was processed, smaller tail grains say nothing about the cost. */
+      if (time_elapsed < RANGE_GRAIN_TIME * 0.5) {
+        if (end - begin == grain && grain < INT_MAX / 2) {
+          grain *= 2;
+        }
+      }
+      else if (time_elapsed > RANGE_GRAIN_TIME * 2.0) {
+        grain = max_ii(min_grain, grain / 2);
+      }
+    }
+  } while (range_split_steal(state, task_index));
+}
+
 /**
  * This function allows to parallelized for loops in a similar way to OpenMP's
  * 'parallel for' statement.
  *
+ * Iterations are distributed using adaptive range splitting, so there is no
+ * need to tune chunk size for the particular loop: #TaskParallelSettings.min_iter_per_thread
+ * is only used as the lower bound of the amount of iterations handled at once.
+ *
  * See public API doc of ParallelRangeSettings for description of all settings.
  */
 void BLI_task_parallel_range(const int start,
@@ -1316,39 +1970,79 @@ void BLI_task_parallel_range(const int start,
   TaskScheduler *task_scheduler = BLI_task_scheduler_get();
   num_threads = BLI_task_scheduler_num_threads(task_scheduler);
 
-  /* The idea here is to prevent creating task for each of the loop iterations
-   * and instead have tasks which are evenly distributed across CPU cores and
-   * pull next iter to be crunched using the queue.
+  /* One task per thread is enough, load is balanced by splitting ranges of
+   * busy tasks rather than by having more tasks than threads.
    */
-  range_pool.num_tasks = num_tasks = num_threads + 2;
-
-  task_parallel_range_calc_chunk_size(&range_pool);
-  range_pool.num_tasks = num_tasks = min_ii(num_tasks,
-                                            max_ii(1, (stop - start) / range_pool.chunk_size));
+  const int num_iters = stop - start;
+  int min_grain = 1;
+  num_tasks = num_threads;
+  if (settings->min_iter_per_thread > 0) {
+    min_grain = settings->min_iter_per_thread;
+    num_tasks = min_ii(num_tasks, max_ii(1, num_iters / min_grain));
+  }
+  else {
+    /* Basic heuristic to avoid threading on low amount of items, same as
+     * task_parallel_calc_chunk_size(). */
+    const int chunk_size = 32 * max_ii(1, num_threads >> 3);
+    if (num_iters < max_ii(256, chunk_size * 2)) {
+      num_tasks = 1;
+    }
+  }
 
   if (num_tasks == 1) {
     parallel_range_single_thread(&range_pool);
     return;
   }
 
-  TaskPool *task_pool = range_pool.pool = BLI_task_pool_create_suspended(task_scheduler,
-                                                                         &range_pool);
+  /* Every split takes a whole cache line, so the buffer is aligned to make sure neighboring
+   * splits don't share one. Neither alloca() nor MEM_mallocN() guarantee that. */
+  const size_t splits_size = sizeof(TaskParallelRangeSplit) * (size_t)num_tasks + CACHELINE_SIZE;
+  void *splits_mem = MALLOCA(splits_size);
+  TaskParallelRangeSplit *splits = (TaskParallelRangeSplit *)(
+      ((uintptr_t)splits_mem + CACHELINE_SIZE - 1) & ~(uintptr_t)(CACHELINE_SIZE - 1));
+  for (i = 0; i < num_tasks; i++) {
+    const int begin = (int)(((int64_t)num_iters * i) / num_tasks);
+    const int end = (int)(((int64_t)num_iters * (i + 1)) / num_tasks);
+    splits[i].range = range_split_pack(begin, end);
+  }
+
+  TaskParallelRangeSplitState split_state = {
+      .start = start,
+      .userdata = userdata,
+      .func = func,
+      .num_tasks = num_tasks,
+      .splits = splits,
+      .min_grain = min_grain,
+      /* Static scheduling hints that all iterations cost the same, so start
+       * with big grains right away, dynamic one starts small and grows. */
+      .initial_grain = (settings->scheduling_mode == TASK_SCHEDULING_STATIC) ?
+                           max_ii(min_grain, num_iters / (num_tasks * 8)) :
+                           min_grain,
+      .flatten_tls_storage = NULL,
+      .tls_data_size = tls_data_size,
+      .initial_tls_memory = tls_data,
+      .tls_chunks = NULL,
+  };
 
-  range_pool.current_state = &state;
+  TaskPool *task_pool = BLI_task_pool_create_suspended(task_scheduler, &split_state);
 
-  if (use_tls_data) {
-    state.flatten_tls_storage = flatten_tls_storage = MALLOCA(tls_data_size * (size_t)num_tasks);
-    state.tls_data_size = tls_data_size;
+  const bool use_local_tls_chunks = use_tls_data && task_scheduler->use_numa;
+  if (use_local_tls_chunks) {
+    split_state.tls_chunks = MALLOCA(sizeof(void *) * (size_t)num_tasks);
+  }
+  else if (use_tls_data) {
+    split_state.flatten_tls_storage = flatten_tls_storage = MALLOCA(tls_data_size *
+                                                                    (size_t)num_tasks);
   }
 
   for (i = 0; i < num_tasks; i++) {
-    if (use_tls_data) {
+    if (use_tls_data && !use_local_tls_chunks) {
       void *userdata_chunk_local = (char *)flatten_tls_storage + (tls_data_size * (size_t)i);
       memcpy(userdata_chunk_local, tls_data, tls_data_size);
     }
     /* Use this pool's pre-allocated tasks. */
     BLI_task_pool_push_from_thread(task_pool,
-                                   parallel_range_func,
+                                   parallel_range_split_func,
                                    POINTER_FROM_INT(i),
                                    false,
                                    TASK_PRIORITY_HIGH,
@@ -1358,7 +2052,18 @@ void BLI_task_parallel_range(const int start,
   BLI_task_pool_work_and_wait(task_pool);
   BLI_task_pool_free(task_pool);
 
-  if (use_tls_data) {
+  MALLOCA_FREE(splits_mem, splits_size);
+
+  if (use_local_tls_chunks) {
+    for (i = 0; i < num_tasks; i++) {
+      if (settings->func_finalize != NULL) {
+        settings->func_finalize(userdata, split_state.tls_chunks[i]);
+      }
+      MEM_freeN(split_state.tls_chunks[i]);
+    }
+    MALLOCA_FREE(split_state.tls_chunks, sizeof(void *) * (size_t)num_tasks);
+  }
+  else if (use_tls_data) {
     if (settings->func_finalize != NULL) {
       for (i = 0; i < num_tasks; i++) {
         void *userdata_chunk_local = (char *)flatten_tls_storage + (tls_data_size * (size_t)i);
@@ -125,6 +125,7 @@ static pthread_t mainid;
 static bool is_numa_available = false;
 static unsigned int thread_levels = 0; /* threads can be invoked inside threads */
 static int num_threads_override = 0;
+static bool use_numa_scheduling = false;
 
 /* just a max for security reasons */
 #define RE_MAX_THREAD BLENDER_MAX_THREADS
@@ -392,6 +393,16 @@ int BLI_system_num_threads_override_get(void)
   return num_threads_override;
 }
 
+void BLI_system_numa_scheduling_set(bool use_numa)
+{
+  use_numa_scheduling = use_numa;
+}
+
+bool BLI_system_numa_scheduling_get(void)
+{
+  return use_numa_scheduling;
+}
+
 /* Global Mutex Locks */
 
 static ThreadMutex *global_mutex_from_type(const int type)
@@ -966,3 +977,27 @@ void BLI_thread_put_thread_on_fast_node(void)
   }
 #endif
 }
+
+int BLI_thread_numa_num_nodes(void)
+{
+  if (!is_numa_available) {
+    return 0;
+  }
+  return numaAPI_GetNumNodes();
+}
+
+int BLI_thread_numa_node_num_processors(int node)
+{
+  if (!is_numa_available || !numaAPI_IsNodeAvailable(node)) {
+    return 0;
+  }
+  return numaAPI_GetNumNodeProcessors(node);
+}
+
+bool BLI_thread_numa_run_on_node(int node)
+{
+  if (!is_numa_available) {
+    return false;
+  }
+  return numaAPI_RunThreadOnNode(node);
+}
@@ -25,6 +25,8 @@
  * \ingroup blenloader
  */
 
+struct GHash;
+struct MemFileSharedBuffer;
 struct Scene;
 
 typedef struct {
@@ -32,13 +34,32 @@ typedef struct {
   const char *buf;
   /** Size in bytes. */
   unsigned int size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** When true, the memory was already stored by another #MemFileChunk when this one was added,
+   * it's shared with any chunk of the same content (in any #MemFile). */
   bool is_identical;
+  /** Reference counted storage of #MemFileChunk.buf. */
+  struct MemFileSharedBuffer *shared;
 } MemFileChunk;
 
+/**
+ * The chunks an ID was written to, to detect IDs that didn't change between two memfiles.
+ */
+typedef struct MemFileIDInfo {
+  /** First chunk of the ID, followed by the others. The chunks only contain data of this ID. */
+  MemFileChunk *chunk_first;
+  int chunks_len;
+  /** Session UUIDs of the IDs used by this one (zero for NULL pointers),
+   * in #BKE_library_foreach_ID_link order. */
+  int id_refs_len;
+  unsigned int *id_refs;
+} MemFileIDInfo;
+
 typedef struct MemFile {
   ListBase chunks;
   size_t size;
+  /** #MemFileIDInfo of the written IDs supporting reuse on undo, by #ID.session_uuid
+   * (NULL when there are none). */
+  struct GHash *id_infos;
 } MemFile;
 
 typedef struct MemFileUndoData {
@@ -53,7 +74,14 @@ extern void memfile_chunk_add(MemFile *memfile,
                               unsigned int size,
                               MemFileChunk **compchunk_step);
 
+extern MemFileIDInfo *memfile_id_info_add(MemFile *memfile, unsigned int session_uuid);
+
 /* exports */
+extern bool BLO_memfile_id_supports_reuse(short idcode);
+extern const MemFileIDInfo *BLO_memfile_id_info_find(const MemFile *memfile,
+                                                     unsigned int session_uuid);
+extern bool BLO_memfile_id_info_is_identical(const MemFileIDInfo *info_a,
+                                             const MemFileIDInfo *info_b);
 extern void BLO_memfile_free(MemFile *memfile);
 extern void BLO_memfile_merge(MemFile *first, MemFile *second);
 
@@ -0,0 +1,536 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Blocked gzip streams for compressed blend files.
+ *
+ * The uncompressed file is split into blocks of #BLOCK_SIZE bytes, each block
+ * is stored as a separate gzip member. Since members are independent they are
+ * compressed and decompressed in parallel, a batch of blocks at a time.
+ *
+ * A sequence of gzip members is a valid gzip stream, so files remain readable
+ * by `gzread()` and any other gzip tool. Each member header stores its own
+ * total size in an extra field (subfield `BL`), which lets the reader split
+ * the stream into members without having to inflate them first:
+ *
+ * <pre>
+ * 0      1f 8b 08 04   ID1, ID2, CM (deflate), FLG (FEXTRA)
+ * 4      00 00 00 00   MTIME
+ * 8      00 ff         XFL, OS (unknown)
+ * 10     08 00         XLEN
+ * 12     42 4c 04 00   SI1, SI2 ('B', 'L'), LEN
+ * 16     uint32        Total member size, header and trailer included.
+ * 20     ...           Raw deflate data.
+ * -8     uint32        CRC32 of the uncompressed block.
+ * -4     uint32        Uncompressed block size.
+ * </pre>
+ *
+ * All integers are little endian, as required by the gzip format.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include <io.h>
+#endif
+
+#include "zlib.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "blend_compress.h"
+
+/* Uncompressed size of blocks, larger blocks are rejected when reading. */
+#define BLOCK_SIZE (1 << 20)
+
+#define MEMBER_HEADER_SIZE 20
+#define MEMBER_TRAILER_SIZE 8
+
+/* Same compression level as used for regular gzip writing. */
+#define COMPRESS_LEVEL 1
+
+/* Upper limit of blocks processed at once, bounds memory usage. */
+#define BATCH_BLOCKS_MAX 64
+
+/* -------------------------------------------------------------------- */
+/** \name Utilities
+ * \{ */
+
+static void write_le16(uchar *p, uint value)
+{
+  p[0] = (uchar)(value & 0xff);
+  p[1] = (uchar)((value >> 8) & 0xff);
+}
+
+static void write_le32(uchar *p, uint value)
+{
+  write_le16(p, value & 0xffff);
+  write_le16(p + 2, value >> 16);
+}
+
+static uint read_le16(const uchar *p)
+{
+  return (uint)p[0] | ((uint)p[1] << 8);
+}
+
+static uint read_le32(const uchar *p)
+{
+  return read_le16(p) | (read_le16(p + 2) << 16);
+}
+
+/* Size of a member holding a block which doesn't compress at all. */
+static uint member_len_max(void)
+{
+  return MEMBER_HEADER_SIZE + (uint)compressBound(BLOCK_SIZE) + MEMBER_TRAILER_SIZE;
+}
+
+static void member_header_write(uchar header[MEMBER_HEADER_SIZE], uint member_len)
+{
+  const uchar header_fixed[16] = {
+      0x1f, 0x8b, Z_DEFLATED, 0x04, 0, 0, 0, 0, 0, 0xff, 8, 0, 'B', 'L', 4, 0};
+  memcpy(header, header_fixed, sizeof(header_fixed));
+  write_le32(header + 16, member_len);
+}
+
+/**
+ * \return The total size of the member, or zero when the header isn't one of a blocked stream.
+ * Sizes a block of #BLOCK_SIZE bytes can't compress to are rejected as well, so a corrupt file
+ * can't make the reader allocate arbitrary amounts of memory.
+ */
+static uint member_header_read(const uchar header[MEMBER_HEADER_SIZE])
+{
+  if (header[0] != 0x1f || header[1] != 0x8b || header[2] != Z_DEFLATED) {
+    return 0;
+  }
+  /* Only FEXTRA is set, other flags would add fields after the extra field. */
+  if (header[3] != 0x04) {
+    return 0;
+  }
+  if (read_le16(header + 10) != 8 || header[12] != 'B' || header[13] != 'L' ||
+      read_le16(header + 14) != 4) {
+    return 0;
+  }
+  const uint member_len = read_le32(header + 16);
+  if (member_len < MEMBER_HEADER_SIZE + MEMBER_TRAILER_SIZE || member_len > member_len_max()) {
+    return 0;
+  }
+  return member_len;
+}
+
+/* Read until `len` bytes are read or the end of the file is reached. */
+static size_t file_read_full(int file, void *buffer, size_t len)
+{
+  size_t totread = 0;
+  while (totread < len) {
+    const int readsize = read(file, POINTER_OFFSET(buffer, totread), (uint)(len - totread));
+    if (readsize <= 0) {
+      break;
+    }
+    totread += (size_t)readsize;
+  }
+  return totread;
+}
+
+static bool file_write_full(int file, const void *buffer, size_t len)
+{
+  size_t totwrite = 0;
+  while (totwrite < len) {
+    const int writesize = write(file, POINTER_OFFSET(buffer, totwrite), (uint)(len - totwrite));
+    if (writesize <= 0) {
+      return false;
+    }
+    totwrite += (size_t)writesize;
+  }
+  return true;
+}
+
+static int batch_blocks_num(void)
+{
+  /* Two blocks per thread, so threads finishing early can pick up more work. */
+  return MIN2(BLI_system_thread_count() * 2, BATCH_BLOCKS_MAX);
+}
+
+static void batch_parallel_range(void *userdata, const int blocks_num, TaskParallelRangeFunc func)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (blocks_num > 1);
+  settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, blocks_num, userdata, func, &settings);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Writing
+ * \{ */
+
+typedef struct CompressBlock {
+  /** Uncompressed data, #BLOCK_SIZE bytes. */
+  uchar *data;
+  uint data_len;
+  /** Complete gzip member, header and trailer included. */
+  uchar *member;
+  uint member_len;
+  bool error;
+} CompressBlock;
+
+struct BlendCompressWriter {
+  int file;
+  CompressBlock *blocks;
+  int blocks_num;
+  /** Block currently being filled. */
+  int block_index;
+  bool error;
+};
+
+static void compress_block_cb(void *__restrict userdata,
+                              const int index,
+                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CompressBlock *block = &((CompressBlock *)userdata)[index];
+  z_stream strm;
+
+  memset(&strm, 0, sizeof(strm));
+  if (deflateInit2(&strm, COMPRESS_LEVEL, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    block->error = true;
+    return;
+  }
+
+  strm.next_in = block->data;
+  strm.avail_in = block->data_len;
+  strm.next_out = block->member + MEMBER_HEADER_SIZE;
+  strm.avail_out = member_len_max() - MEMBER_HEADER_SIZE - MEMBER_TRAILER_SIZE;
+
+  const int err = deflate(&strm, Z_FINISH);
+  const uint compressed_len = (uint)strm.total_out;
+  deflateEnd(&strm);
+
+  if (err != Z_STREAM_END) {
+    block->error = true;
+    return;
+  }
+
+  block->member_len = MEMBER_HEADER_SIZE + compressed_len + MEMBER_TRAILER_SIZE;
+  member_header_write(block->member, block->member_len);
+
+  uchar *trailer = block->member + MEMBER_HEADER_SIZE + compressed_len;
+  write_le32(trailer, (uint)crc32(crc32(0L, Z_NULL, 0), block->data, block->data_len));
+  write_le32(trailer + 4, block->data_len);
+}
+
+/* Compress all filled blocks and write them to the file. */
+static bool writer_flush(BlendCompressWriter *writer)
+{
+  int blocks_num = writer->block_index;
+  if (blocks_num < writer->blocks_num && writer->blocks[blocks_num].data_len != 0) {
+    /* Include the partially filled block. */
+    blocks_num++;
+  }
+
+  if (writer->error || blocks_num == 0) {
+    return !writer->error;
+  }
+
+  batch_parallel_range(writer->blocks, blocks_num, compress_block_cb);
+
+  for (int i = 0; i < blocks_num; i++) {
+    CompressBlock *block = &writer->blocks[i];
+    if (block->error || !file_write_full(writer->file, block->member, block->member_len)) {
+      writer->error = true;
+      break;
+    }
+    block->data_len = 0;
+  }
+
+  writer->block_index = 0;
+  return !writer->error;
+}
+
+BlendCompressWriter *blo_compress_writer_open(const char *filepath)
+{
+  const int file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+  if (file == -1) {
+    return NULL;
+  }
+
+  BlendCompressWriter *writer = MEM_callocN(sizeof(*writer), __func__);
+  writer->file = file;
+  writer->blocks_num = batch_blocks_num();
+  writer->blocks = MEM_callocN(sizeof(*writer->blocks) * (size_t)writer->blocks_num, __func__);
+  return writer;
+}
+
+bool blo_compress_writer_write(BlendCompressWriter *writer, const void *data, size_t data_len)
+{
+  const uchar *data_iter = data;
+
+  while (data_len != 0 && !writer->error) {
+    if (writer->block_index == writer->blocks_num) {
+      writer_flush(writer);
+      continue;
+    }
+
+    CompressBlock *block = &writer->blocks[writer->block_index];
+    if (block->data == NULL) {
+      /* Allocated on first use, small files only need a single block. */
+      block->data = MEM_mallocN(BLOCK_SIZE, __func__);
+      block->member = MEM_mallocN(member_len_max(), __func__);
+    }
+
+    const uint copy_len = (uint)MIN2(data_len, (size_t)(BLOCK_SIZE - block->data_len));
+    memcpy(block->data + block->data_len, data_iter, copy_len);
+    block->data_len += copy_len;
+    data_iter += copy_len;
+    data_len -= copy_len;
+
+    if (block->data_len == BLOCK_SIZE) {
+      writer->block_index++;
+    }
+  }
+
+  return !writer->error;
+}
+
+/**
+ * Writes any remaining data and frees the writer.
+ * \return Success, false when any of the writes failed.
+ */
+bool blo_compress_writer_close(BlendCompressWriter *writer)
+{
+  bool ok = writer_flush(writer);
+
+  if (close(writer->file) == -1) {
+    ok = false;
+  }
+
+  for (int i = 0; i < writer->blocks_num; i++) {
+    MEM_SAFE_FREE(writer->blocks[i].data);
+    MEM_SAFE_FREE(writer->blocks[i].member);
+  }
+  MEM_freeN(writer->blocks);
+  MEM_freeN(writer);
+
+  return ok;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Reading
+ * \{ */
+
+typedef struct DecompressBlock {
+  /** Complete gzip member, header and trailer included. */
+  uchar *member;
+  uint member_len;
+  uint member_alloc_len;
+  /** Uncompressed data. */
+  uchar *data;
+  uint data_len;
+  uint data_alloc_len;
+  bool error;
+} DecompressBlock;
+
+struct BlendCompressReader {
+  int file;
+  DecompressBlock *blocks;
+  int blocks_num;
+  /** Number of blocks in the current batch. */
+  int blocks_used;
+  /** Block and offset in that block to continue reading from. */
+  int block_index;
+  uint block_offset;
+  bool is_eof;
+  bool error;
+};
+
+static void decompress_block_cb(void *__restrict userdata,
+                                const int index,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  DecompressBlock *block = &((DecompressBlock *)userdata)[index];
+  const uchar *trailer = block->member + block->member_len - MEMBER_TRAILER_SIZE;
+  const uint crc_expected = read_le32(trailer);
+
+  block->data_len = read_le32(trailer + 4);
+  if (block->data_len > BLOCK_SIZE) {
+    block->error = true;
+    return;
+  }
+  if (block->data_len > block->data_alloc_len) {
+    MEM_SAFE_FREE(block->data);
+    block->data = MEM_mallocN(block->data_len, __func__);
+    block->data_alloc_len = block->data_len;
+  }
+
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+    block->error = true;
+    return;
+  }
+
+  strm.next_in = block->member + MEMBER_HEADER_SIZE;
+  strm.avail_in = block->member_len - MEMBER_HEADER_SIZE - MEMBER_TRAILER_SIZE;
+  strm.next_out = block->data;
+  strm.avail_out = block->data_len;
+
+  const int err = inflate(&strm, Z_FINISH);
+  const uint decompressed_len = (uint)strm.total_out;
+  inflateEnd(&strm);
+
+  if (err != Z_STREAM_END || decompressed_len != block->data_len ||
+      crc32(crc32(0L, Z_NULL, 0), block->data, block->data_len) != crc_expected) {
+    block->error = true;
+  }
+}
+
+/* Read the next batch of members from the file and decompress them. */
+static bool reader_fill(BlendCompressReader *reader)
+{
+  reader->blocks_used = 0;
+  reader->block_index = 0;
+  reader->block_offset = 0;
+
+  while (reader->blocks_used < reader->blocks_num) {
+    uchar header[MEMBER_HEADER_SIZE];
+    const size_t header_len = file_read_full(reader->file, header, sizeof(header));
+    if (header_len == 0) {
+      reader->is_eof = true;
+      break;
+    }
+
+    const uint member_len = (header_len == sizeof(header)) ? member_header_read(header) : 0;
+    if (member_len == 0) {
+      /* Truncated file or trailing data which isn't part of a blocked stream. */
+      reader->error = true;
+      return false;
+    }
+
+    DecompressBlock *block = &reader->blocks[reader->blocks_used];
+    if (member_len > block->member_alloc_len) {
+      MEM_SAFE_FREE(block->member);
+      block->member = MEM_mallocN(member_len, __func__);
+      block->member_alloc_len = member_len;
+    }
+    memcpy(block->member, header, sizeof(header));
+    if (file_read_full(reader->file,
+                       block->member + sizeof(header),
+                       member_len - sizeof(header)) != member_len - sizeof(header)) {
+      reader->error = true;
+      return false;
+    }
+    block->member_len = member_len;
+    block->error = false;
+    reader->blocks_used++;
+  }
+
+  batch_parallel_range(reader->blocks, reader->blocks_used, decompress_block_cb);
+
+  for (int i = 0; i < reader->blocks_used; i++) {
+    if (reader->blocks[i].error) {
+      reader->error = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Start reading a blocked gzip stream from the start of `file`.
+ *
+ * \return NULL when `file` doesn't start with a blocked gzip member, it can still be read as a
+ * regular gzip stream in that case.
+ * The caller keeps ownership of `file`.
+ */
+BlendCompressReader *blo_compress_reader_open(int file)
+{
+  uchar header[MEMBER_HEADER_SIZE];
+
+  lseek(file, 0, SEEK_SET);
+  const bool is_blocked = (file_read_full(file, header, sizeof(header)) == sizeof(header)) &&
+                          (member_header_read(header) != 0);
+  lseek(file, 0, SEEK_SET);
+
+  if (!is_blocked) {
+    return NULL;
+  }
+
+  BlendCompressReader *reader = MEM_callocN(sizeof(*reader), __func__);
+  reader->file = file;
+  reader->blocks_num = batch_blocks_num();
+  reader->blocks = MEM_callocN(sizeof(*reader->blocks) * (size_t)reader->blocks_num, __func__);
+  return reader;
+}
+
+/**
+ * \return The number of bytes read, less than `size` at the end of the stream, or -1 on error.
+ */
+int blo_compress_reader_read(BlendCompressReader *reader, void *buffer, uint size)
+{
+  uint totread = 0;
+
+  while (totread < size) {
+    if (reader->block_index == reader->blocks_used) {
+      if (reader->is_eof) {
+        break;
+      }
+      if (reader->error || !reader_fill(reader)) {
+        return -1;
+      }
+      continue;
+    }
+
+    DecompressBlock *block = &reader->blocks[reader->block_index];
+    const uint readsize = MIN2(size - totread, block->data_len - reader->block_offset);
+    memcpy(POINTER_OFFSET(buffer, totread), block->data + reader->block_offset, readsize);
+    totread += readsize;
+    reader->block_offset += readsize;
+
+    if (reader->block_offset == block->data_len) {
+      reader->block_index++;
+      reader->block_offset = 0;
+    }
+  }
+
+  return (int)totread;
+}
+
+void blo_compress_reader_close(BlendCompressReader *reader)
+{
+  for (int i = 0; i < reader->blocks_num; i++) {
+    MEM_SAFE_FREE(reader->blocks[i].member);
+    MEM_SAFE_FREE(reader->blocks[i].data);
+  }
+  MEM_freeN(reader->blocks);
+  MEM_freeN(reader);
+}
+
+/** \} */
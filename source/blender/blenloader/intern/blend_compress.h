@@ -0,0 +1,47 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Blocked gzip streams for compressed blend files.
+ */
+
+#ifndef __BLEND_COMPRESS_H__
+#define __BLEND_COMPRESS_H__
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct BlendCompressWriter BlendCompressWriter;
+typedef struct BlendCompressReader BlendCompressReader;
+
+BlendCompressWriter *blo_compress_writer_open(const char *filepath);
+bool blo_compress_writer_write(BlendCompressWriter *writer, const void *data, size_t data_len);
+bool blo_compress_writer_close(BlendCompressWriter *writer);
+
+BlendCompressReader *blo_compress_reader_open(int file);
+int blo_compress_reader_read(BlendCompressReader *reader, void *buffer, uint size);
+void blo_compress_reader_close(BlendCompressReader *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLEND_COMPRESS_H__ */
@@ -359,10 +359,13 @@ BlendFileData *BLO_read_from_memory(const void *mem,
  * \param oldmain: old main,
  * from which we will keep libraries and other data-blocks that should not have changed.
  * \param filename: current file, only for retrieving library data.
+ * \param memfile_current: The memfile of the current state (\a oldmain), when known.
+ * Its IDs which are identical in \a memfile are kept instead of being read again.
  */
 BlendFileData *BLO_read_from_memfile(Main *oldmain,
                                      const char *filename,
                                      MemFile *memfile,
+                                     MemFile *memfile_current,
                                      eBLOReadSkip skip_flags,
                                      ReportList *reports)
 {
@@ -396,6 +399,9 @@ BlendFileData *BLO_read_from_memfile(Main *oldmain,
     /* make lookups of existing sound data in old main */
     blo_make_sound_pointer_map(fd, oldmain);
 
+    /* makes lookup of unchanged IDs in old main */
+    blo_make_undo_reuse_map(fd, oldmain, memfile_current);
+
     /* removed packed data from this trick - it's internal data that needs saves */
 
     bfd = blo_read_file_internal(fd, filename);
@@ -100,7 +100,10 @@
 #include "BLI_math.h"
 #include "BLI_threads.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
 #include "BLI_ghash.h"
+#include "BLI_linklist.h"
+#include "BLI_task.h"
 
 #include "BLT_translation.h"
 
@@ -156,6 +159,7 @@
 
 #include "RE_engine.h"
 
+#include "blend_compress.h"
 #include "readfile.h"
 
 #include <errno.h>
@@ -318,9 +322,12 @@ typedef struct OldNewMap {
   int32_t *map;
 
   int capacity_exp;
+  /* Capacity of the allocated arrays, kept when clearing to avoid reallocating for every ID. */
+  int capacity_exp_alloc;
 } OldNewMap;
 
-#define ENTRIES_CAPACITY(onm) (1ll << (onm)->capacity_exp)
+#define ENTRIES_CAPACITY_EXP(exp) (1ll << (exp))
+#define ENTRIES_CAPACITY(onm) ENTRIES_CAPACITY_EXP((onm)->capacity_exp)
 #define MAP_CAPACITY(onm) (1ll << ((onm)->capacity_exp + 1))
 #define SLOT_MASK(onm) (MAP_CAPACITY(onm) - 1)
 #define DEFAULT_SIZE_EXP 6
@@ -383,17 +390,39 @@ static void oldnewmap_clear_map(OldNewMap *onm)
   memset(onm->map, 0xFF, MAP_CAPACITY(onm) * sizeof(*onm->map));
 }
 
-static void oldnewmap_increase_size(OldNewMap *onm)
+static void oldnewmap_resize(OldNewMap *onm, int capacity_exp)
 {
-  onm->capacity_exp++;
-  onm->entries = MEM_reallocN(onm->entries, sizeof(*onm->entries) * ENTRIES_CAPACITY(onm));
-  onm->map = MEM_reallocN(onm->map, sizeof(*onm->map) * MAP_CAPACITY(onm));
+  onm->capacity_exp = capacity_exp;
+  if (capacity_exp > onm->capacity_exp_alloc) {
+    onm->capacity_exp_alloc = capacity_exp;
+    onm->entries = MEM_reallocN(onm->entries, sizeof(*onm->entries) * ENTRIES_CAPACITY(onm));
+    /* The map is rebuilt from the entries, no need to copy it. */
+    MEM_freeN(onm->map);
+    onm->map = MEM_malloc_arrayN(MAP_CAPACITY(onm), sizeof(*onm->map), "OldNewMap.map");
+  }
   oldnewmap_clear_map(onm);
   for (int i = 0; i < onm->nentries; i++) {
     oldnewmap_insert_index_in_map(onm, onm->entries[i].oldp, i);
   }
 }
 
+static void oldnewmap_increase_size(OldNewMap *onm)
+{
+  oldnewmap_resize(onm, onm->capacity_exp + 1);
+}
+
+/* Ensure `nentries` can be stored without growing the map again. */
+static void oldnewmap_reserve(OldNewMap *onm, int nentries)
+{
+  int capacity_exp = onm->capacity_exp;
+  while (ENTRIES_CAPACITY_EXP(capacity_exp) < nentries) {
+    capacity_exp++;
+  }
+  if (capacity_exp != onm->capacity_exp) {
+    oldnewmap_resize(onm, capacity_exp);
+  }
+}
+
 /* Public OldNewMap API */
 
 static OldNewMap *oldnewmap_new(void)
@@ -401,6 +430,7 @@ static OldNewMap *oldnewmap_new(void)
   OldNewMap *onm = MEM_callocN(sizeof(*onm), "OldNewMap");
 
   onm->capacity_exp = DEFAULT_SIZE_EXP;
+  onm->capacity_exp_alloc = DEFAULT_SIZE_EXP;
   onm->entries = MEM_malloc_arrayN(
       ENTRIES_CAPACITY(onm), sizeof(*onm->entries), "OldNewMap.entries");
   onm->map = MEM_malloc_arrayN(MAP_CAPACITY(onm), sizeof(*onm->map), "OldNewMap.map");
@@ -485,6 +515,7 @@ static void oldnewmap_free(OldNewMap *onm)
   MEM_freeN(onm);
 }
 
+#undef ENTRIES_CAPACITY_EXP
 #undef ENTRIES_CAPACITY
 #undef MAP_CAPACITY
 #undef SLOT_MASK
@@ -961,6 +992,11 @@ static bool blo_bhead_read_data(FileData *fd, BHead *thisblock, void *buf)
   bool success = true;
   BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
   BLI_assert(new_bhead->has_data == false && new_bhead->file_offset != 0);
+  if (fd->mmap_file != NULL) {
+    /* Copy directly from the mapped file, no need to seek back and forth. */
+    return BLI_mmap_read(
+        fd->mmap_file, buf, (size_t)new_bhead->file_offset, (size_t)new_bhead->bhead.len);
+  }
   off64_t offset_backup = fd->file_offset;
   if (UNLIKELY(fd->seek(fd, new_bhead->file_offset, SEEK_SET) == -1)) {
     success = false;
@@ -1171,6 +1207,65 @@ static int fd_read_gzip_from_file(FileData *filedata, void *buffer, uint size)
   return (readsize);
 }
 
+/* Memory-mapped file reading.
+ * By only copying blocks out of the mapped memory (instead of going through 'read()' calls)
+ * data is moved once from the systems page cache into the allocated blocks. */
+
+static int fd_read_from_mmap(FileData *filedata, void *buffer, uint size)
+{
+  /* don't read more bytes then there are available in the file */
+  const size_t readsize = MIN2(
+      (size_t)size, BLI_mmap_get_length(filedata->mmap_file) - (size_t)filedata->file_offset);
+
+  if (!BLI_mmap_read(filedata->mmap_file, buffer, (size_t)filedata->file_offset, readsize)) {
+    return EOF;
+  }
+
+  filedata->file_offset += readsize;
+
+  return (int)readsize;
+}
+
+static off64_t fd_seek_from_mmap(FileData *filedata, off64_t offset, int whence)
+{
+  off64_t new_pos;
+  if (whence == SEEK_CUR) {
+    new_pos = filedata->file_offset + offset;
+  }
+  else if (whence == SEEK_SET) {
+    new_pos = offset;
+  }
+  else if (whence == SEEK_END) {
+    new_pos = (off64_t)BLI_mmap_get_length(filedata->mmap_file) + offset;
+  }
+  else {
+    return -1;
+  }
+
+  if (new_pos < 0 || new_pos > (off64_t)BLI_mmap_get_length(filedata->mmap_file)) {
+    return -1;
+  }
+
+  filedata->file_offset = new_pos;
+  return filedata->file_offset;
+}
+
+/* Blocked GZip file reading. */
+
+static int fd_read_blocked_gzip_from_file(FileData *filedata, void *buffer, uint size)
+{
+  int readsize = blo_compress_reader_read(filedata->compress_reader, buffer, size);
+
+  if (readsize < 0) {
+    readsize = EOF;
+  }
+  else {
+    filedata->file_offset += readsize;
+  }
+
+  return (readsize);
+}
+
 /* Memory reading. */
 
 static int fd_read_from_memory(FileData *filedata, void *buffer, uint size)
@@ -1297,6 +1392,8 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  BlendCompressReader *compress_reader = NULL;
+  BLI_mmap_file *mmap_file = NULL;
 
   char header[7];
 
@@ -1318,6 +1415,22 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
     read_fn = fd_read_data_from_file;
     seek_fn = fd_seek_data_from_file;
+
+    mmap_file = BLI_mmap_open(file);
+    if (mmap_file != NULL) {
+      read_fn = fd_read_from_mmap;
+      seek_fn = fd_seek_from_mmap;
+    }
+  }
+
+  /* Blocked gzip file, decompressed using multiple threads. */
+  if ((read_fn == NULL) &&
+      /* Check header magic. */
+      (header[0] == 0x1f && header[1] == 0x8b)) {
+    compress_reader = blo_compress_reader_open(file);
+    if (compress_reader != NULL) {
+      read_fn = fd_read_blocked_gzip_from_file;
+    }
   }
 
   /* Gzip file. */
@@ -1351,6 +1464,8 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->compress_reader = compress_reader;
+  fd->mmap_file = mmap_file;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1415,20 +1530,29 @@ static int fd_read_gzip_from_memory(FileData *filedata, void *buffer, uint size)
   filedata->strm.next_out = (Bytef *)buffer;
   filedata->strm.avail_out = size;
 
-  // Inflate another chunk.
-  err = inflate(&filedata->strm, Z_SYNC_FLUSH);
+  while (filedata->strm.avail_out != 0) {
+    // Inflate another chunk.
+    err = inflate(&filedata->strm, Z_SYNC_FLUSH);
 
-  if (err == Z_STREAM_END) {
-    return 0;
-  }
-  else if (err != Z_OK) {
-    printf("fd_read_gzip_from_memory: zlib error\n");
-    return 0;
+    if (err == Z_STREAM_END) {
+      /* Compressed files are written as a sequence of gzip members, continue with the next. */
+      if (filedata->strm.avail_in == 0 || inflateReset(&filedata->strm) != Z_OK) {
+        break;
+      }
+    }
+    else if (err != Z_OK) {
+      printf("fd_read_gzip_from_memory: zlib error\n");
+      return 0;
+    }
+    else if (filedata->strm.avail_in == 0) {
+      break;
+    }
   }
 
-  filedata->file_offset += size;
+  const int readsize = (int)(size - filedata->strm.avail_out);
+  filedata->file_offset += readsize;
 
-  return (size);
+  return (readsize);
 }
 
 static int fd_read_gzip_from_memory_init(FileData *fd)
@@ -1507,6 +1631,14 @@ void blo_filedata_free(FileData *fd)
       gzclose(fd->gzfiledes);
     }
 
+    if (fd->compress_reader != NULL) {
+      blo_compress_reader_close(fd->compress_reader);
+    }
+
+    if (fd->mmap_file != NULL) {
+      BLI_mmap_free(fd->mmap_file);
+    }
+
     if (fd->strm.next_in) {
       if (inflateEnd(&fd->strm) != Z_OK) {
         printf("close gzip stream error\n");
@@ -1565,6 +1697,10 @@ void blo_filedata_free(FileData *fd)
     if (fd->bheadmap) {
       MEM_freeN(fd->bheadmap);
     }
+    if (fd->undo_old_ids) {
+      BLI_ghash_free(fd->undo_old_ids, NULL, NULL);
+    }
+    BLI_linklist_free(fd->undo_reused_ids, NULL);
 
 #ifdef USE_GHASH_BHEAD
     if (fd->bhead_idname_hash) {
@@ -1849,6 +1985,92 @@ static void change_link_placeholder_to_real_ID_pointer(ListBase *mainlist,
   }
 }
 
+/* Number of libmap entries handled by a single task when replacing placeholders. */
+#define PLACEHOLDERS_REPLACE_CHUNK_SIZE 4096
+
+typedef struct PlaceholdersReplaceData {
+  /* Chunks of #PLACEHOLDERS_REPLACE_CHUNK_SIZE entries for all libmaps. */
+  OldNewMap **chunk_maps;
+  int *chunk_starts;
+  /* Placeholder ID to real ID (or NULL when the ID was lost). */
+  GHash *placeholder_map;
+} PlaceholdersReplaceData;
+
+static void change_link_placeholders_to_real_ID_pointers_cb(
+    void *__restrict userdata, const int index, const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PlaceholdersReplaceData *data = userdata;
+  OldNewMap *onm = data->chunk_maps[index];
+  const int start = data->chunk_starts[index];
+  const int end = min_ii(start + PLACEHOLDERS_REPLACE_CHUNK_SIZE, onm->nentries);
+
+  for (int i = start; i < end; i++) {
+    OldNew *entry = &onm->entries[i];
+    if (entry->nr == ID_LINK_PLACEHOLDER) {
+      void **new_p = BLI_ghash_lookup_p(data->placeholder_map, entry->newp);
+      if (new_p != NULL) {
+        ID *new = *new_p;
+        entry->newp = new;
+        if (new) {
+          entry->nr = GS(new->name);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Same as #change_link_placeholder_to_real_ID_pointer for all placeholders in `placeholder_map`
+ * at once. Libmaps of all libraries are scanned only once, using multiple threads.
+ */
+static void change_link_placeholders_to_real_ID_pointers(ListBase *mainlist,
+                                                         FileData *basefd,
+                                                         GHash *placeholder_map)
+{
+  if (BLI_ghash_len(placeholder_map) == 0) {
+    return;
+  }
+
+  int chunks_len = 0;
+  LISTBASE_FOREACH (Main *, mainptr, mainlist) {
+    FileData *fd = mainptr->curlib ? mainptr->curlib->filedata : basefd;
+    if (fd) {
+      chunks_len += (fd->libmap->nentries + PLACEHOLDERS_REPLACE_CHUNK_SIZE - 1) /
+                    PLACEHOLDERS_REPLACE_CHUNK_SIZE;
+    }
+  }
+  if (chunks_len == 0) {
+    return;
+  }
+
+  PlaceholdersReplaceData data = {
+      .chunk_maps = MEM_malloc_arrayN(chunks_len, sizeof(OldNewMap *), __func__),
+      .chunk_starts = MEM_malloc_arrayN(chunks_len, sizeof(int), __func__),
+      .placeholder_map = placeholder_map,
+  };
+
+  int chunk = 0;
+  LISTBASE_FOREACH (Main *, mainptr, mainlist) {
+    FileData *fd = mainptr->curlib ? mainptr->curlib->filedata : basefd;
+    if (fd) {
+      for (int i = 0; i < fd->libmap->nentries; i += PLACEHOLDERS_REPLACE_CHUNK_SIZE) {
+        data.chunk_maps[chunk] = fd->libmap;
+        data.chunk_starts[chunk] = i;
+        chunk++;
+      }
+    }
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(
+      0, chunks_len, &data, change_link_placeholders_to_real_ID_pointers_cb, &settings);
+
+  MEM_freeN(data.chunk_maps);
+  MEM_freeN(data.chunk_starts);
+}
+
 /* lib linked proxy objects point to our local data, we need
  * to clear that pointer before reading the undo memfile since
  * the object might be removed, it is set again in reading
@@ -2089,6 +2311,37 @@ void blo_end_sound_pointer_map(FileData *fd, Main *oldmain)
   }
 }
 
+/**
+ * In undo case, IDs which didn't change since \a memfile_current was written are kept as-is
+ * instead of being read again, see #read_libblock_undo_reuse_find.
+ *
+ * \param memfile_current: The memfile \a oldmain was written to or read from,
+ * when its IDs may only have changed in ways tagged by #ID.recalc_after_undo_push.
+ */
+void blo_make_undo_reuse_map(FileData *fd, Main *oldmain, MemFile *memfile_current)
+{
+  if (memfile_current == NULL || memfile_current->id_infos == NULL) {
+    return;
+  }
+
+  fd->undo_memfile_current = memfile_current;
+  fd->undo_old_ids = BLI_ghash_int_new(__func__);
+
+  ListBase *lbarray[MAX_LIBARRAY];
+  int a = set_listbasepointers(oldmain, lbarray);
+  while (a--) {
+    ID *id = lbarray[a]->first;
+    if (id == NULL || !BLO_memfile_id_supports_reuse(GS(id->name))) {
+      continue;
+    }
+    for (; id; id = id->next) {
+      if (id->session_uuid != 0) {
+        BLI_ghash_insert(fd->undo_old_ids, POINTER_FROM_UINT(id->session_uuid), id);
+      }
+    }
+  }
+}
+
 /* XXX disabled this feature - packed files also belong in temp saves and quit.blend,
  * to make restore work. */
 
@@ -2248,6 +2501,18 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
     if (fd->compflags[bh->SDNAnr] != SDNA_CMP_REMOVED) {
       if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
 #ifdef USE_BHEAD_READ_ON_DEMAND
+        if (BHEADN_FROM_BHEAD(bh)->has_data == false && fd->mmap_file != NULL) {
+          /* Reconstruct directly from the mapped file, without an intermediate copy. */
+          const void *data = POINTER_OFFSET(BLI_mmap_get_pointer(fd->mmap_file),
+                                            BHEADN_FROM_BHEAD(bh)->file_offset);
+          temp = DNA_struct_reconstruct(
+              fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, data);
+          if (UNLIKELY(BLI_mmap_has_io_error(fd->mmap_file))) {
+            fd->flags &= ~FD_FLAGS_FILE_OK;
+            MEM_SAFE_FREE(temp);
+          }
+          return temp;
+        }
         if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
           bh = blo_bhead_read_full(fd, bh);
           if (UNLIKELY(bh == NULL)) {
@@ -5034,6 +5299,7 @@ static void direct_link_customdata(FileData *fd, CustomData *data, int count)
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+    layer->sharing_info = NULL;
 
     if (CustomData_verify_versions(data, i)) {
       layer->data = newdataadr(fd, layer->data);
@@ -9279,11 +9545,73 @@ static const char *dataname(short id_code)
   return "Data from Lib Block";
 }
 
+/* Minimum size of the data of an ID to read it using multiple threads. */
+#define READ_DATA_PARALLEL_MIN_SIZE (1 << 20)
+
+typedef struct ReadDataParallelData {
+  FileData *fd;
+  BHead **bheads;
+  void **data;
+  const char *allocname;
+} ReadDataParallelData;
+
+static void read_data_parallel_cb(void *__restrict userdata,
+                                  const int index,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ReadDataParallelData *data = userdata;
+  data->data[index] = read_struct(data->fd, data->bheads[index], data->allocname);
+}
+
 static BHead *read_data_into_oldnewmap(FileData *fd, BHead *bhead, const char *allocname)
 {
-  bhead = blo_bhead_next(fd, bhead);
+  BHead *bhead_first = blo_bhead_next(fd, bhead);
+  BHead *bhead_end;
+  int bheads_len = 0;
+  size_t data_len = 0;
+
+  for (bhead = bhead_first; bhead && bhead->code == DATA; bhead = blo_bhead_next(fd, bhead)) {
+    bheads_len++;
+    data_len += (size_t)bhead->len;
+  }
+  bhead_end = bhead;
+
+  oldnewmap_reserve(fd->datamap, fd->datamap->nentries + bheads_len);
+
+  /* Reading from a memory mapped file is thread-safe, large data (mesh arrays, custom data
+   * layers, ...) is copied and reconstructed in parallel. */
+  if (fd->mmap_file != NULL && bheads_len > 1 && data_len >= READ_DATA_PARALLEL_MIN_SIZE) {
+    ReadDataParallelData data = {
+        .fd = fd,
+        .bheads = MEM_malloc_arrayN(bheads_len, sizeof(BHead *), __func__),
+        .data = MEM_malloc_arrayN(bheads_len, sizeof(void *), __func__),
+        .allocname = allocname,
+    };
+
+    int i = 0;
+    for (bhead = bhead_first; bhead != bhead_end; bhead = blo_bhead_next(fd, bhead)) {
+      data.bheads[i++] = bhead;
+    }
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(0, bheads_len, &data, read_data_parallel_cb, &settings);
 
-  while (bhead && bhead->code == DATA) {
+    /* Insert in file order, the same as when reading serially. */
+    for (i = 0; i < bheads_len; i++) {
+      if (data.data[i]) {
+        oldnewmap_insert(fd->datamap, data.bheads[i]->old, data.data[i], 0);
+      }
+    }
+
+    MEM_freeN(data.bheads);
+    MEM_freeN(data.data);
+    return bhead_end;
+  }
+
+  for (bhead = bhead_first; bhead != bhead_end; bhead = blo_bhead_next(fd, bhead)) {
     void *data;
 #if 0
     /* XXX DUMB DEBUGGING OPTION TO GIVE NAMES for guarded malloc errors */
@@ -9299,13 +9627,198 @@ static BHead *read_data_into_oldnewmap(FileData *fd, BHead *bhead, const char *a
     if (data) {
       oldnewmap_insert(fd->datamap, bhead->old, data, 0);
     }
+  }
 
-    bhead = blo_bhead_next(fd, bhead);
+  return bhead_end;
+}
+
+/* While expanding, IDs are only added to the Mains by #read_libblock, so the name lookup tables
+ * built on demand for each Main can be kept up to date, see #expand_is_yet_read.
+ * Keeps the first ID found, like #BLI_findstring. */
+static void expand_idname_map_add(GHash *idname_map, ID *id)
+{
+  void **val_p;
+  if (!BLI_ghash_ensure_p(idname_map, id->name, &val_p)) {
+    *val_p = id;
+  }
+}
+
+static void expand_idname_maps_add(FileData *fd, Main *main, ID *id)
+{
+  if (fd->expand_idname_maps != NULL) {
+    GHash *idname_map = BLI_ghash_lookup(fd->expand_idname_maps, main);
+    if (idname_map != NULL) {
+      expand_idname_map_add(idname_map, id);
+    }
+  }
+}
+
+static void expand_idname_maps_remove(FileData *fd, Main *main, ID *id)
+{
+  if (fd->expand_idname_maps != NULL) {
+    GHash *idname_map = BLI_ghash_lookup(fd->expand_idname_maps, main);
+    if (idname_map != NULL && BLI_ghash_lookup(idname_map, id->name) == id) {
+      BLI_ghash_remove(idname_map, id->name, NULL, NULL);
+    }
+  }
+}
+
+static void expand_idname_map_free(void *idname_map)
+{
+  BLI_ghash_free(idname_map, NULL, NULL);
+}
+
+typedef struct UndoReuseIDRefsCheck {
+  const MemFileIDInfo *info;
+  int index;
+  bool is_identical;
+} UndoReuseIDRefsCheck;
+
+static int read_libblock_undo_id_refs_cb(void *user_data,
+                                         ID *UNUSED(id_self),
+                                         ID **id_pointer,
+                                         int UNUSED(cb_flag))
+{
+  UndoReuseIDRefsCheck *check = user_data;
+  const uint session_uuid = (*id_pointer != NULL) ? (*id_pointer)->session_uuid : 0;
+
+  if (check->index >= check->info->id_refs_len ||
+      check->info->id_refs[check->index] != session_uuid ||
+      (*id_pointer != NULL && session_uuid == 0)) {
+    check->is_identical = false;
+    return IDWALK_RET_STOP_ITER;
+  }
+  check->index++;
+  return IDWALK_RET_NOP;
+}
+
+/**
+ * In undo case, find the ID of the old main to keep instead of reading \a id, when both the ID
+ * and the IDs it uses are the same in the memfile being read and in the current state.
+ */
+static ID *read_libblock_undo_reuse_find(FileData *fd, Main *main, const ID *id)
+{
+  if (main->curlib != NULL || id->session_uuid == 0) {
+    return NULL;
+  }
+
+  ID *id_old = BLI_ghash_lookup(fd->undo_old_ids, POINTER_FROM_UINT(id->session_uuid));
+  if (id_old == NULL || GS(id_old->name) != GS(id->name)) {
+    return NULL;
+  }
+  /* Changed since the current state was written. */
+  if (id_old->recalc_after_undo_push != 0) {
+    return NULL;
   }
 
+  const MemFileIDInfo *info = BLO_memfile_id_info_find(fd->memfile, id->session_uuid);
+  const MemFileIDInfo *info_current = BLO_memfile_id_info_find(fd->undo_memfile_current,
+                                                               id->session_uuid);
+  if (info == NULL || info_current == NULL ||
+      !BLO_memfile_id_info_is_identical(info, info_current)) {
+    return NULL;
+  }
+
+  /* The IDs used by the old ID are remapped by their session UUID once everything is read. */
+  UndoReuseIDRefsCheck check = {.info = info, .is_identical = true};
+  BKE_library_foreach_ID_link(
+      NULL, id_old, read_libblock_undo_id_refs_cb, &check, IDWALK_READONLY);
+  if (!check.is_identical || check.index != info->id_refs_len) {
+    return NULL;
+  }
+
+  return id_old;
+}
+
+/**
+ * Move \a id_old to the new main instead of reading the ID, skipping its data.
+ */
+static BHead *read_libblock_undo_reuse(
+    FileData *fd, Main *main, BHead *bhead, const int tag, ID *id_old, ID **r_id)
+{
+  Main *oldmain = fd->old_mainlist->first;
+  const short idcode = GS(id_old->name);
+
+  BLI_ghash_remove(fd->undo_old_ids, POINTER_FROM_UINT(id_old->session_uuid), NULL, NULL);
+  BLI_remlink(which_libbase(oldmain, idcode), id_old);
+  BLI_addtail(which_libbase(main, idcode), id_old);
+  expand_idname_maps_add(fd, main, id_old);
+
+  /* For IDs being read using this one. */
+  oldnewmap_insert(fd->libmap, bhead->old, id_old, bhead->code);
+  BLI_linklist_prepend(&fd->undo_reused_ids, id_old);
+
+  /* Users are counted again when linking, like for IDs being read. */
+  id_old->us = ID_FAKE_USERS(id_old);
+  id_old->newid = NULL;
+  id_old->tag = tag;
+
+  if (r_id) {
+    *r_id = id_old;
+  }
+
+  do {
+    bhead = blo_bhead_next(fd, bhead);
+  } while (bhead && bhead->code == DATA);
+
   return bhead;
 }
 
+static int read_undo_reused_id_relink_cb(void *user_data,
+                                         ID *UNUSED(id_self),
+                                         ID **id_pointer,
+                                         int cb_flag)
+{
+  GHash *new_ids = user_data;
+
+  if (*id_pointer == NULL) {
+    return IDWALK_RET_NOP;
+  }
+
+  *id_pointer = BLI_ghash_lookup(new_ids, POINTER_FROM_UINT((*id_pointer)->session_uuid));
+  BLI_assert(*id_pointer != NULL);
+
+  if (*id_pointer != NULL) {
+    if (cb_flag & IDWALK_CB_USER) {
+      id_us_plus_no_lib(*id_pointer);
+    }
+    if (cb_flag & IDWALK_CB_USER_ONE) {
+      id_us_ensure_real(*id_pointer);
+    }
+  }
+
+  return IDWALK_RET_NOP;
+}
+
+/**
+ * IDs kept from the old main still use IDs of the old main,
+ * replace those by the new IDs with the same session UUID.
+ */
+static void read_undo_reused_ids_relink(FileData *fd, Main *bmain)
+{
+  if (fd->undo_reused_ids == NULL) {
+    return;
+  }
+
+  GHash *new_ids = BLI_ghash_int_new(__func__);
+  ID *id;
+  FOREACH_MAIN_ID_BEGIN (bmain, id) {
+    if (id->session_uuid != 0) {
+      BLI_ghash_reinsert(new_ids, POINTER_FROM_UINT(id->session_uuid), id, NULL, NULL);
+    }
+  }
+  FOREACH_MAIN_ID_END;
+
+  for (LinkNode *link = fd->undo_reused_ids; link; link = link->next) {
+    BKE_library_foreach_ID_link(
+        bmain, link->link, read_undo_reused_id_relink_cb, new_ids, IDWALK_NOP);
+  }
+
+  BLI_ghash_free(new_ids, NULL, NULL);
+  BLI_linklist_free(fd->undo_reused_ids, NULL);
+  fd->undo_reused_ids = NULL;
+}
+
 static BHead *read_libblock(FileData *fd,
                             Main *main,
                             BHead *bhead,
@@ -9388,6 +9901,14 @@ static BHead *read_libblock(FileData *fd,
   /* read libblock */
   id = read_struct(fd, bhead, "lib block");
 
+  if (id && fd->undo_old_ids && BLO_memfile_id_supports_reuse(GS(id->name))) {
+    ID *id_old = read_libblock_undo_reuse_find(fd, main, id);
+    if (id_old != NULL) {
+      MEM_freeN(id);
+      return read_libblock_undo_reuse(fd, main, bhead, tag, id_old, r_id);
+    }
+  }
+
   if (id) {
     const short idcode = GS(id->name);
     /* do after read_struct, for dna reconstruct */
@@ -9397,6 +9918,7 @@ static BHead *read_libblock(FileData *fd,
       oldnewmap_insert(fd->libmap, bhead->old, id, bhead->code);
 
       BLI_addtail(lb, id);
+      expand_idname_maps_add(fd, main, id);
     }
     else {
       /* unknown ID type */
@@ -9430,6 +9952,15 @@ static BHead *read_libblock(FileData *fd,
   if (!fd->memfile) {
     id->recalc = 0;
   }
+  id->recalc_after_undo_push = 0;
+
+  /* Session UUIDs identify IDs across undo steps, they are not meaningful in files. */
+  if (fd->memfile) {
+    BKE_libblock_session_uuid_ensure(id);
+  }
+  else {
+    BKE_libblock_session_uuid_renew(id);
+  }
 
   /* this case cannot be direct_linked: it's just the ID part */
   if (bhead->code == ID_LINK_PLACEHOLDER) {
@@ -9580,6 +10111,7 @@ static BHead *read_libblock(FileData *fd,
      * However, it is absolutely **not** handled correctly: it is freeing an ID pointer that has
      * been added to the fd->libmap mapping, which in theory could lead to nice crashes...
      * This should be properly solved at some point. */
+    expand_idname_maps_remove(fd, main, id);
     BKE_id_free(main, id);
     if (r_id != NULL) {
       *r_id = NULL;
@@ -10049,6 +10581,8 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 
     lib_link_all(fd, bfd->main);
 
+    read_undo_reused_ids_relink(fd, bfd->main);
+
     /* Skip in undo case. */
     if (fd->memfile == NULL) {
       /* Yep, second splitting... but this is a very cheap operation, so no big deal. */
@@ -10233,6 +10767,33 @@ static ID *is_yet_read(FileData *fd, Main *mainvar, BHead *bhead)
   return BLI_findstring(which_libbase(mainvar, GS(idname)), idname, offsetof(ID, name));
 }
 
+/**
+ * Same as #is_yet_read, but uses the name lookup tables of #library_expand_main when available.
+ * A linear search of the ID list for every expanded pointer makes expanding many linked IDs
+ * quadratic.
+ */
+static ID *expand_is_yet_read(FileData *fd, Main *mainvar, BHead *bhead)
+{
+  if (fd->expand_idname_maps == NULL) {
+    return is_yet_read(fd, mainvar, bhead);
+  }
+
+  GHash **idname_map_p;
+  if (!BLI_ghash_ensure_p(fd->expand_idname_maps, mainvar, (void ***)&idname_map_p)) {
+    ListBase *lbarray[MAX_LIBARRAY];
+    int a = set_listbasepointers(mainvar, lbarray);
+
+    *idname_map_p = BLI_ghash_str_new(__func__);
+    while (a--) {
+      LISTBASE_FOREACH (ID *, id, lbarray[a]) {
+        expand_idname_map_add(*idname_map_p, id);
+      }
+    }
+  }
+
+  return BLI_ghash_lookup(*idname_map_p, blo_bhead_id_name(fd, bhead));
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -10269,7 +10830,7 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
       return;
     }
 
-    ID *id = is_yet_read(fd, libmain, bhead);
+    ID *id = expand_is_yet_read(fd, libmain, bhead);
 
     if (id == NULL) {
       /* ID has not been read yet, add placeholder to the main of the
@@ -10299,16 +10860,18 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
        * (B) forest.blend: contains Forest collection linking in Tree from tree.blend.
        * (C) shot.blend: links in both Tree from tree.blend and Forest from forest.blend.
        */
-      oldnewmap_insert(fd->libmap, bhead->old, id, bhead->code);
-
       /* If "id" is a real data-lock and not a placeholder, we need to
-       * update fd->libmap to replace ID_LINK_PLACEHOLDER with the real
-       * ID_* code.
+       * insert it with its real ID_* code instead of ID_LINK_PLACEHOLDER.
        *
        * When the real ID is read this replacement happens for all
        * libraries read so far, but not for libraries that have not been
-       * read yet at that point. */
-      change_link_placeholder_to_real_ID_pointer_fd(fd, bhead->old, id);
+       * read yet at that point. Inserting the right code directly avoids
+       * scanning the whole fd->libmap for every already read ID. */
+      oldnewmap_insert(fd->libmap,
+                       bhead->old,
+                       id,
+                       (id->tag & LIB_TAG_ID_LINK_PLACEHOLDER) ? ID_LINK_PLACEHOLDER :
+                                                                 GS(id->name));
 
       /* Commented because this can print way too much. */
 #if 0
@@ -10327,7 +10890,7 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
       bhead->code = ID_SCR;
     }
 
-    ID *id = is_yet_read(fd, mainvar, bhead);
+    ID *id = expand_is_yet_read(fd, mainvar, bhead);
     if (id == NULL) {
       read_libblock(fd, mainvar, bhead, LIB_TAG_NEED_EXPAND | LIB_TAG_INDIRECT, false, NULL);
     }
@@ -11379,6 +11942,24 @@ void BLO_expand_main(void *fdhandle, Main *mainvar)
   }
 }
 
+/**
+ * #BLO_expand_main for linking, with name lookup tables for the IDs already read,
+ * see #expand_is_yet_read.
+ */
+static void library_expand_main(FileData *fd, Main *mainvar)
+{
+  if (fd != NULL) {
+    fd->expand_idname_maps = BLI_ghash_ptr_new(__func__);
+  }
+
+  BLO_expand_main(fd, mainvar);
+
+  if (fd != NULL) {
+    BLI_ghash_free(fd->expand_idname_maps, NULL, expand_idname_map_free);
+    fd->expand_idname_maps = NULL;
+  }
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -11809,7 +12390,7 @@ static void library_link_end(Main *mainl,
   BLO_main_expander(expand_doit_library);
 
   /* make main consistent */
-  BLO_expand_main(*fd, mainl);
+  library_expand_main(*fd, mainl);
 
   /* do this when expand found other libs */
   read_libraries(*fd, (*fd)->mainlist);
@@ -11990,6 +12571,7 @@ static void read_library_linked_ids(FileData *basefd,
                                     Main *mainvar)
 {
   GHash *loaded_ids = BLI_ghash_str_new(__func__);
+  GHash *placeholder_map = BLI_ghash_ptr_new(__func__);
 
   ListBase *lbarray[MAX_LIBARRAY];
   int a = set_listbasepointers(mainvar, lbarray);
@@ -12018,8 +12600,9 @@ static void read_library_linked_ids(FileData *basefd,
 
         /* Now that we have a real ID, replace all pointers to placeholders in
          * fd->libmap with pointers to the real data-blocks. We do this for all
-         * libraries since multiple might be referencing this ID. */
-        change_link_placeholder_to_real_ID_pointer(mainlist, basefd, id, *realid);
+         * libraries since multiple might be referencing this ID, for all IDs of
+         * this type at once below. */
+        BLI_ghash_insert(placeholder_map, id, *realid);
 
         /* We cannot free old lib-ref placeholder ID here anymore, since we use
          * its name as key in loaded_ids hash. */
@@ -12028,34 +12611,49 @@ static void read_library_linked_ids(FileData *basefd,
       id = id_next;
     }
 
+    change_link_placeholders_to_real_ID_pointers(mainlist, basefd, placeholder_map);
+
     /* Clear GHash and free link placeholder IDs of the current type. */
     BLI_ghash_clear(loaded_ids, NULL, NULL);
+    BLI_ghash_clear(placeholder_map, NULL, NULL);
     BLI_freelistN(&pending_free_ids);
   }
 
   BLI_ghash_free(loaded_ids, NULL, NULL);
+  BLI_ghash_free(placeholder_map, NULL, NULL);
 }
 
 static void read_library_clear_weak_links(FileData *basefd, ListBase *mainlist, Main *mainvar)
 {
   /* Any remaining weak links at this point have been lost, silently drop
    * those by setting them to NULL pointers. */
+  GHash *placeholder_map = BLI_ghash_ptr_new(__func__);
+
   ListBase *lbarray[MAX_LIBARRAY];
   int a = set_listbasepointers(mainvar, lbarray);
 
   while (a--) {
     ID *id = lbarray[a]->first;
+    ListBase pending_free_ids = {NULL};
 
     while (id) {
       ID *id_next = id->next;
       if ((id->tag & LIB_TAG_ID_LINK_PLACEHOLDER) && (id->flag & LIB_INDIRECT_WEAK_LINK)) {
         /* printf("Dropping weak link to %s\n", id->name); */
-        change_link_placeholder_to_real_ID_pointer(mainlist, basefd, id, NULL);
-        BLI_freelinkN(lbarray[a], id);
+        BLI_ghash_insert(placeholder_map, id, NULL);
+        BLI_remlink(lbarray[a], id);
+        BLI_addtail(&pending_free_ids, id);
       }
       id = id_next;
     }
+
+    change_link_placeholders_to_real_ID_pointers(mainlist, basefd, placeholder_map);
+
+    BLI_ghash_clear(placeholder_map, NULL, NULL);
+    BLI_freelistN(&pending_free_ids);
   }
+
+  BLI_ghash_free(placeholder_map, NULL, NULL);
 }
 
 static FileData *read_library_file_data(FileData *basefd,
@@ -12177,7 +12775,7 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
 
         /* Test if linked data-locks need to read further linked data-locks
          * and create link placeholders for them. */
-        BLO_expand_main(fd, mainptr);
+        library_expand_main(fd, mainptr);
       }
     }
   }
@@ -30,6 +30,8 @@
 #include "DNA_space_types.h"
 #include "DNA_windowmanager_types.h" /* for ReportType */
 
+struct BLI_mmap_file;
+struct BlendCompressReader;
 struct Key;
 struct MemFile;
 struct Object;
@@ -81,6 +83,10 @@ typedef struct FileData {
 
   /** Variables needed for reading from file. */
   gzFile gzfiledes;
+  /** Memory mapped file reading, when supported for the file. */
+  struct BLI_mmap_file *mmap_file;
+  /** Blocked gzip file reading, decompressed in parallel. */
+  struct BlendCompressReader *compress_reader;
   /** Gzip stream for memory decompression. */
   z_stream strm;
 
@@ -117,9 +123,18 @@ typedef struct FileData {
   /** See: #USE_GHASH_BHEAD. */
   struct GHash *bhead_idname_hash;
 
+  /** Name lookup tables for each Main while expanding, see: #expand_is_yet_read. */
+  struct GHash *expand_idname_maps;
+
   ListBase *mainlist;
   /** Used for undo. */
   ListBase *old_mainlist;
+  /** Memfile of the current state in undo case, see #blo_make_undo_reuse_map. */
+  struct MemFile *undo_memfile_current;
+  /** Old main IDs which may be kept as-is, by #ID.session_uuid. */
+  struct GHash *undo_old_ids;
+  /** IDs kept from the old main, relinked once all IDs have been read. */
+  struct LinkNode *undo_reused_ids;
 
   struct ReportList *reports;
 } FileData;
@@ -146,6 +161,9 @@ void blo_make_movieclip_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_end_movieclip_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_make_sound_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_end_sound_pointer_map(FileData *fd, struct Main *oldmain);
+void blo_make_undo_reuse_map(FileData *fd,
+                             struct Main *oldmain,
+                             struct MemFile *memfile_current);
 void blo_make_packed_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_end_packed_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_add_library_pointer_map(ListBase *old_mainlist, FileData *fd);
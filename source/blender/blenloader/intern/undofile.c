@@ -38,9 +38,13 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "DNA_ID.h"
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm3.h"
+#include "BLI_threads.h"
 
 #include "BLO_undofile.h"
 #include "BLO_readfile.h"
@@ -52,43 +56,135 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/**
+ * Chunk buffers are stored by content in a store shared by all memfiles, so identical data
+ * is only stored once, wherever it is in the undo history (not only when it is at the same
+ * position as in the previous step).
+ */
+typedef struct MemFileSharedBuffer {
+  const char *buf;
+  uint size;
+  /** #BLI_hash_mm3 of the buffer. */
+  uint hash;
+  /** Number of #MemFileChunk using this buffer. */
+  uint users;
+} MemFileSharedBuffer;
+
+static struct {
+  /** Set of #MemFileSharedBuffer, allocated while any is in use. */
+  GSet *buffers;
+  ThreadMutex lock;
+} g_memfile_store = {NULL, BLI_MUTEX_INITIALIZER};
+
+static uint memfile_shared_buffer_hash(const void *key)
+{
+  return ((const MemFileSharedBuffer *)key)->hash;
+}
+
+static bool memfile_shared_buffer_cmp(const void *a, const void *b)
+{
+  const MemFileSharedBuffer *buffer_a = a;
+  const MemFileSharedBuffer *buffer_b = b;
+  return (buffer_a->hash != buffer_b->hash) || (buffer_a->size != buffer_b->size) ||
+         (memcmp(buffer_a->buf, buffer_b->buf, buffer_a->size) != 0);
+}
+
+/**
+ * Find the stored buffer with the same content or store a copy of \a buf.
+ * \param r_is_new: Set when the buffer was not stored yet.
+ */
+static MemFileSharedBuffer *memfile_shared_buffer_ensure(const char *buf,
+                                                         uint size,
+                                                         bool *r_is_new)
+{
+  MemFileSharedBuffer key = {
+      .buf = buf,
+      .size = size,
+      .hash = BLI_hash_mm3((const uchar *)buf, size, 0),
+  };
+
+  BLI_mutex_lock(&g_memfile_store.lock);
+
+  if (g_memfile_store.buffers == NULL) {
+    g_memfile_store.buffers = BLI_gset_new(
+        memfile_shared_buffer_hash, memfile_shared_buffer_cmp, __func__);
+  }
+
+  void **buffer_p;
+  *r_is_new = !BLI_gset_ensure_p_ex(g_memfile_store.buffers, &key, &buffer_p);
+  if (*r_is_new) {
+    MemFileSharedBuffer *buffer = MEM_mallocN(sizeof(*buffer), "MemFileSharedBuffer");
+    char *buf_new = MEM_mallocN(size, "Chunk buffer");
+    memcpy(buf_new, buf, size);
+    *buffer = key;
+    buffer->buf = buf_new;
+    /* The key of the set is the stored buffer, not the temporary one. */
+    *buffer_p = buffer;
+  }
+  MemFileSharedBuffer *buffer = *buffer_p;
+  buffer->users++;
+
+  BLI_mutex_unlock(&g_memfile_store.lock);
+
+  return buffer;
+}
+
+static void memfile_shared_buffer_user_add(MemFileSharedBuffer *buffer)
+{
+  BLI_mutex_lock(&g_memfile_store.lock);
+  buffer->users++;
+  BLI_mutex_unlock(&g_memfile_store.lock);
+}
+
+static void memfile_shared_buffer_user_remove(MemFileSharedBuffer *buffer)
+{
+  BLI_mutex_lock(&g_memfile_store.lock);
+
+  BLI_assert(buffer->users > 0);
+  buffer->users--;
+  if (buffer->users == 0) {
+    BLI_gset_remove(g_memfile_store.buffers, buffer, NULL);
+    MEM_freeN((void *)buffer->buf);
+    MEM_freeN(buffer);
+
+    if (BLI_gset_len(g_memfile_store.buffers) == 0) {
+      BLI_gset_free(g_memfile_store.buffers, NULL);
+      g_memfile_store.buffers = NULL;
+    }
+  }
+
+  BLI_mutex_unlock(&g_memfile_store.lock);
+}
+
+static void memfile_id_info_free(void *info_v)
+{
+  MemFileIDInfo *info = info_v;
+  MEM_SAFE_FREE(info->id_refs);
+  MEM_freeN(info);
+}
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
   MemFileChunk *chunk;
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    memfile_shared_buffer_user_remove(chunk->shared);
     MEM_freeN(chunk);
   }
   memfile->size = 0;
+
+  if (memfile->id_infos != NULL) {
+    BLI_ghash_free(memfile->id_infos, NULL, memfile_id_info_free);
+    memfile->id_infos = NULL;
+  }
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
 /* result is that 'first' is being freed */
-void BLO_memfile_merge(MemFile *first, MemFile *second)
+void BLO_memfile_merge(MemFile *first, MemFile *UNUSED(second))
 {
-  MemFileChunk *fc, *sc;
-
-  fc = first->chunks.first;
-  sc = second->chunks.first;
-  while (fc || sc) {
-    if (fc && sc) {
-      if (sc->is_identical) {
-        sc->is_identical = false;
-        fc->is_identical = true;
-      }
-    }
-    if (fc) {
-      fc = fc->next;
-    }
-    if (sc) {
-      sc = sc->next;
-    }
-  }
-
+  /* Buffers are reference counted, the ones still used by 'second' are kept. */
   BLO_memfile_free(first);
 }
 
@@ -98,36 +194,103 @@ void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChun
   curchunk->size = size;
   curchunk->buf = NULL;
   curchunk->is_identical = false;
+  curchunk->shared = NULL;
   BLI_addtail(&memfile->chunks, curchunk);
 
-  /* we compare compchunk with buf */
+  /* we compare compchunk with buf, this is the common case and avoids hashing */
   if (*compchunk_step != NULL) {
     MemFileChunk *compchunk = *compchunk_step;
     if (compchunk->size == curchunk->size) {
       if (memcmp(compchunk->buf, buf, size) == 0) {
         curchunk->buf = compchunk->buf;
+        curchunk->shared = compchunk->shared;
         curchunk->is_identical = true;
+        memfile_shared_buffer_user_add(curchunk->shared);
       }
     }
     *compchunk_step = compchunk->next;
   }
 
-  /* not equal... */
+  /* not equal, look for the same data anywhere else in the undo history */
   if (curchunk->buf == NULL) {
-    char *buf_new = MEM_mallocN(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+    bool is_new;
+    curchunk->shared = memfile_shared_buffer_ensure(buf, size, &is_new);
+    curchunk->buf = curchunk->shared->buf;
+    curchunk->is_identical = !is_new;
+    if (is_new) {
+      memfile->size += size;
+    }
   }
 }
 
+/**
+ * ID types which are kept as-is on undo when they didn't change, see #BLO_read_from_memfile.
+ *
+ * Only types whose changes are always tagged for depsgraph update (as user edits) can be
+ * supported, other changes (edit-mode, sculpting, ...) push undo steps of their own.
+ */
+bool BLO_memfile_id_supports_reuse(short idcode)
+{
+  return ELEM(idcode, ID_ME, ID_CU, ID_MB, ID_LT);
+}
+
+/**
+ * Start tracking the chunks of an ID, the caller adds them to the returned info.
+ */
+MemFileIDInfo *memfile_id_info_add(MemFile *memfile, uint session_uuid)
+{
+  BLI_assert(session_uuid != 0);
+
+  if (memfile->id_infos == NULL) {
+    memfile->id_infos = BLI_ghash_int_new(__func__);
+  }
+
+  MemFileIDInfo *info = MEM_callocN(sizeof(*info), "MemFileIDInfo");
+  BLI_ghash_insert(memfile->id_infos, POINTER_FROM_UINT(session_uuid), info);
+  return info;
+}
+
+const MemFileIDInfo *BLO_memfile_id_info_find(const MemFile *memfile, uint session_uuid)
+{
+  if (memfile->id_infos == NULL) {
+    return NULL;
+  }
+  return BLI_ghash_lookup(memfile->id_infos, POINTER_FROM_UINT(session_uuid));
+}
+
+/**
+ * \return True when the ID was written to identical chunks and uses the same IDs.
+ * Buffers are shared by content, so comparing them doesn't need to read the data.
+ */
+bool BLO_memfile_id_info_is_identical(const MemFileIDInfo *info_a, const MemFileIDInfo *info_b)
+{
+  if (info_a->chunks_len != info_b->chunks_len || info_a->id_refs_len != info_b->id_refs_len) {
+    return false;
+  }
+
+  const MemFileChunk *chunk_a = info_a->chunk_first;
+  const MemFileChunk *chunk_b = info_b->chunk_first;
+  for (int i = 0; i < info_a->chunks_len; i++) {
+    if (chunk_a->shared != chunk_b->shared) {
+      return false;
+    }
+    chunk_a = chunk_a->next;
+    chunk_b = chunk_b->next;
+  }
+
+  return (info_a->id_refs_len == 0) ||
+         (memcmp(info_a->id_refs,
+                 info_b->id_refs,
+                 sizeof(*info_a->id_refs) * (size_t)info_a->id_refs_len) == 0);
+}
+
 struct Main *BLO_memfile_main_get(struct MemFile *memfile,
                                   struct Main *oldmain,
                                   struct Scene **r_scene)
 {
   struct Main *bmain_undo = NULL;
   BlendFileData *bfd = BLO_read_from_memfile(
-      oldmain, BKE_main_blendfile_path(oldmain), memfile, BLO_READ_SKIP_NONE, NULL);
+      oldmain, BKE_main_blendfile_path(oldmain), memfile, NULL, BLO_READ_SKIP_NONE, NULL);
 
   if (bfd) {
     bmain_undo = bfd->main;
@@ -142,9 +142,12 @@
 #include "DNA_curveprofile_types.h"
 
 #include "MEM_guardedalloc.h"  // MEM_freeN
+#include "BLI_alloca.h"
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_buffer.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BKE_action.h"
 #include "BKE_blender_version.h"
@@ -158,6 +161,7 @@
 #include "BKE_idcode.h"
 #include "BKE_layer.h"
 #include "BKE_library_override.h"
+#include "BKE_library_query.h"
 #include "BKE_main.h"
 #include "BKE_modifier.h"
 #include "BKE_node.h"
@@ -174,6 +178,7 @@
 #include "BLO_undofile.h"
 #include "BLO_writefile.h"
 
+#include "blend_compress.h"
 #include "readfile.h"
 
 /* for SDNA_TYPE_FROM_STRUCT() macro */
@@ -215,7 +220,7 @@ struct WriteWrap {
   /* internal */
   union {
     int file_handle;
-    gzFile gz_handle;
+    BlendCompressWriter *compress_writer;
   } _user_data;
 };
 
@@ -246,17 +251,17 @@ static size_t ww_write_none(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
-/* zlib */
-#define FILE_HANDLE(ww) (ww)->_user_data.gz_handle
+/* zlib, written as blocked gzip (see blend_compress.c) to compress using multiple threads. */
+#define FILE_HANDLE(ww) (ww)->_user_data.compress_writer
 
 static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 {
-  gzFile file;
+  BlendCompressWriter *writer;
 
-  file = BLI_gzopen(filepath, "wb1");
+  writer = blo_compress_writer_open(filepath);
 
-  if (file != Z_NULL) {
-    FILE_HANDLE(ww) = file;
+  if (writer != NULL) {
+    FILE_HANDLE(ww) = writer;
     return true;
   }
   else {
@@ -265,11 +270,11 @@ static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 }
 static bool ww_close_zlib(WriteWrap *ww)
 {
-  return (gzclose(FILE_HANDLE(ww)) == Z_OK);
+  return blo_compress_writer_close(FILE_HANDLE(ww));
 }
 static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 {
-  return gzwrite(FILE_HANDLE(ww), buf, buf_len);
+  return blo_compress_writer_write(FILE_HANDLE(ww), buf, buf_len) ? buf_len : 0;
 }
 #undef FILE_HANDLE
 
@@ -325,6 +330,8 @@ typedef struct {
     MemFile *compare;
     /** Use to de-duplicate chunks when writing. */
     MemFileChunk *compare_chunk;
+    /** The ID being written, when its chunks are tracked (see #mywrite_id_begin). */
+    MemFileIDInfo *id_info;
   } mem;
   /** When true, write to #WriteData.current, could also call 'is_undo'. */
   bool use_memfile;
@@ -335,6 +342,12 @@ typedef struct {
    * Will be NULL for UNDO.
    */
   WriteWrap *ww;
+
+  /**
+   * When set, calls to #mywrite are recorded here instead of being written,
+   * to be replayed later in order (see #write_ids_parallel).
+   */
+  BLI_Buffer *record;
 } WriteData;
 
 static WriteData *writedata_new(WriteWrap *ww)
@@ -365,6 +378,14 @@ static void writedata_do_write(WriteData *wd, const void *mem, int memlen)
   /* memory based save */
   if (wd->use_memfile) {
     memfile_chunk_add(wd->mem.current, mem, memlen, &wd->mem.compare_chunk);
+
+    MemFileIDInfo *id_info = wd->mem.id_info;
+    if (id_info != NULL) {
+      if (id_info->chunk_first == NULL) {
+        id_info->chunk_first = wd->mem.current->chunks.last;
+      }
+      id_info->chunks_len++;
+    }
   }
   else {
     if (wd->ww->write(wd->ww, mem, memlen) != memlen) {
@@ -415,6 +436,16 @@ static void mywrite(WriteData *wd, const void *adr, int len)
     return;
   }
 
+  if (wd->record != NULL) {
+    /* Store the length followed by the data, #mywrite_replay calls #mywrite the same way. */
+    const size_t offset = wd->record->count;
+    BLI_buffer_resize(wd->record, offset + sizeof(int) + (size_t)len);
+    uchar *record_data = BLI_buffer_array(wd->record, uchar);
+    memcpy(&record_data[offset], &len, sizeof(int));
+    memcpy(&record_data[offset + sizeof(int)], adr, (size_t)len);
+    return;
+  }
+
 #ifdef USE_WRITE_DATA_LEN
   wd->write_len += len;
 #endif
@@ -453,6 +484,73 @@ static void mywrite(WriteData *wd, const void *adr, int len)
   }
 }
 
+/**
+ * Write data recorded by #mywrite, splitting and buffering it exactly as when it was written
+ * directly, so the output is the same (including the chunks of memfile undo).
+ */
+static void mywrite_replay(WriteData *wd, BLI_Buffer *record)
+{
+  const uchar *record_data = record->data;
+  size_t offset = 0;
+
+  while (offset < record->count) {
+    int len;
+    memcpy(&len, &record_data[offset], sizeof(int));
+    offset += sizeof(int);
+    mywrite(wd, &record_data[offset], len);
+    offset += (size_t)len;
+  }
+}
+
+static int mywrite_id_refs_cb(void *user_data,
+                              ID *UNUSED(id_self),
+                              ID **id_pointer,
+                              int UNUSED(cb_flag))
+{
+  BLI_Buffer *id_refs = user_data;
+  const uint session_uuid = (*id_pointer != NULL) ? (*id_pointer)->session_uuid : 0;
+  BLI_buffer_append(id_refs, uint, session_uuid);
+  return IDWALK_RET_NOP;
+}
+
+/**
+ * Call before writing an ID. For memfile undo, the chunks of IDs which can be kept as-is on
+ * undo are tracked, so that reading can detect they didn't change (see #MemFileIDInfo).
+ */
+static void mywrite_id_begin(WriteData *wd, ID *id)
+{
+  if (!wd->use_memfile || id->session_uuid == 0 || !BLO_memfile_id_supports_reuse(GS(id->name))) {
+    return;
+  }
+
+  /* Start a new chunk, so it only contains data of this ID. */
+  mywrite_flush(wd);
+
+  MemFileIDInfo *id_info = memfile_id_info_add(wd->mem.current, id->session_uuid);
+
+  BLI_buffer_declare_static(uint, id_refs, BLI_BUFFER_NOP, 64);
+  BKE_library_foreach_ID_link(NULL, id, mywrite_id_refs_cb, &id_refs, IDWALK_READONLY);
+  if (id_refs.count != 0) {
+    id_info->id_refs_len = (int)id_refs.count;
+    id_info->id_refs = MEM_mallocN(sizeof(uint) * id_refs.count, __func__);
+    memcpy(id_info->id_refs, id_refs.data, sizeof(uint) * id_refs.count);
+  }
+  BLI_buffer_free(&id_refs);
+
+  wd->mem.id_info = id_info;
+}
+
+/**
+ * Call after writing an ID, see #mywrite_id_begin.
+ */
+static void mywrite_id_end(WriteData *wd)
+{
+  if (wd->mem.id_info != NULL) {
+    mywrite_flush(wd);
+    wd->mem.id_info = NULL;
+  }
+}
+
 /**
  * BeGiN initializer for mywrite
  * \param ww: File write wrapper.
@@ -3748,6 +3846,213 @@ static void write_thumb(WriteData *wd, const BlendThumbnail *thumb)
 /** \name File Writing (Private)
  * \{ */
 
+static void write_id(WriteData *wd, ID *id)
+{
+  /* We should never attempt to write non-regular IDs
+   * (i.e. all kind of temp/runtime ones). */
+  BLI_assert((id->tag & (LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT | LIB_TAG_NOT_ALLOCATED)) ==
+             0);
+
+  switch ((ID_Type)GS(id->name)) {
+    case ID_WM:
+      write_windowmanager(wd, (wmWindowManager *)id);
+      break;
+    case ID_WS:
+      write_workspace(wd, (WorkSpace *)id);
+      break;
+    case ID_SCR:
+      write_screen(wd, (bScreen *)id);
+      break;
+    case ID_MC:
+      write_movieclip(wd, (MovieClip *)id);
+      break;
+    case ID_MSK:
+      write_mask(wd, (Mask *)id);
+      break;
+    case ID_SCE:
+      write_scene(wd, (Scene *)id);
+      break;
+    case ID_CU:
+      write_curve(wd, (Curve *)id);
+      break;
+    case ID_MB:
+      write_mball(wd, (MetaBall *)id);
+      break;
+    case ID_IM:
+      write_image(wd, (Image *)id);
+      break;
+    case ID_CA:
+      write_camera(wd, (Camera *)id);
+      break;
+    case ID_LA:
+      write_light(wd, (Light *)id);
+      break;
+    case ID_LT:
+      write_lattice(wd, (Lattice *)id);
+      break;
+    case ID_VF:
+      write_vfont(wd, (VFont *)id);
+      break;
+    case ID_KE:
+      write_key(wd, (Key *)id);
+      break;
+    case ID_WO:
+      write_world(wd, (World *)id);
+      break;
+    case ID_TXT:
+      write_text(wd, (Text *)id);
+      break;
+    case ID_SPK:
+      write_speaker(wd, (Speaker *)id);
+      break;
+    case ID_LP:
+      write_probe(wd, (LightProbe *)id);
+      break;
+    case ID_SO:
+      write_sound(wd, (bSound *)id);
+      break;
+    case ID_GR:
+      write_collection(wd, (Collection *)id);
+      break;
+    case ID_AR:
+      write_armature(wd, (bArmature *)id);
+      break;
+    case ID_AC:
+      write_action(wd, (bAction *)id);
+      break;
+    case ID_OB:
+      write_object(wd, (Object *)id);
+      break;
+    case ID_MA:
+      write_material(wd, (Material *)id);
+      break;
+    case ID_TE:
+      write_texture(wd, (Tex *)id);
+      break;
+    case ID_ME:
+      write_mesh(wd, (Mesh *)id);
+      break;
+    case ID_PA:
+      write_particlesettings(wd, (ParticleSettings *)id);
+      break;
+    case ID_NT:
+      write_nodetree(wd, (bNodeTree *)id);
+      break;
+    case ID_BR:
+      write_brush(wd, (Brush *)id);
+      break;
+    case ID_PAL:
+      write_palette(wd, (Palette *)id);
+      break;
+    case ID_PC:
+      write_paintcurve(wd, (PaintCurve *)id);
+      break;
+    case ID_GD:
+      write_gpencil(wd, (bGPdata *)id);
+      break;
+    case ID_LS:
+      write_linestyle(wd, (FreestyleLineStyle *)id);
+      break;
+    case ID_CF:
+      write_cachefile(wd, (CacheFile *)id);
+      break;
+    case ID_LI:
+      /* Do nothing, handled below - and should never be reached. */
+      BLI_assert(0);
+      break;
+    case ID_IP:
+      /* Do nothing, deprecated. */
+      break;
+    default:
+      /* Should never be reached. */
+      BLI_assert(0);
+      break;
+  }
+}
+
+/* Number of IDs written at once by each thread, see #write_ids_parallel. */
+#define WRITE_IDS_PARALLEL_BATCH_PER_THREAD 2
+
+/**
+ * ID types which are written without accessing data of other IDs or global state,
+ * and which can hold large data (geometry, packed files, ...) worth writing in parallel.
+ */
+static bool write_id_supports_threads(const ID *id)
+{
+  return ELEM(GS(id->name), ID_ME, ID_IM, ID_KE, ID_CU, ID_LT, ID_MB, ID_VF, ID_SO);
+}
+
+typedef struct WriteIDsParallelData {
+  const WriteData *wd;
+  ID **ids;
+  BLI_Buffer *records;
+} WriteIDsParallelData;
+
+static void write_ids_parallel_cb(void *__restrict userdata,
+                                  const int index,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  WriteIDsParallelData *data = userdata;
+  WriteData wd_record = {
+      .sdna = data->wd->sdna,
+      .use_memfile = data->wd->use_memfile,
+      .record = &data->records[index],
+  };
+
+  write_id(&wd_record, data->ids[index]);
+}
+
+/**
+ * Write consecutive IDs starting at \a id, serializing them into separate buffers using
+ * multiple threads. The buffers are written in the same order as when writing serially,
+ * so the output is identical.
+ *
+ * \param use_override: Stop at IDs which need library override operations to be stored,
+ * those have to be written serially.
+ * \return The last written ID.
+ */
+static ID *write_ids_parallel(WriteData *wd,
+                              ID *id,
+                              const int num_threads,
+                              const bool use_override)
+{
+  const int ids_len_max = num_threads * WRITE_IDS_PARALLEL_BATCH_PER_THREAD;
+  ID **ids = BLI_array_alloca(ids, ids_len_max);
+  int ids_len = 0;
+
+  for (; id && ids_len < ids_len_max; id = id->next) {
+    if (use_override && id->override_library) {
+      break;
+    }
+    ids[ids_len++] = id;
+  }
+
+  WriteIDsParallelData data = {
+      .wd = wd,
+      .ids = ids,
+      .records = MEM_callocN(sizeof(*data.records) * (size_t)ids_len, __func__),
+  };
+  for (int i = 0; i < ids_len; i++) {
+    BLI_buffer_field_init(&data.records[i], uchar);
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, ids_len, &data, write_ids_parallel_cb, &settings);
+
+  for (int i = 0; i < ids_len; i++) {
+    mywrite_id_begin(wd, ids[i]);
+    mywrite_replay(wd, &data.records[i]);
+    mywrite_id_end(wd);
+    BLI_buffer_field_free(&data.records[i]);
+  }
+  MEM_freeN(data.records);
+
+  return ids[ids_len - 1];
+}
+
 /* if MemFile * there's filesave to memory */
 static bool write_file_handle(Main *mainvar,
                               WriteWrap *ww,
@@ -3784,6 +4089,10 @@ static bool write_file_handle(Main *mainvar,
   OverrideLibraryStorage *override_storage =
       wd->use_memfile ? NULL : BKE_override_library_operations_store_initialize();
 
+  /* Serialize IDs holding large data using multiple threads. */
+  const int num_threads = BLI_task_scheduler_num_threads(BLI_task_scheduler_get());
+  const bool use_threads = num_threads > 1;
+
   /* This outer loop allows to save first data-blocks from real mainvar,
    * then the temp ones from override process,
    * if needed, without duplicating whole code. */
@@ -3798,133 +4107,23 @@ static bool write_file_handle(Main *mainvar,
         continue; /* Libraries are handled separately below. */
       }
 
+      const bool use_override = !ELEM(override_storage, NULL, bmain);
+
       for (; id; id = id->next) {
-        /* We should never attempt to write non-regular IDs
-         * (i.e. all kind of temp/runtime ones). */
-        BLI_assert(
-            (id->tag & (LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT | LIB_TAG_NOT_ALLOCATED)) == 0);
+        const bool do_override = use_override && id->override_library;
 
-        const bool do_override = !ELEM(override_storage, NULL, bmain) && id->override_library;
+        if (use_threads && !do_override && id->next && write_id_supports_threads(id)) {
+          id = write_ids_parallel(wd, id, num_threads, use_override);
+          continue;
+        }
 
         if (do_override) {
           BKE_override_library_operations_store_start(bmain, override_storage, id);
         }
 
-        switch ((ID_Type)GS(id->name)) {
-          case ID_WM:
-            write_windowmanager(wd, (wmWindowManager *)id);
-            break;
-          case ID_WS:
-            write_workspace(wd, (WorkSpace *)id);
-            break;
-          case ID_SCR:
-            write_screen(wd, (bScreen *)id);
-            break;
-          case ID_MC:
-            write_movieclip(wd, (MovieClip *)id);
-            break;
-          case ID_MSK:
-            write_mask(wd, (Mask *)id);
-            break;
-          case ID_SCE:
-            write_scene(wd, (Scene *)id);
-            break;
-          case ID_CU:
-            write_curve(wd, (Curve *)id);
-            break;
-          case ID_MB:
-            write_mball(wd, (MetaBall *)id);
-            break;
-          case ID_IM:
-            write_image(wd, (Image *)id);
-            break;
-          case ID_CA:
-            write_camera(wd, (Camera *)id);
-            break;
-          case ID_LA:
-            write_light(wd, (Light *)id);
-            break;
-          case ID_LT:
-            write_lattice(wd, (Lattice *)id);
-            break;
-          case ID_VF:
-            write_vfont(wd, (VFont *)id);
-            break;
-          case ID_KE:
-            write_key(wd, (Key *)id);
-            break;
-          case ID_WO:
-            write_world(wd, (World *)id);
-            break;
-          case ID_TXT:
-            write_text(wd, (Text *)id);
-            break;
-          case ID_SPK:
-            write_speaker(wd, (Speaker *)id);
-            break;
-          case ID_LP:
-            write_probe(wd, (LightProbe *)id);
-            break;
-          case ID_SO:
-            write_sound(wd, (bSound *)id);
-            break;
-          case ID_GR:
-            write_collection(wd, (Collection *)id);
-            break;
-          case ID_AR:
-            write_armature(wd, (bArmature *)id);
-            break;
-          case ID_AC:
-            write_action(wd, (bAction *)id);
-            break;
-          case ID_OB:
-            write_object(wd, (Object *)id);
-            break;
-          case ID_MA:
-            write_material(wd, (Material *)id);
-            break;
-          case ID_TE:
-            write_texture(wd, (Tex *)id);
-            break;
-          case ID_ME:
-            write_mesh(wd, (Mesh *)id);
-            break;
-          case ID_PA:
-            write_particlesettings(wd, (ParticleSettings *)id);
-            break;
-          case ID_NT:
-            write_nodetree(wd, (bNodeTree *)id);
-            break;
-          case ID_BR:
-            write_brush(wd, (Brush *)id);
-            break;
-          case ID_PAL:
-            write_palette(wd, (Palette *)id);
-            break;
-          case ID_PC:
-            write_paintcurve(wd, (PaintCurve *)id);
-            break;
-          case ID_GD:
-            write_gpencil(wd, (bGPdata *)id);
-            break;
-          case ID_LS:
-            write_linestyle(wd, (FreestyleLineStyle *)id);
-            break;
-          case ID_CF:
-            write_cachefile(wd, (CacheFile *)id);
-            break;
-          case ID_LI:
-            /* Do nothing, handled below - and should never be reached. */
-            BLI_assert(0);
-            break;
-          case ID_IP:
-            /* Do nothing, deprecated. */
-            break;
-          default:
-            /* Should never be reached. */
-            BLI_assert(0);
-            break;
-        }
+        mywrite_id_begin(wd, id);
+        write_id(wd, id);
+        mywrite_id_end(wd);
 
         if (do_override) {
           BKE_override_library_operations_store_end(override_storage, id);
@@ -4091,9 +4290,12 @@ bool BLO_write_file(Main *mainvar,
   }
 
   /* actual file writing */
-  const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
+  bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
 
-  ww.close(&ww);
+  /* Compressed output may still be buffered, closing can fail too. */
+  if (ww.close(&ww) == false) {
+    err = true;
+  }
 
   if (UNLIKELY(path_list_backup)) {
     BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
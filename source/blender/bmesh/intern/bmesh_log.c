@@ -32,6 +32,7 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_utildefines.h"
+#include "BLI_flathash.h"
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
@@ -90,8 +91,8 @@ struct BMLog {
    * The ID is needed because element pointers will change as they
    * are created and deleted.
    */
-  GHash *id_to_elem;
-  GHash *elem_to_id;
+  FlatHash *id_to_elem;
+  FlatHash *elem_to_id;
 
   /* All BMLogEntrys, ordered from earliest to most recent */
   ListBase entries;
@@ -128,8 +129,8 @@ typedef struct {
 /* Get the vertex's unique ID from the log */
 static uint bm_log_vert_id_get(BMLog *log, BMVert *v)
 {
-  BLI_assert(BLI_ghash_haskey(log->elem_to_id, v));
-  return POINTER_AS_UINT(BLI_ghash_lookup(log->elem_to_id, v));
+  BLI_assert(BLI_flathash_haskey(log->elem_to_id, v));
+  return POINTER_AS_UINT(BLI_flathash_lookup(log->elem_to_id, v));
 }
 
 /* Set the vertex's unique ID in the log */
@@ -137,23 +138,23 @@ static void bm_log_vert_id_set(BMLog *log, BMVert *v, uint id)
 {
   void *vid = POINTER_FROM_UINT(id);
 
-  BLI_ghash_reinsert(log->id_to_elem, vid, v, NULL, NULL);
-  BLI_ghash_reinsert(log->elem_to_id, v, vid, NULL, NULL);
+  BLI_flathash_reinsert(log->id_to_elem, vid, v, NULL, NULL);
+  BLI_flathash_reinsert(log->elem_to_id, v, vid, NULL, NULL);
 }
 
 /* Get a vertex from its unique ID */
 static BMVert *bm_log_vert_from_id(BMLog *log, uint id)
 {
   void *key = POINTER_FROM_UINT(id);
-  BLI_assert(BLI_ghash_haskey(log->id_to_elem, key));
-  return BLI_ghash_lookup(log->id_to_elem, key);
+  BLI_assert(BLI_flathash_haskey(log->id_to_elem, key));
+  return BLI_flathash_lookup(log->id_to_elem, key);
 }
 
 /* Get the face's unique ID from the log */
 static uint bm_log_face_id_get(BMLog *log, BMFace *f)
 {
-  BLI_assert(BLI_ghash_haskey(log->elem_to_id, f));
-  return POINTER_AS_UINT(BLI_ghash_lookup(log->elem_to_id, f));
+  BLI_assert(BLI_flathash_haskey(log->elem_to_id, f));
+  return POINTER_AS_UINT(BLI_flathash_lookup(log->elem_to_id, f));
 }
 
 /* Set the face's unique ID in the log */
@@ -161,16 +162,16 @@ static void bm_log_face_id_set(BMLog *log, BMFace *f, uint id)
 {
   void *fid = POINTER_FROM_UINT(id);
 
-  BLI_ghash_reinsert(log->id_to_elem, fid, f, NULL, NULL);
-  BLI_ghash_reinsert(log->elem_to_id, f, fid, NULL, NULL);
+  BLI_flathash_reinsert(log->id_to_elem, fid, f, NULL, NULL);
+  BLI_flathash_reinsert(log->elem_to_id, f, fid, NULL, NULL);
 }
 
 /* Get a face from its unique ID */
 static BMFace *bm_log_face_from_id(BMLog *log, uint id)
 {
   void *key = POINTER_FROM_UINT(id);
-  BLI_assert(BLI_ghash_haskey(log->id_to_elem, key));
-  return BLI_ghash_lookup(log->id_to_elem, key);
+  BLI_assert(BLI_flathash_haskey(log->id_to_elem, key));
+  return BLI_flathash_lookup(log->id_to_elem, key);
 }
 
 /************************ BMLogVert / BMLogFace ***********************/
@@ -477,8 +478,8 @@ BMLog *BM_log_create(BMesh *bm)
   const uint reserve_num = (uint)(bm->totvert + bm->totface);
 
   log->unused_ids = range_tree_uint_alloc(0, (unsigned)-1);
-  log->id_to_elem = BLI_ghash_new_ex(logkey_hash, logkey_cmp, __func__, reserve_num);
-  log->elem_to_id = BLI_ghash_ptr_new_ex(__func__, reserve_num);
+  log->id_to_elem = BLI_flathash_new_ex(logkey_hash, logkey_cmp, __func__, reserve_num);
+  log->elem_to_id = BLI_flathash_ptr_new_ex(__func__, reserve_num);
 
   /* Assign IDs to all existing vertices and faces */
   bm_log_assign_ids(bm, log);
@@ -567,11 +568,11 @@ void BM_log_free(BMLog *log)
   }
 
   if (log->id_to_elem) {
-    BLI_ghash_free(log->id_to_elem, NULL, NULL);
+    BLI_flathash_free(log->id_to_elem, NULL, NULL);
   }
 
   if (log->elem_to_id) {
-    BLI_ghash_free(log->elem_to_id, NULL, NULL);
+    BLI_flathash_free(log->elem_to_id, NULL, NULL);
   }
 
   /* Clear the BMLog references within each entry, but do not free
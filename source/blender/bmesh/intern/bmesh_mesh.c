@@ -1711,88 +1711,107 @@ void bmesh_edit_end(BMesh *bm, BMOpTypeFlag type_flag)
   }
 }
 
-void BM_mesh_elem_index_ensure_ex(BMesh *bm, const char htype, int elem_offset[4])
+typedef struct BMElemIndexEnsureData {
+  BMesh *bm;
+  /* The element types to update, #BM_FACE and #BM_LOOP are updated together. */
+  bool update_vert, update_edge, update_face, update_loop;
+  const int *elem_offset;
+} BMElemIndexEnsureData;
+
+/* Each element type is independent, update them in parallel. */
+static void bm_mesh_elem_index_ensure_cb(void *__restrict userdata,
+                                         const int iter,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
 {
+  BMElemIndexEnsureData *data = userdata;
+  BMesh *bm = data->bm;
+  const int *elem_offset = data->elem_offset;
+  BMIter iter_mesh;
+  BMElem *ele;
 
-#ifdef DEBUG
-  BM_ELEM_INDEX_VALIDATE(bm, "Should Never Fail!", __func__);
-#endif
-
-  if (elem_offset == NULL) {
-    /* Simple case. */
-    const char htype_needed = bm->elem_index_dirty & htype;
-    if (htype_needed == 0) {
-      goto finally;
+  if (iter == 0 && data->update_vert) {
+    int index = elem_offset ? elem_offset[0] : 0;
+    BM_ITER_MESH (ele, &iter_mesh, bm, BM_VERTS_OF_MESH) {
+      BM_elem_index_set(ele, index++); /* set_ok */
+    }
+    BLI_assert(elem_offset || index == bm->totvert);
+  }
+  else if (iter == 1 && data->update_edge) {
+    int index = elem_offset ? elem_offset[1] : 0;
+    BM_ITER_MESH (ele, &iter_mesh, bm, BM_EDGES_OF_MESH) {
+      BM_elem_index_set(ele, index++); /* set_ok */
     }
+    BLI_assert(elem_offset || index == bm->totedge);
   }
+  else if (iter == 2 && (data->update_face || data->update_loop)) {
+    const bool update_face = data->update_face;
+    const bool update_loop = data->update_loop;
 
-  if (htype & BM_VERT) {
-    if ((bm->elem_index_dirty & BM_VERT) || (elem_offset && elem_offset[0])) {
-      BMIter iter;
-      BMElem *ele;
+    int index_loop = elem_offset ? elem_offset[2] : 0;
+    int index = elem_offset ? elem_offset[3] : 0;
 
-      int index = elem_offset ? elem_offset[0] : 0;
-      BM_ITER_MESH (ele, &iter, bm, BM_VERTS_OF_MESH) {
+    BM_ITER_MESH (ele, &iter_mesh, bm, BM_FACES_OF_MESH) {
+      if (update_face) {
         BM_elem_index_set(ele, index++); /* set_ok */
       }
-      BLI_assert(elem_offset || index == bm->totvert);
-    }
-    else {
-      // printf("%s: skipping vert index calc!\n", __func__);
-    }
-  }
 
-  if (htype & BM_EDGE) {
-    if ((bm->elem_index_dirty & BM_EDGE) || (elem_offset && elem_offset[1])) {
-      BMIter iter;
-      BMElem *ele;
+      if (update_loop) {
+        BMLoop *l_iter, *l_first;
 
-      int index = elem_offset ? elem_offset[1] : 0;
-      BM_ITER_MESH (ele, &iter, bm, BM_EDGES_OF_MESH) {
-        BM_elem_index_set(ele, index++); /* set_ok */
+        l_iter = l_first = BM_FACE_FIRST_LOOP((BMFace *)ele);
+        do {
+          BM_elem_index_set(l_iter, index_loop++); /* set_ok */
+        } while ((l_iter = l_iter->next) != l_first);
       }
-      BLI_assert(elem_offset || index == bm->totedge);
     }
-    else {
-      // printf("%s: skipping edge index calc!\n", __func__);
+
+    BLI_assert(elem_offset || !update_face || index == bm->totface);
+    if (update_loop) {
+      BLI_assert(elem_offset || !update_loop || index_loop == bm->totloop);
     }
   }
+}
 
-  if (htype & (BM_FACE | BM_LOOP)) {
-    if ((bm->elem_index_dirty & (BM_FACE | BM_LOOP)) ||
-        (elem_offset && (elem_offset[2] || elem_offset[3]))) {
-      BMIter iter;
-      BMElem *ele;
-
-      const bool update_face = (htype & BM_FACE) && (bm->elem_index_dirty & BM_FACE);
-      const bool update_loop = (htype & BM_LOOP) && (bm->elem_index_dirty & BM_LOOP);
-
-      int index_loop = elem_offset ? elem_offset[2] : 0;
-      int index = elem_offset ? elem_offset[3] : 0;
+void BM_mesh_elem_index_ensure_ex(BMesh *bm, const char htype, int elem_offset[4])
+{
 
-      BM_ITER_MESH (ele, &iter, bm, BM_FACES_OF_MESH) {
-        if (update_face) {
-          BM_elem_index_set(ele, index++); /* set_ok */
-        }
+#ifdef DEBUG
+  BM_ELEM_INDEX_VALIDATE(bm, "Should Never Fail!", __func__);
+#endif
 
-        if (update_loop) {
-          BMLoop *l_iter, *l_first;
+  if (elem_offset == NULL) {
+    /* Simple case. */
+    const char htype_needed = bm->elem_index_dirty & htype;
+    if (htype_needed == 0) {
+      goto finally;
+    }
+  }
 
-          l_iter = l_first = BM_FACE_FIRST_LOOP((BMFace *)ele);
-          do {
-            BM_elem_index_set(l_iter, index_loop++); /* set_ok */
-          } while ((l_iter = l_iter->next) != l_first);
-        }
-      }
+  {
+    BMElemIndexEnsureData data = {
+        .bm = bm,
+        .elem_offset = elem_offset,
+    };
 
-      BLI_assert(elem_offset || !update_face || index == bm->totface);
-      if (update_loop) {
-        BLI_assert(elem_offset || !update_loop || index_loop == bm->totloop);
-      }
+    if (htype & BM_VERT) {
+      data.update_vert = (bm->elem_index_dirty & BM_VERT) || (elem_offset && elem_offset[0]);
     }
-    else {
-      // printf("%s: skipping face/loop index calc!\n", __func__);
+    if (htype & BM_EDGE) {
+      data.update_edge = (bm->elem_index_dirty & BM_EDGE) || (elem_offset && elem_offset[1]);
     }
+    if (htype & (BM_FACE | BM_LOOP)) {
+      if ((bm->elem_index_dirty & (BM_FACE | BM_LOOP)) ||
+          (elem_offset && (elem_offset[2] || elem_offset[3]))) {
+        data.update_face = (htype & BM_FACE) && (bm->elem_index_dirty & BM_FACE);
+        data.update_loop = (htype & BM_LOOP) && (bm->elem_index_dirty & BM_LOOP);
+      }
+    }
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (bm->totvert + bm->totedge + bm->totface) >= BM_OMP_LIMIT;
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(0, 3, &data, bm_mesh_elem_index_ensure_cb, &settings);
   }
 
 finally:
@@ -1949,6 +1968,29 @@ bool BM_mesh_elem_table_check(BMesh *bm)
 }
 #endif
 
+typedef struct BMElemTableEnsureData {
+  BMesh *bm;
+  char htype_needed;
+} BMElemTableEnsureData;
+
+static void bm_mesh_elem_table_ensure_cb(void *__restrict userdata,
+                                         const int iter,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BMElemTableEnsureData *data = userdata;
+  BMesh *bm = data->bm;
+
+  if (iter == 0 && (data->htype_needed & BM_VERT)) {
+    BM_iter_as_array(bm, BM_VERTS_OF_MESH, NULL, (void **)bm->vtable, bm->totvert);
+  }
+  else if (iter == 1 && (data->htype_needed & BM_EDGE)) {
+    BM_iter_as_array(bm, BM_EDGES_OF_MESH, NULL, (void **)bm->etable, bm->totedge);
+  }
+  else if (iter == 2 && (data->htype_needed & BM_FACE)) {
+    BM_iter_as_array(bm, BM_FACES_OF_MESH, NULL, (void **)bm->ftable, bm->totface);
+  }
+}
+
 void BM_mesh_elem_table_ensure(BMesh *bm, const char htype)
 {
   /* assume if the array is non-null then its valid and no need to recalc */
@@ -2004,16 +2046,13 @@ void BM_mesh_elem_table_ensure(BMesh *bm, const char htype)
     }
   }
 
-  if (htype_needed & BM_VERT) {
-    BM_iter_as_array(bm, BM_VERTS_OF_MESH, NULL, (void **)bm->vtable, bm->totvert);
-  }
-
-  if (htype_needed & BM_EDGE) {
-    BM_iter_as_array(bm, BM_EDGES_OF_MESH, NULL, (void **)bm->etable, bm->totedge);
-  }
-
-  if (htype_needed & BM_FACE) {
-    BM_iter_as_array(bm, BM_FACES_OF_MESH, NULL, (void **)bm->ftable, bm->totface);
+  {
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (bm->totvert + bm->totedge + bm->totface) >= BM_OMP_LIMIT;
+    settings.min_iter_per_thread = 1;
+    BMElemTableEnsureData data = {bm, htype_needed};
+    BLI_task_parallel_range(0, 3, &data, bm_mesh_elem_table_ensure_cb, &settings);
   }
 
 finally:
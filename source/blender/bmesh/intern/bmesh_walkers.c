@@ -24,6 +24,7 @@
 #include <string.h> /* for memcpy */
 
 #include "BLI_utildefines.h"
+#include "BLI_flathash.h"
 #include "BLI_listbase.h"
 
 #include "bmesh.h"
@@ -42,12 +43,11 @@
  * basic design pattern: the walker step function goes through it's
  * list of possible choices for recursion, and recurses (by pushing a new state)
  * using the first non-visited one.  This choice is the flagged as visited using
- * the ghash.  each step may push multiple new states onto the worklist at once.
+ * the visit set.  each step may push multiple new states onto the worklist at once.
  *
  * - Walkers use tool flags, not header flags.
- * - Walkers now use ghash for storing visited elements,
- *   rather then stealing flags.  ghash can be rewritten
- *   to be faster if necessary, in the far future :) .
+ * - Walkers now use a flat hash set for storing visited elements,
+ *   rather then stealing flags.
  * - tools should ALWAYS have necessary error handling
  *   for if walkers fail.
  */
@@ -86,8 +86,8 @@ void BMW_init(BMWalker *walker,
   walker->mask_edge = mask_edge;
   walker->mask_face = mask_face;
 
-  walker->visit_set = BLI_gset_ptr_new("bmesh walkers");
-  walker->visit_set_alt = BLI_gset_ptr_new("bmesh walkers sec");
+  walker->visit_set = BLI_flatset_ptr_new("bmesh walkers");
+  walker->visit_set_alt = BLI_flatset_ptr_new("bmesh walkers sec");
 
   if (UNLIKELY(type >= BMW_MAXWALKERS || type < 0)) {
     fprintf(stderr,
@@ -133,8 +133,8 @@ void BMW_init(BMWalker *walker,
 void BMW_end(BMWalker *walker)
 {
   BLI_mempool_destroy(walker->worklist);
-  BLI_gset_free(walker->visit_set, NULL);
-  BLI_gset_free(walker->visit_set_alt, NULL);
+  BLI_flatset_free(walker->visit_set, NULL);
+  BLI_flatset_free(walker->visit_set_alt, NULL);
 }
 
 /**
@@ -258,6 +258,6 @@ void BMW_reset(BMWalker *walker)
     BMW_state_remove(walker);
   }
   walker->depth = 0;
-  BLI_gset_clear(walker->visit_set, NULL);
-  BLI_gset_clear(walker->visit_set_alt, NULL);
+  BLI_flatset_clear(walker->visit_set, NULL);
+  BLI_flatset_clear(walker->visit_set_alt, NULL);
 }
@@ -60,8 +60,8 @@ typedef struct BMWalker {
 
   BMWFlag flag;
 
-  struct GSet *visit_set;
-  struct GSet *visit_set_alt;
+  struct FlatSet *visit_set;
+  struct FlatSet *visit_set_alt;
   int depth;
 } BMWalker;
 
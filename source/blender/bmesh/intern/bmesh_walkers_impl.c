@@ -23,6 +23,7 @@
 #include <string.h>
 
 #include "BLI_utildefines.h"
+#include "BLI_flathash.h"
 
 #include "BKE_customdata.h"
 
@@ -119,7 +120,7 @@ static void bmw_VertShellWalker_visitEdge(BMWalker *walker, BMEdge *e)
 {
   BMwShellWalker *shellWalk = NULL;
 
-  if (BLI_gset_haskey(walker->visit_set, e)) {
+  if (BLI_flatset_haskey(walker->visit_set, e)) {
     return;
   }
 
@@ -129,7 +130,7 @@ static void bmw_VertShellWalker_visitEdge(BMWalker *walker, BMEdge *e)
 
   shellWalk = BMW_state_add(walker);
   shellWalk->curedge = e;
-  BLI_gset_insert(walker->visit_set, e);
+  BLI_flatset_insert(walker->visit_set, e);
 }
 
 static void bmw_VertShellWalker_begin(BMWalker *walker, void *data)
@@ -203,8 +204,8 @@ static void *bmw_VertShellWalker_step(BMWalker *walker)
   bool restrictpass = true;
   BMwShellWalker shellWalk = *((BMwShellWalker *)BMW_current_state(walker));
 
-  if (!BLI_gset_haskey(walker->visit_set, shellWalk.base)) {
-    BLI_gset_insert(walker->visit_set, shellWalk.base);
+  if (!BLI_flatset_haskey(walker->visit_set, shellWalk.base)) {
+    BLI_flatset_insert(walker->visit_set, shellWalk.base);
   }
 
   BMW_state_remove(walker);
@@ -212,7 +213,7 @@ static void *bmw_VertShellWalker_step(BMWalker *walker)
   /* find the next edge whose other vertex has not been visite */
   curedge = shellWalk.curedge;
   do {
-    if (!BLI_gset_haskey(walker->visit_set, curedge)) {
+    if (!BLI_flatset_haskey(walker->visit_set, curedge)) {
       if (!walker->restrictflag ||
           (walker->restrictflag &&
            BMO_edge_flag_test(walker->bm, curedge, walker->restrictflag))) {
@@ -222,7 +223,7 @@ static void *bmw_VertShellWalker_step(BMWalker *walker)
 
         /* push a new state onto the stac */
         newState = BMW_state_add(walker);
-        BLI_gset_insert(walker->visit_set, curedge);
+        BLI_flatset_insert(walker->visit_set, curedge);
 
         /* populate the new stat */
 
@@ -250,7 +251,7 @@ static void bmw_LoopShellWalker_visitLoop(BMWalker *walker, BMLoop *l)
 {
   BMwLoopShellWalker *shellWalk = NULL;
 
-  if (BLI_gset_haskey(walker->visit_set, l)) {
+  if (BLI_flatset_haskey(walker->visit_set, l)) {
     return;
   }
 
@@ -260,7 +261,7 @@ static void bmw_LoopShellWalker_visitLoop(BMWalker *walker, BMLoop *l)
 
   shellWalk = BMW_state_add(walker);
   shellWalk->curloop = l;
-  BLI_gset_insert(walker->visit_set, l);
+  BLI_flatset_insert(walker->visit_set, l);
 }
 
 static void bmw_LoopShellWalker_begin(BMWalker *walker, void *data)
@@ -381,7 +382,7 @@ static void bmw_LoopShellWalker_visitEdgeWire(BMWalker *walker, BMEdge *e)
 
   BLI_assert(bmw_edge_is_wire(walker, e));
 
-  if (BLI_gset_haskey(walker->visit_set_alt, e)) {
+  if (BLI_flatset_haskey(walker->visit_set_alt, e)) {
     return;
   }
 
@@ -391,7 +392,7 @@ static void bmw_LoopShellWalker_visitEdgeWire(BMWalker *walker, BMEdge *e)
 
   shellWalk = BMW_state_add(walker);
   shellWalk->curelem = (BMElem *)e;
-  BLI_gset_insert(walker->visit_set_alt, e);
+  BLI_flatset_insert(walker->visit_set_alt, e);
 }
 
 static void bmw_LoopShellWireWalker_visitVert(BMWalker *walker, BMVert *v, const BMEdge *e_from)
@@ -400,7 +401,7 @@ static void bmw_LoopShellWireWalker_visitVert(BMWalker *walker, BMVert *v, const
 
   BLI_assert(v->head.htype == BM_VERT);
 
-  if (BLI_gset_haskey(walker->visit_set_alt, v)) {
+  if (BLI_flatset_haskey(walker->visit_set_alt, v)) {
     return;
   }
 
@@ -426,7 +427,7 @@ static void bmw_LoopShellWireWalker_visitVert(BMWalker *walker, BMVert *v, const
     }
   } while ((e = BM_DISK_EDGE_NEXT(e, v)) != v->e);
 
-  BLI_gset_insert(walker->visit_set_alt, v);
+  BLI_flatset_insert(walker->visit_set_alt, v);
 }
 
 static void bmw_LoopShellWireWalker_begin(BMWalker *walker, void *data)
@@ -525,7 +526,7 @@ static void bmw_FaceShellWalker_visitEdge(BMWalker *walker, BMEdge *e)
 {
   BMwShellWalker *shellWalk = NULL;
 
-  if (BLI_gset_haskey(walker->visit_set, e)) {
+  if (BLI_flatset_haskey(walker->visit_set, e)) {
     return;
   }
 
@@ -535,7 +536,7 @@ static void bmw_FaceShellWalker_visitEdge(BMWalker *walker, BMEdge *e)
 
   shellWalk = BMW_state_add(walker);
   shellWalk->curedge = e;
-  BLI_gset_insert(walker->visit_set, e);
+  BLI_flatset_insert(walker->visit_set, e);
 }
 
 static void bmw_FaceShellWalker_begin(BMWalker *walker, void *data)
@@ -589,7 +590,7 @@ static void bmw_ConnectedVertexWalker_visitVertex(BMWalker *walker, BMVert *v)
 {
   BMwConnectedVertexWalker *vwalk;
 
-  if (BLI_gset_haskey(walker->visit_set, v)) {
+  if (BLI_flatset_haskey(walker->visit_set, v)) {
     /* already visited */
     return;
   }
@@ -601,7 +602,7 @@ static void bmw_ConnectedVertexWalker_visitVertex(BMWalker *walker, BMVert *v)
 
   vwalk = BMW_state_add(walker);
   vwalk->curvert = v;
-  BLI_gset_insert(walker->visit_set, v);
+  BLI_flatset_insert(walker->visit_set, v);
 }
 
 static void bmw_ConnectedVertexWalker_begin(BMWalker *walker, void *data)
@@ -630,7 +631,7 @@ static void *bmw_ConnectedVertexWalker_step(BMWalker *walker)
 
   BM_ITER_ELEM (e, &iter, v, BM_EDGES_OF_VERT) {
     v2 = BM_edge_other_vert(e, v);
-    if (!BLI_gset_haskey(walker->visit_set, v2)) {
+    if (!BLI_flatset_haskey(walker->visit_set, v2)) {
       bmw_ConnectedVertexWalker_visitVertex(walker, v2);
     }
   }
@@ -662,7 +663,7 @@ static void bmw_IslandboundWalker_begin(BMWalker *walker, void *data)
   iwalk->base = iwalk->curloop = l;
   iwalk->lastv = l->v;
 
-  BLI_gset_insert(walker->visit_set, data);
+  BLI_flatset_insert(walker->visit_set, data);
 }
 
 static void *bmw_IslandboundWalker_yield(BMWalker *walker)
@@ -718,11 +719,11 @@ static void *bmw_IslandboundWalker_step(BMWalker *walker)
   if (l == owalk.curloop) {
     return NULL;
   }
-  else if (BLI_gset_haskey(walker->visit_set, l)) {
+  else if (BLI_flatset_haskey(walker->visit_set, l)) {
     return owalk.curloop;
   }
 
-  BLI_gset_insert(walker->visit_set, l);
+  BLI_flatset_insert(walker->visit_set, l);
   iwalk = BMW_state_add(walker);
   iwalk->base = owalk.base;
 
@@ -750,7 +751,7 @@ static void bmw_IslandWalker_begin(BMWalker *walker, void *data)
   }
 
   iwalk = BMW_state_add(walker);
-  BLI_gset_insert(walker->visit_set, data);
+  BLI_flatset_insert(walker->visit_set, data);
 
   iwalk->cur = data;
 }
@@ -805,18 +806,18 @@ static void *bmw_IslandWalker_step_ex(BMWalker *walker, bool only_manifold)
         continue;
       }
 
-      /* saves checking BLI_gset_haskey below (manifold edges there's a 50% chance) */
+      /* saves checking BLI_flatset_haskey below (manifold edges there's a 50% chance) */
       if (f == iwalk->cur) {
         continue;
       }
 
-      if (BLI_gset_haskey(walker->visit_set, f)) {
+      if (BLI_flatset_haskey(walker->visit_set, f)) {
         continue;
       }
 
       iwalk = BMW_state_add(walker);
       iwalk->cur = f;
-      BLI_gset_insert(walker->visit_set, f);
+      BLI_flatset_insert(walker->visit_set, f);
       break;
     }
   } while ((l_iter = l_iter->next) != l_first);
@@ -865,7 +866,7 @@ static void bmw_EdgeLoopWalker_begin(BMWalker *walker, void *data)
   v = e->v1;
 
   lwalk = BMW_state_add(walker);
-  BLI_gset_insert(walker->visit_set, e);
+  BLI_flatset_insert(walker->visit_set, e);
 
   lwalk->cur = lwalk->start = e;
   lwalk->lastv = lwalk->startv = v;
@@ -909,8 +910,8 @@ static void bmw_EdgeLoopWalker_begin(BMWalker *walker, void *data)
 
   lwalk->lastv = lwalk->startv = BM_edge_other_vert(owalk.cur, lwalk->lastv);
 
-  BLI_gset_clear(walker->visit_set, NULL);
-  BLI_gset_insert(walker->visit_set, owalk.cur);
+  BLI_flatset_clear(walker->visit_set, NULL);
+  BLI_flatset_insert(walker->visit_set, owalk.cur);
 }
 
 static void *bmw_EdgeLoopWalker_yield(BMWalker *walker)
@@ -944,7 +945,7 @@ static void *bmw_EdgeLoopWalker_step(BMWalker *walker)
       l = BM_face_other_vert_loop(owalk.f_hub, lwalk->lastv, v);
       nexte = BM_edge_exists(v, l->v);
 
-      if (bmw_mask_check_edge(walker, nexte) && !BLI_gset_haskey(walker->visit_set, nexte) &&
+      if (bmw_mask_check_edge(walker, nexte) && !BLI_flatset_haskey(walker->visit_set, nexte) &&
           /* never step onto a boundary edge, this gives odd-results */
           (BM_edge_is_boundary(nexte) == false)) {
         lwalk = BMW_state_add(walker);
@@ -955,7 +956,7 @@ static void *bmw_EdgeLoopWalker_step(BMWalker *walker)
         lwalk->is_single = owalk.is_single;
         lwalk->f_hub = owalk.f_hub;
 
-        BLI_gset_insert(walker->visit_set, nexte);
+        BLI_flatset_insert(walker->visit_set, nexte);
       }
     }
   }
@@ -968,7 +969,7 @@ static void *bmw_EdgeLoopWalker_step(BMWalker *walker)
 
       BM_ITER_ELEM (nexte, &eiter, v, BM_EDGES_OF_VERT) {
         if ((nexte->l == NULL) && bmw_mask_check_edge(walker, nexte) &&
-            !BLI_gset_haskey(walker->visit_set, nexte)) {
+            !BLI_flatset_haskey(walker->visit_set, nexte)) {
           lwalk = BMW_state_add(walker);
           lwalk->cur = nexte;
           lwalk->lastv = v;
@@ -977,7 +978,7 @@ static void *bmw_EdgeLoopWalker_step(BMWalker *walker)
           lwalk->is_single = owalk.is_single;
           lwalk->f_hub = owalk.f_hub;
 
-          BLI_gset_insert(walker->visit_set, nexte);
+          BLI_flatset_insert(walker->visit_set, nexte);
         }
       }
     }
@@ -1012,7 +1013,7 @@ static void *bmw_EdgeLoopWalker_step(BMWalker *walker)
 
     if (l != NULL) {
       if (l != e->l && bmw_mask_check_edge(walker, l->e) &&
-          !BLI_gset_haskey(walker->visit_set, l->e)) {
+          !BLI_flatset_haskey(walker->visit_set, l->e)) {
         lwalk = BMW_state_add(walker);
         lwalk->cur = l->e;
         lwalk->lastv = v;
@@ -1021,7 +1022,7 @@ static void *bmw_EdgeLoopWalker_step(BMWalker *walker)
         lwalk->is_single = owalk.is_single;
         lwalk->f_hub = owalk.f_hub;
 
-        BLI_gset_insert(walker->visit_set, l->e);
+        BLI_flatset_insert(walker->visit_set, l->e);
       }
     }
   }
@@ -1062,7 +1063,7 @@ static void *bmw_EdgeLoopWalker_step(BMWalker *walker)
 
     if (l != NULL) {
       if (l != e->l && bmw_mask_check_edge(walker, l->e) &&
-          !BLI_gset_haskey(walker->visit_set, l->e)) {
+          !BLI_flatset_haskey(walker->visit_set, l->e)) {
         lwalk = BMW_state_add(walker);
         lwalk->cur = l->e;
         lwalk->lastv = v;
@@ -1071,7 +1072,7 @@ static void *bmw_EdgeLoopWalker_step(BMWalker *walker)
         lwalk->is_single = owalk.is_single;
         lwalk->f_hub = owalk.f_hub;
 
-        BLI_gset_insert(walker->visit_set, l->e);
+        BLI_flatset_insert(walker->visit_set, l->e);
       }
     }
   }
@@ -1103,7 +1104,8 @@ static bool bmw_FaceLoopWalker_include_face(BMWalker *walker, BMLoop *l)
   }
 
   /* the face must not have been already visited */
-  if (BLI_gset_haskey(walker->visit_set, l->f) && BLI_gset_haskey(walker->visit_set_alt, l->e)) {
+  if (BLI_flatset_haskey(walker->visit_set, l->f) &&
+      BLI_flatset_haskey(walker->visit_set_alt, l->e)) {
     return false;
   }
 
@@ -1148,7 +1150,7 @@ static void bmw_FaceLoopWalker_begin(BMWalker *walker, void *data)
   lwalk = BMW_state_add(walker);
   lwalk->l = e->l;
   lwalk->no_calc = false;
-  BLI_gset_insert(walker->visit_set, lwalk->l->f);
+  BLI_flatset_insert(walker->visit_set, lwalk->l->f);
 
   /* rewind */
   while ((owalk_pt = BMW_current_state(walker))) {
@@ -1160,11 +1162,11 @@ static void bmw_FaceLoopWalker_begin(BMWalker *walker, void *data)
   *lwalk = owalk;
   lwalk->no_calc = false;
 
-  BLI_gset_clear(walker->visit_set_alt, NULL);
-  BLI_gset_insert(walker->visit_set_alt, lwalk->l->e);
+  BLI_flatset_clear(walker->visit_set_alt, NULL);
+  BLI_flatset_insert(walker->visit_set_alt, lwalk->l->e);
 
-  BLI_gset_clear(walker->visit_set, NULL);
-  BLI_gset_insert(walker->visit_set, lwalk->l->f);
+  BLI_flatset_clear(walker->visit_set, NULL);
+  BLI_flatset_insert(walker->visit_set, lwalk->l->f);
 }
 
 static void *bmw_FaceLoopWalker_yield(BMWalker *walker)
@@ -1216,8 +1218,8 @@ static void *bmw_FaceLoopWalker_step(BMWalker *walker)
     }
 
     /* both may already exist */
-    BLI_gset_add(walker->visit_set_alt, l->e);
-    BLI_gset_add(walker->visit_set, l->f);
+    BLI_flatset_add(walker->visit_set_alt, l->e);
+    BLI_flatset_add(walker->visit_set, l->f);
   }
 
   return f;
@@ -1250,7 +1252,7 @@ static void bmw_EdgeringWalker_begin(BMWalker *walker, void *data)
     lwalk->wireedge = NULL;
   }
 
-  BLI_gset_insert(walker->visit_set, lwalk->l->e);
+  BLI_flatset_insert(walker->visit_set, lwalk->l->e);
 
   /* rewind */
   while ((owalk_pt = BMW_current_state(walker))) {
@@ -1270,8 +1272,8 @@ static void bmw_EdgeringWalker_begin(BMWalker *walker, void *data)
     lwalk->l = lwalk->l->radial_next;
   }
 
-  BLI_gset_clear(walker->visit_set, NULL);
-  BLI_gset_insert(walker->visit_set, lwalk->l->e);
+  BLI_flatset_clear(walker->visit_set, NULL);
+  BLI_flatset_insert(walker->visit_set, lwalk->l->e);
 }
 
 static void *bmw_EdgeringWalker_yield(BMWalker *walker)
@@ -1337,7 +1339,7 @@ static void *bmw_EdgeringWalker_step(BMWalker *walker)
     }
   }
   /* only walk to manifold edge */
-  if ((l->f->len % 2 == 0) && EDGE_CHECK(l->e) && !BLI_gset_haskey(walker->visit_set, l->e))
+  if ((l->f->len % 2 == 0) && EDGE_CHECK(l->e) && !BLI_flatset_haskey(walker->visit_set, l->e))
 #else
 
   l = l->radial_next;
@@ -1347,14 +1349,14 @@ static void *bmw_EdgeringWalker_step(BMWalker *walker)
     l = owalk.l->next->next;
   }
   /* only walk to manifold edge */
-  if ((l->f->len == 4) && EDGE_CHECK(l->e) && !BLI_gset_haskey(walker->visit_set, l->e))
+  if ((l->f->len == 4) && EDGE_CHECK(l->e) && !BLI_flatset_haskey(walker->visit_set, l->e))
 #endif
   {
     lwalk = BMW_state_add(walker);
     lwalk->l = l;
     lwalk->wireedge = NULL;
 
-    BLI_gset_insert(walker->visit_set, l->e);
+    BLI_flatset_insert(walker->visit_set, l->e);
   }
 
   return e;
@@ -1374,13 +1376,13 @@ static void bmw_EdgeboundaryWalker_begin(BMWalker *walker, void *data)
 
   BLI_assert(BM_edge_is_boundary(e));
 
-  if (BLI_gset_haskey(walker->visit_set, e)) {
+  if (BLI_flatset_haskey(walker->visit_set, e)) {
     return;
   }
 
   lwalk = BMW_state_add(walker);
   lwalk->e = e;
-  BLI_gset_insert(walker->visit_set, e);
+  BLI_flatset_insert(walker->visit_set, e);
 }
 
 static void *bmw_EdgeboundaryWalker_yield(BMWalker *walker)
@@ -1414,7 +1416,7 @@ static void *bmw_EdgeboundaryWalker_step(BMWalker *walker)
   BM_ITER_ELEM (v, &viter, e, BM_VERTS_OF_EDGE) {
     BM_ITER_ELEM (e_other, &eiter, v, BM_EDGES_OF_VERT) {
       if (e != e_other && BM_edge_is_boundary(e_other)) {
-        if (BLI_gset_haskey(walker->visit_set, e_other)) {
+        if (BLI_flatset_haskey(walker->visit_set, e_other)) {
           continue;
         }
 
@@ -1423,7 +1425,7 @@ static void *bmw_EdgeboundaryWalker_step(BMWalker *walker)
         }
 
         lwalk = BMW_state_add(walker);
-        BLI_gset_insert(walker->visit_set, e_other);
+        BLI_flatset_insert(walker->visit_set, e_other);
 
         lwalk->e = e_other;
       }
@@ -1450,13 +1452,13 @@ static void bmw_UVEdgeWalker_begin(BMWalker *walker, void *data)
   BMwUVEdgeWalker *lwalk;
   BMLoop *l = data;
 
-  if (BLI_gset_haskey(walker->visit_set, l)) {
+  if (BLI_flatset_haskey(walker->visit_set, l)) {
     return;
   }
 
   lwalk = BMW_state_add(walker);
   lwalk->l = l;
-  BLI_gset_insert(walker->visit_set, l);
+  BLI_flatset_insert(walker->visit_set, l);
 }
 
 static void *bmw_UVEdgeWalker_yield(BMWalker *walker)
@@ -1503,7 +1505,7 @@ static void *bmw_UVEdgeWalker_step(BMWalker *walker)
         BMLoop *l_other;
         void *data_other;
 
-        if (BLI_gset_haskey(walker->visit_set, l_radial)) {
+        if (BLI_flatset_haskey(walker->visit_set, l_radial)) {
           continue;
         }
 
@@ -1521,7 +1523,7 @@ static void *bmw_UVEdgeWalker_step(BMWalker *walker)
         }
 
         lwalk = BMW_state_add(walker);
-        BLI_gset_insert(walker->visit_set, l_radial);
+        BLI_flatset_insert(walker->visit_set, l_radial);
 
         lwalk->l = l_radial;
 
@@ -40,6 +40,7 @@
 #include "BLI_sort_utils.h"
 
 #include "BLI_linklist_stack.h"
+#include "BLI_task.h"
 #include "BLI_utildefines_stack.h"
 #ifndef NDEBUG
 #endif
@@ -837,6 +838,69 @@ finally:
 
 #ifdef USE_BVH
 
+struct ISectOverlapData {
+  BMLoop *(*looptris)[3];
+  float eps_margin;
+};
+
+/**
+ * Check the vertices of \a t_cos_other are all further than \a margin
+ * on one side of the plane of \a t_cos.
+ */
+static bool tri_plane_separated(const float *t_cos[3],
+                                const float *t_cos_other[3],
+                                const float margin)
+{
+  float t_nor[3];
+  if (normal_tri_v3(t_nor, UNPACK3(t_cos)) == 0.0f) {
+    /* Degenerate, can't tell. */
+    return false;
+  }
+
+  float dist[3];
+  for (uint i = 0; i < 3; i++) {
+    float dir[3];
+    sub_v3_v3v3(dir, t_cos_other[i], t_cos[0]);
+    dist[i] = dot_v3v3(t_nor, dir);
+  }
+  return (min_fff(UNPACK3(dist)) > margin) || (max_fff(UNPACK3(dist)) < -margin);
+}
+
+/**
+ * Overlap callback, rejecting triangle pairs with overlapping bounds that can't touch,
+ * so only pairs which may intersect are passed to #bm_isect_tri_tri.
+ *
+ * All intersection tests in #bm_isect_tri_tri need points of both triangles to be within
+ * #ISectEpsilon.eps_margin of each other, which can't happen when one triangle is entirely
+ * on one side of the other triangle's plane (with a margin to spare).
+ *
+ * Only reads the coordinates, so this runs threaded while the BVH trees are overlapped.
+ */
+static bool bm_isect_tri_tri_overlap_cb(void *userdata,
+                                        int index_a,
+                                        int index_b,
+                                        int UNUSED(thread))
+{
+  const struct ISectOverlapData *data = userdata;
+  BMLoop **a = data->looptris[index_a];
+  BMLoop **b = data->looptris[index_b];
+  BMVert *fv_a[3] = {UNPACK3_EX(, a, ->v)};
+  BMVert *fv_b[3] = {UNPACK3_EX(, b, ->v)};
+
+  /* Same early exit as #bm_isect_tri_tri. */
+  if (UNLIKELY(ELEM(fv_a[0], UNPACK3(fv_b)) || ELEM(fv_a[1], UNPACK3(fv_b)) ||
+               ELEM(fv_a[2], UNPACK3(fv_b)))) {
+    return false;
+  }
+
+  const float *f_a_cos[3] = {UNPACK3_EX(, fv_a, ->co)};
+  const float *f_b_cos[3] = {UNPACK3_EX(, fv_b, ->co)};
+  const float margin = data->eps_margin * 2.0f;
+
+  return !(tri_plane_separated(f_a_cos, f_b_cos, margin) ||
+           tri_plane_separated(f_b_cos, f_a_cos, margin));
+}
+
 struct RaycastData {
   const float **looptris;
   BLI_Buffer *z_buffer;
@@ -940,6 +1004,44 @@ static int isect_bvhtree_point_v3(BVHTree *tree, const float **looptris, const f
   return num_isect;
 }
 
+struct GroupClassifyData {
+  BMFace **ftable;
+  const int *groups_array;
+  int (*group_index)[2];
+  int (*test_fn)(BMFace *f, void *user_data);
+  void *user_data;
+  BVHTree *tree_pair[2];
+  const float **looptri_coords;
+  int *r_group_hits;
+};
+
+/**
+ * Count the ray hits of a face in each group against the other side,
+ * only reads the mesh so groups are classified in parallel.
+ */
+static void bm_face_group_classify_cb(void *__restrict userdata,
+                                      const int i,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const struct GroupClassifyData *data = userdata;
+  /* for now assyme this is an OK face to test with (not degenerate!) */
+  BMFace *f = data->ftable[data->groups_array[data->group_index[i][0]]];
+  float co[3];
+  int side = data->test_fn(f, data->user_data);
+
+  if (side == -1) {
+    data->r_group_hits[i] = 0;
+    return;
+  }
+  BLI_assert(ELEM(side, 0, 1));
+  side = !side;
+
+  // BM_face_calc_center_median(f, co);
+  BM_face_calc_point_in_face(f, co);
+
+  data->r_group_hits[i] = isect_bvhtree_point_v3(data->tree_pair[side], data->looptri_coords, co);
+}
+
 #endif /* USE_BVH */
 
 /**
@@ -1090,7 +1192,17 @@ bool BM_mesh_intersect(BMesh *bm,
     flag &= ~BVH_OVERLAP_USE_THREADING;
   }
 #  endif
-  overlap = BLI_bvhtree_overlap_ex(tree_b, tree_a, &tree_overlap_tot, NULL, NULL, 0, flag);
+  struct ISectOverlapData overlap_data = {
+      .looptris = looptris,
+      .eps_margin = s.epsilon.eps_margin,
+  };
+  overlap = BLI_bvhtree_overlap_ex(tree_b,
+                                   tree_a,
+                                   &tree_overlap_tot,
+                                   bm_isect_tri_tri_overlap_cb,
+                                   &overlap_data,
+                                   0,
+                                   flag);
 
   if (overlap) {
     uint i;
@@ -1522,30 +1634,39 @@ bool BM_mesh_intersect(BMesh *bm,
     printf("%s: Total face-groups: %d\n", __func__, group_tot);
 #endif
 
-    /* Check if island is inside/outside */
+    /* Check if island is inside/outside, ray-casting for each group in parallel. */
+    int *group_hits = MEM_mallocN(sizeof(*group_hits) * (size_t)max_ii(group_tot, 1), __func__);
+    {
+      struct GroupClassifyData classify_data = {
+          .ftable = ftable,
+          .groups_array = groups_array,
+          .group_index = group_index,
+          .test_fn = test_fn,
+          .user_data = user_data,
+          .tree_pair = {tree_pair[0], tree_pair[1]},
+          .looptri_coords = looptri_coords,
+          .r_group_hits = group_hits,
+      };
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+      settings.use_threading = (group_tot > 1);
+      BLI_task_parallel_range(0, group_tot, &classify_data, bm_face_group_classify_cb, &settings);
+    }
+
     for (i = 0; i < group_tot; i++) {
       int fg = group_index[i][0];
       int fg_end = group_index[i][1] + fg;
       bool do_remove, do_flip;
 
       {
-        /* for now assyme this is an OK face to test with (not degenerate!) */
-        BMFace *f = ftable[groups_array[fg]];
-        float co[3];
-        int hits;
-        int side = test_fn(f, user_data);
+        const int hits = group_hits[i];
+        int side = test_fn(ftable[groups_array[fg]], user_data);
 
         if (side == -1) {
           continue;
         }
-        BLI_assert(ELEM(side, 0, 1));
         side = !side;
 
-        // BM_face_calc_center_median(f, co);
-        BM_face_calc_point_in_face(f, co);
-
-        hits = isect_bvhtree_point_v3(tree_pair[side], looptri_coords, co);
-
         switch (boolean_mode) {
           case BMESH_ISECT_BOOLEAN_ISECT:
             do_remove = ((hits & 1) != 1);
@@ -1578,6 +1699,7 @@ bool BM_mesh_intersect(BMesh *bm,
       has_edit_boolean |= (do_flip || do_remove);
     }
 
+    MEM_freeN(group_hits);
     MEM_freeN(groups_array);
     MEM_freeN(group_index);
 
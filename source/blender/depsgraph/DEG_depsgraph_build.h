@@ -93,6 +93,11 @@ void DEG_graph_relations_update(struct Depsgraph *graph,
 /* Tag all relations in the database for update.*/
 void DEG_relations_tag_update(struct Main *bmain);
 
+/* Tag relations of the given ID for update, in all dependency graphs. Unlike the above only
+ * nodes and relations of this ID are rebuilt, when possible. To be used when the ID changes
+ * what it depends on, but not the set of bases of the scene. */
+void DEG_id_relations_tag_update(struct Main *bmain, struct ID *id);
+
 /* Add Dependencies  ----------------------------- */
 
 /* Handle for components to define their dependencies from callbacks.
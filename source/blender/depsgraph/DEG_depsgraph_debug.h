@@ -53,6 +53,13 @@ void DEG_stats_simple(const struct Depsgraph *graph,
                       size_t *r_operations,
                       size_t *r_relations);
 
+/* Time in seconds spent on the last build of the graph: creation of the nodes, of the relations,
+ * and the whole build including its finalization. */
+void DEG_stats_build_time(const struct Depsgraph *graph,
+                          double *r_nodes_time,
+                          double *r_relations_time,
+                          double *r_total_time);
+
 /* ************************************************ */
 /* Diagram-Based Graph Debugging */
 
@@ -63,6 +70,11 @@ void DEG_debug_stats_gnuplot(const struct Depsgraph *graph,
                              const char *label,
                              const char *output_filename);
 
+/* Evaluation timeline in the Chrome trace event format, recorded while G_DEBUG_DEPSGRAPH_TRACE
+ * is enabled. */
+void DEG_debug_trace_chrome(const struct Depsgraph *graph, FILE *stream);
+void DEG_debug_trace_clear(struct Depsgraph *graph);
+
 /* ************************************************ */
 
 /* Compare two dependency graphs. */
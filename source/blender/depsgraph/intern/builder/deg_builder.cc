@@ -34,6 +34,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
 #include "BLI_stack.h"
+#include "BLI_task.h"
 
 #include "BKE_action.h"
 
@@ -77,7 +78,7 @@ bool deg_check_base_in_depsgraph(const Depsgraph *graph, Base *base)
  */
 
 DepsgraphBuilder::DepsgraphBuilder(Main *bmain, Depsgraph *graph, DepsgraphBuilderCache *cache)
-    : bmain_(bmain), graph_(graph), cache_(cache)
+    : bmain_(bmain), graph_(graph), cache_(cache), owner_id_(nullptr)
 {
 }
 
@@ -161,7 +162,8 @@ void deg_graph_build_flush_visibility(Depsgraph *graph)
   BLI_Stack *stack = BLI_stack_new(sizeof(OperationNode *), "DEG flush layers stack");
   for (IDNode *id_node : graph->id_nodes) {
     GHASH_FOREACH_BEGIN (ComponentNode *, comp_node, id_node->components) {
-      comp_node->affects_directly_visible |= id_node->is_directly_visible;
+      /* NOTE: Components of the nodes kept by the incremental build are flushed again. */
+      comp_node->affects_directly_visible = id_node->is_directly_visible;
     }
     GHASH_FOREACH_END();
   }
@@ -208,15 +210,33 @@ void deg_graph_build_flush_visibility(Depsgraph *graph)
 
 }  // namespace
 
+namespace {
+
+void graph_build_finalize_id_node_func(void *__restrict userdata,
+                                       const int index,
+                                       const TaskParallelTLS *__restrict /*tls*/)
+{
+  Depsgraph *graph = static_cast<Depsgraph *>(userdata);
+  graph->id_nodes[index]->finalize_build(graph);
+}
+
+}  // namespace
+
 void deg_graph_build_finalize(Main *bmain, Depsgraph *graph)
 {
   /* Make sure dependencies of visible ID datablocks are visible. */
   deg_graph_build_flush_visibility(graph);
+  /* ID nodes are independent from each other when finalizing, tagging is done afterwards since
+   * it flushes updates across the graph. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(
+      0, graph->id_nodes.size(), graph, graph_build_finalize_id_node_func, &settings);
   /* Re-tag IDs for update if it was tagged before the relations
    * update tag. */
   for (IDNode *id_node : graph->id_nodes) {
     ID *id_orig = id_node->id_orig;
-    id_node->finalize_build(graph);
     int flag = 0;
     /* Tag rebuild if special evaluation flags changed. */
     if (id_node->eval_flags != id_node->previous_eval_flags) {
@@ -243,4 +263,186 @@ void deg_graph_build_finalize(Main *bmain, Depsgraph *graph)
   }
 }
 
+namespace {
+
+/* Whether nodes and relations of the ID can be rebuilt without rebuilding the whole graph.
+ * Scenes and collections are built in the context of the view layer, and some of the IDs are
+ * only built as a part of their users. */
+bool deg_incremental_build_supports_id(const ID *id)
+{
+  switch (GS(id->name)) {
+    case ID_AC:
+    case ID_AR:
+    case ID_CA:
+    case ID_OB:
+    case ID_KE:
+    case ID_LA:
+    case ID_LP:
+    case ID_NT:
+    case ID_MA:
+    case ID_TE:
+    case ID_IM:
+    case ID_WO:
+    case ID_MSK:
+    case ID_LS:
+    case ID_MC:
+    case ID_ME:
+    case ID_CU:
+    case ID_MB:
+    case ID_LT:
+    case ID_SPK:
+    case ID_SO:
+    case ID_CF:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+bool deg_graph_build_incremental_ids(const Depsgraph *graph,
+                                     const set<ID *> &ids,
+                                     vector<ID *> *r_node_ids,
+                                     vector<ID *> *r_relation_ids,
+                                     vector<ID *> *r_kept_node_ids)
+{
+  set<const IDNode *> rebuilt_id_nodes;
+  set<ID *> relation_ids;
+  for (const IDNode *id_node : graph->id_nodes) {
+    if (ids.count(id_node->id_orig) == 0) {
+      continue;
+    }
+    if (!deg_incremental_build_supports_id(id_node->id_orig)) {
+      return false;
+    }
+    rebuilt_id_nodes.insert(id_node);
+    relation_ids.insert(id_node->id_orig);
+  }
+  /* Relations connected to the rebuilt nodes are removed together with them, so the IDs which
+   * added those relations are to build their relations again. */
+  for (const OperationNode *op_node : graph->operations) {
+    const bool is_to_rebuilt = rebuilt_id_nodes.count(op_node->owner->owner) != 0;
+    for (const Relation *rel : op_node->inlinks) {
+      const bool is_from_rebuilt = rel->from->type == NodeType::OPERATION &&
+                                   rebuilt_id_nodes.count(
+                                       ((const OperationNode *)rel->from)->owner->owner) != 0;
+      if (!is_to_rebuilt && !is_from_rebuilt) {
+        continue;
+      }
+      if (rel->owner_id == nullptr || !deg_incremental_build_supports_id(rel->owner_id)) {
+        return false;
+      }
+      relation_ids.insert(rel->owner_id);
+    }
+  }
+  for (const IDNode *id_node : graph->id_nodes) {
+    if (rebuilt_id_nodes.count(id_node) != 0) {
+      r_node_ids->push_back(id_node->id_orig);
+    }
+    else {
+      r_kept_node_ids->push_back(id_node->id_orig);
+    }
+    if (relation_ids.count(id_node->id_orig) != 0) {
+      r_relation_ids->push_back(id_node->id_orig);
+    }
+  }
+  /* All the relations are to be owned by IDs which are in the graph. */
+  return r_relation_ids->size() == relation_ids.size();
+}
+
+bool deg_graph_remove_unused_id_nodes(Depsgraph *graph,
+                                      vector<ID *> *r_relation_ids,
+                                      vector<ID *> *r_kept_node_ids)
+{
+  /* Walk from the IDs used by the view layer, and from the IDs which users are not known. */
+  map<ID *, vector<ID *>> used_ids;
+  vector<ID *> stack;
+  for (const map<ID *, Depsgraph::IDNodeUsers>::value_type &id_users : graph->id_node_users) {
+    for (const Depsgraph::IDNodeUsers::value_type &user : id_users.second) {
+      if (user.first == nullptr) {
+        stack.push_back(id_users.first);
+      }
+      else {
+        used_ids[user.first].push_back(id_users.first);
+      }
+    }
+  }
+  for (const IDNode *id_node : graph->id_nodes) {
+    if (graph->id_node_users.count(id_node->id_orig) == 0) {
+      stack.push_back(id_node->id_orig);
+    }
+  }
+  set<ID *> reached_ids(stack.begin(), stack.end());
+  while (!stack.empty()) {
+    ID *id = stack.back();
+    stack.pop_back();
+    for (ID *used_id : used_ids[id]) {
+      if (reached_ids.insert(used_id).second) {
+        stack.push_back(used_id);
+      }
+    }
+  }
+  set<IDNode *> unused_id_nodes;
+  set<ID *> unused_ids;
+  for (IDNode *id_node : graph->id_nodes) {
+    if (reached_ids.count(id_node->id_orig) == 0) {
+      unused_id_nodes.insert(id_node);
+      unused_ids.insert(id_node->id_orig);
+    }
+  }
+  if (unused_id_nodes.empty()) {
+    return true;
+  }
+  /* Relations of other IDs which are connected to the removed nodes are built again. */
+  set<ID *> relation_ids(r_relation_ids->begin(), r_relation_ids->end());
+  for (const OperationNode *op_node : graph->operations) {
+    const bool is_to_unused = unused_id_nodes.count(op_node->owner->owner) != 0;
+    for (const Relation *rel : op_node->inlinks) {
+      const bool is_from_unused = rel->from->type == NodeType::OPERATION &&
+                                  unused_id_nodes.count(
+                                      ((const OperationNode *)rel->from)->owner->owner) != 0;
+      if (!is_to_unused && !is_from_unused) {
+        continue;
+      }
+      if (rel->owner_id == nullptr) {
+        return false;
+      }
+      if (unused_ids.count(rel->owner_id) != 0) {
+        continue;
+      }
+      if (!deg_incremental_build_supports_id(rel->owner_id)) {
+        return false;
+      }
+      relation_ids.insert(rel->owner_id);
+    }
+  }
+  graph->remove_id_nodes(unused_id_nodes);
+  for (ID *id : unused_ids) {
+    graph->id_node_users.erase(id);
+    graph->id_eval_requests.erase(id);
+  }
+  for (map<ID *, Depsgraph::IDNodeUsers>::value_type &id_users : graph->id_node_users) {
+    for (ID *id : unused_ids) {
+      id_users.second.erase(id);
+    }
+  }
+  for (map<ID *, Depsgraph::IDEvalRequests>::value_type &id_requests : graph->id_eval_requests) {
+    for (ID *id : unused_ids) {
+      id_requests.second.erase(id);
+    }
+  }
+  r_relation_ids->clear();
+  for (const IDNode *id_node : graph->id_nodes) {
+    if (relation_ids.count(id_node->id_orig) != 0) {
+      r_relation_ids->push_back(id_node->id_orig);
+    }
+  }
+  r_kept_node_ids->erase(std::remove_if(r_kept_node_ids->begin(),
+                                        r_kept_node_ids->end(),
+                                        [&](ID *id) { return unused_ids.count(id) != 0; }),
+                         r_kept_node_ids->end());
+  return true;
+}
+
 }  // namespace DEG
@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include "intern/depsgraph_type.h"
+
 struct Base;
 struct ID;
 struct Main;
@@ -48,14 +50,58 @@ class DepsgraphBuilder {
   /* NOTE: The builder does NOT take ownership over any of those resources. */
   DepsgraphBuilder(Main *bmain, Depsgraph *graph, DepsgraphBuilderCache *cache);
 
+  /* Nodes and relations built while the scope exists are built for the given ID. */
+  class OwnerScope {
+   public:
+    OwnerScope(DepsgraphBuilder *builder, ID *id)
+        : builder_(builder), previous_owner_id_(builder->owner_id_)
+    {
+      builder->owner_id_ = id;
+    }
+    ~OwnerScope()
+    {
+      builder_->owner_id_ = previous_owner_id_;
+    }
+
+   protected:
+    DepsgraphBuilder *builder_;
+    ID *previous_owner_id_;
+  };
+
   /* State which never changes, same for the whole builder time. */
   Main *bmain_;
   Depsgraph *graph_;
   DepsgraphBuilderCache *cache_;
+
+  /* ID which nodes or relations are currently being built. */
+  ID *owner_id_;
 };
 
 bool deg_check_id_in_depsgraph(const Depsgraph *graph, ID *id_orig);
 bool deg_check_base_in_depsgraph(const Depsgraph *graph, Base *base);
 void deg_graph_build_finalize(Main *bmain, Depsgraph *graph);
 
+/* Get IDs which are to be rebuilt when relations of the given IDs are to be updated, in the
+ * order of the ID nodes of the graph:
+ *
+ * - r_node_ids: IDs which nodes are rebuilt.
+ * - r_relation_ids: IDs which relations are rebuilt, includes the IDs which relations were
+ *   connected to the rebuilt nodes.
+ * - r_kept_node_ids: IDs which nodes are kept as-is.
+ *
+ * Returns false when the graph can not be updated partially and needs a full rebuild. */
+bool deg_graph_build_incremental_ids(const Depsgraph *graph,
+                                     const set<ID *> &ids,
+                                     vector<ID *> *r_node_ids,
+                                     vector<ID *> *r_relation_ids,
+                                     vector<ID *> *r_kept_node_ids);
+
+/* Remove nodes of the IDs which are not used by the view layer anymore, after the incremental
+ * build. IDs which relations were connected to them are added to r_relation_ids.
+ *
+ * Returns false when the graph can not be updated partially and needs a full rebuild. */
+bool deg_graph_remove_unused_id_nodes(Depsgraph *graph,
+                                      vector<ID *> *r_relation_ids,
+                                      vector<ID *> *r_kept_node_ids);
+
 }  // namespace DEG
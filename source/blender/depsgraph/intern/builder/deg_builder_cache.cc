@@ -152,6 +152,7 @@ bool AnimatedPropertyStorage::isPropertyAnimated(const PointerRNA *pointer_rna,
 
 DepsgraphBuilderCache::DepsgraphBuilderCache()
 {
+  BLI_mutex_init(&mutex_);
 }
 
 DepsgraphBuilderCache::~DepsgraphBuilderCache()
@@ -160,6 +161,7 @@ DepsgraphBuilderCache::~DepsgraphBuilderCache()
     AnimatedPropertyStorage *animated_property_storage = iter.second;
     OBJECT_GUARDED_DELETE(animated_property_storage, AnimatedPropertyStorage);
   }
+  BLI_mutex_end(&mutex_);
 }
 
 AnimatedPropertyStorage *DepsgraphBuilderCache::ensureAnimatedPropertyStorage(ID *id)
@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include "BLI_threads.h"
+
 #include "intern/depsgraph_type.h"
 
 #include "RNA_access.h"
@@ -89,15 +91,24 @@ class DepsgraphBuilderCache {
    * the storage.
    *
    * TODO(sergey): Technically, this makes this class something else than just a cache, but what is
-   * the better name? */
+   * the better name?
+   *
+   * NOTE: Is safe to be called from multiple threads: initialization of a storage can tag
+   * properties in the storages of other IDs, so all storages are guarded by a single lock. */
   template<typename... Args> bool isPropertyAnimated(ID *id, Args... args)
   {
+    BLI_mutex_lock(&mutex_);
     AnimatedPropertyStorage *animated_property_storage = ensureInitializedAnimatedPropertyStorage(
         id);
-    return animated_property_storage->isPropertyAnimated(args...);
+    const bool is_animated = animated_property_storage->isPropertyAnimated(args...);
+    BLI_mutex_unlock(&mutex_);
+    return is_animated;
   }
 
   AnimatedPropertyStorageMap animated_property_storage_map_;
+
+ protected:
+  ThreadMutex mutex_;
 };
 
 }  // namespace DEG
@@ -29,36 +29,48 @@ namespace DEG {
 
 BuilderMap::BuilderMap()
 {
+  BLI_spin_init(&lock_);
 }
 
 BuilderMap::~BuilderMap()
 {
+  BLI_spin_end(&lock_);
 }
 
 bool BuilderMap::checkIsBuilt(ID *id, int tag) const
 {
-  return (getIDTag(id) & tag) == tag;
+  BLI_spin_lock(&lock_);
+  const int id_tag = getIDTag(id);
+  BLI_spin_unlock(&lock_);
+  return (id_tag & tag) == tag;
 }
 
 void BuilderMap::tagBuild(ID *id, int tag)
 {
+  BLI_spin_lock(&lock_);
   IDTagMap::iterator it = id_tags_.find(id);
   if (it == id_tags_.end()) {
     id_tags_.insert(make_pair(id, tag));
-    return;
   }
-  it->second |= tag;
+  else {
+    it->second |= tag;
+  }
+  BLI_spin_unlock(&lock_);
 }
 
 bool BuilderMap::checkIsBuiltAndTag(ID *id, int tag)
 {
+  bool result = false;
+  BLI_spin_lock(&lock_);
   IDTagMap::iterator it = id_tags_.find(id);
   if (it == id_tags_.end()) {
     id_tags_.insert(make_pair(id, tag));
-    return false;
   }
-  const bool result = (it->second & tag) == tag;
-  it->second |= tag;
+  else {
+    result = (it->second & tag) == tag;
+    it->second |= tag;
+  }
+  BLI_spin_unlock(&lock_);
   return result;
 }
 
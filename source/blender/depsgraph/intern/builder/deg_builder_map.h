@@ -23,12 +23,16 @@
 
 #pragma once
 
+#include "BLI_threads.h" /* for SpinLock */
+
 #include "intern/depsgraph_type.h"
 
 struct ID;
 
 namespace DEG {
 
+/* Map is shared by the builders which are building relations from multiple threads, all its
+ * queries are thread safe. */
 class BuilderMap {
  public:
   enum {
@@ -77,6 +81,8 @@ class BuilderMap {
 
   typedef map<ID *, int> IDTagMap;
   IDTagMap id_tags_;
+
+  mutable SpinLock lock_;
 };
 
 }  // namespace DEG
@@ -129,6 +129,19 @@ void free_copy_on_write_datablock(void *id_info_v)
   MEM_freeN(id_info);
 }
 
+/* Visibility all the users requested the ID node with, as eIDNodeUserFlag. */
+int id_node_users_flag(const map<ID *, Depsgraph::IDNodeUsers> &id_node_users, ID *id)
+{
+  int user_flag = 0;
+  map<ID *, Depsgraph::IDNodeUsers>::const_iterator id_users = id_node_users.find(id);
+  if (id_users != id_node_users.end()) {
+    for (const Depsgraph::IDNodeUsers::value_type &user : id_users->second) {
+      user_flag |= user.second;
+    }
+  }
+  return user_flag;
+}
+
 } /* namespace */
 
 /* ************ */
@@ -196,6 +209,16 @@ IDNode *DepsgraphNodeBuilder::find_id_node(ID *id)
   return graph_->find_id_node(id);
 }
 
+bool DepsgraphNodeBuilder::check_is_built_and_tag(ID *id, bool is_visible)
+{
+  /* ID might be requested by itself, for example from its drivers. */
+  if (id != owner_id_) {
+    graph_->id_node_users[id][owner_id_] |= is_visible ? ID_NODE_USER_VISIBLE :
+                                                         ID_NODE_USER_INVISIBLE;
+  }
+  return built_map_.checkIsBuiltAndTag(id);
+}
+
 TimeSourceNode *DepsgraphNodeBuilder::add_time_source()
 {
   return graph_->add_time_source();
@@ -349,7 +372,9 @@ void DepsgraphNodeBuilder::begin_build()
 
   /* Make sure graph has no nodes left from previous state. */
   graph_->clear_all_nodes();
+  graph_->id_node_users.clear();
   graph_->operations.clear();
+  graph_->critical_path_update_countdown = 0;
   BLI_gset_clear(graph_->entry_tags, nullptr);
 }
 
@@ -375,6 +400,160 @@ void DepsgraphNodeBuilder::end_build()
   }
 }
 
+void DepsgraphNodeBuilder::begin_incremental_build(const vector<ID *> &ids)
+{
+  incremental_ids_ = ids;
+  for (IDNode *id_node : graph_->id_nodes) {
+    previous_id_order_.push_back(id_node->id_orig);
+  }
+  /* Rebuilt IDs request the IDs they use again. */
+  previous_id_node_users_ = graph_->id_node_users;
+  for (map<ID *, Depsgraph::IDNodeUsers>::value_type &id_users : graph_->id_node_users) {
+    for (ID *id : ids) {
+      id_users.second.erase(id);
+    }
+  }
+  /* Store copy-on-write versions of the rebuilt datablocks. Operations of the kept nodes might
+   * be referencing them, so they are re-used even when they are not expanded yet. */
+  id_info_hash_ = BLI_ghash_ptr_new("Depsgraph id hash");
+  set<IDNode *> removed_id_nodes;
+  for (ID *id : ids) {
+    IDNode *id_node = find_id_node(id);
+    IDInfo *id_info = (IDInfo *)MEM_mallocN(sizeof(IDInfo), "depsgraph id info");
+    id_info->id_cow = (id_node->id_orig != id_node->id_cow) ? id_node->id_cow : nullptr;
+    id_info->previously_visible_components_mask = id_node->visible_components_mask;
+    id_info->previous_eval_flags = id_node->eval_flags;
+    id_info->previous_customdata_masks = id_node->customdata_masks;
+    BLI_ghash_insert(id_info_hash_, id_node->id_orig, id_info);
+    id_node->id_cow = nullptr;
+    removed_id_nodes.insert(id_node);
+  }
+
+  GSET_FOREACH_BEGIN (OperationNode *, op_node, graph_->entry_tags) {
+    ComponentNode *comp_node = op_node->owner;
+    IDNode *id_node = comp_node->owner;
+    if (removed_id_nodes.count(id_node) == 0) {
+      continue;
+    }
+    SavedEntryTag entry_tag;
+    entry_tag.id_orig = id_node->id_orig;
+    entry_tag.component_type = comp_node->type;
+    entry_tag.opcode = op_node->opcode;
+    entry_tag.name = op_node->name;
+    entry_tag.name_tag = op_node->name_tag;
+    saved_entry_tags_.push_back(entry_tag);
+  }
+  GSET_FOREACH_END();
+
+  graph_->remove_id_nodes(removed_id_nodes);
+  graph_->critical_path_update_countdown = 0;
+
+  /* Nodes of all other IDs are kept, their evaluation requirements are updated by the relations
+   * builder. */
+  for (IDNode *id_node : graph_->id_nodes) {
+    id_node->previously_visible_components_mask = id_node->visible_components_mask;
+    id_node->previous_eval_flags = id_node->eval_flags;
+    id_node->previous_customdata_masks = id_node->customdata_masks;
+    built_map_.tagBuild(id_node->id_orig);
+  }
+}
+
+void DepsgraphNodeBuilder::build_incremental(Scene *scene, ViewLayer *view_layer)
+{
+  /* NOTE: Pass view layer index of 0 since after scene CoW there is
+   * only one view layer in there. */
+  view_layer_index_ = 0;
+  /* Build objects from their bases first, same as the view layer builder does. */
+  eDepsNode_LinkedState_Type linked_state = DEG_ID_LINKED_DIRECTLY;
+  for (Scene *scene_iter = scene; scene_iter != nullptr; scene_iter = scene_iter->set) {
+    ViewLayer *view_layer_iter = (scene_iter == scene) ? view_layer :
+                                                         BKE_view_layer_default_render(scene_iter);
+    scene_ = scene_iter;
+    view_layer_ = view_layer_iter;
+    int base_index = 0;
+    LISTBASE_FOREACH (Base *, base, &view_layer_iter->object_bases) {
+      if (!need_pull_base_into_graph(base)) {
+        continue;
+      }
+      Object *object = base->object;
+      if (std::find(incremental_ids_.begin(), incremental_ids_.end(), &object->id) !=
+          incremental_ids_.end()) {
+        build_object(base_index, object, linked_state, true);
+      }
+      base_index++;
+    }
+    linked_state = DEG_ID_LINKED_VIA_SET;
+  }
+  scene_ = scene;
+  view_layer_ = view_layer;
+
+  for (ID *id : incremental_ids_) {
+    /* Users of the ID which are not rebuilt do not request it again, so it is built the same way
+     * they requested it. */
+    const OwnerScope owner_scope(this, id);
+    if (GS(id->name) == ID_OB) {
+      const int user_flag = id_node_users_flag(previous_id_node_users_, id);
+      build_object(
+          -1, (Object *)id, DEG_ID_LINKED_INDIRECTLY, (user_flag & ID_NODE_USER_VISIBLE) != 0);
+    }
+    else {
+      build_id(id);
+    }
+    IDNode *id_node = find_id_node(id);
+    id_node->tag_update(graph_, DEG_UPDATE_SOURCE_RELATIONS);
+  }
+
+  /* Keep the order of ID nodes, new ones go after all the existing ones. */
+  Depsgraph::IDDepsNodes id_nodes;
+  id_nodes.reserve(graph_->id_nodes.size());
+  set<IDNode *> ordered_id_nodes;
+  for (ID *id : previous_id_order_) {
+    IDNode *id_node = find_id_node(id);
+    if (id_node != nullptr) {
+      id_nodes.push_back(id_node);
+      ordered_id_nodes.insert(id_node);
+    }
+  }
+  for (IDNode *id_node : graph_->id_nodes) {
+    if (ordered_id_nodes.count(id_node) == 0) {
+      id_nodes.push_back(id_node);
+    }
+  }
+  graph_->id_nodes = id_nodes;
+}
+
+bool DepsgraphNodeBuilder::end_incremental_build()
+{
+  end_build();
+  /* Objects and collections get visibility of the user which builds them first. It is only known
+   * when all the users agree on it, which is checked for the rebuilt nodes and for the nodes which
+   * users changed. */
+  for (const map<ID *, Depsgraph::IDNodeUsers>::value_type &id_users : graph_->id_node_users) {
+    ID *id = id_users.first;
+    if (!ELEM(GS(id->name), ID_OB, ID_GR)) {
+      continue;
+    }
+    map<ID *, Depsgraph::IDNodeUsers>::const_iterator previous_id_users =
+        previous_id_node_users_.find(id);
+    const bool is_new = (previous_id_users == previous_id_node_users_.end());
+    const bool is_rebuilt = std::find(incremental_ids_.begin(), incremental_ids_.end(), id) !=
+                            incremental_ids_.end();
+    if (!is_new && !is_rebuilt && previous_id_users->second == id_users.second) {
+      continue;
+    }
+    const int user_flag = id_node_users_flag(graph_->id_node_users, id);
+    if (user_flag == (ID_NODE_USER_VISIBLE | ID_NODE_USER_INVISIBLE)) {
+      return false;
+    }
+    if (!is_new && !id_users.second.empty() &&
+        user_flag != id_node_users_flag(previous_id_node_users_, id)) {
+      return false;
+    }
+  }
+  previous_id_node_users_.clear();
+  return true;
+}
+
 void DepsgraphNodeBuilder::build_id(ID *id)
 {
   if (id == nullptr) {
@@ -479,7 +658,7 @@ void DepsgraphNodeBuilder::build_collection(LayerCollection *from_layer_collecti
   const bool is_collection_restricted = (collection->flag & restrict_flag);
   const bool is_collection_visible = !is_collection_restricted && is_parent_collection_visible_;
   IDNode *id_node;
-  if (built_map_.checkIsBuiltAndTag(collection)) {
+  if (check_is_built_and_tag(collection, is_collection_visible)) {
     id_node = find_id_node(&collection->id);
     if (is_collection_visible && id_node->is_directly_visible == false &&
         id_node->is_collection_fully_expanded == true) {
@@ -501,6 +680,7 @@ void DepsgraphNodeBuilder::build_collection(LayerCollection *from_layer_collecti
     id_node = add_id_node(&collection->id);
     id_node->is_directly_visible = is_collection_visible;
   }
+  const OwnerScope owner_scope(this, &collection->id);
   if (from_layer_collection != nullptr) {
     /* If we came from layer collection we don't go deeper, view layer
      * builder takes care of going deeper. */
@@ -534,7 +714,7 @@ void DepsgraphNodeBuilder::build_object(int base_index,
   if (object->proxy != nullptr) {
     object->proxy->proxy_from = object;
   }
-  const bool has_object = built_map_.checkIsBuiltAndTag(object);
+  const bool has_object = check_is_built_and_tag(object, is_visible);
   /* Skip rest of components if the ID node was already there. */
   if (has_object) {
     IDNode *id_node = find_id_node(&object->id);
@@ -550,6 +730,7 @@ void DepsgraphNodeBuilder::build_object(int base_index,
     id_node->has_base |= (base_index != -1);
     return;
   }
+  const OwnerScope owner_scope(this, &object->id);
   /* Create ID node for object and begin init. */
   IDNode *id_node = add_id_node(&object->id);
   Object *object_cow = get_cow_datablock(object);
@@ -903,9 +1084,10 @@ void DepsgraphNodeBuilder::build_animation_images(ID *id)
 
 void DepsgraphNodeBuilder::build_action(bAction *action)
 {
-  if (built_map_.checkIsBuiltAndTag(action)) {
+  if (check_is_built_and_tag(action)) {
     return;
   }
+  const OwnerScope owner_scope(this, &action->id);
   add_operation_node(&action->id, NodeType::ANIMATION, OperationCode::ANIMATION_EVAL);
 }
 
@@ -994,9 +1176,10 @@ void DepsgraphNodeBuilder::build_parameters(ID *id)
 /* Recursively build graph for world */
 void DepsgraphNodeBuilder::build_world(World *world)
 {
-  if (built_map_.checkIsBuiltAndTag(world)) {
+  if (check_is_built_and_tag(world)) {
     return;
   }
+  const OwnerScope owner_scope(this, &world->id);
   /* World itself. */
   add_id_node(&world->id);
   World *world_cow = get_cow_datablock(world);
@@ -1150,9 +1333,10 @@ void DepsgraphNodeBuilder::build_particle_systems(Object *object, bool is_object
 
 void DepsgraphNodeBuilder::build_particle_settings(ParticleSettings *particle_settings)
 {
-  if (built_map_.checkIsBuiltAndTag(particle_settings)) {
+  if (check_is_built_and_tag(particle_settings)) {
     return;
   }
+  const OwnerScope owner_scope(this, &particle_settings->id);
   /* Make sure we've got proper copied ID pointer. */
   add_id_node(&particle_settings->id);
   ParticleSettings *particle_settings_cow = get_cow_datablock(particle_settings);
@@ -1184,9 +1368,10 @@ void DepsgraphNodeBuilder::build_particle_settings(ParticleSettings *particle_se
 /* Shapekeys */
 void DepsgraphNodeBuilder::build_shapekeys(Key *key)
 {
-  if (built_map_.checkIsBuiltAndTag(key)) {
+  if (check_is_built_and_tag(key)) {
     return;
   }
+  const OwnerScope owner_scope(this, &key->id);
   build_animdata(&key->id);
   build_parameters(&key->id);
   /* This is an exit operation for the entire key datablock, is what is used
@@ -1233,9 +1418,10 @@ void DepsgraphNodeBuilder::build_object_data_geometry(Object *object, bool is_ob
 
 void DepsgraphNodeBuilder::build_object_data_geometry_datablock(ID *obdata, bool is_object_visible)
 {
-  if (built_map_.checkIsBuiltAndTag(obdata)) {
+  if (check_is_built_and_tag(obdata)) {
     return;
   }
+  const OwnerScope owner_scope(this, obdata);
   OperationNode *op_node;
   /* Make sure we've got an ID node before requesting CoW pointer. */
   (void)add_id_node((ID *)obdata);
@@ -1322,9 +1508,10 @@ void DepsgraphNodeBuilder::build_object_data_geometry_datablock(ID *obdata, bool
 
 void DepsgraphNodeBuilder::build_armature(bArmature *armature)
 {
-  if (built_map_.checkIsBuiltAndTag(armature)) {
+  if (check_is_built_and_tag(armature)) {
     return;
   }
+  const OwnerScope owner_scope(this, &armature->id);
   build_animdata(&armature->id);
   build_parameters(&armature->id);
   /* Make sure pose is up-to-date with armature updates. */
@@ -1333,9 +1520,10 @@ void DepsgraphNodeBuilder::build_armature(bArmature *armature)
 
 void DepsgraphNodeBuilder::build_camera(Camera *camera)
 {
-  if (built_map_.checkIsBuiltAndTag(camera)) {
+  if (check_is_built_and_tag(camera)) {
     return;
   }
+  const OwnerScope owner_scope(this, &camera->id);
   build_animdata(&camera->id);
   build_parameters(&camera->id);
   if (camera->dof.focus_object != nullptr) {
@@ -1345,9 +1533,10 @@ void DepsgraphNodeBuilder::build_camera(Camera *camera)
 
 void DepsgraphNodeBuilder::build_light(Light *lamp)
 {
-  if (built_map_.checkIsBuiltAndTag(lamp)) {
+  if (check_is_built_and_tag(lamp)) {
     return;
   }
+  const OwnerScope owner_scope(this, &lamp->id);
   build_animdata(&lamp->id);
   build_parameters(&lamp->id);
   /* light's nodetree */
@@ -1359,9 +1548,10 @@ void DepsgraphNodeBuilder::build_nodetree(bNodeTree *ntree)
   if (ntree == nullptr) {
     return;
   }
-  if (built_map_.checkIsBuiltAndTag(ntree)) {
+  if (check_is_built_and_tag(ntree)) {
     return;
   }
+  const OwnerScope owner_scope(this, &ntree->id);
   /* nodetree itself */
   add_id_node(&ntree->id);
   bNodeTree *ntree_cow = get_cow_datablock(ntree);
@@ -1433,9 +1623,10 @@ void DepsgraphNodeBuilder::build_nodetree(bNodeTree *ntree)
 /* Recursively build graph for material */
 void DepsgraphNodeBuilder::build_material(Material *material)
 {
-  if (built_map_.checkIsBuiltAndTag(material)) {
+  if (check_is_built_and_tag(material)) {
     return;
   }
+  const OwnerScope owner_scope(this, &material->id);
   /* Material itself. */
   add_id_node(&material->id);
   Material *material_cow = get_cow_datablock(material);
@@ -1464,9 +1655,10 @@ void DepsgraphNodeBuilder::build_materials(Material **materials, int num_materia
 /* Recursively build graph for texture */
 void DepsgraphNodeBuilder::build_texture(Tex *texture)
 {
-  if (built_map_.checkIsBuiltAndTag(texture)) {
+  if (check_is_built_and_tag(texture)) {
     return;
   }
+  const OwnerScope owner_scope(this, &texture->id);
   /* Texture itself. */
   build_animdata(&texture->id);
   build_parameters(&texture->id);
@@ -1484,9 +1676,10 @@ void DepsgraphNodeBuilder::build_texture(Tex *texture)
 
 void DepsgraphNodeBuilder::build_image(Image *image)
 {
-  if (built_map_.checkIsBuiltAndTag(image)) {
+  if (check_is_built_and_tag(image)) {
     return;
   }
+  const OwnerScope owner_scope(this, &image->id);
   build_parameters(&image->id);
   add_operation_node(
       &image->id, NodeType::GENERIC_DATABLOCK, OperationCode::GENERIC_DATABLOCK_UPDATE);
@@ -1494,9 +1687,10 @@ void DepsgraphNodeBuilder::build_image(Image *image)
 
 void DepsgraphNodeBuilder::build_gpencil(bGPdata *gpd)
 {
-  if (built_map_.checkIsBuiltAndTag(gpd)) {
+  if (check_is_built_and_tag(gpd)) {
     return;
   }
+  const OwnerScope owner_scope(this, &gpd->id);
   ID *gpd_id = &gpd->id;
 
   /* TODO(sergey): what about multiple users of same datablock? This should
@@ -1510,9 +1704,10 @@ void DepsgraphNodeBuilder::build_gpencil(bGPdata *gpd)
 
 void DepsgraphNodeBuilder::build_cachefile(CacheFile *cache_file)
 {
-  if (built_map_.checkIsBuiltAndTag(cache_file)) {
+  if (check_is_built_and_tag(cache_file)) {
     return;
   }
+  const OwnerScope owner_scope(this, &cache_file->id);
   ID *cache_file_id = &cache_file->id;
   add_id_node(cache_file_id);
   CacheFile *cache_file_cow = get_cow_datablock(cache_file);
@@ -1528,9 +1723,10 @@ void DepsgraphNodeBuilder::build_cachefile(CacheFile *cache_file)
 
 void DepsgraphNodeBuilder::build_mask(Mask *mask)
 {
-  if (built_map_.checkIsBuiltAndTag(mask)) {
+  if (check_is_built_and_tag(mask)) {
     return;
   }
+  const OwnerScope owner_scope(this, &mask->id);
   ID *mask_id = &mask->id;
   Mask *mask_cow = (Mask *)ensure_cow_id(mask_id);
   /* F-Curve based animation. */
@@ -1563,9 +1759,10 @@ void DepsgraphNodeBuilder::build_mask(Mask *mask)
 
 void DepsgraphNodeBuilder::build_freestyle_linestyle(FreestyleLineStyle *linestyle)
 {
-  if (built_map_.checkIsBuiltAndTag(linestyle)) {
+  if (check_is_built_and_tag(linestyle)) {
     return;
   }
+  const OwnerScope owner_scope(this, &linestyle->id);
 
   ID *linestyle_id = &linestyle->id;
   build_parameters(linestyle_id);
@@ -1575,9 +1772,10 @@ void DepsgraphNodeBuilder::build_freestyle_linestyle(FreestyleLineStyle *linesty
 
 void DepsgraphNodeBuilder::build_movieclip(MovieClip *clip)
 {
-  if (built_map_.checkIsBuiltAndTag(clip)) {
+  if (check_is_built_and_tag(clip)) {
     return;
   }
+  const OwnerScope owner_scope(this, &clip->id);
   ID *clip_id = &clip->id;
   MovieClip *clip_cow = (MovieClip *)ensure_cow_id(clip_id);
   /* Animation. */
@@ -1597,9 +1795,10 @@ void DepsgraphNodeBuilder::build_movieclip(MovieClip *clip)
 
 void DepsgraphNodeBuilder::build_lightprobe(LightProbe *probe)
 {
-  if (built_map_.checkIsBuiltAndTag(probe)) {
+  if (check_is_built_and_tag(probe)) {
     return;
   }
+  const OwnerScope owner_scope(this, &probe->id);
   /* Placeholder so we can add relations and tag ID node for update. */
   add_operation_node(&probe->id, NodeType::PARAMETERS, OperationCode::LIGHT_PROBE_EVAL);
   build_animdata(&probe->id);
@@ -1608,9 +1807,10 @@ void DepsgraphNodeBuilder::build_lightprobe(LightProbe *probe)
 
 void DepsgraphNodeBuilder::build_speaker(Speaker *speaker)
 {
-  if (built_map_.checkIsBuiltAndTag(speaker)) {
+  if (check_is_built_and_tag(speaker)) {
     return;
   }
+  const OwnerScope owner_scope(this, &speaker->id);
   /* Placeholder so we can add relations and tag ID node for update. */
   add_operation_node(&speaker->id, NodeType::AUDIO, OperationCode::SPEAKER_EVAL);
   build_animdata(&speaker->id);
@@ -1622,9 +1822,10 @@ void DepsgraphNodeBuilder::build_speaker(Speaker *speaker)
 
 void DepsgraphNodeBuilder::build_sound(bSound *sound)
 {
-  if (built_map_.checkIsBuiltAndTag(sound)) {
+  if (check_is_built_and_tag(sound)) {
     return;
   }
+  const OwnerScope owner_scope(this, &sound->id);
   add_id_node(&sound->id);
   bSound *sound_cow = get_cow_datablock(sound);
   add_operation_node(&sound->id,
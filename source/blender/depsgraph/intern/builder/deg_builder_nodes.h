@@ -98,6 +98,13 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   virtual void begin_build();
   virtual void end_build();
 
+  /* Rebuild nodes of the given IDs only, nodes of all other IDs are kept as-is. Is to be followed
+   * by end_incremental_build(), which returns false when the visibility of the nodes can not be
+   * the same as the full build of the graph gives, and the graph is to be fully rebuilt. */
+  void begin_incremental_build(const vector<ID *> &ids);
+  void build_incremental(Scene *scene, ViewLayer *view_layer);
+  bool end_incremental_build();
+
   IDNode *add_id_node(ID *id);
   IDNode *find_id_node(ID *id);
   TimeSourceNode *add_time_source();
@@ -246,6 +253,14 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   };
   vector<SavedEntryTag> saved_entry_tags_;
 
+  /* Same as BuilderMap::checkIsBuiltAndTag(), but also remembers the ID which is currently being
+   * built as a user of the given one. */
+  bool check_is_built_and_tag(ID *id, bool is_visible = true);
+  template<typename T> bool check_is_built_and_tag(T *datablock, bool is_visible = true)
+  {
+    return check_is_built_and_tag(&datablock->id, is_visible);
+  }
+
   struct BuilderWalkUserData {
     DepsgraphNodeBuilder *builder;
     /* Denotes whether object the walk is invoked from is visible. */
@@ -275,6 +290,12 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   /* Indexed by original ID, values are IDInfo. */
   GHash *id_info_hash_;
 
+  /* IDs which nodes are rebuilt by the incremental build, order of all ID nodes and their users
+   * before it. */
+  vector<ID *> incremental_ids_;
+  vector<ID *> previous_id_order_;
+  map<ID *, map<ID *, int>> previous_id_node_users_;
+
   /* Set of IDs which were already build. Makes it easier to keep track of
    * what was already built and what was not. */
   BuilderMap built_map_;
@@ -241,10 +241,32 @@ bool object_have_geometry_component(const Object *object)
 DepsgraphRelationBuilder::DepsgraphRelationBuilder(Main *bmain,
                                                    Depsgraph *graph,
                                                    DepsgraphBuilderCache *cache)
-    : DepsgraphBuilder(bmain, graph, cache), scene_(nullptr), rna_node_query_(graph, this)
+    : DepsgraphBuilder(bmain, graph, cache),
+      scene_(nullptr),
+      built_map_(own_built_map_),
+      rna_node_query_(graph, this),
+      use_threading_(false),
+      deferred_relations_(nullptr)
 {
 }
 
+DepsgraphRelationBuilder::DepsgraphRelationBuilder(DepsgraphRelationBuilder *parent,
+                                                   vector<DeferredRelation> *deferred_relations)
+    : DepsgraphBuilder(parent->bmain_, parent->graph_, parent->cache_),
+      scene_(parent->scene_),
+      built_map_(parent->built_map_),
+      rna_node_query_(parent->graph_, this),
+      use_threading_(false),
+      deferred_relations_(deferred_relations)
+{
+  owner_id_ = parent->owner_id_;
+}
+
+void DepsgraphRelationBuilder::set_use_threading(bool use_threading)
+{
+  use_threading_ = use_threading;
+}
+
 TimeSourceNode *DepsgraphRelationBuilder::get_node(const TimeSourceKey &key) const
 {
   if (key.id) {
@@ -326,7 +348,11 @@ void DepsgraphRelationBuilder::add_customdata_mask(Object *object,
       BLI_assert(!"ID should always be valid");
     }
     else {
+      /* Masks are requested by relations of multiple objects, possibly built from threads. */
+      BLI_spin_lock(&graph_->lock);
       id_node->customdata_masks |= customdata_masks;
+      graph_->id_eval_requests[&object->id][owner_id_].customdata_masks |= customdata_masks;
+      BLI_spin_unlock(&graph_->lock);
     }
   }
 }
@@ -338,7 +364,10 @@ void DepsgraphRelationBuilder::add_special_eval_flag(ID *id, uint32_t flag)
     BLI_assert(!"ID should always be valid");
   }
   else {
+    BLI_spin_lock(&graph_->lock);
     id_node->eval_flags |= flag;
+    graph_->id_eval_requests[id][owner_id_].eval_flags |= flag;
+    BLI_spin_unlock(&graph_->lock);
   }
 }
 
@@ -348,7 +377,7 @@ Relation *DepsgraphRelationBuilder::add_time_relation(TimeSourceNode *timesrc,
                                                       int flags)
 {
   if (timesrc && node_to) {
-    return graph_->add_new_relation(timesrc, node_to, description, flags);
+    return add_new_relation(timesrc, node_to, description, flags);
   }
   else {
     DEG_DEBUG_PRINTF((::Depsgraph *)graph_,
@@ -369,7 +398,7 @@ Relation *DepsgraphRelationBuilder::add_operation_relation(OperationNode *node_f
                                                            int flags)
 {
   if (node_from && node_to) {
-    return graph_->add_new_relation(node_from, node_to, description, flags);
+    return add_new_relation(node_from, node_to, description, flags);
   }
   else {
     DEG_DEBUG_PRINTF((::Depsgraph *)graph_,
@@ -384,6 +413,31 @@ Relation *DepsgraphRelationBuilder::add_operation_relation(OperationNode *node_f
   return nullptr;
 }
 
+Relation *DepsgraphRelationBuilder::add_new_relation(Node *node_from,
+                                                     Node *node_to,
+                                                     const char *description,
+                                                     int flags)
+{
+  if (deferred_relations_ != nullptr) {
+    DeferredRelation relation = {node_from, node_to, description, flags, owner_id_};
+    deferred_relations_->push_back(relation);
+    return nullptr;
+  }
+  Relation *existing_relation = nullptr;
+  if (flags & RELATION_CHECK_BEFORE_ADD) {
+    existing_relation = graph_->check_nodes_connected(node_from, node_to, description);
+  }
+  Relation *relation = graph_->add_new_relation(node_from, node_to, description, flags);
+  if (relation != existing_relation) {
+    relation->owner_id = owner_id_;
+  }
+  else if (relation->owner_id != owner_id_) {
+    /* Relation is requested by multiple IDs, none of them owns it. */
+    relation->owner_id = nullptr;
+  }
+  return relation;
+}
+
 void DepsgraphRelationBuilder::add_particle_collision_relations(const OperationKey &key,
                                                                 Object *object,
                                                                 Collection *collection,
@@ -474,6 +528,81 @@ Depsgraph *DepsgraphRelationBuilder::getGraph()
 
 void DepsgraphRelationBuilder::begin_build()
 {
+  graph_->id_eval_requests.clear();
+}
+
+void DepsgraphRelationBuilder::begin_incremental_build(const vector<ID *> &ids,
+                                                       const vector<ID *> &kept_node_ids)
+{
+  incremental_ids_.insert(ids.begin(), ids.end());
+  kept_node_ids_.insert(kept_node_ids.begin(), kept_node_ids.end());
+  /* Remove relations which are to be built again. The ones which were connected to the rebuilt
+   * nodes were removed together with the nodes. */
+  vector<Relation *> removed_relations;
+  for (OperationNode *op_node : graph_->operations) {
+    for (Relation *rel : op_node->inlinks) {
+      if (rel->owner_id != nullptr && incremental_ids_.count(rel->owner_id) != 0) {
+        removed_relations.push_back(rel);
+      }
+    }
+  }
+  for (Relation *rel : removed_relations) {
+    rel->unlink();
+    OBJECT_GUARDED_DELETE(rel, Relation);
+  }
+  /* Evaluation requirements are requested again by the rebuilt relations. */
+  for (map<ID *, Depsgraph::IDEvalRequests>::value_type &id_requests : graph_->id_eval_requests) {
+    for (ID *id : ids) {
+      id_requests.second.erase(id);
+    }
+  }
+  for (IDNode *id_node : graph_->id_nodes) {
+    id_node->eval_flags = 0;
+    id_node->customdata_masks = DEGCustomDataMeshMasks();
+    map<ID *, Depsgraph::IDEvalRequests>::const_iterator id_requests =
+        graph_->id_eval_requests.find(id_node->id_orig);
+    if (id_requests == graph_->id_eval_requests.end()) {
+      continue;
+    }
+    for (const Depsgraph::IDEvalRequests::value_type &request : id_requests->second) {
+      id_node->eval_flags |= request.second.eval_flags;
+      id_node->customdata_masks |= request.second.customdata_masks;
+    }
+  }
+  /* Relations of all other kept nodes are up to date. */
+  for (ID *id : kept_node_ids) {
+    if (incremental_ids_.count(id) == 0) {
+      built_map_.tagBuild(id);
+    }
+  }
+}
+
+void DepsgraphRelationBuilder::build_incremental(Scene *scene, ViewLayer *view_layer)
+{
+  /* Build objects from their bases first, same as the view layer builder does. */
+  for (Scene *scene_iter = scene; scene_iter != nullptr; scene_iter = scene_iter->set) {
+    ViewLayer *view_layer_iter = (scene_iter == scene) ? view_layer :
+                                                         BKE_view_layer_default_render(scene_iter);
+    scene_ = scene_iter;
+    LISTBASE_FOREACH (Base *, base, &view_layer_iter->object_bases) {
+      if (need_pull_base_into_graph(base) && incremental_ids_.count(&base->object->id) != 0) {
+        build_object(base, base->object);
+      }
+    }
+  }
+  scene_ = scene;
+  for (IDNode *id_node : graph_->id_nodes) {
+    if (incremental_ids_.count(id_node->id_orig) != 0) {
+      build_id(id_node->id_orig);
+    }
+  }
+  /* Copy-on-write relations of the rebuilt relations and of the newly created nodes. */
+  for (IDNode *id_node : graph_->id_nodes) {
+    if (incremental_ids_.count(id_node->id_orig) != 0 ||
+        kept_node_ids_.count(id_node->id_orig) == 0) {
+      build_copy_on_write_relations(id_node);
+    }
+  }
 }
 
 void DepsgraphRelationBuilder::build_id(ID *id)
@@ -603,6 +732,7 @@ void DepsgraphRelationBuilder::build_collection(LayerCollection *from_layer_coll
 
 void DepsgraphRelationBuilder::build_object(Base *base, Object *object)
 {
+  const OwnerScope owner_scope(this, &object->id);
   if (built_map_.checkIsBuiltAndTag(object)) {
     if (base != nullptr) {
       build_object_flags(base, object);
@@ -949,6 +1079,12 @@ void DepsgraphRelationBuilder::build_object_parent(Object *object)
     /* NOTE: Metaballs are evaluating geometry only after their transform,
      * so we only hook up to transform channel here. */
     add_relation(parent_geometry_key, object_transform_key, "Parent");
+    /* The basis of the family builds the instance list of the parent. */
+    Object *mom = BKE_mball_basis_find(scene_, object);
+    ComponentKey mom_geom_key(&mom->id, NodeType::GEOMETRY);
+    ComponentKey parent_transform_key(parent_id, NodeType::TRANSFORM);
+    add_relation(parent_geometry_key, mom_geom_key, "Metaball Instancer");
+    add_relation(parent_transform_key, mom_geom_key, "Metaball Instancer");
   }
 
   /* Dupliverts uses original vertex index. */
@@ -1278,7 +1414,7 @@ void DepsgraphRelationBuilder::build_animdata_curves_targets(ID *id,
       add_relation(adt_key, pose_init_key, "Animation -> Prop", RELATION_CHECK_BEFORE_ADD);
       continue;
     }
-    graph_->add_new_relation(
+    add_operation_relation(
         operation_from, operation_to, "Animation -> Prop", RELATION_CHECK_BEFORE_ADD);
     /* It is possible that animation is writing to a nested ID data-block,
      * need to make sure animation is evaluated after target ID is copied. */
@@ -1394,6 +1530,7 @@ void DepsgraphRelationBuilder::build_animation_images(ID *id)
 
 void DepsgraphRelationBuilder::build_action(bAction *action)
 {
+  const OwnerScope owner_scope(this, &action->id);
   if (built_map_.checkIsBuiltAndTag(action)) {
     return;
   }
@@ -1626,6 +1763,7 @@ void DepsgraphRelationBuilder::build_parameters(ID *id)
 
 void DepsgraphRelationBuilder::build_world(World *world)
 {
+  const OwnerScope owner_scope(this, &world->id);
   if (built_map_.checkIsBuiltAndTag(world)) {
     return;
   }
@@ -1839,6 +1977,7 @@ void DepsgraphRelationBuilder::build_particle_systems(Object *object)
         break;
     }
   }
+  build_particle_systems_mball_bases(object);
   /* Particle depends on the object transform, so that channel is to be ready
    * first. */
   add_depends_on_transform_relation(&object->id, obdata_ubereval_key, "Particle Eval");
@@ -1846,6 +1985,7 @@ void DepsgraphRelationBuilder::build_particle_systems(Object *object)
 
 void DepsgraphRelationBuilder::build_particle_settings(ParticleSettings *part)
 {
+  const OwnerScope owner_scope(this, &part->id);
   if (built_map_.checkIsBuiltAndTag(part)) {
     return;
   }
@@ -1898,12 +2038,51 @@ void DepsgraphRelationBuilder::build_particle_system_visualization_object(Object
   if (draw_object->type == OB_MBALL) {
     ComponentKey dup_geometry_key(&draw_object->id, NodeType::GEOMETRY);
     add_relation(obdata_ubereval_key, dup_geometry_key, "Particle MBall Visualization");
+    /* The basis of the family builds the instance list of the object. */
+    Object *mom = BKE_mball_basis_find(scene_, draw_object);
+    ComponentKey mom_geom_key(&mom->id, NodeType::GEOMETRY);
+    ComponentKey transform_key(&object->id, NodeType::TRANSFORM);
+    add_relation(obdata_ubereval_key, mom_geom_key, "Particle MBall Instancer");
+    add_relation(transform_key, mom_geom_key, "Particle MBall Instancer");
+  }
+}
+
+void DepsgraphRelationBuilder::build_particle_systems_mball_bases(Object *object)
+{
+  /* Metaball bases instanced by the particles each build the instance list of the object, which
+   * temporarily writes to its particle systems. Evaluate these bases one after another, ordered
+   * by address so bases shared by several objects never depend on each other both ways. */
+  set<Object *> moms;
+  LISTBASE_FOREACH (ParticleSystem *, psys, &object->particlesystem) {
+    ParticleSettings *part = psys->part;
+    if (part->ren_as == PART_DRAW_OB && part->instance_object != nullptr) {
+      if (part->instance_object->type == OB_MBALL) {
+        moms.insert(BKE_mball_basis_find(scene_, part->instance_object));
+      }
+    }
+    else if (part->ren_as == PART_DRAW_GR && part->instance_collection != nullptr) {
+      LISTBASE_FOREACH (CollectionObject *, go, &part->instance_collection->gobject) {
+        if (go->ob->type == OB_MBALL) {
+          moms.insert(BKE_mball_basis_find(scene_, go->ob));
+        }
+      }
+    }
+  }
+  Object *mom_prev = nullptr;
+  for (Object *mom : moms) {
+    if (mom_prev != nullptr) {
+      ComponentKey mom_prev_geom_key(&mom_prev->id, NodeType::GEOMETRY);
+      ComponentKey mom_geom_key(&mom->id, NodeType::GEOMETRY);
+      add_relation(mom_prev_geom_key, mom_geom_key, "Particle MBall Instancer Order");
+    }
+    mom_prev = mom;
   }
 }
 
 /* Shapekeys */
 void DepsgraphRelationBuilder::build_shapekeys(Key *key)
 {
+  const OwnerScope owner_scope(this, &key->id);
   if (built_map_.checkIsBuiltAndTag(key)) {
     return;
   }
@@ -1956,8 +2135,7 @@ void DepsgraphRelationBuilder::build_object_data_geometry(Object *object)
    * data mask to be used. We add relation here to ensure object is never
    * evaluated prior to Scene's CoW is ready. */
   OperationKey scene_key(&scene_->id, NodeType::PARAMETERS, OperationCode::SCENE_EVAL);
-  Relation *rel = add_relation(scene_key, obdata_ubereval_key, "CoW Relation");
-  rel->flag |= RELATION_FLAG_NO_FLUSH;
+  add_relation(scene_key, obdata_ubereval_key, "CoW Relation", RELATION_FLAG_NO_FLUSH);
   /* Modifiers */
   if (object->modifiers.first != nullptr) {
     ModifierUpdateDepsgraphContext ctx = {};
@@ -2082,6 +2260,7 @@ void DepsgraphRelationBuilder::build_object_data_geometry(Object *object)
 
 void DepsgraphRelationBuilder::build_object_data_geometry_datablock(ID *obdata)
 {
+  const OwnerScope owner_scope(this, obdata);
   if (built_map_.checkIsBuiltAndTag(obdata)) {
     return;
   }
@@ -2159,6 +2338,7 @@ void DepsgraphRelationBuilder::build_object_data_geometry_datablock(ID *obdata)
 
 void DepsgraphRelationBuilder::build_armature(bArmature *armature)
 {
+  const OwnerScope owner_scope(this, &armature->id);
   if (built_map_.checkIsBuiltAndTag(armature)) {
     return;
   }
@@ -2168,6 +2348,7 @@ void DepsgraphRelationBuilder::build_armature(bArmature *armature)
 
 void DepsgraphRelationBuilder::build_camera(Camera *camera)
 {
+  const OwnerScope owner_scope(this, &camera->id);
   if (built_map_.checkIsBuiltAndTag(camera)) {
     return;
   }
@@ -2184,6 +2365,7 @@ void DepsgraphRelationBuilder::build_camera(Camera *camera)
 /* Lights */
 void DepsgraphRelationBuilder::build_light(Light *lamp)
 {
+  const OwnerScope owner_scope(this, &lamp->id);
   if (built_map_.checkIsBuiltAndTag(lamp)) {
     return;
   }
@@ -2204,6 +2386,7 @@ void DepsgraphRelationBuilder::build_nodetree(bNodeTree *ntree)
   if (ntree == nullptr) {
     return;
   }
+  const OwnerScope owner_scope(this, &ntree->id);
   if (built_map_.checkIsBuiltAndTag(ntree)) {
     return;
   }
@@ -2292,6 +2475,7 @@ void DepsgraphRelationBuilder::build_nodetree(bNodeTree *ntree)
 /* Recursively build graph for material */
 void DepsgraphRelationBuilder::build_material(Material *material)
 {
+  const OwnerScope owner_scope(this, &material->id);
   if (built_map_.checkIsBuiltAndTag(material)) {
     return;
   }
@@ -2322,6 +2506,7 @@ void DepsgraphRelationBuilder::build_materials(Material **materials, int num_mat
 /* Recursively build graph for texture */
 void DepsgraphRelationBuilder::build_texture(Tex *texture)
 {
+  const OwnerScope owner_scope(this, &texture->id);
   if (built_map_.checkIsBuiltAndTag(texture)) {
     return;
   }
@@ -2346,6 +2531,7 @@ void DepsgraphRelationBuilder::build_texture(Tex *texture)
 
 void DepsgraphRelationBuilder::build_image(Image *image)
 {
+  const OwnerScope owner_scope(this, &image->id);
   if (built_map_.checkIsBuiltAndTag(image)) {
     return;
   }
@@ -2354,6 +2540,7 @@ void DepsgraphRelationBuilder::build_image(Image *image)
 
 void DepsgraphRelationBuilder::build_gpencil(bGPdata *gpd)
 {
+  const OwnerScope owner_scope(this, &gpd->id);
   if (built_map_.checkIsBuiltAndTag(gpd)) {
     return;
   }
@@ -2366,6 +2553,7 @@ void DepsgraphRelationBuilder::build_gpencil(bGPdata *gpd)
 
 void DepsgraphRelationBuilder::build_cachefile(CacheFile *cache_file)
 {
+  const OwnerScope owner_scope(this, &cache_file->id);
   if (built_map_.checkIsBuiltAndTag(cache_file)) {
     return;
   }
@@ -2394,6 +2582,7 @@ void DepsgraphRelationBuilder::build_cachefile(CacheFile *cache_file)
 
 void DepsgraphRelationBuilder::build_mask(Mask *mask)
 {
+  const OwnerScope owner_scope(this, &mask->id);
   if (built_map_.checkIsBuiltAndTag(mask)) {
     return;
   }
@@ -2430,6 +2619,7 @@ void DepsgraphRelationBuilder::build_mask(Mask *mask)
 
 void DepsgraphRelationBuilder::build_freestyle_linestyle(FreestyleLineStyle *linestyle)
 {
+  const OwnerScope owner_scope(this, &linestyle->id);
   if (built_map_.checkIsBuiltAndTag(linestyle)) {
     return;
   }
@@ -2442,6 +2632,7 @@ void DepsgraphRelationBuilder::build_freestyle_linestyle(FreestyleLineStyle *lin
 
 void DepsgraphRelationBuilder::build_movieclip(MovieClip *clip)
 {
+  const OwnerScope owner_scope(this, &clip->id);
   if (built_map_.checkIsBuiltAndTag(clip)) {
     return;
   }
@@ -2452,6 +2643,7 @@ void DepsgraphRelationBuilder::build_movieclip(MovieClip *clip)
 
 void DepsgraphRelationBuilder::build_lightprobe(LightProbe *probe)
 {
+  const OwnerScope owner_scope(this, &probe->id);
   if (built_map_.checkIsBuiltAndTag(probe)) {
     return;
   }
@@ -2461,6 +2653,7 @@ void DepsgraphRelationBuilder::build_lightprobe(LightProbe *probe)
 
 void DepsgraphRelationBuilder::build_speaker(Speaker *speaker)
 {
+  const OwnerScope owner_scope(this, &speaker->id);
   if (built_map_.checkIsBuiltAndTag(speaker)) {
     return;
   }
@@ -2476,6 +2669,7 @@ void DepsgraphRelationBuilder::build_speaker(Speaker *speaker)
 
 void DepsgraphRelationBuilder::build_sound(bSound *sound)
 {
+  const OwnerScope owner_scope(this, &sound->id);
   if (built_map_.checkIsBuiltAndTag(sound)) {
     return;
   }
@@ -2579,6 +2773,7 @@ void DepsgraphRelationBuilder::build_nested_shapekey(ID *owner, Key *key)
 void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
 {
   ID *id_orig = id_node->id_orig;
+  const OwnerScope owner_scope(this, id_orig);
   const ID_Type id_type = GS(id_orig->name);
   TimeSourceKey time_source_key;
   OperationKey copy_on_write_key(id_orig, NodeType::COPY_ON_WRITE, OperationCode::COPY_ON_WRITE);
@@ -2628,16 +2823,16 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
      * copy of ID. */
     OperationNode *op_entry = comp_node->get_entry_operation();
     if (op_entry != nullptr) {
-      Relation *rel = graph_->add_new_relation(op_cow, op_entry, "CoW Dependency");
+      Relation *rel = add_operation_relation(op_cow, op_entry, "CoW Dependency");
       rel->flag |= rel_flag;
     }
     /* All dangling operations should also be executed after copy-on-write. */
-    GHASH_FOREACH_BEGIN (OperationNode *, op_node, comp_node->operations_map) {
+    auto add_dangling_relation = [&](OperationNode *op_node) {
       if (op_node == op_entry) {
-        continue;
+        return;
       }
       if (op_node->inlinks.size() == 0) {
-        Relation *rel = graph_->add_new_relation(op_cow, op_node, "CoW Dependency");
+        Relation *rel = add_operation_relation(op_cow, op_node, "CoW Dependency");
         rel->flag |= rel_flag;
       }
       else {
@@ -2653,12 +2848,23 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
           }
         }
         if (!has_same_comp_dependency) {
-          Relation *rel = graph_->add_new_relation(op_cow, op_node, "CoW Dependency");
+          Relation *rel = add_operation_relation(op_cow, op_node, "CoW Dependency");
           rel->flag |= rel_flag;
         }
       }
+    };
+    if (comp_node->operations_map != nullptr) {
+      GHASH_FOREACH_BEGIN (OperationNode *, op_node, comp_node->operations_map) {
+        add_dangling_relation(op_node);
+      }
+      GHASH_FOREACH_END();
+    }
+    else {
+      /* Component was finalized already, it is kept by an incremental build. */
+      for (OperationNode *op_node : comp_node->operations) {
+        add_dangling_relation(op_node);
+      }
     }
-    GHASH_FOREACH_END();
     /* NOTE: We currently ignore implicit relations to an external
      * data-blocks for copy-on-write operations. This means, for example,
      * copy-on-write component of Object will not wait for copy-on-write
@@ -161,6 +161,26 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
 
   void begin_build();
 
+  /* Build relations of the objects of the view layer from multiple threads. */
+  void set_use_threading(bool use_threading);
+
+  /* Relation requested by a builder running in a thread, added to the graph once all the
+   * threads are done. */
+  struct DeferredRelation {
+    Node *node_from;
+    Node *node_to;
+    const char *description;
+    int flags;
+    ID *owner_id;
+  };
+
+  /* Rebuild relations of the given IDs only, relations of the other IDs are kept.
+   *
+   * IDs which nodes are kept are passed as well: all other ID nodes were created by the
+   * incremental nodes builder and get their relations built as well. */
+  void begin_incremental_build(const vector<ID *> &ids, const vector<ID *> &kept_node_ids);
+  void build_incremental(Scene *scene, ViewLayer *view_layer);
+
   template<typename KeyFrom, typename KeyTo>
   Relation *add_relation(const KeyFrom &key_from,
                          const KeyTo &key_to,
@@ -249,6 +269,7 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
   virtual void build_particle_system_visualization_object(Object *object,
                                                           ParticleSystem *psys,
                                                           Object *draw_object);
+  virtual void build_particle_systems_mball_bases(Object *object);
   virtual void build_ik_pose(Object *object,
                              bPoseChannel *pchan,
                              bConstraint *con,
@@ -324,10 +345,20 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
                                    OperationNode *node_to,
                                    const char *description,
                                    int flags = 0);
+  Relation *add_new_relation(Node *node_from, Node *node_to, const char *description, int flags);
 
   template<typename KeyType>
   DepsNodeHandle create_node_handle(const KeyType &key, const char *default_name = "");
 
+  /* Builder which builds relations from a thread: it shares the built map with the parent
+   * builder and records relations instead of adding them to the graph. */
+  DepsgraphRelationBuilder(DepsgraphRelationBuilder *parent,
+                           vector<DeferredRelation> *deferred_relations);
+
+  /* Build relations of the given objects from threads. */
+  void build_objects_threaded(const vector<Base *> &bases);
+  void add_deferred_relations(vector<DeferredRelation> &relations);
+
   /* TODO(sergey): All those is_same* functions are to be generalized. */
 
   /* Check whether two keys corresponds to the same bone from same armature.
@@ -358,8 +389,18 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
   /* State which demotes currently built entities. */
   Scene *scene_;
 
-  BuilderMap built_map_;
+  /* IDs which relations are rebuilt by the incremental build, and IDs which nodes were kept. */
+  set<ID *> incremental_ids_;
+  set<ID *> kept_node_ids_;
+
+  BuilderMap own_built_map_;
+  /* Is shared with the builders which are building relations from threads. */
+  BuilderMap &built_map_;
   RNANodeQuery rna_node_query_;
+
+  bool use_threading_;
+  /* Relations are recorded here rather than added to the graph, when building from a thread. */
+  vector<DeferredRelation> *deferred_relations_;
 };
 
 struct DepsNodeHandle {
@@ -29,6 +29,7 @@ namespace DEG {
 
 void DepsgraphRelationBuilder::build_scene_render(Scene *scene, ViewLayer *view_layer)
 {
+  const OwnerScope owner_scope(this, &scene->id);
   scene_ = scene;
   const bool build_compositor = (scene->r.scemode & R_DOCOMP);
   const bool build_sequencer = (scene->r.scemode & R_DOSEQ);
@@ -49,6 +50,7 @@ void DepsgraphRelationBuilder::build_scene_render(Scene *scene, ViewLayer *view_
 
 void DepsgraphRelationBuilder::build_scene_parameters(Scene *scene)
 {
+  const OwnerScope owner_scope(this, &scene->id);
   if (built_map_.checkIsBuiltAndTag(scene, BuilderMap::TAG_PARAMETERS)) {
     return;
   }
@@ -61,6 +63,7 @@ void DepsgraphRelationBuilder::build_scene_parameters(Scene *scene)
 
 void DepsgraphRelationBuilder::build_scene_compositor(Scene *scene)
 {
+  const OwnerScope owner_scope(this, &scene->id);
   if (built_map_.checkIsBuiltAndTag(scene, BuilderMap::TAG_SCENE_COMPOSITOR)) {
     return;
   }
@@ -33,6 +33,7 @@
 
 #include "BLI_utildefines.h"
 #include "BLI_blenlib.h"
+#include "BLI_task.h"
 
 extern "C" {
 #include "DNA_linestyle_types.h"
@@ -56,10 +57,127 @@ extern "C" {
 #include "intern/node/deg_node_id.h"
 #include "intern/node/deg_node_operation.h"
 
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
 #include "intern/depsgraph_type.h"
 
 namespace DEG {
 
+namespace {
+
+struct BuildObjectsThreadData {
+  const vector<Base *> *bases;
+  /* Builder for every thread, indexed by the thread ID. */
+  vector<DepsgraphRelationBuilder *> *builders;
+};
+
+void build_objects_threaded_func(void *__restrict userdata,
+                                 const int index,
+                                 const TaskParallelTLS *__restrict tls)
+{
+  BuildObjectsThreadData *data = static_cast<BuildObjectsThreadData *>(userdata);
+  Base *base = (*data->bases)[index];
+  (*data->builders)[tls->thread_id]->build_object(base, base->object);
+}
+
+/* Order in which the relations built from threads are added to the graph. It only depends on
+ * the order of the nodes in the graph, so the graph is the same regardless of which thread has
+ * built which relation. */
+struct DeferredRelationCompare {
+  typedef DepsgraphRelationBuilder::DeferredRelation DeferredRelation;
+
+  const unordered_map<const Node *, int> *node_indices;
+  const unordered_map<const ID *, int> *id_indices;
+
+  static int find_index(const unordered_map<const Node *, int> &indices, const Node *node)
+  {
+    unordered_map<const Node *, int>::const_iterator it = indices.find(node);
+    return (it != indices.end()) ? it->second : -1;
+  }
+
+  static int find_index(const unordered_map<const ID *, int> &indices, const ID *id)
+  {
+    unordered_map<const ID *, int>::const_iterator it = indices.find(id);
+    return (it != indices.end()) ? it->second : -1;
+  }
+
+  bool operator()(const DeferredRelation &a, const DeferredRelation &b) const
+  {
+    const int a_to = find_index(*node_indices, a.node_to);
+    const int b_to = find_index(*node_indices, b.node_to);
+    if (a_to != b_to) {
+      return a_to < b_to;
+    }
+    const int a_from = find_index(*node_indices, a.node_from);
+    const int b_from = find_index(*node_indices, b.node_from);
+    if (a_from != b_from) {
+      return a_from < b_from;
+    }
+    const int description_compare = strcmp(a.description, b.description);
+    if (description_compare != 0) {
+      return description_compare < 0;
+    }
+    if (a.flags != b.flags) {
+      return a.flags < b.flags;
+    }
+    return find_index(*id_indices, a.owner_id) < find_index(*id_indices, b.owner_id);
+  }
+};
+
+}  // namespace
+
+void DepsgraphRelationBuilder::build_objects_threaded(const vector<Base *> &bases)
+{
+  /* Builders share the built map, so every object is built by a single thread, and relations
+   * are recorded to be added once all the threads are done. */
+  TaskScheduler *task_scheduler = BLI_task_scheduler_get();
+  const int num_threads = BLI_task_scheduler_num_threads(task_scheduler);
+  vector<vector<DeferredRelation>> thread_relations(num_threads);
+  vector<DepsgraphRelationBuilder *> builders(num_threads);
+  for (int thread_id = 0; thread_id < num_threads; thread_id++) {
+    builders[thread_id] = OBJECT_GUARDED_NEW(
+        DepsgraphRelationBuilder, this, &thread_relations[thread_id]);
+  }
+
+  BuildObjectsThreadData data;
+  data.bases = &bases;
+  data.builders = &builders;
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+  settings.min_iter_per_thread = 8;
+  BLI_task_parallel_range(0, bases.size(), &data, build_objects_threaded_func, &settings);
+
+  vector<DeferredRelation> relations;
+  for (int thread_id = 0; thread_id < num_threads; thread_id++) {
+    OBJECT_GUARDED_DELETE(builders[thread_id], DepsgraphRelationBuilder);
+    relations.insert(
+        relations.end(), thread_relations[thread_id].begin(), thread_relations[thread_id].end());
+  }
+  add_deferred_relations(relations);
+}
+
+void DepsgraphRelationBuilder::add_deferred_relations(vector<DeferredRelation> &relations)
+{
+  unordered_map<const Node *, int> node_indices;
+  node_indices.reserve(graph_->operations.size());
+  for (int i = 0; i < graph_->operations.size(); i++) {
+    node_indices[graph_->operations[i]] = i;
+  }
+  unordered_map<const ID *, int> id_indices;
+  id_indices.reserve(graph_->id_nodes.size());
+  for (int i = 0; i < graph_->id_nodes.size(); i++) {
+    id_indices[graph_->id_nodes[i]->id_orig] = i;
+  }
+  DeferredRelationCompare compare = {&node_indices, &id_indices};
+  std::sort(relations.begin(), relations.end(), compare);
+
+  for (const DeferredRelation &relation : relations) {
+    const OwnerScope owner_scope(this, relation.owner_id);
+    add_new_relation(relation.node_from, relation.node_to, relation.description, relation.flags);
+  }
+}
+
 void DepsgraphRelationBuilder::build_layer_collections(ListBase *lb)
 {
   const int restrict_flag = (graph_->mode == DAG_EVAL_VIEWPORT) ? COLLECTION_RESTRICT_VIEWPORT :
@@ -90,15 +208,27 @@ void DepsgraphRelationBuilder::build_view_layer(Scene *scene,
                                                 ViewLayer *view_layer,
                                                 eDepsNode_LinkedState_Type linked_state)
 {
+  const OwnerScope owner_scope(this, &scene->id);
   /* Setup currently building context. */
   scene_ = scene;
   /* Scene objects. */
   /* NOTE: Nodes builder requires us to pass CoW base because it's being
    * passed to the evaluation functions. During relations builder we only
    * do nullptr-pointer check of the base, so it's fine to pass original one. */
-  LISTBASE_FOREACH (Base *, base, &view_layer->object_bases) {
-    if (need_pull_base_into_graph(base)) {
-      build_object(base, base->object);
+  if (use_threading_) {
+    vector<Base *> bases;
+    LISTBASE_FOREACH (Base *, base, &view_layer->object_bases) {
+      if (need_pull_base_into_graph(base)) {
+        bases.push_back(base);
+      }
+    }
+    build_objects_threaded(bases);
+  }
+  else {
+    LISTBASE_FOREACH (Base *, base, &view_layer->object_bases) {
+      if (need_pull_base_into_graph(base)) {
+        build_object(base, base->object);
+      }
     }
   }
 
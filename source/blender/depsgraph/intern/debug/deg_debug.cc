@@ -35,7 +35,7 @@
 namespace DEG {
 
 DepsgraphDebug::DepsgraphDebug()
-    : flags(G.debug), is_ever_evaluated(false), graph_evaluation_start_time_(0)
+    : flags(G.debug), is_ever_evaluated(false), build_time(), graph_evaluation_start_time_(0)
 {
 }
 
@@ -44,6 +44,11 @@ bool DepsgraphDebug::do_time_debug() const
   return ((G.debug & G_DEBUG_DEPSGRAPH_TIME) != 0);
 }
 
+bool DepsgraphDebug::do_trace() const
+{
+  return ((G.debug & G_DEBUG_DEPSGRAPH_TRACE) != 0);
+}
+
 void DepsgraphDebug::begin_graph_evaluation()
 {
   if (!do_time_debug()) {
@@ -24,6 +24,7 @@
 #pragma once
 
 #include "intern/depsgraph_type.h"
+#include "intern/debug/deg_debug_trace.h"
 #include "intern/debug/deg_time_average.h"
 
 #include "BKE_global.h"
@@ -37,6 +38,7 @@ class DepsgraphDebug {
   DepsgraphDebug();
 
   bool do_time_debug() const;
+  bool do_trace() const;
 
   void begin_graph_evaluation();
   void end_graph_evaluation();
@@ -52,6 +54,16 @@ class DepsgraphDebug {
    * This is NOT an indication that depsgraph is at its evaluated state. */
   bool is_ever_evaluated;
 
+  /* Evaluation timeline, recorded when do_trace() is true. */
+  DepsgraphTrace trace;
+
+  /* Time in seconds spent on the last build or relations update of the graph. */
+  struct {
+    double nodes;
+    double relations;
+    double total;
+  } build_time;
+
  protected:
   /* Maximum number of counters used to calculate frame rate of depsgraph update. */
   static const constexpr int MAX_FPS_COUNTERS = 64;
@@ -0,0 +1,189 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/debug/deg_debug_trace.h"
+
+#include "PIL_time.h"
+
+#include "DEG_depsgraph_debug.h"
+
+#include "intern/depsgraph.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
+
+namespace DEG {
+
+namespace {
+
+string json_escape(const string &str)
+{
+  string result;
+  result.reserve(str.size());
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    }
+    else if ((unsigned char)c < 0x20) {
+      char buffer[8];
+      snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+      result += buffer;
+    }
+    else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+/* Timestamps of the trace events are in microseconds. */
+double trace_timestamp(const double time, const double trace_start_time)
+{
+  return (time - trace_start_time) * 1e6;
+}
+
+}  // namespace
+
+DepsgraphTrace::DepsgraphTrace() : evaluation_start_time_(0.0), trace_start_time_(-1.0)
+{
+}
+
+void DepsgraphTrace::begin_graph_evaluation(const int num_threads)
+{
+  if (thread_records_.size() < num_threads) {
+    thread_records_.resize(num_threads);
+  }
+  evaluation_start_time_ = PIL_check_seconds_timer();
+  if (trace_start_time_ < 0.0) {
+    trace_start_time_ = evaluation_start_time_;
+  }
+}
+
+void DepsgraphTrace::end_graph_evaluation()
+{
+  const double evaluation_end_time = PIL_check_seconds_timer();
+  Event evaluation_event = {-1, 0, evaluation_start_time_, evaluation_end_time};
+  events_.push_back(evaluation_event);
+
+  /* Resolve the names now, the operations might be freed before the trace is written. */
+  for (int thread_id = 0; thread_id < thread_records_.size(); thread_id++) {
+    for (const OperationRecord &record : thread_records_[thread_id]) {
+      Event event = {
+          operation_name_index(record.node), thread_id, record.start_time, record.end_time};
+      events_.push_back(event);
+    }
+    /* Keep the memory for the next evaluation. */
+    thread_records_[thread_id].clear();
+  }
+}
+
+int DepsgraphTrace::operation_name_index(const OperationNode *node)
+{
+  unordered_map<const OperationNode *, int>::const_iterator it = name_index_map_.find(node);
+  if (it != name_index_map_.end()) {
+    return it->second;
+  }
+  const ComponentNode *comp_node = node->owner;
+  OperationName name;
+  name.id = comp_node->owner->name;
+  name.component = nodeTypeAsString(comp_node->type);
+  if (comp_node->type == NodeType::BONE) {
+    name.component += "/" + comp_node->name;
+  }
+  name.operation = node->identifier();
+
+  const int index = names_.size();
+  names_.push_back(name);
+  name_index_map_[node] = index;
+  return index;
+}
+
+void DepsgraphTrace::clear_operations()
+{
+  name_index_map_.clear();
+}
+
+void DepsgraphTrace::clear()
+{
+  events_.clear();
+  names_.clear();
+  name_index_map_.clear();
+  trace_start_time_ = -1.0;
+}
+
+void DepsgraphTrace::write_chrome(FILE *stream) const
+{
+  int max_thread_id = 0;
+  for (const Event &event : events_) {
+    max_thread_id = max(max_thread_id, event.thread_id);
+  }
+
+  fprintf(stream, "{\"traceEvents\":[\n");
+  for (int thread_id = 0; thread_id <= max_thread_id; thread_id++) {
+    fprintf(stream,
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"Thread %d\"}},\n",
+            thread_id,
+            thread_id);
+  }
+  for (const Event &event : events_) {
+    const double timestamp = trace_timestamp(event.start_time, trace_start_time_);
+    const double duration = (event.end_time - event.start_time) * 1e6;
+    if (event.name_index == -1) {
+      fprintf(stream,
+              "{\"name\":\"Depsgraph Evaluation\",\"cat\":\"Depsgraph\",\"ph\":\"X\","
+              "\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},\n",
+              event.thread_id,
+              timestamp,
+              duration);
+      continue;
+    }
+    const OperationName &name = names_[event.name_index];
+    fprintf(stream,
+            "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"id\":\"%s\"}},\n",
+            json_escape(name.operation).c_str(),
+            json_escape(name.component).c_str(),
+            event.thread_id,
+            timestamp,
+            duration,
+            json_escape(name.id).c_str());
+  }
+  /* Trailing commas are not allowed, end with the process name. */
+  fprintf(stream,
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"Depsgraph\"}}\n");
+  fprintf(stream, "],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+}  // namespace DEG
+
+void DEG_debug_trace_chrome(const Depsgraph *graph, FILE *stream)
+{
+  const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+  deg_graph->debug.trace.write_chrome(stream);
+}
+
+void DEG_debug_trace_clear(Depsgraph *graph)
+{
+  DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
+  deg_graph->debug.trace.clear();
+}
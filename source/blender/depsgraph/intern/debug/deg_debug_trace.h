@@ -0,0 +1,98 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include "intern/depsgraph_type.h"
+
+namespace DEG {
+
+struct OperationNode;
+
+/* Timeline of the graph evaluations, with the thread and the start and end time of every
+ * evaluated operation. Recorded when G_DEBUG_DEPSGRAPH_TRACE is enabled and written in the
+ * Chrome trace event format, which can be opened in chrome://tracing. */
+class DepsgraphTrace {
+ public:
+  DepsgraphTrace();
+
+  /* Called before and after graph evaluation, operations are evaluated by threads with an index
+   * lower than num_threads. */
+  void begin_graph_evaluation(const int num_threads);
+  void end_graph_evaluation();
+
+  /* Record an evaluated operation. Every thread only touches its own records, so this is safe
+   * to call from the evaluating threads without any locking. */
+  inline void add_operation(const OperationNode *node,
+                            const int thread_id,
+                            const double start_time,
+                            const double end_time)
+  {
+    OperationRecord record = {node, start_time, end_time};
+    thread_records_[thread_id].push_back(record);
+  }
+
+  /* Must be called before the operation nodes are freed, since their names are cached. */
+  void clear_operations();
+
+  /* Forget all recorded evaluations. */
+  void clear();
+
+  void write_chrome(FILE *stream) const;
+
+ protected:
+  struct OperationRecord {
+    const OperationNode *node;
+    double start_time;
+    double end_time;
+  };
+
+  struct OperationName {
+    string id;
+    string component;
+    string operation;
+  };
+
+  struct Event {
+    /* Index in the operation names, -1 for the whole graph evaluation. */
+    int name_index;
+    int thread_id;
+    double start_time;
+    double end_time;
+  };
+
+  int operation_name_index(const OperationNode *node);
+
+  /* Operations evaluated by each thread during the current graph evaluation. */
+  vector<vector<OperationRecord>> thread_records_;
+
+  vector<Event> events_;
+  vector<OperationName> names_;
+  unordered_map<const OperationNode *, int> name_index_map_;
+
+  /* Start of the current graph evaluation. */
+  double evaluation_start_time_;
+  /* Start of the first recorded graph evaluation, trace timestamps are relative to it. */
+  double trace_start_time_;
+};
+
+}  // namespace DEG
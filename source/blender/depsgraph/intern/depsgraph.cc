@@ -70,6 +70,7 @@ Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluati
     : time_source(nullptr),
       need_update(true),
       need_update_time(false),
+      critical_path_update_countdown(0),
       bmain(bmain),
       scene(scene),
       view_layer(view_layer),
@@ -86,6 +87,7 @@ Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluati
   memset(id_type_updated, 0, sizeof(id_type_updated));
   memset(id_type_exist, 0, sizeof(id_type_exist));
   memset(physics_relations, 0, sizeof(physics_relations));
+  BLI_mutex_init(&physics_relations_mutex);
 }
 
 Depsgraph::~Depsgraph()
@@ -96,6 +98,7 @@ Depsgraph::~Depsgraph()
   if (time_source != nullptr) {
     OBJECT_GUARDED_DELETE(time_source, TimeSourceNode);
   }
+  BLI_mutex_end(&physics_relations_mutex);
   BLI_spin_end(&lock);
 }
 
@@ -238,6 +241,7 @@ void Depsgraph::add_entry_tag(OperationNode *node)
 
 void Depsgraph::clear_all_nodes()
 {
+  debug.trace.clear_operations();
   clear_id_nodes();
   if (time_source != nullptr) {
     OBJECT_GUARDED_DELETE(time_source, TimeSourceNode);
@@ -245,6 +249,42 @@ void Depsgraph::clear_all_nodes()
   }
 }
 
+void Depsgraph::remove_id_nodes(const set<IDNode *> &id_nodes_to_remove)
+{
+  /* Relations between two removed nodes are connected to operations of both of them, collect
+   * them first so they are only freed once. */
+  set<Relation *> relations_to_remove;
+  for (OperationNode *op_node : operations) {
+    if (id_nodes_to_remove.count(op_node->owner->owner) == 0) {
+      continue;
+    }
+    relations_to_remove.insert(op_node->inlinks.begin(), op_node->inlinks.end());
+    relations_to_remove.insert(op_node->outlinks.begin(), op_node->outlinks.end());
+    BLI_gset_remove(entry_tags, op_node, nullptr);
+  }
+  for (Relation *rel : relations_to_remove) {
+    rel->unlink();
+    OBJECT_GUARDED_DELETE(rel, Relation);
+  }
+  operations.erase(std::remove_if(operations.begin(),
+                                  operations.end(),
+                                  [&](OperationNode *op_node) {
+                                    return id_nodes_to_remove.count(op_node->owner->owner) != 0;
+                                  }),
+                   operations.end());
+  id_nodes.erase(std::remove_if(id_nodes.begin(),
+                                id_nodes.end(),
+                                [&](IDNode *id_node) {
+                                  return id_nodes_to_remove.count(id_node) != 0;
+                                }),
+                 id_nodes.end());
+  debug.trace.clear_operations();
+  for (IDNode *id_node : id_nodes_to_remove) {
+    BLI_ghash_remove(id_hash, id_node->id_orig, nullptr, nullptr);
+    OBJECT_GUARDED_DELETE(id_node, IDNode);
+  }
+}
+
 ID *Depsgraph::get_cow_id(const ID *id_orig) const
 {
   IDNode *id_node = find_id_node(id_orig);
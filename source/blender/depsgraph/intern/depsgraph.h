@@ -57,11 +57,29 @@ struct OperationNode;
 struct Relation;
 struct TimeSourceNode;
 
+/* Visibility with which an ID node was requested by its user, see Depsgraph::id_node_users. */
+enum eIDNodeUserFlag {
+  ID_NODE_USER_INVISIBLE = (1 << 0),
+  ID_NODE_USER_VISIBLE = (1 << 1),
+};
+
+/* Evaluation requirements of an ID node requested by relations of another ID. */
+struct IDEvalRequest {
+  IDEvalRequest() : eval_flags(0)
+  {
+  }
+
+  uint32_t eval_flags;
+  DEGCustomDataMeshMasks customdata_masks;
+};
+
 /* Dependency Graph object */
 struct Depsgraph {
   // TODO(sergey): Go away from C++ container and use some native BLI.
   typedef vector<OperationNode *> OperationNodes;
   typedef vector<IDNode *> IDDepsNodes;
+  typedef map<ID *, int> IDNodeUsers;
+  typedef map<ID *, IDEvalRequest> IDEvalRequests;
 
   Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluationMode mode);
   ~Depsgraph();
@@ -88,6 +106,10 @@ struct Depsgraph {
   /* Clear storage used by all nodes. */
   void clear_all_nodes();
 
+  /* Remove given ID nodes together with all relations which are connected to their operations.
+   * Copy-on-write datablocks which are still referenced by the ID nodes are freed as well. */
+  void remove_id_nodes(const set<IDNode *> &id_nodes_to_remove);
+
   /* Copy-on-Write Functionality ........ */
 
   /* For given original ID get ID which is created by CoW system. */
@@ -110,6 +132,19 @@ struct Depsgraph {
   /* Indicates whether relations needs to be updated. */
   bool need_update;
 
+  /* IDs which relations needs to be updated. Only used when need_update is false: relations of
+   * these IDs are rebuilt without building the whole graph again. */
+  set<ID *> need_update_relations_ids;
+
+  /* IDs which requested the ID nodes to be built, with eIDNodeUserFlag of how they requested
+   * them. Indexed by the ID of the node, nullptr user stands for the view layer itself. Allows
+   * the incremental build to find nodes which are not used anymore. */
+  map<ID *, IDNodeUsers> id_node_users;
+
+  /* Evaluation requirements of the ID nodes, indexed by the ID of the node and by the ID which
+   * relations requested them. */
+  map<ID *, IDEvalRequests> id_eval_requests;
+
   /* Indicates which ID types were updated. */
   char id_type_updated[MAX_LIBARRAY];
 
@@ -135,6 +170,10 @@ struct Depsgraph {
    * Mainly used by graph evaluation. */
   SpinLock lock;
 
+  /* Number of evaluations until the critical path time of the operations is updated from their
+   * timing, zero when it is to be updated on the next evaluation. */
+  int critical_path_update_countdown;
+
   /* Main, scene, layer, mode this dependency graph is built for. */
   Main *bmain;
   Scene *scene;
@@ -170,6 +209,8 @@ struct Depsgraph {
   /* Cached list of colliders/effectors for collections and the scene
    * created along with relations, for fast lookup during evaluation. */
   GHash *physics_relations[DEG_PHYSICS_RELATIONS_NUM];
+  /* Guards creation of the physics relations, relations are built from multiple threads. */
+  ThreadMutex physics_relations_mutex;
 };
 
 }  // namespace DEG
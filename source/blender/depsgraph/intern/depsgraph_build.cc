@@ -143,13 +143,8 @@ void DEG_add_object_pointcache_relation(struct DepsNodeHandle *node_handle,
   /* Node deduct point cache component and connect source to it. */
   ID *id = DEG_get_id_from_handle(node_handle);
   DEG::ComponentKey point_cache_key(id, DEG::NodeType::POINT_CACHE);
-  DEG::Relation *rel = relation_builder->add_relation(comp_key, point_cache_key, "Point Cache");
-  if (rel != nullptr) {
-    rel->flag |= DEG::RELATION_FLAG_FLUSH_USER_EDIT_ONLY;
-  }
-  else {
-    fprintf(stderr, "Error in point cache relation from %s to ^%s.\n", object->id.name, id->name);
-  }
+  relation_builder->add_relation(
+      comp_key, point_cache_key, "Point Cache", DEG::RELATION_FLAG_FLUSH_USER_EDIT_ONLY);
 }
 
 void DEG_add_generic_id_relation(struct DepsNodeHandle *node_handle,
@@ -223,6 +218,17 @@ static void graph_build_finalize_common(DEG::Depsgraph *deg_graph, Main *bmain)
 #endif
   /* Relations are up to date. */
   deg_graph->need_update = false;
+  deg_graph->need_update_relations_ids.clear();
+}
+
+static void graph_build_time_store(DEG::Depsgraph *deg_graph,
+                                   const double start_time,
+                                   const double nodes_time,
+                                   const double relations_time)
+{
+  deg_graph->debug.build_time.nodes = nodes_time - start_time;
+  deg_graph->debug.build_time.relations = relations_time - nodes_time;
+  deg_graph->debug.build_time.total = PIL_check_seconds_timer() - start_time;
 }
 
 /* Build depsgraph for the given scene layer, and dump results in given graph container. */
@@ -231,10 +237,7 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
                                      Scene *scene,
                                      ViewLayer *view_layer)
 {
-  double start_time = 0.0;
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    start_time = PIL_check_seconds_timer();
-  }
+  const double start_time = PIL_check_seconds_timer();
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   /* Perform sanity checks. */
   BLI_assert(BLI_findindex(&scene->view_layers, view_layer) != -1);
@@ -246,16 +249,20 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
   node_builder.begin_build();
   node_builder.build_view_layer(scene, view_layer, DEG::DEG_ID_LINKED_DIRECTLY);
   node_builder.end_build();
+  const double nodes_time = PIL_check_seconds_timer();
   /* Hook up relationships between operations - to determine evaluation order. */
   DEG::DepsgraphRelationBuilder relation_builder(bmain, deg_graph, &builder_cache);
   relation_builder.begin_build();
+  relation_builder.set_use_threading(true);
   relation_builder.build_view_layer(scene, view_layer, DEG::DEG_ID_LINKED_DIRECTLY);
   relation_builder.build_copy_on_write_relations();
+  const double relations_time = PIL_check_seconds_timer();
   /* Finalize building. */
   graph_build_finalize_common(deg_graph, bmain);
   /* Finish statistics. */
+  graph_build_time_store(deg_graph, start_time, nodes_time, relations_time);
   if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    printf("Depsgraph built in %f seconds.\n", PIL_check_seconds_timer() - start_time);
+    printf("Depsgraph built in %f seconds.\n", deg_graph->debug.build_time.total);
   }
 }
 
@@ -264,10 +271,7 @@ void DEG_graph_build_for_render_pipeline(Depsgraph *graph,
                                          Scene *scene,
                                          ViewLayer *view_layer)
 {
-  double start_time = 0.0;
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    start_time = PIL_check_seconds_timer();
-  }
+  const double start_time = PIL_check_seconds_timer();
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   /* Perform sanity checks. */
   BLI_assert(deg_graph->scene == scene);
@@ -278,27 +282,27 @@ void DEG_graph_build_for_render_pipeline(Depsgraph *graph,
   node_builder.begin_build();
   node_builder.build_scene_render(scene, view_layer);
   node_builder.end_build();
+  const double nodes_time = PIL_check_seconds_timer();
   /* Hook up relationships between operations - to determine evaluation
    * order. */
   DEG::DepsgraphRelationBuilder relation_builder(bmain, deg_graph, &builder_cache);
   relation_builder.begin_build();
   relation_builder.build_scene_render(scene, view_layer);
   relation_builder.build_copy_on_write_relations();
+  const double relations_time = PIL_check_seconds_timer();
   /* Finalize building. */
   graph_build_finalize_common(deg_graph, bmain);
   /* Finish statistics. */
+  graph_build_time_store(deg_graph, start_time, nodes_time, relations_time);
   if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    printf("Depsgraph built in %f seconds.\n", PIL_check_seconds_timer() - start_time);
+    printf("Depsgraph built in %f seconds.\n", deg_graph->debug.build_time.total);
   }
 }
 
 void DEG_graph_build_for_compositor_preview(
     Depsgraph *graph, Main *bmain, Scene *scene, struct ViewLayer *view_layer, bNodeTree *nodetree)
 {
-  double start_time = 0.0;
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    start_time = PIL_check_seconds_timer();
-  }
+  const double start_time = PIL_check_seconds_timer();
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   /* Perform sanity checks. */
   BLI_assert(deg_graph->scene == scene);
@@ -310,6 +314,7 @@ void DEG_graph_build_for_compositor_preview(
   node_builder.build_scene_render(scene, view_layer);
   node_builder.build_nodetree(nodetree);
   node_builder.end_build();
+  const double nodes_time = PIL_check_seconds_timer();
   /* Hook up relationships between operations - to determine evaluation
    * order. */
   DEG::DepsgraphRelationBuilder relation_builder(bmain, deg_graph, &builder_cache);
@@ -317,11 +322,13 @@ void DEG_graph_build_for_compositor_preview(
   relation_builder.build_scene_render(scene, view_layer);
   relation_builder.build_nodetree(nodetree);
   relation_builder.build_copy_on_write_relations();
+  const double relations_time = PIL_check_seconds_timer();
   /* Finalize building. */
   graph_build_finalize_common(deg_graph, bmain);
   /* Finish statistics. */
+  graph_build_time_store(deg_graph, start_time, nodes_time, relations_time);
   if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    printf("Depsgraph built in %f seconds.\n", PIL_check_seconds_timer() - start_time);
+    printf("Depsgraph built in %f seconds.\n", deg_graph->debug.build_time.total);
   }
 }
 
@@ -431,10 +438,7 @@ void DEG_graph_build_from_ids(Depsgraph *graph,
                               ID **ids,
                               const int num_ids)
 {
-  double start_time = 0.0;
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    start_time = PIL_check_seconds_timer();
-  }
+  const double start_time = PIL_check_seconds_timer();
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   /* Perform sanity checks. */
   BLI_assert(BLI_findindex(&scene->view_layers, view_layer) != -1);
@@ -449,6 +453,7 @@ void DEG_graph_build_from_ids(Depsgraph *graph,
     node_builder.build_id(ids[i]);
   }
   node_builder.end_build();
+  const double nodes_time = PIL_check_seconds_timer();
   /* Hook up relationships between operations - to determine evaluation order. */
   DEG::DepsgraphFromIDsRelationBuilder relation_builder(
       bmain, deg_graph, &builder_cache, ids, num_ids);
@@ -458,11 +463,13 @@ void DEG_graph_build_from_ids(Depsgraph *graph,
     relation_builder.build_id(ids[i]);
   }
   relation_builder.build_copy_on_write_relations();
+  const double relations_time = PIL_check_seconds_timer();
   /* Finalize building. */
   graph_build_finalize_common(deg_graph, bmain);
   /* Finish statistics. */
+  graph_build_time_store(deg_graph, start_time, nodes_time, relations_time);
   if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    printf("Depsgraph built in %f seconds.\n", PIL_check_seconds_timer() - start_time);
+    printf("Depsgraph built in %f seconds.\n", deg_graph->debug.build_time.total);
   }
 }
 
@@ -484,17 +491,99 @@ void DEG_graph_tag_relations_update(Depsgraph *graph)
   }
 }
 
+/* Rebuild nodes and relations of the IDs which were tagged for relations update, keeping the
+ * rest of the graph. Returns false if the graph is to be fully rebuilt instead. */
+static bool graph_build_incremental(DEG::Depsgraph *deg_graph,
+                                    Main *bmain,
+                                    Scene *scene,
+                                    ViewLayer *view_layer)
+{
+  /* Transitive reduction removes relations which are needed when rebuilding parts of the graph,
+   * and there is no graph to update when it was never built. Graphs of the render pipeline are
+   * not built from the view layer. */
+  if (G.debug_value == 799 || deg_graph->id_nodes.empty() ||
+      deg_graph->is_render_pipeline_depsgraph) {
+    return false;
+  }
+  DEG::vector<ID *> node_ids, relation_ids, kept_node_ids;
+  if (!DEG::deg_graph_build_incremental_ids(deg_graph,
+                                            deg_graph->need_update_relations_ids,
+                                            &node_ids,
+                                            &relation_ids,
+                                            &kept_node_ids)) {
+    return false;
+  }
+  if (node_ids.empty()) {
+    /* None of the tagged IDs are in the graph, so they can not affect it. */
+    deg_graph->need_update_relations_ids.clear();
+    return true;
+  }
+  const double start_time = PIL_check_seconds_timer();
+  DEG::DepsgraphBuilderCache builder_cache;
+  /* Rebuild the nodes of the tagged IDs. */
+  DEG::DepsgraphNodeBuilder node_builder(bmain, deg_graph, &builder_cache);
+  node_builder.begin_incremental_build(node_ids);
+  node_builder.build_incremental(scene, view_layer);
+  if (!node_builder.end_incremental_build()) {
+    return false;
+  }
+  /* Remove nodes which were only used by the rebuilt ones. */
+  if (!DEG::deg_graph_remove_unused_id_nodes(deg_graph, &relation_ids, &kept_node_ids)) {
+    return false;
+  }
+  const double nodes_time = PIL_check_seconds_timer();
+  /* Rebuild the relations which were connected to them. */
+  DEG::DepsgraphRelationBuilder relation_builder(bmain, deg_graph, &builder_cache);
+  relation_builder.begin_incremental_build(relation_ids, kept_node_ids);
+  relation_builder.build_incremental(scene, view_layer);
+  /* Cycles are detected again for the whole graph. */
+  for (DEG::OperationNode *op_node : deg_graph->operations) {
+    for (DEG::Relation *rel : op_node->inlinks) {
+      rel->flag &= ~DEG::RELATION_FLAG_CYCLIC;
+    }
+  }
+  const double relations_time = PIL_check_seconds_timer();
+  /* Finalize building. */
+  graph_build_finalize_common(deg_graph, bmain);
+  /* Finish statistics. */
+  graph_build_time_store(deg_graph, start_time, nodes_time, relations_time);
+  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
+    printf("Depsgraph relations of %d IDs updated in %f seconds.\n",
+           (int)node_ids.size(),
+           deg_graph->debug.build_time.total);
+  }
+  return true;
+}
+
 /* Create or update relations in the specified graph. */
 void DEG_graph_relations_update(Depsgraph *graph, Main *bmain, Scene *scene, ViewLayer *view_layer)
 {
   DEG::Depsgraph *deg_graph = (DEG::Depsgraph *)graph;
   if (!deg_graph->need_update) {
-    /* Graph is up to date, nothing to do. */
-    return;
+    if (deg_graph->need_update_relations_ids.empty()) {
+      /* Graph is up to date, nothing to do. */
+      return;
+    }
+    if (graph_build_incremental(deg_graph, bmain, scene, view_layer)) {
+      return;
+    }
   }
   DEG_graph_build_from_view_layer(graph, bmain, scene, view_layer);
 }
 
+/* Tag relations of the given ID for update. */
+void DEG_id_relations_tag_update(Main *bmain, ID *id)
+{
+  DEG_GLOBAL_DEBUG_PRINTF(TAG, "%s: Tagging relations of %s for update.\n", __func__, id->name);
+  for (DEG::Depsgraph *depsgraph : DEG::get_all_registered_graphs(bmain)) {
+    if (depsgraph->need_update) {
+      /* Whole graph is to be rebuilt anyway. */
+      continue;
+    }
+    depsgraph->need_update_relations_ids.insert(id);
+  }
+}
+
 /* Tag all relations for update. */
 void DEG_relations_tag_update(Main *bmain)
 {
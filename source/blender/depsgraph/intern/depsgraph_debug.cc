@@ -247,6 +247,23 @@ void DEG_stats_simple(const Depsgraph *graph,
   }
 }
 
+void DEG_stats_build_time(const Depsgraph *graph,
+                          double *r_nodes_time,
+                          double *r_relations_time,
+                          double *r_total_time)
+{
+  const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+  if (r_nodes_time) {
+    *r_nodes_time = deg_graph->debug.build_time.nodes;
+  }
+  if (r_relations_time) {
+    *r_relations_time = deg_graph->debug.build_time.relations;
+  }
+  if (r_total_time) {
+    *r_total_time = deg_graph->debug.build_time.total;
+  }
+}
+
 static DEG::string depsgraph_name_for_logging(struct Depsgraph *depsgraph)
 {
   const char *name = DEG_debug_name_get(depsgraph);
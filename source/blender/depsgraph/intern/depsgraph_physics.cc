@@ -165,6 +165,7 @@ namespace DEG {
 
 ListBase *build_effector_relations(Depsgraph *graph, Collection *collection)
 {
+  BLI_mutex_lock(&graph->physics_relations_mutex);
   GHash *hash = graph->physics_relations[DEG_PHYSICS_EFFECTOR];
   if (hash == nullptr) {
     graph->physics_relations[DEG_PHYSICS_EFFECTOR] = BLI_ghash_ptr_new(
@@ -177,6 +178,7 @@ ListBase *build_effector_relations(Depsgraph *graph, Collection *collection)
     relations = BKE_effector_relations_create(depsgraph, graph->view_layer, collection);
     BLI_ghash_insert(hash, &collection->id, relations);
   }
+  BLI_mutex_unlock(&graph->physics_relations_mutex);
   return relations;
 }
 
@@ -185,6 +187,7 @@ ListBase *build_collision_relations(Depsgraph *graph,
                                     unsigned int modifier_type)
 {
   const ePhysicsRelationType type = modifier_to_relation_type(modifier_type);
+  BLI_mutex_lock(&graph->physics_relations_mutex);
   GHash *hash = graph->physics_relations[type];
   if (hash == nullptr) {
     graph->physics_relations[type] = BLI_ghash_ptr_new("Depsgraph physics relations hash");
@@ -196,6 +199,7 @@ ListBase *build_collision_relations(Depsgraph *graph,
     relations = BKE_collision_relations_create(depsgraph, collection, modifier_type);
     BLI_ghash_insert(hash, &collection->id, relations);
   }
+  BLI_mutex_unlock(&graph->physics_relations_mutex);
   return relations;
 }
 
@@ -315,7 +315,7 @@ bool DEG_is_fully_evaluated(const struct Depsgraph *depsgraph)
 {
   const DEG::Depsgraph *deg_graph = (const DEG::Depsgraph *)depsgraph;
   /* Check whether relations are up to date. */
-  if (deg_graph->need_update) {
+  if (deg_graph->need_update || !deg_graph->need_update_relations_ids.empty()) {
     return false;
   }
   /* Check whether IDs are up to date. */
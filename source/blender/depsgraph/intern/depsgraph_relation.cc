@@ -37,7 +37,7 @@ template<typename T> static void remove_from_vector(vector<T> *vector, const T &
 }
 
 Relation::Relation(Node *from, Node *to, const char *description)
-    : from(from), to(to), name(description), flag(0)
+    : from(from), to(to), name(description), flag(0), owner_id(nullptr)
 {
   /* Hook it up to the nodes which use it.
    *
@@ -23,6 +23,8 @@
 
 #pragma once
 
+struct ID;
+
 namespace DEG {
 
 struct Node;
@@ -58,6 +60,10 @@ struct Relation {
   /* relationship attributes */
   const char *name; /* label for debugging */
   int flag;         /* Bitmask of RelationFlag) */
+
+  /* ID which relations were being built when the relation was added, nullptr when the relation
+   * was added for several IDs. Allows to rebuild relations of a single ID. */
+  ID *owner_id;
 };
 
 }  // namespace DEG
@@ -656,6 +656,8 @@ void graph_id_tag_update(
    * changes). */
   if (update_source == DEG_UPDATE_SOURCE_USER_EDIT) {
     id->recalc |= deg_recalc_flags_effective(graph, flag);
+    /* Changed IDs can not be kept as-is by memfile undo, whichever graph they are tagged in. */
+    id->recalc_after_undo_push |= (flag != 0) ? flag : deg_recalc_flags_for_legacy_zero();
   }
   int current_flag = flag;
   while (current_flag != 0) {
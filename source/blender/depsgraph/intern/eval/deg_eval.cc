@@ -25,17 +25,17 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include <algorithm>
+
 #include "PIL_time.h"
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_utildefines.h"
 #include "BLI_task.h"
 #include "BLI_ghash.h"
-#include "BLI_gsqueue.h"
 
 #include "BKE_global.h"
 
-#include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 
 #include "DEG_depsgraph.h"
@@ -58,6 +58,12 @@ namespace DEG {
 
 namespace {
 
+/* Time assumed for operations which were not evaluated yet, so that without any timing the
+ * critical path follows the longest chain of operations. */
+#define CRITICAL_PATH_DEFAULT_OPERATION_TIME 1e-6
+/* Number of evaluations between updates of the critical path times. */
+#define CRITICAL_PATH_UPDATE_INTERVAL 8
+
 struct DepsgraphEvalState;
 
 void deg_task_run_func(TaskPool *pool, void *taskdata, int thread_id);
@@ -84,32 +90,77 @@ enum class EvaluationStage {
 
   /* Threaded evaluation of all possible operations. */
   THREADED_EVALUATION,
-
-  /* Workaround for areas which can not be evaluated in threads.
-   *
-   * For example, metaballs, which are iterating over all bases and are requesting dupli-lists
-   * to see whether there are metaballs inside. */
-  SINGLE_THREADED_WORKAROUND,
 };
 
 struct DepsgraphEvalState {
   Depsgraph *graph;
   bool do_stats;
+  /* Time operations, for statistics or to update the critical path. */
+  bool do_timing;
+  /* Record operations in the evaluation timeline, implies timing. */
+  bool do_trace;
   EvaluationStage stage;
-  bool need_single_thread_pass;
 };
 
-void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_node)
+/* Operations which became ready for evaluation after an operation was evaluated. */
+struct ReadyOperations {
+  OperationNode *nodes[64];
+  int num_nodes;
+};
+
+void schedule_node_to_ready_operations(OperationNode *node,
+                                       const int thread_id,
+                                       ReadyOperations *ready_operations,
+                                       TaskPool *pool)
+{
+  if (ready_operations->num_nodes < ARRAY_SIZE(ready_operations->nodes)) {
+    ready_operations->nodes[ready_operations->num_nodes++] = node;
+  }
+  else {
+    schedule_node_to_pool(node, thread_id, pool);
+  }
+}
+
+bool operation_critical_path_compare(const OperationNode *a, const OperationNode *b)
+{
+  return a->critical_path_time > b->critical_path_time;
+}
+
+/* Push operations with the longest critical path first. From a worker thread the first one goes
+ * to the thread's local queue and continues the longest chain on this thread, the next ones are
+ * the first to be stolen by other threads. */
+void schedule_ready_operations_to_pool(OperationNode **nodes,
+                                       const int num_nodes,
+                                       const int thread_id,
+                                       TaskPool *pool)
+{
+  std::sort(nodes, nodes + num_nodes, operation_critical_path_compare);
+  for (int i = 0; i < num_nodes; i++) {
+    schedule_node_to_pool(nodes[i], thread_id, pool);
+  }
+}
+
+void evaluate_node(const DepsgraphEvalState *state,
+                   OperationNode *operation_node,
+                   const int thread_id)
 {
   ::Depsgraph *depsgraph = reinterpret_cast<::Depsgraph *>(state->graph);
 
   /* Sanity checks. */
   BLI_assert(!operation_node->is_noop() && "NOOP nodes should not actually be scheduled");
   /* Perform operation. */
-  if (state->do_stats) {
+  if (state->do_timing) {
     const double start_time = PIL_check_seconds_timer();
     operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
+    const double end_time = PIL_check_seconds_timer();
+    const double time = end_time - start_time;
+    operation_node->stats.add_time_sample(time);
+    if (state->do_stats) {
+      operation_node->stats.current_time += time;
+    }
+    if (state->do_trace) {
+      state->graph->debug.trace.add_operation(operation_node, thread_id, start_time, end_time);
+    }
   }
   else {
     operation_node->evaluate(depsgraph);
@@ -123,11 +174,16 @@ void deg_task_run_func(TaskPool *pool, void *taskdata, int thread_id)
 
   /* Evaluate node. */
   OperationNode *operation_node = reinterpret_cast<OperationNode *>(taskdata);
-  evaluate_node(state, operation_node);
+  evaluate_node(state, operation_node, thread_id);
 
   /* Schedule children. */
   BLI_task_pool_delayed_push_begin(pool, thread_id);
-  schedule_children(state, operation_node, thread_id, schedule_node_to_pool, pool);
+  ReadyOperations ready_operations;
+  ready_operations.num_nodes = 0;
+  schedule_children(
+      state, operation_node, thread_id, schedule_node_to_ready_operations, &ready_operations, pool);
+  schedule_ready_operations_to_pool(
+      ready_operations.nodes, ready_operations.num_nodes, thread_id, pool);
   BLI_task_pool_delayed_push_end(pool, thread_id);
 }
 
@@ -181,10 +237,75 @@ void calculate_pending_parents(Depsgraph *graph)
   }
 }
 
+bool is_critical_path_relation(const Relation *rel)
+{
+  return rel->from->type == NodeType::OPERATION && rel->to->type == NodeType::OPERATION &&
+         (rel->flag & RELATION_FLAG_CYCLIC) == 0;
+}
+
+double operation_time_estimate(const OperationNode *node)
+{
+  if (node->is_noop()) {
+    return 0.0;
+  }
+  if (node->stats.average_time > 0.0) {
+    return node->stats.average_time;
+  }
+  return CRITICAL_PATH_DEFAULT_OPERATION_TIME;
+}
+
+/* Calculate the time needed to evaluate every operation and the longest chain of operations
+ * depending on it. Operations are visited after all operations depending on them, which are
+ * counted using the custom flags. */
+void calculate_critical_path(Depsgraph *graph)
+{
+  vector<OperationNode *> queue;
+  for (OperationNode *node : graph->operations) {
+    node->custom_flags = 0;
+    for (Relation *rel : node->outlinks) {
+      if (is_critical_path_relation(rel)) {
+        node->custom_flags++;
+      }
+    }
+    if (node->custom_flags == 0) {
+      queue.push_back(node);
+    }
+  }
+  while (!queue.empty()) {
+    OperationNode *node = queue.back();
+    queue.pop_back();
+    double children_time = 0.0;
+    for (Relation *rel : node->outlinks) {
+      if (is_critical_path_relation(rel)) {
+        children_time = max(children_time, ((OperationNode *)rel->to)->critical_path_time);
+      }
+    }
+    node->critical_path_time = operation_time_estimate(node) + children_time;
+    for (Relation *rel : node->inlinks) {
+      if (is_critical_path_relation(rel)) {
+        OperationNode *from = (OperationNode *)rel->from;
+        if (--from->custom_flags == 0) {
+          queue.push_back(from);
+        }
+      }
+    }
+  }
+}
+
 void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
 {
   const bool do_stats = state->do_stats;
   calculate_pending_parents(graph);
+  /* Operation timings change slowly, so the critical path is only updated every few evaluations
+   * and after the graph was rebuilt. Timing every operation is not free either, so operations
+   * are only timed in the evaluation before the update, unless statistics or the trace need
+   * them. */
+  if (graph->critical_path_update_countdown == 0) {
+    calculate_critical_path(graph);
+    graph->critical_path_update_countdown = CRITICAL_PATH_UPDATE_INTERVAL;
+  }
+  graph->critical_path_update_countdown--;
+  state->do_timing = do_stats || state->do_trace || graph->critical_path_update_countdown == 0;
   /* Clear tags and other things which needs to be clear. */
   for (OperationNode *node : graph->operations) {
     if (do_stats) {
@@ -193,17 +314,6 @@ void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
   }
 }
 
-bool is_metaball_object_operation(const OperationNode *operation_node)
-{
-  const ComponentNode *component_node = operation_node->owner;
-  const IDNode *id_node = component_node->owner;
-  if (GS(id_node->id_cow->name) != ID_OB) {
-    return false;
-  }
-  const Object *object = reinterpret_cast<const Object *>(id_node->id_cow);
-  return object->type == OB_MBALL;
-}
-
 bool need_evaluate_operation_at_stage(DepsgraphEvalState *state,
                                       const OperationNode *operation_node)
 {
@@ -217,13 +327,6 @@ bool need_evaluate_operation_at_stage(DepsgraphEvalState *state,
        * scheduled flag (we assume that scheduled operations have been actually handled by previous
        * stage). */
       BLI_assert(operation_node->scheduled || component_node->type != NodeType::COPY_ON_WRITE);
-      if (is_metaball_object_operation(operation_node)) {
-        state->need_single_thread_pass = true;
-        return false;
-      }
-      return true;
-
-    case EvaluationStage::SINGLE_THREADED_WORKAROUND:
       return true;
   }
   BLI_assert(!"Unhandled evaluation stage, should never happen.");
@@ -313,27 +416,24 @@ void schedule_children(DepsgraphEvalState *state,
   }
 }
 
-void schedule_node_to_queue(OperationNode *node,
-                            const int /*thread_id*/,
-                            GSQueue *evaluation_queue)
+void schedule_node_to_vector(OperationNode *node,
+                             const int /*thread_id*/,
+                             vector<OperationNode *> *nodes)
 {
-  BLI_gsqueue_push(evaluation_queue, &node);
+  nodes->push_back(node);
 }
 
-void evaluate_graph_single_threaded(DepsgraphEvalState *state)
+void schedule_graph_to_pool(DepsgraphEvalState *state, TaskPool *pool)
 {
-  GSQueue *evaluation_queue = BLI_gsqueue_new(sizeof(OperationNode *));
-  schedule_graph(state, schedule_node_to_queue, evaluation_queue);
-
-  while (!BLI_gsqueue_is_empty(evaluation_queue)) {
-    OperationNode *operation_node;
-    BLI_gsqueue_pop(evaluation_queue, &operation_node);
-
-    evaluate_node(state, operation_node);
-    schedule_children(state, operation_node, 0, schedule_node_to_queue, evaluation_queue);
+  vector<OperationNode *> nodes;
+  schedule_graph(state, schedule_node_to_vector, &nodes);
+  /* Tasks of the suspended pool are given to the scheduler in reverse order, and the ones given
+   * last are stolen by the worker threads first. Push in ascending order, so that the workers
+   * start with the longest chains. */
+  std::sort(nodes.begin(), nodes.end(), operation_critical_path_compare);
+  for (vector<OperationNode *>::reverse_iterator it = nodes.rbegin(); it != nodes.rend(); ++it) {
+    schedule_node_to_pool(*it, -1, pool);
   }
-
-  BLI_gsqueue_free(evaluation_queue);
 }
 
 void depsgraph_ensure_view_layer(Depsgraph *graph)
@@ -374,7 +474,7 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   DepsgraphEvalState state;
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
-  state.need_single_thread_pass = false;
+  state.do_trace = graph->debug.do_trace();
   /* Set up task scheduler and pull for threaded evaluation. */
   TaskScheduler *task_scheduler;
   bool need_free_scheduler;
@@ -386,6 +486,9 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
     task_scheduler = BLI_task_scheduler_get();
     need_free_scheduler = false;
   }
+  if (state.do_trace) {
+    graph->debug.trace.begin_graph_evaluation(BLI_task_scheduler_num_threads(task_scheduler));
+  }
   TaskPool *task_pool = BLI_task_pool_create_suspended(task_scheduler, &state);
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
@@ -394,26 +497,24 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
 
   /* First, process all Copy-On-Write nodes. */
   state.stage = EvaluationStage::COPY_ON_WRITE;
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
+  schedule_graph_to_pool(&state, task_pool);
   BLI_task_pool_work_wait_and_reset(task_pool);
 
   /* After that, process all other nodes. */
   state.stage = EvaluationStage::THREADED_EVALUATION;
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
+  schedule_graph_to_pool(&state, task_pool);
   BLI_task_pool_work_and_wait(task_pool);
   BLI_task_pool_free(task_pool);
 
-  if (state.need_single_thread_pass) {
-    state.stage = EvaluationStage::SINGLE_THREADED_WORKAROUND;
-    evaluate_graph_single_threaded(&state);
-  }
-
   /* Finalize statistics gathering. This is because we only gather single
    * operation timing here, without aggregating anything to avoid any extra
    * synchronization. */
   if (state.do_stats) {
     deg_eval_stats_aggregate(graph);
   }
+  if (state.do_trace) {
+    graph->debug.trace.end_graph_evaluation();
+  }
   /* Clear any uncleared tags - just in case. */
   deg_graph_clear_tags(graph);
   if (need_free_scheduler) {
@@ -270,6 +270,7 @@ Node::Stats::Stats()
 void Node::Stats::reset()
 {
   current_time = 0.0;
+  average_time = 0.0;
 }
 
 void Node::Stats::reset_current()
@@ -277,6 +278,12 @@ void Node::Stats::reset_current()
   current_time = 0.0;
 }
 
+void Node::Stats::add_time_sample(double time)
+{
+  /* Exponential moving average, follows changes of the evaluated data within a few frames. */
+  average_time = (average_time == 0.0) ? time : average_time + (time - average_time) * 0.25;
+}
+
 /*******************************************************************************
  * Node itself.
  */
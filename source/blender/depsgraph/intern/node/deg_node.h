@@ -154,8 +154,12 @@ struct Node {
     /* Reset counters needed for the current graph evaluation, does not
      * touch averaging accumulators. */
     void reset_current();
+    /* Add time spent on an evaluation of this node to the averaged time. */
+    void add_time_sample(double time);
     /* Time spend on this node during current graph evaluation. */
     double current_time;
+    /* Evaluation time averaged over the previous graph evaluations. */
+    double average_time;
   };
   /* Relationships between nodes
    * The reason why all depsgraph nodes are descended from this type (apart
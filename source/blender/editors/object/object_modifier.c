@@ -127,6 +127,30 @@ static void object_force_modifier_bind_simple_options(Depsgraph *depsgraph,
   md_eval->mode = mode;
 }
 
+/* Physics modifiers are used by other objects through the physics relations of the scene, so
+ * adding or removing them needs relations of the whole scene to be updated. */
+static bool object_modifier_type_affects_scene_relations(int type)
+{
+  return ELEM(type,
+              eModifierType_Collision,
+              eModifierType_Surface,
+              eModifierType_DynamicPaint,
+              eModifierType_Fluid,
+              eModifierType_ParticleSystem,
+              eModifierType_Softbody,
+              eModifierType_Cloth);
+}
+
+static void object_modifier_relations_tag_update(Main *bmain, Object *ob, bool affects_scene)
+{
+  if (affects_scene) {
+    DEG_relations_tag_update(bmain);
+  }
+  else {
+    DEG_id_relations_tag_update(bmain, &ob->id);
+  }
+}
+
 /** Add a modifier to given object, including relevant extra processing needed by some physics
  * types (particles, simulations...).
  *
@@ -215,7 +239,8 @@ ModifierData *ED_object_modifier_add(
   }
 
   DEG_id_tag_update(&ob->id, ID_RECALC_GEOMETRY);
-  DEG_relations_tag_update(bmain);
+  object_modifier_relations_tag_update(
+      bmain, ob, object_modifier_type_affects_scene_relations(type));
 
   return new_md;
 }
@@ -342,11 +367,6 @@ static bool object_modifier_remove(Main *bmain,
     if (ob->pd) {
       ob->pd->deflect = 0;
     }
-
-    *r_sort_depsgraph = true;
-  }
-  else if (md->type == eModifierType_Surface) {
-    *r_sort_depsgraph = true;
   }
   else if (md->type == eModifierType_Multires) {
     /* Delete MDisps layer if not used by another multires modifier */
@@ -366,6 +386,10 @@ static bool object_modifier_remove(Main *bmain,
     ob->mode &= ~OB_MODE_PARTICLE_EDIT;
   }
 
+  if (object_modifier_type_affects_scene_relations(md->type)) {
+    *r_sort_depsgraph = true;
+  }
+
   BLI_remlink(&ob->modifiers, md);
   modifier_free(md);
   BKE_object_free_derived_caches(ob);
@@ -386,7 +410,7 @@ bool ED_object_modifier_remove(ReportList *reports, Main *bmain, Object *ob, Mod
   }
 
   DEG_id_tag_update(&ob->id, ID_RECALC_GEOMETRY);
-  DEG_relations_tag_update(bmain);
+  object_modifier_relations_tag_update(bmain, ob, sort_depsgraph);
 
   return 1;
 }
@@ -411,7 +435,7 @@ void ED_object_modifier_clear(Main *bmain, Object *ob)
   }
 
   DEG_id_tag_update(&ob->id, ID_RECALC_GEOMETRY);
-  DEG_relations_tag_update(bmain);
+  object_modifier_relations_tag_update(bmain, ob, sort_depsgraph);
 }
 
 int ED_object_modifier_move_up(ReportList *reports, Object *ob, ModifierData *md)
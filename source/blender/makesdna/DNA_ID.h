@@ -261,6 +261,16 @@ typedef struct ID {
   int us;
   int icon_id;
   int recalc;
+  /**
+   * Recalc flags of user edits since the last memfile undo push, IDs without any can be kept
+   * as-is when undoing (runtime only, cleared when pushing memfile undo steps).
+   */
+  int recalc_after_undo_push;
+  /**
+   * Unique identifier of the ID in the current session, kept on undo (runtime only, reset when
+   * reading from a file).
+   */
+  unsigned int session_uuid;
   char _pad[4];
   IDProperty *properties;
 
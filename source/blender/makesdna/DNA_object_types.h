@@ -183,6 +183,12 @@ typedef struct Object_Runtime {
   /** Runtime grease pencil evaluated data created by modifiers */
   struct bGPDframe *gpencil_evaluated_frames;
 
+  /**
+   * Intermediate results of the modifier stack, kept between evaluations so that only the
+   * modifiers after a change need to be evaluated again (see `mesh_calc_modifiers`).
+   */
+  struct ModifierStackCache *modifier_stack_cache;
+
   unsigned short local_collections_bits;
   short _pad2[3];
 } Object_Runtime;
@@ -244,6 +244,21 @@ static void rna_Depsgraph_debug_stats_gnuplot(Depsgraph *depsgraph,
   fclose(f);
 }
 
+static void rna_Depsgraph_debug_trace_chrome(Depsgraph *depsgraph, const char *filename)
+{
+  FILE *f = fopen(filename, "w");
+  if (f == NULL) {
+    return;
+  }
+  DEG_debug_trace_chrome(depsgraph, f);
+  fclose(f);
+}
+
+static void rna_Depsgraph_debug_trace_clear(Depsgraph *depsgraph)
+{
+  DEG_debug_trace_clear(depsgraph);
+}
+
 static void rna_Depsgraph_debug_tag_update(Depsgraph *depsgraph)
 {
   DEG_graph_tag_relations_update(depsgraph);
@@ -252,13 +267,19 @@ static void rna_Depsgraph_debug_tag_update(Depsgraph *depsgraph)
 static void rna_Depsgraph_debug_stats(Depsgraph *depsgraph, char *result)
 {
   size_t outer, ops, rels;
+  double nodes_time, relations_time, total_time;
   DEG_stats_simple(depsgraph, &outer, &ops, &rels);
+  DEG_stats_build_time(depsgraph, &nodes_time, &relations_time, &total_time);
   BLI_snprintf(result,
                STATS_MAX_SIZE,
-               "Approx %zu Operations, %zu Relations, %zu Outer Nodes",
+               "Approx %zu Operations, %zu Relations, %zu Outer Nodes, "
+               "Built in %.4f seconds (Nodes %.4f, Relations %.4f)",
                ops,
                rels,
-               outer);
+               outer,
+               total_time,
+               nodes_time,
+               relations_time);
 }
 
 static void rna_Depsgraph_update(Depsgraph *depsgraph, Main *bmain, ReportList *reports)
@@ -643,10 +664,22 @@ static void rna_def_depsgraph(BlenderRNA *brna)
                                   "File name where gnuplot script will save the result");
   RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
 
+  func = RNA_def_function(srna, "debug_trace_chrome", "rna_Depsgraph_debug_trace_chrome");
+  RNA_def_function_ui_description(func,
+                                  "Write the evaluation timeline recorded while "
+                                  "bpy.app.debug_depsgraph_trace is enabled, in the Chrome "
+                                  "trace event format");
+  parm = RNA_def_string_file_path(
+      func, "filename", NULL, FILE_MAX, "File Name", "Output path for the trace JSON file");
+  RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+
+  func = RNA_def_function(srna, "debug_trace_clear", "rna_Depsgraph_debug_trace_clear");
+  RNA_def_function_ui_description(func, "Clear the recorded evaluation timeline");
+
   func = RNA_def_function(srna, "debug_tag_update", "rna_Depsgraph_debug_tag_update");
 
   func = RNA_def_function(srna, "debug_stats", "rna_Depsgraph_debug_stats");
-  RNA_def_function_ui_description(func, "Report the number of elements in the Dependency Graph");
+  RNA_def_function_ui_description(func, "Report the number of elements in the Dependency Graph and the time spent building it");
   /* weak!, no way to return dynamic string type */
   parm = RNA_def_string(func, "result", NULL, STATS_MAX_SIZE, "result", "");
   RNA_def_parameter_flags(parm, PROP_THICK_WRAP, 0); /* needed for string return value */
@@ -40,6 +40,7 @@
 #include "BKE_library_query.h"
 #include "BKE_material.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_boolean.h"
 #include "BKE_modifier.h"
 
 #include "MOD_util.h"
@@ -63,6 +64,7 @@ static void initData(ModifierData *md)
 
   bmd->double_threshold = 1e-6f;
   bmd->operation = eBooleanModifierOp_Difference;
+  bmd->solver = eBooleanModifierSolver_Exact;
 }
 
 static bool isDisabled(const struct Scene *UNUSED(scene),
@@ -174,6 +176,29 @@ static Mesh *applyModifier(ModifierData *md, const ModifierEvalContext *ctx, Mes
      * Returning mesh is depended on modifiers operation (sergey) */
     result = get_quick_mesh(object, mesh, other, mesh_other, bmd->operation);
 
+    if (result == NULL && bmd->solver == eBooleanModifierSolver_Exact) {
+      const bool is_flip = (is_negative_m4(object->obmat) != is_negative_m4(other->obmat));
+
+      float imat[4][4];
+      float omat[4][4];
+
+      invert_m4_m4(imat, object->obmat);
+      mul_m4_m4m4(omat, imat, other->obmat);
+
+      const short ob_src_totcol = other->totcol;
+      short *material_remap = BLI_array_alloca(material_remap, ob_src_totcol ? ob_src_totcol : 1);
+      BKE_material_remap_object_calc(ctx->object, other, material_remap);
+
+#ifdef DEBUG_TIME
+      TIMEIT_START(boolean_exact);
+#endif
+      result = BKE_mesh_boolean(
+          mesh, mesh_other, omat, is_flip, material_remap, ob_src_totcol, bmd->operation);
+#ifdef DEBUG_TIME
+      TIMEIT_END(boolean_exact);
+#endif
+    }
+
     if (result == NULL) {
       const bool is_flip = (is_negative_m4(object->obmat) != is_negative_m4(other->obmat));
 
@@ -24,6 +24,7 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -97,6 +98,97 @@ static void updateDepsgraph(ModifierData *md, const ModifierUpdateDepsgraphConte
   }
 }
 
+typedef struct CastUserdata {
+  const CastModifierData *cmd;
+  MDeformVert *dvert;
+  int defgrp_index;
+  bool invert_vgroup;
+  bool has_radius;
+  bool use_ctrl_ob;
+  short flag;
+  short type;
+  float len;
+  float center[3];
+  float mat[4][4], imat[4][4];
+  /* Custom bounding box, for the cuboid projection. */
+  float bb[8][3];
+  float (*vertexCos)[3];
+} CastUserdata;
+
+/* Vertex group influence, 1.0 when no vertex group is used. */
+static float cast_vert_weight(const CastUserdata *data, const int i)
+{
+  if (data->dvert == NULL) {
+    return 1.0f;
+  }
+  const float weight = defvert_find_weight(&data->dvert[i], data->defgrp_index);
+  return data->invert_vgroup ? 1.0f - weight : weight;
+}
+
+static void sphere_do_task(void *__restrict userdata,
+                           const int i,
+                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const CastUserdata *data = userdata;
+  const CastModifierData *cmd = data->cmd;
+  const short flag = data->flag;
+  const float len = data->len;
+  float vec[3], tmp_co[3];
+
+  copy_v3_v3(tmp_co, data->vertexCos[i]);
+  if (data->use_ctrl_ob) {
+    if (flag & MOD_CAST_USE_OB_TRANSFORM) {
+      mul_m4_v3(data->mat, tmp_co);
+    }
+    else {
+      sub_v3_v3(tmp_co, data->center);
+    }
+  }
+
+  copy_v3_v3(vec, tmp_co);
+
+  if (data->type == MOD_CAST_TYPE_CYLINDER) {
+    vec[2] = 0.0f;
+  }
+
+  if (data->has_radius) {
+    if (len_v3(vec) > cmd->radius) {
+      return;
+    }
+  }
+
+  const float weight = cast_vert_weight(data, i);
+  if (weight == 0.0f) {
+    return;
+  }
+
+  const float fac = cmd->fac * weight;
+  const float facm = 1.0f - fac;
+
+  normalize_v3(vec);
+
+  if (flag & MOD_CAST_X) {
+    tmp_co[0] = fac * vec[0] * len + facm * tmp_co[0];
+  }
+  if (flag & MOD_CAST_Y) {
+    tmp_co[1] = fac * vec[1] * len + facm * tmp_co[1];
+  }
+  if (flag & MOD_CAST_Z) {
+    tmp_co[2] = fac * vec[2] * len + facm * tmp_co[2];
+  }
+
+  if (data->use_ctrl_ob) {
+    if (flag & MOD_CAST_USE_OB_TRANSFORM) {
+      mul_m4_v3(data->imat, tmp_co);
+    }
+    else {
+      add_v3_v3(tmp_co, data->center);
+    }
+  }
+
+  copy_v3_v3(data->vertexCos[i], tmp_co);
+}
+
 static void sphere_do(CastModifierData *cmd,
                       const ModifierEvalContext *UNUSED(ctx),
                       Object *ob,
@@ -104,42 +196,36 @@ static void sphere_do(CastModifierData *cmd,
                       float (*vertexCos)[3],
                       int numVerts)
 {
-  MDeformVert *dvert = NULL;
-  const bool invert_vgroup = (cmd->flag & MOD_CAST_INVERT_VGROUP) != 0;
-
+  CastUserdata data = {
+      .cmd = cmd,
+      .invert_vgroup = (cmd->flag & MOD_CAST_INVERT_VGROUP) != 0,
+      .flag = cmd->flag,
+      .type = cmd->type, /* projection type: sphere or cylinder */
+      .vertexCos = vertexCos,
+  };
   Object *ctrl_ob = NULL;
-
-  int i, defgrp_index;
-  bool has_radius = false;
-  short flag, type;
   float len = 0.0f;
-  float fac = cmd->fac;
-  float facm = 1.0f - fac;
-  const float fac_orig = fac;
-  float vec[3], center[3] = {0.0f, 0.0f, 0.0f};
-  float mat[4][4], imat[4][4];
+  int i;
 
-  flag = cmd->flag;
-  type = cmd->type; /* projection type: sphere or cylinder */
-
-  if (type == MOD_CAST_TYPE_CYLINDER) {
-    flag &= ~MOD_CAST_Z;
+  if (data.type == MOD_CAST_TYPE_CYLINDER) {
+    data.flag &= ~MOD_CAST_Z;
   }
 
   ctrl_ob = cmd->object;
+  data.use_ctrl_ob = (ctrl_ob != NULL);
 
   /* spherify's center is {0, 0, 0} (the ob's own center in its local
    * space), by default, but if the user defined a control object,
    * we use its location, transformed to ob's local space */
   if (ctrl_ob) {
-    if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-      invert_m4_m4(imat, ctrl_ob->obmat);
-      mul_m4_m4m4(mat, imat, ob->obmat);
-      invert_m4_m4(imat, mat);
+    if (data.flag & MOD_CAST_USE_OB_TRANSFORM) {
+      invert_m4_m4(data.imat, ctrl_ob->obmat);
+      mul_m4_m4m4(data.mat, data.imat, ob->obmat);
+      invert_m4_m4(data.imat, data.mat);
     }
 
     invert_m4_m4(ob->imat, ob->obmat);
-    mul_v3_m4v3(center, ob->imat, ctrl_ob->obmat[3]);
+    mul_v3_m4v3(data.center, ob->imat, ctrl_ob->obmat[3]);
   }
 
   /* now we check which options the user wants */
@@ -148,14 +234,14 @@ static void sphere_do(CastModifierData *cmd,
   /* 2) cmd->radius > 0.0f: only the vertices within this radius from
    * the center of the effect should be deformed */
   if (cmd->radius > FLT_EPSILON) {
-    has_radius = 1;
+    data.has_radius = true;
   }
 
   /* 3) if we were given a vertex group name,
    * only those vertices should be affected */
-  MOD_get_vgroup(ob, mesh, cmd->defgrp_name, &dvert, &defgrp_index);
+  MOD_get_vgroup(ob, mesh, cmd->defgrp_name, &data.dvert, &data.defgrp_index);
 
-  if (flag & MOD_CAST_SIZE_FROM_RADIUS) {
+  if (data.flag & MOD_CAST_SIZE_FROM_RADIUS) {
     len = cmd->radius;
   }
   else {
@@ -164,7 +250,7 @@ static void sphere_do(CastModifierData *cmd,
 
   if (len <= 0) {
     for (i = 0; i < numVerts; i++) {
-      len += len_v3v3(center, vertexCos[i]);
+      len += len_v3v3(data.center, vertexCos[i]);
     }
     len /= numVerts;
 
@@ -172,67 +258,121 @@ static void sphere_do(CastModifierData *cmd,
       len = 10.0f;
     }
   }
+  data.len = len;
 
-  for (i = 0; i < numVerts; i++) {
-    float tmp_co[3];
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (numVerts > 512);
+  BLI_task_parallel_range(0, numVerts, &data, sphere_do_task, &settings);
+}
 
-    copy_v3_v3(tmp_co, vertexCos[i]);
-    if (ctrl_ob) {
-      if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-        mul_m4_v3(mat, tmp_co);
-      }
-      else {
-        sub_v3_v3(tmp_co, center);
-      }
+static void cuboid_do_task(void *__restrict userdata,
+                           const int i,
+                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const CastUserdata *data = userdata;
+  const CastModifierData *cmd = data->cmd;
+  const short flag = data->flag;
+  int octant, coord;
+  float d[3], dmax, apex[3], fbb;
+  float tmp_co[3];
+
+  copy_v3_v3(tmp_co, data->vertexCos[i]);
+  if (data->use_ctrl_ob) {
+    if (flag & MOD_CAST_USE_OB_TRANSFORM) {
+      mul_m4_v3(data->mat, tmp_co);
     }
-
-    copy_v3_v3(vec, tmp_co);
-
-    if (type == MOD_CAST_TYPE_CYLINDER) {
-      vec[2] = 0.0f;
+    else {
+      sub_v3_v3(tmp_co, data->center);
     }
+  }
 
-    if (has_radius) {
-      if (len_v3(vec) > cmd->radius) {
-        continue;
-      }
+  if (data->has_radius) {
+    if (fabsf(tmp_co[0]) > cmd->radius || fabsf(tmp_co[1]) > cmd->radius ||
+        fabsf(tmp_co[2]) > cmd->radius) {
+      return;
     }
+  }
 
-    if (dvert) {
-      const float weight = invert_vgroup ? 1.0f - defvert_find_weight(&dvert[i], defgrp_index) :
-                                           defvert_find_weight(&dvert[i], defgrp_index);
+  const float weight = cast_vert_weight(data, i);
+  if (weight == 0.0f) {
+    return;
+  }
 
-      if (weight == 0.0f) {
-        continue;
-      }
+  const float fac = cmd->fac * weight;
+  const float facm = 1.0f - fac;
+
+  /* The algo used to project the vertices to their
+   * bounding box (bb) is pretty simple:
+   * for each vertex v:
+   * 1) find in which octant v is in;
+   * 2) find which outer "wall" of that octant is closer to v;
+   * 3) calculate factor (var fbb) to project v to that wall;
+   * 4) project. */
+
+  /* find in which octant this vertex is in */
+  octant = 0;
+  if (tmp_co[0] > 0.0f) {
+    octant += 1;
+  }
+  if (tmp_co[1] > 0.0f) {
+    octant += 2;
+  }
+  if (tmp_co[2] > 0.0f) {
+    octant += 4;
+  }
 
-      fac = fac_orig * weight;
-      facm = 1.0f - fac;
-    }
+  /* apex is the bb's vertex at the chosen octant */
+  copy_v3_v3(apex, data->bb[octant]);
 
-    normalize_v3(vec);
+  /* find which bb plane is closest to this vertex ... */
+  d[0] = tmp_co[0] / apex[0];
+  d[1] = tmp_co[1] / apex[1];
+  d[2] = tmp_co[2] / apex[2];
 
-    if (flag & MOD_CAST_X) {
-      tmp_co[0] = fac * vec[0] * len + facm * tmp_co[0];
-    }
-    if (flag & MOD_CAST_Y) {
-      tmp_co[1] = fac * vec[1] * len + facm * tmp_co[1];
-    }
-    if (flag & MOD_CAST_Z) {
-      tmp_co[2] = fac * vec[2] * len + facm * tmp_co[2];
-    }
+  /* ... (the closest has the higher (closer to 1) d value) */
+  dmax = d[0];
+  coord = 0;
+  if (d[1] > dmax) {
+    dmax = d[1];
+    coord = 1;
+  }
+  if (d[2] > dmax) {
+    /* dmax = d[2]; */ /* commented, we don't need it */
+    coord = 2;
+  }
 
-    if (ctrl_ob) {
-      if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-        mul_m4_v3(imat, tmp_co);
-      }
-      else {
-        add_v3_v3(tmp_co, center);
-      }
-    }
+  /* ok, now we know which coordinate of the vertex to use */
+
+  if (fabsf(tmp_co[coord]) < FLT_EPSILON) { /* avoid division by zero */
+    return;
+  }
+
+  /* finally, this is the factor we wanted, to project the vertex
+   * to its bounding box (bb) */
+  fbb = apex[coord] / tmp_co[coord];
 
-    copy_v3_v3(vertexCos[i], tmp_co);
+  /* calculate the new vertex position */
+  if (flag & MOD_CAST_X) {
+    tmp_co[0] = facm * tmp_co[0] + fac * tmp_co[0] * fbb;
+  }
+  if (flag & MOD_CAST_Y) {
+    tmp_co[1] = facm * tmp_co[1] + fac * tmp_co[1] * fbb;
+  }
+  if (flag & MOD_CAST_Z) {
+    tmp_co[2] = facm * tmp_co[2] + fac * tmp_co[2] * fbb;
   }
+
+  if (data->use_ctrl_ob) {
+    if (flag & MOD_CAST_USE_OB_TRANSFORM) {
+      mul_m4_v3(data->imat, tmp_co);
+    }
+    else {
+      add_v3_v3(tmp_co, data->center);
+    }
+  }
+
+  copy_v3_v3(data->vertexCos[i], tmp_co);
 }
 
 static void cuboid_do(CastModifierData *cmd,
@@ -242,24 +382,21 @@ static void cuboid_do(CastModifierData *cmd,
                       float (*vertexCos)[3],
                       int numVerts)
 {
-  MDeformVert *dvert = NULL;
-  const bool invert_vgroup = (cmd->flag & MOD_CAST_INVERT_VGROUP) != 0;
-
+  CastUserdata data = {
+      .cmd = cmd,
+      .invert_vgroup = (cmd->flag & MOD_CAST_INVERT_VGROUP) != 0,
+      .flag = cmd->flag,
+      .type = cmd->type,
+      .vertexCos = vertexCos,
+  };
   Object *ctrl_ob = NULL;
-
-  int i, defgrp_index;
-  bool has_radius = false;
-  short flag;
-  float fac = cmd->fac;
-  float facm = 1.0f - fac;
-  const float fac_orig = fac;
-  float min[3], max[3], bb[8][3];
-  float center[3] = {0.0f, 0.0f, 0.0f};
-  float mat[4][4], imat[4][4];
-
-  flag = cmd->flag;
+  float(*bb)[3] = data.bb;
+  float *center = data.center;
+  float min[3], max[3];
+  int i;
 
   ctrl_ob = cmd->object;
+  data.use_ctrl_ob = (ctrl_ob != NULL);
 
   /* now we check which options the user wants */
 
@@ -267,31 +404,31 @@ static void cuboid_do(CastModifierData *cmd,
   /* 2) cmd->radius > 0.0f: only the vertices within this radius from
    * the center of the effect should be deformed */
   if (cmd->radius > FLT_EPSILON) {
-    has_radius = 1;
+    data.has_radius = true;
   }
 
   /* 3) if we were given a vertex group name,
    * only those vertices should be affected */
-  MOD_get_vgroup(ob, mesh, cmd->defgrp_name, &dvert, &defgrp_index);
+  MOD_get_vgroup(ob, mesh, cmd->defgrp_name, &data.dvert, &data.defgrp_index);
 
   if (ctrl_ob) {
-    if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-      invert_m4_m4(imat, ctrl_ob->obmat);
-      mul_m4_m4m4(mat, imat, ob->obmat);
-      invert_m4_m4(imat, mat);
+    if (data.flag & MOD_CAST_USE_OB_TRANSFORM) {
+      invert_m4_m4(data.imat, ctrl_ob->obmat);
+      mul_m4_m4m4(data.mat, data.imat, ob->obmat);
+      invert_m4_m4(data.imat, data.mat);
     }
 
     invert_m4_m4(ob->imat, ob->obmat);
     mul_v3_m4v3(center, ob->imat, ctrl_ob->obmat[3]);
   }
 
-  if ((flag & MOD_CAST_SIZE_FROM_RADIUS) && has_radius) {
+  if ((data.flag & MOD_CAST_SIZE_FROM_RADIUS) && data.has_radius) {
     for (i = 0; i < 3; i++) {
       min[i] = -cmd->radius;
       max[i] = cmd->radius;
     }
   }
-  else if (!(flag & MOD_CAST_SIZE_FROM_RADIUS) && cmd->size > 0) {
+  else if (!(data.flag & MOD_CAST_SIZE_FROM_RADIUS) && cmd->size > 0) {
     for (i = 0; i < 3; i++) {
       min[i] = -cmd->size;
       max[i] = cmd->size;
@@ -346,113 +483,11 @@ static void cuboid_do(CastModifierData *cmd,
   bb[0][2] = bb[1][2] = bb[2][2] = bb[3][2] = min[2];
   bb[4][2] = bb[5][2] = bb[6][2] = bb[7][2] = max[2];
 
-  /* ready to apply the effect, one vertex at a time */
-  for (i = 0; i < numVerts; i++) {
-    int octant, coord;
-    float d[3], dmax, apex[3], fbb;
-    float tmp_co[3];
-
-    copy_v3_v3(tmp_co, vertexCos[i]);
-    if (ctrl_ob) {
-      if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-        mul_m4_v3(mat, tmp_co);
-      }
-      else {
-        sub_v3_v3(tmp_co, center);
-      }
-    }
-
-    if (has_radius) {
-      if (fabsf(tmp_co[0]) > cmd->radius || fabsf(tmp_co[1]) > cmd->radius ||
-          fabsf(tmp_co[2]) > cmd->radius) {
-        continue;
-      }
-    }
-
-    if (dvert) {
-      const float weight = invert_vgroup ? 1.0f - defvert_find_weight(&dvert[i], defgrp_index) :
-                                           defvert_find_weight(&dvert[i], defgrp_index);
-
-      if (weight == 0.0f) {
-        continue;
-      }
-
-      fac = fac_orig * weight;
-      facm = 1.0f - fac;
-    }
-
-    /* The algo used to project the vertices to their
-     * bounding box (bb) is pretty simple:
-     * for each vertex v:
-     * 1) find in which octant v is in;
-     * 2) find which outer "wall" of that octant is closer to v;
-     * 3) calculate factor (var fbb) to project v to that wall;
-     * 4) project. */
-
-    /* find in which octant this vertex is in */
-    octant = 0;
-    if (tmp_co[0] > 0.0f) {
-      octant += 1;
-    }
-    if (tmp_co[1] > 0.0f) {
-      octant += 2;
-    }
-    if (tmp_co[2] > 0.0f) {
-      octant += 4;
-    }
-
-    /* apex is the bb's vertex at the chosen octant */
-    copy_v3_v3(apex, bb[octant]);
-
-    /* find which bb plane is closest to this vertex ... */
-    d[0] = tmp_co[0] / apex[0];
-    d[1] = tmp_co[1] / apex[1];
-    d[2] = tmp_co[2] / apex[2];
-
-    /* ... (the closest has the higher (closer to 1) d value) */
-    dmax = d[0];
-    coord = 0;
-    if (d[1] > dmax) {
-      dmax = d[1];
-      coord = 1;
-    }
-    if (d[2] > dmax) {
-      /* dmax = d[2]; */ /* commented, we don't need it */
-      coord = 2;
-    }
-
-    /* ok, now we know which coordinate of the vertex to use */
-
-    if (fabsf(tmp_co[coord]) < FLT_EPSILON) { /* avoid division by zero */
-      continue;
-    }
-
-    /* finally, this is the factor we wanted, to project the vertex
-     * to its bounding box (bb) */
-    fbb = apex[coord] / tmp_co[coord];
-
-    /* calculate the new vertex position */
-    if (flag & MOD_CAST_X) {
-      tmp_co[0] = facm * tmp_co[0] + fac * tmp_co[0] * fbb;
-    }
-    if (flag & MOD_CAST_Y) {
-      tmp_co[1] = facm * tmp_co[1] + fac * tmp_co[1] * fbb;
-    }
-    if (flag & MOD_CAST_Z) {
-      tmp_co[2] = facm * tmp_co[2] + fac * tmp_co[2] * fbb;
-    }
-
-    if (ctrl_ob) {
-      if (flag & MOD_CAST_USE_OB_TRANSFORM) {
-        mul_m4_v3(imat, tmp_co);
-      }
-      else {
-        add_v3_v3(tmp_co, center);
-      }
-    }
-
-    copy_v3_v3(vertexCos[i], tmp_co);
-  }
+  /* ready to apply the effect, the vertices are independent of each other */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (numVerts > 512);
+  BLI_task_parallel_range(0, numVerts, &data, cuboid_do_task, &settings);
 }
 
 static void deformVerts(ModifierData *md,
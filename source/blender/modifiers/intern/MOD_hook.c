@@ -23,7 +23,9 @@
 
 #include "BLI_utildefines.h"
 
+#include "BLI_bitmap.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -126,6 +128,11 @@ static void updateDepsgraph(ModifierData *md, const ModifierUpdateDepsgraphConte
 struct HookData_cb {
   float (*vertexCos)[3];
 
+  /* Only used when mapping the hook indices through #CD_ORIGINDEX. */
+  const int *origindex_ar;
+  const BLI_bitmap *indexar_map;
+  int indexar_map_len;
+
   MDeformVert *dvert;
   int defgrp_index;
 
@@ -247,6 +254,22 @@ static void hook_co_apply(struct HookData_cb *hd, const int j)
   }
 }
 
+static void hook_co_apply_task(void *__restrict userdata,
+                               const int j,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  struct HookData_cb *hd = userdata;
+
+  if (hd->origindex_ar) {
+    const int index = hd->origindex_ar[j];
+    if (!IN_RANGE_INCL(index, 0, hd->indexar_map_len - 1) ||
+        !BLI_BITMAP_TEST(hd->indexar_map, index)) {
+      return;
+    }
+  }
+  hook_co_apply(hd, j);
+}
+
 static void deformVerts_do(HookModifierData *hmd,
                            const ModifierEvalContext *UNUSED(ctx),
                            Object *ob,
@@ -313,6 +336,14 @@ static void deformVerts_do(HookModifierData *hmd,
    * not correct them on exit editmode. - zr
    */
 
+  hd.origindex_ar = NULL;
+  hd.indexar_map = NULL;
+  hd.indexar_map_len = 0;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (numVerts > 512);
+
   if (hmd->force == 0.0f) {
     /* do nothing, avoid annoying checks in the loop */
   }
@@ -321,17 +352,20 @@ static void deformVerts_do(HookModifierData *hmd,
 
     /* if mesh is present and has original index data, use it */
     if (mesh && (origindex_ar = CustomData_get_layer(&mesh->vdata, CD_ORIGINDEX))) {
+      /* Look up the hooked indices per vertex, instead of searching all vertices per index. */
+      BLI_bitmap *indexar_map = BLI_BITMAP_NEW(numVerts, __func__);
       for (i = 0, index_pt = hmd->indexar; i < hmd->totindex; i++, index_pt++) {
-        if (*index_pt < numVerts) {
-          int j;
-
-          for (j = 0; j < numVerts; j++) {
-            if (origindex_ar[j] == *index_pt) {
-              hook_co_apply(&hd, j);
-            }
-          }
+        if (*index_pt >= 0 && *index_pt < numVerts) {
+          BLI_BITMAP_ENABLE(indexar_map, *index_pt);
         }
       }
+
+      hd.origindex_ar = origindex_ar;
+      hd.indexar_map = indexar_map;
+      hd.indexar_map_len = numVerts;
+      BLI_task_parallel_range(0, numVerts, &hd, hook_co_apply_task, &settings);
+
+      MEM_freeN(indexar_map);
     }
     else { /* missing mesh or ORIGINDEX */
       for (i = 0, index_pt = hmd->indexar; i < hmd->totindex; i++, index_pt++) {
@@ -342,9 +376,7 @@ static void deformVerts_do(HookModifierData *hmd,
     }
   }
   else if (hd.dvert) { /* vertex group hook */
-    for (i = 0; i < numVerts; i++) {
-      hook_co_apply(&hd, i);
-    }
+    BLI_task_parallel_range(0, numVerts, &hd, hook_co_apply_task, &settings);
   }
 }
 
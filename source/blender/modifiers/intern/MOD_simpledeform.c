@@ -24,6 +24,7 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -191,6 +192,79 @@ static void simpleDeform_bend(const float factor,
 }
 
 /* simple deform modifier */
+typedef struct SimpleDeformUserdata {
+  void (*simpleDeform_callback)(const float factor,
+                                const int axis,
+                                const float dcut[3],
+                                float co[3]);
+  const SpaceTransform *transf;
+  MDeformVert *dvert;
+  int vgroup;
+  bool invert_vgroup;
+  int lock_axis;
+  int deform_axis;
+  int limit_axis;
+  const uint *axis_map;
+  float smd_factor;
+  float smd_limit[2];
+  float (*vertexCos)[3];
+} SimpleDeformUserdata;
+
+static void SimpleDeformModifier_do_task(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SimpleDeformUserdata *data = userdata;
+  const float base_limit[2] = {0.0f, 0.0f};
+  const SpaceTransform *transf = data->transf;
+  const int lock_axis = data->lock_axis;
+  const uint *axis_map = data->axis_map;
+  float *vco = data->vertexCos[i];
+  float weight = defvert_array_find_weight_safe(data->dvert, i, data->vgroup);
+
+  if (data->invert_vgroup) {
+    weight = 1.0f - weight;
+  }
+
+  if (weight != 0.0f) {
+    float co[3], dcut[3] = {0.0f, 0.0f, 0.0f};
+
+    if (transf) {
+      BLI_space_transform_apply(transf, vco);
+    }
+
+    copy_v3_v3(co, vco);
+
+    /* Apply axis limits, and axis mappings */
+    if (lock_axis & MOD_SIMPLEDEFORM_LOCK_AXIS_X) {
+      axis_limit(0, base_limit, co, dcut);
+    }
+    if (lock_axis & MOD_SIMPLEDEFORM_LOCK_AXIS_Y) {
+      axis_limit(1, base_limit, co, dcut);
+    }
+    if (lock_axis & MOD_SIMPLEDEFORM_LOCK_AXIS_Z) {
+      axis_limit(2, base_limit, co, dcut);
+    }
+    axis_limit(data->limit_axis, data->smd_limit, co, dcut);
+
+    /* apply the deform to a mapped copy of the vertex, and then re-map it back. */
+    float co_remap[3];
+    float dcut_remap[3];
+    copy_v3_v3_map(co_remap, co, axis_map);
+    copy_v3_v3_map(dcut_remap, dcut, axis_map);
+    /* apply deform */
+    data->simpleDeform_callback(data->smd_factor, data->deform_axis, dcut_remap, co_remap);
+    copy_v3_v3_unmap(co, co_remap, axis_map);
+
+    /* Use vertex weight has coef of linear interpolation */
+    interp_v3_v3v3(vco, vco, co, weight);
+
+    if (transf) {
+      BLI_space_transform_invert(transf, vco);
+    }
+  }
+}
+
 static void SimpleDeformModifier_do(SimpleDeformModifierData *smd,
                                     const ModifierEvalContext *UNUSED(ctx),
                                     struct Object *ob,
@@ -198,7 +272,6 @@ static void SimpleDeformModifier_do(SimpleDeformModifierData *smd,
                                     float (*vertexCos)[3],
                                     int numVerts)
 {
-  const float base_limit[2] = {0.0f, 0.0f};
   int i;
   float smd_limit[2], smd_factor;
   SpaceTransform *transf = NULL, tmp_transf;
@@ -315,50 +388,25 @@ static void SimpleDeformModifier_do(SimpleDeformModifierData *smd,
   const uint *axis_map =
       axis_map_table[(smd->mode != MOD_SIMPLEDEFORM_MODE_BEND) ? deform_axis : 2];
 
-  for (i = 0; i < numVerts; i++) {
-    float weight = defvert_array_find_weight_safe(dvert, i, vgroup);
-
-    if (invert_vgroup) {
-      weight = 1.0f - weight;
-    }
-
-    if (weight != 0.0f) {
-      float co[3], dcut[3] = {0.0f, 0.0f, 0.0f};
-
-      if (transf) {
-        BLI_space_transform_apply(transf, vertexCos[i]);
-      }
-
-      copy_v3_v3(co, vertexCos[i]);
-
-      /* Apply axis limits, and axis mappings */
-      if (lock_axis & MOD_SIMPLEDEFORM_LOCK_AXIS_X) {
-        axis_limit(0, base_limit, co, dcut);
-      }
-      if (lock_axis & MOD_SIMPLEDEFORM_LOCK_AXIS_Y) {
-        axis_limit(1, base_limit, co, dcut);
-      }
-      if (lock_axis & MOD_SIMPLEDEFORM_LOCK_AXIS_Z) {
-        axis_limit(2, base_limit, co, dcut);
-      }
-      axis_limit(limit_axis, smd_limit, co, dcut);
-
-      /* apply the deform to a mapped copy of the vertex, and then re-map it back. */
-      float co_remap[3];
-      float dcut_remap[3];
-      copy_v3_v3_map(co_remap, co, axis_map);
-      copy_v3_v3_map(dcut_remap, dcut, axis_map);
-      simpleDeform_callback(smd_factor, deform_axis, dcut_remap, co_remap); /* apply deform */
-      copy_v3_v3_unmap(co, co_remap, axis_map);
-
-      /* Use vertex weight has coef of linear interpolation */
-      interp_v3_v3v3(vertexCos[i], vertexCos[i], co, weight);
-
-      if (transf) {
-        BLI_space_transform_invert(transf, vertexCos[i]);
-      }
-    }
-  }
+  SimpleDeformUserdata data = {
+      .simpleDeform_callback = simpleDeform_callback,
+      .transf = transf,
+      .dvert = dvert,
+      .vgroup = vgroup,
+      .invert_vgroup = invert_vgroup,
+      .lock_axis = lock_axis,
+      .deform_axis = deform_axis,
+      .limit_axis = limit_axis,
+      .axis_map = axis_map,
+      .smd_factor = smd_factor,
+      .smd_limit = {smd_limit[0], smd_limit[1]},
+      .vertexCos = vertexCos,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (numVerts > 512);
+  BLI_task_parallel_range(0, numVerts, &data, SimpleDeformModifier_do_task, &settings);
 }
 
 /* SimpleDeform */
@@ -26,6 +26,7 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -77,6 +78,51 @@ static void requiredDataMask(Object *UNUSED(ob),
   }
 }
 
+typedef struct SmoothUserdata {
+  MDeformVert *dvert;
+  int defgrp_index;
+  short flag;
+  float fac_new;
+  float (*vertexCos)[3];
+  float (*accumulated_vecs)[3];
+  const uint *num_accumulated_vecs;
+} SmoothUserdata;
+
+static void smooth_apply_task(void *__restrict userdata,
+                              const int i,
+                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SmoothUserdata *data = userdata;
+  const short flag = data->flag;
+  float *vco_orig = data->vertexCos[i];
+  float *vco_new = data->accumulated_vecs[i];
+
+  /* Loose vertices have nothing to be smoothed towards. */
+  if (data->num_accumulated_vecs[i] == 0) {
+    return;
+  }
+  mul_v3_fl(vco_new, 1.0f / (float)data->num_accumulated_vecs[i]);
+
+  float f_new = data->fac_new;
+  if (data->dvert) {
+    f_new *= defvert_find_weight(&data->dvert[i], data->defgrp_index);
+    if (f_new <= 0.0f) {
+      return;
+    }
+  }
+  const float f_orig = 1.0f - f_new;
+
+  if (flag & MOD_SMOOTH_X) {
+    vco_orig[0] = f_orig * vco_orig[0] + f_new * vco_new[0];
+  }
+  if (flag & MOD_SMOOTH_Y) {
+    vco_orig[1] = f_orig * vco_orig[1] + f_new * vco_new[1];
+  }
+  if (flag & MOD_SMOOTH_Z) {
+    vco_orig[2] = f_orig * vco_orig[2] + f_new * vco_new[2];
+  }
+}
+
 static void smoothModifier_do(
     SmoothModifierData *smd, Object *ob, Mesh *mesh, float (*vertexCos)[3], int numVerts)
 {
@@ -99,15 +145,21 @@ static void smoothModifier_do(
     return;
   }
 
-  const float fac_new = smd->fac;
-  const float fac_orig = 1.0f - fac_new;
-
   MEdge *medges = mesh->medge;
   const int num_edges = mesh->totedge;
 
-  MDeformVert *dvert;
-  int defgrp_index;
-  MOD_get_vgroup(ob, mesh, smd->defgrp_name, &dvert, &defgrp_index);
+  SmoothUserdata data = {
+      .flag = smd->flag,
+      .fac_new = smd->fac,
+      .vertexCos = vertexCos,
+      .accumulated_vecs = accumulated_vecs,
+      .num_accumulated_vecs = num_accumulated_vecs,
+  };
+  MOD_get_vgroup(ob, mesh, smd->defgrp_name, &data.dvert, &data.defgrp_index);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (numVerts > 512);
 
   for (int j = 0; j < smd->repeat; j++) {
     if (j != 0) {
@@ -115,6 +167,8 @@ static void smoothModifier_do(
       memset(num_accumulated_vecs, 0, sizeof(*num_accumulated_vecs) * (size_t)numVerts);
     }
 
+    /* Accumulating over the edges is memory bound and depends on the edge order,
+     * gathering per vertex would need an adjacency map that costs more to build. */
     for (int i = 0; i < num_edges; i++) {
       float fvec[3];
       const uint idx1 = medges[i].v1;
@@ -129,52 +183,7 @@ static void smoothModifier_do(
       add_v3_v3(accumulated_vecs[idx2], fvec);
     }
 
-    const short flag = smd->flag;
-    if (dvert) {
-      MDeformVert *dv = dvert;
-      for (int i = 0; i < numVerts; i++, dv++) {
-        float *vco_orig = vertexCos[i];
-        if (num_accumulated_vecs[0] > 0) {
-          mul_v3_fl(accumulated_vecs[i], 1.0f / (float)num_accumulated_vecs[i]);
-        }
-        float *vco_new = accumulated_vecs[i];
-
-        const float f_new = defvert_find_weight(dv, defgrp_index) * fac_new;
-        if (f_new <= 0.0f) {
-          continue;
-        }
-        const float f_orig = 1.0f - f_new;
-
-        if (flag & MOD_SMOOTH_X) {
-          vco_orig[0] = f_orig * vco_orig[0] + f_new * vco_new[0];
-        }
-        if (flag & MOD_SMOOTH_Y) {
-          vco_orig[1] = f_orig * vco_orig[1] + f_new * vco_new[1];
-        }
-        if (flag & MOD_SMOOTH_Z) {
-          vco_orig[2] = f_orig * vco_orig[2] + f_new * vco_new[2];
-        }
-      }
-    }
-    else { /* no vertex group */
-      for (int i = 0; i < numVerts; i++) {
-        float *vco_orig = vertexCos[i];
-        if (num_accumulated_vecs[0] > 0) {
-          mul_v3_fl(accumulated_vecs[i], 1.0f / (float)num_accumulated_vecs[i]);
-        }
-        float *vco_new = accumulated_vecs[i];
-
-        if (flag & MOD_SMOOTH_X) {
-          vco_orig[0] = fac_orig * vco_orig[0] + fac_new * vco_new[0];
-        }
-        if (flag & MOD_SMOOTH_Y) {
-          vco_orig[1] = fac_orig * vco_orig[1] + fac_new * vco_new[1];
-        }
-        if (flag & MOD_SMOOTH_Z) {
-          vco_orig[2] = fac_orig * vco_orig[2] + fac_new * vco_new[2];
-        }
-      }
-    }
+    BLI_task_parallel_range(0, numVerts, &data, smooth_apply_task, &settings);
   }
 
   MEM_freeN(accumulated_vecs);
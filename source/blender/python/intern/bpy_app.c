@@ -468,6 +468,11 @@ static PyGetSetDef bpy_app_getsets[] = {
      bpy_app_debug_set,
      bpy_app_debug_doc,
      (void *)G_DEBUG_DEPSGRAPH_TIME},
+    {"debug_depsgraph_trace",
+     bpy_app_debug_get,
+     bpy_app_debug_set,
+     bpy_app_debug_doc,
+     (void *)G_DEBUG_DEPSGRAPH_TRACE},
     {"debug_depsgraph_pretty",
      bpy_app_debug_get,
      bpy_app_debug_set,
@@ -420,6 +420,173 @@ static PyObject *py_bvhtree_find_nearest(PyBVHTree *self, PyObject *args)
   return py_bvhtree_nearest_to_py_none();
 }
 
+PyDoc_STRVAR(py_bvhtree_ray_cast_multi_doc,
+             ".. method:: ray_cast_multi(origins, directions, distance=sys.float_info.max)\n"
+             "\n"
+             "   Cast many rays onto the mesh at once, in parallel.\n"
+             "   Neighboring rays are cast together, so coherent rays should be next to each "
+             "other.\n"
+             "\n"
+             "   :arg origins: Start locations of the rays in object space.\n"
+             "   :type origins: sequence of :class:`Vector`\n"
+             "   :arg directions: Directions of the rays in object space, "
+             "one for every origin.\n"
+             "   :type directions: sequence of :class:`Vector`\n" PYBVH_FIND_GENERIC_DISTANCE_DOC
+             "   :return: Returns a list with a tuple for every ray\n"
+             "      (:class:`Vector` location, :class:`Vector` normal, int index, float "
+             "distance),\n"
+             "      Values will all be None if no hit is found.\n"
+             "   :rtype: :class:`list`\n");
+static PyObject *py_bvhtree_ray_cast_multi(PyBVHTree *self, PyObject *args)
+{
+  const char *error_prefix = "ray_cast_multi";
+  float(*co)[3] = NULL, (*direction)[3] = NULL;
+  int co_len, direction_len;
+  float max_dist = FLT_MAX;
+
+  /* parse args */
+  {
+    PyObject *py_co, *py_direction;
+
+    if (!PyArg_ParseTuple(args, "OO|f:ray_cast_multi", &py_co, &py_direction, &max_dist)) {
+      return NULL;
+    }
+
+    if ((co_len = mathutils_array_parse_alloc_v((float **)&co, 3, py_co, error_prefix)) == -1) {
+      return NULL;
+    }
+    if ((direction_len = mathutils_array_parse_alloc_v(
+             (float **)&direction, 3, py_direction, error_prefix)) == -1) {
+      PyMem_Free(co);
+      return NULL;
+    }
+    if (co_len != direction_len) {
+      PyErr_Format(PyExc_ValueError,
+                   "%s: expected as many directions as origins (%d), not %d",
+                   error_prefix,
+                   co_len,
+                   direction_len);
+      PyMem_Free(co);
+      PyMem_Free(direction);
+      return NULL;
+    }
+
+    for (int i = 0; i < direction_len; i++) {
+      normalize_v3(direction[i]);
+    }
+  }
+
+  PyObject *ret = PyList_New(co_len);
+  if (co_len == 0) {
+    return ret;
+  }
+
+  BVHTreeRayHit *hits = MEM_mallocN(sizeof(*hits) * (size_t)co_len, __func__);
+  for (int i = 0; i < co_len; i++) {
+    hits[i].dist = max_dist;
+    hits[i].index = -1;
+  }
+
+  /* may fail if the mesh has no faces, in that case the ray-cast misses */
+  if (self->tree) {
+    /* The callback doesn't use Python, let other threads run while casting. */
+    Py_BEGIN_ALLOW_THREADS;
+    BLI_bvhtree_ray_cast_packet(self->tree,
+                                (const float(*)[3])co,
+                                (const float(*)[3])direction,
+                                co_len,
+                                0.0f,
+                                hits,
+                                py_bvhtree_raycast_cb,
+                                self,
+                                BVH_RAYCAST_DEFAULT | BVH_RAYCAST_USE_THREADING);
+    Py_END_ALLOW_THREADS;
+  }
+
+  for (int i = 0; i < co_len; i++) {
+    PyList_SET_ITEM(ret,
+                    i,
+                    (hits[i].index != -1) ? py_bvhtree_raycast_to_py(&hits[i]) :
+                                            py_bvhtree_raycast_to_py_none());
+  }
+
+  MEM_freeN(hits);
+  PyMem_Free(co);
+  PyMem_Free(direction);
+  return ret;
+}
+
+PyDoc_STRVAR(py_bvhtree_find_nearest_multi_doc,
+             ".. method:: find_nearest_multi(origins, distance=" PYBVH_MAX_DIST_STR
+             ")\n"
+             "\n"
+             "   Find the nearest element (typically face index) to many points at once, "
+             "in parallel.\n"
+             "\n"
+             "   :arg origins: Find nearest elements to these points.\n"
+             "   :type origins: sequence of :class:`Vector`\n" PYBVH_FIND_GENERIC_DISTANCE_DOC
+             "   :return: Returns a list with a tuple for every point\n"
+             "      (:class:`Vector` location, :class:`Vector` normal, int index, float "
+             "distance),\n"
+             "      Values will all be None if no element is found.\n"
+             "   :rtype: :class:`list`\n");
+static PyObject *py_bvhtree_find_nearest_multi(PyBVHTree *self, PyObject *args)
+{
+  const char *error_prefix = "find_nearest_multi";
+  float(*co)[3] = NULL;
+  int co_len;
+  float max_dist = max_dist_default;
+
+  /* parse args */
+  {
+    PyObject *py_co;
+
+    if (!PyArg_ParseTuple(args, "O|f:find_nearest_multi", &py_co, &max_dist)) {
+      return NULL;
+    }
+
+    if ((co_len = mathutils_array_parse_alloc_v((float **)&co, 3, py_co, error_prefix)) == -1) {
+      return NULL;
+    }
+  }
+
+  PyObject *ret = PyList_New(co_len);
+  if (co_len == 0) {
+    return ret;
+  }
+
+  BVHTreeNearest *nearest = MEM_mallocN(sizeof(*nearest) * (size_t)co_len, __func__);
+  for (int i = 0; i < co_len; i++) {
+    nearest[i].index = -1;
+    nearest[i].dist_sq = max_dist * max_dist;
+  }
+
+  /* may fail if the mesh has no faces, in that case the search finds nothing */
+  if (self->tree) {
+    /* The callback doesn't use Python, let other threads run while searching. */
+    Py_BEGIN_ALLOW_THREADS;
+    BLI_bvhtree_find_nearest_batch(self->tree,
+                                   (const float(*)[3])co,
+                                   co_len,
+                                   nearest,
+                                   py_bvhtree_nearest_point_cb,
+                                   self,
+                                   BVH_NEAREST_USE_THREADING);
+    Py_END_ALLOW_THREADS;
+  }
+
+  for (int i = 0; i < co_len; i++) {
+    PyList_SET_ITEM(ret,
+                    i,
+                    (nearest[i].index != -1) ? py_bvhtree_nearest_to_py(&nearest[i]) :
+                                               py_bvhtree_nearest_to_py_none());
+  }
+
+  MEM_freeN(nearest);
+  PyMem_Free(co);
+  return ret;
+}
+
 struct PyBVH_RangeData {
   PyBVHTree *self;
   PyObject *result;
@@ -1237,6 +1404,14 @@ static PyMethodDef py_bvhtree_methods[] = {
      (PyCFunction)py_bvhtree_find_nearest,
      METH_VARARGS,
      py_bvhtree_find_nearest_doc},
+    {"ray_cast_multi",
+     (PyCFunction)py_bvhtree_ray_cast_multi,
+     METH_VARARGS,
+     py_bvhtree_ray_cast_multi_doc},
+    {"find_nearest_multi",
+     (PyCFunction)py_bvhtree_find_nearest_multi,
+     METH_VARARGS,
+     py_bvhtree_find_nearest_multi_doc},
     {"find_nearest_range",
      (PyCFunction)py_bvhtree_find_nearest_range,
      METH_VARARGS,
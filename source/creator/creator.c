@@ -277,17 +277,23 @@ int main(int argc,
    *       guarded allocator before any allocation happened.
    */
   {
+    bool use_guarded_allocator = false;
     int i;
     for (i = 0; i < argc; i++) {
       if (STR_ELEM(argv[i], "-d", "--debug", "--debug-memory", "--debug-all")) {
         printf("Switching to fully guarded memory allocator.\n");
         MEM_use_guarded_allocator();
+        use_guarded_allocator = true;
         break;
       }
       else if (STREQ(argv[i], "--")) {
         break;
       }
     }
+    /* Small blocks from per-thread slab caches, the guarded allocator keeps tracking each block. */
+    if (!use_guarded_allocator) {
+      MEM_use_slab_allocator(true);
+    }
   }
 
 #ifdef BUILD_DATE
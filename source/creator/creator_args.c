@@ -527,6 +527,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--render-output");
   BLI_argsPrintArgDoc(ba, "--engine");
   BLI_argsPrintArgDoc(ba, "--threads");
+  BLI_argsPrintArgDoc(ba, "--numa");
 
   printf("\n");
   printf("Format Options:\n");
@@ -597,6 +598,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-tag");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-no-threads");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-time");
+  BLI_argsPrintArgDoc(ba, "--debug-depsgraph-trace");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-pretty");
   BLI_argsPrintArgDoc(ba, "--debug-gpu");
   BLI_argsPrintArgDoc(ba, "--debug-gpumem");
@@ -958,6 +960,10 @@ static const char arg_handle_debug_mode_generic_set_doc_depsgraph_tag[] =
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_time[] =
     "\n\t"
     "Enable debug messages from dependency graph related on timing.";
+static const char arg_handle_debug_mode_generic_set_doc_depsgraph_trace[] =
+    "\n\t"
+    "Record the dependency graph evaluation timeline, which can be written using "
+    "Depsgraph.debug_trace_chrome().";
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_eval[] =
     "\n\t"
     "Enable debug messages from dependency graph related on evaluation.";
@@ -1478,6 +1484,16 @@ static int arg_handle_threads_set(int argc, const char **argv, void *UNUSED(data
   }
 }
 
+static const char arg_handle_numa_set_doc[] =
+    "\n"
+    "\tUse NUMA aware task scheduling: worker threads are pinned to NUMA nodes and\n"
+    "\tprefer to take work from threads of the same node.";
+static int arg_handle_numa_set(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
+{
+  BLI_system_numa_scheduling_set(true);
+  return 0;
+}
+
 static const char arg_handle_verbosity_set_doc[] =
     "<verbose>\n"
     "\tSet logging verbosity level for debug messages which supports it.";
@@ -2154,6 +2170,12 @@ void main_args_setup(bContext *C, bArgs *ba)
               "--debug-depsgraph-time",
               CB_EX(arg_handle_debug_mode_generic_set, depsgraph_time),
               (void *)G_DEBUG_DEPSGRAPH_TIME);
+  BLI_argsAdd(ba,
+              1,
+              NULL,
+              "--debug-depsgraph-trace",
+              CB_EX(arg_handle_debug_mode_generic_set, depsgraph_trace),
+              (void *)G_DEBUG_DEPSGRAPH_TRACE);
   BLI_argsAdd(ba,
               1,
               NULL,
@@ -2237,6 +2259,7 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_argsAdd(ba, 4, "-F", "--render-format", CB(arg_handle_image_type_set), C);
   BLI_argsAdd(ba, 1, "-t", "--threads", CB(arg_handle_threads_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--numa", CB(arg_handle_numa_set), NULL);
   BLI_argsAdd(ba, 4, "-x", "--use-extension", CB(arg_handle_extension_set), C);
 
 #  undef CB
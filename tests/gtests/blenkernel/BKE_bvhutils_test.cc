@@ -0,0 +1,273 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_bvhutils.h"
+#include "BKE_collection.h"
+#include "BKE_customdata.h"
+#include "BKE_layer.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
+#include "BKE_modifier.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+}
+
+#define GRID_SIZE 32
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static void mesh_grid_fill(Mesh *me)
+{
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      float *co = me->mvert[y * GRID_SIZE + x].co;
+      co[0] = (float)x / (float)(GRID_SIZE - 1);
+      co[1] = (float)y / (float)(GRID_SIZE - 1);
+      co[2] = 0.1f * sinf(co[0] * 8.0f);
+    }
+  }
+
+  MLoop *ml = me->mloop;
+  MPoly *mp = me->mpoly;
+  for (int y = 0; y < GRID_SIZE - 1; y++) {
+    for (int x = 0; x < GRID_SIZE - 1; x++, mp++) {
+      const int v = y * GRID_SIZE + x;
+      mp->loopstart = (int)(ml - me->mloop);
+      mp->totloop = 4;
+      (ml++)->v = v;
+      (ml++)->v = v + 1;
+      (ml++)->v = v + GRID_SIZE + 1;
+      (ml++)->v = v + GRID_SIZE;
+    }
+  }
+  BKE_mesh_calc_edges(me, false, false);
+}
+
+static Mesh *mesh_grid_create()
+{
+  const int polys_len = (GRID_SIZE - 1) * (GRID_SIZE - 1);
+  Mesh *me = BKE_mesh_new_nomain(GRID_SIZE * GRID_SIZE, 0, 0, polys_len * 4, polys_len);
+  mesh_grid_fill(me);
+  return me;
+}
+
+/* Move the positions the way a deform modifier would. */
+static void mesh_deform(Mesh *me, const float factor)
+{
+  float(*vert_coords)[3] = BKE_mesh_vert_coords_alloc(me, NULL);
+  for (int i = 0; i < me->totvert; i++) {
+    vert_coords[i][2] += factor * sinf(vert_coords[i][1] * 5.0f);
+  }
+  BKE_mesh_vert_coords_apply(me, vert_coords);
+  MEM_freeN(vert_coords);
+}
+
+static BVHTree *mesh_bvhtree_cached(Mesh *me)
+{
+  BVHTree *tree = NULL;
+  bvhcache_find(me->runtime.bvh_cache, BVHTREE_FROM_LOOPTRI, &tree);
+  return tree;
+}
+
+/* Nearest queries on the cached tree of the mesh must give the same results as on a tree
+ * built from scratch for the current positions. */
+static void mesh_bvhtree_nearest_test(Mesh *me)
+{
+  BVHTreeFromMesh treedata, treedata_ref;
+  BKE_bvhtree_from_mesh_get(&treedata, me, BVHTREE_FROM_LOOPTRI, 2);
+  EXPECT_TRUE(treedata.cached);
+
+  Mesh *me_ref = BKE_mesh_copy_for_eval(me, false);
+  BKE_bvhtree_from_mesh_get(&treedata_ref, me_ref, BVHTREE_FROM_LOOPTRI, 2);
+
+  for (int i = 0; i < me->totvert; i += 5) {
+    float co[3];
+    copy_v3_v3(co, me->mvert[i].co);
+    co[2] += 0.05f;
+
+    BVHTreeNearest nearest, nearest_ref;
+    nearest.index = nearest_ref.index = -1;
+    nearest.dist_sq = nearest_ref.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(
+        treedata.tree, co, &nearest, treedata.nearest_callback, &treedata);
+    BLI_bvhtree_find_nearest(
+        treedata_ref.tree, co, &nearest_ref, treedata_ref.nearest_callback, &treedata_ref);
+    EXPECT_FLOAT_EQ(nearest.dist_sq, nearest_ref.dist_sq);
+  }
+
+  free_bvhtree_from_mesh(&treedata);
+  free_bvhtree_from_mesh(&treedata_ref);
+  BKE_mesh_eval_delete(me_ref);
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+/* Changing the positions refits the cached tree instead of building a new one. */
+TEST(bvhutils, CacheRefit)
+{
+  BLI_threadapi_init();
+  Mesh *me = mesh_grid_create();
+
+  mesh_bvhtree_nearest_test(me);
+  BVHTree *tree = mesh_bvhtree_cached(me);
+  EXPECT_NE(tree, nullptr);
+
+  mesh_deform(me, 0.5f);
+  mesh_bvhtree_nearest_test(me);
+  EXPECT_EQ(mesh_bvhtree_cached(me), tree);
+
+  BKE_mesh_eval_delete(me);
+  BLI_threadapi_exit();
+}
+
+/* The trees are handed to a mesh with the same topology and refit to its positions. */
+TEST(bvhutils, CacheTransfer)
+{
+  BLI_threadapi_init();
+  Mesh *me_src = mesh_grid_create();
+  mesh_bvhtree_nearest_test(me_src);
+  BVHTree *tree = mesh_bvhtree_cached(me_src);
+
+  Mesh *me_dst = BKE_mesh_copy_for_eval(me_src, false);
+  EXPECT_EQ(me_dst->runtime.bvh_cache, nullptr);
+  mesh_deform(me_dst, 0.5f);
+
+  EXPECT_TRUE(BKE_mesh_runtime_bvh_cache_transfer(me_src, me_dst));
+  EXPECT_EQ(me_src->runtime.bvh_cache, nullptr);
+  EXPECT_EQ(mesh_bvhtree_cached(me_dst), tree);
+  mesh_bvhtree_nearest_test(me_dst);
+  EXPECT_EQ(mesh_bvhtree_cached(me_dst), tree);
+
+  BKE_mesh_eval_delete(me_src);
+  BKE_mesh_eval_delete(me_dst);
+  BLI_threadapi_exit();
+}
+
+/* Different topology keeps the trees where they are. */
+TEST(bvhutils, CacheTransferTopologyChange)
+{
+  BLI_threadapi_init();
+  Mesh *me_src = mesh_grid_create();
+  mesh_bvhtree_nearest_test(me_src);
+
+  Mesh *me_dst = BKE_mesh_copy_for_eval(me_src, false);
+  SWAP(unsigned int, me_dst->mloop[0].v, me_dst->mloop[2].v);
+  EXPECT_FALSE(BKE_mesh_runtime_bvh_cache_transfer(me_src, me_dst));
+  EXPECT_NE(me_src->runtime.bvh_cache, nullptr);
+  EXPECT_EQ(me_dst->runtime.bvh_cache, nullptr);
+
+  /* Loose or hidden elements are part of the topology too. */
+  SWAP(unsigned int, me_dst->mloop[0].v, me_dst->mloop[2].v);
+  me_dst->mpoly[0].flag |= ME_HIDE;
+  EXPECT_FALSE(BKE_mesh_runtime_bvh_cache_transfer(me_src, me_dst));
+
+  BKE_mesh_eval_delete(me_src);
+  BKE_mesh_eval_delete(me_dst);
+  BLI_threadapi_exit();
+}
+
+/* An object deformed through its relations (as by an animated armature or hook) keeps its trees
+ * across evaluations, so shrink-wrapping or snapping to it only refits them. */
+class BVHUtilsEvaluationTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Object *ob = nullptr;
+  Object *ob_hook = nullptr;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+
+    bmain = BKE_main_new();
+    Scene *scene = BKE_scene_add(bmain, "Scene");
+    ViewLayer *view_layer = BKE_view_layer_default_view(scene);
+
+    ob = BKE_object_add_only_object(bmain, OB_MESH, "Object");
+    Mesh *me = BKE_mesh_add(bmain, "Mesh");
+    const int polys_len = (GRID_SIZE - 1) * (GRID_SIZE - 1);
+    me->totvert = GRID_SIZE * GRID_SIZE;
+    me->totloop = polys_len * 4;
+    me->totpoly = polys_len;
+    CustomData_add_layer(&me->vdata, CD_MVERT, CD_CALLOC, nullptr, me->totvert);
+    CustomData_add_layer(&me->ldata, CD_MLOOP, CD_CALLOC, nullptr, me->totloop);
+    CustomData_add_layer(&me->pdata, CD_MPOLY, CD_CALLOC, nullptr, me->totpoly);
+    BKE_mesh_update_customdata_pointers(me, false);
+    mesh_grid_fill(me);
+    ob->data = me;
+    BKE_collection_object_add(bmain, scene->master_collection, ob);
+
+    ob_hook = BKE_object_add_only_object(bmain, OB_EMPTY, "Hook");
+    BKE_collection_object_add(bmain, scene->master_collection, ob_hook);
+
+    /* Hook the first row of the grid. */
+    HookModifierData *hmd = (HookModifierData *)modifier_new(eModifierType_Hook);
+    hmd->object = ob_hook;
+    unit_m4(hmd->parentinv);
+    hmd->totindex = GRID_SIZE;
+    hmd->indexar = (int *)MEM_malloc_arrayN(GRID_SIZE, sizeof(int), __func__);
+    for (int i = 0; i < GRID_SIZE; i++) {
+      hmd->indexar[i] = i;
+    }
+    BLI_addtail(&ob->modifiers, hmd);
+
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  void TearDown() override
+  {
+    BlendfileLoadingBaseTest::TearDown();
+    BKE_main_free(bmain);
+    bmain = nullptr;
+  }
+
+  /* Only the hook is tagged, the object is evaluated again through the relations. */
+  Mesh *mesh_eval_update(const float hook_height)
+  {
+    ob_hook->loc[2] = hook_height;
+    DEG_id_tag_update_ex(bmain, &ob_hook->id, ID_RECALC_TRANSFORM);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+    return DEG_get_evaluated_object(depsgraph, ob)->runtime.mesh_eval;
+  }
+};
+
+TEST_F(BVHUtilsEvaluationTest, CacheKeptOnDeform)
+{
+  Mesh *me_eval = mesh_eval_update(0.5f);
+  mesh_bvhtree_nearest_test(me_eval);
+  BVHTree *tree = mesh_bvhtree_cached(me_eval);
+  EXPECT_NE(tree, nullptr);
+
+  /* Nothing requested trees of the new result yet, so they can only come from the previous. */
+  Mesh *me_eval_next = mesh_eval_update(0.8f);
+  EXPECT_NE(me_eval_next, me_eval);
+  EXPECT_NE(me_eval_next->runtime.bvh_cache, nullptr);
+  EXPECT_EQ(mesh_bvhtree_cached(me_eval_next), tree);
+  EXPECT_FLOAT_EQ(me_eval_next->mvert[0].co[2], 0.8f);
+  mesh_bvhtree_nearest_test(me_eval_next);
+}
@@ -0,0 +1,211 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_math.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_collection.h"
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_layer.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+}
+
+#define VERTS_LEN 64
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static void customdata_verts_create(CustomData *data)
+{
+  CustomData_reset(data);
+  MVert *mvert = (MVert *)CustomData_add_layer(data, CD_MVERT, CD_CALLOC, nullptr, VERTS_LEN);
+  MDeformVert *dvert = (MDeformVert *)CustomData_add_layer(
+      data, CD_MDEFORMVERT, CD_CALLOC, nullptr, VERTS_LEN);
+  for (int i = 0; i < VERTS_LEN; i++) {
+    mvert[i].co[0] = (float)i;
+    defvert_add_index_notest(&dvert[i], 0, 0.5f);
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+/* Shared layers are copied before writing, only while other layers use their data. */
+TEST(customdata, SharedLayerCopyOnWrite)
+{
+  CustomData data, data_shared;
+  customdata_verts_create(&data);
+  CustomData_copy(&data, &data_shared, CD_MASK_MESH.vmask, CD_SHARE, VERTS_LEN);
+
+  MVert *mvert = (MVert *)CustomData_get_layer(&data, CD_MVERT);
+  EXPECT_EQ(CustomData_get_layer(&data_shared, CD_MVERT), mvert);
+  EXPECT_TRUE(CustomData_is_shared_layer(&data, CD_MVERT));
+  EXPECT_TRUE(CustomData_is_shared_layer(&data_shared, CD_MVERT));
+
+  MVert *mvert_copy = (MVert *)CustomData_duplicate_referenced_layer(
+      &data_shared, CD_MVERT, VERTS_LEN);
+  EXPECT_NE(mvert_copy, mvert);
+  mvert_copy[1].co[0] = -1.0f;
+  EXPECT_FLOAT_EQ(mvert[1].co[0], 1.0f);
+  EXPECT_FALSE(CustomData_is_shared_layer(&data, CD_MVERT));
+  EXPECT_FALSE(CustomData_is_shared_layer(&data_shared, CD_MVERT));
+
+  /* The last user owns the data, it's not copied again. */
+  EXPECT_EQ(CustomData_duplicate_referenced_layer(&data, CD_MVERT, VERTS_LEN), mvert);
+
+  /* Layers with a copy callback duplicate what their elements allocate. */
+  MDeformVert *dvert = (MDeformVert *)CustomData_get_layer(&data, CD_MDEFORMVERT);
+  MDeformVert *dvert_copy = (MDeformVert *)CustomData_duplicate_referenced_layer(
+      &data_shared, CD_MDEFORMVERT, VERTS_LEN);
+  EXPECT_NE(dvert_copy, dvert);
+  EXPECT_NE(dvert_copy[0].dw, dvert[0].dw);
+  EXPECT_FLOAT_EQ(dvert_copy[0].dw[0].weight, 0.5f);
+
+  CustomData_free(&data, VERTS_LEN);
+  CustomData_free(&data_shared, VERTS_LEN);
+}
+
+/* Shared data outlives the layer it was shared from, references to it become users too. */
+TEST(customdata, SharedLayerFree)
+{
+  CustomData data, data_shared, data_reference;
+  customdata_verts_create(&data);
+  CustomData_copy(&data, &data_shared, CD_MASK_MESH.vmask, CD_SHARE, VERTS_LEN);
+  CustomData_copy(&data_shared, &data_reference, CD_MASK_MESH.vmask, CD_REFERENCE, VERTS_LEN);
+
+  MVert *mvert = (MVert *)CustomData_get_layer(&data, CD_MVERT);
+  EXPECT_EQ(CustomData_get_layer(&data_reference, CD_MVERT), mvert);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&data_reference, CD_MVERT));
+  EXPECT_TRUE(CustomData_is_shared_layer(&data_reference, CD_MVERT));
+
+  CustomData_free(&data, VERTS_LEN);
+  CustomData_free(&data_shared, VERTS_LEN);
+  EXPECT_FALSE(CustomData_is_shared_layer(&data_reference, CD_MVERT));
+  EXPECT_FLOAT_EQ(mvert[VERTS_LEN - 1].co[0], (float)(VERTS_LEN - 1));
+  EXPECT_EQ(CustomData_duplicate_referenced_layer(&data_reference, CD_MVERT, VERTS_LEN), mvert);
+
+  /* Assigning moves the user along with the data. */
+  CustomData data_assign;
+  CustomData_copy(&data_reference, &data_assign, CD_MASK_MESH.vmask, CD_ASSIGN, VERTS_LEN);
+  CustomData_reset(&data_reference);
+  CustomData data_shared_assign;
+  CustomData_copy(&data_assign, &data_shared_assign, CD_MASK_MESH.vmask, CD_SHARE, VERTS_LEN);
+  CustomData_free(&data_reference, VERTS_LEN);
+  CustomData_free(&data_assign, VERTS_LEN);
+  EXPECT_EQ(CustomData_get_layer(&data_shared_assign, CD_MVERT), mvert);
+  CustomData_free(&data_shared_assign, VERTS_LEN);
+}
+
+/* Normals are written to a copy of shared vertices. */
+TEST(customdata, SharedMeshNormals)
+{
+  Mesh *me = BKE_mesh_new_nomain(4, 0, 0, 4, 1);
+  for (int i = 0; i < 4; i++) {
+    me->mvert[i].co[0] = (float)(i & 1);
+    me->mvert[i].co[1] = (float)(i >> 1);
+    me->mloop[i].v = (unsigned int)((i < 2) ? i : 5 - i);
+  }
+  me->mpoly[0].totloop = 4;
+  BKE_mesh_calc_edges(me, false, false);
+
+  Mesh *me_shared;
+  BKE_id_copy_ex(nullptr, &me->id, (ID **)&me_shared, LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE);
+  EXPECT_EQ(me_shared->mvert, me->mvert);
+  EXPECT_EQ(me_shared->mloop, me->mloop);
+
+  BKE_mesh_calc_normals(me_shared);
+  EXPECT_NE(me_shared->mvert, me->mvert);
+  EXPECT_EQ(me_shared->mloop, me->mloop);
+  EXPECT_NE(me_shared->mvert[0].no[2], 0);
+  EXPECT_EQ(me->mvert[0].no[2], 0);
+
+  BKE_id_free(nullptr, me);
+  BKE_id_free(nullptr, me_shared);
+}
+
+/* Viewport copy-on-write shares the geometry of the original mesh. */
+class CustomDataCopyOnWriteTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  ViewLayer *view_layer = nullptr;
+  Object *ob = nullptr;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    view_layer = BKE_view_layer_default_view(scene);
+
+    ob = BKE_object_add_only_object(bmain, OB_MESH, "Object");
+    Mesh *me = BKE_mesh_add(bmain, "Mesh");
+    me->totvert = VERTS_LEN;
+    CustomData_free(&me->vdata, 0);
+    customdata_verts_create(&me->vdata);
+    BKE_mesh_update_customdata_pointers(me, false);
+    ob->data = me;
+    BKE_collection_object_add(bmain, scene->master_collection, ob);
+  }
+
+  void TearDown() override
+  {
+    BlendfileLoadingBaseTest::TearDown();
+    BKE_main_free(bmain);
+    bmain = nullptr;
+  }
+
+  Mesh *mesh_cow_get(const eEvaluationMode mode)
+  {
+    depsgraph_free();
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, mode);
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+    return (Mesh *)DEG_get_evaluated_object(depsgraph, ob)->data;
+  }
+};
+
+TEST_F(CustomDataCopyOnWriteTest, ShareOriginal)
+{
+  Mesh *me = (Mesh *)ob->data;
+  Mesh *me_cow = mesh_cow_get(DAG_EVAL_VIEWPORT);
+  EXPECT_NE(me_cow, me);
+  EXPECT_EQ(me_cow->mvert, me->mvert);
+  EXPECT_EQ(me_cow->dvert, me->dvert);
+
+  EXPECT_TRUE(CustomData_is_shared_layer(&me->vdata, CD_MVERT));
+
+  /* Freeing the geometry of the original keeps it for the evaluated mesh. */
+  MVert *mvert = me->mvert;
+  BKE_mesh_clear_geometry(me);
+  EXPECT_EQ(me_cow->mvert, mvert);
+  EXPECT_FLOAT_EQ(me_cow->mvert[VERTS_LEN - 1].co[0], (float)(VERTS_LEN - 1));
+}
+
+TEST_F(CustomDataCopyOnWriteTest, CopyForRender)
+{
+  Mesh *me = (Mesh *)ob->data;
+  Mesh *me_cow = mesh_cow_get(DAG_EVAL_RENDER);
+  EXPECT_NE(me_cow->mvert, me->mvert);
+  EXPECT_FALSE(CustomData_is_shared_layer(&me->vdata, CD_MVERT));
+}
@@ -0,0 +1,166 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_meta_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_collection.h"
+#include "BKE_curve.h"
+#include "BKE_customdata.h"
+#include "BKE_displist.h"
+#include "BKE_layer.h"
+#include "BKE_main.h"
+#include "BKE_mball.h"
+#include "BKE_mball_tessellate.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+}
+
+#define NUM_THREADS 8
+#define INSTANCER_VERTS_LEN 4
+
+/* Recreate the task scheduler with the given number of threads. */
+static void threads_set(const int num_threads)
+{
+  BLI_threadapi_exit();
+  BLI_system_num_threads_override_set(num_threads);
+  BLI_threadapi_init();
+}
+
+/* The tessellation of a metaball family, made of the basis, a second member and a third one
+ * instanced on the vertices of a mesh. The parts are close enough to melt together. */
+class MBallTessellateTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  ViewLayer *view_layer = nullptr;
+  Object *ob_basis = nullptr;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    view_layer = BKE_view_layer_default_view(scene);
+
+    ob_basis = mball_object_add("Mball", 0.0f);
+    mball_object_add("Mball.001", 1.5f);
+    Object *ob_instanced = mball_object_add("Mball.002", 0.0f);
+
+    Object *ob_instancer = BKE_object_add_only_object(bmain, OB_MESH, "Instancer");
+    ob_instancer->data = instancer_mesh_create();
+    ob_instancer->transflag |= OB_DUPLIVERTS;
+    BKE_collection_object_add(bmain, scene->master_collection, ob_instancer);
+    ob_instanced->parent = ob_instancer;
+  }
+
+  void TearDown() override
+  {
+    BlendfileLoadingBaseTest::TearDown();
+    BKE_main_free(bmain);
+    bmain = nullptr;
+  }
+
+  static void TearDownTestCase()
+  {
+    /* Freed on exit by the window manager otherwise. */
+    BKE_mball_cubeTable_free();
+    BlendfileLoadingBaseTest::TearDownTestCase();
+  }
+
+  Object *mball_object_add(const char *name, const float offset)
+  {
+    MetaBall *mb = BKE_mball_add(bmain, name);
+    mb->wiresize = 0.05f;
+    for (int i = 0; i < 3; i++) {
+      MetaElem *ml = BKE_mball_element_add(mb, (i == 1) ? MB_ELIPSOID : MB_BALL);
+      ml->x = offset + 0.8f * (float)i;
+      ml->y = 0.3f * (float)i;
+      ml->rad = 0.6f;
+    }
+
+    Object *ob = BKE_object_add_only_object(bmain, OB_MBALL, name);
+    ob->data = mb;
+    BKE_collection_object_add(bmain, scene->master_collection, ob);
+    return ob;
+  }
+
+  Mesh *instancer_mesh_create()
+  {
+    Mesh *me = BKE_mesh_add(bmain, "Instancer");
+    me->totvert = INSTANCER_VERTS_LEN;
+    me->mvert = (MVert *)CustomData_add_layer(
+        &me->vdata, CD_MVERT, CD_CALLOC, nullptr, me->totvert);
+    for (int i = 0; i < me->totvert; i++) {
+      me->mvert[i].co[0] = 0.7f * (float)i;
+      me->mvert[i].co[1] = -1.0f;
+    }
+    return me;
+  }
+
+  /* Evaluate in a new depsgraph and copy the vertices, normals and faces of the basis. */
+  void tessellate(std::vector<float> &r_co, std::vector<float> &r_no, std::vector<int> &r_index)
+  {
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+
+    const Object *ob_eval = DEG_get_evaluated_object(depsgraph, ob_basis);
+    ASSERT_NE(ob_eval->runtime.curve_cache, nullptr);
+    const DispList *dl = (const DispList *)ob_eval->runtime.curve_cache->disp.first;
+    ASSERT_NE(dl, nullptr);
+    r_co.assign(dl->verts, dl->verts + dl->nr * 3);
+    r_no.assign(dl->nors, dl->nors + dl->nr * 3);
+    r_index.assign(dl->index, dl->index + dl->parts * 4);
+
+    depsgraph_free();
+  }
+};
+
+/* The field is evaluated in parallel while cubes and faces are added in order, so threads do
+ * not change the result. The instanced member is only found once the instancer is evaluated,
+ * which the dependency graph ensures without a lock. */
+TEST_F(MBallTessellateTest, ThreadedMatchesSerial)
+{
+  std::vector<float> co_serial, no_serial, co, no;
+  std::vector<int> index_serial, index;
+
+  threads_set(1);
+  tessellate(co_serial, no_serial, index_serial);
+  threads_set(NUM_THREADS);
+  tessellate(co, no, index);
+  threads_set(0);
+
+  EXPECT_GT(index_serial.size(), 0u);
+  EXPECT_EQ(co, co_serial);
+  EXPECT_EQ(no, no_serial);
+  EXPECT_EQ(index, index_serial);
+
+  /* The instances add to the surface, the serial result without them has fewer faces. */
+  Object *ob_instancer = (Object *)BLI_findstring(
+      &bmain->objects, "OBInstancer", offsetof(ID, name));
+  ob_instancer->transflag &= ~OB_DUPLIVERTS;
+  tessellate(co, no, index);
+  EXPECT_LT(index.size(), index_serial.size());
+}
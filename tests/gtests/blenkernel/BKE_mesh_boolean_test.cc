@@ -0,0 +1,228 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_library.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_boolean.h"
+}
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+/* Cube from -1 to 1, with its faces pointing outwards. */
+static Mesh *mesh_cube_create()
+{
+  static const int faces[6][4] = {
+      {0, 1, 3, 2},
+      {4, 6, 7, 5},
+      {0, 4, 5, 1},
+      {2, 3, 7, 6},
+      {0, 2, 6, 4},
+      {1, 5, 7, 3},
+  };
+  Mesh *me = BKE_mesh_new_nomain(8, 0, 0, 24, 6);
+  for (int i = 0; i < 8; i++) {
+    me->mvert[i].co[0] = (i & 4) ? 1.0f : -1.0f;
+    me->mvert[i].co[1] = (i & 2) ? 1.0f : -1.0f;
+    me->mvert[i].co[2] = (i & 1) ? 1.0f : -1.0f;
+  }
+  for (int i = 0; i < 6; i++) {
+    me->mpoly[i].loopstart = i * 4;
+    me->mpoly[i].totloop = 4;
+    me->mpoly[i].mat_nr = 1;
+    for (int j = 0; j < 4; j++) {
+      me->mloop[i * 4 + j].v = (unsigned int)faces[i][j];
+    }
+  }
+  BKE_mesh_calc_edges(me, false, false);
+  return me;
+}
+
+/* Volume enclosed by the faces, negative when they point inwards. */
+static double mesh_volume(const Mesh *me)
+{
+  double volume = 0.0;
+  for (int i = 0; i < me->totpoly; i++) {
+    const MPoly *mp = &me->mpoly[i];
+    const float *co0 = me->mvert[me->mloop[mp->loopstart].v].co;
+    for (int j = 2; j < mp->totloop; j++) {
+      const float *co1 = me->mvert[me->mloop[mp->loopstart + j - 1].v].co;
+      const float *co2 = me->mvert[me->mloop[mp->loopstart + j].v].co;
+      double cross[3], a[3], b[3], c[3];
+      copy_v3db_v3fl(a, co0);
+      copy_v3db_v3fl(b, co1);
+      copy_v3db_v3fl(c, co2);
+      cross_v3_v3v3_db(cross, b, c);
+      volume += dot_v3v3_db(a, cross) / 6.0;
+    }
+  }
+  return volume;
+}
+
+/* Every edge is used by two faces, in opposite directions. */
+static bool mesh_is_manifold(const Mesh *me)
+{
+  int *edge_users = (int *)MEM_calloc_arrayN(me->totedge, sizeof(int), __func__);
+  bool is_manifold = true;
+  for (int i = 0; i < me->totpoly; i++) {
+    const MPoly *mp = &me->mpoly[i];
+    for (int j = 0; j < mp->totloop; j++) {
+      const MLoop *ml = &me->mloop[mp->loopstart + j];
+      const MLoop *ml_next = &me->mloop[mp->loopstart + (j + 1) % mp->totloop];
+      const MEdge *med = &me->medge[ml->e];
+      if (!((med->v1 == ml->v && med->v2 == ml_next->v) ||
+            (med->v2 == ml->v && med->v1 == ml_next->v))) {
+        is_manifold = false;
+      }
+      edge_users[ml->e] += (ml->v == med->v1) ? 1 : -1;
+      edge_users[ml->e] += 2;
+    }
+  }
+  for (int i = 0; i < me->totedge; i++) {
+    if (edge_users[i] != 4) {
+      is_manifold = false;
+    }
+  }
+  MEM_freeN(edge_users);
+  return is_manifold;
+}
+
+static Mesh *mesh_cubes_boolean_ex(const float mat_b[4][4], const int operation)
+{
+  Mesh *me_a = mesh_cube_create();
+  Mesh *me_b = mesh_cube_create();
+  const short material_remap[2] = {0, 3};
+
+  Mesh *result = BKE_mesh_boolean(
+      me_a, me_b, mat_b, is_negative_m4(mat_b), material_remap, 2, operation);
+
+  BKE_id_free(nullptr, me_a);
+  BKE_id_free(nullptr, me_b);
+  return result;
+}
+
+static Mesh *mesh_cubes_boolean(const float offset[3], const float scale_b, const int operation)
+{
+  float mat_b[4][4];
+  unit_m4(mat_b);
+  mat_b[0][0] = scale_b;
+  copy_v3_v3(mat_b[3], offset);
+  return mesh_cubes_boolean_ex(mat_b, operation);
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(mesh_boolean, Overlapping)
+{
+  BLI_threadapi_init();
+  const float offset[3] = {1.0f, 1.0f, 1.0f};
+  const double volumes[3] = {1.0, 15.0, 7.0};
+  for (int operation = 0; operation < 3; operation++) {
+    Mesh *result = mesh_cubes_boolean(offset, 1.0f, operation);
+    EXPECT_TRUE(mesh_is_manifold(result));
+    EXPECT_NEAR(mesh_volume(result), volumes[operation], 1e-5);
+    if (operation == eBooleanModifierOp_Intersect) {
+      /* Pieces of the same face are joined back together. */
+      EXPECT_EQ(result->totpoly, 6);
+    }
+    BKE_id_free(nullptr, result);
+  }
+  BLI_threadapi_exit();
+}
+
+/* Any placement of the other mesh gives a closed result, with consistent volumes. */
+TEST(mesh_boolean, Rotated)
+{
+  BLI_threadapi_init();
+  float mat_b[4][4];
+  const float eul[3] = {0.3f, 0.7f, 1.1f};
+  eul_to_mat4(mat_b, eul);
+  mat_b[3][0] = 0.6f;
+  mat_b[3][1] = 0.2f;
+  mat_b[3][2] = -0.4f;
+
+  double volumes[3];
+  for (int operation = 0; operation < 3; operation++) {
+    Mesh *result = mesh_cubes_boolean_ex(mat_b, operation);
+    EXPECT_TRUE(mesh_is_manifold(result));
+    volumes[operation] = mesh_volume(result);
+    BKE_id_free(nullptr, result);
+  }
+  EXPECT_NEAR(volumes[eBooleanModifierOp_Union] + volumes[eBooleanModifierOp_Intersect],
+              16.0,
+              1e-4);
+  EXPECT_NEAR(volumes[eBooleanModifierOp_Difference],
+              volumes[eBooleanModifierOp_Union] - 8.0,
+              1e-4);
+  BLI_threadapi_exit();
+}
+
+/* Faces on the same plane are merged, the result doesn't have any inner faces. */
+TEST(mesh_boolean, Coplanar)
+{
+  BLI_threadapi_init();
+  const float offset[3] = {1.0f, 0.0f, 0.0f};
+  const double volumes[3] = {4.0, 12.0, 4.0};
+  for (int operation = 0; operation < 3; operation++) {
+    Mesh *result = mesh_cubes_boolean(offset, 1.0f, operation);
+    EXPECT_TRUE(mesh_is_manifold(result));
+    EXPECT_NEAR(mesh_volume(result), volumes[operation], 1e-5);
+    BKE_id_free(nullptr, result);
+  }
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_boolean, Identical)
+{
+  BLI_threadapi_init();
+  const float offset[3] = {0.0f, 0.0f, 0.0f};
+  Mesh *result = mesh_cubes_boolean(offset, 1.0f, eBooleanModifierOp_Union);
+  EXPECT_TRUE(mesh_is_manifold(result));
+  EXPECT_NEAR(mesh_volume(result), 8.0, 1e-5);
+  BKE_id_free(nullptr, result);
+
+  result = mesh_cubes_boolean(offset, 1.0f, eBooleanModifierOp_Intersect);
+  EXPECT_TRUE(mesh_is_manifold(result));
+  EXPECT_NEAR(mesh_volume(result), 8.0, 1e-5);
+  BKE_id_free(nullptr, result);
+
+  result = mesh_cubes_boolean(offset, 1.0f, eBooleanModifierOp_Difference);
+  EXPECT_NEAR(mesh_volume(result), 0.0, 1e-5);
+  BKE_id_free(nullptr, result);
+  BLI_threadapi_exit();
+}
+
+/* Faces of the other mesh are reversed for a negative scale, and their materials remapped. */
+TEST(mesh_boolean, FlipAndMaterials)
+{
+  BLI_threadapi_init();
+  const float offset[3] = {0.5f, 0.5f, 0.5f};
+  Mesh *result = mesh_cubes_boolean(offset, -1.0f, eBooleanModifierOp_Difference);
+  EXPECT_TRUE(mesh_is_manifold(result));
+  EXPECT_NEAR(mesh_volume(result), 8.0 - 1.5 * 1.5 * 1.5, 1e-5);
+
+  int materials_len[4] = {0, 0, 0, 0};
+  for (int i = 0; i < result->totpoly; i++) {
+    materials_len[result->mpoly[i].mat_nr]++;
+  }
+  EXPECT_EQ(materials_len[0], 0);
+  EXPECT_GT(materials_len[1], 0);
+  EXPECT_GT(materials_len[3], 0);
+  BKE_id_free(nullptr, result);
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,182 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_flathash.h"
+}
+
+#define TESTCASE_SIZE 10000
+
+/* Unique keys in a scrambled order, multiplying by an odd number is a permutation. */
+static unsigned int test_key(const unsigned int i)
+{
+  return (i + 1) * 2654435761u;
+}
+
+TEST(flathash, InsertLookup)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_flathash_insert(fh, POINTER_FROM_UINT(test_key(i)), POINTER_FROM_UINT(i));
+  }
+  EXPECT_EQ(BLI_flathash_len(fh), TESTCASE_SIZE);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    void *v = BLI_flathash_lookup(fh, POINTER_FROM_UINT(test_key(i)));
+    EXPECT_EQ(POINTER_AS_UINT(v), i);
+  }
+  EXPECT_EQ(BLI_flathash_lookup_p(fh, POINTER_FROM_UINT(test_key(TESTCASE_SIZE))), nullptr);
+
+  BLI_flathash_free(fh, NULL, NULL);
+}
+
+/* Removing keys must keep all other keys reachable, also when the removed slots are reused. */
+TEST(flathash, InsertRemove)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  for (int pass = 0; pass < 3; pass++) {
+    for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+      BLI_flathash_insert(fh, POINTER_FROM_UINT(test_key(i)), POINTER_FROM_UINT(i));
+    }
+    for (unsigned int i = 0; i < TESTCASE_SIZE; i += 2) {
+      void *v = BLI_flathash_popkey(fh, POINTER_FROM_UINT(test_key(i)), NULL);
+      EXPECT_EQ(POINTER_AS_UINT(v), i);
+    }
+    EXPECT_EQ(BLI_flathash_len(fh), TESTCASE_SIZE / 2);
+    EXPECT_FALSE(BLI_flathash_remove(fh, POINTER_FROM_UINT(test_key(0)), NULL, NULL));
+
+    for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+      void **v_p = BLI_flathash_lookup_p(fh, POINTER_FROM_UINT(test_key(i)));
+      if (i % 2) {
+        ASSERT_NE(v_p, nullptr);
+        EXPECT_EQ(POINTER_AS_UINT(*v_p), i);
+      }
+      else {
+        EXPECT_EQ(v_p, nullptr);
+      }
+    }
+    for (unsigned int i = 1; i < TESTCASE_SIZE; i += 2) {
+      EXPECT_TRUE(BLI_flathash_remove(fh, POINTER_FROM_UINT(test_key(i)), NULL, NULL));
+    }
+    EXPECT_EQ(BLI_flathash_len(fh), 0);
+  }
+
+  BLI_flathash_free(fh, NULL, NULL);
+}
+
+TEST(flathash, ReinsertEnsure)
+{
+  FlatHash *fh = BLI_flathash_int_new(__func__);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    EXPECT_TRUE(BLI_flathash_reinsert(
+        fh, POINTER_FROM_UINT(test_key(i)), POINTER_FROM_UINT(i), NULL, NULL));
+  }
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    EXPECT_FALSE(BLI_flathash_reinsert(
+        fh, POINTER_FROM_UINT(test_key(i)), POINTER_FROM_UINT(i + 1), NULL, NULL));
+  }
+  EXPECT_EQ(BLI_flathash_len(fh), TESTCASE_SIZE);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE * 2; i++) {
+    void **v_p;
+    if (BLI_flathash_ensure_p(fh, POINTER_FROM_UINT(test_key(i)), &v_p)) {
+      EXPECT_EQ(POINTER_AS_UINT(*v_p), i + 1);
+    }
+    else {
+      EXPECT_GE(i, TESTCASE_SIZE);
+      *v_p = POINTER_FROM_UINT(i + 1);
+    }
+  }
+  EXPECT_EQ(BLI_flathash_len(fh), TESTCASE_SIZE * 2);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE * 2; i++) {
+    void *v = BLI_flathash_lookup(fh, POINTER_FROM_UINT(test_key(i)));
+    EXPECT_EQ(POINTER_AS_UINT(v), i + 1);
+  }
+
+  BLI_flathash_free(fh, NULL, NULL);
+}
+
+/* The iterator visits every entry exactly once. */
+TEST(flathash, Iterator)
+{
+  FlatHash *fh = BLI_flathash_int_new_ex(__func__, TESTCASE_SIZE);
+
+  unsigned int sum = 0;
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_flathash_insert(fh, POINTER_FROM_UINT(test_key(i)), POINTER_FROM_UINT(i));
+    sum += i;
+  }
+
+  FlatHashIterator fh_iter;
+  unsigned int count = 0;
+  FLATHASH_ITER (fh_iter, fh) {
+    const unsigned int i = POINTER_AS_UINT(BLI_flathashIterator_getValue(&fh_iter));
+    EXPECT_EQ(POINTER_AS_UINT(BLI_flathashIterator_getKey(&fh_iter)), test_key(i));
+    sum -= i;
+    count++;
+  }
+  EXPECT_EQ(count, TESTCASE_SIZE);
+  EXPECT_EQ(sum, 0);
+
+  BLI_flathash_clear(fh, NULL, NULL);
+  EXPECT_EQ(BLI_flathash_len(fh), 0);
+  EXPECT_FALSE(BLI_flathash_haskey(fh, POINTER_FROM_UINT(test_key(0))));
+
+  BLI_flathash_free(fh, NULL, NULL);
+}
+
+TEST(flathash, StringKeys)
+{
+  FlatHash *fh = BLI_flathash_str_new(__func__);
+  char keys[][8] = {"one", "two", "three", "four"};
+
+  for (int i = 0; i < ARRAY_SIZE(keys); i++) {
+    BLI_flathash_insert(fh, keys[i], POINTER_FROM_INT(i));
+  }
+  /* Lookup with copies of the keys. */
+  EXPECT_EQ(POINTER_AS_INT(BLI_flathash_lookup(fh, "three")), 2);
+  EXPECT_EQ(POINTER_AS_INT(BLI_flathash_lookup_default(fh, "five", POINTER_FROM_INT(-1))), -1);
+
+  BLI_flathash_free(fh, NULL, NULL);
+}
+
+TEST(flatset, AddRemove)
+{
+  FlatSet *fs = BLI_flatset_int_new(__func__);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    EXPECT_TRUE(BLI_flatset_add(fs, POINTER_FROM_UINT(test_key(i))));
+  }
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    EXPECT_FALSE(BLI_flatset_add(fs, POINTER_FROM_UINT(test_key(i))));
+  }
+  EXPECT_EQ(BLI_flatset_len(fs), TESTCASE_SIZE);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i += 3) {
+    EXPECT_TRUE(BLI_flatset_remove(fs, POINTER_FROM_UINT(test_key(i)), NULL));
+  }
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    EXPECT_EQ(BLI_flatset_haskey(fs, POINTER_FROM_UINT(test_key(i))), (i % 3) != 0);
+  }
+
+  FlatSetIterator fs_iter;
+  unsigned int count = 0;
+  FLATSET_ITER (fs_iter, fs) {
+    EXPECT_TRUE(BLI_flatset_haskey(fs, BLI_flatsetIterator_getKey(&fs_iter)));
+    count++;
+  }
+  EXPECT_EQ(count, BLI_flatset_len(fs));
+
+  BLI_flatset_clear(fs, NULL);
+  EXPECT_EQ(BLI_flatset_len(fs), 0);
+  BLI_flatset_insert(fs, POINTER_FROM_UINT(test_key(0)));
+  EXPECT_TRUE(BLI_flatset_haskey(fs, POINTER_FROM_UINT(test_key(0))));
+
+  BLI_flatset_free(fs, NULL);
+}
@@ -9,9 +9,11 @@
 
 extern "C" {
 #include "BLI_utildefines.h"
+#include "BLI_flathash.h"
 #include "BLI_ghash.h"
 #include "BLI_rand.h"
 #include "BLI_string.h"
+#include "PIL_time.h"
 #include "PIL_time_utildefines.h"
 }
 
@@ -554,3 +556,107 @@ TEST(ghash, MultiRandIntMurmur2a200000)
 
   multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - Murmur2a - 200000", 200000);
 }
+
+/* GHash vs. FlatHash: throughput of the chaining and the open addressing tables,
+ * with the same keys and hash function. */
+
+static void print_throughput(const char *id, const char *step, const unsigned int nbr, double time)
+{
+  printf("\t%s %s: %.2f M/s (%fs)\n", id, step, (double)nbr / time * 1e-6, time);
+}
+
+static void ghash_flathash_tests(const char *id, const unsigned int nbr)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  /* Unique keys in a scrambled order, multiplying by an odd number is a permutation. */
+  unsigned int *data = (unsigned int *)MEM_mallocN(sizeof(*data) * (size_t)nbr, __func__);
+  for (unsigned int i = 0; i < nbr; i++) {
+    data[i] = i * 2654435761u;
+  }
+
+  {
+    GHash *ghash = BLI_ghash_int_new(__func__);
+
+    double time = PIL_check_seconds_timer();
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_ghash_insert(ghash, POINTER_FROM_UINT(data[i]), POINTER_FROM_UINT(i));
+    }
+    print_throughput("GHash", "insert", nbr, PIL_check_seconds_timer() - time);
+
+    time = PIL_check_seconds_timer();
+    for (unsigned int i = 0; i < nbr; i++) {
+      void *v = BLI_ghash_lookup(ghash, POINTER_FROM_UINT(data[i]));
+      EXPECT_EQ(POINTER_AS_UINT(v), i);
+    }
+    print_throughput("GHash", "lookup", nbr, PIL_check_seconds_timer() - time);
+
+    time = PIL_check_seconds_timer();
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_FALSE(BLI_ghash_haskey(ghash, POINTER_FROM_UINT(data[i] + 1)));
+    }
+    print_throughput("GHash", "lookup (missing)", nbr, PIL_check_seconds_timer() - time);
+
+    time = PIL_check_seconds_timer();
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_ghash_remove(ghash, POINTER_FROM_UINT(data[i]), NULL, NULL);
+    }
+    print_throughput("GHash", "remove", nbr, PIL_check_seconds_timer() - time);
+    EXPECT_EQ(BLI_ghash_len(ghash), 0);
+
+    BLI_ghash_free(ghash, NULL, NULL);
+  }
+
+  {
+    FlatHash *fh = BLI_flathash_int_new(__func__);
+
+    double time = PIL_check_seconds_timer();
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_flathash_insert(fh, POINTER_FROM_UINT(data[i]), POINTER_FROM_UINT(i));
+    }
+    print_throughput("FlatHash", "insert", nbr, PIL_check_seconds_timer() - time);
+
+    time = PIL_check_seconds_timer();
+    for (unsigned int i = 0; i < nbr; i++) {
+      void *v = BLI_flathash_lookup(fh, POINTER_FROM_UINT(data[i]));
+      EXPECT_EQ(POINTER_AS_UINT(v), i);
+    }
+    print_throughput("FlatHash", "lookup", nbr, PIL_check_seconds_timer() - time);
+
+    time = PIL_check_seconds_timer();
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_FALSE(BLI_flathash_haskey(fh, POINTER_FROM_UINT(data[i] + 1)));
+    }
+    print_throughput("FlatHash", "lookup (missing)", nbr, PIL_check_seconds_timer() - time);
+
+    time = PIL_check_seconds_timer();
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_flathash_remove(fh, POINTER_FROM_UINT(data[i]), NULL, NULL);
+    }
+    print_throughput("FlatHash", "remove", nbr, PIL_check_seconds_timer() - time);
+    EXPECT_EQ(BLI_flathash_len(fh), 0);
+
+    BLI_flathash_free(fh, NULL, NULL);
+  }
+
+  MEM_freeN(data);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, IntGHashFlatHash1000000)
+{
+  ghash_flathash_tests("IntGHash vs. FlatHash - 1000000", 1000000);
+}
+
+#ifdef GHASH_RUN_BIG
+TEST(ghash, IntGHashFlatHash10000000)
+{
+  ghash_flathash_tests("IntGHash vs. FlatHash - 10000000", 10000000);
+}
+
+TEST(ghash, IntGHashFlatHash100000000)
+{
+  ghash_flathash_tests("IntGHash vs. FlatHash - 100000000", 100000000);
+}
+#endif
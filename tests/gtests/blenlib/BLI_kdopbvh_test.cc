@@ -11,6 +11,7 @@ extern "C" {
 #include "BLI_kdopbvh.h"
 #include "BLI_rand.h"
 #include "BLI_math_vector.h"
+#include "BLI_threads.h"
 }
 
 #include "stubs/bf_intern_eigen_stubs.h"
@@ -136,3 +137,195 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/**
+ * Cast rays at small boxes around random points,
+ * casting them in packets must give the same hits as casting them one by one.
+ */
+static int ray_cast_packet_test(int points_len, int rays_len, float radius, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 4, 6);
+
+  for (int i = 0; i < points_len; i++) {
+    float co[3], box[2][3];
+    rng_v3_round(co, 3, rng, 1000, 1.0f);
+    copy_v3_v3(box[0], co);
+    copy_v3_v3(box[1], co);
+    add_v3_fl(box[0], -0.01f);
+    add_v3_fl(box[1], 0.01f);
+    BLI_bvhtree_insert(tree, i, box[0], 2);
+  }
+  BLI_bvhtree_balance(tree);
+
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(*co) * rays_len, __func__);
+  float(*dir)[3] = (float(*)[3])MEM_mallocN(sizeof(*dir) * rays_len, __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * rays_len, __func__);
+
+  for (int i = 0; i < rays_len; i++) {
+    rng_v3_round(co[i], 3, rng, 1000, 2.0f);
+    BLI_rng_get_float_unit_v3(rng, dir[i]);
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+  /* Axis aligned rays take a different path. */
+  copy_v3_fl3(dir[0], 0.0f, 0.0f, 1.0f);
+
+  BLI_bvhtree_ray_cast_packet(
+      tree, co, dir, rays_len, radius, hits, NULL, NULL, BVH_RAYCAST_USE_THREADING);
+
+  int hits_len = 0;
+  for (int i = 0; i < rays_len; i++) {
+    BVHTreeRayHit hit;
+    hit.index = -1;
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast_ex(tree, co[i], dir[i], radius, &hit, NULL, NULL, BVH_RAYCAST_DEFAULT);
+
+    EXPECT_EQ(hit.index, hits[i].index);
+    if (hit.index != -1) {
+      EXPECT_EQ(hit.dist, hits[i].dist);
+      hits_len++;
+    }
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(co);
+  MEM_freeN(dir);
+  MEM_freeN(hits);
+  return hits_len;
+}
+
+TEST(kdopbvh, RayCastPacket_1)
+{
+  BLI_threadapi_init();
+  ray_cast_packet_test(500, 1, 0.0f, 1234);
+  BLI_threadapi_exit();
+}
+TEST(kdopbvh, RayCastPacket_2000)
+{
+  BLI_threadapi_init();
+  EXPECT_GT(ray_cast_packet_test(500, 2003, 0.0f, 123), 0);
+  BLI_threadapi_exit();
+}
+TEST(kdopbvh, RayCastPacketRadius_2000)
+{
+  BLI_threadapi_init();
+  EXPECT_GT(ray_cast_packet_test(500, 2003, 0.01f, 12), 0);
+  BLI_threadapi_exit();
+}
+
+TEST(kdopbvh, FindNearestBatch_500)
+{
+  BLI_threadapi_init();
+  struct RNG *rng = BLI_rng_new(12);
+  const int points_len = 500;
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(*points) * points_len, __func__);
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_mallocN(sizeof(*nearest) * points_len,
+                                                          __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+    nearest[i].index = -1;
+    nearest[i].dist_sq = FLT_MAX;
+  }
+  BLI_bvhtree_balance(tree);
+
+  BLI_bvhtree_find_nearest_batch(
+      tree, points, points_len, nearest, NULL, NULL, BVH_NEAREST_USE_THREADING);
+
+  for (int i = 0; i < points_len; i++) {
+    EXPECT_EQ(BLI_bvhtree_find_nearest(tree, points[i], NULL, NULL, NULL), nearest[i].index);
+    EXPECT_EQ_ARRAY(points[i], points[nearest[i].index], 3);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(nearest);
+  BLI_threadapi_exit();
+}
+
+static int refit_points_cb(void *userdata, int index, float r_co[4][3])
+{
+  const float(*points)[3] = (const float(*)[3])userdata;
+  copy_v3_v3(r_co[0], points[index]);
+  return 1;
+}
+
+/**
+ * Move all points and update the tree (node by node or with a refit callback),
+ * nearest queries must give the same result as on a tree built from the moved points.
+ */
+static void update_tree_test(int points_len, int random_seed, bool use_refit = false)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 4, 8);
+  BVHTree *tree_moved = BLI_bvhtree_new(points_len, 0.0, 4, 8);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(*points) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 10000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  for (int i = 0; i < points_len; i++) {
+    float offset[3];
+    rng_v3_round(offset, 3, rng, 10000, 0.1f);
+    add_v3_v3(points[i], offset);
+    if (!use_refit) {
+      BLI_bvhtree_update_node(tree, i, points[i], NULL, 1);
+    }
+    BLI_bvhtree_insert(tree_moved, i, points[i], 1);
+  }
+  if (use_refit) {
+    BLI_bvhtree_refit(tree, refit_points_cb, points);
+  }
+  else {
+    BLI_bvhtree_update_tree(tree);
+  }
+  BLI_bvhtree_balance(tree_moved);
+
+  for (int i = 0; i < points_len; i += 7) {
+    BVHTreeNearest nearest, nearest_moved;
+    nearest.index = nearest_moved.index = -1;
+    nearest.dist_sq = nearest_moved.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, points[i], &nearest, NULL, NULL);
+    BLI_bvhtree_find_nearest(tree_moved, points[i], &nearest_moved, NULL, NULL);
+    EXPECT_EQ(nearest.dist_sq, nearest_moved.dist_sq);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_bvhtree_free(tree_moved);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, UpdateTree_500)
+{
+  BLI_threadapi_init();
+  update_tree_test(500, 12);
+  BLI_threadapi_exit();
+}
+TEST(kdopbvh, UpdateTree_50000)
+{
+  BLI_threadapi_init();
+  update_tree_test(50000, 123);
+  BLI_threadapi_exit();
+}
+
+TEST(kdopbvh, RefitTree_500)
+{
+  BLI_threadapi_init();
+  update_tree_test(500, 12, true);
+  BLI_threadapi_exit();
+}
+TEST(kdopbvh, RefitTree_50000)
+{
+  BLI_threadapi_init();
+  update_tree_test(50000, 123, true);
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,235 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_kdtree.h"
+#include "BLI_rand.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_RUN_AVERAGED 10
+
+static float (*points_random(const int points_len, const uint seed))[3]
+{
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(*points) * points_len, __func__);
+  RNG *rng = BLI_rng_new(seed);
+  for (int i = 0; i < points_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, points[i]);
+  }
+  BLI_rng_free(rng);
+  return points;
+}
+
+static KDTree_3d *tree_create(const float (*points)[3], const int points_len)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_len);
+  for (int i = 0; i < points_len; i++) {
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  return tree;
+}
+
+/* *** Balancing. *** */
+
+static void kdtree_balance_test_do(const char *id, const int points_len)
+{
+  BLI_threadapi_init();
+  float(*points)[3] = points_random(points_len, 0);
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    KDTree_3d *tree = BLI_kdtree_3d_new(points_len);
+    for (int j = 0; j < points_len; j++) {
+      BLI_kdtree_3d_insert(tree, j, points[j]);
+    }
+    const double init_time = PIL_check_seconds_timer();
+    BLI_kdtree_3d_balance(tree);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+
+    /* Every point must be found again. */
+    for (int j = 0; j < points_len; j += 97) {
+      KDTreeNearest_3d nearest;
+      BLI_kdtree_3d_find_nearest(tree, points[j], &nearest);
+      EXPECT_EQ(nearest.dist, 0.0f);
+    }
+    BLI_kdtree_3d_free(tree);
+  }
+
+  printf("\t%s: balanced %d points in %fs on average over %d runs\n",
+         id,
+         points_len,
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  MEM_freeN(points);
+  BLI_threadapi_exit();
+}
+
+TEST(kdtree, Balance100K)
+{
+  kdtree_balance_test_do("Balance - 100K points", 100000);
+}
+
+TEST(kdtree, Balance1000K)
+{
+  kdtree_balance_test_do("Balance - 1000K points", 1000000);
+}
+
+/* *** Batched queries. *** */
+
+static void kdtree_find_nearest_batch_test_do(const char *id,
+                                              const int points_len,
+                                              const int queries_len)
+{
+  BLI_threadapi_init();
+  float(*points)[3] = points_random(points_len, 0);
+  float(*queries)[3] = points_random(queries_len, 1);
+  KDTree_3d *tree = tree_create(points, points_len);
+
+  KDTreeNearest_3d *nearest_serial = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(*nearest_serial) * queries_len, __func__);
+  KDTreeNearest_3d *nearest_batch = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(*nearest_batch) * queries_len, __func__);
+
+  double averaged_timing_serial = 0.0, averaged_timing_batch = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    double init_time = PIL_check_seconds_timer();
+    for (int j = 0; j < queries_len; j++) {
+      BLI_kdtree_3d_find_nearest(tree, queries[j], &nearest_serial[j]);
+    }
+    averaged_timing_serial += PIL_check_seconds_timer() - init_time;
+
+    init_time = PIL_check_seconds_timer();
+    BLI_kdtree_3d_find_nearest_batch(tree, queries, (uint)queries_len, nearest_batch);
+    averaged_timing_batch += PIL_check_seconds_timer() - init_time;
+  }
+
+  for (int j = 0; j < queries_len; j++) {
+    EXPECT_EQ(nearest_serial[j].index, nearest_batch[j].index);
+    EXPECT_EQ(nearest_serial[j].dist, nearest_batch[j].dist);
+  }
+
+  printf("\t%s: serial done in %fs, batch done in %fs on average over %d runs\n",
+         id,
+         averaged_timing_serial / NUM_RUN_AVERAGED,
+         averaged_timing_batch / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  MEM_freeN(nearest_serial);
+  MEM_freeN(nearest_batch);
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(points);
+  MEM_freeN(queries);
+  BLI_threadapi_exit();
+}
+
+TEST(kdtree, FindNearestBatch100K)
+{
+  kdtree_find_nearest_batch_test_do("Find nearest - 100K points, 100K queries", 100000, 100000);
+}
+
+TEST(kdtree, FindNearestBatch1000K)
+{
+  kdtree_find_nearest_batch_test_do(
+      "Find nearest - 1000K points, 1000K queries", 1000000, 1000000);
+}
+
+static void kdtree_range_search_batch_test_do(const char *id,
+                                              const int points_len,
+                                              const int queries_len,
+                                              const float range)
+{
+  BLI_threadapi_init();
+  float(*points)[3] = points_random(points_len, 0);
+  float(*queries)[3] = points_random(queries_len, 1);
+  KDTree_3d *tree = tree_create(points, points_len);
+
+  KDTreeNearest_3d **nearest_batch = (KDTreeNearest_3d **)MEM_mallocN(
+      sizeof(*nearest_batch) * queries_len, __func__);
+  int *nearest_batch_len = (int *)MEM_mallocN(sizeof(*nearest_batch_len) * queries_len,
+                                              __func__);
+
+  double averaged_timing_serial = 0.0, averaged_timing_batch = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    double init_time = PIL_check_seconds_timer();
+    int found_serial = 0;
+    for (int j = 0; j < queries_len; j++) {
+      KDTreeNearest_3d *nearest = NULL;
+      found_serial += BLI_kdtree_3d_range_search(tree, queries[j], &nearest, range);
+      MEM_SAFE_FREE(nearest);
+    }
+    averaged_timing_serial += PIL_check_seconds_timer() - init_time;
+
+    init_time = PIL_check_seconds_timer();
+    BLI_kdtree_3d_range_search_batch(
+        tree, queries, (uint)queries_len, range, nearest_batch, nearest_batch_len);
+    averaged_timing_batch += PIL_check_seconds_timer() - init_time;
+
+    int found_batch = 0;
+    for (int j = 0; j < queries_len; j++) {
+      found_batch += nearest_batch_len[j];
+      for (int k = 0; k < nearest_batch_len[j]; k++) {
+        EXPECT_LE(nearest_batch[j][k].dist, range);
+      }
+      MEM_SAFE_FREE(nearest_batch[j]);
+    }
+    EXPECT_EQ(found_serial, found_batch);
+  }
+
+  printf("\t%s: serial done in %fs, batch done in %fs on average over %d runs\n",
+         id,
+         averaged_timing_serial / NUM_RUN_AVERAGED,
+         averaged_timing_batch / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  MEM_freeN(nearest_batch);
+  MEM_freeN(nearest_batch_len);
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(points);
+  MEM_freeN(queries);
+  BLI_threadapi_exit();
+}
+
+TEST(kdtree, RangeSearchBatch100K)
+{
+  kdtree_range_search_batch_test_do(
+      "Range search - 100K points, 100K queries", 100000, 100000, 0.05f);
+}
+
+TEST(kdtree, RangeSearchBatch1000K)
+{
+  kdtree_range_search_batch_test_do(
+      "Range search - 1000K points, 100K queries", 1000000, 100000, 0.02f);
+}
+
+/* Empty trees report nothing found for every query. */
+TEST(kdtree, BatchEmptyTree)
+{
+  BLI_threadapi_init();
+  KDTree_3d *tree = BLI_kdtree_3d_new(0);
+  BLI_kdtree_3d_balance(tree);
+
+  const float queries[2][3] = {{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}};
+  KDTreeNearest_3d nearest[2];
+  BLI_kdtree_3d_find_nearest_batch(tree, queries, 2, nearest);
+  EXPECT_EQ(nearest[0].index, -1);
+  EXPECT_EQ(nearest[1].index, -1);
+
+  KDTreeNearest_3d *nearest_range[2];
+  int nearest_range_len[2];
+  BLI_kdtree_3d_range_search_batch(tree, queries, 2, 1.0f, nearest_range, nearest_range_len);
+  EXPECT_EQ(nearest_range_len[0], 0);
+  EXPECT_EQ(nearest_range[1], nullptr);
+
+  BLI_kdtree_3d_free(tree);
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,108 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <stdio.h>
+#include <vector>
+
+#ifndef WIN32
+#  include <unistd.h>
+#endif
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_mmap.h"
+}
+
+#ifndef WIN32
+
+#  define FILE_SIZE (1 << 16)
+
+static FILE *mmap_test_file_create(void)
+{
+  FILE *fp = tmpfile();
+  std::vector<char> data(FILE_SIZE);
+  for (int i = 0; i < FILE_SIZE; i++) {
+    data[i] = (char)(i % 251);
+  }
+  fwrite(&data[0], 1, data.size(), fp);
+  fflush(fp);
+  return fp;
+}
+
+TEST(mmap, Read)
+{
+  FILE *fp = mmap_test_file_create();
+  BLI_mmap_file *file = BLI_mmap_open(fileno(fp));
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(BLI_mmap_get_length(file), FILE_SIZE);
+
+  char buffer[16];
+  EXPECT_TRUE(BLI_mmap_read(file, buffer, 1000, sizeof(buffer)));
+  EXPECT_EQ(buffer[0], (char)(1000 % 251));
+  EXPECT_FALSE(BLI_mmap_read(file, buffer, FILE_SIZE - 8, sizeof(buffer)));
+  EXPECT_FALSE(BLI_mmap_has_io_error(file));
+
+  BLI_mmap_free(file);
+  fclose(fp);
+}
+
+/* Reading pages of a file which was truncated after mapping it faults, the fault is caught and
+ * reported as an error instead of crashing. */
+TEST(mmap, ReadTruncated)
+{
+  FILE *fp = mmap_test_file_create();
+  BLI_mmap_file *file = BLI_mmap_open(fileno(fp));
+  ASSERT_NE(file, nullptr);
+
+  /* Other open files must not be affected. */
+  FILE *fp_other = mmap_test_file_create();
+  BLI_mmap_file *file_other = BLI_mmap_open(fileno(fp_other));
+  ASSERT_NE(file_other, nullptr);
+
+  ASSERT_EQ(ftruncate(fileno(fp), 0), 0);
+
+  char buffer[16];
+  EXPECT_FALSE(BLI_mmap_read(file, buffer, FILE_SIZE / 2, sizeof(buffer)));
+  EXPECT_TRUE(BLI_mmap_has_io_error(file));
+
+  EXPECT_TRUE(BLI_mmap_read(file_other, buffer, FILE_SIZE / 2, sizeof(buffer)));
+  EXPECT_FALSE(BLI_mmap_has_io_error(file_other));
+
+  BLI_mmap_free(file);
+  BLI_mmap_free(file_other);
+  fclose(fp);
+  fclose(fp_other);
+}
+
+/* Files are opened and freed in a different order, the regions used by the signal handler are
+ * reused. */
+TEST(mmap, OpenFreeMany)
+{
+  std::vector<FILE *> fps;
+  std::vector<BLI_mmap_file *> files;
+  for (int run = 0; run < 4; run++) {
+    for (int i = 0; i < 100; i++) {
+      FILE *fp = mmap_test_file_create();
+      BLI_mmap_file *file = BLI_mmap_open(fileno(fp));
+      ASSERT_NE(file, nullptr);
+      fps.push_back(fp);
+      files.push_back(file);
+    }
+    for (int i = 0; i < (int)files.size(); i += 2) {
+      BLI_mmap_free(files[i]);
+      fclose(fps[i]);
+    }
+    for (int i = 1; i < (int)files.size(); i += 2) {
+      char buffer[16];
+      EXPECT_TRUE(BLI_mmap_read(files[i], buffer, 0, sizeof(buffer)));
+      BLI_mmap_free(files[i]);
+      fclose(fps[i]);
+    }
+    files.clear();
+    fps.clear();
+  }
+}
+
+#endif /* WIN32 */
@@ -122,6 +122,78 @@ TEST(task, RangeIter1000k)
   task_parallel_range_test_do("Range parallel iteration - Threaded - 1000K items", 1000000, true);
 }
 
+/* *** Task pools with lots of small tasks, stressing scheduler's queues. *** */
+
+static void task_pool_spawn_func(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+  const int depth = POINTER_AS_INT(taskdata);
+  int *count = (int *)BLI_task_pool_userdata(pool);
+
+  if (depth > 0) {
+    for (int i = 0; i < 2; i++) {
+      BLI_task_pool_push_from_thread(pool,
+                                     task_pool_spawn_func,
+                                     POINTER_FROM_INT(depth - 1),
+                                     false,
+                                     TASK_PRIORITY_HIGH,
+                                     threadid);
+    }
+  }
+  task_parallel_range_func(NULL, depth, NULL);
+  atomic_add_and_fetch_uint32((uint32_t *)count, 1);
+}
+
+static void task_pool_contention_test_do(const char *id,
+                                         const int num_threads,
+                                         const int num_roots,
+                                         const int depth)
+{
+  BLI_threadapi_init();
+  TaskScheduler *scheduler = BLI_task_scheduler_create(num_threads);
+  const int num_tasks = num_roots * ((1 << (depth + 1)) - 1);
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    int count = 0;
+    const double init_time = PIL_check_seconds_timer();
+    TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+    for (int j = 0; j < num_roots; j++) {
+      BLI_task_pool_push(
+          pool, task_pool_spawn_func, POINTER_FROM_INT(depth), false, TASK_PRIORITY_HIGH);
+    }
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+
+    EXPECT_EQ(count, num_tasks);
+  }
+
+  printf("\t%s: %d tasks on %d threads done in %fs on average over %d runs\n",
+         id,
+         num_tasks,
+         BLI_task_scheduler_num_threads(scheduler),
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  BLI_task_scheduler_free(scheduler);
+  BLI_threadapi_exit();
+}
+
+TEST(task, PoolContentionFlat)
+{
+  task_pool_contention_test_do("Task pool contention - Flat", 0, 32768, 0);
+}
+
+TEST(task, PoolContentionSpawn)
+{
+  task_pool_contention_test_do("Task pool contention - Nested spawn", 0, 8, 12);
+}
+
+TEST(task, PoolContentionSpawnOversubscribed)
+{
+  task_pool_contention_test_do("Task pool contention - Nested spawn, 16 threads", 16, 8, 12);
+}
+
 /* *** Parallel iterations over double-linked list items. *** */
 
 static void task_listbase_light_iter_func(void *UNUSED(userdata),
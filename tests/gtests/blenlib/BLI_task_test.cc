@@ -13,6 +13,8 @@ extern "C" {
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+
+#include "PIL_time.h"
 };
 
 #define NUM_ITEMS 10000
@@ -65,6 +67,63 @@ TEST(task, RangeIter)
   BLI_threadapi_exit();
 }
 
+/* Iterations of very uneven cost, to exercise adaptive range splitting. */
+#define NUM_ITEMS_UNEVEN 100000
+
+static void task_range_uneven_iter_func(void *userdata,
+                                        int index,
+                                        const TaskParallelTLS *__restrict tls)
+{
+  int *data = (int *)userdata;
+  /* Only last items are expensive. */
+  volatile int dummy = 0;
+  if (index > NUM_ITEMS_UNEVEN - 100) {
+    for (int i = 0; i < 10000; i++) {
+      dummy += i;
+    }
+  }
+  data[index] += 1;
+  *((int64_t *)tls->userdata_chunk) += index;
+}
+
+static void task_range_uneven_finalize_func(void *__restrict userdata,
+                                            void *__restrict userdata_chunk)
+{
+  int64_t *sum = (int64_t *)((int *)userdata + NUM_ITEMS_UNEVEN);
+  *sum += *(int64_t *)userdata_chunk;
+}
+
+TEST(task, RangeIterUneven)
+{
+  BLI_threadapi_init();
+
+  for (int mode = 0; mode < 2; mode++) {
+    int *data = (int *)MEM_callocN(sizeof(int) * NUM_ITEMS_UNEVEN + sizeof(int64_t), __func__);
+    int64_t sum = 0;
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.scheduling_mode = (mode == 0) ? TASK_SCHEDULING_STATIC : TASK_SCHEDULING_DYNAMIC;
+    settings.userdata_chunk = &sum;
+    settings.userdata_chunk_size = sizeof(sum);
+    settings.func_finalize = task_range_uneven_finalize_func;
+
+    BLI_task_parallel_range(0, NUM_ITEMS_UNEVEN, data, task_range_uneven_iter_func, &settings);
+
+    /* Every item is expected to be processed once and only once. */
+    int64_t expected_sum = 0;
+    for (int i = 0; i < NUM_ITEMS_UNEVEN; i++) {
+      EXPECT_EQ(data[i], 1);
+      expected_sum += i;
+    }
+    EXPECT_EQ(*(int64_t *)(data + NUM_ITEMS_UNEVEN), expected_sum);
+
+    MEM_freeN(data);
+  }
+
+  BLI_threadapi_exit();
+}
+
 TEST(task, RangeIterPool)
 {
   const int num_tasks = 10;
@@ -137,6 +196,127 @@ TEST(task, RangeIterPool)
   BLI_threadapi_exit();
 }
 
+/* *** Task pool with tasks spawning sub-tasks. *** */
+
+#define SPAWN_DEPTH 12
+
+static void task_pool_spawn_func(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+  const int depth = POINTER_AS_INT(taskdata);
+  int *count = (int *)BLI_task_pool_userdata(pool);
+
+  if (depth > 0) {
+    for (int i = 0; i < 2; i++) {
+      BLI_task_pool_push_from_thread(pool,
+                                     task_pool_spawn_func,
+                                     POINTER_FROM_INT(depth - 1),
+                                     false,
+                                     TASK_PRIORITY_HIGH,
+                                     threadid);
+    }
+  }
+  atomic_add_and_fetch_uint32((uint32_t *)count, 1);
+}
+
+static void task_pool_spawn_test_do(void)
+{
+  /* Use own scheduler with a fixed number of threads, so work-stealing between
+   * threads is tested regardless of the number of cores. */
+  TaskScheduler *scheduler = BLI_task_scheduler_create(4);
+
+  for (int run = 0; run < 10; run++) {
+    int count = 0;
+    TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+    for (int i = 0; i < 4; i++) {
+      BLI_task_pool_push(
+          pool, task_pool_spawn_func, POINTER_FROM_INT(SPAWN_DEPTH), false, TASK_PRIORITY_HIGH);
+    }
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+
+    /* Every task of the full binary tree is expected to be executed once and only once. */
+    EXPECT_EQ(count, 4 * ((1 << (SPAWN_DEPTH + 1)) - 1));
+  }
+
+  BLI_task_scheduler_free(scheduler);
+}
+
+TEST(task, PoolSpawn)
+{
+  BLI_threadapi_init();
+  task_pool_spawn_test_do();
+  BLI_threadapi_exit();
+}
+
+/* NUMA scheduling falls back to regular scheduling when there is no NUMA. */
+TEST(task, PoolSpawnNUMA)
+{
+  BLI_threadapi_init();
+  BLI_system_numa_scheduling_set(true);
+  task_pool_spawn_test_do();
+  BLI_system_numa_scheduling_set(false);
+  BLI_threadapi_exit();
+}
+
+/* *** Waiting for a pool with tasks of other pools in front of its task. *** */
+
+/* Keeps a thread busy until released, state is the started and the released flag. */
+static void task_pool_block_func(TaskPool *__restrict UNUSED(pool),
+                                 void *taskdata,
+                                 int UNUSED(threadid))
+{
+  int32_t *state = (int32_t *)taskdata;
+  atomic_add_and_fetch_int32(&state[0], 1);
+  while (atomic_add_and_fetch_int32(&state[1], 0) == 0) {
+    PIL_sleep_ms(1);
+  }
+}
+
+static void task_pool_count_func(TaskPool *__restrict pool,
+                                 void *UNUSED(taskdata),
+                                 int UNUSED(threadid))
+{
+  atomic_add_and_fetch_uint32((uint32_t *)BLI_task_pool_userdata(pool), 1);
+}
+
+TEST(task, PoolWaitBuried)
+{
+  BLI_threadapi_init();
+  /* A single worker thread next to the main thread. */
+  TaskScheduler *scheduler = BLI_task_scheduler_create(2);
+
+  /* Keep the worker busy, so tasks pushed below stay where they are. */
+  int32_t block_state[2] = {0, 0};
+  TaskPool *pool_block = BLI_task_pool_create(scheduler, NULL);
+  BLI_task_pool_push(pool_block, task_pool_block_func, block_state, false, TASK_PRIORITY_LOW);
+  while (atomic_add_and_fetch_int32(&block_state[0], 0) == 0) {
+    PIL_sleep_ms(1);
+  }
+
+  /* High priority tasks go to the deque of the main thread, with the task of pool_a in
+   * between the ones of pool_b. */
+  int count_a = 0, count_b = 0;
+  TaskPool *pool_a = BLI_task_pool_create(scheduler, &count_a);
+  TaskPool *pool_b = BLI_task_pool_create(scheduler, &count_b);
+  BLI_task_pool_push(pool_b, task_pool_count_func, NULL, false, TASK_PRIORITY_HIGH);
+  BLI_task_pool_push(pool_a, task_pool_count_func, NULL, false, TASK_PRIORITY_HIGH);
+  BLI_task_pool_push(pool_b, task_pool_count_func, NULL, false, TASK_PRIORITY_HIGH);
+
+  BLI_task_pool_work_and_wait(pool_a);
+  EXPECT_EQ(count_a, 1);
+
+  atomic_add_and_fetch_int32(&block_state[1], 1);
+  BLI_task_pool_work_and_wait(pool_b);
+  EXPECT_EQ(count_b, 2);
+  BLI_task_pool_work_and_wait(pool_block);
+
+  BLI_task_pool_free(pool_a);
+  BLI_task_pool_free(pool_b);
+  BLI_task_pool_free(pool_block);
+  BLI_task_scheduler_free(scheduler);
+  BLI_threadapi_exit();
+}
+
 /* *** Parallel iterations over mempool items. *** */
 
 static void task_mempool_iter_func(void *userdata, MempoolIterData *item)
@@ -0,0 +1,182 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <fcntl.h>
+#include <vector>
+
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include <io.h>
+#endif
+
+#include "zlib.h"
+
+extern "C" {
+#include "BKE_appdir.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+
+#include "intern/blend_compress.h"
+}
+
+/* Larger than a few blocks, and not a multiple of the block size. */
+#define DATA_SIZE ((7 << 20) + 12345)
+
+static std::vector<char> blend_compress_test_data()
+{
+  std::vector<char> data(DATA_SIZE);
+  RNG *rng = BLI_rng_new(0);
+  /* Mix of compressible and random data. */
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (i % 4096 < 1024) ? (char)BLI_rng_get_uint(rng) : (char)(i / 64);
+  }
+  BLI_rng_free(rng);
+  return data;
+}
+
+static std::string blend_compress_test_filepath(const char *name)
+{
+  char filepath[FILE_MAX];
+  BKE_tempdir_init(nullptr);
+  BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), name);
+  return filepath;
+}
+
+static bool blend_compress_test_write(const char *filepath, const std::vector<char> &data)
+{
+  BlendCompressWriter *writer = blo_compress_writer_open(filepath);
+  if (writer == nullptr) {
+    return false;
+  }
+  /* Write in uneven chunks, similar to what writing blend files does. */
+  bool ok = true;
+  size_t offset = 0;
+  for (size_t chunk = 1; offset < data.size(); chunk = (chunk * 3) % 100003) {
+    const size_t len = MIN2(chunk, data.size() - offset);
+    ok &= blo_compress_writer_write(writer, &data[offset], len);
+    offset += len;
+  }
+  ok &= blo_compress_writer_close(writer);
+  return ok;
+}
+
+TEST(blend_compress, RoundTrip)
+{
+  const std::vector<char> data = blend_compress_test_data();
+  const std::string filepath = blend_compress_test_filepath("blend_compress_test.blend");
+  ASSERT_TRUE(blend_compress_test_write(filepath.c_str(), data));
+
+  const int file = BLI_open(filepath.c_str(), O_BINARY | O_RDONLY, 0);
+  ASSERT_NE(file, -1);
+  BlendCompressReader *reader = blo_compress_reader_open(file);
+  ASSERT_NE(reader, nullptr);
+
+  std::vector<char> result(data.size() + 1);
+  size_t offset = 0;
+  for (uint chunk = 1;; chunk = (chunk * 7) % 65537) {
+    const int readsize = blo_compress_reader_read(reader, &result[offset], chunk);
+    ASSERT_GE(readsize, 0);
+    offset += readsize;
+    if (readsize < (int)chunk) {
+      break;
+    }
+  }
+  blo_compress_reader_close(reader);
+  close(file);
+
+  ASSERT_EQ(offset, data.size());
+  result.resize(offset);
+  EXPECT_TRUE(result == data);
+
+  BLI_delete(filepath.c_str(), false, false);
+  BKE_tempdir_session_purge();
+}
+
+/* Blocked files must remain readable as regular gzip streams. */
+TEST(blend_compress, ReadGzip)
+{
+  const std::vector<char> data = blend_compress_test_data();
+  const std::string filepath = blend_compress_test_filepath("blend_compress_test.blend");
+  ASSERT_TRUE(blend_compress_test_write(filepath.c_str(), data));
+
+  gzFile gzfile = (gzFile)BLI_gzopen(filepath.c_str(), "rb");
+  ASSERT_NE(gzfile, (gzFile)Z_NULL);
+  std::vector<char> result(data.size() + 1);
+  const int readsize = gzread(gzfile, &result[0], (uint)result.size());
+  gzclose(gzfile);
+
+  ASSERT_EQ(readsize, (int)data.size());
+  result.resize(readsize);
+  EXPECT_TRUE(result == data);
+
+  BLI_delete(filepath.c_str(), false, false);
+  BKE_tempdir_session_purge();
+}
+
+/* Regular gzip files are left to be read with zlib. */
+TEST(blend_compress, NotBlocked)
+{
+  const std::string filepath = blend_compress_test_filepath("blend_compress_test.blend");
+
+  gzFile gzfile = (gzFile)BLI_gzopen(filepath.c_str(), "wb1");
+  ASSERT_NE(gzfile, (gzFile)Z_NULL);
+  gzwrite(gzfile, "BLENDER-v283", 12);
+  gzclose(gzfile);
+
+  const int file = BLI_open(filepath.c_str(), O_BINARY | O_RDONLY, 0);
+  ASSERT_NE(file, -1);
+  EXPECT_EQ(blo_compress_reader_open(file), nullptr);
+  close(file);
+
+  BLI_delete(filepath.c_str(), false, false);
+  BKE_tempdir_session_purge();
+}
+
+static void blend_compress_test_file_patch(const char *filepath, const long offset, const uint value)
+{
+  FILE *fp = BLI_fopen(filepath, "r+b");
+  ASSERT_NE(fp, nullptr);
+  const uchar bytes[4] = {(uchar)(value & 0xff),
+                          (uchar)((value >> 8) & 0xff),
+                          (uchar)((value >> 16) & 0xff),
+                          (uchar)(value >> 24)};
+  fseek(fp, offset, (offset < 0) ? SEEK_END : SEEK_SET);
+  fwrite(bytes, 1, sizeof(bytes), fp);
+  fclose(fp);
+}
+
+/* Sizes stored in the file are rejected when no block could have them, instead of allocating
+ * whatever the file asks for. */
+TEST(blend_compress, CorruptSizes)
+{
+  const std::vector<char> data(1000, 'b');
+  const std::string filepath = blend_compress_test_filepath("blend_compress_test.blend");
+
+  /* Total member size in the header. */
+  ASSERT_TRUE(blend_compress_test_write(filepath.c_str(), data));
+  blend_compress_test_file_patch(filepath.c_str(), 16, 0x7fffffff);
+  int file = BLI_open(filepath.c_str(), O_BINARY | O_RDONLY, 0);
+  ASSERT_NE(file, -1);
+  EXPECT_EQ(blo_compress_reader_open(file), nullptr);
+  close(file);
+
+  /* Uncompressed block size in the trailer. */
+  ASSERT_TRUE(blend_compress_test_write(filepath.c_str(), data));
+  blend_compress_test_file_patch(filepath.c_str(), -4, 0x7fffffff);
+  file = BLI_open(filepath.c_str(), O_BINARY | O_RDONLY, 0);
+  ASSERT_NE(file, -1);
+  BlendCompressReader *reader = blo_compress_reader_open(file);
+  ASSERT_NE(reader, nullptr);
+  std::vector<char> result(data.size());
+  EXPECT_EQ(blo_compress_reader_read(reader, &result[0], (uint)result.size()), -1);
+  blo_compress_reader_close(reader);
+  close(file);
+
+  BLI_delete(filepath.c_str(), false, false);
+  BKE_tempdir_session_purge();
+}
@@ -0,0 +1,130 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_collection.h"
+#include "BKE_customdata.h"
+#include "BKE_global.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+
+#include "BLO_readfile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_collection_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_RUN_AVERAGED 5
+
+class BlendfileLoadingPerformanceTest : public BlendfileLoadingBaseTest {
+ protected:
+  std::string library_filepath;
+  std::string filepath;
+
+  /* Writes a library file with `num_objects` objects, each with its own mesh of `num_verts`
+   * vertices, and a file linking all of those objects. */
+  void blendfiles_create(const int num_objects, const int num_verts)
+  {
+    char path[FILE_MAX];
+    BKE_tempdir_init(nullptr);
+    BLI_join_dirfile(path, sizeof(path), BKE_tempdir_session(), "load_performance_lib.blend");
+    library_filepath = path;
+    BLI_join_dirfile(path, sizeof(path), BKE_tempdir_session(), "load_performance.blend");
+    filepath = path;
+
+    Main *bmain_lib = BKE_main_new();
+    Collection *collection = BKE_collection_add(bmain_lib, nullptr, "Objects");
+    id_fake_user_set(&collection->id);
+    for (int i = 0; i < num_objects; i++) {
+      char name[MAX_ID_NAME - 2];
+      BLI_snprintf(name, sizeof(name), "Object%d", i);
+
+      Mesh *me = BKE_mesh_add(bmain_lib, name);
+      me->totvert = num_verts;
+      me->mvert = (MVert *)CustomData_add_layer(
+          &me->vdata, CD_MVERT, CD_CALLOC, nullptr, me->totvert);
+
+      Object *ob = BKE_object_add_only_object(bmain_lib, OB_MESH, name);
+      ob->data = me;
+      BKE_collection_object_add(bmain_lib, collection, ob);
+    }
+    ASSERT_TRUE(BLO_write_file(bmain_lib, library_filepath.c_str(), 0, nullptr, nullptr));
+    BKE_main_free(bmain_lib);
+
+    /* Link every object individually, so they are all directly linked. */
+    Main *bmain = BKE_main_new();
+    collection = BKE_collection_add(bmain, nullptr, "Linked");
+    id_fake_user_set(&collection->id);
+    BlendHandle *bh = BLO_blendhandle_from_file(library_filepath.c_str(), nullptr);
+    ASSERT_NE(bh, nullptr);
+    Main *mainl = BLO_library_link_begin(bmain, &bh, library_filepath.c_str());
+    for (int i = 0; i < num_objects; i++) {
+      char name[MAX_ID_NAME - 2];
+      BLI_snprintf(name, sizeof(name), "Object%d", i);
+      Object *ob = (Object *)BLO_library_link_named_part(mainl, &bh, ID_OB, name);
+      ASSERT_NE(ob, nullptr);
+      BKE_collection_object_add(bmain, collection, ob);
+    }
+    BLO_library_link_end(mainl, &bh, 0, bmain, nullptr, nullptr, nullptr);
+    BLO_blendhandle_close(bh);
+    ASSERT_TRUE(BLO_write_file(bmain, filepath.c_str(), 0, nullptr, nullptr));
+    BKE_main_free(bmain);
+  }
+
+  void blendfiles_delete()
+  {
+    BLI_delete(filepath.c_str(), false, false);
+    BLI_delete(library_filepath.c_str(), false, false);
+  }
+
+  void load_performance_test_do(const char *id, const int num_objects, const int num_verts)
+  {
+    blendfiles_create(num_objects, num_verts);
+
+    double averaged_timing = 0.0;
+    for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+      const double init_time = PIL_check_seconds_timer();
+      bfile = BLO_read_from_file(filepath.c_str(), BLO_READ_SKIP_NONE, nullptr);
+      averaged_timing += PIL_check_seconds_timer() - init_time;
+
+      ASSERT_NE(bfile, nullptr);
+      EXPECT_EQ(BLI_listbase_count(&bfile->main->objects), num_objects);
+      blendfile_free();
+    }
+
+    printf("\t%s: %d linked objects with %d vertices loaded in %fs on average over %d runs\n",
+           id,
+           num_objects,
+           num_verts,
+           averaged_timing / NUM_RUN_AVERAGED,
+           NUM_RUN_AVERAGED);
+
+    blendfiles_delete();
+  }
+};
+
+TEST_F(BlendfileLoadingPerformanceTest, LinkedObjectsMany)
+{
+  load_performance_test_do("LinkedObjectsMany", 20000, 8);
+}
+
+TEST_F(BlendfileLoadingPerformanceTest, LinkedObjectsHeavy)
+{
+  load_performance_test_do("LinkedObjectsHeavy", 16, 1000000);
+}
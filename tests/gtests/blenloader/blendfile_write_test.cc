@@ -0,0 +1,188 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_customdata.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_material.h"
+#include "BKE_mesh.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "BLO_readfile.h"
+#include "BLO_undofile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_material_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+}
+
+class BlendfileWriteTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+
+  void TearDown() override
+  {
+    if (bmain) {
+      BKE_main_free(bmain);
+      bmain = nullptr;
+    }
+    /* Back to the default scheduler. */
+    threads_set(0);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  /* Recreate the task scheduler with the given number of threads. */
+  static void threads_set(const int num_threads)
+  {
+    BLI_threadapi_exit();
+    BLI_system_num_threads_override_set(num_threads);
+    BLI_threadapi_init();
+  }
+
+  /* Meshes of varying size, some larger than a single write chunk. */
+  void main_create(const int num_meshes)
+  {
+    bmain = BKE_main_new();
+    RNG *rng = BLI_rng_new(0);
+    for (int i = 0; i < num_meshes; i++) {
+      char name[MAX_ID_NAME - 2];
+      BLI_snprintf(name, sizeof(name), "Mesh%d", i);
+
+      Mesh *me = BKE_mesh_add(bmain, name);
+      me->totvert = (i % 7 == 0) ? 20000 : 10 * i;
+      me->mvert = (MVert *)CustomData_add_layer(
+          &me->vdata, CD_MVERT, CD_CALLOC, nullptr, me->totvert);
+      for (int v = 0; v < me->totvert; v++) {
+        BLI_rng_get_float_unit_v3(rng, me->mvert[v].co);
+      }
+      /* Keep the meshes when writing. */
+      id_us_plus(&me->id);
+    }
+    BLI_rng_free(rng);
+  }
+
+  std::vector<char> file_write(const int num_threads)
+  {
+    char filepath[FILE_MAX];
+    BKE_tempdir_init(nullptr);
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), "write_test.blend");
+
+    threads_set(num_threads);
+    EXPECT_TRUE(BLO_write_file(bmain, filepath, 0, nullptr, nullptr));
+
+    std::ifstream file(filepath, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+    file.close();
+    BLI_delete(filepath, false, false);
+    return data;
+  }
+
+  /* Chunks of memfile undo, as sizes followed by their data. */
+  std::vector<char> memfile_write(const int num_threads)
+  {
+    MemFile memfile = {{nullptr}};
+
+    threads_set(num_threads);
+    EXPECT_TRUE(BLO_write_file_mem(bmain, nullptr, &memfile, 0));
+
+    std::vector<char> data;
+    LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile.chunks) {
+      const char *size = (const char *)&chunk->size;
+      data.insert(data.end(), size, size + sizeof(chunk->size));
+      data.insert(data.end(), chunk->buf, chunk->buf + chunk->size);
+    }
+    BLO_memfile_free(&memfile);
+    return data;
+  }
+};
+
+/* Writing IDs using multiple threads must give the same output as writing serially. */
+TEST_F(BlendfileWriteTest, ThreadedFileIdentical)
+{
+  main_create(100);
+
+  const std::vector<char> data_serial = file_write(1);
+  const std::vector<char> data_threaded = file_write(8);
+
+  ASSERT_FALSE(data_serial.empty());
+  EXPECT_TRUE(data_serial == data_threaded);
+}
+
+TEST_F(BlendfileWriteTest, ThreadedMemfileIdentical)
+{
+  main_create(100);
+
+  const std::vector<char> data_serial = memfile_write(1);
+  const std::vector<char> data_threaded = memfile_write(8);
+
+  ASSERT_FALSE(data_serial.empty());
+  EXPECT_TRUE(data_serial == data_threaded);
+}
+
+/* Reading a memfile back keeps the IDs which are the same as in the current state. */
+TEST_F(BlendfileWriteTest, MemfileUndoKeepsUnchangedIDs)
+{
+  main_create(3);
+  Mesh *me_unchanged = (Mesh *)bmain->meshes.first;
+  Mesh *me_changed = (Mesh *)me_unchanged->id.next;
+  Mesh *me_tagged = (Mesh *)me_changed->id.next;
+
+  Material *ma = BKE_material_add(bmain, "Material");
+  me_unchanged->totcol = 1;
+  me_unchanged->mat = (Material **)MEM_callocN(sizeof(*me_unchanged->mat), __func__);
+  me_unchanged->mat[0] = ma;
+  id_us_plus(&ma->id);
+
+  MemFile memfile_undo = {{nullptr}};
+  ASSERT_TRUE(BLO_write_file_mem(bmain, nullptr, &memfile_undo, 0));
+
+  const float co_undo = me_changed->mvert[0].co[0];
+  me_changed->mvert[0].co[0] += 1.0f;
+  MemFile memfile_current = {{nullptr}};
+  ASSERT_TRUE(BLO_write_file_mem(bmain, &memfile_undo, &memfile_current, 0));
+  me_tagged->id.recalc_after_undo_push = ID_RECALC_GEOMETRY;
+
+  BlendFileData *bfd = BLO_read_from_memfile(
+      bmain, "", &memfile_undo, &memfile_current, BLO_READ_SKIP_USERDEF, nullptr);
+  ASSERT_NE(bfd, nullptr);
+
+  Main *bmain_old = bmain;
+  bmain = bfd->main;
+  bfd->main = nullptr;
+  BLO_blendfiledata_free(bfd);
+
+  EXPECT_EQ(BLI_listbase_count(&bmain->meshes), 3);
+  EXPECT_NE(BLI_findindex(&bmain->meshes, me_unchanged), -1);
+  EXPECT_EQ(BLI_findindex(&bmain->meshes, me_changed), -1);
+  EXPECT_EQ(BLI_findindex(&bmain->meshes, me_tagged), -1);
+
+  /* The kept mesh uses the material of the new state. */
+  EXPECT_EQ(me_unchanged->mat[0], bmain->materials.first);
+  EXPECT_NE(me_unchanged->mat[0], ma);
+  EXPECT_EQ(me_unchanged->mat[0]->id.us, 1);
+
+  Mesh *me_undo = (Mesh *)BKE_libblock_find_name(bmain, ID_ME, me_changed->id.name + 2);
+  ASSERT_NE(me_undo, nullptr);
+  EXPECT_EQ(me_undo->mvert[0].co[0], co_undo);
+
+  BKE_main_free(bmain_old);
+  BLO_memfile_free(&memfile_undo);
+  BLO_memfile_free(&memfile_current);
+}
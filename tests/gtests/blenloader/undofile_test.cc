@@ -0,0 +1,87 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <string.h>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_listbase.h"
+#include "BLI_utildefines.h"
+
+#include "BLO_undofile.h"
+}
+
+static std::vector<char> undofile_test_chunk(const char value, const uint size)
+{
+  return std::vector<char>(size, value);
+}
+
+static MemFileChunk *undofile_test_chunk_at(MemFile *memfile, const int index)
+{
+  return (MemFileChunk *)BLI_findlink(&memfile->chunks, index);
+}
+
+static void undofile_test_memfile_add(MemFile *memfile,
+                                      MemFile *compare,
+                                      const std::vector<std::vector<char>> &chunks)
+{
+  MemFileChunk *compare_chunk = compare ? (MemFileChunk *)compare->chunks.first : nullptr;
+  for (const std::vector<char> &chunk : chunks) {
+    memfile_chunk_add(memfile, chunk.data(), (uint)chunk.size(), &compare_chunk);
+  }
+}
+
+/* Data moved to another position is still shared with the previous step. */
+TEST(undofile, ChunksSharedByContent)
+{
+  const std::vector<char> a = undofile_test_chunk('a', 1000);
+  const std::vector<char> b = undofile_test_chunk('b', 2000);
+  const std::vector<char> c = undofile_test_chunk('c', 3000);
+
+  MemFile memfile_first = {{nullptr}};
+  undofile_test_memfile_add(&memfile_first, nullptr, {a, b});
+  EXPECT_EQ(memfile_first.size, a.size() + b.size());
+
+  MemFile memfile_second = {{nullptr}};
+  undofile_test_memfile_add(&memfile_second, &memfile_first, {c, a, b});
+  EXPECT_EQ(memfile_second.size, c.size());
+
+  EXPECT_FALSE(undofile_test_chunk_at(&memfile_second, 0)->is_identical);
+  EXPECT_TRUE(undofile_test_chunk_at(&memfile_second, 1)->is_identical);
+  EXPECT_EQ(undofile_test_chunk_at(&memfile_second, 1)->buf,
+            undofile_test_chunk_at(&memfile_first, 0)->buf);
+  EXPECT_TRUE(undofile_test_chunk_at(&memfile_second, 2)->is_identical);
+  EXPECT_EQ(undofile_test_chunk_at(&memfile_second, 2)->buf,
+            undofile_test_chunk_at(&memfile_first, 1)->buf);
+
+  BLO_memfile_free(&memfile_first);
+  BLO_memfile_free(&memfile_second);
+}
+
+/* Shared buffers stay valid until the last memfile using them is freed. */
+TEST(undofile, ChunksFreed)
+{
+  const int blocks_in_use = (int)MEM_get_memory_blocks_in_use();
+
+  const std::vector<char> a = undofile_test_chunk('a', 1000);
+  const std::vector<char> b = undofile_test_chunk('b', 2000);
+
+  MemFile memfile_first = {{nullptr}};
+  undofile_test_memfile_add(&memfile_first, nullptr, {a, b});
+  MemFile memfile_second = {{nullptr}};
+  undofile_test_memfile_add(&memfile_second, &memfile_first, {b, a, a});
+
+  BLO_memfile_merge(&memfile_first, &memfile_second);
+  EXPECT_EQ(BLI_listbase_count(&memfile_first.chunks), 0);
+
+  EXPECT_EQ(memcmp(undofile_test_chunk_at(&memfile_second, 0)->buf, b.data(), b.size()), 0);
+  EXPECT_EQ(memcmp(undofile_test_chunk_at(&memfile_second, 1)->buf, a.data(), a.size()), 0);
+  EXPECT_EQ(undofile_test_chunk_at(&memfile_second, 1)->buf,
+            undofile_test_chunk_at(&memfile_second, 2)->buf);
+
+  BLO_memfile_free(&memfile_second);
+  EXPECT_EQ((int)MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
@@ -0,0 +1,183 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "PIL_time.h"
+
+#include "bmesh.h"
+#include "tools/bmesh_intersect.h"
+}
+
+/* Faces of the second operand (the one being subtracted for a difference) are tagged. */
+static int bm_face_isect_pair(BMFace *f, void *UNUSED(user_data))
+{
+  return BM_elem_flag_test(f, BM_ELEM_DRAW) ? 1 : 0;
+}
+
+/* A unit UV sphere with outward pointing faces, rotated so no edges are axis aligned. */
+static void bm_uvsphere_add(BMesh *bm, const int segments, const float offset[3])
+{
+  const int ring_verts = segments * 2;
+  BMVert **verts = (BMVert **)MEM_malloc_arrayN(
+      (size_t)((segments - 1) * ring_verts), sizeof(*verts), __func__);
+  float co[3];
+
+  for (int r = 1; r < segments; r++) {
+    const float theta = (float)M_PI * (float)r / (float)segments;
+    for (int u = 0; u < ring_verts; u++) {
+      const float phi = 2.0f * (float)M_PI * (float)u / (float)ring_verts + 0.3f;
+      co[0] = sinf(theta) * cosf(phi);
+      co[1] = sinf(theta) * sinf(phi);
+      co[2] = -cosf(theta);
+      add_v3_v3(co, offset);
+      verts[(r - 1) * ring_verts + u] = BM_vert_create(bm, co, NULL, BM_CREATE_NOP);
+    }
+  }
+  copy_v3_fl3(co, 0.0f, 0.0f, -1.0f);
+  add_v3_v3(co, offset);
+  BMVert *v_south = BM_vert_create(bm, co, NULL, BM_CREATE_NOP);
+  copy_v3_fl3(co, 0.0f, 0.0f, 1.0f);
+  add_v3_v3(co, offset);
+  BMVert *v_north = BM_vert_create(bm, co, NULL, BM_CREATE_NOP);
+
+  for (int u = 0; u < ring_verts; u++) {
+    const int u_next = (u + 1) % ring_verts;
+    BMVert **ring_first = verts;
+    BMVert **ring_last = verts + (segments - 2) * ring_verts;
+    BM_face_create_quad_tri(
+        bm, v_south, ring_first[u_next], ring_first[u], NULL, NULL, BM_CREATE_NOP);
+    BM_face_create_quad_tri(
+        bm, v_north, ring_last[u], ring_last[u_next], NULL, NULL, BM_CREATE_NOP);
+    for (int r = 0; r < segments - 2; r++) {
+      BMVert **ring = verts + r * ring_verts;
+      BM_face_create_quad_tri(bm,
+                              ring[u],
+                              ring[u_next],
+                              ring[ring_verts + u_next],
+                              ring[ring_verts + u],
+                              NULL,
+                              BM_CREATE_NOP);
+    }
+  }
+  MEM_freeN(verts);
+}
+
+/* Two overlapping spheres, with the faces of the second sphere tagged. */
+static BMesh *bm_spheres_create(const int segments, const bool use_second)
+{
+  BMeshCreateParams create_params = {0};
+  BMesh *bm = BM_mesh_create(&bm_mesh_allocsize_default, &create_params);
+
+  if (use_second) {
+    const float offset_b[3] = {0.7f, 0.15f, 0.1f};
+    bm_uvsphere_add(bm, segments, offset_b);
+    BM_mesh_elem_hflag_enable_all(bm, BM_FACE, BM_ELEM_DRAW, false);
+  }
+  const float offset_a[3] = {0.0f, 0.0f, 0.0f};
+  bm_uvsphere_add(bm, segments, offset_a);
+
+  BM_mesh_normals_update(bm);
+  return bm;
+}
+
+static double bm_boolean_volume(const int segments, const int boolean_mode, double *r_time)
+{
+  BMesh *bm = bm_spheres_create(segments, true);
+
+  const int looptris_tot = poly_to_tri_count(bm->totface, bm->totloop);
+  BMLoop *(*looptris)[3] = (BMLoop * (*)[3]) MEM_malloc_arrayN(
+      (size_t)looptris_tot, sizeof(*looptris), __func__);
+  int tottri;
+  BM_mesh_calc_tessellation_beauty(bm, looptris, &tottri);
+
+  const double init_time = PIL_check_seconds_timer();
+  const bool has_edit = BM_mesh_intersect(bm,
+                                          looptris,
+                                          tottri,
+                                          bm_face_isect_pair,
+                                          NULL,
+                                          false,
+                                          false,
+                                          true,
+                                          true,
+                                          false,
+                                          false,
+                                          boolean_mode,
+                                          1e-6f);
+  if (r_time) {
+    *r_time = PIL_check_seconds_timer() - init_time;
+  }
+  EXPECT_TRUE(has_edit);
+
+  /* Both spheres are closed, so the result must be too. */
+  int totedge_non_manifold = 0;
+  BMEdge *e;
+  BMIter iter;
+  BM_ITER_MESH (e, &iter, bm, BM_EDGES_OF_MESH) {
+    if (!BM_edge_is_manifold(e)) {
+      totedge_non_manifold++;
+    }
+  }
+  EXPECT_EQ(totedge_non_manifold, 0);
+
+  const double volume = BM_mesh_calc_volume(bm, false);
+  MEM_freeN(looptris);
+  BM_mesh_free(bm);
+  return volume;
+}
+
+static double bm_sphere_volume(const int segments)
+{
+  BMesh *bm = bm_spheres_create(segments, false);
+  const double volume = BM_mesh_calc_volume(bm, false);
+  BM_mesh_free(bm);
+  return volume;
+}
+
+/* The results of all three operations are consistent with each other:
+ * the union and intersection add up to both spheres,
+ * the difference and intersection add up to the first sphere. */
+static void boolean_spheres_test_do(const char *id, const int segments)
+{
+  BLI_threadapi_init();
+
+  const double volume_sphere = bm_sphere_volume(segments);
+  double time_isect, time_union, time_difference;
+  const double volume_isect = bm_boolean_volume(
+      segments, BMESH_ISECT_BOOLEAN_ISECT, &time_isect);
+  const double volume_union = bm_boolean_volume(
+      segments, BMESH_ISECT_BOOLEAN_UNION, &time_union);
+  const double volume_difference = bm_boolean_volume(
+      segments, BMESH_ISECT_BOOLEAN_DIFFERENCE, &time_difference);
+
+  EXPECT_GT(volume_isect, 0.1 * volume_sphere);
+  EXPECT_LT(volume_isect, volume_sphere);
+  EXPECT_NEAR(volume_union + volume_isect, volume_sphere * 2.0, volume_sphere * 1e-3);
+  EXPECT_NEAR(volume_difference + volume_isect, volume_sphere, volume_sphere * 1e-3);
+
+  printf("\t%s: intersect in %fs, union in %fs, difference in %fs\n",
+         id,
+         time_isect,
+         time_union,
+         time_difference);
+
+  BLI_threadapi_exit();
+}
+
+TEST(bmesh_boolean, Spheres)
+{
+  boolean_spheres_test_do("Spheres - 2x 8K faces", 64);
+}
+
+TEST(bmesh_boolean, Spheres130K)
+{
+  boolean_spheres_test_do("Spheres - 2x 130K faces", 256);
+}
@@ -0,0 +1,67 @@
+/* Apache License, Version 2.0 */
+
+#include "bmesh_mesh_conv_cases.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_mesh.h"
+
+#include "bmesh.h"
+}
+
+Mesh *mesh_grid_create(const int verts_x)
+{
+  const int quads_x = verts_x - 1;
+  const int totvert = verts_x * verts_x;
+  const int totpoly = quads_x * quads_x;
+  Mesh *me = BKE_mesh_new_nomain(totvert, 0, 0, totpoly * 4, totpoly);
+
+  float *vert_values = (float *)CustomData_add_layer(
+      &me->vdata, CD_PROP_FLT, CD_CALLOC, NULL, totvert);
+  int *poly_values = (int *)CustomData_add_layer(
+      &me->pdata, CD_PROP_INT, CD_CALLOC, NULL, totpoly);
+
+  for (int y = 0; y < verts_x; y++) {
+    for (int x = 0; x < verts_x; x++) {
+      const int i = y * verts_x + x;
+      me->mvert[i].co[0] = (float)x;
+      me->mvert[i].co[1] = (float)y;
+      vert_values[i] = (float)i;
+    }
+  }
+
+  for (int y = 0; y < quads_x; y++) {
+    for (int x = 0; x < quads_x; x++) {
+      const int i = y * quads_x + x;
+      const int v = y * verts_x + x;
+      MLoop *ml = &me->mloop[i * 4];
+      me->mpoly[i].loopstart = i * 4;
+      me->mpoly[i].totloop = 4;
+      ml[0].v = v;
+      ml[1].v = v + 1;
+      ml[2].v = v + verts_x + 1;
+      ml[3].v = v + verts_x;
+      poly_values[i] = i;
+    }
+  }
+
+  BKE_mesh_calc_edges(me, false, false);
+  return me;
+}
+
+BMesh *bmesh_from_mesh(const Mesh *me)
+{
+  const BMAllocTemplate allocsize = BMALLOC_TEMPLATE_FROM_ME(me);
+  BMeshCreateParams create_params = {0};
+  BMesh *bm = BM_mesh_create(&allocsize, &create_params);
+
+  BMeshFromMeshParams convert_params = {0};
+  convert_params.calc_face_normal = true;
+  BM_mesh_bm_from_me(bm, me, &convert_params);
+  return bm;
+}
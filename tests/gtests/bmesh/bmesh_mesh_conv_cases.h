@@ -0,0 +1,16 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __BMESH_MESH_CONV_CASES_H__
+#define __BMESH_MESH_CONV_CASES_H__
+
+struct BMesh;
+struct Mesh;
+
+/* A grid of `verts_x * verts_x` vertices made of quads in the XY plane, with a float vertex layer
+ * and an int polygon layer holding the element indices. */
+struct Mesh *mesh_grid_create(const int verts_x);
+
+/* Convert with face normals calculated, as the bmesh_mesh_conv tests and benchmarks expect. */
+struct BMesh *bmesh_from_mesh(const struct Mesh *me);
+
+#endif /* __BMESH_MESH_CONV_CASES_H__ */
@@ -0,0 +1,58 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "bmesh_mesh_conv_cases.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+
+#include "BKE_library.h"
+
+#include "PIL_time.h"
+
+#include "bmesh.h"
+}
+
+#define NUM_RUN_AVERAGED 5
+
+static void mesh_conv_round_trip_test_do(const char *id, const int verts_x)
+{
+  BLI_threadapi_init();
+  Mesh *me = mesh_grid_create(verts_x);
+
+  double averaged_timing_from_me = 0.0, averaged_timing_to_me = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    double init_time = PIL_check_seconds_timer();
+    BMesh *bm = bmesh_from_mesh(me);
+    averaged_timing_from_me += PIL_check_seconds_timer() - init_time;
+
+    Mesh *me_eval = (Mesh *)BKE_id_new_nomain(ID_ME, NULL);
+    init_time = PIL_check_seconds_timer();
+    BM_mesh_bm_to_me_for_eval(bm, me_eval, NULL);
+    averaged_timing_to_me += PIL_check_seconds_timer() - init_time;
+
+    EXPECT_EQ(me_eval->totpoly, me->totpoly);
+
+    BKE_id_free(NULL, me_eval);
+    BM_mesh_free(bm);
+  }
+
+  printf("\t%s: mesh to bmesh in %fs, bmesh to mesh in %fs on average over %d runs\n",
+         id,
+         averaged_timing_from_me / NUM_RUN_AVERAGED,
+         averaged_timing_to_me / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  BKE_id_free(NULL, me);
+  BLI_threadapi_exit();
+}
+
+TEST(bmesh_mesh_conv_performance, RoundTrip1000K)
+{
+  mesh_conv_round_trip_test_do("Round trip - 1000K vertices", 1000);
+}
@@ -0,0 +1,101 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "bmesh_mesh_conv_cases.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_library.h"
+#include "BKE_mesh.h"
+
+#include "bmesh.h"
+}
+
+static void mesh_expect_equal(const Mesh *me_a, const Mesh *me_b)
+{
+  ASSERT_EQ(me_a->totvert, me_b->totvert);
+  ASSERT_EQ(me_a->totedge, me_b->totedge);
+  ASSERT_EQ(me_a->totloop, me_b->totloop);
+  ASSERT_EQ(me_a->totpoly, me_b->totpoly);
+
+  const float *vert_values_a = (const float *)CustomData_get_layer(&me_a->vdata, CD_PROP_FLT);
+  const float *vert_values_b = (const float *)CustomData_get_layer(&me_b->vdata, CD_PROP_FLT);
+  ASSERT_NE(vert_values_b, nullptr);
+  for (int i = 0; i < me_a->totvert; i++) {
+    EXPECT_EQ(me_a->mvert[i].co[0], me_b->mvert[i].co[0]);
+    EXPECT_EQ(me_a->mvert[i].co[1], me_b->mvert[i].co[1]);
+    EXPECT_EQ(vert_values_a[i], vert_values_b[i]);
+  }
+  for (int i = 0; i < me_a->totedge; i++) {
+    EXPECT_EQ(me_a->medge[i].v1, me_b->medge[i].v1);
+    EXPECT_EQ(me_a->medge[i].v2, me_b->medge[i].v2);
+  }
+  for (int i = 0; i < me_a->totloop; i++) {
+    EXPECT_EQ(me_a->mloop[i].v, me_b->mloop[i].v);
+    EXPECT_EQ(me_a->mloop[i].e, me_b->mloop[i].e);
+  }
+
+  const int *poly_values_a = (const int *)CustomData_get_layer(&me_a->pdata, CD_PROP_INT);
+  const int *poly_values_b = (const int *)CustomData_get_layer(&me_b->pdata, CD_PROP_INT);
+  ASSERT_NE(poly_values_b, nullptr);
+  for (int i = 0; i < me_a->totpoly; i++) {
+    EXPECT_EQ(me_a->mpoly[i].loopstart, me_b->mpoly[i].loopstart);
+    EXPECT_EQ(me_a->mpoly[i].totloop, me_b->mpoly[i].totloop);
+    EXPECT_EQ(poly_values_a[i], poly_values_b[i]);
+  }
+}
+
+/* Large enough for the conversion to run threaded. */
+TEST(bmesh_mesh_conv, RoundTrip)
+{
+  BLI_threadapi_init();
+  Mesh *me = mesh_grid_create(200);
+  BMesh *bm = bmesh_from_mesh(me);
+
+  EXPECT_EQ(bm->totvert, me->totvert);
+  EXPECT_EQ(bm->totedge, me->totedge);
+  EXPECT_EQ(bm->totloop, me->totloop);
+  EXPECT_EQ(bm->totface, me->totpoly);
+
+  BM_mesh_elem_table_ensure(bm, BM_VERT | BM_FACE);
+  for (int i = 0; i < me->totvert; i += 37) {
+    BMVert *v = BM_vert_at_index(bm, i);
+    EXPECT_EQ(v->co[0], me->mvert[i].co[0]);
+    EXPECT_EQ(BM_elem_float_data_get(&bm->vdata, v, CD_PROP_FLT), (float)i);
+  }
+  for (int i = 0; i < me->totpoly; i += 37) {
+    /* Face normals are calculated on conversion. */
+    EXPECT_EQ(BM_face_at_index(bm, i)->no[2], 1.0f);
+  }
+
+  Mesh *me_eval = (Mesh *)BKE_id_new_nomain(ID_ME, NULL);
+  BM_mesh_bm_to_me_for_eval(bm, me_eval, NULL);
+  mesh_expect_equal(me, me_eval);
+
+  const int *poly_origindex = (const int *)CustomData_get_layer(&me_eval->pdata, CD_ORIGINDEX);
+  ASSERT_NE(poly_origindex, nullptr);
+  for (int i = 0; i < me_eval->totpoly; i++) {
+    EXPECT_EQ(poly_origindex[i], i);
+  }
+
+  Mesh *me_copy = BKE_mesh_new_nomain(0, 0, 0, 0, 0);
+  BMeshToMeshParams to_mesh_params = {0};
+  BM_mesh_bm_to_me(NULL, bm, me_copy, &to_mesh_params);
+  mesh_expect_equal(me, me_copy);
+
+  BKE_id_free(NULL, me_copy);
+  BKE_id_free(NULL, me_eval);
+  BM_mesh_free(bm);
+  BKE_id_free(NULL, me);
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,309 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+
+#include "BKE_collection.h"
+#include "BKE_constraint.h"
+#include "BKE_curve.h"
+#include "BKE_layer.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_constraint_types.h"
+#include "DNA_curve_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+}
+
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
+
+/* Everything the builders define about the graph, as strings so differences are readable. */
+struct GraphState {
+  std::set<std::string> id_nodes;
+  std::multiset<std::string> operations;
+  std::multiset<std::string> relations;
+};
+
+static std::string operation_key(const DEG::OperationNode *op_node)
+{
+  const DEG::ComponentNode *comp_node = op_node->owner;
+  return std::string(comp_node->owner->id_orig->name) + " " +
+         DEG::nodeTypeAsString(comp_node->type) + " '" + comp_node->name + "' " +
+         DEG::operationCodeAsString(op_node->opcode) + " '" + op_node->name + "' " +
+         std::to_string(op_node->name_tag);
+}
+
+static std::string node_key(const DEG::Node *node)
+{
+  if (node->type == DEG::NodeType::OPERATION) {
+    return operation_key((const DEG::OperationNode *)node);
+  }
+  return DEG::nodeTypeAsString(node->type);
+}
+
+static GraphState graph_state_get(Depsgraph *depsgraph)
+{
+  const DEG::Depsgraph *deg_graph = (const DEG::Depsgraph *)depsgraph;
+  GraphState state;
+  for (const DEG::IDNode *id_node : deg_graph->id_nodes) {
+    const DEG::DEGCustomDataMeshMasks &masks = id_node->customdata_masks;
+    state.id_nodes.insert(std::string(id_node->id_orig->name) +
+                          " linked: " + std::to_string(id_node->linked_state) +
+                          " visible: " + std::to_string(id_node->is_directly_visible) +
+                          " visible components: " +
+                          std::to_string(id_node->visible_components_mask) +
+                          " eval flags: " + std::to_string(id_node->eval_flags) +
+                          " masks: " + std::to_string(masks.vert_mask) + " " +
+                          std::to_string(masks.edge_mask) + " " + std::to_string(masks.loop_mask) +
+                          " " + std::to_string(masks.poly_mask));
+  }
+  for (const DEG::OperationNode *op_node : deg_graph->operations) {
+    state.operations.insert(operation_key(op_node));
+    for (const DEG::Relation *rel : op_node->inlinks) {
+      /* Cyclic flag depends on the order the relations are visited in. */
+      const int flag = rel->flag & ~DEG::RELATION_FLAG_CYCLIC;
+      state.relations.insert(node_key(rel->from) + " -> " + node_key(rel->to) + " '" + rel->name +
+                             "' " + std::to_string(flag));
+    }
+  }
+  return state;
+}
+
+template<typename T> static void expect_same_elements(const T &result, const T &expected)
+{
+  std::string missing, unexpected;
+  for (const std::string &elem : expected) {
+    if (result.count(elem) < expected.count(elem)) {
+      missing += "\n  " + elem;
+    }
+  }
+  for (const std::string &elem : result) {
+    if (expected.count(elem) < result.count(elem)) {
+      unexpected += "\n  " + elem;
+    }
+  }
+  EXPECT_TRUE(missing.empty()) << "Missing:" << missing;
+  EXPECT_TRUE(unexpected.empty()) << "Unexpected:" << unexpected;
+}
+
+/* An object which gets modifiers and constraints, a target in the view layer and objects which
+ * are only in the graph while something uses them. */
+class DepsgraphIncrementalBuildTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  ViewLayer *view_layer = nullptr;
+  Object *ob = nullptr;
+  Object *ob_other = nullptr;
+  Object *ob_target = nullptr;
+  Object *ob_curve = nullptr;
+  Object *ob_empty = nullptr;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    view_layer = BKE_view_layer_default_view(scene);
+
+    ob = object_add(OB_MESH, "Object", BKE_mesh_add(bmain, "Mesh"), true);
+    ob_other = object_add(OB_MESH, "Other", BKE_mesh_add(bmain, "OtherMesh"), true);
+    ob_target = object_add(OB_MESH, "Target", BKE_mesh_add(bmain, "TargetMesh"), true);
+    /* Not in the scene, only used by modifiers and constraints. */
+    ob_curve = object_add(OB_CURVE, "Curve", BKE_curve_add(bmain, "Curve", OB_CURVE), false);
+    ob_empty = object_add(OB_EMPTY, "Empty", nullptr, false);
+
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  void TearDown() override
+  {
+    BlendfileLoadingBaseTest::TearDown();
+    BKE_main_free(bmain);
+    bmain = nullptr;
+  }
+
+  Object *object_add(const int type, const char *name, void *data, const bool in_scene)
+  {
+    Object *object = BKE_object_add_only_object(bmain, type, name);
+    object->data = data;
+    if (in_scene) {
+      BKE_collection_object_add(bmain, scene->master_collection, object);
+    }
+    return object;
+  }
+
+  CurveModifierData *curve_modifier_add(Object *object)
+  {
+    CurveModifierData *cmd = (CurveModifierData *)modifier_new(eModifierType_Curve);
+    cmd->object = ob_curve;
+    BLI_addtail(&object->modifiers, cmd);
+    return cmd;
+  }
+
+  void modifier_remove(Object *object, ModifierData *md)
+  {
+    BLI_remlink(&object->modifiers, md);
+    modifier_free(md);
+  }
+
+  /* Update the graph after the relations of the ID changed, the same way the editors do.
+   * The graph must be updated without building it again, to the same result as when it is
+   * built from scratch. */
+  void relations_update_test(ID *id)
+  {
+    DEG::Depsgraph *deg_graph = (DEG::Depsgraph *)depsgraph;
+    /* Full rebuild would create a new scene node. */
+    DEG::IDNode *scene_node = deg_graph->find_id_node(&scene->id);
+    scene_node->name = "Kept";
+    std::map<ID *, ID *> id_cow_map;
+    for (const DEG::IDNode *id_node : deg_graph->id_nodes) {
+      id_cow_map[id_node->id_orig] = id_node->id_cow;
+    }
+
+    DEG_id_relations_tag_update(bmain, id);
+    DEG_id_tag_update_ex(bmain, id, ID_RECALC_GEOMETRY);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+
+    /* Nodes which are not rebuilt are kept, and so are the copy-on-write datablocks. */
+    EXPECT_EQ(deg_graph->find_id_node(&scene->id)->name, "Kept");
+    for (const DEG::IDNode *id_node : deg_graph->id_nodes) {
+      std::map<ID *, ID *>::const_iterator it = id_cow_map.find(id_node->id_orig);
+      if (it != id_cow_map.end()) {
+        EXPECT_EQ(id_node->id_cow, it->second) << id_node->id_orig->name;
+      }
+    }
+
+    Depsgraph *depsgraph_full = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph_full, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph_full, bmain);
+
+    const GraphState state = graph_state_get(depsgraph);
+    const GraphState state_full = graph_state_get(depsgraph_full);
+    expect_same_elements(state.id_nodes, state_full.id_nodes);
+    expect_same_elements(state.operations, state_full.operations);
+    expect_same_elements(state.relations, state_full.relations);
+
+    DEG_graph_free(depsgraph_full);
+  }
+
+  Object *object_eval(Object *object)
+  {
+    return DEG_get_evaluated_object(depsgraph, object);
+  }
+};
+
+TEST_F(DepsgraphIncrementalBuildTest, ModifierAddRemove)
+{
+  /* The curve enters the graph and gets evaluated with its path. */
+  CurveModifierData *cmd = curve_modifier_add(ob);
+  relations_update_test(&ob->id);
+  CurveModifierData *cmd_eval = (CurveModifierData *)object_eval(ob)->modifiers.first;
+  EXPECT_EQ(cmd_eval->object, object_eval(ob_curve));
+  EXPECT_NE(cmd_eval->object, ob_curve);
+
+  /* The curve leaves the graph. */
+  modifier_remove(ob, &cmd->modifier);
+  relations_update_test(&ob->id);
+  EXPECT_EQ(object_eval(ob_curve), ob_curve);
+}
+
+TEST_F(DepsgraphIncrementalBuildTest, ModifierSharedTarget)
+{
+  CurveModifierData *cmd_other = curve_modifier_add(ob_other);
+  relations_update_test(&ob_other->id);
+  CurveModifierData *cmd = curve_modifier_add(ob);
+  relations_update_test(&ob->id);
+
+  /* Still used by the other object. */
+  modifier_remove(ob, &cmd->modifier);
+  relations_update_test(&ob->id);
+  EXPECT_NE(object_eval(ob_curve), ob_curve);
+
+  modifier_remove(ob_other, &cmd_other->modifier);
+  relations_update_test(&ob_other->id);
+  EXPECT_EQ(object_eval(ob_curve), ob_curve);
+}
+
+TEST_F(DepsgraphIncrementalBuildTest, ConstraintAddRemove)
+{
+  /* Target in the view layer, its vertex group requests deform vertices from its evaluation. */
+  bConstraint *con = BKE_constraint_add_for_object(ob, "Copy Location", CONSTRAINT_TYPE_LOCLIKE);
+  bLocateLikeConstraint *data = (bLocateLikeConstraint *)con->data;
+  data->tar = ob_target;
+  STRNCPY(data->subtarget, "Group");
+  relations_update_test(&ob->id);
+  bConstraint *con_eval = (bConstraint *)object_eval(ob)->constraints.first;
+  EXPECT_EQ(((bLocateLikeConstraint *)con_eval->data)->tar, object_eval(ob_target));
+
+  /* Target which enters the graph with the constraint. */
+  bConstraint *con_empty = BKE_constraint_add_for_object(
+      ob, "Copy Rotation", CONSTRAINT_TYPE_ROTLIKE);
+  ((bRotateLikeConstraint *)con_empty->data)->tar = ob_empty;
+  relations_update_test(&ob->id);
+  con_eval = (bConstraint *)object_eval(ob)->constraints.last;
+  EXPECT_EQ(((bRotateLikeConstraint *)con_eval->data)->tar, object_eval(ob_empty));
+  EXPECT_NE(object_eval(ob_empty), ob_empty);
+
+  BKE_constraint_remove_ex(&ob->constraints, ob, con, true);
+  relations_update_test(&ob->id);
+  BKE_constraint_remove_ex(&ob->constraints, ob, con_empty, true);
+  relations_update_test(&ob->id);
+  EXPECT_EQ(object_eval(ob_empty), ob_empty);
+}
+
+/* Relations of an object which is only in the graph because it is used by another one. */
+TEST_F(DepsgraphIncrementalBuildTest, IndirectObject)
+{
+  bConstraint *con = BKE_constraint_add_for_object(ob, "Copy Location", CONSTRAINT_TYPE_LOCLIKE);
+  ((bLocateLikeConstraint *)con->data)->tar = ob_empty;
+  relations_update_test(&ob->id);
+
+  CurveModifierData *cmd = curve_modifier_add(ob_empty);
+  bConstraint *con_empty = BKE_constraint_add_for_object(
+      ob_empty, "Copy Location", CONSTRAINT_TYPE_LOCLIKE);
+  ((bLocateLikeConstraint *)con_empty->data)->tar = ob_curve;
+  relations_update_test(&ob_empty->id);
+  EXPECT_NE(object_eval(ob_curve), ob_curve);
+
+  BKE_constraint_remove_ex(&ob_empty->constraints, ob_empty, con_empty, true);
+  relations_update_test(&ob_empty->id);
+  EXPECT_NE(object_eval(ob_curve), ob_curve);
+
+  modifier_remove(ob_empty, &cmd->modifier);
+  relations_update_test(&ob_empty->id);
+  EXPECT_EQ(object_eval(ob_curve), ob_curve);
+
+  /* Everything the object used leaves the graph with it. */
+  BKE_constraint_remove_ex(&ob->constraints, ob, con, true);
+  curve_modifier_add(ob_empty);
+  relations_update_test(&ob->id);
+  EXPECT_EQ(object_eval(ob_empty), ob_empty);
+  EXPECT_EQ(object_eval(ob_curve), ob_curve);
+}
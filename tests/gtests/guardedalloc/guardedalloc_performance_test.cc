@@ -0,0 +1,101 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#define NUM_RUN_AVERAGED 5
+#define NUM_ITERATIONS 2000000
+#define NUM_BLOCKS_LIVE 1024
+
+namespace {
+
+/* Small allocations of varying size, each thread keeping a window of blocks alive and handing
+ * part of them to the next thread to free, as happens when data is created in parallel and freed
+ * elsewhere. */
+void allocation_thread_func(std::vector<void *> *handover, const unsigned int seed)
+{
+  std::vector<void *> blocks(NUM_BLOCKS_LIVE, nullptr);
+  unsigned int num = seed;
+  for (int i = 0; i < NUM_ITERATIONS; i++) {
+    num = num * 1103515245u + 12345u;
+    const size_t index = (num >> 8) % NUM_BLOCKS_LIVE;
+    const size_t len = 8 + (num >> 20) % 256;
+    if (blocks[index] != nullptr) {
+      if (index % 8 == 0) {
+        handover->push_back(blocks[index]);
+      }
+      else {
+        MEM_freeN(blocks[index]);
+      }
+    }
+    blocks[index] = (index % 2) ? MEM_callocN(len, __func__) : MEM_mallocN(len, __func__);
+  }
+  for (void *block : blocks) {
+    if (block != nullptr) {
+      MEM_freeN(block);
+    }
+  }
+}
+
+void allocation_test_do(const char *id, const int num_threads, const bool use_slab)
+{
+  MEM_use_slab_allocator(use_slab);
+
+  double averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    std::vector<std::vector<void *>> handovers(num_threads);
+    std::vector<std::thread> threads;
+
+    const auto time_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back(allocation_thread_func, &handovers[i], (unsigned int)i);
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    /* Free handed over blocks from other threads than the ones allocating them. */
+    threads.clear();
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&handovers, i]() {
+        for (void *block : handovers[i]) {
+          MEM_freeN(block);
+        }
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    averaged_timing +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - time_start).count();
+  }
+
+  printf("\t%s: %d threads with %s allocator: %fs on average over %d runs\n",
+         id,
+         num_threads,
+         use_slab ? "slab" : "system",
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  MEM_use_slab_allocator(false);
+}
+
+}  // namespace
+
+TEST(guardedalloc, SmallAllocationsSingleThread)
+{
+  allocation_test_do("SmallAllocationsSingleThread", 1, false);
+  allocation_test_do("SmallAllocationsSingleThread", 1, true);
+}
+
+TEST(guardedalloc, SmallAllocationsMultiThread)
+{
+  const int num_threads = std::max((int)std::thread::hardware_concurrency(), 2);
+  allocation_test_do("SmallAllocationsMultiThread", num_threads, false);
+  allocation_test_do("SmallAllocationsMultiThread", num_threads, true);
+}
@@ -0,0 +1,94 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+namespace {
+
+class SlabAllocatorTest : public ::testing::Test {
+ protected:
+  size_t mem_in_use;
+  unsigned int blocks_in_use;
+
+  void SetUp() override
+  {
+    mem_in_use = MEM_get_memory_in_use();
+    blocks_in_use = MEM_get_memory_blocks_in_use();
+    MEM_use_slab_allocator(true);
+  }
+
+  void TearDown() override
+  {
+    MEM_use_slab_allocator(false);
+    EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+    EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+  }
+};
+
+}  // namespace
+
+/* Lengths and memory usage are the same as for blocks from the system allocator. */
+TEST_F(SlabAllocatorTest, Accounting)
+{
+  std::vector<void *> blocks;
+  size_t len_total = 0;
+  for (size_t len = 1; len < 1024; len += 7) {
+    blocks.push_back(MEM_mallocN(len, __func__));
+    EXPECT_EQ(MEM_allocN_len(blocks.back()), (len + 3) & ~(size_t)3);
+    len_total += MEM_allocN_len(blocks.back());
+  }
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use + len_total);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use + blocks.size());
+
+  for (void *block : blocks) {
+    MEM_freeN(block);
+  }
+}
+
+/* Recycled blocks are cleared and keep their contents when duplicated or reallocated. */
+TEST_F(SlabAllocatorTest, Contents)
+{
+  for (size_t len = 4; len < 600; len += 4) {
+    char *block = (char *)MEM_mallocN(len, __func__);
+    memset(block, 1, len);
+    MEM_freeN(block);
+
+    block = (char *)MEM_callocN(len, __func__);
+    EXPECT_EQ(std::vector<char>(block, block + len), std::vector<char>(len, 0));
+    memset(block, 2, len);
+
+    char *block_dup = (char *)MEM_dupallocN(block);
+    EXPECT_EQ(memcmp(block, block_dup, len), 0);
+    MEM_freeN(block_dup);
+
+    block = (char *)MEM_recallocN(block, len * 2);
+    EXPECT_EQ(std::vector<char>(block, block + len), std::vector<char>(len, 2));
+    EXPECT_EQ(std::vector<char>(block + len, block + len * 2), std::vector<char>(len, 0));
+    MEM_freeN(block);
+  }
+}
+
+/* Blocks can be freed by another thread, and after switching the slab allocator off. */
+TEST_F(SlabAllocatorTest, FreeFromOtherThread)
+{
+  std::vector<void *> blocks(10000);
+  std::thread thread([&blocks]() {
+    for (size_t i = 0; i < blocks.size(); i++) {
+      blocks[i] = MEM_mallocN(i % 300, __func__);
+    }
+  });
+  thread.join();
+
+  for (size_t i = 0; i < blocks.size(); i += 2) {
+    MEM_freeN(blocks[i]);
+  }
+  MEM_use_slab_allocator(false);
+  for (size_t i = 1; i < blocks.size(); i += 2) {
+    MEM_freeN(blocks[i]);
+  }
+}
@@ -0,0 +1,309 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_collection.h"
+#include "BKE_colortools.h"
+#include "BKE_curveprofile.h"
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_DerivedMesh.h"
+#include "BKE_layer.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_object.h"
+#include "BKE_object_deform.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_color_types.h"
+#include "DNA_curveprofile_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+}
+
+#define GRID_SIZE 8
+
+/* Solidify, bevel with a custom profile, vertex weights mapped by a curve and a
+ * displacement by those weights: every modifier can be cached and the first two build
+ * new geometry, so the results of a partially cached stack depend on all of them. */
+class ModifierStackCacheTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  Object *ob = nullptr;
+  BevelModifierData *bmd = nullptr;
+  WeightVGEditModifierData *wmd = nullptr;
+  DisplaceModifierData *dmd = nullptr;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    ViewLayer *view_layer = BKE_view_layer_default_view(scene);
+
+    ob = BKE_object_add_only_object(bmain, OB_MESH, "Object");
+    ob->data = mesh_create();
+    BKE_collection_object_add(bmain, scene->master_collection, ob);
+    BKE_object_defgroup_add_name(ob, "Group");
+    /* Only the active object is cached. */
+    view_layer->basact = BKE_view_layer_base_find(view_layer, ob);
+
+    SolidifyModifierData *smd = (SolidifyModifierData *)modifier_add(eModifierType_Solidify);
+    smd->offset = 1.0f;
+
+    bmd = (BevelModifierData *)modifier_add(eModifierType_Bevel);
+    bmd->res = 3;
+    bmd->flags |= MOD_BEVEL_CUSTOM_PROFILE;
+    BKE_curveprofile_insert(bmd->custom_profile, 0.8f, 0.8f);
+    BKE_curveprofile_update(bmd->custom_profile, false);
+
+    wmd = (WeightVGEditModifierData *)modifier_add(eModifierType_WeightVGEdit);
+    STRNCPY(wmd->defgrp_name, "Group");
+    wmd->falloff_type = MOD_WVG_MAPPING_CURVE;
+
+    dmd = (DisplaceModifierData *)modifier_add(eModifierType_Displace);
+    STRNCPY(dmd->defgrp_name, "Group");
+
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+
+    /* The first evaluation of an input only stores its hash, the second one the results. */
+    object_update();
+  }
+
+  void TearDown() override
+  {
+    BlendfileLoadingBaseTest::TearDown();
+    BKE_main_free(bmain);
+    bmain = nullptr;
+  }
+
+  /* A grid folded along its rows, so the edges bevel to the custom profile. */
+  Mesh *mesh_create()
+  {
+    const int verts_len = GRID_SIZE * GRID_SIZE;
+    const int polys_len = (GRID_SIZE - 1) * (GRID_SIZE - 1);
+    Mesh *me = BKE_mesh_add(bmain, "Mesh");
+    me->totvert = verts_len;
+    me->totloop = polys_len * 4;
+    me->totpoly = polys_len;
+    me->mvert = (MVert *)CustomData_add_layer(
+        &me->vdata, CD_MVERT, CD_CALLOC, nullptr, me->totvert);
+    me->dvert = (MDeformVert *)CustomData_add_layer(
+        &me->vdata, CD_MDEFORMVERT, CD_CALLOC, nullptr, me->totvert);
+    me->mloop = (MLoop *)CustomData_add_layer(
+        &me->ldata, CD_MLOOP, CD_CALLOC, nullptr, me->totloop);
+    me->mpoly = (MPoly *)CustomData_add_layer(
+        &me->pdata, CD_MPOLY, CD_CALLOC, nullptr, me->totpoly);
+
+    for (int y = 0; y < GRID_SIZE; y++) {
+      for (int x = 0; x < GRID_SIZE; x++) {
+        const int v = y * GRID_SIZE + x;
+        me->mvert[v].co[0] = (float)x;
+        me->mvert[v].co[1] = (float)y;
+        me->mvert[v].co[2] = (y % 2) ? 0.5f : 0.0f;
+        defvert_add_index_notest(&me->dvert[v], 0, 0.2f + 0.6f * (float)x / GRID_SIZE);
+      }
+    }
+
+    MLoop *ml = me->mloop;
+    MPoly *mp = me->mpoly;
+    for (int y = 0; y < GRID_SIZE - 1; y++) {
+      for (int x = 0; x < GRID_SIZE - 1; x++, mp++) {
+        const int v = y * GRID_SIZE + x;
+        mp->loopstart = (int)(ml - me->mloop);
+        mp->totloop = 4;
+        (ml++)->v = v;
+        (ml++)->v = v + 1;
+        (ml++)->v = v + GRID_SIZE + 1;
+        (ml++)->v = v + GRID_SIZE;
+      }
+    }
+    BKE_mesh_calc_edges(me, false, false);
+    return me;
+  }
+
+  ModifierData *modifier_add(const int type)
+  {
+    ModifierData *md = modifier_new(type);
+    BLI_addtail(&ob->modifiers, md);
+    return md;
+  }
+
+  /* Evaluate the object again, the same way editing a modifier setting does. */
+  void object_update()
+  {
+    DEG_id_tag_update_ex(bmain, &ob->id, ID_RECALC_GEOMETRY);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  Object *object_eval()
+  {
+    return DEG_get_evaluated_object(depsgraph, ob);
+  }
+
+  const Mesh *mesh_eval()
+  {
+    return object_eval()->runtime.mesh_eval;
+  }
+
+  /* Keep the displacements only, the second one depends on the normals from the first. */
+  void modifiers_deform_only_set()
+  {
+    LISTBASE_FOREACH (ModifierData *, md, &ob->modifiers) {
+      if (md->type != eModifierType_Displace) {
+        md->mode &= ~eModifierMode_Realtime;
+      }
+    }
+    dmd->direction = MOD_DISP_DIR_Z;
+    DisplaceModifierData *dmd_next = (DisplaceModifierData *)modifier_add(
+        eModifierType_Displace);
+    dmd_next->strength = 0.25f;
+  }
+
+  int modifiers_enabled_len()
+  {
+    int len = 0;
+    LISTBASE_FOREACH (ModifierData *, md, &ob->modifiers) {
+      if (md->mode & eModifierMode_Realtime) {
+        len++;
+      }
+    }
+    return len;
+  }
+
+  std::vector<float> positions_eval()
+  {
+    const Mesh *me_eval = mesh_eval();
+    std::vector<float> positions;
+    for (int i = 0; i < me_eval->totvert; i++) {
+      positions.insert(positions.end(), me_eval->mvert[i].co, me_eval->mvert[i].co + 3);
+    }
+    return positions;
+  }
+
+  /* Evaluate after a change, the result must be the same as without any cached data. */
+  void update_test_do(const int reused_len_expected)
+  {
+    const std::vector<float> positions_prev = positions_eval();
+
+    object_update();
+    EXPECT_EQ(mesh_modifier_stack_cache_reused_len(object_eval()), reused_len_expected);
+    const std::vector<float> positions = positions_eval();
+
+    mesh_modifier_stack_cache_free(object_eval());
+    object_update();
+    EXPECT_EQ(mesh_modifier_stack_cache_reused_len(object_eval()), 0);
+    EXPECT_EQ(positions, positions_eval());
+
+    if (reused_len_expected != modifiers_enabled_len()) {
+      EXPECT_NE(positions, positions_prev);
+    }
+
+    /* Store the results again for the next change. */
+    object_update();
+  }
+};
+
+TEST_F(ModifierStackCacheTest, IdenticalSettings)
+{
+  update_test_do(4);
+  update_test_do(4);
+}
+
+TEST_F(ModifierStackCacheTest, SettingsChange)
+{
+  bmd->value = 0.15f;
+  update_test_do(1);
+
+  dmd->strength = 0.5f;
+  update_test_do(3);
+}
+
+/* Settings behind pointers change while the pointers stay the same. */
+TEST_F(ModifierStackCacheTest, PointerSettingsChange)
+{
+  CurveProfilePoint *point = &bmd->custom_profile->path[1];
+  point->x = 0.2f;
+  point->y = 0.4f;
+  BKE_curveprofile_update(bmd->custom_profile, false);
+  update_test_do(1);
+
+  CurveMapPoint *cmap_point = &wmd->cmap_curve->cm[0].curve[0];
+  cmap_point->y = 0.5f;
+  BKE_curvemapping_changed(wmd->cmap_curve, false);
+  update_test_do(2);
+}
+
+/* Input geometry changes are detected as well. */
+TEST_F(ModifierStackCacheTest, InputChange)
+{
+  Mesh *me = (Mesh *)ob->data;
+  me->mvert[0].co[2] = 1.0f;
+  DEG_id_tag_update_ex(bmain, &me->id, ID_RECALC_GEOMETRY);
+  update_test_do(0);
+  update_test_do(4);
+}
+
+/* Stacks which only deform are cached as well. */
+TEST_F(ModifierStackCacheTest, DeformOnly)
+{
+  modifiers_deform_only_set();
+  update_test_do(0);
+  update_test_do(2);
+
+  dmd->strength = 0.5f;
+  update_test_do(0);
+}
+
+/* When only the input coordinates change, the copy of the input keeps its topology,
+ * which deformed results share from one evaluation to the next. */
+TEST_F(ModifierStackCacheTest, CoordinatesChange)
+{
+  modifiers_deform_only_set();
+  object_update();
+  object_update();
+  EXPECT_EQ(mesh_modifier_stack_cache_reused_len(object_eval()), 2);
+  const MLoop *mloop_prev = mesh_eval()->mloop;
+  EXPECT_NE(mloop_prev, ((const Mesh *)DEG_get_evaluated_id(depsgraph, (ID *)ob->data))->mloop);
+
+  Mesh *me = (Mesh *)ob->data;
+  me->mvert[0].co[2] = 1.0f;
+  DEG_id_tag_update_ex(bmain, &me->id, ID_RECALC_GEOMETRY);
+  object_update();
+  EXPECT_EQ(mesh_modifier_stack_cache_reused_len(object_eval()), 0);
+  object_update();
+  object_update();
+  EXPECT_EQ(mesh_modifier_stack_cache_reused_len(object_eval()), 2);
+  EXPECT_EQ(mesh_eval()->mloop, mloop_prev);
+}
+
+/* Objects which aren't active don't keep their results. */
+TEST_F(ModifierStackCacheTest, InactiveObject)
+{
+  EXPECT_NE(object_eval()->runtime.modifier_stack_cache, nullptr);
+
+  BKE_view_layer_default_view(scene)->basact = nullptr;
+  DEG_id_tag_update_ex(bmain, &scene->id, ID_RECALC_COPY_ON_WRITE);
+  object_update();
+  EXPECT_EQ(object_eval()->runtime.modifier_stack_cache, nullptr);
+}
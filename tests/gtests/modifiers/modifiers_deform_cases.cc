@@ -0,0 +1,325 @@
+/* Apache License, Version 2.0 */
+
+#include "modifiers_deform_cases.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_string.h"
+
+#include "DNA_action_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_curve_types.h"
+#include "DNA_lattice_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_armature.h"
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_lattice.h"
+#include "BKE_library.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+
+#include "bmesh.h"
+}
+
+/* A grid of quads spanning [-1, 1] in X and Y, with a wavy Z so all axes are used.
+ * Every vertex is in a vertex group, with weights varying over the grid. */
+static Mesh *mesh_grid_create(const int verts_x)
+{
+  BMeshCreateParams create_params = {0};
+  create_params.use_toolflags = true;
+  BMesh *bm = BM_mesh_create(&bm_mesh_allocsize_default, &create_params);
+  float mat[4][4];
+  unit_m4(mat);
+  BMO_op_callf(bm,
+               BMO_FLAG_DEFAULTS,
+               "create_grid x_segments=%i y_segments=%i size=%f matrix=%m4 calc_uvs=%b",
+               verts_x,
+               verts_x,
+               1.0f,
+               mat,
+               false);
+  Mesh *me = (Mesh *)BKE_id_new_nomain(ID_ME, NULL);
+  BM_mesh_bm_to_me_for_eval(bm, me, NULL);
+  BM_mesh_free(bm);
+
+  CustomData_add_layer(&me->vdata, CD_MDEFORMVERT, CD_CALLOC, NULL, me->totvert);
+  BKE_mesh_update_customdata_pointers(me, false);
+  for (int i = 0; i < me->totvert; i++) {
+    float *co = me->mvert[i].co;
+    co[2] = 0.1f * sinf(co[0] * 8.0f) * cosf(co[1] * 8.0f);
+    defvert_add_index_notest(&me->dvert[i], 0, (float)(i % 5) / 4.0f);
+  }
+  BKE_mesh_calc_normals(me);
+  return me;
+}
+
+/* The hook indices are mapped through the original index of a generated mesh. */
+static void mesh_add_origindex(Mesh *me)
+{
+  int *origindex = (int *)CustomData_add_layer(
+      &me->vdata, CD_ORIGINDEX, CD_CALLOC, NULL, me->totvert);
+  for (int i = 0; i < me->totvert; i++) {
+    origindex[i] = i;
+  }
+}
+
+static Object *object_create(const short type, void *data)
+{
+  Object *ob = (Object *)BKE_id_new_nomain(ID_OB, NULL);
+  ob->type = type;
+  ob->data = data;
+  unit_m4(ob->obmat);
+  unit_m4(ob->imat);
+  return ob;
+}
+
+static void object_add_vgroup(Object *ob, const char *name)
+{
+  bDeformGroup *dg = (bDeformGroup *)MEM_callocN(sizeof(*dg), __func__);
+  STRNCPY(dg->name, name);
+  BLI_addtail(&ob->defbase, dg);
+}
+
+/* Lattice scaled unevenly, so every vertex moves. */
+static Object *object_lattice_create(void)
+{
+  Lattice *lt = (Lattice *)BKE_id_new_nomain(ID_LT, NULL);
+  BKE_lattice_resize(lt, 4, 4, 4, NULL);
+  for (int i = 0; i < lt->pntsu * lt->pntsv * lt->pntsw; i++) {
+    mul_v3_fl(lt->def[i].vec, 2.0f + 0.25f * (float)(i % 3));
+  }
+  return object_create(OB_LATTICE, lt);
+}
+
+/* Posed armature with bones along X, the last one scaled non-uniformly so the dual quaternion
+ * scale path is used as well. */
+static Object *object_armature_create(void)
+{
+  bArmature *arm = (bArmature *)BKE_id_new_nomain(ID_AR, NULL);
+  for (int i = 0; i < DEFORM_CASE_ARMATURE_BONES; i++) {
+    Bone *bone = (Bone *)MEM_callocN(sizeof(*bone), __func__);
+    BLI_snprintf(bone->name, sizeof(bone->name), "Bone%d", i);
+    bone->segments = 1;
+    unit_m4(bone->arm_mat);
+    bone->arm_mat[3][0] = (float)i * 0.5f - 0.75f;
+    BLI_addtail(&arm->bonebase, bone);
+  }
+
+  Object *ob_arm = object_create(OB_ARMATURE, arm);
+  BKE_pose_rebuild(NULL, ob_arm, arm, false);
+
+  int i = 0;
+  LISTBASE_FOREACH (bPoseChannel *, pchan, &ob_arm->pose->chanbase) {
+    const float loc[3] = {0.1f * (float)i, 0.05f, -0.1f};
+    const float eul[3] = {0.2f, -0.1f * (float)i, 0.3f * (float)i};
+    const float size[3] = {1.0f, (i == DEFORM_CASE_ARMATURE_BONES - 1) ? 1.3f : 1.0f, 1.0f};
+    loc_eul_size_to_mat4(pchan->chan_mat, loc, eul, size);
+    mat4_to_dquat(&pchan->runtime.deform_dual_quat, pchan->bone->arm_mat, pchan->chan_mat);
+    i++;
+  }
+  return ob_arm;
+}
+
+/* Add a vertex group per bone, every vertex is weighted to two or three bones. */
+static void mesh_add_bone_weights(Object *ob, Mesh *me)
+{
+  for (int i = 0; i < DEFORM_CASE_ARMATURE_BONES; i++) {
+    char name[MAX_VGROUP_NAME];
+    BLI_snprintf(name, sizeof(name), "Bone%d", i);
+    object_add_vgroup(ob, name);
+  }
+  for (int i = 0; i < me->totvert; i++) {
+    const int bone = i % DEFORM_CASE_ARMATURE_BONES;
+    defvert_add_index_notest(&me->dvert[i], 1 + bone, 0.6f);
+    defvert_add_index_notest(&me->dvert[i], 1 + (bone + 1) % DEFORM_CASE_ARMATURE_BONES, 0.3f);
+    if (i % 3) {
+      defvert_add_index_notest(
+          &me->dvert[i], 1 + (bone + 2) % DEFORM_CASE_ARMATURE_BONES, 0.25f);
+    }
+  }
+}
+
+static ModifierData *cast_create(const char type)
+{
+  CastModifierData *cmd = (CastModifierData *)modifier_new(eModifierType_Cast);
+  cmd->type = type;
+  cmd->fac = 0.75f;
+  STRNCPY(cmd->defgrp_name, DEFORM_CASE_VGROUP_NAME);
+  return &cmd->modifier;
+}
+
+static ModifierData *smooth_create(void)
+{
+  SmoothModifierData *smd = (SmoothModifierData *)modifier_new(eModifierType_Smooth);
+  smd->repeat = 4;
+  STRNCPY(smd->defgrp_name, DEFORM_CASE_VGROUP_NAME);
+  return &smd->modifier;
+}
+
+static ModifierData *simpledeform_create(const char mode)
+{
+  SimpleDeformModifierData *smd = (SimpleDeformModifierData *)modifier_new(
+      eModifierType_SimpleDeform);
+  smd->mode = mode;
+  smd->deform_axis = 2;
+  smd->limit[0] = 0.1f;
+  smd->limit[1] = 0.9f;
+  return &smd->modifier;
+}
+
+static ModifierData *warp_create(DeformCase *dc)
+{
+  Object *ob_to = object_create(OB_EMPTY, NULL);
+  Object *ob_from = object_create(OB_EMPTY, NULL);
+  copy_v3_fl3(ob_to->obmat[3], 0.2f, 0.1f, 0.3f);
+  rotate_m4(ob_to->obmat, 'Z', 0.5f);
+  dc->ob_targets[0] = ob_to;
+  dc->ob_targets[1] = ob_from;
+
+  WarpModifierData *wmd = (WarpModifierData *)modifier_new(eModifierType_Warp);
+  wmd->object_from = ob_from;
+  wmd->object_to = ob_to;
+  wmd->falloff_type = eWarp_Falloff_Curve;
+  wmd->flag |= MOD_WARP_VOLUME_PRESERVE;
+  STRNCPY(wmd->defgrp_name, DEFORM_CASE_VGROUP_NAME);
+  return &wmd->modifier;
+}
+
+static ModifierData *hook_create(DeformCase *dc, const bool use_indices)
+{
+  Object *ob_hook = object_create(OB_EMPTY, NULL);
+  copy_v3_fl3(ob_hook->obmat[3], 0.0f, 0.0f, 0.5f);
+  dc->ob_targets[0] = ob_hook;
+
+  HookModifierData *hmd = (HookModifierData *)modifier_new(eModifierType_Hook);
+  hmd->object = ob_hook;
+  hmd->falloff = 0.75f;
+  unit_m4(hmd->parentinv);
+  if (use_indices) {
+    /* Hook every other vertex. */
+    hmd->totindex = dc->me->totvert / 2;
+    hmd->indexar = (int *)MEM_malloc_arrayN((size_t)hmd->totindex, sizeof(int), __func__);
+    for (int i = 0; i < hmd->totindex; i++) {
+      hmd->indexar[i] = i * 2;
+    }
+    mesh_add_origindex(dc->me);
+  }
+  else {
+    STRNCPY(hmd->name, DEFORM_CASE_VGROUP_NAME);
+  }
+  return &hmd->modifier;
+}
+
+DeformCase *deform_case_create(const eDeformCaseType type, const int verts_x)
+{
+  BKE_modifier_init();
+
+  DeformCase *dc = (DeformCase *)MEM_callocN(sizeof(*dc), __func__);
+  dc->type = type;
+  dc->me = mesh_grid_create(verts_x);
+  dc->ob = object_create(OB_MESH, dc->me);
+  object_add_vgroup(dc->ob, DEFORM_CASE_VGROUP_NAME);
+
+  switch (type) {
+    case DEFORM_CASE_CAST_SPHERE:
+      dc->md = cast_create(MOD_CAST_TYPE_SPHERE);
+      break;
+    case DEFORM_CASE_CAST_CUBOID:
+      dc->md = cast_create(MOD_CAST_TYPE_CUBOID);
+      break;
+    case DEFORM_CASE_SMOOTH:
+      dc->md = smooth_create();
+      break;
+    case DEFORM_CASE_SIMPLEDEFORM_TWIST:
+      dc->md = simpledeform_create(MOD_SIMPLEDEFORM_MODE_TWIST);
+      break;
+    case DEFORM_CASE_SIMPLEDEFORM_BEND:
+      dc->md = simpledeform_create(MOD_SIMPLEDEFORM_MODE_BEND);
+      break;
+    case DEFORM_CASE_WARP:
+      dc->md = warp_create(dc);
+      break;
+    case DEFORM_CASE_HOOK_VGROUP:
+      dc->md = hook_create(dc, false);
+      break;
+    case DEFORM_CASE_HOOK_ORIGINDEX:
+      dc->md = hook_create(dc, true);
+      break;
+    case DEFORM_CASE_LATTICE:
+      dc->ob_targets[0] = object_lattice_create();
+      break;
+    case DEFORM_CASE_ARMATURE_LINEAR_BLEND:
+    case DEFORM_CASE_ARMATURE_DUAL_QUATERNION:
+      dc->ob_targets[0] = object_armature_create();
+      mesh_add_bone_weights(dc->ob, dc->me);
+      dc->deformflag = ARM_DEF_VGROUP;
+      if (type == DEFORM_CASE_ARMATURE_DUAL_QUATERNION) {
+        dc->deformflag |= ARM_DEF_QUATERNION;
+      }
+      break;
+  }
+  return dc;
+}
+
+void deform_case_free(DeformCase *dc)
+{
+  if (dc->md) {
+    modifier_free_ex(dc->md, LIB_ID_CREATE_NO_USER_REFCOUNT);
+  }
+  for (int i = 0; i < ARRAY_SIZE(dc->ob_targets); i++) {
+    Object *ob_target = dc->ob_targets[i];
+    if (ob_target == NULL) {
+      continue;
+    }
+    ID *data = (ID *)ob_target->data;
+    BKE_id_free(NULL, ob_target);
+    if (data) {
+      BKE_id_free(NULL, data);
+    }
+  }
+  BKE_id_free(NULL, dc->ob);
+  BKE_id_free(NULL, dc->me);
+  MEM_freeN(dc);
+}
+
+void deform_case_exec(const DeformCase *dc, float (*vert_coords)[3])
+{
+  Object *ob = dc->ob;
+  Mesh *me = dc->me;
+
+  switch (dc->type) {
+    case DEFORM_CASE_LATTICE:
+      lattice_deform_verts(
+          dc->ob_targets[0], ob, me, vert_coords, me->totvert, DEFORM_CASE_VGROUP_NAME, 1.0f);
+      break;
+    case DEFORM_CASE_ARMATURE_LINEAR_BLEND:
+    case DEFORM_CASE_ARMATURE_DUAL_QUATERNION:
+      armature_deform_verts(dc->ob_targets[0],
+                            ob,
+                            me,
+                            vert_coords,
+                            NULL,
+                            me->totvert,
+                            dc->deformflag,
+                            NULL,
+                            NULL,
+                            NULL);
+      break;
+    default: {
+      const ModifierTypeInfo *mti = modifierType_getInfo((ModifierType)dc->md->type);
+      const ModifierEvalContext ctx = {NULL, ob, (ModifierApplyFlag)0};
+      mti->deformVerts(dc->md, &ctx, me, vert_coords, me->totvert);
+      break;
+    }
+  }
+}
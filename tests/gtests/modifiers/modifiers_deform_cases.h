@@ -0,0 +1,52 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __MODIFIERS_DEFORM_CASES_H__
+#define __MODIFIERS_DEFORM_CASES_H__
+
+struct Mesh;
+struct ModifierData;
+struct Object;
+
+#define DEFORM_CASE_VGROUP_NAME "Group"
+#define DEFORM_CASE_ARMATURE_BONES 4
+
+/* Deformations shared by the modifiers_deform tests and benchmarks. */
+typedef enum eDeformCaseType {
+  DEFORM_CASE_CAST_SPHERE = 0,
+  DEFORM_CASE_CAST_CUBOID,
+  DEFORM_CASE_SMOOTH,
+  DEFORM_CASE_SIMPLEDEFORM_TWIST,
+  DEFORM_CASE_SIMPLEDEFORM_BEND,
+  DEFORM_CASE_WARP,
+  DEFORM_CASE_HOOK_VGROUP,
+  DEFORM_CASE_HOOK_ORIGINDEX,
+  DEFORM_CASE_LATTICE,
+  DEFORM_CASE_ARMATURE_LINEAR_BLEND,
+  DEFORM_CASE_ARMATURE_DUAL_QUATERNION,
+} eDeformCaseType;
+
+typedef struct DeformCase {
+  eDeformCaseType type;
+
+  /* The deformed object, owning the grid mesh and the vertex groups. */
+  struct Object *ob;
+  struct Mesh *me;
+
+  /* The modifier doing the deformation, NULL for lattice and armature deform. */
+  struct ModifierData *md;
+  /* Objects the deformation depends on: the lattice, armature or hook object,
+   * or the warp destination and source. */
+  struct Object *ob_targets[2];
+
+  /* Armature deform flags. */
+  int deformflag;
+} DeformCase;
+
+/* Set up the deformation of a grid of `verts_x * verts_x` vertices. */
+DeformCase *deform_case_create(const eDeformCaseType type, const int verts_x);
+void deform_case_free(DeformCase *dc);
+
+/* Deform `vert_coords`, which holds a position for every vertex of the grid. */
+void deform_case_exec(const DeformCase *dc, float (*vert_coords)[3]);
+
+#endif /* __MODIFIERS_DEFORM_CASES_H__ */
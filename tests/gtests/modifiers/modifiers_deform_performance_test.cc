@@ -0,0 +1,115 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "modifiers_deform_cases.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+
+#include "BKE_mesh.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_RUN_AVERAGED 5
+
+static void deform_performance_test_do(const char *id,
+                                       const eDeformCaseType type,
+                                       const int verts_x)
+{
+  BLI_threadapi_init();
+  DeformCase *dc = deform_case_create(type, verts_x);
+  const int totvert = dc->me->totvert;
+
+  float(*vert_coords_orig)[3] = BKE_mesh_vert_coords_alloc(dc->me, NULL);
+  float(*vert_coords)[3] = (float(*)[3])MEM_malloc_arrayN(
+      (size_t)totvert, sizeof(*vert_coords), __func__);
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    memcpy(vert_coords, vert_coords_orig, sizeof(*vert_coords) * (size_t)totvert);
+
+    const double init_time = PIL_check_seconds_timer();
+    deform_case_exec(dc, vert_coords);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+
+  printf("\t%s: %d vertices deformed in %fs on average over %d runs\n",
+         id,
+         totvert,
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  MEM_freeN(vert_coords);
+  MEM_freeN(vert_coords_orig);
+  deform_case_free(dc);
+  BLI_threadapi_exit();
+}
+
+TEST(modifiers_deform_performance, CastSphere1000K)
+{
+  deform_performance_test_do("Cast sphere - 1000K vertices", DEFORM_CASE_CAST_SPHERE, 1000);
+}
+
+TEST(modifiers_deform_performance, CastCuboid1000K)
+{
+  deform_performance_test_do("Cast cuboid - 1000K vertices", DEFORM_CASE_CAST_CUBOID, 1000);
+}
+
+TEST(modifiers_deform_performance, Smooth1000K)
+{
+  deform_performance_test_do("Smooth x4 - 1000K vertices", DEFORM_CASE_SMOOTH, 1000);
+}
+
+TEST(modifiers_deform_performance, SimpleDeformTwist1000K)
+{
+  deform_performance_test_do(
+      "SimpleDeform twist - 1000K vertices", DEFORM_CASE_SIMPLEDEFORM_TWIST, 1000);
+}
+
+TEST(modifiers_deform_performance, SimpleDeformBend1000K)
+{
+  deform_performance_test_do(
+      "SimpleDeform bend - 1000K vertices", DEFORM_CASE_SIMPLEDEFORM_BEND, 1000);
+}
+
+TEST(modifiers_deform_performance, Warp1000K)
+{
+  deform_performance_test_do("Warp - 1000K vertices", DEFORM_CASE_WARP, 1000);
+}
+
+TEST(modifiers_deform_performance, HookVertexGroup1000K)
+{
+  deform_performance_test_do(
+      "Hook vertex group - 1000K vertices", DEFORM_CASE_HOOK_VGROUP, 1000);
+}
+
+TEST(modifiers_deform_performance, HookOrigIndex1000K)
+{
+  deform_performance_test_do(
+      "Hook original indices - 1000K vertices", DEFORM_CASE_HOOK_ORIGINDEX, 1000);
+}
+
+TEST(modifiers_deform_performance, Lattice1000K)
+{
+  deform_performance_test_do("Lattice 4x4x4 - 1000K vertices", DEFORM_CASE_LATTICE, 1000);
+}
+
+TEST(modifiers_deform_performance, ArmatureLinearBlend1000K)
+{
+  deform_performance_test_do(
+      "Armature linear blend - 1000K vertices", DEFORM_CASE_ARMATURE_LINEAR_BLEND, 1000);
+}
+
+TEST(modifiers_deform_performance, ArmatureDualQuaternion1000K)
+{
+  deform_performance_test_do(
+      "Armature dual quaternion - 1000K vertices", DEFORM_CASE_ARMATURE_DUAL_QUATERNION, 1000);
+}
@@ -0,0 +1,233 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "modifiers_deform_cases.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "DNA_action_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_armature.h"
+#include "BKE_lattice.h"
+#include "BKE_mesh.h"
+}
+
+/* Enough vertices for every kernel to be split over all threads. */
+#define VERTS_X 100
+#define NUM_THREADS 8
+
+/* Recreate the task scheduler with the given number of threads. */
+static void threads_set(const int num_threads)
+{
+  BLI_threadapi_exit();
+  BLI_system_num_threads_override_set(num_threads);
+  BLI_threadapi_init();
+}
+
+static float (*deform_case_coords(const DeformCase *dc))[3]
+{
+  float(*vert_coords)[3] = BKE_mesh_vert_coords_alloc(dc->me, NULL);
+  deform_case_exec(dc, vert_coords);
+  return vert_coords;
+}
+
+/* The modifiers decide on threading from the vertex count, so the serial reference is made with
+ * a single thread scheduler instead, which runs all tasks on the calling thread. The deformation
+ * of a vertex does not depend on how the vertices are split over threads, so both have to give
+ * exactly the same result. */
+static void deform_test_do(const eDeformCaseType type)
+{
+  BLI_threadapi_init();
+  DeformCase *dc = deform_case_create(type, VERTS_X);
+  const Mesh *me = dc->me;
+
+  threads_set(1);
+  float(*vert_coords_serial)[3] = deform_case_coords(dc);
+  threads_set(NUM_THREADS);
+  float(*vert_coords)[3] = deform_case_coords(dc);
+  threads_set(0);
+
+  EXPECT_EQ(memcmp(vert_coords, vert_coords_serial, sizeof(*vert_coords) * (size_t)me->totvert),
+            0);
+
+  int totvert_moved = 0;
+  bool is_finite = true;
+  for (int i = 0; i < me->totvert; i++) {
+    if (!equals_v3v3(vert_coords[i], me->mvert[i].co)) {
+      totvert_moved++;
+    }
+    if (!(std::isfinite(vert_coords[i][0]) && std::isfinite(vert_coords[i][1]) &&
+          std::isfinite(vert_coords[i][2]))) {
+      is_finite = false;
+    }
+  }
+  EXPECT_GT(totvert_moved, 0);
+  EXPECT_TRUE(is_finite);
+
+  MEM_freeN(vert_coords);
+  MEM_freeN(vert_coords_serial);
+  deform_case_free(dc);
+  BLI_threadapi_exit();
+}
+
+TEST(modifiers_deform, CastSphere)
+{
+  deform_test_do(DEFORM_CASE_CAST_SPHERE);
+}
+
+TEST(modifiers_deform, CastCuboid)
+{
+  deform_test_do(DEFORM_CASE_CAST_CUBOID);
+}
+
+TEST(modifiers_deform, Smooth)
+{
+  deform_test_do(DEFORM_CASE_SMOOTH);
+}
+
+TEST(modifiers_deform, SimpleDeformTwist)
+{
+  deform_test_do(DEFORM_CASE_SIMPLEDEFORM_TWIST);
+}
+
+TEST(modifiers_deform, SimpleDeformBend)
+{
+  deform_test_do(DEFORM_CASE_SIMPLEDEFORM_BEND);
+}
+
+TEST(modifiers_deform, Warp)
+{
+  deform_test_do(DEFORM_CASE_WARP);
+}
+
+TEST(modifiers_deform, HookVertexGroup)
+{
+  deform_test_do(DEFORM_CASE_HOOK_VGROUP);
+}
+
+TEST(modifiers_deform, HookOrigIndex)
+{
+  deform_test_do(DEFORM_CASE_HOOK_ORIGINDEX);
+}
+
+TEST(modifiers_deform, Lattice)
+{
+  deform_test_do(DEFORM_CASE_LATTICE);
+}
+
+/* Per bone skinning of a single vertex, as armature deform did before the bone matrices were
+ * blended, used as reference. */
+static void armature_deform_reference(const Object *ob_arm,
+                                      const MDeformVert *dvert,
+                                      const bool use_quaternion,
+                                      float co[3],
+                                      float defmat[3][3])
+{
+  float vec[3] = {0.0f, 0.0f, 0.0f};
+  DualQuat dq;
+  float contrib = 0.0f;
+
+  memset(&dq, 0, sizeof(dq));
+  zero_m3(defmat);
+
+  for (int j = 0; j < dvert->totweight; j++) {
+    const MDeformWeight *dw = &dvert->dw[j];
+    const bPoseChannel *pchan = (const bPoseChannel *)BLI_findlink(&ob_arm->pose->chanbase,
+                                                                   dw->def_nr - 1);
+    if (pchan == NULL) {
+      continue;
+    }
+    if (use_quaternion) {
+      add_weighted_dq_dq(&dq, &pchan->runtime.deform_dual_quat, dw->weight);
+    }
+    else {
+      float tmp[3], tmpmat[3][3];
+      mul_v3_m4v3(tmp, pchan->chan_mat, co);
+      sub_v3_v3(tmp, co);
+      madd_v3_v3fl(vec, tmp, dw->weight);
+      copy_m3_m4(tmpmat, pchan->chan_mat);
+      madd_m3_m3m3fl(defmat, defmat, tmpmat, dw->weight);
+    }
+    contrib += dw->weight;
+  }
+
+  if (use_quaternion) {
+    normalize_dq(&dq, contrib);
+    mul_v3m3_dq(co, defmat, &dq);
+  }
+  else {
+    madd_v3_v3fl(co, vec, 1.0f / contrib);
+    mul_m3_fl(defmat, 1.0f / contrib);
+  }
+}
+
+/* Compare against per bone skinning, including the crazy-space matrices. */
+static void armature_test_do(const eDeformCaseType type)
+{
+  deform_test_do(type);
+
+  BLI_threadapi_init();
+  DeformCase *dc = deform_case_create(type, VERTS_X);
+  const Mesh *me = dc->me;
+  const bool use_quaternion = (dc->deformflag & ARM_DEF_QUATERNION) != 0;
+
+  float(*vert_coords)[3] = BKE_mesh_vert_coords_alloc(me, NULL);
+  float(*def_mats)[3][3] = (float(*)[3][3])MEM_malloc_arrayN(
+      (size_t)me->totvert, sizeof(*def_mats), __func__);
+  for (int i = 0; i < me->totvert; i++) {
+    unit_m3(def_mats[i]);
+  }
+  armature_deform_verts(dc->ob_targets[0],
+                        dc->ob,
+                        dc->me,
+                        vert_coords,
+                        def_mats,
+                        me->totvert,
+                        dc->deformflag,
+                        NULL,
+                        NULL,
+                        NULL);
+
+  float max_co_error = 0.0f, max_mat_error = 0.0f;
+  for (int i = 0; i < me->totvert; i++) {
+    float co[3], defmat[3][3];
+    copy_v3_v3(co, me->mvert[i].co);
+    armature_deform_reference(dc->ob_targets[0], &me->dvert[i], use_quaternion, co, defmat);
+    for (int k = 0; k < 3; k++) {
+      max_co_error = max_ff(max_co_error, fabsf(co[k] - vert_coords[i][k]));
+      for (int l = 0; l < 3; l++) {
+        max_mat_error = max_ff(max_mat_error, fabsf(defmat[k][l] - def_mats[i][k][l]));
+      }
+    }
+  }
+  EXPECT_LT(max_co_error, 1e-5f);
+  EXPECT_LT(max_mat_error, 1e-5f);
+
+  MEM_freeN(def_mats);
+  MEM_freeN(vert_coords);
+  deform_case_free(dc);
+  BLI_threadapi_exit();
+}
+
+TEST(modifiers_deform, ArmatureLinearBlend)
+{
+  armature_test_do(DEFORM_CASE_ARMATURE_LINEAR_BLEND);
+}
+
+TEST(modifiers_deform, ArmatureDualQuaternion)
+{
+  armature_test_do(DEFORM_CASE_ARMATURE_DUAL_QUATERNION);
+}